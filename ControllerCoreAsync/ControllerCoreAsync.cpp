@@ -0,0 +1,268 @@
+/*  NAME:
+        ControllerCoreAsync.cpp
+
+    DESCRIPTION:
+        C++20 coroutine facade over the asynchronous calls of ControllerCoreOSX.
+		
+		Binds the completion procs of ControllerCoreOSX to CC3AsyncOperation and
+		implements the value and pose streams.
+      
+    COPYRIGHT:
+        Copyright (c) 1999-2005, Quesa Developers. All rights reserved.
+
+        For the current release of Quesa, please see:
+
+            <http://www.quesa.org/>
+        
+        Redistribution and use in source and binary forms, with or without
+        modification, are permitted provided that the following conditions
+        are met:
+        
+            o Redistributions of source code must retain the above copyright
+              notice, this list of conditions and the following disclaimer.
+        
+            o Redistributions in binary form must reproduce the above
+              copyright notice, this list of conditions and the following
+              disclaimer in the documentation and/or other materials provided
+              with the distribution.
+        
+            o Neither the name of Quesa nor the names of its contributors
+              may be used to endorse or promote products derived from this
+              software without specific prior written permission.
+        
+        THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+        "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+        LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+        A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+        OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+        SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+        TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+        PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+        LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+        NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+        SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+    ___________________________________________________________________________
+*/
+
+//=============================================================================
+//      Include files
+//-----------------------------------------------------------------------------
+#include "E3Prefix.h"
+#include "ControllerCoreAsync.h"
+
+#include <string.h>
+
+
+
+
+
+//=============================================================================
+//      Internal functions
+//-----------------------------------------------------------------------------
+//=============================================================================
+//      CC3Async_ValuesCompleted : TC3ValuesCompletionProc of the value calls.
+//-----------------------------------------------------------------------------
+static void
+CC3Async_ValuesCompleted(TQ3Status status, TQ3ControllerRef controllerRef, TQ3Uns32 valueCount, const float *values, TQ3Boolean active, TQ3Uns32 serialNumber, void *userData)
+{
+	TC3AsyncCall<TC3AsyncValues> *call = (TC3AsyncCall<TC3AsyncValues>*)userData;
+	
+	if (valueCount>kQ3MaxControllerValues)
+		valueCount = kQ3MaxControllerValues;
+	
+	call->result.status = status;
+	call->result.controllerRef = controllerRef;
+	call->result.valueCount = (status==kQ3Success) ? valueCount : 0;
+	if ((call->result.valueCount>0) && (values!=NULL))
+		memcpy(call->result.values, values, call->result.valueCount*sizeof(float));
+	call->result.active = active;
+	call->result.serialNumber = serialNumber;
+	
+	CC3AsyncOperation<TC3AsyncValues>::Complete(call);
+}
+
+
+
+//=============================================================================
+//      CC3Async_PositionCompleted : TC3PositionCompletionProc.
+//-----------------------------------------------------------------------------
+static void
+CC3Async_PositionCompleted(TQ3Status status, TQ3ControllerRef controllerRef, const TQ3Point3D *position, void *userData)
+{
+	TC3AsyncCall<TC3AsyncPosition> *call = (TC3AsyncCall<TC3AsyncPosition>*)userData;
+	
+	call->result.status = ((status==kQ3Success) && (position!=NULL)) ? kQ3Success : kQ3Failure;
+	if (call->result.status==kQ3Success)
+		call->result.position = *position;
+	
+	CC3AsyncOperation<TC3AsyncPosition>::Complete(call);
+}
+
+
+
+//=============================================================================
+//      CC3Async_OrientationCompleted : TC3OrientationCompletionProc.
+//-----------------------------------------------------------------------------
+static void
+CC3Async_OrientationCompleted(TQ3Status status, TQ3ControllerRef controllerRef, const TQ3Quaternion *orientation, void *userData)
+{
+	TC3AsyncCall<TC3AsyncOrientation> *call = (TC3AsyncCall<TC3AsyncOrientation>*)userData;
+	
+	call->result.status = ((status==kQ3Success) && (orientation!=NULL)) ? kQ3Success : kQ3Failure;
+	if (call->result.status==kQ3Success)
+		call->result.orientation = *orientation;
+	
+	CC3AsyncOperation<TC3AsyncOrientation>::Complete(call);
+}
+
+
+
+//=============================================================================
+//      CC3Async_Start* : Issue the call of an operation.
+//-----------------------------------------------------------------------------
+static TQ3Status
+CC3Async_StartGetValues(const TC3AsyncRequest &request, TC3AsyncCall<TC3AsyncValues> *call)
+{
+	return(CC3OSXController_GetValuesAsync(request.controllerRef, request.valueCount, CC3Async_ValuesCompleted, call));
+}
+
+static TQ3Status
+CC3Async_StartWaitForValues(const TC3AsyncRequest &request, TC3AsyncCall<TC3AsyncValues> *call)
+{
+	return(CC3OSXController_WaitForValues(request.controllerRef, request.valueCount, request.serialNumber, CC3Async_ValuesCompleted, call));
+}
+
+static TQ3Status
+CC3Async_StartGetTrackerPosition(const TC3AsyncRequest &request, TC3AsyncCall<TC3AsyncPosition> *call)
+{
+	return(CC3OSXController_GetTrackerPositionAsync(request.controllerRef, CC3Async_PositionCompleted, call));
+}
+
+static TQ3Status
+CC3Async_StartGetTrackerOrientation(const TC3AsyncRequest &request, TC3AsyncCall<TC3AsyncOrientation> *call)
+{
+	return(CC3OSXController_GetTrackerOrientationAsync(request.controllerRef, CC3Async_OrientationCompleted, call));
+}
+
+
+
+
+
+//=============================================================================
+//      Public functions
+//-----------------------------------------------------------------------------
+//=============================================================================
+//      CC3Async_GetValues : Awaitable CC3OSXController_GetValuesAsync.
+//-----------------------------------------------------------------------------
+CC3AsyncOperation<TC3AsyncValues>
+CC3Async_GetValues(TQ3ControllerRef controllerRef, TQ3Uns32 valueCount)
+{
+	TC3AsyncRequest request = {controllerRef, valueCount, 0};
+	
+	return(CC3AsyncOperation<TC3AsyncValues>(CC3Async_StartGetValues, request));
+}
+
+
+
+//=============================================================================
+//      CC3Async_WaitForValues : Awaitable CC3OSXController_WaitForValues.
+//-----------------------------------------------------------------------------
+CC3AsyncOperation<TC3AsyncValues>
+CC3Async_WaitForValues(TQ3ControllerRef controllerRef, TQ3Uns32 valueCount, TQ3Uns32 serialNumber)
+{
+	TC3AsyncRequest request = {controllerRef, valueCount, serialNumber};
+	
+	return(CC3AsyncOperation<TC3AsyncValues>(CC3Async_StartWaitForValues, request));
+}
+
+
+
+//=============================================================================
+//      CC3Async_GetTrackerPosition : Awaitable
+//				CC3OSXController_GetTrackerPositionAsync.
+//-----------------------------------------------------------------------------
+CC3AsyncOperation<TC3AsyncPosition>
+CC3Async_GetTrackerPosition(TQ3ControllerRef controllerRef)
+{
+	TC3AsyncRequest request = {controllerRef, 0, 0};
+	
+	return(CC3AsyncOperation<TC3AsyncPosition>(CC3Async_StartGetTrackerPosition, request));
+}
+
+
+
+//=============================================================================
+//      CC3Async_GetTrackerOrientation : Awaitable
+//				CC3OSXController_GetTrackerOrientationAsync.
+//-----------------------------------------------------------------------------
+CC3AsyncOperation<TC3AsyncOrientation>
+CC3Async_GetTrackerOrientation(TQ3ControllerRef controllerRef)
+{
+	TC3AsyncRequest request = {controllerRef, 0, 0};
+	
+	return(CC3AsyncOperation<TC3AsyncOrientation>(CC3Async_StartGetTrackerOrientation, request));
+}
+
+
+
+//=============================================================================
+//      CC3Async_ValueStream : Every value change of a controller.
+//-----------------------------------------------------------------------------
+//		Note : Serial number 0 is never current, so the first element holds
+//				the values the controller has now. A server wait that expires
+//				without a change is re-armed, not yielded.
+//-----------------------------------------------------------------------------
+CC3AsyncGenerator<TC3AsyncValues>
+CC3Async_ValueStream(TQ3ControllerRef controllerRef, TQ3Uns32 valueCount)
+{
+	TQ3Uns32 serialNumber = 0;
+	
+	for (;;)
+	{
+		TC3AsyncValues values = co_await CC3Async_WaitForValues(controllerRef, valueCount, serialNumber);
+		if (values.status==kQ3Failure)
+			co_return;
+		
+		if (values.serialNumber==serialNumber)
+			continue;
+		serialNumber = values.serialNumber;
+		
+		co_yield values;
+	}
+}
+
+
+
+//=============================================================================
+//      CC3Async_PoseStream : Tracker pose of a controller after each change.
+//-----------------------------------------------------------------------------
+//		Note : Driven by the value changes of the controller, which come with
+//				each tracker update of its driver.
+//-----------------------------------------------------------------------------
+CC3AsyncGenerator<TC3AsyncPose>
+CC3Async_PoseStream(TQ3ControllerRef controllerRef)
+{
+	TQ3Uns32 serialNumber = 0;
+	
+	for (;;)
+	{
+		TC3AsyncValues values = co_await CC3Async_WaitForValues(controllerRef, 0, serialNumber);
+		if (values.status==kQ3Failure)
+			co_return;
+		
+		if (values.serialNumber==serialNumber)
+			continue;
+		serialNumber = values.serialNumber;
+		
+		TC3AsyncPosition position = co_await CC3Async_GetTrackerPosition(controllerRef);
+		if (position.status==kQ3Failure)
+			co_return;
+		
+		TC3AsyncOrientation orientation = co_await CC3Async_GetTrackerOrientation(controllerRef);
+		if (orientation.status==kQ3Failure)
+			co_return;
+		
+		TC3AsyncPose pose = {position.position, orientation.orientation, serialNumber};
+		co_yield pose;
+	}
+}
@@ -0,0 +1,387 @@
+/*  NAME:
+        ControllerCoreAsync.h
+
+    DESCRIPTION:
+        C++20 coroutine facade over the asynchronous calls of ControllerCoreOSX.
+		
+		co_await CC3Async_GetValues, CC3Async_WaitForValues,
+		CC3Async_GetTrackerPosition or CC3Async_GetTrackerOrientation from any
+		coroutine; CC3Async_ValueStream and CC3Async_PoseStream are async
+		generators, read with co_await stream.Next(). A pending call costs one
+		small heap block and a parked server request, no thread.
+		
+		Coroutines resume on the run loop of the thread that started the call,
+		as the completion procs of ControllerCoreOSX do; that run loop must run.
+		
+		Header plus a static library, built alongside ControllerCoreOSX with a
+		C++20 compiler, from this directory:
+		
+		    c++ -std=c++20 -c -I../ControllerCoreOSX ControllerCoreAsync.cpp
+		    ar rcs libControllerCoreAsync.a ControllerCoreAsync.o
+		
+		Link clients against libControllerCoreAsync.a and ControllerCoreOSX.
+      
+    COPYRIGHT:
+        Copyright (c) 1999-2005, Quesa Developers. All rights reserved.
+
+        For the current release of Quesa, please see:
+
+            <http://www.quesa.org/>
+        
+        Redistribution and use in source and binary forms, with or without
+        modification, are permitted provided that the following conditions
+        are met:
+        
+            o Redistributions of source code must retain the above copyright
+              notice, this list of conditions and the following disclaimer.
+        
+            o Redistributions in binary form must reproduce the above
+              copyright notice, this list of conditions and the following
+              disclaimer in the documentation and/or other materials provided
+              with the distribution.
+        
+            o Neither the name of Quesa nor the names of its contributors
+              may be used to endorse or promote products derived from this
+              software without specific prior written permission.
+        
+        THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+        "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+        LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+        A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+        OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+        SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+        TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+        PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+        LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+        NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+        SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+    ___________________________________________________________________________
+*/
+
+#ifndef CONTROLLERCOREASYNC_HDR
+#define CONTROLLERCOREASYNC_HDR
+//=============================================================================
+//      Include files
+//-----------------------------------------------------------------------------
+#include <coroutine>
+#include <exception>
+#include <optional>
+#include <utility>
+
+#include "ControllerCoreOSX.h"
+
+//=============================================================================
+//      Types
+//-----------------------------------------------------------------------------
+//results of the awaitable calls; status is kQ3Failure if the call failed
+typedef struct TC3AsyncValues
+{
+	TQ3Status				status;
+	TQ3ControllerRef		controllerRef;
+	TQ3Uns32				valueCount;
+	float					values[kQ3MaxControllerValues];
+	TQ3Boolean				active;
+	TQ3Uns32				serialNumber;
+} TC3AsyncValues;
+
+typedef struct TC3AsyncPosition
+{
+	TQ3Status				status;
+	TQ3Point3D				position;
+} TC3AsyncPosition;
+
+typedef struct TC3AsyncOrientation
+{
+	TQ3Status				status;
+	TQ3Quaternion			orientation;
+} TC3AsyncOrientation;
+
+//element of CC3Async_PoseStream
+typedef struct TC3AsyncPose
+{
+	TQ3Point3D				position;
+	TQ3Quaternion			orientation;
+	TQ3Uns32				serialNumber;	//of the value change that triggered it
+} TC3AsyncPose;
+
+//parameters of one asynchronous call
+typedef struct TC3AsyncRequest
+{
+	TQ3ControllerRef		controllerRef;
+	TQ3Uns32				valueCount;
+	TQ3Uns32				serialNumber;
+} TC3AsyncRequest;
+
+typedef enum TC3AsyncCallState
+{
+	kC3AsyncCallStarting	= 0,	//inside the CC3OSXController_ call
+	kC3AsyncCallWaiting		= 1,	//a coroutine is suspended on it
+	kC3AsyncCallDone		= 2,	//result is set
+	kC3AsyncCallOrphaned	= 3		//the awaiting coroutine was destroyed
+} TC3AsyncCallState;
+
+/*
+TC3AsyncCall:
+-shared by an awaiter and the completion proc of its call
+-freed by whoever sees it last: await_resume, the awaiter's destructor, or a
+ completion proc that finds it orphaned
+*/
+template<typename TResult>
+struct TC3AsyncCall
+{
+	TResult					result;
+	std::coroutine_handle<>	waiter;
+	TC3AsyncCallState		state;
+};
+
+/*
+CC3AsyncOperation:
+-awaitable of one asynchronous call; start issues the call with the call block
+ as userData, its completion proc goes through CC3AsyncOperation::Complete
+-does not suspend if the call fails to start or completes right away
+*/
+template<typename TResult>
+class CC3AsyncOperation
+{
+public:
+	typedef TQ3Status (*TStartProc)(const TC3AsyncRequest &request, TC3AsyncCall<TResult> *call);
+	
+	CC3AsyncOperation(TStartProc start, const TC3AsyncRequest &request)
+		: mStart(start), mRequest(request), mCall(NULL)
+	{
+		mResult.status = kQ3Failure;
+	}
+	
+	CC3AsyncOperation(CC3AsyncOperation &&other)
+		: mStart(other.mStart), mRequest(other.mRequest), mResult(other.mResult), mCall(other.mCall)
+	{
+		other.mCall = NULL;
+	}
+	
+	CC3AsyncOperation(const CC3AsyncOperation&) = delete;
+	CC3AsyncOperation &operator=(const CC3AsyncOperation&) = delete;
+	
+	~CC3AsyncOperation()
+	{
+		if (mCall==NULL)
+			return;
+		if (mCall->state==kC3AsyncCallWaiting)
+			mCall->state = kC3AsyncCallOrphaned;//the completion proc frees it
+		else
+			delete mCall;
+	}
+	
+	bool await_ready() const noexcept
+	{
+		return(false);
+	}
+	
+	bool await_suspend(std::coroutine_handle<> waiter)
+	{
+		TC3AsyncCall<TResult> *call = new TC3AsyncCall<TResult>;
+		
+		call->result.status = kQ3Failure;
+		call->waiter = waiter;
+		call->state = kC3AsyncCallStarting;
+		
+		if (mStart(mRequest, call)==kQ3Failure)
+		{
+			//the completion proc never runs
+			delete call;
+			return(false);
+		}
+		
+		if (call->state==kC3AsyncCallDone)
+		{
+			//completed from within the call, e.g. the server went away
+			mResult = call->result;
+			delete call;
+			return(false);
+		}
+		
+		call->state = kC3AsyncCallWaiting;
+		mCall = call;
+		return(true);
+	}
+	
+	TResult await_resume()
+	{
+		if (mCall!=NULL)
+		{
+			mResult = mCall->result;
+			delete mCall;
+			mCall = NULL;
+		}
+		return(mResult);
+	}
+	
+	//to be called by the completion proc once call->result is set
+	static void Complete(TC3AsyncCall<TResult> *call)
+	{
+		switch (call->state)
+		{
+			case kC3AsyncCallStarting:
+				call->state = kC3AsyncCallDone;
+				break;
+			
+			case kC3AsyncCallWaiting:
+				//call may be gone once the waiter runs
+				call->state = kC3AsyncCallDone;
+				call->waiter.resume();
+				break;
+			
+			case kC3AsyncCallOrphaned:
+				delete call;
+				break;
+			
+			default:
+				break;
+		}
+	}
+
+private:
+	TStartProc				mStart;
+	TC3AsyncRequest			mRequest;
+	TResult					mResult;
+	TC3AsyncCall<TResult>	*mCall;		//NULL unless suspended
+};
+
+/*
+CC3AsyncGenerator:
+-async generator with a single consumer; the body runs only while the
+ consumer waits in co_await Next()
+-Next() yields the next element, or nothing once the body has returned
+-destroying it abandons a body suspended on a pending call
+*/
+template<typename T>
+class CC3AsyncGenerator
+{
+public:
+	struct promise_type;
+	typedef std::coroutine_handle<promise_type> THandle;
+	
+	//hands control back to the consumer on co_yield and at the end
+	struct TYieldAwaiter
+	{
+		bool await_ready() const noexcept
+		{
+			return(false);
+		}
+		
+		std::coroutine_handle<> await_suspend(THandle body) noexcept
+		{
+			return(body.promise().consumer);
+		}
+		
+		void await_resume() const noexcept
+		{
+		}
+	};
+	
+	struct promise_type
+	{
+		std::optional<T>		current;
+		std::coroutine_handle<>	consumer;
+		
+		CC3AsyncGenerator get_return_object()
+		{
+			return(CC3AsyncGenerator(THandle::from_promise(*this)));
+		}
+		
+		std::suspend_always initial_suspend() const noexcept
+		{
+			return(std::suspend_always());
+		}
+		
+		TYieldAwaiter final_suspend() const noexcept
+		{
+			return(TYieldAwaiter());
+		}
+		
+		TYieldAwaiter yield_value(T value)
+		{
+			current = std::move(value);
+			return(TYieldAwaiter());
+		}
+		
+		void return_void()
+		{
+		}
+		
+		void unhandled_exception()
+		{
+			std::terminate();
+		}
+	};
+	
+	struct TNextAwaiter
+	{
+		THandle					body;
+		
+		bool await_ready() const noexcept
+		{
+			return(!body || body.done());
+		}
+		
+		std::coroutine_handle<> await_suspend(std::coroutine_handle<> consumer)
+		{
+			body.promise().consumer = consumer;
+			body.promise().current.reset();
+			return(body);
+		}
+		
+		std::optional<T> await_resume()
+		{
+			if (!body || body.done())
+				return(std::nullopt);
+			return(std::move(body.promise().current));
+		}
+	};
+	
+	explicit CC3AsyncGenerator(THandle body)
+		: mBody(body)
+	{
+	}
+	
+	CC3AsyncGenerator(CC3AsyncGenerator &&other)
+		: mBody(std::exchange(other.mBody, nullptr))
+	{
+	}
+	
+	CC3AsyncGenerator(const CC3AsyncGenerator&) = delete;
+	CC3AsyncGenerator &operator=(const CC3AsyncGenerator&) = delete;
+	
+	~CC3AsyncGenerator()
+	{
+		if (mBody)
+			mBody.destroy();
+	}
+	
+	TNextAwaiter Next()
+	{
+		return(TNextAwaiter{mBody});
+	}
+
+private:
+	THandle					mBody;
+};
+
+//=============================================================================
+//      Function prototypes
+//-----------------------------------------------------------------------------
+//awaitable forms of CC3OSXController_GetValuesAsync, _WaitForValues,
+//_GetTrackerPositionAsync and _GetTrackerOrientationAsync
+CC3AsyncOperation<TC3AsyncValues>		CC3Async_GetValues(TQ3ControllerRef controllerRef, TQ3Uns32 valueCount);
+CC3AsyncOperation<TC3AsyncValues>		CC3Async_WaitForValues(TQ3ControllerRef controllerRef, TQ3Uns32 valueCount, TQ3Uns32 serialNumber);
+CC3AsyncOperation<TC3AsyncPosition>		CC3Async_GetTrackerPosition(TQ3ControllerRef controllerRef);
+CC3AsyncOperation<TC3AsyncOrientation>	CC3Async_GetTrackerOrientation(TQ3ControllerRef controllerRef);
+
+//every value change of a controller, starting with its current values;
+//ends when a call fails, e.g. once the controller is decommissioned
+CC3AsyncGenerator<TC3AsyncValues>		CC3Async_ValueStream(TQ3ControllerRef controllerRef, TQ3Uns32 valueCount);
+
+//tracker pose of a controller after each of its value changes; ends like
+//CC3Async_ValueStream
+CC3AsyncGenerator<TC3AsyncPose>			CC3Async_PoseStream(TQ3ControllerRef controllerRef);
+
+#endif
@@ -0,0 +1,244 @@
+/*  NAME:
+        C3EventRing.c
+
+    DESCRIPTION:
+        Internal to ControllerCoreOSX; see C3EventRing.h.
+		
+		Appending is O(1); an event arriving with an older stamp than the
+		newest one is moved into place by insertion. Once the ring is full the
+		oldest event is dropped. Lookup is a bsearch, or a short walk from a
+		cursor.
+      
+    COPYRIGHT:
+        Copyright (c) 1999-2005, Quesa Developers. All rights reserved.
+
+        For the current release of Quesa, please see:
+
+            <http://www.quesa.org/>
+        
+        Redistribution and use in source and binary forms, with or without
+        modification, are permitted provided that the following conditions
+        are met:
+        
+            o Redistributions of source code must retain the above copyright
+              notice, this list of conditions and the following disclaimer.
+        
+            o Redistributions in binary form must reproduce the above
+              copyright notice, this list of conditions and the following
+              disclaimer in the documentation and/or other materials provided
+              with the distribution.
+        
+            o Neither the name of Quesa nor the names of its contributors
+              may be used to endorse or promote products derived from this
+              software without specific prior written permission.
+        
+        THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+        "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+        LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+        A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+        OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+        SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+        TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+        PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+        LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+        NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+        SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+    ___________________________________________________________________________
+*/
+
+
+
+
+#include "C3EventRing.h"
+
+
+
+
+
+//=============================================================================
+//      Public functions
+//-----------------------------------------------------------------------------
+//      CC3EventRing_Init : Allocate an empty ring.
+//-----------------------------------------------------------------------------
+//		Note : capacity must be a power of two.
+//-----------------------------------------------------------------------------
+TQ3Status
+CC3EventRing_Init(TC3EventRing *ring, TQ3Uns32 capacity)
+{
+	ring->events = (TC3TrackerEventPtr)malloc(capacity*sizeof(TC3TrackerEvent));
+	if (ring->events==NULL)
+		return(kQ3Failure);
+	
+	ring->capacity = capacity;
+	ring->head = 0;
+	ring->count = 0;
+	ring->firstSequence = 0;
+	return(kQ3Success);
+}
+
+
+
+//=============================================================================
+//      CC3EventRing_Dispose : Free the slots of a ring.
+//-----------------------------------------------------------------------------
+void
+CC3EventRing_Dispose(TC3EventRing *ring)
+{
+	free(ring->events);
+	ring->events = NULL;
+	ring->capacity = 0;
+	ring->count = 0;
+}
+
+
+
+//=============================================================================
+//      CC3EventRing_SetCapacity : Resize a ring.
+//-----------------------------------------------------------------------------
+//		Note : Rounded up to a power of two. On shrinking the newest events
+//				are kept.
+//-----------------------------------------------------------------------------
+TQ3Status
+CC3EventRing_SetCapacity(TC3EventRing *ring, TQ3Uns32 capacity)
+{
+	TQ3Uns32			newCapacity = 1;
+	TQ3Uns32			keepCount,firstKept,index;
+	TC3TrackerEventPtr	newEvents;
+	
+	if ((capacity==0)||(capacity>kC3EventRingMaxCapacity))
+		return(kQ3Failure);
+		
+	while (newCapacity<capacity)
+		newCapacity <<= 1;
+		
+	if (newCapacity==ring->capacity)
+		return(kQ3Success);
+	
+	newEvents = (TC3TrackerEventPtr)malloc(newCapacity*sizeof(TC3TrackerEvent));
+	if (newEvents==NULL)
+		return(kQ3Failure);
+	
+	//unwrap into the new ring, starting at slot 0
+	keepCount = ring->count;
+	if (keepCount>newCapacity)
+		keepCount = newCapacity;
+	firstKept = ring->count-keepCount;
+	for (index=0; index<keepCount; index++)
+		newEvents[index] = *CC3EventRing_At(ring,firstKept+index);
+	
+	free(ring->events);
+	ring->events = newEvents;
+	ring->capacity = newCapacity;
+	ring->head = 0;
+	ring->count = keepCount;
+	ring->firstSequence += firstKept;
+	
+	return(kQ3Success);
+}
+
+
+
+//=============================================================================
+//      CC3EventRing_Insert : Make room for an event, in stamp order.
+//-----------------------------------------------------------------------------
+//		Note : Identical stamps keep their arrival order. The caller fills
+//				in everything but EventTimeStamp. NULL if the ring is full and
+//				the event is older than all stored ones: the newest history
+//				is kept rather than the late event.
+//-----------------------------------------------------------------------------
+TC3TrackerEventPtr
+CC3EventRing_Insert(TC3EventRing *ring, TQ3Uns32 timeStamp)
+{
+	TC3TrackerEventPtr	workEvent;
+	TQ3Uns32			index;
+	
+	//if ring is full, drop oldest, or the event if it is older still
+	if (ring->count==ring->capacity)
+	{
+		if (timeStamp < CC3EventRing_At(ring,0)->EventTimeStamp)
+			return(NULL);
+		
+		ring->head = (ring->head+1) & (ring->capacity-1);
+		ring->count--;
+		ring->firstSequence++;
+	}
+	
+	index = ring->count;
+	while ((index>0) && (CC3EventRing_At(ring,index-1)->EventTimeStamp > timeStamp))
+	{
+		*CC3EventRing_At(ring,index) = *CC3EventRing_At(ring,index-1);
+		index--;
+	}
+	ring->count++;
+	
+	workEvent = CC3EventRing_At(ring,index);
+	workEvent->EventTimeStamp = timeStamp;
+	return(workEvent);
+}
+
+
+
+//=============================================================================
+//      CC3EventRing_Find : Binary search by stamp; no allocation.
+//-----------------------------------------------------------------------------
+TQ3Uns32
+CC3EventRing_Find(const TC3EventRing *ring, TQ3Uns32 timeStamp)
+{
+	TQ3Uns32 low = 0;
+	TQ3Uns32 high = ring->count;
+	
+	while (low<high)
+	{
+		TQ3Uns32 mid = low + ((high-low)>>1);
+		if (CC3EventRing_At(ring,mid)->EventTimeStamp < timeStamp)
+			low = mid+1;
+		else
+			high = mid;
+	}
+	return(low);
+}
+
+
+
+//=============================================================================
+//      CC3EventRing_Locate : Number of events with a stamp <= timeStamp.
+//-----------------------------------------------------------------------------
+//		Note : A cursor remembers the previous answer as a sequence number;
+//				close queries are answered by walking from there, anything
+//				else by bsearch.
+//-----------------------------------------------------------------------------
+TQ3Uns32
+CC3EventRing_Locate(const TC3EventRing *ring, TQ3Uns32 *sequence, TQ3Uns32 timeStamp)
+{
+	TQ3Uns32 count = ring->count;
+	TQ3Uns32 found = count+1;//invalid
+	
+	if (sequence!=NULL)
+	{
+		TQ3Uns32 hint = *sequence - ring->firstSequence;
+		TQ3Uns32 steps = 0;
+		
+		if (hint<=count)
+		{
+			while ((hint<count) && (CC3EventRing_At(ring,hint)->EventTimeStamp <= timeStamp) && (steps<kC3EventRingCursorMaxWalk))
+				{ hint++; steps++; }
+			while ((hint>0) && (CC3EventRing_At(ring,hint-1)->EventTimeStamp > timeStamp) && (steps<kC3EventRingCursorMaxWalk))
+				{ hint--; steps++; }
+			if (steps<kC3EventRingCursorMaxWalk)
+				found = hint;
+		}
+	}
+	
+	if (found>count)
+	{
+		if (timeStamp==0xFFFFFFFF)
+			found = count;
+		else
+			found = CC3EventRing_Find(ring,timeStamp+1);
+	}
+	
+	if (sequence!=NULL)
+		*sequence = ring->firstSequence + found;
+	
+	return(found);
+}
@@ -0,0 +1,113 @@
+/*  NAME:
+        C3EventRing.h
+
+    DESCRIPTION:
+        Internal to ControllerCoreOSX, not one of its public headers; kept
+		apart so Tools/ControllerBench can link the ring without the rest
+		of the library.
+		
+		Time-stamped event history of a tracker: a fixed-capacity ring, kept
+		sorted by stamp, with cursor-assisted lookup.
+      
+    COPYRIGHT:
+        Copyright (c) 1999-2005, Quesa Developers. All rights reserved.
+
+        For the current release of Quesa, please see:
+
+            <http://www.quesa.org/>
+        
+        Redistribution and use in source and binary forms, with or without
+        modification, are permitted provided that the following conditions
+        are met:
+        
+            o Redistributions of source code must retain the above copyright
+              notice, this list of conditions and the following disclaimer.
+        
+            o Redistributions in binary form must reproduce the above
+              copyright notice, this list of conditions and the following
+              disclaimer in the documentation and/or other materials provided
+              with the distribution.
+        
+            o Neither the name of Quesa nor the names of its contributors
+              may be used to endorse or promote products derived from this
+              software without specific prior written permission.
+        
+        THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+        "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+        LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+        A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+        OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+        SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+        TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+        PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+        LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+        NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+        SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+    ___________________________________________________________________________
+*/
+
+
+
+
+#ifndef C3EventRing_HDR
+#define C3EventRing_HDR
+
+#include <Carbon/Carbon.h>
+
+//=============================================================================
+//		C++ preamble
+//-----------------------------------------------------------------------------
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define kC3EventRingMaxCapacity		65536
+#define kC3EventRingCursorMaxWalk	8		//beyond that a cursor falls back to bsearch
+
+typedef struct TC3TrackerEvent
+{
+	TQ3Uns32		EventTimeStamp;
+	TQ3Uns32		EventButtons;
+	TQ3Point3D		EventPosition;
+	TQ3Boolean		EventPositionIsNULL;
+	TQ3Quaternion	EventOrientation;
+	TQ3Boolean		EventOrientationIsNULL;
+} TC3TrackerEvent, *TC3TrackerEventPtr;
+
+typedef struct TC3EventRing
+{
+	TC3TrackerEventPtr		events;			//capacity slots, sorted by stamp from head on
+	TQ3Uns32				capacity;		//power of two
+	TQ3Uns32				head;			//slot of oldest event
+	TQ3Uns32				count;
+	TQ3Uns32				firstSequence;	//sequence number of the oldest event; for cursors
+} TC3EventRing;
+
+//i-th oldest event of a ring
+#define CC3EventRing_At(_ring,_i)	\
+	(&(_ring)->events[((_ring)->head+(_i)) & ((_ring)->capacity-1)])
+
+//=============================================================================
+//      Function prototypes
+//-----------------------------------------------------------------------------
+TQ3Status			CC3EventRing_Init(TC3EventRing *ring, TQ3Uns32 capacity);
+void				CC3EventRing_Dispose(TC3EventRing *ring);
+TQ3Status			CC3EventRing_SetCapacity(TC3EventRing *ring, TQ3Uns32 capacity);
+
+//slot for an event with timeStamp; only EventTimeStamp is set; NULL: dropped as too old
+TC3TrackerEventPtr	CC3EventRing_Insert(TC3EventRing *ring, TQ3Uns32 timeStamp);
+
+//logical index of the first event with a stamp >= timeStamp, or count
+TQ3Uns32			CC3EventRing_Find(const TC3EventRing *ring, TQ3Uns32 timeStamp);
+
+//number of events with a stamp <= timeStamp; sequence is a cursor and may be NULL
+TQ3Uns32			CC3EventRing_Locate(const TC3EventRing *ring, TQ3Uns32 *sequence, TQ3Uns32 timeStamp);
+
+//=============================================================================
+//		C++ postamble
+//-----------------------------------------------------------------------------
+#ifdef __cplusplus
+}
+#endif
+
+#endif
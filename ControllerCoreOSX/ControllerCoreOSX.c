@@ -58,6 +58,11 @@
 #include "ControllerCoreOSX.h"
 #include "IPCMessageIDs.h"
 #include "IPCPackUnpack.h"
+#include "IPCAsync.h"
+#include "IPCHandles.h"
+#include "IPCSharedData.h"
+#include "C3EventRing.h"
+#include "C3QuaternionMath.h"
 
 
 
@@ -69,6 +74,15 @@
 //-----------------------------------------------------------------------------
 // Internal constants go here
 
+#define kC3TrackerDefaultEventCapacity		16
+#define kC3TrackerDefaultMaxExtrapolation	50		//in time stamp units
+#define kC3TrackerSampleChunk				64
+#define kC3SlerpLinearCos					0.9999995f	//closer rotations (theta below about 1e-3) are interpolated linearly
+#define kC3TrackerDefaultMinCutoff			1.0f	//Hz
+#define kC3TrackerDefaultMaxLead			0.05f	//seconds
+#define kC3TrackerDerivateCutoff			1.0f	//Hz; One-Euro cutoff of the velocity
+#define kC3TrackerMinFeedInterval			0.0005	//seconds; a closer sample replaces the last one
+
 
 
 
@@ -79,20 +93,45 @@
 // Internal types go here
 
 
-typedef struct TC3TrackerEvent
+typedef struct TC3TrackerPredictor
 {
-	TQ3Uns32		EventTimeStamp;
-	TQ3Uns32		EventButtons;
-	TQ3Point3D		EventPosition;
-	TQ3Boolean		EventPositionIsNULL;
-	TQ3Quaternion	EventOrientation;
-	TQ3Boolean		EventOrientationIsNULL;
-} TC3TrackerEvent, *TC3TrackerEventPtr;
+	TC3TrackerPredictionMode	mode;
+	float						minCutoff;		//One-Euro only
+	float						beta;			//One-Euro only
+	float						maxLead;		//prediction is clamped to that many seconds
+	
+	TQ3Boolean					posPrimed;
+	CFAbsoluteTime				posTime;		//time of lastPosition
+	TQ3Point3D					lastPosition;
+	TQ3Point3D					filteredPosition;
+	TQ3Vector3D					velocity;		//units per second
+	
+	//state before the last fed position; a sample too close to that one replaces it
+	TQ3Boolean					posHasPrevious;
+	CFAbsoluteTime				prevPosTime;
+	TQ3Point3D					prevLastPosition;
+	TQ3Point3D					prevFilteredPosition;
+	TQ3Vector3D					prevVelocity;
+	
+	TQ3Boolean					oriPrimed;
+	CFAbsoluteTime				oriTime;		//time of lastOrientation
+	TQ3Quaternion				lastOrientation;
+	TQ3Quaternion				filteredOrientation;
+	TQ3Vector3D					angularVelocity;//rotation vector per second, tracker frame
+	
+	//state before the last fed orientation, as for the position
+	TQ3Boolean					oriHasPrevious;
+	CFAbsoluteTime				prevOriTime;
+	TQ3Quaternion				prevLastOrientation;
+	TQ3Quaternion				prevFilteredOrientation;
+	TQ3Vector3D					prevAngularVelocity;
+} TC3TrackerPredictor;
 
 typedef struct TC3TrackerInstanceData
 {
 	float			posThreshold;
 	float			oriThreshold;
+	float			oriThresholdCos;	//see CC3Quaternion_ReachesAngle
 	TQ3TrackerNotifyFunc 
 					theNotifyFunc;
 					
@@ -107,19 +146,63 @@ typedef struct TC3TrackerInstanceData
 	TQ3Uns32		posSerialNum;
 	TQ3Boolean		isActive;
 	
-	CFMutableArrayRef
-					eventsRingBuffer;
+	TC3EventRing	events;			//see C3EventRing.h
+	TQ3Uns32		eventsMaxExtrapolation;
 	
+	TC3TrackerPredictor
+					predictor;		//fed by Set/Move Position/Orientation
 	
-	CFUUIDRef		trackerUUID;
+	CFUUIDRef		trackerUUID;	//external identity only
+	TQ3Uns32		trackerHandle;	//key of ClientTrackers, used on the wire
 	TQ3Object		tracker_self;	//tracker_self is needed by notification functions
 	
 } TC3TrackerInstanceData;
 
+/*
+TC3AsyncCallData:
+-travels with an asynchronous request and is freed by its completion
+*/
+typedef struct TC3AsyncCallData
+{
+	TQ3ControllerRef				controllerRef;
+	TQ3Uns32						valueCount;
+	TC3ValuesCompletionProc			valuesProc;
+	TC3PositionCompletionProc		positionProc;
+	TC3OrientationCompletionProc	orientationProc;
+	TC3StateBatchCompletionProc		stateBatchProc;		//valueCount is the number of states
+	void							*userData;
+} TC3AsyncCallData, *TC3AsyncCallDataPtr;
+
+/*
+TC3DriverChannelsData:
+-channel methods of a controller created by this driver, for direct client calls
+-clients get handle and token of it from the device server
+*/
+typedef struct TC3DriverChannelsData
+{
+	TQ3ControllerRef		controllerRef;
+	TQ3Uns32				token;				//capability; a request without it is refused
+	TQ3ChannelSetMethod		channelSetMethod;
+	TQ3ChannelGetMethod		channelGetMethod;
+} TC3DriverChannelsData, *TC3DriverChannelsDataPtr;
+
+/*
+TC3DriverEndpoint:
+-where a client sends the channel calls of a controller, bypassing the device server
+*/
+typedef struct TC3DriverEndpoint
+{
+	TQ3ControllerRef			controllerRef;
+	CFMessagePortRef			driverPort;
+	TQ3Uns32					driverHandle;	//key of DriverChannels in the driver
+	TQ3Uns32					token;
+	struct TC3DriverEndpoint	*next;
+} TC3DriverEndpoint, *TC3DriverEndpointPtr;
+
 typedef struct TC3ControllerStateInstanceData
 {
 	TQ3ControllerRef	myController;
-	CFStringRef			ctrlStateUUIDString;
+	TQ3Uns32			ctrlStateHandle;
 } TC3ControllerStateInstanceData;
 
 //=============================================================================
@@ -163,9 +246,16 @@ static CFMessagePortRef			DeviceServerPort = NULL;
 /*
 ClientTrackers:
 -is used for IPC bookkeeping of trackers created by a controller client
--created at first creation of a tracker oject
+-maps the tracker handles sent to the device server back to tracker instances
 */	
-static CFMutableDictionaryRef	ClientTrackers	 = NULL;
+static TC3HandleTable			ClientTrackers	 = kIPCHandleTableEmpty;
+
+/*
+TrackerPortName:
+-name of TrackerServerPort; sent along with each tracker handle
+-created at first creation of a tracker object
+*/
+static CFStringRef				TrackerPortName	 = NULL;
 
 /*
 TrackerServerPort and TrackerRunLoopSource:
@@ -184,6 +274,19 @@ DeviceDriverPort and DeviceDriverRunLoopSource:
 static CFMessagePortRef			DeviceDriverPort = NULL;
 static CFRunLoopSourceRef 		DeviceDriverRunLoopSource = NULL;
 
+/*
+DriverChannels:
+-channel methods of the controllers of this driver, by the handle clients send directly
+*/
+static TC3HandleTable			DriverChannels	 = kIPCHandleTableEmpty;
+
+/*
+DriverEndpoints:
+-driver ports of controllers whose channels this client calls directly
+-filled on the first channel call of a controller
+*/
+static TC3DriverEndpointPtr		DriverEndpoints	 = NULL;
+
 //=============================================================================
 //      Internal function prototypes
 //-----------------------------------------------------------------------------
@@ -254,24 +357,149 @@ CC3Quaternion_Multiply(const TQ3Quaternion *q1, const TQ3Quaternion *q2, TQ3Quat
 }
 
 
+//=============================================================================
+//      CC3Point3D_LerpArray : Linear interpolation of count point pairs.
+//-----------------------------------------------------------------------------
+//		Note : u outside [0,1] extrapolates. Straight-line loop body, kept
+//				free of branches so the compiler can vectorize it.
+//-----------------------------------------------------------------------------
+static void
+CC3Point3D_LerpArray(TQ3Uns32 count, const TQ3Point3D *p0, const TQ3Point3D *p1, const float *u, TQ3Point3D *result)
+{
+	TQ3Uns32 i;
+	
+	for (i=0; i<count; i++)
+	{
+		result[i].x = p0[i].x + u[i]*(p1[i].x - p0[i].x);
+		result[i].y = p0[i].y + u[i]*(p1[i].y - p0[i].y);
+		result[i].z = p0[i].z + u[i]*(p1[i].z - p0[i].z);
+	}
+}
+
+//=============================================================================
+//      CC3Quaternion_SlerpArray : Spherical interpolation of count
+//				quaternion pairs.
+//-----------------------------------------------------------------------------
+//		Note : Takes the shorter arc. Falls back to normalized lerp for nearly
+//				identical rotations; the result is always renormalized.
+//				u > 1 extrapolates along the same great circle.
+//
+//				Plain scalar code: acos and sin are library calls per element,
+//				so this loop does not vectorize. Nearly identical rotations, the
+//				common case between close events, skip them.
+//-----------------------------------------------------------------------------
+static void
+CC3Quaternion_SlerpArray(TQ3Uns32 count, const TQ3Quaternion *q0, const TQ3Quaternion *q1, const float *u, TQ3Quaternion *result)
+{
+	TQ3Uns32 i;
+	
+	for (i=0; i<count; i++)
+	{
+		float cosTheta	= q0[i].w*q1[i].w + q0[i].x*q1[i].x + q0[i].y*q1[i].y + q0[i].z*q1[i].z;
+		float sign		= 1.0f;
+		float s0		= 1.0f-u[i];
+		float s1		= u[i];
+		
+		if (cosTheta < 0.0f)
+		{
+			cosTheta = -cosTheta;
+			sign = -1.0f;
+		}
+		
+		if (cosTheta < kC3SlerpLinearCos)
+		{
+			float theta		= (float) acos(cosTheta);
+			float invSin	= 1.0f / (float) sin(theta);
+			
+			s0 = (float) sin((1.0f-u[i])*theta) * invSin;
+			s1 = (float) sin(u[i]*theta) * invSin;
+		}
+		s1 *= sign;
+		
+		float w = s0*q0[i].w + s1*q1[i].w;
+		float x = s0*q0[i].x + s1*q1[i].x;
+		float y = s0*q0[i].y + s1*q1[i].y;
+		float z = s0*q0[i].z + s1*q1[i].z;
+		float invLen = 1.0f / (float) sqrt(w*w + x*x + y*y + z*z);
+		
+		result[i].w = w*invLen;
+		result[i].x = x*invLen;
+		result[i].y = y*invLen;
+		result[i].z = z*invLen;
+	}
+}
+
+//=============================================================================
+//      CC3Quaternion_ToRotationVector : Axis times angle of a rotation.
+//-----------------------------------------------------------------------------
+//		Note : Takes the shorter arc; q needs to be normalized.
+//-----------------------------------------------------------------------------
+static void
+CC3Quaternion_ToRotationVector(const TQ3Quaternion *q, TQ3Vector3D *result)
+{
+	float sign		= (q->w < 0.0f) ? -1.0f : 1.0f;
+	float sinHalf	= (float) sqrt(q->x*q->x + q->y*q->y + q->z*q->z);
+	float scale		= 2.0f;//limit of angle/sinHalf for small angles
+	
+	if (sinHalf > 1.0e-6f)
+		scale = 2.0f * (float) atan2(sinHalf, q->w*sign) / sinHalf;
+	
+	result->x = q->x*sign*scale;
+	result->y = q->y*sign*scale;
+	result->z = q->z*sign*scale;
+}
+
+//=============================================================================
+//      CC3Quaternion_FromRotationVector : Rotation of |v| radians about v.
+//-----------------------------------------------------------------------------
+static void
+CC3Quaternion_FromRotationVector(const TQ3Vector3D *v, TQ3Quaternion *result)
+{
+	float angle		= (float) sqrt(v->x*v->x + v->y*v->y + v->z*v->z);
+	float scale		= 0.5f;//limit of sin(angle/2)/angle for small angles
+	
+	if (angle > 1.0e-6f)
+		scale = (float) sin(0.5f*angle) / angle;
+	
+	result->w = (float) cos(0.5f*angle);
+	result->x = v->x*scale;
+	result->y = v->y*scale;
+	result->z = v->z*scale;
+}
+
+//=============================================================================
+//      CC3OneEuro_Alpha : Smoothing factor of a first order low pass.
+//-----------------------------------------------------------------------------
+//		Note : See Casiez et al., "1 Euro Filter", CHI 2012.
+//-----------------------------------------------------------------------------
+static float
+CC3OneEuro_Alpha(float cutoff, float dt)
+{
+	float tau = 1.0f / (2.0f * (float) kQ3Pi * cutoff);
+	return(1.0f / (1.0f + tau/dt));
+}
+
+
 #pragma mark -
 
-TQ3Status
-IPCControllerDriver_SetChannel(CFDictionaryRef dict, CFMutableDictionaryRef returnDict)
+/*
+IPCControllerDriver_CallSetChannel:
+- calls theSetChannelMethod with the channel data of dict
+- shared by the requests forwarded by the server and the direct ones of clients
+*/
+static TQ3Status
+IPCControllerDriver_CallSetChannel(TQ3ChannelSetMethod theSetChannelMethod, TQ3ControllerRef controllerRef, CFDictionaryRef dict, CFMutableDictionaryRef returnDict)
 {
 	TQ3Status			status = kQ3Failure;	//resulting status after calling driver method
 	Boolean 			result;
 	
-	TQ3ControllerRef 	controllerRef;
-	TQ3ChannelSetMethod theSetChannelMethod;
 	TQ3Uns32            channel, dataSize;
 	void 				*data;
+	CFDataRef			dataRef;
+	TC3IPCSharedData	shared;
 	
-	//method
-	result = IPCGetBytes(dict, CFSTR(k3MethodRef), sizeof(TQ3ChannelSetMethod), &theSetChannelMethod);
-		
-	//controllerRef
-	result = IPCGetControllerRef(dict, CFSTR(k3CtrlRef), &controllerRef);
+	if (theSetChannelMethod==NULL)
+		return status;
 		
 	//channel
 	result = IPCGetTQ3Uns32(dict, CFSTR(k3Channel), &channel);
@@ -279,8 +507,23 @@ IPCControllerDriver_SetChannel(CFDictionaryRef dict, CFMutableDictionaryRef retu
 	//dataSize
 	result = IPCGetTQ3Uns32(dict, CFSTR(k3DataSize), &dataSize);
 		
-	//data
-	data = (void*)CFDataGetBytePtr((CFDataRef)CFDictionaryGetValue(dict, CFSTR(k3Data)));
+	//data: large data is set straight from the caller's shared memory
+	if (IPCSharedData_InDict(dict))
+	{
+		if (IPCSharedData_Open(dict, &shared)==kQ3Failure)
+			return status;
+		
+		if (dataSize<=shared.size)
+			status = theSetChannelMethod(controllerRef, channel, shared.bytes, dataSize);
+		
+		IPCSharedData_Close(&shared);
+		return status;
+	}
+	
+	dataRef = (CFDataRef)CFDictionaryGetValue(dict, CFSTR(k3Data));
+	if ((dataRef==NULL) || (dataSize>(TQ3Uns32)CFDataGetLength(dataRef)))
+		return status;
+	data = (void*)CFDataGetBytePtr(dataRef);
 	
 	//do call
 	status = theSetChannelMethod(controllerRef, channel, data, dataSize);
@@ -288,22 +531,22 @@ IPCControllerDriver_SetChannel(CFDictionaryRef dict, CFMutableDictionaryRef retu
 	return status;
 }
 
-TQ3Status
-IPCControllerDriver_GetChannel(CFDictionaryRef dict, CFMutableDictionaryRef returnDict)
+/*
+IPCControllerDriver_CallGetChannel:
+- calls theGetChannelMethod for the channel of dict, puts the data into returnDict
+*/
+static TQ3Status
+IPCControllerDriver_CallGetChannel(TQ3ChannelGetMethod theGetChannelMethod, TQ3ControllerRef controllerRef, CFDictionaryRef dict, CFMutableDictionaryRef returnDict)
 {
 	TQ3Status			status = kQ3Failure;	//resulting status after calling tracker method
 	Boolean 			result;
 	
-	TQ3ControllerRef 	controllerRef;
-	TQ3ChannelGetMethod theGetChannelMethod;
-	TQ3Uns32            channel, dataSize;
+	TQ3Uns32            channel, dataSize, capacity;
 	void 				*data;
+	TC3IPCSharedData	shared;
 	
-	//method
-	result = IPCGetBytes(dict, CFSTR(k3MethodRef), sizeof(TQ3ChannelGetMethod), &theGetChannelMethod);
-		
-	//controllerRef
-	result = IPCGetControllerRef(dict, CFSTR(k3CtrlRef), &controllerRef);
+	if (theGetChannelMethod==NULL)
+		return status;
 		
 	//channel
 	result = IPCGetTQ3Uns32(dict, CFSTR(k3Channel), &channel);
@@ -311,151 +554,616 @@ IPCControllerDriver_GetChannel(CFDictionaryRef dict, CFMutableDictionaryRef retu
 	//dataSize
 	result = IPCGetTQ3Uns32(dict, CFSTR(k3DataSize), &dataSize);
 	
-	//data
-	//to do: sanity check for dataSize
-	data = malloc(dataSize);
+	//data: large data is read straight into the caller's shared memory
+	if (IPCSharedData_InDict(dict))
+	{
+		if (IPCSharedData_Open(dict, &shared)==kQ3Failure)
+			return status;
+		
+		if (dataSize>shared.size)
+			dataSize = shared.size;
+		
+		//do call
+		status = theGetChannelMethod(controllerRef, channel, shared.bytes, &dataSize);
+		if (dataSize>shared.size)
+			status = kQ3Failure;
+		IPCSharedData_Close(&shared);
+		
+		//return:
+		//dataSize
+		if (status==kQ3Success)
+			result = IPCPutTQ3Uns32(returnDict, CFSTR(k3DataSize), &dataSize);
+		return status;
+	}
+	
+	//inline data never exceeds kIPCSharedDataThreshold, whatever the caller asks for
+	if (dataSize>kIPCSharedDataThreshold)
+		dataSize = kIPCSharedDataThreshold;
+	capacity = dataSize;
+	data = malloc((capacity>0) ? capacity : 1);
+	if (data==NULL)
+		return status;
 	
 	//do call
 	status = theGetChannelMethod(controllerRef, channel, data, &dataSize);
+	if (dataSize>capacity)
+		status = kQ3Failure;
 	
 	//return:
-	//data
-	IPCPutBytes(returnDict, CFSTR(k3Data), dataSize, data);
+	if (status==kQ3Success)
+	{
+		//data
+		IPCPutBytes(returnDict, CFSTR(k3Data), dataSize, data);
+		
+		//dataSize
+		result = IPCPutTQ3Uns32(returnDict, CFSTR(k3DataSize), &dataSize);
+	}
 	free(data);
-	
-	//dataSize
-	result = IPCPutTQ3Uns32(returnDict, CFSTR(k3DataSize), &dataSize);
 		
 	return status;
 }
 
 TQ3Status
-IPCControllerDriver_StateSaveAndReset(CFDictionaryRef dict, CFMutableDictionaryRef returnDict)
+IPCControllerDriver_SetChannel(CFDictionaryRef dict, CFMutableDictionaryRef returnDict)
 {
-	TQ3Status			status = kQ3Failure;	//resulting status after calling driver method
 	Boolean 			result;
 	
 	TQ3ControllerRef 	controllerRef;
 	TQ3ChannelSetMethod theSetChannelMethod = NULL;
-	TQ3ChannelGetMethod theGetChannelMethod = NULL;
 	
-	TQ3Uns32            channel, channelCount, dataSize;
-	UInt8				channelData[kQ3ControllerSetChannelMaxDataSize];
+	//method
+	result = IPCGetBytes(dict, CFSTR(k3MethodRef), sizeof(TQ3ChannelSetMethod), &theSetChannelMethod);
+		
+	//controllerRef
+	result = IPCGetControllerRef(dict, CFSTR(k3CtrlRef), &controllerRef);
 	
-	//Set method
-	result = IPCGetBytes(dict, CFSTR(k3SetMethodRef), sizeof(TQ3ChannelSetMethod), &theSetChannelMethod);
+	return IPCControllerDriver_CallSetChannel(theSetChannelMethod, controllerRef, dict, returnDict);
+}
+
+TQ3Status
+IPCControllerDriver_GetChannel(CFDictionaryRef dict, CFMutableDictionaryRef returnDict)
+{
+	Boolean 			result;
 	
-	//Get method
-	result = IPCGetBytes(dict, CFSTR(k3GetMethodRef), sizeof(TQ3ChannelGetMethod), &theGetChannelMethod);
+	TQ3ControllerRef 	controllerRef;
+	TQ3ChannelGetMethod theGetChannelMethod = NULL;
+	
+	//method
+	result = IPCGetBytes(dict, CFSTR(k3MethodRef), sizeof(TQ3ChannelGetMethod), &theGetChannelMethod);
 		
 	//controllerRef
 	result = IPCGetControllerRef(dict, CFSTR(k3CtrlRef), &controllerRef);
 	
-	//channelCount
-	result = IPCGetTQ3Uns32(dict, CFSTR(k3ChannelCount), &channelCount);		
+	return IPCControllerDriver_CallGetChannel(theGetChannelMethod, controllerRef, dict, returnDict);
+}
+
+/*
+IPCControllerDriver_Notify:
+- sends dict to the device server without waiting for a reply
+*/
+static void
+IPCControllerDriver_Notify(SInt32 msgid, CFMutableDictionaryRef dict)
+{
+	CFDataRef	data = CFPropertyListCreateXMLData(kCFAllocatorDefault,dict);
 	
-	//-Create Array
-	CFMutableArrayRef channelArrayRef = CFArrayCreateMutable(kCFAllocatorDefault, channelCount, &kCFTypeArrayCallBacks);
-		
-	for (channel=0; channel<channelCount; channel++)
+	if (DeviceServerPort==NULL)
+		DeviceServerPort=CFMessagePortCreateRemote(kCFAllocatorDefault, CFSTR(kQuesa3DeviceServer));
+	
+	if ((data!=NULL) && (DeviceServerPort!=NULL))
+		CFMessagePortSendRequest(DeviceServerPort, msgid, data, 10, 0, NULL, NULL);
+	
+	if (data)
+		CFRelease(data);
+}
+
+/*
+IPCControllerDriver_DirectChannel:
+- channel call sent by a client straight to the driver
+- k3DriverHandle and k3CapToken select the controller; methods and controllerRef
+  are the driver's own, nothing of them is taken from the request
+- the server learns about a set channel afterwards, for its channel shadow
+*/
+TQ3Status
+IPCControllerDriver_DirectChannel(SInt32 msgid, CFDictionaryRef dict, CFMutableDictionaryRef returnDict)
+{
+	TQ3Status					status = kQ3Failure;
+	TQ3Uns32					driverHandle = kIPCHandleNone, token = 0;
+	TQ3Boolean					capValid = kQ3True;
+	TC3DriverChannelsDataPtr	theChannels;
+	CFMutableDictionaryRef		notifyDict;
+	
+	IPCGetTQ3Uns32(dict, CFSTR(k3DriverHandle), &driverHandle);
+	IPCGetTQ3Uns32(dict, CFSTR(k3CapToken), &token);
+	
+	theChannels = (TC3DriverChannelsDataPtr)IPCHandle_Lookup(&DriverChannels, driverHandle);
+	if ((theChannels==NULL) || (token==0) || (theChannels->token!=token))
+		return status;
+	IPCPutTQ3Boolean(returnDict, CFSTR(k3CapValid), &capValid);
+	
+	if (msgid==m3ControllerDriver_DirectGetChannel)
+		return IPCControllerDriver_CallGetChannel(theChannels->channelGetMethod, theChannels->controllerRef, dict, returnDict);
+	
+	status = IPCControllerDriver_CallSetChannel(theChannels->channelSetMethod, theChannels->controllerRef, dict, returnDict);
+	if (status==kQ3Success)
 	{
-		dataSize = kQ3ControllerSetChannelMaxDataSize;
-		if (theGetChannelMethod!=NULL)
+		notifyDict = CFDictionaryCreateMutable(	kCFAllocatorDefault,0,
+												&kCFTypeDictionaryKeyCallBacks,
+												&kCFTypeDictionaryValueCallBacks);
+		if (notifyDict)
 		{
-			//--get channel data
-			status = theGetChannelMethod(controllerRef, channel, channelData, &dataSize);
-			
-			//--create array element
-			CFDataRef ChannelDataRef = CFDataCreate(kCFAllocatorDefault, (UInt8*)channelData, dataSize);
-			
-			//--store array element in array
-			CFArrayAppendValue(channelArrayRef, ChannelDataRef);
-			CFRelease(ChannelDataRef);
-		}
+			IPCPutControllerRef(notifyDict, CFSTR(k3CtrlRef), &theChannels->controllerRef);
+			if (CFDictionaryGetValue(dict, CFSTR(k3Channel))!=NULL)
+				CFDictionarySetValue(notifyDict, CFSTR(k3Channel), CFDictionaryGetValue(dict, CFSTR(k3Channel)));
+			if (CFDictionaryGetValue(dict, CFSTR(k3Data))!=NULL)
+				CFDictionarySetValue(notifyDict, CFSTR(k3Data), CFDictionaryGetValue(dict, CFSTR(k3Data)));
+			if (CFDictionaryGetValue(dict, CFSTR(k3DataSize))!=NULL)
+				CFDictionarySetValue(notifyDict, CFSTR(k3DataSize), CFDictionaryGetValue(dict, CFSTR(k3DataSize)));
 			
-		if (theSetChannelMethod!=NULL)
-		{ 
-			//--set channel data to NULL
-			dataSize=0;
-			status = theSetChannelMethod(controllerRef, channel, NULL, dataSize);
+			IPCControllerDriver_Notify(m3Controller_ChannelChanged, notifyDict);
+			CFRelease(notifyDict);
 		}
 	}
+	return status;
+}
+
+/*
+IPCControllerDriver_GetMethods:
+- channel methods of a controller, for a device server that restarted; the server
+  does not keep them across runs
+- k3DriverHandle and k3CapToken select the controller, as for direct calls
+*/
+TQ3Status
+IPCControllerDriver_GetMethods(CFDictionaryRef dict, CFMutableDictionaryRef returnDict)
+{
+	TQ3Uns32					driverHandle = kIPCHandleNone, token = 0;
+	TC3DriverChannelsDataPtr	theChannels;
 	
-	//return Array
-	CFDictionarySetValue(returnDict, CFSTR(k3ChannelsData), channelArrayRef);
+	IPCGetTQ3Uns32(dict, CFSTR(k3DriverHandle), &driverHandle);
+	IPCGetTQ3Uns32(dict, CFSTR(k3CapToken), &token);
 	
-	//-clean up
-	if (channelArrayRef)
-		CFRelease(channelArrayRef);
+	theChannels = (TC3DriverChannelsDataPtr)IPCHandle_Lookup(&DriverChannels, driverHandle);
+	if ((theChannels==NULL) || (token==0) || (theChannels->token!=token))
+		return(kQ3Failure);
 	
-	return status;
+	IPCPutBytes(returnDict, CFSTR(k3GetMethodRef), sizeof(TQ3ChannelGetMethod), &theChannels->channelGetMethod);
+	IPCPutBytes(returnDict, CFSTR(k3SetMethodRef), sizeof(TQ3ChannelSetMethod), &theChannels->channelSetMethod);
+	return(kQ3Success);
 }
 
+/*
+IPCControllerDriver_SetChannels:
+- calls the channelSetMethod once per entry of k3Channels
+- each entry of the returned k3Channels carries the status of its call
+*/
 TQ3Status
-IPCControllerDriver_StateRestore(CFDictionaryRef dict, CFMutableDictionaryRef returnDict)
+IPCControllerDriver_SetChannels(CFDictionaryRef dict, CFMutableDictionaryRef returnDict)
 {
 	TQ3Status			status = kQ3Failure;	//resulting status after calling driver method
 	Boolean 			result;
 	
 	TQ3ControllerRef 	controllerRef;
 	TQ3ChannelSetMethod theSetChannelMethod = NULL;
+	CFArrayRef			requests;
+	CFMutableArrayRef	replies;
+	CFIndex				index, count;
 	
-	TQ3Uns32            channel, channelCount, dataSize;
-	void				*channelData;
-	CFDataRef			channelDataRef;
-	CFArrayRef			channelArrayRef;
-	
-	//Set method
-	result = IPCGetBytes(dict, CFSTR(k3SetMethodRef), sizeof(TQ3ChannelSetMethod), &theSetChannelMethod);
-	
+	//method
+	result = IPCGetBytes(dict, CFSTR(k3MethodRef), sizeof(TQ3ChannelSetMethod), &theSetChannelMethod);
+		
 	//controllerRef
 	result = IPCGetControllerRef(dict, CFSTR(k3CtrlRef), &controllerRef);
 	
-	//channelCount
-	result = IPCGetTQ3Uns32(dict, CFSTR(k3ChannelCount), &channelCount);
+	//channels
+	requests = (CFArrayRef)CFDictionaryGetValue(dict, CFSTR(k3Channels));
+	if ((theSetChannelMethod==NULL) || (requests==NULL))
+		return status;
 	
-	//Array
-	channelArrayRef = (CFArrayRef)CFDictionaryGetValue(dict, CFSTR(k3ChannelsData));
+	count = CFArrayGetCount(requests);
+	replies = CFArrayCreateMutable(kCFAllocatorDefault, count, &kCFTypeArrayCallBacks);
+	if (replies==NULL)
+		return status;
 	
-	//Do what to do:
-	for (channel=0; channel<channelCount; channel++)
+	for (index=0; index<count; index++)
 	{
-		status = kQ3Failure;
-		//-for each channel
-		if (theSetChannelMethod!=NULL)
-		{ 
-			//--set channel data from array
-			channelDataRef = (CFDataRef)CFArrayGetValueAtIndex(channelArrayRef, channel);
-			dataSize = CFDataGetLength(channelDataRef);
-			channelData = (void*)CFDataGetBytePtr(channelDataRef);
-			
-			status = theSetChannelMethod(controllerRef, channel, channelData, dataSize);
-		}
+		CFDictionaryRef			request = (CFDictionaryRef)CFArrayGetValueAtIndex(requests, index);
+		CFMutableDictionaryRef	reply;
+		CFDataRef				dataRef;
+		TQ3Uns32				channel = 0, dataSize = 0;
+		TQ3Status				channelStatus;
+		
+		reply = CFDictionaryCreateMutable(	kCFAllocatorDefault,0,
+											&kCFTypeDictionaryKeyCallBacks,
+											&kCFTypeDictionaryValueCallBacks);
+		if (reply==NULL)
+			break;
+		
+		result = IPCGetTQ3Uns32(request, CFSTR(k3Channel), &channel);
+		result = IPCGetTQ3Uns32(request, CFSTR(k3DataSize), &dataSize);
+		dataRef = (CFDataRef)CFDictionaryGetValue(request, CFSTR(k3Data));
+		if ((dataRef!=NULL) && (dataSize>(TQ3Uns32)CFDataGetLength(dataRef)))
+			dataSize = (TQ3Uns32)CFDataGetLength(dataRef);
+		
+		//do call
+		channelStatus = theSetChannelMethod(controllerRef, channel, (dataRef!=NULL) ? (void*)CFDataGetBytePtr(dataRef) : NULL, dataSize);
+		
+		IPCPutTQ3Uns32(reply, CFSTR(k3Channel), &channel);
+		IPCPutTQ3Uns32(reply, CFSTR(k3Status), (TQ3Uns32*)&channelStatus);
+		CFArrayAppendValue(replies, reply);
+		CFRelease(reply);
 	}
-
+	
+	CFDictionarySetValue(returnDict, CFSTR(k3Channels), replies);
+	CFRelease(replies);
+	
+	status = kQ3Success;
 	return status;
 }
 
-
 /*
-IPCControllerDriver_Dispatcher will be called by CFMessagePort on incoming message 
+IPCControllerDriver_GetChannels:
+- calls the channelGetMethod once per entry of k3Channels
+- the capacity asked for is bounded by kQ3ControllerSetChannelMaxDataSize
 */
-CFDataRef IPCControllerDriver_Dispatcher ( CFMessagePortRef local, SInt32 msgid, CFDataRef data, void *info)
+TQ3Status
+IPCControllerDriver_GetChannels(CFDictionaryRef dict, CFMutableDictionaryRef returnDict)
 {
-	TQ3Status 				status;
+	TQ3Status			status = kQ3Failure;	//resulting status after calling driver method
+	Boolean 			result;
+	
+	TQ3ControllerRef 	controllerRef;
+	TQ3ChannelGetMethod theGetChannelMethod = NULL;
+	CFArrayRef			requests;
+	CFMutableArrayRef	replies;
+	CFIndex				index, count;
+	UInt8				channelData[kQ3ControllerSetChannelMaxDataSize];
+	
+	//method
+	result = IPCGetBytes(dict, CFSTR(k3MethodRef), sizeof(TQ3ChannelGetMethod), &theGetChannelMethod);
 		
-	CFDictionaryRef			dict;
-	CFMutableDictionaryRef	returnDict;
+	//controllerRef
+	result = IPCGetControllerRef(dict, CFSTR(k3CtrlRef), &controllerRef);
 	
-	CFStringRef				propertyListError;
-	CFDataRef 				returnData;
-	Boolean					result;
+	//channels
+	requests = (CFArrayRef)CFDictionaryGetValue(dict, CFSTR(k3Channels));
+	if ((theGetChannelMethod==NULL) || (requests==NULL))
+		return status;
 	
-	dict=(CFDictionaryRef)CFPropertyListCreateFromXMLData(	kCFAllocatorDefault, 
-															data, 
-															kCFPropertyListImmutable, 
-															&propertyListError);
-	if (propertyListError)
+	count = CFArrayGetCount(requests);
+	replies = CFArrayCreateMutable(kCFAllocatorDefault, count, &kCFTypeArrayCallBacks);
+	if (replies==NULL)
+		return status;
+	
+	for (index=0; index<count; index++)
+	{
+		CFDictionaryRef			request = (CFDictionaryRef)CFArrayGetValueAtIndex(requests, index);
+		CFMutableDictionaryRef	reply;
+		TQ3Uns32				channel = 0, dataSize = 0;
+		TQ3Status				channelStatus;
+		
+		reply = CFDictionaryCreateMutable(	kCFAllocatorDefault,0,
+											&kCFTypeDictionaryKeyCallBacks,
+											&kCFTypeDictionaryValueCallBacks);
+		if (reply==NULL)
+			break;
+		
+		result = IPCGetTQ3Uns32(request, CFSTR(k3Channel), &channel);
+		result = IPCGetTQ3Uns32(request, CFSTR(k3DataSize), &dataSize);
+		if (dataSize>kQ3ControllerSetChannelMaxDataSize)
+			dataSize = kQ3ControllerSetChannelMaxDataSize;
+		
+		//do call
+		channelStatus = theGetChannelMethod(controllerRef, channel, channelData, &dataSize);
+		if (dataSize>kQ3ControllerSetChannelMaxDataSize)
+			channelStatus = kQ3Failure;
+		
+		IPCPutTQ3Uns32(reply, CFSTR(k3Channel), &channel);
+		if (channelStatus==kQ3Success)
+		{
+			IPCPutBytes(reply, CFSTR(k3Data), dataSize, channelData);
+			IPCPutTQ3Uns32(reply, CFSTR(k3DataSize), &dataSize);
+		}
+		IPCPutTQ3Uns32(reply, CFSTR(k3Status), (TQ3Uns32*)&channelStatus);
+		CFArrayAppendValue(replies, reply);
+		CFRelease(reply);
+	}
+	
+	CFDictionarySetValue(returnDict, CFSTR(k3Channels), replies);
+	CFRelease(replies);
+	
+	status = kQ3Success;
+	return status;
+}
+
+/*
+IPCControllerDriver_StateSaveAndReset:
+- reads the channels of k3ChannelMask, then resets those of k3ResetMask
+- a channel with an entry in k3Channels is read into its slot of the caller's shared
+  memory (k3DataOffset, k3DataSize), any other inline up to kIPCSharedDataThreshold
+- k3ChannelMask of the reply holds the channels read, k3ResetMask those reset; a channel
+  that couldn't be read carries no data and is not reset
+*/
+TQ3Status
+IPCControllerDriver_StateSaveAndReset(CFDictionaryRef dict, CFMutableDictionaryRef returnDict)
+{
+	TQ3Status			status = kQ3Failure;	//resulting status after calling driver method
+	Boolean 			result;
+	
+	TQ3ControllerRef 	controllerRef;
+	TQ3ChannelSetMethod theSetChannelMethod = NULL;
+	TQ3ChannelGetMethod theGetChannelMethod = NULL;
+	
+	TQ3Uns32            channel, channelCount, dataSize, capacity;
+	TQ3Uns32			getMask = 0xFFFFFFFF, resetMask = 0xFFFFFFFF, readMask = 0, doneMask = 0;
+	TQ3Uns32			slotOffset[kQ3MaxControllerChannels], slotSize[kQ3MaxControllerChannels];
+	UInt8				*channelData, *inlineData;
+	CFArrayRef			slots;
+	CFMutableArrayRef	channelArrayRef, sharedArrayRef;
+	CFIndex				index;
+	TC3IPCSharedData	shared = {"", NULL, 0, kQ3False};
+	
+	//Set method
+	result = IPCGetBytes(dict, CFSTR(k3SetMethodRef), sizeof(TQ3ChannelSetMethod), &theSetChannelMethod);
+	
+	//Get method
+	result = IPCGetBytes(dict, CFSTR(k3GetMethodRef), sizeof(TQ3ChannelGetMethod), &theGetChannelMethod);
+		
+	//controllerRef
+	result = IPCGetControllerRef(dict, CFSTR(k3CtrlRef), &controllerRef);
+	
+	//channelCount
+	result = IPCGetTQ3Uns32(dict, CFSTR(k3ChannelCount), &channelCount);		
+	if (channelCount>kQ3MaxControllerChannels)
+		channelCount = kQ3MaxControllerChannels;
+	
+	//channels the server's shadow doesn't know / hasn't reset yet; absent: all
+	if (CFDictionaryGetValue(dict, CFSTR(k3ChannelMask))!=NULL)
+		result = IPCGetTQ3Uns32(dict, CFSTR(k3ChannelMask), &getMask);
+	if (CFDictionaryGetValue(dict, CFSTR(k3ResetMask))!=NULL)
+		result = IPCGetTQ3Uns32(dict, CFSTR(k3ResetMask), &resetMask);
+	
+	//slots of the large channels; a slot outside the segment is ignored
+	memset(slotSize, 0, sizeof(slotSize));
+	slots = (CFArrayRef)CFDictionaryGetValue(dict, CFSTR(k3Channels));
+	if ((slots!=NULL) && (IPCSharedData_InDict(dict)) && (IPCSharedData_Open(dict, &shared)==kQ3Success))
+		for (index=0; index<CFArrayGetCount(slots); index++)
+		{
+			CFDictionaryRef	slot = (CFDictionaryRef)CFArrayGetValueAtIndex(slots, index);
+			TQ3Uns32		offset = 0, size = 0;
+			
+			result = IPCGetTQ3Uns32(slot, CFSTR(k3Channel), &channel);
+			result = IPCGetTQ3Uns32(slot, CFSTR(k3DataOffset), &offset);
+			result = IPCGetTQ3Uns32(slot, CFSTR(k3DataSize), &size);
+			if ((channel<channelCount) && (size<=shared.size) && (offset<=shared.size-size))
+			{
+				slotOffset[channel] = offset;
+				slotSize[channel] = size;
+			}
+		}
+	
+	inlineData = (UInt8*)malloc(kIPCSharedDataThreshold);
+	channelArrayRef = CFArrayCreateMutable(kCFAllocatorDefault, channelCount, &kCFTypeArrayCallBacks);
+	sharedArrayRef = CFArrayCreateMutable(kCFAllocatorDefault, 0, &kCFTypeArrayCallBacks);
+	if ((inlineData==NULL) || (channelArrayRef==NULL) || (sharedArrayRef==NULL))
+	{
+		if (inlineData)
+			free(inlineData);
+		if (channelArrayRef)
+			CFRelease(channelArrayRef);
+		if (sharedArrayRef)
+			CFRelease(sharedArrayRef);
+		IPCSharedData_Close(&shared);
+		return status;
+	}
+	
+	for (channel=0; channel<channelCount; channel++)
+	{
+		if (theGetChannelMethod!=NULL)
+		{
+			//--get channel data; channels outside getMask keep their place with no data
+			dataSize = 0;
+			if (getMask & (1UL<<channel))
+			{
+				if (slotSize[channel]>0)
+				{
+					channelData = (UInt8*)shared.bytes+slotOffset[channel];
+					capacity = slotSize[channel];
+				}
+				else
+				{
+					channelData = inlineData;
+					capacity = kIPCSharedDataThreshold;
+				}
+				dataSize = capacity;
+				
+				//a failed or truncated get is no data
+				if ((theGetChannelMethod(controllerRef, channel, channelData, &dataSize)==kQ3Success) && (dataSize<=capacity))
+					readMask |= (1UL<<channel);
+				else
+					dataSize = 0;
+				
+				//data in shared memory stays there, the server copies it out
+				if ((slotSize[channel]>0) && (readMask & (1UL<<channel)))
+				{
+					CFMutableDictionaryRef slot = CFDictionaryCreateMutable(	kCFAllocatorDefault,0,
+																				&kCFTypeDictionaryKeyCallBacks,
+																				&kCFTypeDictionaryValueCallBacks);
+					if (slot!=NULL)
+					{
+						IPCPutTQ3Uns32(slot, CFSTR(k3Channel), &channel);
+						IPCPutTQ3Uns32(slot, CFSTR(k3DataOffset), &slotOffset[channel]);
+						IPCPutTQ3Uns32(slot, CFSTR(k3DataSize), &dataSize);
+						CFArrayAppendValue(sharedArrayRef, slot);
+						CFRelease(slot);
+					}
+					else
+						readMask &= ~(1UL<<channel);
+					dataSize = 0;
+				}
+			}
+			
+			//--create array element
+			CFDataRef ChannelDataRef = CFDataCreate(kCFAllocatorDefault, inlineData, dataSize);
+			
+			//--store array element in array
+			CFArrayAppendValue(channelArrayRef, ChannelDataRef);
+			CFRelease(ChannelDataRef);
+		}
+		
+		//--a channel that couldn't be saved keeps its data
+		if ((theSetChannelMethod!=NULL) && (resetMask & (1UL<<channel))
+		 && ((!(getMask & (1UL<<channel))) || (readMask & (1UL<<channel))))
+		{ 
+			//--set channel data to NULL
+			dataSize=0;
+			if (theSetChannelMethod(controllerRef, channel, NULL, dataSize)==kQ3Success)
+				doneMask |= (1UL<<channel);
+		}
+	}
+	
+	//return Array and what was done
+	CFDictionarySetValue(returnDict, CFSTR(k3ChannelsData), channelArrayRef);
+	if (CFArrayGetCount(sharedArrayRef)>0)
+		CFDictionarySetValue(returnDict, CFSTR(k3Channels), sharedArrayRef);
+	IPCPutTQ3Uns32(returnDict, CFSTR(k3ChannelMask), &readMask);
+	IPCPutTQ3Uns32(returnDict, CFSTR(k3ResetMask), &doneMask);
+	status = kQ3Success;
+	
+	//-clean up
+	free(inlineData);
+	CFRelease(channelArrayRef);
+	CFRelease(sharedArrayRef);
+	IPCSharedData_Close(&shared);
+	
+	return status;
+}
+
+TQ3Status
+IPCControllerDriver_StateRestore(CFDictionaryRef dict, CFMutableDictionaryRef returnDict)
+{
+	TQ3Status			status = kQ3Failure;	//resulting status after calling driver method
+	Boolean 			result;
+	
+	TQ3ControllerRef 	controllerRef;
+	TQ3ChannelSetMethod theSetChannelMethod = NULL;
+	
+	TQ3Uns32            channel, channelCount, dataSize;
+	TQ3Uns32			setMask = 0xFFFFFFFF;
+	void				*channelData;
+	CFDataRef			channelDataRef;
+	CFArrayRef			channelArrayRef;
+	
+	//Set method
+	result = IPCGetBytes(dict, CFSTR(k3SetMethodRef), sizeof(TQ3ChannelSetMethod), &theSetChannelMethod);
+	
+	//controllerRef
+	result = IPCGetControllerRef(dict, CFSTR(k3CtrlRef), &controllerRef);
+	
+	//channelCount
+	result = IPCGetTQ3Uns32(dict, CFSTR(k3ChannelCount), &channelCount);
+	
+	//channels that differ from the live state; absent: all
+	if (CFDictionaryGetValue(dict, CFSTR(k3ChannelMask))!=NULL)
+		result = IPCGetTQ3Uns32(dict, CFSTR(k3ChannelMask), &setMask);
+	
+	//Array
+	channelArrayRef = (CFArrayRef)CFDictionaryGetValue(dict, CFSTR(k3ChannelsData));
+	if (channelArrayRef==NULL)
+		return status;
+	if (channelCount>(TQ3Uns32)CFArrayGetCount(channelArrayRef))
+		channelCount = (TQ3Uns32)CFArrayGetCount(channelArrayRef);
+	
+	//Do what to do:
+	for (channel=0; channel<channelCount; channel++)
+	{
+		if (!(setMask & (1UL<<channel)))
+			continue;
+		
+		status = kQ3Failure;
+		//-for each channel
+		if (theSetChannelMethod!=NULL)
+		{ 
+			//--set channel data from array; no data restores the reset state
+			channelDataRef = (CFDataRef)CFArrayGetValueAtIndex(channelArrayRef, channel);
+			dataSize = CFDataGetLength(channelDataRef);
+			channelData = (dataSize>0) ? (void*)CFDataGetBytePtr(channelDataRef) : NULL;
+			
+			status = theSetChannelMethod(controllerRef, channel, channelData, dataSize);
+		}
+	}
+
+	return status;
+}
+
+/*
+IPCControllerDriver_StateBatch:
+- runs the save and reset, or restore, of every state of a batch
+- each state's return dictionary carries its own status
+*/
+TQ3Status
+IPCControllerDriver_StateBatch(SInt32 msgid, CFDictionaryRef dict, CFMutableDictionaryRef returnDict)
+{
+	TQ3Status				status = kQ3Failure;
+	CFArrayRef				requests;
+	CFMutableArrayRef		replies;
+	CFIndex					index;
+	
+	requests = (CFArrayRef)CFDictionaryGetValue(dict, CFSTR(k3CtrlStates));
+	if (requests==NULL)
+		return status;
+	
+	replies = CFArrayCreateMutable(kCFAllocatorDefault, CFArrayGetCount(requests), &kCFTypeArrayCallBacks);
+	if (replies==NULL)
+		return status;
+	
+	for (index=0; index<CFArrayGetCount(requests); index++)
+	{
+		CFDictionaryRef			request = (CFDictionaryRef)CFArrayGetValueAtIndex(requests, index);
+		CFMutableDictionaryRef	reply;
+		TQ3Status				stateStatus;
+		
+		reply = CFDictionaryCreateMutable(	kCFAllocatorDefault,0,
+											&kCFTypeDictionaryKeyCallBacks,
+											&kCFTypeDictionaryValueCallBacks);
+		if (reply==NULL)
+			break;
+		
+		if (msgid==m3ControllerDriver_StateRestoreBatch)
+			stateStatus = IPCControllerDriver_StateRestore(request, reply);
+		else
+			stateStatus = IPCControllerDriver_StateSaveAndReset(request, reply);
+		
+		IPCPutTQ3Uns32(reply, CFSTR(k3Status), (TQ3Uns32*)&stateStatus);
+		CFArrayAppendValue(replies, reply);
+		CFRelease(reply);
+	}
+	
+	CFDictionarySetValue(returnDict, CFSTR(k3CtrlStates), replies);
+	CFRelease(replies);
+	
+	status = kQ3Success;
+	return status;
+}
+
+
+/*
+IPCControllerDriver_Dispatcher will be called by CFMessagePort on incoming message 
+*/
+CFDataRef IPCControllerDriver_Dispatcher ( CFMessagePortRef local, SInt32 msgid, CFDataRef data, void *info)
+{
+	TQ3Status 				status;
+		
+	CFDictionaryRef			dict;
+	CFMutableDictionaryRef	returnDict;
+	
+	CFStringRef				propertyListError;
+	CFDataRef 				returnData;
+	Boolean					result;
+	
+	dict=(CFDictionaryRef)CFPropertyListCreateFromXMLData(	kCFAllocatorDefault, 
+															data, 
+															kCFPropertyListImmutable, 
+															&propertyListError);
+	if (propertyListError)
 	{
 		//Do error handling
 		
@@ -479,24 +1187,48 @@ CFDataRef IPCControllerDriver_Dispatcher ( CFMessagePortRef local, SInt32 msgid,
 			case m3ControllerDriver_GetChannel:
 				status = IPCControllerDriver_GetChannel(dict, returnDict);
 				break;
+			case m3ControllerDriver_DirectSetChannel:
+			case m3ControllerDriver_DirectGetChannel:
+				status = IPCControllerDriver_DirectChannel(msgid, dict, returnDict);
+				break;
+			case m3ControllerDriver_GetMethods:
+				status = IPCControllerDriver_GetMethods(dict, returnDict);
+				break;
+			case m3ControllerDriver_SetChannels:
+				status = IPCControllerDriver_SetChannels(dict, returnDict);
+				break;
+			case m3ControllerDriver_GetChannels:
+				status = IPCControllerDriver_GetChannels(dict, returnDict);
+				break;
 			case m3ControllerDriver_StateSaveAndReset:
 				status = IPCControllerDriver_StateSaveAndReset(dict, returnDict);
 				break;
 			case m3ControllerDriver_StateRestore:
 				status = IPCControllerDriver_StateRestore(dict, returnDict);
 				break;	
+			case m3ControllerDriver_StateSaveAndResetBatch:
+			case m3ControllerDriver_StateRestoreBatch:
+				status = IPCControllerDriver_StateBatch(msgid, dict, returnDict);
+				break;
 			default:
 				break;
 		}
 	}
-	if (dict)
-		CFRelease(dict);
-	
 	//status
 	result = IPCPutTQ3Uns32(returnDict, CFSTR(k3Status), (TQ3Uns32*)&status);
-		
-	//returnDict to CFDataRef
-	returnData= CFPropertyListCreateXMLData(kCFAllocatorDefault,returnDict);
+	
+	if ((dict!=NULL) && (IPCAsync_IsAsyncRequest(dict)))
+	{
+		//asynchronous caller, e.g. a batch of the server: answer via its reply port
+		IPCAsync_SendReply(dict, msgid, returnDict);
+		returnData = NULL;
+	}
+	else
+		//returnDict to CFDataRef
+		returnData= CFPropertyListCreateXMLData(kCFAllocatorDefault,returnDict);
+	
+	if (dict)
+		CFRelease(dict);
 	
 	if (returnDict)
 		CFRelease(returnDict);
@@ -546,6 +1278,62 @@ void IPCControllerDriver_PortCreate(CFMutableDictionaryRef 	dict, const TQ3Contr
 }
 
 
+/*
+IPCControllerDriver_NewChannels:
+- registers the channel methods of a new controller for direct client calls
+- the token is taken from a fresh UUID, so it can not be guessed from the handle
+*/
+static TC3DriverChannelsDataPtr
+IPCControllerDriver_NewChannels(const TQ3ControllerData *controllerData, TQ3Uns32 *driverHandle)
+{
+	TC3DriverChannelsDataPtr	theChannels;
+	CFUUIDRef					tokenUUID;
+	CFUUIDBytes					tokenBytes;
+	
+	theChannels = (TC3DriverChannelsDataPtr)malloc(sizeof(TC3DriverChannelsData));
+	if (theChannels==NULL)
+		return(NULL);
+	
+	theChannels->controllerRef = NULL;
+	theChannels->channelSetMethod = controllerData->channelSetMethod;
+	theChannels->channelGetMethod = controllerData->channelGetMethod;
+	theChannels->token = 0;
+	
+	tokenUUID = CFUUIDCreate(kCFAllocatorDefault);
+	if (tokenUUID!=NULL)
+	{
+		tokenBytes = CFUUIDGetUUIDBytes(tokenUUID);
+		theChannels->token = ((TQ3Uns32)tokenBytes.byte0<<24) | ((TQ3Uns32)tokenBytes.byte1<<16)
+						   | ((TQ3Uns32)tokenBytes.byte2<<8) | (TQ3Uns32)tokenBytes.byte3;
+		CFRelease(tokenUUID);
+	}
+	
+	*driverHandle = IPCHandle_Insert(&DriverChannels, theChannels);
+	if ((theChannels->token==0) || (*driverHandle==kIPCHandleNone))
+	{
+		IPCHandle_Remove(&DriverChannels, *driverHandle);
+		free(theChannels);
+		return(NULL);
+	}
+	return(theChannels);
+}
+
+/*
+IPCControllerDriver_DeleteChannels:
+- revokes the direct channel calls of controllerRef; clients fall back to the server
+*/
+static void
+IPCControllerDriver_DeleteChannels(TQ3ControllerRef controllerRef)
+{
+	TC3DriverChannelsDataPtr	theChannels;
+	TQ3Uns32					driverHandle = kIPCHandleNone;
+	
+	while ((theChannels = (TC3DriverChannelsDataPtr)IPCHandle_Next(&DriverChannels, &driverHandle))!=NULL)
+		if (theChannels->controllerRef==controllerRef)
+			free(IPCHandle_Remove(&DriverChannels, driverHandle));
+}
+
+
 TQ3Status IPCControllerDriver_Send( SInt32 msgid, CFMutableDictionaryRef dict, CFMutableDictionaryRef *returnDict)
 {
 	TQ3Status status = kQ3Failure;
@@ -711,6 +1499,8 @@ CC3OSXController_New(const TQ3ControllerData *controllerData)
 	TQ3Status 				status = kQ3Failure;
 	TQ3ControllerRef 		controllerRef;
 	CFMutableDictionaryRef 	dict,returnDict;
+	TC3DriverChannelsDataPtr theChannels = NULL;
+	TQ3Uns32				driverHandle = kIPCHandleNone;
 	
 	Boolean result;
 	
@@ -722,6 +1512,15 @@ CC3OSXController_New(const TQ3ControllerData *controllerData)
 	{
 		IPCControllerDriver_PortCreate(dict, controllerData);
 		
+		//channel methods for direct client calls, guarded by a token
+		if (CFDictionaryGetValue(dict,CFSTR(k3DriverPortName))!=NULL)
+			theChannels = IPCControllerDriver_NewChannels(controllerData, &driverHandle);
+		if (theChannels!=NULL)
+		{
+			result = IPCPutTQ3Uns32(dict, CFSTR(k3DriverHandle), &driverHandle);
+			result = IPCPutTQ3Uns32(dict, CFSTR(k3CapToken), &theChannels->token);
+		}
+		
 		//Put structure controllerData into dict
 		result = IPCPutBytes(dict, CFSTR(k3CtrlData), sizeof(TQ3ControllerData), controllerData);
 				
@@ -753,6 +1552,14 @@ CC3OSXController_New(const TQ3ControllerData *controllerData)
 	if (status==kQ3Failure)
 		controllerRef=NULL;
 	
+	if (theChannels!=NULL)
+	{
+		if (controllerRef!=NULL)
+			theChannels->controllerRef = controllerRef;
+		else
+			free(IPCHandle_Remove(&DriverChannels, driverHandle));
+	}
+	
 	return controllerRef;
 }
 
@@ -784,6 +1591,9 @@ CC3OSXController_Decommission(TQ3ControllerRef controllerRef)
 		//controllerRef
 		result = IPCPutControllerRef(dict, CFSTR(k3CtrlRef), &controllerRef);
 		
+		//no direct channel calls any more
+		IPCControllerDriver_DeleteChannels(controllerRef);
+		
 		//try sending
 		status = IPCControllerDriver_Send(m3Controller_Decommission,dict,&returnDict);
 		if (status!=kQ3Failure)
@@ -963,22 +1773,58 @@ CC3OSXController_GetSignature(TQ3ControllerRef controllerRef, char *signature, T
 
 
 //=============================================================================
-//      CC3OSXController_SetChannel : One-line description of the method.
+//      CC3OSXController_ForgetDriverEndpoint : Send the channel calls of
+//				controllerRef through the device server again.
 //-----------------------------------------------------------------------------
-//		Only device clients will call CC3OSXController_SetChannel.
-//		parameters will be transfered via IPC to the device driver.
-//		the device server holds only the name of the device driver messageport.
-//		the parameters are then forwarded by the server to the driver's messageport.
-//		the device driver will call its channelSetMethod found in TQ3ControllerData.
+static void
+CC3OSXController_ForgetDriverEndpoint(TQ3ControllerRef controllerRef)
+{
+	TC3DriverEndpointPtr	*link = &DriverEndpoints;
+	TC3DriverEndpointPtr	theEndpoint;
+	
+	while ((theEndpoint = *link)!=NULL)
+	{
+		if (theEndpoint->controllerRef==controllerRef)
+		{
+			*link = theEndpoint->next;
+			if (theEndpoint->driverPort!=NULL)
+				CFRelease(theEndpoint->driverPort);
+			free(theEndpoint);
+			return;
+		}
+		link = &theEndpoint->next;
+	}
+}
+
+
+
+//=============================================================================
+//      CC3OSXController_GetDriverEndpoint : Driver port and capability for
+//				direct channel calls of controllerRef.
 //-----------------------------------------------------------------------------
-TQ3Status
-CC3OSXController_SetChannel(TQ3ControllerRef controllerRef, TQ3Uns32 channel, const void *data, TQ3Uns32 dataSize)
+//		Note : Asks the device server once per controller; driverPort is
+//				NULL if the driver grants no direct calls.
+//-----------------------------------------------------------------------------
+static TC3DriverEndpointPtr
+CC3OSXController_GetDriverEndpoint(TQ3ControllerRef controllerRef)
 {
-	TQ3Status status = kQ3Failure;
-	CFMutableDictionaryRef dict,returnDict;
+	TQ3Status				status = kQ3Failure;
+	TC3DriverEndpointPtr	theEndpoint;
+	CFMutableDictionaryRef	dict,returnDict = NULL;
+	CFStringRef				portName;
 	
 	Boolean result;
 	
+	for (theEndpoint=DriverEndpoints; theEndpoint!=NULL; theEndpoint=theEndpoint->next)
+		if (theEndpoint->controllerRef==controllerRef)
+			return(theEndpoint);
+	
+	theEndpoint = (TC3DriverEndpointPtr)malloc(sizeof(TC3DriverEndpoint));
+	if (theEndpoint==NULL)
+		return(NULL);
+	theEndpoint->controllerRef = controllerRef;
+	theEndpoint->driverPort = NULL;
+	
 	//create dictionary
 	dict = CFDictionaryCreateMutable(	kCFAllocatorDefault,0,
 										&kCFTypeDictionaryKeyCallBacks,
@@ -989,24 +1835,169 @@ CC3OSXController_SetChannel(TQ3ControllerRef controllerRef, TQ3Uns32 channel, co
 		//controllerRef
 		result = IPCPutControllerRef(dict, CFSTR(k3CtrlRef), &controllerRef);
 		
-		//channel
-		result = IPCPutTQ3Uns32(dict, CFSTR(k3Channel), &channel);
-				
-		//data
-		result = IPCPutBytes(dict, CFSTR(k3Data), dataSize, data);
-		
-		//dataSize
-		result = IPCPutTQ3Uns32(dict, CFSTR(k3DataSize), &dataSize);
-								
 		//try sending
-		status = IPCControllerDriver_Send(m3Controller_SetChannel,dict,&returnDict);
+		status = IPCControllerDriver_Send(m3Controller_GetDriverEndpoint,dict,&returnDict);
 		if (status!=kQ3Failure)
 		{
 			//Get status from returnDict
 			result = IPCGetTQ3Uns32(returnDict, CFSTR(k3Status), (TQ3Uns32*)&status);
 		};
-		//Do clean up
-		CFRelease(dict);
+		if (status!=kQ3Failure)
+		{
+			//Get parameters from returnDict
+			portName = (CFStringRef)CFDictionaryGetValue(returnDict, CFSTR(k3DriverPortName));
+			result = IPCGetTQ3Uns32(returnDict, CFSTR(k3DriverHandle), &theEndpoint->driverHandle);
+			result = IPCGetTQ3Uns32(returnDict, CFSTR(k3CapToken), &theEndpoint->token);
+			
+			if (portName!=NULL)
+				theEndpoint->driverPort = CFMessagePortCreateRemote(kCFAllocatorDefault, portName);
+		}
+		//Do clean up
+		CFRelease(dict);
+		
+		if (returnDict)
+			CFRelease(returnDict);
+	}
+	
+	//remembered without driverPort, too, so the server is not asked on every call
+	theEndpoint->next = DriverEndpoints;
+	DriverEndpoints = theEndpoint;
+	return(theEndpoint);
+}
+
+
+
+//=============================================================================
+//      CC3OSXController_SendChannel : Send a channel call straight to the
+//				driver, through the device server if that is not possible.
+//-----------------------------------------------------------------------------
+//		Note : returnDict looks the same either way: the driver's reply is
+//				found under k3MethodsReturn.
+//				A refused capability or a vanished driver port drops the
+//				endpoint; the next call asks the device server again.
+//-----------------------------------------------------------------------------
+static TQ3Status
+CC3OSXController_SendChannel(SInt32 msgid, TQ3ControllerRef controllerRef, CFMutableDictionaryRef dict, CFMutableDictionaryRef *returnDict)
+{
+	TC3DriverEndpointPtr	theEndpoint = CC3OSXController_GetDriverEndpoint(controllerRef);
+	SInt32					driverMsgid = (msgid==m3Controller_SetChannel) ? m3ControllerDriver_DirectSetChannel : m3ControllerDriver_DirectGetChannel;
+	TQ3Status				status = kQ3Success;
+	TQ3Boolean				capValid = kQ3False;
+	CFDataRef 				data,returnData = NULL;
+	CFStringRef				propertyListError = NULL;
+	CFDictionaryRef			driverReturnDict = NULL;
+	
+	if ((theEndpoint!=NULL) && (theEndpoint->driverPort!=NULL))
+	{
+		IPCPutTQ3Uns32(dict, CFSTR(k3DriverHandle), &theEndpoint->driverHandle);
+		IPCPutTQ3Uns32(dict, CFSTR(k3CapToken), &theEndpoint->token);
+		
+		data = CFPropertyListCreateXMLData(kCFAllocatorDefault,dict);
+		if ((data!=NULL)
+		 && (CFMessagePortSendRequest(	theEndpoint->driverPort, driverMsgid, data, 
+										10, 10, kCFRunLoopDefaultMode,
+										&returnData)==kCFMessagePortSuccess)
+		 && (returnData!=NULL))
+		{
+			driverReturnDict = (CFDictionaryRef)CFPropertyListCreateFromXMLData(	kCFAllocatorDefault, 
+																					returnData, 
+																					kCFPropertyListImmutable, 
+																					&propertyListError);
+			if (propertyListError)
+				CFRelease(propertyListError);
+			if ((driverReturnDict!=NULL) && (CFDictionaryGetValue(driverReturnDict, CFSTR(k3CapValid))!=NULL))
+				IPCGetTQ3Boolean(driverReturnDict, CFSTR(k3CapValid), &capValid);
+		}
+		if (returnData)
+			CFRelease(returnData);
+		if (data)
+			CFRelease(data);
+		
+		CFDictionaryRemoveValue(dict, CFSTR(k3DriverHandle));
+		CFDictionaryRemoveValue(dict, CFSTR(k3CapToken));
+		
+		if (capValid==kQ3True)
+		{
+			*returnDict = CFDictionaryCreateMutable(	kCFAllocatorDefault,0,
+														&kCFTypeDictionaryKeyCallBacks,
+														&kCFTypeDictionaryValueCallBacks);
+			if (*returnDict!=NULL)
+			{
+				CFDictionarySetValue(*returnDict, CFSTR(k3MethodsReturn), driverReturnDict);
+				IPCPutTQ3Uns32(*returnDict, CFSTR(k3Status), (TQ3Uns32*)&status);
+			}
+			CFRelease(driverReturnDict);
+			return((*returnDict!=NULL) ? kQ3Success : kQ3Failure);
+		}
+		
+		if (driverReturnDict)
+			CFRelease(driverReturnDict);
+		CC3OSXController_ForgetDriverEndpoint(controllerRef);
+	}
+	
+	return(IPCControllerDriver_Send(msgid,dict,returnDict));
+}
+
+
+
+//=============================================================================
+//      CC3OSXController_SetChannel : One-line description of the method.
+//-----------------------------------------------------------------------------
+//		Only device clients will call CC3OSXController_SetChannel.
+//		parameters will be transfered via IPC to the device driver.
+//		the device server holds only the name of the device driver messageport.
+//		the parameters are then forwarded by the server to the driver's messageport.
+//		the device driver will call its channelSetMethod found in TQ3ControllerData.
+//-----------------------------------------------------------------------------
+TQ3Status
+CC3OSXController_SetChannel(TQ3ControllerRef controllerRef, TQ3Uns32 channel, const void *data, TQ3Uns32 dataSize)
+{
+	TQ3Status status = kQ3Failure;
+	CFMutableDictionaryRef dict,returnDict;
+	
+	Boolean result;
+	TC3IPCSharedData shared = {"", NULL, 0, kQ3False};
+	
+	//create dictionary
+	dict = CFDictionaryCreateMutable(	kCFAllocatorDefault,0,
+										&kCFTypeDictionaryKeyCallBacks,
+										&kCFTypeDictionaryValueCallBacks);
+	if (dict)
+	{
+		//Put parameters into dict
+		//controllerRef
+		result = IPCPutControllerRef(dict, CFSTR(k3CtrlRef), &controllerRef);
+		
+		//channel
+		result = IPCPutTQ3Uns32(dict, CFSTR(k3Channel), &channel);
+				
+		//data: small data travels inline, large data in shared memory
+		if (dataSize<=kIPCSharedDataThreshold)
+			result = IPCPutBytes(dict, CFSTR(k3Data), dataSize, data);
+		else if (IPCSharedData_Create(dataSize, &shared)==kQ3Success)
+		{
+			memcpy(shared.bytes, data, dataSize);
+			result = IPCSharedData_Put(dict, &shared);
+		}
+		else
+		{
+			CFRelease(dict);
+			return(status);
+		}
+		
+		//dataSize
+		result = IPCPutTQ3Uns32(dict, CFSTR(k3DataSize), &dataSize);
+								
+		//try sending
+		status = CC3OSXController_SendChannel(m3Controller_SetChannel,controllerRef,dict,&returnDict);
+		if (status!=kQ3Failure)
+		{
+			//Get status from returnDict
+			result = IPCGetTQ3Uns32(returnDict, CFSTR(k3Status), (TQ3Uns32*)&status);
+		};
+		//Do clean up
+		IPCSharedData_Close(&shared);
+		CFRelease(dict);
 		
 		if (returnDict)
 			CFRelease(returnDict);
@@ -1032,6 +2023,8 @@ CC3OSXController_GetChannel(TQ3ControllerRef controllerRef, TQ3Uns32 channel, vo
 	CFMutableDictionaryRef dict,returnDict;
 	
 	Boolean result;
+	TC3IPCSharedData shared = {"", NULL, 0, kQ3False};
+	TQ3Uns32 capacity = *dataSize;
 	
 	//create dictionary
 	dict = CFDictionaryCreateMutable(	kCFAllocatorDefault,0,
@@ -1048,29 +2041,202 @@ CC3OSXController_GetChannel(TQ3ControllerRef controllerRef, TQ3Uns32 channel, vo
 				
 		//dataSize
 		result = IPCPutTQ3Uns32(dict, CFSTR(k3DataSize), dataSize);
+		
+		//large data comes back in shared memory
+		if (capacity>kIPCSharedDataThreshold)
+		{
+			if (IPCSharedData_Create(capacity, &shared)==kQ3Failure)
+			{
+				CFRelease(dict);
+				return(status);
+			}
+			result = IPCSharedData_Put(dict, &shared);
+		}
 										
 		//try sending
-		status = IPCControllerDriver_Send(m3Controller_GetChannel,dict,&returnDict);
+		status = CC3OSXController_SendChannel(m3Controller_GetChannel,controllerRef,dict,&returnDict);
+		if (status!=kQ3Failure)
+		{
+			//Get status from returnDict
+			result = IPCGetTQ3Uns32(returnDict, CFSTR(k3Status), (TQ3Uns32*)&status);
+		};
 		if (status!=kQ3Failure)
 		{
 			//Get parameters from returnDict
 			//get originaly returned dictionary from inside the returnDict
 			CFMutableDictionaryRef 	workReturnDict = 
 				(CFMutableDictionaryRef)CFDictionaryGetValue(returnDict,CFSTR(k3MethodsReturn));
+			TQ3Uns32				returnSize = 0;
 				
-			if (workReturnDict!=NULL)
+			status = kQ3Failure;
+			if ((workReturnDict!=NULL) && (CFDictionaryGetValue(workReturnDict,CFSTR(k3DataSize))!=NULL))
 			{
-				
-				//dataSize
-				result = IPCGetTQ3Uns32(workReturnDict, CFSTR(k3DataSize), dataSize);
-																		
-				//data
-				result = IPCGetBytes(workReturnDict, CFSTR(k3Data), *dataSize, data);
+				//dataSize, never beyond the caller's buffer
+				result = IPCGetTQ3Uns32(workReturnDict, CFSTR(k3DataSize), &returnSize);
+				if (returnSize<=capacity)
+				{
+					//data
+					if (shared.bytes!=NULL)
+					{
+						memcpy(data, shared.bytes, returnSize);
+						status = kQ3Success;
+					}
+					else if (CFDictionaryGetValue(workReturnDict,CFSTR(k3Data))!=NULL)
+					{
+						result = IPCGetBytes(workReturnDict, CFSTR(k3Data), returnSize, data);
+						status = kQ3Success;
+					}
+				}
+			}
+			if (status==kQ3Success)
+				*dataSize = returnSize;
+		};
+		//Do clean up
+		IPCSharedData_Close(&shared);
+		CFRelease(dict);
+		
+		if (returnDict)
+			CFRelease(returnDict);
+	}
+	return(status);
+}
+
+
+
+
+
+
+//=============================================================================
+//      CC3OSXController_NewChannelsDict : Build the request of a
+//				SetChannels or GetChannels.
+//-----------------------------------------------------------------------------
+//		Note : data==NULL leaves out the data, as GetChannels needs only the
+//				capacity of each channel.
+//-----------------------------------------------------------------------------
+static CFMutableDictionaryRef
+CC3OSXController_NewChannelsDict(TQ3ControllerRef controllerRef, TQ3Uns32 channelCount, const TQ3Uns32 *channels, const void *const *data, const TQ3Uns32 *dataSizes)
+{
+	CFMutableDictionaryRef	dict;
+	CFMutableArrayRef		entries;
+	TQ3Uns32				index;
+	
+	if ((channelCount==0) || (channelCount>kQ3MaxControllerChannels) || (channels==NULL) || (dataSizes==NULL))
+		return(NULL);
+	
+	entries = CFArrayCreateMutable(kCFAllocatorDefault, channelCount, &kCFTypeArrayCallBacks);
+	if (entries==NULL)
+		return(NULL);
+	
+	for (index=0; index<channelCount; index++)
+	{
+		CFMutableDictionaryRef	entry;
+		TQ3Uns32				channel = channels[index], dataSize = dataSizes[index];
+		
+		entry = CFDictionaryCreateMutable(	kCFAllocatorDefault,0,
+											&kCFTypeDictionaryKeyCallBacks,
+											&kCFTypeDictionaryValueCallBacks);
+		if (entry==NULL)
+		{
+			CFRelease(entries);
+			return(NULL);
+		}
+		
+		//channel
+		IPCPutTQ3Uns32(entry, CFSTR(k3Channel), &channel);
+		
+		//data; batches carry inline data only
+		if (data!=NULL)
+		{
+			if (dataSize>kIPCSharedDataThreshold)
+			{
+				CFRelease(entry);
+				CFRelease(entries);
+				return(NULL);
 			}
+			IPCPutBytes(entry, CFSTR(k3Data), dataSize, data[index]);
+		}
+		
+		//dataSize
+		IPCPutTQ3Uns32(entry, CFSTR(k3DataSize), &dataSize);
+		
+		CFArrayAppendValue(entries, entry);
+		CFRelease(entry);
+	}
+	
+	dict = CFDictionaryCreateMutable(	kCFAllocatorDefault,0,
+										&kCFTypeDictionaryKeyCallBacks,
+										&kCFTypeDictionaryValueCallBacks);
+	if (dict)
+	{
+		//controllerRef
+		IPCPutControllerRef(dict, CFSTR(k3CtrlRef), &controllerRef);
+		
+		//channels
+		CFDictionarySetValue(dict, CFSTR(k3Channels), entries);
+	}
+	
+	CFRelease(entries);
+	return(dict);
+}
+
+
+
+//=============================================================================
+//      CC3OSXController_SetChannels : CC3OSXController_SetChannel for many
+//				channels of one controller.
+//-----------------------------------------------------------------------------
+//		Note : All channels travel with one message to the device server and
+//				one from there to the device driver, which calls its
+//				channelSetMethod for each of them in order.
+//				channelStatus may be NULL; otherwise it gets the status of
+//				each channel. The result is kQ3Failure if any channel failed.
+//				Channels larger than kIPCSharedDataThreshold need
+//				CC3OSXController_SetChannel.
+//-----------------------------------------------------------------------------
+TQ3Status
+CC3OSXController_SetChannels(TQ3ControllerRef controllerRef, TQ3Uns32 channelCount, const TQ3Uns32 *channels, const void *const *data, const TQ3Uns32 *dataSizes, TQ3Status *channelStatus)
+{
+	TQ3Status status = kQ3Failure;
+	CFMutableDictionaryRef dict,returnDict = NULL;
+	CFArrayRef replies = NULL;
+	TQ3Uns32 index;
+	
+	Boolean result;
+	
+	if (data==NULL)
+		return(status);
+	
+	//create dictionary
+	dict = CC3OSXController_NewChannelsDict(controllerRef, channelCount, channels, data, dataSizes);
+	if (dict)
+	{
+		//try sending
+		status = IPCControllerDriver_Send(m3Controller_SetChannels,dict,&returnDict);
+		if (status!=kQ3Failure)
+		{
+			//Get parameters from returnDict
+			CFDictionaryRef workReturnDict = 
+				(CFDictionaryRef)CFDictionaryGetValue(returnDict,CFSTR(k3MethodsReturn));
+			
+			if (workReturnDict!=NULL)
+				replies = (CFArrayRef)CFDictionaryGetValue(workReturnDict,CFSTR(k3Channels));
 			
 			//Get status from returnDict
 			result = IPCGetTQ3Uns32(returnDict, CFSTR(k3Status), (TQ3Uns32*)&status);
 		};
+		
+		for (index=0; index<channelCount; index++)
+		{
+			TQ3Status channelResult = kQ3Failure;
+			
+			if ((status!=kQ3Failure) && (replies!=NULL) && (index<(TQ3Uns32)CFArrayGetCount(replies)))
+				IPCGetTQ3Uns32((CFDictionaryRef)CFArrayGetValueAtIndex(replies,index), CFSTR(k3Status), (TQ3Uns32*)&channelResult);
+			if (channelStatus!=NULL)
+				channelStatus[index] = channelResult;
+			if (channelResult!=kQ3Success)
+				status = kQ3Failure;
+		}
+		
 		//Do clean up
 		CFRelease(dict);
 		
@@ -1083,6 +2249,89 @@ CC3OSXController_GetChannel(TQ3ControllerRef controllerRef, TQ3Uns32 channel, vo
 
 
 
+//=============================================================================
+//      CC3OSXController_GetChannels : CC3OSXController_GetChannel for many
+//				channels of one controller.
+//-----------------------------------------------------------------------------
+//		Note : On entry dataSizes holds the capacity of each buffer in data,
+//				on exit the size the driver delivered; a failed channel
+//				gets 0. channelStatus may be NULL.
+//				The result is kQ3Failure if any channel failed.
+//-----------------------------------------------------------------------------
+TQ3Status
+CC3OSXController_GetChannels(TQ3ControllerRef controllerRef, TQ3Uns32 channelCount, const TQ3Uns32 *channels, void *const *data, TQ3Uns32 *dataSizes, TQ3Status *channelStatus)
+{
+	TQ3Status status = kQ3Failure;
+	CFMutableDictionaryRef dict,returnDict = NULL;
+	CFArrayRef replies = NULL;
+	TQ3Uns32 index;
+	
+	Boolean result;
+	
+	if (data==NULL)
+		return(status);
+	
+	//create dictionary
+	dict = CC3OSXController_NewChannelsDict(controllerRef, channelCount, channels, NULL, dataSizes);
+	if (dict)
+	{
+		//try sending
+		status = IPCControllerDriver_Send(m3Controller_GetChannels,dict,&returnDict);
+		if (status!=kQ3Failure)
+		{
+			//Get parameters from returnDict
+			CFDictionaryRef workReturnDict = 
+				(CFDictionaryRef)CFDictionaryGetValue(returnDict,CFSTR(k3MethodsReturn));
+			
+			if (workReturnDict!=NULL)
+				replies = (CFArrayRef)CFDictionaryGetValue(workReturnDict,CFSTR(k3Channels));
+			
+			//Get status from returnDict
+			result = IPCGetTQ3Uns32(returnDict, CFSTR(k3Status), (TQ3Uns32*)&status);
+		};
+		
+		for (index=0; index<channelCount; index++)
+		{
+			TQ3Status	channelResult = kQ3Failure;
+			TQ3Uns32	dataSize = 0;
+			
+			if ((status!=kQ3Failure) && (replies!=NULL) && (index<(TQ3Uns32)CFArrayGetCount(replies)))
+			{
+				CFDictionaryRef reply = (CFDictionaryRef)CFArrayGetValueAtIndex(replies,index);
+				
+				IPCGetTQ3Uns32(reply, CFSTR(k3Status), (TQ3Uns32*)&channelResult);
+				if (channelResult==kQ3Success)
+				{
+					//dataSize, never beyond the caller's buffer
+					IPCGetTQ3Uns32(reply, CFSTR(k3DataSize), &dataSize);
+					if (dataSize>dataSizes[index])
+						channelResult = kQ3Failure;
+					
+					//data
+					else if (!IPCGetBytes(reply, CFSTR(k3Data), dataSize, data[index]))
+						channelResult = kQ3Failure;
+				}
+			}
+			if (channelResult!=kQ3Success)
+				dataSize = 0;
+			
+			dataSizes[index] = dataSize;
+			if (channelStatus!=NULL)
+				channelStatus[index] = channelResult;
+			if (channelResult!=kQ3Success)
+				status = kQ3Failure;
+		}
+		
+		//Do clean up
+		CFRelease(dict);
+		
+		if (returnDict)
+			CFRelease(returnDict);
+	}
+	return(status);
+}
+
+
 
 
 //=============================================================================
@@ -1146,7 +2395,6 @@ CC3OSXController_SetTracker(TQ3ControllerRef controllerRef, TC3TrackerInstanceDa
 {
 	TQ3Status status = kQ3Failure;
 	CFMutableDictionaryRef dict,returnDict;
-	CFDictionaryRef	trackers = ClientTrackers;
 	
 	Boolean result;
 	
@@ -1162,17 +2410,14 @@ CC3OSXController_SetTracker(TQ3ControllerRef controllerRef, TC3TrackerInstanceDa
 		
 		//equivalent of tracker
 		//TrackerServerName
-		CFStringRef TrackerServerName = (CFStringRef)CFDictionaryGetValue(trackers,CFSTR(k3TrackerPortName));
-		CFDictionarySetValue(dict,CFSTR(k3TrackerPortName),TrackerServerName);
+		if (TrackerPortName!=NULL)
+			CFDictionarySetValue(dict,CFSTR(k3TrackerPortName),TrackerPortName);
 		
-		//TrackerUUID instead of tracker if tracker is not NULL
+		//tracker handle instead of tracker if tracker is not NULL
 		//NULL is a valid tracker!!
 		if (tracker!=NULL)
-		{
-			CFStringRef TrackerUUIDString = CFUUIDCreateString(kCFAllocatorDefault,tracker->trackerUUID);
-			CFDictionarySetValue(dict,CFSTR(k3TrackerUUID),TrackerUUIDString);
-			CFRelease(TrackerUUIDString);
-		}
+			result = IPCPutTQ3Uns32(dict, CFSTR(k3TrackerHandle), &tracker->trackerHandle);
+			
 		//try sending
 		status = IPCControllerDriver_Send(m3Controller_SetTracker,dict,&returnDict);
 		if (status!=kQ3Failure)
@@ -1240,14 +2485,15 @@ CC3OSXController_HasTracker(TQ3ControllerRef controllerRef, TQ3Boolean *hasTrack
 
 
 //=============================================================================
-//      CC3OSXController_Track2DCursor : One-line description of the method.
+//      CC3OSXController_GetConsumerState : Client demand for a controller.
 //-----------------------------------------------------------------------------
-//		Note : More detailed comments can be placed here if required.
-//
-// used on Server/Driver Side
+//		Note : For drivers. hasSubscribers is kQ3True while a tracker is attached
+//			   or a client waits for values; both want every sample. consumerRate
+//			   is how often clients poll values, buttons or the tracker per
+//			   second. A driver with neither may slow its device down.
 //-----------------------------------------------------------------------------
 TQ3Status
-CC3OSXController_Track2DCursor(TQ3ControllerRef controllerRef, TQ3Boolean *track2DCursor)
+CC3OSXController_GetConsumerState(TQ3ControllerRef controllerRef, TQ3Boolean *hasSubscribers, float *consumerRate)
 {
 	TQ3Status status = kQ3Failure;
 	CFMutableDictionaryRef dict,returnDict;
@@ -1265,12 +2511,15 @@ CC3OSXController_Track2DCursor(TQ3ControllerRef controllerRef, TQ3Boolean *track
 		result = IPCPutControllerRef(dict, CFSTR(k3CtrlRef), &controllerRef);
 				
 		//try sending
-		status = IPCControllerDriver_Send(m3Controller_Track2DCursor,dict,&returnDict);
+		status = IPCControllerDriver_Send(m3Controller_GetConsumerState,dict,&returnDict);
 		if (status!=kQ3Failure)
 		{
 			//Get parameters from returnDict
-			//track2DCursor
-			result = IPCGetTQ3Boolean(returnDict, CFSTR(k3Track2DCrsr), track2DCursor);
+			//hasSubscribers
+			result = IPCGetTQ3Boolean(returnDict, CFSTR(k3hasSubscribers), hasSubscribers);
+			
+			//consumerRate
+			result = IPCGetBytes(returnDict, CFSTR(k3ConsumerRate), sizeof(float), consumerRate);
 			
 			//Get status from returnDict
 			result = IPCGetTQ3Uns32(returnDict, CFSTR(k3Status), (TQ3Uns32*)&status);
@@ -1286,18 +2535,16 @@ CC3OSXController_Track2DCursor(TQ3ControllerRef controllerRef, TQ3Boolean *track
 
 
 
-
-
-
 //=============================================================================
-//      CC3OSXController_Track3DCursor : One-line description of the method.
+//      CC3OSXController_SetFilter : Filter pipeline of the device server.
 //-----------------------------------------------------------------------------
-//		Note : More detailed comments can be placed here if required.
-//
-// used on Server/Driver Side
+//		Note : For drivers. stages is a CFArray of stage dictionaries (keys
+//			   k3FilterType and k3FilterParams of IPCMessageIDs.h), applied
+//			   by the server to values and tracker deltas before clients see
+//			   them. NULL removes the pipeline.
 //-----------------------------------------------------------------------------
 TQ3Status
-CC3OSXController_Track3DCursor(TQ3ControllerRef controllerRef, TQ3Boolean *track3DCursor)
+CC3OSXController_SetFilter(TQ3ControllerRef controllerRef, CFArrayRef stages)
 {
 	TQ3Status status = kQ3Failure;
 	CFMutableDictionaryRef dict,returnDict;
@@ -1313,15 +2560,15 @@ CC3OSXController_Track3DCursor(TQ3ControllerRef controllerRef, TQ3Boolean *track
 		//Put parameters into dict
 		//controllerRef
 		result = IPCPutControllerRef(dict, CFSTR(k3CtrlRef), &controllerRef);
-				
+		
+		//stages
+		if (stages!=NULL)
+			CFDictionarySetValue(dict, CFSTR(k3FilterStages), stages);
+						
 		//try sending
-		status = IPCControllerDriver_Send(m3Controller_Track3DCursor,dict,&returnDict);
+		status = IPCControllerDriver_Send(m3Controller_SetFilter,dict,&returnDict);
 		if (status!=kQ3Failure)
 		{
-			//Get parameters from returnDict
-			//track3DCursor
-			result = IPCGetTQ3Boolean(returnDict, CFSTR(k3Track3DCrsr), track3DCursor);
-			
 			//Get status from returnDict
 			result = IPCGetTQ3Uns32(returnDict, CFSTR(k3Status), (TQ3Uns32*)&status);
 		};
@@ -1336,7 +2583,104 @@ CC3OSXController_Track3DCursor(TQ3ControllerRef controllerRef, TQ3Boolean *track
 
 
 
-
+//=============================================================================
+//      CC3OSXController_Track2DCursor : One-line description of the method.
+//-----------------------------------------------------------------------------
+//		Note : More detailed comments can be placed here if required.
+//
+// used on Server/Driver Side
+//-----------------------------------------------------------------------------
+TQ3Status
+CC3OSXController_Track2DCursor(TQ3ControllerRef controllerRef, TQ3Boolean *track2DCursor)
+{
+	TQ3Status status = kQ3Failure;
+	CFMutableDictionaryRef dict,returnDict;
+	
+	Boolean result;
+	
+	//create dictionary
+	dict = CFDictionaryCreateMutable(	kCFAllocatorDefault,0,
+										&kCFTypeDictionaryKeyCallBacks,
+										&kCFTypeDictionaryValueCallBacks);
+	if (dict)
+	{
+		//Put parameters into dict
+		//controllerRef
+		result = IPCPutControllerRef(dict, CFSTR(k3CtrlRef), &controllerRef);
+				
+		//try sending
+		status = IPCControllerDriver_Send(m3Controller_Track2DCursor,dict,&returnDict);
+		if (status!=kQ3Failure)
+		{
+			//Get parameters from returnDict
+			//track2DCursor
+			result = IPCGetTQ3Boolean(returnDict, CFSTR(k3Track2DCrsr), track2DCursor);
+			
+			//Get status from returnDict
+			result = IPCGetTQ3Uns32(returnDict, CFSTR(k3Status), (TQ3Uns32*)&status);
+		};
+		//Do clean up
+		CFRelease(dict);
+		
+		if (returnDict)
+			CFRelease(returnDict);
+	}
+	return(status);
+}
+
+
+
+
+
+
+//=============================================================================
+//      CC3OSXController_Track3DCursor : One-line description of the method.
+//-----------------------------------------------------------------------------
+//		Note : More detailed comments can be placed here if required.
+//
+// used on Server/Driver Side
+//-----------------------------------------------------------------------------
+TQ3Status
+CC3OSXController_Track3DCursor(TQ3ControllerRef controllerRef, TQ3Boolean *track3DCursor)
+{
+	TQ3Status status = kQ3Failure;
+	CFMutableDictionaryRef dict,returnDict;
+	
+	Boolean result;
+	
+	//create dictionary
+	dict = CFDictionaryCreateMutable(	kCFAllocatorDefault,0,
+										&kCFTypeDictionaryKeyCallBacks,
+										&kCFTypeDictionaryValueCallBacks);
+	if (dict)
+	{
+		//Put parameters into dict
+		//controllerRef
+		result = IPCPutControllerRef(dict, CFSTR(k3CtrlRef), &controllerRef);
+				
+		//try sending
+		status = IPCControllerDriver_Send(m3Controller_Track3DCursor,dict,&returnDict);
+		if (status!=kQ3Failure)
+		{
+			//Get parameters from returnDict
+			//track3DCursor
+			result = IPCGetTQ3Boolean(returnDict, CFSTR(k3Track3DCrsr), track3DCursor);
+			
+			//Get status from returnDict
+			result = IPCGetTQ3Uns32(returnDict, CFSTR(k3Status), (TQ3Uns32*)&status);
+		};
+		//Do clean up
+		CFRelease(dict);
+		
+		if (returnDict)
+			CFRelease(returnDict);
+	}
+	return(status);
+}
+
+
+
+
 //=============================================================================
 //      CC3OSXController_GetButtons : One-line description of the method.
 //-----------------------------------------------------------------------------
@@ -1754,116 +3098,440 @@ CC3OSXController_GetValues(TQ3ControllerRef controllerRef, TQ3Uns32 valueCount,
 	{
 		//Put parameters into dict
 		//controllerRef
-		result = IPCPutControllerRef(dict, CFSTR(k3CtrlRef), &controllerRef);
-		
-		//valueCount
-		result = IPCPutTQ3Uns32(dict, CFSTR(k3ValueCount), &valueCount);
+		result = IPCPutControllerRef(dict, CFSTR(k3CtrlRef), &controllerRef);
+		
+		//valueCount
+		result = IPCPutTQ3Uns32(dict, CFSTR(k3ValueCount), &valueCount);
+		
+		//try sending
+		status = IPCControllerDriver_Send(m3Controller_GetValues,dict,&returnDict);
+		
+		if (status!=kQ3Failure)
+		{
+			//Get result from returnDict
+			//privValueCount
+			result = IPCGetTQ3Uns32(returnDict, CFSTR(k3PrivValueCount), &privValueCount);
+						
+			//serialNumber
+			result = IPCGetTQ3Uns32(returnDict, CFSTR(k3SerNum), &tempSerNum);
+						
+			//active (here: helper variable)
+			result = IPCGetTQ3Boolean(returnDict, CFSTR(k3Active), &active);
+			if (active)
+			{
+				//serialNumber NULL or not
+				if (serialNumber==NULL)
+				{
+					if (privValueCount>0)
+					{
+						TQ3Uns32	maxCount,index;
+						if (privValueCount > valueCount)
+							maxCount=valueCount;
+						else
+							maxCount=privValueCount;
+						
+						CFArrayRef valAr = (CFArrayRef)CFDictionaryGetValue(returnDict,CFSTR(k3Values));
+						if (valAr!=NULL)
+							for (index=0; index<maxCount; index++)
+								result = CFNumberGetValue(	(CFNumberRef)CFArrayGetValueAtIndex(valAr,index),
+															kCFNumberFloatType,
+															&values[index]);
+						// CFRelease(valAr);
+					}
+					
+					if (changed!=NULL)		
+						*changed=kQ3True;
+				}
+				else
+				{
+					if (*serialNumber!=tempSerNum)
+					{
+						if (privValueCount>0)
+						{
+							TQ3Uns32	maxCount,index;
+							if (privValueCount > valueCount)
+								maxCount=valueCount;
+							else
+								maxCount=privValueCount;
+							
+							CFArrayRef valAr = (CFArrayRef)CFDictionaryGetValue(returnDict,CFSTR(k3Values));
+							if (valAr!=NULL)
+								for (index=0; index<maxCount; index++)
+									result = CFNumberGetValue(	(CFNumberRef)CFArrayGetValueAtIndex(valAr,index),
+																kCFNumberFloatType,
+																&values[index]);
+							// CFRelease(valAr);
+						}
+							
+						if (changed!=NULL)		
+							*changed=kQ3True;
+					}
+					else
+						if (changed!=NULL)		
+							*changed=kQ3False;
+				}
+			}
+			
+			if (serialNumber!=NULL)
+				if (*serialNumber!=tempSerNum)
+					*serialNumber = tempSerNum;
+																								
+			//Get status from returnDict
+			result = IPCGetTQ3Uns32(returnDict, CFSTR(k3Status), (TQ3Uns32*)&status);
+		};
+		//Do clean up
+		CFRelease(dict);
+		
+		if (returnDict)
+			CFRelease(returnDict);
+	}
+	return(status);
+}
+
+
+
+
+
+//=============================================================================
+//      CC3OSXController_SetValues : One-line description of the method.
+//-----------------------------------------------------------------------------
+//		Note : More detailed comments can be placed here if required.
+//
+// Deviation from Apple-doc: Controller serialNumber is incremented!
+// used on Server/Driver Side
+//-----------------------------------------------------------------------------
+TQ3Status
+CC3OSXController_SetValues(TQ3ControllerRef controllerRef, const float *values, TQ3Uns32 valueCount)
+{
+	TQ3Status status = kQ3Failure;
+	CFMutableDictionaryRef dict,returnDict;
+	
+	Boolean		result;
+	TQ3Uns32 	index;
+	
+	//create dictionary
+	dict = CFDictionaryCreateMutable(	kCFAllocatorDefault,0,
+										&kCFTypeDictionaryKeyCallBacks,
+										&kCFTypeDictionaryValueCallBacks);
+	if (dict)
+	{
+		//Put parameters into dict
+		//controllerRef
+		result = IPCPutControllerRef(dict, CFSTR(k3CtrlRef), &controllerRef);
+		
+		//valueCount
+		if (valueCount>kQ3MaxControllerValues) 
+			valueCount = kQ3MaxControllerValues;
+		result = IPCPutTQ3Uns32(dict, CFSTR(k3ValueCount), &valueCount);
+				
+		//values
+		CFNumberRef *valuesInput = (CFNumberRef*)malloc(valueCount*sizeof(CFNumberRef));
+		for (index=0; index<valueCount; index++)
+			valuesInput[index]= CFNumberCreate(kCFAllocatorDefault,kCFNumberFloatType,&values[index]);
+		CFArrayRef valuesRef = CFArrayCreate(kCFAllocatorDefault,(const void**)valuesInput,valueCount,&kCFTypeArrayCallBacks);
+		for (index=0; index<valueCount; index++)
+			CFRelease(valuesInput[index]);
+		free(valuesInput);
+		CFDictionarySetValue(dict,CFSTR(k3Values),valuesRef);
+		CFRelease(valuesRef);
+		
+		//try sending
+		status = IPCControllerDriver_Send(m3Controller_SetValues,dict,&returnDict);
+		if (status!=kQ3Failure)
+		{
+			//Get status from returnDict
+			result = IPCGetTQ3Uns32(returnDict, CFSTR(k3Status), (TQ3Uns32*)&status);
+		};
+		//Do clean up
+		CFRelease(dict);
+		
+		if (returnDict)
+			CFRelease(returnDict);
+	}
+	return(status);
+}
+
+#pragma mark -
+//=============================================================================
+//      CC3OSXController_SendAsync : Send a request to the device server
+//				without waiting for the reply.
+//-----------------------------------------------------------------------------
+//		Note : callData is handed to completionProc, which frees it. Only if
+//				IPCAsync_SendRequest fails has completionProc not run and will
+//				not run, then callData is freed here.
+//-----------------------------------------------------------------------------
+static TQ3Status
+CC3OSXController_SendAsync(SInt32 msgid, CFMutableDictionaryRef dict, TC3IPCAsyncCompletionProc completionProc, TC3AsyncCallDataPtr callData)
+{
+	TQ3Status status = IPCAsync_SendRequest(CFSTR(kQuesa3DeviceServer), msgid, dict, completionProc, callData);
+	
+	if (status==kQ3Failure)
+		free(callData);
+		
+	return(status);
+}
+
+
+
+static TC3AsyncCallDataPtr
+CC3OSXController_NewCallData(TQ3ControllerRef controllerRef, void *userData)
+{
+	TC3AsyncCallDataPtr callData = (TC3AsyncCallDataPtr)malloc(sizeof(TC3AsyncCallData));
+	
+	if (callData!=NULL)
+	{
+		callData->controllerRef = controllerRef;
+		callData->valueCount = 0;
+		callData->valuesProc = NULL;
+		callData->positionProc = NULL;
+		callData->orientationProc = NULL;
+		callData->stateBatchProc = NULL;
+		callData->userData = userData;
+	}
+	return(callData);
+}
+
+
+
+static void
+CC3OSXController_ValuesCompletion(SInt32 msgid, TQ3Status status, CFDictionaryRef returnDict, void *userData)
+{
+	TC3AsyncCallDataPtr	callData = (TC3AsyncCallDataPtr)userData;
+	float				values[kQ3MaxControllerValues];
+	TQ3Uns32			privValueCount = 0;
+	TQ3Uns32			serialNumber = 0;
+	TQ3Boolean			active = kQ3False;
+	TQ3Uns32			index;
+	
+	if ((status==kQ3Success) && (returnDict!=NULL))
+	{
+		IPCGetTQ3Uns32(returnDict, CFSTR(k3PrivValueCount), &privValueCount);
+		IPCGetTQ3Uns32(returnDict, CFSTR(k3SerNum), &serialNumber);
+		IPCGetTQ3Boolean(returnDict, CFSTR(k3Active), &active);
+		
+		if (privValueCount > callData->valueCount)
+			privValueCount = callData->valueCount;
+		
+		CFArrayRef valAr = (CFArrayRef)CFDictionaryGetValue(returnDict,CFSTR(k3Values));
+		if ((valAr!=NULL) && (active==kQ3True))
+		{
+			if (privValueCount > (TQ3Uns32)CFArrayGetCount(valAr))
+				privValueCount = (TQ3Uns32)CFArrayGetCount(valAr);
+			for (index=0; index<privValueCount; index++)
+				CFNumberGetValue(	(CFNumberRef)CFArrayGetValueAtIndex(valAr,index),
+									kCFNumberFloatType,
+									&values[index]);
+		}
+		else
+			privValueCount = 0;
+	}
+	
+	if (callData->valuesProc!=NULL)
+		callData->valuesProc(status, callData->controllerRef, privValueCount, values, active, serialNumber, callData->userData);
+		
+	free(callData);
+}
+
+
+
+static void
+CC3OSXController_PositionCompletion(SInt32 msgid, TQ3Status status, CFDictionaryRef returnDict, void *userData)
+{
+	TC3AsyncCallDataPtr	callData = (TC3AsyncCallDataPtr)userData;
+	TQ3Point3D			position = {0.0f, 0.0f, 0.0f};
+	
+	if ((status==kQ3Success) && (returnDict!=NULL))
+		if (!IPCGetTQ3Point3D(returnDict, CFSTR(k3Position), &position))
+			status = kQ3Failure;
+	
+	if (callData->positionProc!=NULL)
+		callData->positionProc(status, callData->controllerRef, &position, callData->userData);
+		
+	free(callData);
+}
+
+
+
+static void
+CC3OSXController_OrientationCompletion(SInt32 msgid, TQ3Status status, CFDictionaryRef returnDict, void *userData)
+{
+	TC3AsyncCallDataPtr	callData = (TC3AsyncCallDataPtr)userData;
+	TQ3Quaternion		orientation = {1.0f, 0.0f, 0.0f, 0.0f};
+	
+	if ((status==kQ3Success) && (returnDict!=NULL))
+		if (!IPCGetTQ3Quaternion(returnDict, CFSTR(k3Orient), &orientation))
+			status = kQ3Failure;
+	
+	if (callData->orientationProc!=NULL)
+		callData->orientationProc(status, callData->controllerRef, &orientation, callData->userData);
+		
+	free(callData);
+}
+
+
+
+//=============================================================================
+//      CC3OSXController_GetValuesAsync : Non-blocking CC3OSXController_GetValues.
+//-----------------------------------------------------------------------------
+//		Note : completionProc gets at most valueCount values; valueCount is 0
+//				if the controller is inactive.
+//-----------------------------------------------------------------------------
+TQ3Status
+CC3OSXController_GetValuesAsync(TQ3ControllerRef controllerRef, TQ3Uns32 valueCount, TC3ValuesCompletionProc completionProc, void *userData)
+{
+	TQ3Status 			status = kQ3Failure;
+	TC3AsyncCallDataPtr	callData;
+	CFMutableDictionaryRef dict;
+	
+	if (valueCount>kQ3MaxControllerValues)
+		valueCount = kQ3MaxControllerValues;
+	
+	callData = CC3OSXController_NewCallData(controllerRef, userData);
+	if (callData==NULL)
+		return(status);
+	callData->valueCount = valueCount;
+	callData->valuesProc = completionProc;
+	
+	//create dictionary
+	dict = CFDictionaryCreateMutable(	kCFAllocatorDefault,0,
+										&kCFTypeDictionaryKeyCallBacks,
+										&kCFTypeDictionaryValueCallBacks);
+	if (dict)
+	{
+		//Put parameters into dict
+		//controllerRef
+		IPCPutControllerRef(dict, CFSTR(k3CtrlRef), &controllerRef);
+		
+		//valueCount
+		IPCPutTQ3Uns32(dict, CFSTR(k3ValueCount), &valueCount);
+		
+		//try sending
+		status = CC3OSXController_SendAsync(m3Controller_GetValues, dict, CC3OSXController_ValuesCompletion, callData);
+		
+		//Do clean up
+		CFRelease(dict);
+	}
+	else
+		free(callData);
+		
+	return(status);
+}
+
+
+
+//=============================================================================
+//      CC3OSXController_WaitForValues : Get notified as soon as the values of
+//				a controller differ from serialNumber.
+//-----------------------------------------------------------------------------
+//		Note : Completes immediately if serialNumber is already stale; otherwise
+//				the device server parks the request until the next SetValues.
+//				Re-arming from within completionProc with the delivered
+//				serialNumber gives a continuous stream of value updates.
+//				A decommissioned controller completes with kQ3Failure. Without a
+//				change the request completes after 30 s with the unchanged
+//				serialNumber; re-arming simply waits again.
+//-----------------------------------------------------------------------------
+TQ3Status
+CC3OSXController_WaitForValues(TQ3ControllerRef controllerRef, TQ3Uns32 valueCount, TQ3Uns32 serialNumber, TC3ValuesCompletionProc completionProc, void *userData)
+{
+	TQ3Status 			status = kQ3Failure;
+	TC3AsyncCallDataPtr	callData;
+	CFMutableDictionaryRef dict;
+	
+	if (valueCount>kQ3MaxControllerValues)
+		valueCount = kQ3MaxControllerValues;
+	
+	callData = CC3OSXController_NewCallData(controllerRef, userData);
+	if (callData==NULL)
+		return(status);
+	callData->valueCount = valueCount;
+	callData->valuesProc = completionProc;
+	
+	//create dictionary
+	dict = CFDictionaryCreateMutable(	kCFAllocatorDefault,0,
+										&kCFTypeDictionaryKeyCallBacks,
+										&kCFTypeDictionaryValueCallBacks);
+	if (dict)
+	{
+		//Put parameters into dict
+		//controllerRef
+		IPCPutControllerRef(dict, CFSTR(k3CtrlRef), &controllerRef);
+		
+		//valueCount
+		IPCPutTQ3Uns32(dict, CFSTR(k3ValueCount), &valueCount);
+		
+		//serialNumber
+		IPCPutTQ3Uns32(dict, CFSTR(k3SerNum), &serialNumber);
+		
+		//try sending
+		status = CC3OSXController_SendAsync(m3Controller_WaitForValues, dict, CC3OSXController_ValuesCompletion, callData);
+		
+		//Do clean up
+		CFRelease(dict);
+	}
+	else
+		free(callData);
+		
+	return(status);
+}
+
+
+
+//=============================================================================
+//      CC3OSXController_GetTrackerPositionAsync : Non-blocking
+//				CC3OSXController_GetTrackerPosition.
+//-----------------------------------------------------------------------------
+TQ3Status
+CC3OSXController_GetTrackerPositionAsync(TQ3ControllerRef controllerRef, TC3PositionCompletionProc completionProc, void *userData)
+{
+	TQ3Status 			status = kQ3Failure;
+	TC3AsyncCallDataPtr	callData;
+	CFMutableDictionaryRef dict;
+	
+	callData = CC3OSXController_NewCallData(controllerRef, userData);
+	if (callData==NULL)
+		return(status);
+	callData->positionProc = completionProc;
+	
+	//create dictionary
+	dict = CFDictionaryCreateMutable(	kCFAllocatorDefault,0,
+										&kCFTypeDictionaryKeyCallBacks,
+										&kCFTypeDictionaryValueCallBacks);
+	if (dict)
+	{
+		//Put parameters into dict
+		//controllerRef
+		IPCPutControllerRef(dict, CFSTR(k3CtrlRef), &controllerRef);
 		
 		//try sending
-		status = IPCControllerDriver_Send(m3Controller_GetValues,dict,&returnDict);
+		status = CC3OSXController_SendAsync(m3Controller_GetTrackerPosition, dict, CC3OSXController_PositionCompletion, callData);
 		
-		if (status!=kQ3Failure)
-		{
-			//Get result from returnDict
-			//privValueCount
-			result = IPCGetTQ3Uns32(returnDict, CFSTR(k3PrivValueCount), &privValueCount);
-						
-			//serialNumber
-			result = IPCGetTQ3Uns32(returnDict, CFSTR(k3SerNum), &tempSerNum);
-						
-			//active (here: helper variable)
-			result = IPCGetTQ3Boolean(returnDict, CFSTR(k3Active), &active);
-			if (active)
-			{
-				//serialNumber NULL or not
-				if (serialNumber==NULL)
-				{
-					if (privValueCount>0)
-					{
-						TQ3Uns32	maxCount,index;
-						if (privValueCount > valueCount)
-							maxCount=valueCount;
-						else
-							maxCount=privValueCount;
-						
-						CFArrayRef valAr = (CFArrayRef)CFDictionaryGetValue(dict,CFSTR(k3Values));
-						if (valAr!=NULL)
-							for (index=0; index<maxCount; index++)
-								result = CFNumberGetValue(	(CFNumberRef)CFArrayGetValueAtIndex(valAr,index),
-															kCFNumberFloatType,
-															&values[index]);
-						// CFRelease(valAr);
-					}
-					
-					if (changed!=NULL)		
-						*changed=kQ3True;
-				}
-				else
-				{
-					if (*serialNumber!=tempSerNum)
-					{
-						if (privValueCount>0)
-						{
-							TQ3Uns32	maxCount,index;
-							if (privValueCount > valueCount)
-								maxCount=valueCount;
-							else
-								maxCount=privValueCount;
-							
-							CFArrayRef valAr = (CFArrayRef)CFDictionaryGetValue(dict,CFSTR(k3Values));
-							if (valAr!=NULL)
-								for (index=0; index<maxCount; index++)
-									result = CFNumberGetValue(	(CFNumberRef)CFArrayGetValueAtIndex(valAr,index),
-																kCFNumberFloatType,
-																&values[index]);
-							// CFRelease(valAr);
-						}
-							
-						if (changed!=NULL)		
-							*changed=kQ3True;
-					}
-					else
-						if (changed!=NULL)		
-							*changed=kQ3False;
-				}
-			}
-			
-			if (serialNumber!=NULL)
-				if (*serialNumber!=tempSerNum)
-					*serialNumber = tempSerNum;
-																								
-			//Get status from returnDict
-			result = IPCGetTQ3Uns32(returnDict, CFSTR(k3Status), (TQ3Uns32*)&status);
-		};
 		//Do clean up
 		CFRelease(dict);
-		
-		if (returnDict)
-			CFRelease(returnDict);
 	}
+	else
+		free(callData);
+		
 	return(status);
 }
 
 
 
-
-
 //=============================================================================
-//      CC3OSXController_SetValues : One-line description of the method.
-//-----------------------------------------------------------------------------
-//		Note : More detailed comments can be placed here if required.
-//
-// Deviation from Apple-doc: Controller serialNumber is incremented!
-// used on Server/Driver Side
+//      CC3OSXController_GetTrackerOrientationAsync : Non-blocking
+//				CC3OSXController_GetTrackerOrientation.
 //-----------------------------------------------------------------------------
 TQ3Status
-CC3OSXController_SetValues(TQ3ControllerRef controllerRef, const float *values, TQ3Uns32 valueCount)
+CC3OSXController_GetTrackerOrientationAsync(TQ3ControllerRef controllerRef, TC3OrientationCompletionProc completionProc, void *userData)
 {
-	TQ3Status status = kQ3Failure;
-	CFMutableDictionaryRef dict,returnDict;
+	TQ3Status 			status = kQ3Failure;
+	TC3AsyncCallDataPtr	callData;
+	CFMutableDictionaryRef dict;
 	
-	Boolean		result;
-	TQ3Uns32 	index;
+	callData = CC3OSXController_NewCallData(controllerRef, userData);
+	if (callData==NULL)
+		return(status);
+	callData->orientationProc = completionProc;
 	
 	//create dictionary
 	dict = CFDictionaryCreateMutable(	kCFAllocatorDefault,0,
@@ -1873,56 +3541,24 @@ CC3OSXController_SetValues(TQ3ControllerRef controllerRef, const float *values,
 	{
 		//Put parameters into dict
 		//controllerRef
-		result = IPCPutControllerRef(dict, CFSTR(k3CtrlRef), &controllerRef);
-		
-		//valueCount
-		if (valueCount>kQ3MaxControllerValues) 
-			valueCount = kQ3MaxControllerValues;
-		result = IPCPutTQ3Uns32(dict, CFSTR(k3ValueCount), &valueCount);
-				
-		//values
-		CFNumberRef *valuesInput = (CFNumberRef*)malloc(valueCount*sizeof(CFNumberRef));
-		for (index=0; index<valueCount; index++)
-			valuesInput[index]= CFNumberCreate(kCFAllocatorDefault,kCFNumberFloatType,&values[index]);
-		CFArrayRef valuesRef = CFArrayCreate(kCFAllocatorDefault,(const void**)valuesInput,valueCount,&kCFTypeArrayCallBacks);
-		for (index=0; index<valueCount; index++)
-			CFRelease(valuesInput[index]);
-		free(valuesInput);
-		CFDictionarySetValue(dict,CFSTR(k3Values),valuesRef);
-		CFRelease(valuesRef);
+		IPCPutControllerRef(dict, CFSTR(k3CtrlRef), &controllerRef);
 		
 		//try sending
-		status = IPCControllerDriver_Send(m3Controller_SetValues,dict,&returnDict);
-		if (status!=kQ3Failure)
-		{
-			//Get status from returnDict
-			result = IPCGetTQ3Uns32(returnDict, CFSTR(k3Status), (TQ3Uns32*)&status);
-		};
+		status = CC3OSXController_SendAsync(m3Controller_GetTrackerOrientation, dict, CC3OSXController_OrientationCompletion, callData);
+		
 		//Do clean up
 		CFRelease(dict);
-		
-		if (returnDict)
-			CFRelease(returnDict);
 	}
+	else
+		free(callData);
+		
 	return(status);
 }
 
 #pragma mark -
 
-TQ3Status CC3OSXTracker_tryCall_notification_local(TQ3ControllerRef controllerRef,CFUUIDRef trackerUUID)
+TQ3Status CC3OSXTracker_tryCall_notification_local(TQ3ControllerRef controllerRef,TC3TrackerInstanceDataPtr theTrackerInstance)
 {
-	TC3TrackerInstanceDataPtr 	theTrackerInstance;
-	
-	
-	CFStringRef TrackerUUIDkey = CFUUIDCreateString(kCFAllocatorDefault,trackerUUID);
-		
-	CFDataGetBytes(	(CFDataRef)CFDictionaryGetValue(ClientTrackers,TrackerUUIDkey),//ClientTrackers is global!
-											CFRangeMake(0,sizeof(TC3TrackerInstanceDataPtr)),
-											(UInt8*)&theTrackerInstance);
-											
-	if (TrackerUUIDkey)
-		CFRelease(TrackerUUIDkey);
-	
 	if (theTrackerInstance!=NULL)
 	{
 		if (theTrackerInstance->theNotifyFunc!=NULL)
@@ -2164,19 +3800,16 @@ CFDataRef IPCTracker_Dispatcher ( CFMessagePortRef local, SInt32 msgid, CFDataRe
 	
 	if (returnDict)
 	{
-		//get TrackerInstanceData from dictionary
-		//trackerUUID - may be NULL, if key wasn't found in the dictionary				
-		CFStringRef	trackerUUID = (CFStringRef)CFDictionaryGetValue(dict,CFSTR(k3TrackerUUID));//bug?
+		//get TrackerInstanceData from handle
+		TQ3Uns32					trackerHandle = kIPCHandleNone;
+		TC3TrackerInstanceDataPtr 	trackerInstance = NULL;
+		
+		if (CFDictionaryGetValue(dict,CFSTR(k3TrackerHandle))!=NULL)
+			IPCGetTQ3Uns32(dict,CFSTR(k3TrackerHandle),&trackerHandle);
+		trackerInstance = (TC3TrackerInstanceDataPtr)IPCHandle_Lookup(&ClientTrackers,trackerHandle);
 		
-		if (trackerUUID)
+		if (trackerInstance)
 		{
-			TC3TrackerInstanceDataPtr 	trackerInstance;
-			
-			/*CFDataGetBytes(	CFDictionaryGetValue(ClientTrackers,trackerUUID),//ClientTrackers is global!
-							CFRangeMake(0,sizeof(TC3TrackerInstanceDataPtr)),
-							(UInt8*)&trackerInstance);*/
-			IPCGetBytes(ClientTrackers,trackerUUID,sizeof(TC3TrackerInstanceDataPtr),&trackerInstance);				
-			
 			//Dispatch msgid to local functions
 			switch(msgid)
 			{
@@ -2227,27 +3860,17 @@ CFDataRef IPCTracker_Dispatcher ( CFMessagePortRef local, SInt32 msgid, CFDataRe
 	return returnData;
 };
 
-void IPCTracker_Insert(CFMutableDictionaryRef* 	trackersDict, const TC3TrackerInstanceDataPtr theTrackerInstanceData)
+TQ3Uns32 IPCTracker_Insert(const TC3TrackerInstanceDataPtr theTrackerInstanceData)
 {
-	CFMutableDictionaryRef dict = *trackersDict;
-	
-	if(dict==NULL)
+	if(TrackerServerPort==NULL)
 	{
-		//create dictionary
-		dict = CFDictionaryCreateMutable(	kCFAllocatorDefault,0,
-											&kCFTypeDictionaryKeyCallBacks,
-											&kCFTypeDictionaryValueCallBacks);
-											
-		*trackersDict = dict;									
 		//create an unique name representing the client process and its messageport
-		CFMutableStringRef TrackerPortName = CFStringCreateMutable (kCFAllocatorDefault,0);
-		CFStringAppend(TrackerPortName,CFSTR(kQuesa3DeviceTracker));
-		CFStringAppend(TrackerPortName,CFSTR("."));
+		CFMutableStringRef PortName = CFStringCreateMutable (kCFAllocatorDefault,0);
+		CFStringAppend(PortName,CFSTR(kQuesa3DeviceTracker));
+		CFStringAppend(PortName,CFSTR("."));
 		CFUUIDRef ClientUUID = CFUUIDCreate(kCFAllocatorDefault);
 		CFStringRef ClientUUIDString = CFUUIDCreateString(kCFAllocatorDefault,ClientUUID);
-		CFStringAppend(TrackerPortName,ClientUUIDString);
-		//insert to dictionary
-		CFDictionarySetValue(dict,CFSTR(k3TrackerPortName),TrackerPortName);
+		CFStringAppend(PortName,ClientUUIDString);
 		
 		//create messageport for callbacks to tracker objects
 		CFMessagePortContext	context;
@@ -2258,51 +3881,29 @@ void IPCTracker_Insert(CFMutableDictionaryRef* 	trackersDict, const TC3TrackerIn
 		context.release = NULL;
 		context.copyDescription = NULL;
 	
-		TrackerServerPort = CFMessagePortCreateLocal(NULL, TrackerPortName, IPCTracker_Dispatcher, &context, NULL);
+		TrackerServerPort = CFMessagePortCreateLocal(NULL, PortName, IPCTracker_Dispatcher, &context, NULL);
 		TrackerRunLoopSource = CFMessagePortCreateRunLoopSource(NULL, TrackerServerPort, 0);
 		CFRunLoopAddSource(CFRunLoopGetCurrent(), TrackerRunLoopSource, kCFRunLoopDefaultMode);
+		TrackerPortName = PortName;//keeps the reference
+		
 		//do clean up
-		if (TrackerPortName)
-			CFRelease(TrackerPortName);
 		if (ClientUUID)
 			CFRelease(ClientUUID);
 		if (ClientUUIDString)
 			CFRelease(ClientUUIDString);
 	}
 	
-	//insert theInstanceData to dictionary
-	//key is UUID inside theInstanceData
-	CFStringRef TrackerUUIDkey = CFUUIDCreateString(kCFAllocatorDefault, theTrackerInstanceData->trackerUUID);
-	//value is theTrackerObject itself (theInstanceData is a pointer)
-	CFDataRef TrackerObjectRef = CFDataCreate(	kCFAllocatorDefault,
-												(UInt8*)&theTrackerInstanceData,
-												sizeof(TC3TrackerInstanceDataPtr));
-	
-	CFDictionarySetValue(dict,TrackerUUIDkey,TrackerObjectRef);
-	
-	//do clean up
-	if (TrackerObjectRef)
-		CFRelease(TrackerObjectRef);
-	if (TrackerUUIDkey)
-		CFRelease(TrackerUUIDkey);
-	
-	return;
+	//insert theInstanceData to handle table; the handle goes on the wire
+	return(IPCHandle_Insert(&ClientTrackers, theTrackerInstanceData));
 }
 
-void IPCTracker_Remove(CFMutableDictionaryRef 	dict,const TC3TrackerInstanceDataPtr theInstanceData)
+void IPCTracker_Remove(const TC3TrackerInstanceDataPtr theInstanceData)
 {
-#warning IPCTracker_Remove to be completed...
-	//remove theInstanceData from dictionary
-	//key is UUID inside theInstanceData
-	CFStringRef TrackerUUIDkey = CFUUIDCreateString(kCFAllocatorDefault,theInstanceData->trackerUUID);
-	
-	CFDictionaryRemoveValue(dict,TrackerUUIDkey);
-	
-	if (TrackerUUIDkey)
-		CFRelease(TrackerUUIDkey);
+	//remove theInstanceData from handle table; pending messages for it will find nothing
+	IPCHandle_Remove(&ClientTrackers, theInstanceData->trackerHandle);
+	theInstanceData->trackerHandle = kIPCHandleNone;
 	
 	//the last tracker is removed! Questions:
-	//what happens to dict?
 	//what happens to TrackerServerPort?
 	//Who does cleanup of everything used by the IPCTracker-functions? A custom exit-handler? Consider usage of atexit !
 	/*
@@ -2329,17 +3930,37 @@ CC3OSXTracker_New(TQ3Object theObject, TQ3TrackerNotifyFunc notifyFunc)
 	if (theInstanceData==NULL) 
 		return NULL;
 		
-	theInstanceData->eventsRingBuffer = CFArrayCreateMutable(kCFAllocatorDefault,10,&kCFTypeArrayCallBacks);	
+	if (CC3EventRing_Init(&theInstanceData->events,kC3TrackerDefaultEventCapacity)==kQ3Failure)
+	{
+		free(theInstanceData);
+		return NULL;
+	}
+	theInstanceData->eventsMaxExtrapolation = kC3TrackerDefaultMaxExtrapolation;
 	
 	theInstanceData->posThreshold = 0.0;
 	theInstanceData->oriThreshold = 0.0;
+	theInstanceData->oriThresholdCos = CC3Quaternion_AngleThresholdCos(0.0f);
+	
+	theInstanceData->predictor.mode = kC3TrackerPredictionNone;
+	theInstanceData->predictor.minCutoff = kC3TrackerDefaultMinCutoff;
+	theInstanceData->predictor.beta = 0.0f;
+	theInstanceData->predictor.maxLead = kC3TrackerDefaultMaxLead;
+	theInstanceData->predictor.posPrimed = kQ3False;
+	theInstanceData->predictor.oriPrimed = kQ3False;
 	
 	//create UUID and add to theInstanceData;
-	//UUID will later be key for ClientTracker dictionary
+	//UUID identifies the tracker outside of this process only
 	theInstanceData->trackerUUID = CFUUIDCreate(kCFAllocatorDefault);
 	
 	//do bookkeeping for IPCTrackerDispatcher
-	IPCTracker_Insert(&ClientTrackers, theInstanceData);
+	theInstanceData->trackerHandle = IPCTracker_Insert(theInstanceData);
+	if (theInstanceData->trackerHandle==kIPCHandleNone)
+	{
+		CFRelease(theInstanceData->trackerUUID);
+		CC3EventRing_Dispose(&theInstanceData->events);
+		free(theInstanceData);
+		return NULL;
+	}
 	
 	if (notifyFunc!=NULL)
 		theInstanceData->theNotifyFunc = notifyFunc;
@@ -2397,9 +4018,11 @@ TC3TrackerInstanceDataPtr
 CC3OSXTracker_Delete(TC3TrackerInstanceDataPtr trackerObject)
 {
 	//do bookkeeping for IPCTrackerDispatcher
-	IPCTracker_Remove(ClientTrackers,trackerObject);
+	IPCTracker_Remove(trackerObject);
+	
+	CFRelease(trackerObject->trackerUUID);
 	
-	CFRelease(trackerObject->eventsRingBuffer);
+	CC3EventRing_Dispose(&trackerObject->events);
 	
 	free (trackerObject);
 	return(NULL);
@@ -2415,6 +4038,7 @@ CC3OSXTracker_SetNotifyThresholds(TC3TrackerInstanceDataPtr trackerObject, float
 {
 	trackerObject->posThreshold = positionThresh;
 	trackerObject->oriThreshold = orientationThresh;
+	trackerObject->oriThresholdCos = CC3Quaternion_AngleThresholdCos(orientationThresh);
 	return(kQ3Success);
 }
 
@@ -2440,6 +4064,296 @@ CC3OSXTracker_GetNotifyThresholds(TC3TrackerInstanceDataPtr trackerObject, float
 
 
 
+/*
+CC3OSXTracker_FeedPosition/CC3OSXTracker_FeedOrientation:
+-update the predictor with the current pose of the tracker
+-a sample closer than kC3TrackerMinFeedInterval to the last fed one replaces it:
+ the update is redone from the state before that sample, so a burst of moves
+ yields no velocity spike and the latest pose is never held back
+*/
+static void
+CC3OSXTracker_FeedPosition(TC3TrackerInstanceDataPtr trackerObject)
+{
+	TC3TrackerPredictor	*predictor = &trackerObject->predictor;
+	CFAbsoluteTime		now;
+	float				dt, alpha, speed;
+	TQ3Vector3D			rawVelocity;
+	
+	if (predictor->mode==kC3TrackerPredictionNone)
+		return;
+	
+	now = CFAbsoluteTimeGetCurrent();
+	
+	if (predictor->posPrimed==kQ3False)
+	{
+		predictor->posPrimed = kQ3True;
+		predictor->posTime = now;
+		predictor->lastPosition = trackerObject->thePosition;
+		predictor->filteredPosition = trackerObject->thePosition;
+		predictor->velocity.x = predictor->velocity.y = predictor->velocity.z = 0.0f;
+		predictor->posHasPrevious = kQ3False;
+		return;
+	}
+	
+	if (now - predictor->posTime < kC3TrackerMinFeedInterval)
+	{
+		//only the priming sample to replace: take the pose, keep its time
+		if (predictor->posHasPrevious==kQ3False)
+		{
+			predictor->lastPosition = trackerObject->thePosition;
+			predictor->filteredPosition = trackerObject->thePosition;
+			return;
+		}
+		
+		predictor->posTime = predictor->prevPosTime;
+		predictor->lastPosition = predictor->prevLastPosition;
+		predictor->filteredPosition = predictor->prevFilteredPosition;
+		predictor->velocity = predictor->prevVelocity;
+	}
+	
+	predictor->posHasPrevious = kQ3True;
+	predictor->prevPosTime = predictor->posTime;
+	predictor->prevLastPosition = predictor->lastPosition;
+	predictor->prevFilteredPosition = predictor->filteredPosition;
+	predictor->prevVelocity = predictor->velocity;
+	
+	dt = (float)(now - predictor->posTime);
+	rawVelocity.x = (trackerObject->thePosition.x - predictor->lastPosition.x) / dt;
+	rawVelocity.y = (trackerObject->thePosition.y - predictor->lastPosition.y) / dt;
+	rawVelocity.z = (trackerObject->thePosition.z - predictor->lastPosition.z) / dt;
+	
+	if (predictor->mode==kC3TrackerPredictionOneEuro)
+	{
+		//smooth the velocity, then let its magnitude open the cutoff of the position filter
+		alpha = CC3OneEuro_Alpha(kC3TrackerDerivateCutoff,dt);
+		predictor->velocity.x += alpha*(rawVelocity.x - predictor->velocity.x);
+		predictor->velocity.y += alpha*(rawVelocity.y - predictor->velocity.y);
+		predictor->velocity.z += alpha*(rawVelocity.z - predictor->velocity.z);
+		
+		speed = (float) sqrt(predictor->velocity.x*predictor->velocity.x + predictor->velocity.y*predictor->velocity.y + predictor->velocity.z*predictor->velocity.z);
+		alpha = CC3OneEuro_Alpha(predictor->minCutoff + predictor->beta*speed,dt);
+		predictor->filteredPosition.x += alpha*(trackerObject->thePosition.x - predictor->filteredPosition.x);
+		predictor->filteredPosition.y += alpha*(trackerObject->thePosition.y - predictor->filteredPosition.y);
+		predictor->filteredPosition.z += alpha*(trackerObject->thePosition.z - predictor->filteredPosition.z);
+	}
+	else
+	{
+		predictor->velocity = rawVelocity;
+		predictor->filteredPosition = trackerObject->thePosition;
+	}
+	
+	predictor->posTime = now;
+	predictor->lastPosition = trackerObject->thePosition;
+}
+
+static void
+CC3OSXTracker_FeedOrientation(TC3TrackerInstanceDataPtr trackerObject)
+{
+	TC3TrackerPredictor	*predictor = &trackerObject->predictor;
+	CFAbsoluteTime		now;
+	float				dt, alpha, speed;
+	TQ3Quaternion		inverse, step;
+	TQ3Vector3D			rawVelocity;
+	
+	if (predictor->mode==kC3TrackerPredictionNone)
+		return;
+	
+	now = CFAbsoluteTimeGetCurrent();
+	
+	if (predictor->oriPrimed==kQ3False)
+	{
+		predictor->oriPrimed = kQ3True;
+		predictor->oriTime = now;
+		predictor->lastOrientation = trackerObject->theOrientation;
+		predictor->filteredOrientation = trackerObject->theOrientation;
+		predictor->angularVelocity.x = predictor->angularVelocity.y = predictor->angularVelocity.z = 0.0f;
+		predictor->oriHasPrevious = kQ3False;
+		return;
+	}
+	
+	if (now - predictor->oriTime < kC3TrackerMinFeedInterval)
+	{
+		//only the priming sample to replace: take the pose, keep its time
+		if (predictor->oriHasPrevious==kQ3False)
+		{
+			predictor->lastOrientation = trackerObject->theOrientation;
+			predictor->filteredOrientation = trackerObject->theOrientation;
+			return;
+		}
+		
+		predictor->oriTime = predictor->prevOriTime;
+		predictor->lastOrientation = predictor->prevLastOrientation;
+		predictor->filteredOrientation = predictor->prevFilteredOrientation;
+		predictor->angularVelocity = predictor->prevAngularVelocity;
+	}
+	
+	predictor->oriHasPrevious = kQ3True;
+	predictor->prevOriTime = predictor->oriTime;
+	predictor->prevLastOrientation = predictor->lastOrientation;
+	predictor->prevFilteredOrientation = predictor->filteredOrientation;
+	predictor->prevAngularVelocity = predictor->angularVelocity;
+	
+	//step rotates lastOrientation into theOrientation, in the order MoveOrientation applies deltas
+	inverse.w =  predictor->lastOrientation.w;
+	inverse.x = -predictor->lastOrientation.x;
+	inverse.y = -predictor->lastOrientation.y;
+	inverse.z = -predictor->lastOrientation.z;
+	CC3Quaternion_Multiply(&trackerObject->theOrientation,&inverse,&step);
+	
+	dt = (float)(now - predictor->oriTime);
+	CC3Quaternion_ToRotationVector(&step,&rawVelocity);
+	rawVelocity.x /= dt;
+	rawVelocity.y /= dt;
+	rawVelocity.z /= dt;
+	
+	if (predictor->mode==kC3TrackerPredictionOneEuro)
+	{
+		alpha = CC3OneEuro_Alpha(kC3TrackerDerivateCutoff,dt);
+		predictor->angularVelocity.x += alpha*(rawVelocity.x - predictor->angularVelocity.x);
+		predictor->angularVelocity.y += alpha*(rawVelocity.y - predictor->angularVelocity.y);
+		predictor->angularVelocity.z += alpha*(rawVelocity.z - predictor->angularVelocity.z);
+		
+		speed = (float) sqrt(predictor->angularVelocity.x*predictor->angularVelocity.x + predictor->angularVelocity.y*predictor->angularVelocity.y + predictor->angularVelocity.z*predictor->angularVelocity.z);
+		alpha = CC3OneEuro_Alpha(predictor->minCutoff + predictor->beta*speed,dt);
+		CC3Quaternion_SlerpArray(1,&predictor->filteredOrientation,&trackerObject->theOrientation,&alpha,&predictor->filteredOrientation);
+	}
+	else
+	{
+		predictor->angularVelocity = rawVelocity;
+		predictor->filteredOrientation = trackerObject->theOrientation;
+	}
+	
+	predictor->oriTime = now;
+	predictor->lastOrientation = trackerObject->theOrientation;
+}
+
+
+
+
+
+//=============================================================================
+//      CC3OSXTracker_SetPredictionParams : Configure the pose predictor.
+//-----------------------------------------------------------------------------
+//		Note : kC3TrackerPredictionConstantVelocity extrapolates the latest
+//				pose with the velocity between the last two updates.
+//				kC3TrackerPredictionOneEuro smoothes pose and velocity first;
+//				minCutoff (Hz) sets the smoothing at rest, beta how fast it
+//				opens up with speed. Predictions reach at most maxLead
+//				seconds beyond the latest update.
+//
+//				Changing parameters restarts the predictor.
+//-----------------------------------------------------------------------------
+TQ3Status
+CC3OSXTracker_SetPredictionParams(TC3TrackerInstanceDataPtr trackerObject, TC3TrackerPredictionMode mode, float minCutoff, float beta, float maxLead)
+{
+	if ((mode!=kC3TrackerPredictionNone) && (mode!=kC3TrackerPredictionConstantVelocity) && (mode!=kC3TrackerPredictionOneEuro))
+		return(kQ3Failure);
+	
+	if ((minCutoff<=0.0f) || (beta<0.0f) || (maxLead<0.0f))
+		return(kQ3Failure);
+	
+	trackerObject->predictor.mode = mode;
+	trackerObject->predictor.minCutoff = minCutoff;
+	trackerObject->predictor.beta = beta;
+	trackerObject->predictor.maxLead = maxLead;
+	trackerObject->predictor.posPrimed = kQ3False;
+	trackerObject->predictor.oriPrimed = kQ3False;
+	
+	//start from the current pose
+	CC3OSXTracker_FeedPosition(trackerObject);
+	CC3OSXTracker_FeedOrientation(trackerObject);
+	return(kQ3Success);
+}
+
+
+
+
+
+//=============================================================================
+//      CC3OSXTracker_GetPredictionParams : Get the predictor configuration.
+//-----------------------------------------------------------------------------
+TQ3Status
+CC3OSXTracker_GetPredictionParams(TC3TrackerInstanceDataPtr trackerObject, TC3TrackerPredictionMode *mode, float *minCutoff, float *beta, float *maxLead)
+{
+	if (mode!=NULL)
+		*mode = trackerObject->predictor.mode;
+	if (minCutoff!=NULL)
+		*minCutoff = trackerObject->predictor.minCutoff;
+	if (beta!=NULL)
+		*beta = trackerObject->predictor.beta;
+	if (maxLead!=NULL)
+		*maxLead = trackerObject->predictor.maxLead;
+	return(kQ3Success);
+}
+
+
+
+
+
+//=============================================================================
+//      CC3OSXTracker_GetPredictedPose : Pose of the tracker predicted to
+//				targetTime, e.g. the next display refresh.
+//-----------------------------------------------------------------------------
+//		Note : Without a predictor the current pose is returned. Neither the
+//				accumulated deltas nor the serial numbers are touched.
+//				position or orientation may be NULL.
+//-----------------------------------------------------------------------------
+TQ3Status
+CC3OSXTracker_GetPredictedPose(TC3TrackerInstanceDataPtr trackerObject, CFAbsoluteTime targetTime, TQ3Point3D *position, TQ3Quaternion *orientation)
+{
+	TC3TrackerPredictor	*predictor = &trackerObject->predictor;
+	float				lead;
+	
+	if (trackerObject->isActive==kQ3False)
+		return(kQ3Failure);
+	
+	if (position!=NULL)
+	{
+		*position = trackerObject->thePosition;
+		if ((predictor->mode!=kC3TrackerPredictionNone) && (predictor->posPrimed==kQ3True))
+		{
+			lead = (float)(targetTime - predictor->posTime);
+			if (lead<0.0f)
+				lead = 0.0f;
+			if (lead>predictor->maxLead)
+				lead = predictor->maxLead;
+			
+			position->x = predictor->filteredPosition.x + lead*predictor->velocity.x;
+			position->y = predictor->filteredPosition.y + lead*predictor->velocity.y;
+			position->z = predictor->filteredPosition.z + lead*predictor->velocity.z;
+		}
+	}
+	
+	if (orientation!=NULL)
+	{
+		*orientation = trackerObject->theOrientation;
+		if ((predictor->mode!=kC3TrackerPredictionNone) && (predictor->oriPrimed==kQ3True))
+		{
+			TQ3Vector3D		rotation;
+			TQ3Quaternion	step;
+			
+			lead = (float)(targetTime - predictor->oriTime);
+			if (lead<0.0f)
+				lead = 0.0f;
+			if (lead>predictor->maxLead)
+				lead = predictor->maxLead;
+			
+			rotation.x = lead*predictor->angularVelocity.x;
+			rotation.y = lead*predictor->angularVelocity.y;
+			rotation.z = lead*predictor->angularVelocity.z;
+			CC3Quaternion_FromRotationVector(&rotation,&step);
+			CC3Quaternion_Multiply(&step,&predictor->filteredOrientation,orientation);
+		}
+	}
+	
+	return(kQ3Success);
+}
+
+
+
+
+
+
 //=============================================================================
 //      CC3OSXTracker_SetActivation : One-line description of the method.
 //-----------------------------------------------------------------------------
@@ -2508,7 +4422,7 @@ CC3OSXTracker_ChangeButtons(TC3TrackerInstanceDataPtr trackerObject, TQ3Controll
 	//trackerObject->theSerialNum++;	//would make sense; see "activation count" inside Apple QD3D doc
 	
 	if (trackerObject->isActive==kQ3True)
-		CC3OSXTracker_tryCall_notification_local(controllerRef,trackerObject->trackerUUID);
+		CC3OSXTracker_tryCall_notification_local(controllerRef,trackerObject);
 		
 	return(kQ3Success);
 }
@@ -2624,11 +4538,13 @@ CC3OSXTracker_SetPosition(TC3TrackerInstanceDataPtr trackerObject, TQ3Controller
 		
 		//trackerObject->theSerialNum++;	
 		trackerObject->posSerialNum++;	
+		
+		CC3OSXTracker_FeedPosition(trackerObject);
 					
 		//regard posThreshold!!
 		float Threshold = trackerObject->posThreshold;
 		if ( (fabs(deltaPosition.x)>=Threshold) || (fabs(deltaPosition.y)>=Threshold) || (fabs(deltaPosition.z)>=Threshold))
-			CC3OSXTracker_tryCall_notification_local(controllerRef,trackerObject->trackerUUID);
+			CC3OSXTracker_tryCall_notification_local(controllerRef,trackerObject);
 	}
 
 	return(kQ3Success);
@@ -2658,11 +4574,13 @@ CC3OSXTracker_MovePosition(TC3TrackerInstanceDataPtr trackerObject, TQ3Controlle
 		
 		//trackerObject->theSerialNum++;	
 		trackerObject->posSerialNum++;	
+		
+		CC3OSXTracker_FeedPosition(trackerObject);
 					
 		//regard posThreshold!!
 		float Threshold = trackerObject->posThreshold;
 		if ( (fabsf(delta->x)>=Threshold) || (fabsf(delta->y)>=Threshold) || (fabsf(delta->z)>=Threshold))
-			CC3OSXTracker_tryCall_notification_local(controllerRef,trackerObject->trackerUUID);
+			CC3OSXTracker_tryCall_notification_local(controllerRef,trackerObject);
 	}
 
 	return(kQ3Success);
@@ -2765,12 +4683,10 @@ CC3OSXTracker_SetOrientation(TC3TrackerInstanceDataPtr trackerObject, TQ3Control
 		//Set tracker orientation to new orientation
 		trackerObject->theOrientation=*orientation;
 		
-		//calculate delta angle between new and old orientation
+		//delta rotation between new and old orientation
 		TQ3Quaternion 	temp_quat;
-		float			Angle;
 		
 		CC3Quaternion_Multiply(orientation,&trackerObject->accuOrientation,&temp_quat);
-		CC3Quaternion_GetAngle(&temp_quat,&Angle);				
 		
 		//Set tracker orientation accumulator to new orientation
 		trackerObject->accuOrientation=*orientation;
@@ -2778,10 +4694,11 @@ CC3OSXTracker_SetOrientation(TC3TrackerInstanceDataPtr trackerObject, TQ3Control
 		//trackerObject->theSerialNum++;
 		trackerObject->oriSerialNum++;
 		
+		CC3OSXTracker_FeedOrientation(trackerObject);
+		
 		//regard oriThreshold!!
-		float Threshold = trackerObject->oriThreshold;
-		if (fabsf(Angle)>=Threshold)
-			CC3OSXTracker_tryCall_notification_local(controllerRef,trackerObject->trackerUUID);
+		if (CC3Quaternion_ReachesAngle(&temp_quat,trackerObject->oriThresholdCos)==kQ3True)
+			CC3OSXTracker_tryCall_notification_local(controllerRef,trackerObject);
 	}
 	
 	return(kQ3Success);
@@ -2801,23 +4718,26 @@ CC3OSXTracker_MoveOrientation(TC3TrackerInstanceDataPtr trackerObject, TQ3Contro
 {
 	if (trackerObject->isActive==kQ3True)
 	{
-		//Quaternion trackerObject->accuOrientation multiplied with Quaternion delta
-		CC3Quaternion_Multiply(delta,&trackerObject->accuOrientation,&trackerObject->accuOrientation);
+		//Quaternions trackerObject->accuOrientation and trackerObject->theOrientation
+		//multiplied with Quaternion delta, in one batch
+		TQ3Quaternion	deltas[2];
+		TQ3Quaternion	orientations[2];
 		
-		//Quaternion trackerObject->theOrientation multiplied with Quaternion delta
-		CC3Quaternion_Multiply(delta,&trackerObject->theOrientation,&trackerObject->theOrientation);
+		deltas[0] = deltas[1] = *delta;
+		orientations[0] = trackerObject->accuOrientation;
+		orientations[1] = trackerObject->theOrientation;
+		CC3Quaternion_MultiplyArray(2,deltas,orientations,orientations);
+		trackerObject->accuOrientation = orientations[0];
+		trackerObject->theOrientation = orientations[1];
 		
 		//trackerObject->theSerialNum++;
 		trackerObject->oriSerialNum++;
-	
-		//delta to radians!!
-		float			Angle;		
-		CC3Quaternion_GetAngle(delta,&Angle);
 		
-		//regard oriThreshold!!
-		float Threshold = trackerObject->oriThreshold;
-		if (fabsf(Angle)>=Threshold)
-			CC3OSXTracker_tryCall_notification_local(controllerRef,trackerObject->trackerUUID);
+		CC3OSXTracker_FeedOrientation(trackerObject);
+	
+		//regard oriThreshold!! compared without converting delta to radians
+		if (CC3Quaternion_ReachesAngle(delta,trackerObject->oriThresholdCos)==kQ3True)
+			CC3OSXTracker_tryCall_notification_local(controllerRef,trackerObject);
 	}
 	
 	return(kQ3Success);
@@ -2826,75 +4746,69 @@ CC3OSXTracker_MoveOrientation(TC3TrackerInstanceDataPtr trackerObject, TQ3Contro
 
 
 
-CFComparisonResult CC3OSXTracker_CmpEventStamp (const void *val1, const void *val2, void *context)
+//=============================================================================
+//      CC3OSXTracker_SetEventCapacity : Set the number of events a tracker
+//				keeps for CC3OSXTracker_GetEventCoordinates.
+//-----------------------------------------------------------------------------
+//		Note : Rounded up to a power of two. On shrinking the newest events
+//				are kept.
+//-----------------------------------------------------------------------------
+TQ3Status
+CC3OSXTracker_SetEventCapacity(TC3TrackerInstanceDataPtr trackerObject, TQ3Uns32 eventCapacity)
 {
-	//ignore context;
-	
-	//typecast val1 from CFDataRef to TC3TrackerEventPtr
-	TC3TrackerEventPtr _val1 = (TC3TrackerEventPtr)CFDataGetBytePtr((CFDataRef)val1);
-	
-	//typecast val2 from CFDataRef to TC3TrackerEventPtr
-	TC3TrackerEventPtr _val2 = (TC3TrackerEventPtr)CFDataGetBytePtr((CFDataRef)val2);
-	
-	//compare val1.timeStamp with val2.timeStamp
-	CFComparisonResult _res;
-	if (_val1->EventTimeStamp < _val2->EventTimeStamp)
-		_res = kCFCompareLessThan;
-	
-	if (_val1->EventTimeStamp == _val2->EventTimeStamp)
-		_res = kCFCompareEqualTo;
-		
-	if (_val1->EventTimeStamp > _val2->EventTimeStamp)
-		_res = kCFCompareGreaterThan;
-	
-	return _res;
-};
+	return(CC3EventRing_SetCapacity(&trackerObject->events,eventCapacity));
+}
+
+
+//=============================================================================
+//      CC3OSXTracker_GetEventCapacity : Get the size of the event history.
+//-----------------------------------------------------------------------------
+TQ3Status
+CC3OSXTracker_GetEventCapacity(TC3TrackerInstanceDataPtr trackerObject, TQ3Uns32 *eventCapacity)
+{
+	*eventCapacity = trackerObject->events.capacity;
+	return(kQ3Success);
+}
 
 
 //=============================================================================
 //      CC3OSXTracker_SetEventCoordinates : One-line description of the method.
 //-----------------------------------------------------------------------------
-//		Note : More detailed comments can be placed here if required.
+//		Note : Appending is O(1); an event arriving with an older stamp than
+//				the newest one is moved into place by insertion. Once the ring
+//				is full the oldest event is dropped, or the new one if it is
+//				older than all stored events.
 //-----------------------------------------------------------------------------
 TQ3Status
 CC3OSXTracker_SetEventCoordinates(TC3TrackerInstanceDataPtr trackerObject, TQ3Uns32 timeStamp, TQ3Uns32 buttons, const TQ3Point3D *position, const TQ3Quaternion *orientation)
 {
-	//if number of events equals ten, remove oldest at 0
-	CFIndex Count = CFArrayGetCount(trackerObject->eventsRingBuffer);
-	if (Count==10)
-		CFArrayRemoveValueAtIndex(trackerObject->eventsRingBuffer,0);
-	//pack event
-	TC3TrackerEvent workEvent;
+	//find slot; identical timestamps keep their arrival order
+	TC3TrackerEventPtr	workEvent = CC3EventRing_Insert(&trackerObject->events,timeStamp);
 	
-	workEvent.EventTimeStamp=timeStamp;
-	workEvent.EventButtons=buttons;
+	if (workEvent==NULL)
+		return(kQ3Success);
+	
+	//pack event
+	workEvent->EventButtons=buttons;
 	if (position==NULL)
 	{
-		workEvent.EventPositionIsNULL=kQ3True;
+		workEvent->EventPositionIsNULL=kQ3True;
 	}
 	else
 	{
-		workEvent.EventPositionIsNULL=kQ3False;
-		workEvent.EventPosition=*position;
+		workEvent->EventPositionIsNULL=kQ3False;
+		workEvent->EventPosition=*position;
 	}
 	
 	if (orientation==NULL)
 	{
-		workEvent.EventOrientationIsNULL=kQ3True;
+		workEvent->EventOrientationIsNULL=kQ3True;
 	}
 	else
 	{
-		workEvent.EventOrientationIsNULL=kQ3False;
-		workEvent.EventOrientation=*orientation;
+		workEvent->EventOrientationIsNULL=kQ3False;
+		workEvent->EventOrientation=*orientation;
 	}
-	CFDataRef packedEventRef = CFDataCreate (kCFAllocatorDefault, (UInt8*)&workEvent,sizeof(workEvent));
-	//insert event
-	CFArrayAppendValue(trackerObject->eventsRingBuffer,packedEventRef);
-	//sort array by timestamps (identical timestamps are allowed, sorting results depend on applied sorting algorithm)
-	CFRange SortRange = CFRangeMake(0,CFArrayGetCount(trackerObject->eventsRingBuffer));
-	CFArraySortValues(trackerObject->eventsRingBuffer,SortRange,CC3OSXTracker_CmpEventStamp,NULL);
-	//clean up
-	CFRelease(packedEventRef);//just ref'counting; CFArray retained packedEventRef!
 	
 	return(kQ3Success);
 }
@@ -2904,70 +4818,191 @@ CC3OSXTracker_SetEventCoordinates(TC3TrackerInstanceDataPtr trackerObject, TQ3Un
 
 
 //=============================================================================
-//      CC3OSXTracker_GetEventCoordinates : One-line description of the method.
+//      CC3OSXTracker_InitEventCursor : Prepare a cursor for
+//				CC3OSXTracker_SampleEventCoordinates.
 //-----------------------------------------------------------------------------
-//		Note : More detailed comments can be placed here if required.
+//		Note : A cursor is owned by its consumer; any number of cursors may
+//				sample the same tracker. A stale cursor costs a bsearch, it is
+//				never wrong.
 //-----------------------------------------------------------------------------
 TQ3Status
-CC3OSXTracker_GetEventCoordinates(TC3TrackerInstanceDataPtr trackerObject, TQ3Uns32 timeStamp, TQ3Uns32 *buttons, TQ3Point3D *position, TQ3Quaternion *orientation)
+CC3OSXTracker_InitEventCursor(TC3TrackerInstanceDataPtr trackerObject, TC3TrackerEventCursor *cursor)
 {
-	TQ3Status status = kQ3Failure;
-	CFDataRef 			packedEventRef;
-	TC3TrackerEvent		searchEvent;
-	TC3TrackerEventPtr 	returnEvent;
+	cursor->eventSequence = trackerObject->events.firstSequence;
+	return(kQ3Success);
+}
+
+
+//=============================================================================
+//      CC3OSXTracker_SetEventExtrapolation : Limit how far beyond the newest
+//				event a sample may be extrapolated.
+//-----------------------------------------------------------------------------
+//		Note : In time stamp units; 0 disables extrapolation.
+//-----------------------------------------------------------------------------
+TQ3Status
+CC3OSXTracker_SetEventExtrapolation(TC3TrackerInstanceDataPtr trackerObject, TQ3Uns32 maxExtrapolation)
+{
+	trackerObject->eventsMaxExtrapolation = maxExtrapolation;
+	return(kQ3Success);
+}
+
+
+//=============================================================================
+//      CC3OSXTracker_GetEventExtrapolation : Get the extrapolation limit.
+//-----------------------------------------------------------------------------
+TQ3Status
+CC3OSXTracker_GetEventExtrapolation(TC3TrackerInstanceDataPtr trackerObject, TQ3Uns32 *maxExtrapolation)
+{
+	*maxExtrapolation = trackerObject->eventsMaxExtrapolation;
+	return(kQ3Success);
+}
+
+
+//=============================================================================
+//      CC3OSXTracker_SampleEventCoordinates : Get the pose of a tracker at
+//				sampleCount time stamps.
+//-----------------------------------------------------------------------------
+//		Note : Position is interpolated linearly, orientation by slerp between
+//				the two events bracketing each stamp. Past the newest event the
+//				last two events are extrapolated, up to the extrapolation limit.
+//				Before the oldest event the oldest pose is returned.
+//				Buttons are those of the latest event not after the stamp.
+//
+//				If only one bracketing event carries a position (orientation),
+//				that one is returned; if none does, the output is left alone.
+//
+//				The history is not modified. cursor may be NULL; stamps in
+//				ascending order make best use of it. Any output array may be
+//				NULL.
+//-----------------------------------------------------------------------------
+TQ3Status
+CC3OSXTracker_SampleEventCoordinates(TC3TrackerInstanceDataPtr trackerObject, TC3TrackerEventCursor *cursor, TQ3Uns32 sampleCount, const TQ3Uns32 *timeStamps, TQ3Uns32 *buttons, TQ3Point3D *positions, TQ3Quaternion *orientations)
+{
+	TQ3Point3D			p0[kC3TrackerSampleChunk], p1[kC3TrackerSampleChunk], pResult[kC3TrackerSampleChunk];
+	TQ3Quaternion		q0[kC3TrackerSampleChunk], q1[kC3TrackerSampleChunk], qResult[kC3TrackerSampleChunk];
+	float				u[kC3TrackerSampleChunk];
+	TQ3Boolean			hasPosition[kC3TrackerSampleChunk], hasOrientation[kC3TrackerSampleChunk];
+	TQ3Uns32			chunkStart, chunkCount, i;
+	
+	if (trackerObject->events.count==0)
+		return(kQ3Failure);
 	
-	if (0!=CFArrayGetCount(trackerObject->eventsRingBuffer))
+	for (chunkStart=0; chunkStart<sampleCount; chunkStart+=chunkCount)
 	{
-		//find Event with stamp younger than timeStamp
-		//-packetEventRef will be "search" value
-		searchEvent.EventTimeStamp = timeStamp;
-		packedEventRef = CFDataCreate (kCFAllocatorDefault, (UInt8*)&searchEvent,sizeof(searchEvent));
+		chunkCount = sampleCount-chunkStart;
+		if (chunkCount>kC3TrackerSampleChunk)
+			chunkCount = kC3TrackerSampleChunk;
 		
-		//-do bsearch
-		CFRange SearchRange	= CFRangeMake(0,CFArrayGetCount(trackerObject->eventsRingBuffer));
-		CFIndex EventIndex	= CFArrayBSearchValues(trackerObject->eventsRingBuffer,SearchRange,packedEventRef,CC3OSXTracker_CmpEventStamp,NULL);
-		CFRelease(packedEventRef);
-		
-		//Get event from EventIndex and clear buffer
-		if (EventIndex<=SearchRange.length)
+		//gather the bracketing events of every stamp
+		for (i=0; i<chunkCount; i++)
 		{
-			//-find Event closest to timestamp
-			if (EventIndex>0)
+			TQ3Uns32			timeStamp = timeStamps[chunkStart+i];
+			TQ3Uns32			count = trackerObject->events.count;
+			TQ3Uns32			below = CC3EventRing_Locate(&trackerObject->events,(cursor!=NULL) ? &cursor->eventSequence : NULL,timeStamp);
+			TC3TrackerEventPtr	eventA,eventB;
+			
+			if (below==0)
 			{
-				returnEvent = (TC3TrackerEventPtr)CFDataGetBytePtr((CFDataRef)CFArrayGetValueAtIndex(trackerObject->eventsRingBuffer,EventIndex-1));
-				TQ3Uns32 prevStamp = returnEvent->EventTimeStamp;
-				
-				returnEvent = (TC3TrackerEventPtr)CFDataGetBytePtr((CFDataRef)CFArrayGetValueAtIndex(trackerObject->eventsRingBuffer,EventIndex));
-				TQ3Uns32 foundStamp = returnEvent->EventTimeStamp;
-				
-				if ((timeStamp-prevStamp)<(foundStamp-timeStamp))
-					EventIndex--;
-			};
-			//-extract Event
-			packedEventRef = (CFDataRef)CFArrayGetValueAtIndex(trackerObject->eventsRingBuffer,EventIndex);
-			CFRetain(packedEventRef);
-			//-remove Events older than timeStamp
-			CFIndex i;
-			for (i=0;i<=EventIndex;i++)
-				CFArrayRemoveValueAtIndex(trackerObject->eventsRingBuffer,0);
-			//-extract return values
-			returnEvent = (TC3TrackerEventPtr)CFDataGetBytePtr(packedEventRef);
+				//older than history: clamp to oldest
+				eventA = eventB = CC3EventRing_At(&trackerObject->events,0);
+				u[i] = 0.0f;
+			}
+			else if (below<count)
+			{
+				//bracketed: eventA->stamp <= timeStamp < eventB->stamp
+				eventA = CC3EventRing_At(&trackerObject->events,below-1);
+				eventB = CC3EventRing_At(&trackerObject->events,below);
+				u[i] = (float)(timeStamp-eventA->EventTimeStamp) / (float)(eventB->EventTimeStamp-eventA->EventTimeStamp);
+			}
+			else if (count>1)
+			{
+				//newer than history: extrapolate from the last two events
+				eventA = CC3EventRing_At(&trackerObject->events,count-2);
+				eventB = CC3EventRing_At(&trackerObject->events,count-1);
+				if (timeStamp-eventB->EventTimeStamp > trackerObject->eventsMaxExtrapolation)
+					timeStamp = eventB->EventTimeStamp + trackerObject->eventsMaxExtrapolation;
+				if (eventB->EventTimeStamp > eventA->EventTimeStamp)
+					u[i] = (float)(timeStamp-eventA->EventTimeStamp) / (float)(eventB->EventTimeStamp-eventA->EventTimeStamp);
+				else
+					u[i] = 1.0f;
+			}
+			else
+			{
+				eventA = eventB = CC3EventRing_At(&trackerObject->events,0);
+				u[i] = 0.0f;
+			}
+			
 			if (buttons!=NULL)
-				*buttons=returnEvent->EventButtons;
-				
-			if ((position!=NULL)&&(returnEvent->EventPositionIsNULL==kQ3False))
-				*position=returnEvent->EventPosition;
-				
-			if ((orientation!=NULL)&&(returnEvent->EventOrientationIsNULL==kQ3False))
-				*orientation=returnEvent->EventOrientation;
-					
-			CFRelease(packedEventRef);
+				buttons[chunkStart+i] = ((below==0) ? eventA : CC3EventRing_At(&trackerObject->events,below-1))->EventButtons;
+			
+			//position
+			hasPosition[i] = kQ3True;
+			if ((eventA->EventPositionIsNULL==kQ3False) && (eventB->EventPositionIsNULL==kQ3False))
+			{
+				p0[i] = eventA->EventPosition;
+				p1[i] = eventB->EventPosition;
+			}
+			else if (eventA->EventPositionIsNULL==kQ3False)
+				p0[i] = p1[i] = eventA->EventPosition;
+			else if (eventB->EventPositionIsNULL==kQ3False)
+				p0[i] = p1[i] = eventB->EventPosition;
+			else
+			{
+				hasPosition[i] = kQ3False;
+				p0[i] = p1[i] = trackerObject->thePosition;
+			}
+			
+			//orientation
+			hasOrientation[i] = kQ3True;
+			if ((eventA->EventOrientationIsNULL==kQ3False) && (eventB->EventOrientationIsNULL==kQ3False))
+			{
+				q0[i] = eventA->EventOrientation;
+				q1[i] = eventB->EventOrientation;
+			}
+			else if (eventA->EventOrientationIsNULL==kQ3False)
+				q0[i] = q1[i] = eventA->EventOrientation;
+			else if (eventB->EventOrientationIsNULL==kQ3False)
+				q0[i] = q1[i] = eventB->EventOrientation;
+			else
+			{
+				hasOrientation[i] = kQ3False;
+				q0[i] = q1[i] = trackerObject->theOrientation;
+			}
+		}
+		
+		//interpolate the whole chunk
+		if (positions!=NULL)
+		{
+			CC3Point3D_LerpArray(chunkCount,p0,p1,u,pResult);
+			for (i=0; i<chunkCount; i++)
+				if (hasPosition[i]==kQ3True)
+					positions[chunkStart+i] = pResult[i];
 		}
 		
-		status=kQ3Success;
+		if (orientations!=NULL)
+		{
+			CC3Quaternion_SlerpArray(chunkCount,q0,q1,u,qResult);
+			for (i=0; i<chunkCount; i++)
+				if (hasOrientation[i]==kQ3True)
+					orientations[chunkStart+i] = qResult[i];
+		}
 	}
 	
-	return(status);
+	return(kQ3Success);
+}
+
+
+//=============================================================================
+//      CC3OSXTracker_GetEventCoordinates : One-line description of the method.
+//-----------------------------------------------------------------------------
+//		Note : Interpolated pose at timeStamp, see
+//				CC3OSXTracker_SampleEventCoordinates. Events are no longer
+//				removed; the ring drops the oldest ones as new ones arrive.
+//-----------------------------------------------------------------------------
+TQ3Status
+CC3OSXTracker_GetEventCoordinates(TC3TrackerInstanceDataPtr trackerObject, TQ3Uns32 timeStamp, TQ3Uns32 *buttons, TQ3Point3D *position, TQ3Quaternion *orientation)
+{
+	return(CC3OSXTracker_SampleEventCoordinates(trackerObject,NULL,1,&timeStamp,buttons,position,orientation));
 }
 
 
@@ -3003,10 +5038,10 @@ CC3OSXControllerState_New(TQ3Object theObject, TQ3ControllerRef theController)
 	
 			theInstanceData->myController = theController;
 			
-			//ctrlStateUUID - may be NULL, if key wasn't found in the dictionary				
-			theInstanceData->ctrlStateUUIDString = (CFStringRef)CFDictionaryGetValue(returnDict,CFSTR(k3CtrlStateUUID));//bug?
-			
-			CFRetain(theInstanceData->ctrlStateUUIDString);
+			//ctrlStateHandle - stays kIPCHandleNone, if key wasn't found in the dictionary				
+			theInstanceData->ctrlStateHandle = kIPCHandleNone;
+			if (CFDictionaryGetValue(returnDict,CFSTR(k3CtrlStateHandle))!=NULL)
+				result = IPCGetTQ3Uns32(returnDict, CFSTR(k3CtrlStateHandle), &theInstanceData->ctrlStateHandle);
 		};
 		//Do clean up
 		CFRelease(dict);
@@ -3051,8 +5086,8 @@ CC3OSXControllerState_Delete(TC3ControllerStateInstanceDataPtr ctrlStateObject)
 		//-myController
 		result = IPCPutControllerRef(dict, CFSTR(k3CtrlRef), &ctrlStateObject->myController);
 		
-		//-ctrlStateUUID 
-		CFDictionarySetValue(dict,CFSTR(k3CtrlStateUUID),ctrlStateObject->ctrlStateUUIDString);
+		//-ctrlStateHandle 
+		result = IPCPutTQ3Uns32(dict, CFSTR(k3CtrlStateHandle), &ctrlStateObject->ctrlStateHandle);
 				
 		//try sending
 		status = IPCControllerDriver_Send(m3ControllerState_Delete,dict,&returnDict);
@@ -3064,9 +5099,6 @@ CC3OSXControllerState_Delete(TC3ControllerStateInstanceDataPtr ctrlStateObject)
 			CFRelease(returnDict);
 	}
 	
-	//-free things inside instanceData
-	//release theInstanceData->ctrlStateUUIDString !?
-	
 	free (ctrlStateObject);
 	
 	return(NULL);
@@ -3098,8 +5130,8 @@ CC3OSXControllerState_SaveAndReset(TC3ControllerStateInstanceDataPtr ctrlStateOb
 		//-myController
 		result = IPCPutControllerRef(dict, CFSTR(k3CtrlRef), &ctrlStateObject->myController);
 		
-		//-ctrlStateUUID 
-		CFDictionarySetValue(dict,CFSTR(k3CtrlStateUUID), ctrlStateObject->ctrlStateUUIDString);
+		//-ctrlStateHandle 
+		result = IPCPutTQ3Uns32(dict, CFSTR(k3CtrlStateHandle), &ctrlStateObject->ctrlStateHandle);
 				
 		//try sending
 		status = IPCControllerDriver_Send(m3ControllerState_SaveAndReset, dict, &returnDict);
@@ -3143,8 +5175,8 @@ CC3OSXControllerState_Restore(TC3ControllerStateInstanceDataPtr ctrlStateObject)
 		//-myController
 		result = IPCPutControllerRef(dict, CFSTR(k3CtrlRef), &ctrlStateObject->myController);
 		
-		//-ctrlStateUUID 
-		CFDictionarySetValue(dict,CFSTR(k3CtrlStateUUID),ctrlStateObject->ctrlStateUUIDString);
+		//-ctrlStateHandle 
+		result = IPCPutTQ3Uns32(dict, CFSTR(k3CtrlStateHandle), &ctrlStateObject->ctrlStateHandle);
 				
 		//try sending
 		status = IPCControllerDriver_Send(m3ControllerState_Restore,dict,&returnDict);
@@ -3165,6 +5197,257 @@ CC3OSXControllerState_Restore(TC3ControllerStateInstanceDataPtr ctrlStateObject)
 
 
 
+//=============================================================================
+//      CC3OSXControllerState_NewBatchDict : Build the request of a batch of
+//				controller states.
+//-----------------------------------------------------------------------------
+static CFMutableDictionaryRef
+CC3OSXControllerState_NewBatchDict(TQ3Uns32 stateCount, const TC3ControllerStateInstanceDataPtr *stateObjects)
+{
+	CFMutableDictionaryRef	dict;
+	CFMutableArrayRef		states;
+	TQ3Uns32				index;
+	
+	if ((stateCount==0) || (stateObjects==NULL))
+		return(NULL);
+	
+	states = CFArrayCreateMutable(kCFAllocatorDefault, stateCount, &kCFTypeArrayCallBacks);
+	if (states==NULL)
+		return(NULL);
+	
+	for (index=0; index<stateCount; index++)
+	{
+		CFMutableDictionaryRef	stateDict;
+		
+		stateDict = CFDictionaryCreateMutable(	kCFAllocatorDefault,0,
+												&kCFTypeDictionaryKeyCallBacks,
+												&kCFTypeDictionaryValueCallBacks);
+		if (stateDict==NULL)
+		{
+			CFRelease(states);
+			return(NULL);
+		}
+		
+		//-myController
+		IPCPutControllerRef(stateDict, CFSTR(k3CtrlRef), &stateObjects[index]->myController);
+		
+		//-ctrlStateHandle 
+		IPCPutTQ3Uns32(stateDict, CFSTR(k3CtrlStateHandle), &stateObjects[index]->ctrlStateHandle);
+		
+		CFArrayAppendValue(states, stateDict);
+		CFRelease(stateDict);
+	}
+	
+	dict = CFDictionaryCreateMutable(	kCFAllocatorDefault,0,
+										&kCFTypeDictionaryKeyCallBacks,
+										&kCFTypeDictionaryValueCallBacks);
+	if (dict)
+		CFDictionarySetValue(dict, CFSTR(k3CtrlStates), states);
+	
+	CFRelease(states);
+	return(dict);
+}
+
+
+
+//=============================================================================
+//      CC3OSXControllerState_GetBatchStatus : Copy the per state status of a
+//				batch reply.
+//-----------------------------------------------------------------------------
+//		Note : States missing in the reply are reported as kQ3Failure.
+//-----------------------------------------------------------------------------
+static void
+CC3OSXControllerState_GetBatchStatus(CFDictionaryRef returnDict, TQ3Uns32 stateCount, TQ3Status *stateStatus)
+{
+	CFArrayRef		statuses = NULL;
+	TQ3Uns32		index;
+	
+	if (returnDict!=NULL)
+		statuses = (CFArrayRef)CFDictionaryGetValue(returnDict, CFSTR(k3StateStatuses));
+	
+	for (index=0; index<stateCount; index++)
+	{
+		SInt32	stateStatusValue = (SInt32)kQ3Failure;
+		
+		if ((statuses!=NULL) && (index<(TQ3Uns32)CFArrayGetCount(statuses)))
+			CFNumberGetValue(	(CFNumberRef)CFArrayGetValueAtIndex(statuses,index),
+								kCFNumberSInt32Type,
+								&stateStatusValue);
+		stateStatus[index] = (stateStatusValue==(SInt32)kQ3Success) ? kQ3Success : kQ3Failure;
+	}
+}
+
+
+
+//=============================================================================
+//      CC3OSXControllerState_Batch : Save and reset, or restore, a batch of
+//				controller states with one request.
+//-----------------------------------------------------------------------------
+//		Note : The device server asks each driver once for all of its states.
+//				stateStatus gets the status of each state; the result is
+//				kQ3Failure if the request failed or any state did.
+//-----------------------------------------------------------------------------
+static TQ3Status
+CC3OSXControllerState_Batch(SInt32 msgid, TQ3Uns32 stateCount, const TC3ControllerStateInstanceDataPtr *stateObjects, TQ3Status *stateStatus)
+{
+	TQ3Status				status = kQ3Failure;
+	CFMutableDictionaryRef	dict, returnDict = NULL;
+	TQ3Uns32				index;
+	
+	Boolean					result;
+	
+	if (stateStatus==NULL)
+		return(status);
+	
+	//create dictionary
+	dict = CC3OSXControllerState_NewBatchDict(stateCount, stateObjects);
+	if (dict)
+	{
+		//try sending
+		status = IPCControllerDriver_Send(msgid, dict, &returnDict);
+		if (status!=kQ3Failure)
+		{
+			//Get status from returnDict
+			result = IPCGetTQ3Uns32(returnDict, CFSTR(k3Status), (TQ3Uns32*)&status);
+		};
+		CC3OSXControllerState_GetBatchStatus((status!=kQ3Failure) ? returnDict : NULL, stateCount, stateStatus);
+		
+		//Do clean up
+		CFRelease(dict);
+		
+		if (returnDict)
+			CFRelease(returnDict);
+	}
+	
+	for (index=0; index<stateCount; index++)
+		if (stateStatus[index]!=kQ3Success)
+			status = kQ3Failure;
+	
+	return(status);
+}
+
+
+
+static void
+CC3OSXControllerState_BatchCompletion(SInt32 msgid, TQ3Status status, CFDictionaryRef returnDict, void *userData)
+{
+	TC3AsyncCallDataPtr	callData = (TC3AsyncCallDataPtr)userData;
+	TQ3Status			*stateStatus;
+	TQ3Uns32			index;
+	
+	stateStatus = (TQ3Status*)malloc(callData->valueCount*sizeof(TQ3Status));
+	if (stateStatus==NULL)
+		status = kQ3Failure;
+	else
+	{
+		CC3OSXControllerState_GetBatchStatus((status==kQ3Success) ? returnDict : NULL, callData->valueCount, stateStatus);
+		for (index=0; index<callData->valueCount; index++)
+			if (stateStatus[index]!=kQ3Success)
+				status = kQ3Failure;
+	}
+	
+	if (callData->stateBatchProc!=NULL)
+		callData->stateBatchProc(status, (stateStatus!=NULL) ? callData->valueCount : 0, stateStatus, callData->userData);
+	
+	if (stateStatus!=NULL)
+		free(stateStatus);
+	free(callData);
+}
+
+
+
+//=============================================================================
+//      CC3OSXControllerState_BatchAsync : Non-blocking CC3OSXControllerState_Batch.
+//-----------------------------------------------------------------------------
+//		Note : The device server contacts all drivers of the batch in parallel.
+//-----------------------------------------------------------------------------
+static TQ3Status
+CC3OSXControllerState_BatchAsync(SInt32 msgid, TQ3Uns32 stateCount, const TC3ControllerStateInstanceDataPtr *stateObjects, TC3StateBatchCompletionProc completionProc, void *userData)
+{
+	TQ3Status 			status = kQ3Failure;
+	TC3AsyncCallDataPtr	callData;
+	CFMutableDictionaryRef dict;
+	
+	callData = CC3OSXController_NewCallData(NULL, userData);
+	if (callData==NULL)
+		return(status);
+	callData->valueCount = stateCount;
+	callData->stateBatchProc = completionProc;
+	
+	//create dictionary
+	dict = CC3OSXControllerState_NewBatchDict(stateCount, stateObjects);
+	if (dict)
+	{
+		//try sending
+		status = CC3OSXController_SendAsync(msgid, dict, CC3OSXControllerState_BatchCompletion, callData);
+		
+		//Do clean up
+		CFRelease(dict);
+	}
+	else
+		free(callData);
+		
+	return(status);
+}
+
+
+
+//=============================================================================
+//      CC3OSXControllerState_SaveAndResetBatch : CC3OSXControllerState_SaveAndReset
+//				for many controller states.
+//-----------------------------------------------------------------------------
+//		Note : stateStatus has stateCount entries. If two states of a batch
+//				share a controller, the later one saves what the earlier one
+//				left after its reset.
+//-----------------------------------------------------------------------------
+TQ3Status
+CC3OSXControllerState_SaveAndResetBatch(TQ3Uns32 stateCount, const TC3ControllerStateInstanceDataPtr *stateObjects, TQ3Status *stateStatus)
+{
+	return(CC3OSXControllerState_Batch(m3ControllerState_SaveAndResetBatch, stateCount, stateObjects, stateStatus));
+}
+
+
+
+//=============================================================================
+//      CC3OSXControllerState_RestoreBatch : CC3OSXControllerState_Restore for
+//				many controller states.
+//-----------------------------------------------------------------------------
+//		Note : stateStatus has stateCount entries. If two states of a batch
+//				share a controller, the later one wins.
+//-----------------------------------------------------------------------------
+TQ3Status
+CC3OSXControllerState_RestoreBatch(TQ3Uns32 stateCount, const TC3ControllerStateInstanceDataPtr *stateObjects, TQ3Status *stateStatus)
+{
+	return(CC3OSXControllerState_Batch(m3ControllerState_RestoreBatch, stateCount, stateObjects, stateStatus));
+}
+
+
+
+//=============================================================================
+//      CC3OSXControllerState_SaveAndResetBatchAsync : Non-blocking
+//				CC3OSXControllerState_SaveAndResetBatch.
+//-----------------------------------------------------------------------------
+TQ3Status
+CC3OSXControllerState_SaveAndResetBatchAsync(TQ3Uns32 stateCount, const TC3ControllerStateInstanceDataPtr *stateObjects, TC3StateBatchCompletionProc completionProc, void *userData)
+{
+	return(CC3OSXControllerState_BatchAsync(m3ControllerState_SaveAndResetBatch, stateCount, stateObjects, completionProc, userData));
+}
+
+
+
+//=============================================================================
+//      CC3OSXControllerState_RestoreBatchAsync : Non-blocking
+//				CC3OSXControllerState_RestoreBatch.
+//-----------------------------------------------------------------------------
+TQ3Status
+CC3OSXControllerState_RestoreBatchAsync(TQ3Uns32 stateCount, const TC3ControllerStateInstanceDataPtr *stateObjects, TC3StateBatchCompletionProc completionProc, void *userData)
+{
+	return(CC3OSXControllerState_BatchAsync(m3ControllerState_RestoreBatch, stateCount, stateObjects, completionProc, userData));
+}
+
+
+
+
 //=============================================================================
 //      CC3OSXCursorTracker_PrepareTracking : One-line description of the method.
 //-----------------------------------------------------------------------------
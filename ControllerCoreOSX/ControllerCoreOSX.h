@@ -75,6 +75,26 @@ typedef struct TC3TrackerInstanceData *TC3TrackerInstanceDataPtr;
 typedef struct TC3ControllerPrivateData *TC3ControllerPrivateDataPtr;
 typedef struct TC3ControllerStateInstanceData *TC3ControllerStateInstanceDataPtr;
 
+//cursor into the event history of a tracker, see CC3OSXTracker_SampleEventCoordinates
+typedef struct TC3TrackerEventCursor
+{
+	TQ3Uns32					eventSequence;
+} TC3TrackerEventCursor;
+
+//pose predictor of a tracker, see CC3OSXTracker_SetPredictionParams
+typedef enum TC3TrackerPredictionMode
+{
+	kC3TrackerPredictionNone				= 0,
+	kC3TrackerPredictionConstantVelocity	= 1,
+	kC3TrackerPredictionOneEuro				= 2
+} TC3TrackerPredictionMode;
+
+//completion procs of the asynchronous calls; called once, on the run loop of the calling thread
+typedef void (*TC3ValuesCompletionProc)(TQ3Status status, TQ3ControllerRef controllerRef, TQ3Uns32 valueCount, const float *values, TQ3Boolean active, TQ3Uns32 serialNumber, void *userData);
+typedef void (*TC3PositionCompletionProc)(TQ3Status status, TQ3ControllerRef controllerRef, const TQ3Point3D *position, void *userData);
+typedef void (*TC3OrientationCompletionProc)(TQ3Status status, TQ3ControllerRef controllerRef, const TQ3Quaternion *orientation, void *userData);
+typedef void (*TC3StateBatchCompletionProc)(TQ3Status status, TQ3Uns32 stateCount, const TQ3Status *stateStatus, void *userData);
+
 //=============================================================================
 //      Function prototypes
 //-----------------------------------------------------------------------------
@@ -88,9 +108,13 @@ TQ3Status					CC3OSXController_GetActivation(TQ3ControllerRef controllerRef, TQ3
 TQ3Status					CC3OSXController_GetSignature(TQ3ControllerRef controllerRef, char *signature, TQ3Uns32 numChars);
 TQ3Status					CC3OSXController_SetChannel(TQ3ControllerRef controllerRef, TQ3Uns32 channel, const void *data, TQ3Uns32 dataSize);
 TQ3Status					CC3OSXController_GetChannel(TQ3ControllerRef controllerRef, TQ3Uns32 channel, void *data, TQ3Uns32 *dataSize);
+TQ3Status					CC3OSXController_SetChannels(TQ3ControllerRef controllerRef, TQ3Uns32 channelCount, const TQ3Uns32 *channels, const void *const *data, const TQ3Uns32 *dataSizes, TQ3Status *channelStatus);
+TQ3Status					CC3OSXController_GetChannels(TQ3ControllerRef controllerRef, TQ3Uns32 channelCount, const TQ3Uns32 *channels, void *const *data, TQ3Uns32 *dataSizes, TQ3Status *channelStatus);
 TQ3Status					CC3OSXController_GetValueCount(TQ3ControllerRef controllerRef, TQ3Uns32 *valueCount);
 TQ3Status					CC3OSXController_SetTracker(TQ3ControllerRef controllerRef, TC3TrackerInstanceDataPtr tracker);
 TQ3Status					CC3OSXController_HasTracker(TQ3ControllerRef controllerRef, TQ3Boolean *hasTracker);
+TQ3Status					CC3OSXController_GetConsumerState(TQ3ControllerRef controllerRef, TQ3Boolean *hasSubscribers, float *consumerRate);
+TQ3Status					CC3OSXController_SetFilter(TQ3ControllerRef controllerRef, CFArrayRef stages);
 TQ3Status					CC3OSXController_Track2DCursor(TQ3ControllerRef controllerRef, TQ3Boolean *track2DCursor);
 TQ3Status					CC3OSXController_Track3DCursor(TQ3ControllerRef controllerRef, TQ3Boolean *track3DCursor);
 TQ3Status					CC3OSXController_GetButtons(TQ3ControllerRef controllerRef, TQ3Uns32 *buttons);
@@ -104,6 +128,12 @@ TQ3Status					CC3OSXController_MoveTrackerOrientation(TQ3ControllerRef controlle
 TQ3Status					CC3OSXController_GetValues(TQ3ControllerRef controllerRef, TQ3Uns32 valueCount, float *values, TQ3Boolean *changed, TQ3Uns32 *serialNumber);
 TQ3Status					CC3OSXController_SetValues(TQ3ControllerRef controllerRef, const float *values, TQ3Uns32 valueCount);
 
+//asynchronous prototypes for Controller
+TQ3Status					CC3OSXController_GetValuesAsync(TQ3ControllerRef controllerRef, TQ3Uns32 valueCount, TC3ValuesCompletionProc completionProc, void *userData);
+TQ3Status					CC3OSXController_WaitForValues(TQ3ControllerRef controllerRef, TQ3Uns32 valueCount, TQ3Uns32 serialNumber, TC3ValuesCompletionProc completionProc, void *userData);
+TQ3Status					CC3OSXController_GetTrackerPositionAsync(TQ3ControllerRef controllerRef, TC3PositionCompletionProc completionProc, void *userData);
+TQ3Status					CC3OSXController_GetTrackerOrientationAsync(TQ3ControllerRef controllerRef, TC3OrientationCompletionProc completionProc, void *userData);
+
 //prototypes for ControllerState
 TC3ControllerStateInstanceDataPtr
 							CC3OSXControllerState_New(TQ3Object theObject, TQ3ControllerRef theController);
@@ -111,12 +141,19 @@ TC3ControllerStateInstanceDataPtr
 							CC3OSXControllerState_Delete(TC3ControllerStateInstanceDataPtr trackerObject);
 TQ3Status					CC3OSXControllerState_SaveAndReset(TC3ControllerStateInstanceDataPtr controllerStateObject);
 TQ3Status					CC3OSXControllerState_Restore(TC3ControllerStateInstanceDataPtr controllerStateObject);
+TQ3Status					CC3OSXControllerState_SaveAndResetBatch(TQ3Uns32 stateCount, const TC3ControllerStateInstanceDataPtr *stateObjects, TQ3Status *stateStatus);
+TQ3Status					CC3OSXControllerState_RestoreBatch(TQ3Uns32 stateCount, const TC3ControllerStateInstanceDataPtr *stateObjects, TQ3Status *stateStatus);
+TQ3Status					CC3OSXControllerState_SaveAndResetBatchAsync(TQ3Uns32 stateCount, const TC3ControllerStateInstanceDataPtr *stateObjects, TC3StateBatchCompletionProc completionProc, void *userData);
+TQ3Status					CC3OSXControllerState_RestoreBatchAsync(TQ3Uns32 stateCount, const TC3ControllerStateInstanceDataPtr *stateObjects, TC3StateBatchCompletionProc completionProc, void *userData);
 
 //prototypes for Tracker
 TC3TrackerInstanceDataPtr	CC3OSXTracker_New(TQ3Object theObject, TQ3TrackerNotifyFunc notifyFunc);
 TC3TrackerInstanceDataPtr	CC3OSXTracker_Delete(TC3TrackerInstanceDataPtr trackerObject);
 TQ3Status					CC3OSXTracker_SetNotifyThresholds(TC3TrackerInstanceDataPtr trackerObject, float positionThresh, float orientationThresh);
 TQ3Status					CC3OSXTracker_GetNotifyThresholds(TC3TrackerInstanceDataPtr trackerObject, float *positionThresh, float *orientationThresh);
+TQ3Status					CC3OSXTracker_SetPredictionParams(TC3TrackerInstanceDataPtr trackerObject, TC3TrackerPredictionMode mode, float minCutoff, float beta, float maxLead);
+TQ3Status					CC3OSXTracker_GetPredictionParams(TC3TrackerInstanceDataPtr trackerObject, TC3TrackerPredictionMode *mode, float *minCutoff, float *beta, float *maxLead);
+TQ3Status					CC3OSXTracker_GetPredictedPose(TC3TrackerInstanceDataPtr trackerObject, CFAbsoluteTime targetTime, TQ3Point3D *position, TQ3Quaternion *orientation);
 TQ3Status					CC3OSXTracker_SetActivation(TC3TrackerInstanceDataPtr trackerObject, TQ3Boolean active);
 TQ3Status					CC3OSXTracker_GetActivation(TC3TrackerInstanceDataPtr trackerObject, TQ3Boolean *active);
 TQ3Status					CC3OSXTracker_GetButtons(TC3TrackerInstanceDataPtr trackerObject, TQ3Uns32 *buttons);
@@ -129,6 +166,12 @@ TQ3Status					CC3OSXTracker_SetOrientation(TC3TrackerInstanceDataPtr trackerObje
 TQ3Status					CC3OSXTracker_MoveOrientation(TC3TrackerInstanceDataPtr trackerObject, TQ3ControllerRef controllerRef, const TQ3Quaternion *delta);
 TQ3Status					CC3OSXTracker_SetEventCoordinates(TC3TrackerInstanceDataPtr trackerObject, TQ3Uns32 timeStamp, TQ3Uns32 buttons, const TQ3Point3D *position, const TQ3Quaternion *orientation);
 TQ3Status					CC3OSXTracker_GetEventCoordinates(TC3TrackerInstanceDataPtr trackerObject, TQ3Uns32 timeStamp, TQ3Uns32 *buttons, TQ3Point3D *position, TQ3Quaternion *orientation);
+TQ3Status					CC3OSXTracker_SetEventCapacity(TC3TrackerInstanceDataPtr trackerObject, TQ3Uns32 eventCapacity);
+TQ3Status					CC3OSXTracker_GetEventCapacity(TC3TrackerInstanceDataPtr trackerObject, TQ3Uns32 *eventCapacity);
+TQ3Status					CC3OSXTracker_SetEventExtrapolation(TC3TrackerInstanceDataPtr trackerObject, TQ3Uns32 maxExtrapolation);
+TQ3Status					CC3OSXTracker_GetEventExtrapolation(TC3TrackerInstanceDataPtr trackerObject, TQ3Uns32 *maxExtrapolation);
+TQ3Status					CC3OSXTracker_InitEventCursor(TC3TrackerInstanceDataPtr trackerObject, TC3TrackerEventCursor *cursor);
+TQ3Status					CC3OSXTracker_SampleEventCoordinates(TC3TrackerInstanceDataPtr trackerObject, TC3TrackerEventCursor *cursor, TQ3Uns32 sampleCount, const TQ3Uns32 *timeStamps, TQ3Uns32 *buttons, TQ3Point3D *positions, TQ3Quaternion *orientations);
 
 //prototypes for CursorTracker
 TQ3Status					CC3OSXCursorTracker_PrepareTracking(void);
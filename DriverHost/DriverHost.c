@@ -0,0 +1,738 @@
+/*  NAME:
+        DriverHost.c
+
+    DESCRIPTION:
+        Headless host for input device drivers.
+		
+		One thread serves all devices: a select over their descriptors, a read
+		by the device's backend, and at most one flush per flush interval for
+		all devices together. Motion reported between flushes is accumulated
+		(translations summed, rotations multiplied in arrival order), so the
+		IPC load follows the flush rate and not the device rates. Button
+		changes flush the device's motion and go out at once.
+		
+		Watched devices need no rescans: on Linux an inotify descriptor joins
+		the select, and arrivals and removals in the watched directories add
+		and remove devices as they happen.
+      
+    COPYRIGHT:
+        Copyright (c) 1999-2005, Quesa Developers. All rights reserved.
+
+        For the current release of Quesa, please see:
+
+            <http://www.quesa.org/>
+        
+        Redistribution and use in source and binary forms, with or without
+        modification, are permitted provided that the following conditions
+        are met:
+        
+            o Redistributions of source code must retain the above copyright
+              notice, this list of conditions and the following disclaimer.
+        
+            o Redistributions in binary form must reproduce the above
+              copyright notice, this list of conditions and the following
+              disclaimer in the documentation and/or other materials provided
+              with the distribution.
+        
+            o Neither the name of Quesa nor the names of its contributors
+              may be used to endorse or promote products derived from this
+              software without specific prior written permission.
+        
+        THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+        "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+        LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+        A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+        OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+        SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+        TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+        PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+        LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+        NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+        SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+    ___________________________________________________________________________
+*/
+
+
+
+
+
+//=============================================================================
+//      Include files
+//-----------------------------------------------------------------------------
+#include "DriverHost.h"
+#include "C3QuaternionMath.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/select.h>
+
+#if defined(__APPLE__)
+	#include <mach/mach_time.h>
+#else
+	#include <time.h>
+#endif
+
+#if defined(__linux__)
+	#include <sys/inotify.h>
+	#include <limits.h>
+	
+	#define kDriverHostNotifyMask	(IN_CREATE | IN_ATTRIB | IN_MOVED_TO | IN_DELETE | IN_MOVED_FROM)
+#endif
+
+
+
+
+
+//=============================================================================
+//      Internal variables
+//-----------------------------------------------------------------------------
+static const TDriverBackend *backends[] =
+{
+	&kDriverBackendMagellan,
+#if defined(__linux__)
+	&kDriverBackendEvdev,
+#endif
+	NULL
+};
+
+
+
+
+
+//=============================================================================
+//      Internal functions
+//-----------------------------------------------------------------------------
+//      DriverHost_FlushDevice : Deliver a device's pending motion and values.
+//-----------------------------------------------------------------------------
+static void
+DriverHost_FlushDevice(TDriverDevice *device)
+{
+	if (device->hasPendingMotion)
+	{
+		Q3Controller_MoveTrackerPosition(device->controllerRef, &device->pendingTranslation);
+		
+		//the product of many unit quaternions drifts off unit length
+		CC3Quaternion_NormalizeArray(1, &device->pendingRotation, &device->pendingRotation);
+		Q3Controller_MoveTrackerOrientation(device->controllerRef, &device->pendingRotation);
+		
+		device->hasPendingMotion = kQ3False;
+	}
+	
+	if (device->hasPendingValues)
+	{
+		Q3Controller_SetValues(device->controllerRef, device->pendingValues, device->valueCount);
+		device->hasPendingValues = kQ3False;
+	}
+}
+
+
+
+//=============================================================================
+//      DriverHost_FindDevice : The open device of a path, or NULL.
+//-----------------------------------------------------------------------------
+static TDriverDevice *
+DriverHost_FindDevice(const TDriverHost *host, const char *path)
+{
+	TQ3Uns32	index;
+	
+	for (index=0; index<host->deviceCount; index++)
+		if (strcmp(host->devices[index]->path, path)==0)
+			return(host->devices[index]);
+	
+	return(NULL);
+}
+
+
+
+//=============================================================================
+//      DriverHost_WatchMatches : Whether a directory entry is watched.
+//-----------------------------------------------------------------------------
+static TQ3Boolean
+DriverHost_WatchMatches(const TDriverHostWatch *watch, const char *name)
+{
+	if (watch->exact)
+		return((strcmp(watch->name, name)==0) ? kQ3True : kQ3False);
+	
+	return((strncmp(watch->name, name, strlen(watch->name))==0) ? kQ3True : kQ3False);
+}
+
+
+
+//=============================================================================
+//      DriverHost_Arrived : Serve a node that appeared in a watched directory.
+//-----------------------------------------------------------------------------
+static void
+DriverHost_Arrived(TDriverHost *host, const TDriverHostWatch *watch, const char *name)
+{
+	char	path[kDriverHostPathSize];
+	
+	if (!DriverHost_WatchMatches(watch, name))
+		return;
+	
+	if (snprintf(path, sizeof(path), "%s/%s", watch->directory, name) >= (int) sizeof(path))
+		return;
+	
+	if (DriverHost_FindDevice(host, path)==NULL)
+		DriverHost_AddDevice(host, watch->backend, path);
+}
+
+
+
+//=============================================================================
+//      DriverHost_AddWatch : Watch a directory and serve what is there.
+//-----------------------------------------------------------------------------
+static TQ3Status
+DriverHost_AddWatch(TDriverHost *host, const TDriverBackend *backend,
+					const char *directory, const char *name, TQ3Boolean exact)
+{
+	TDriverHostWatch	*watch;
+	DIR					*directoryStream;
+	struct dirent		*entry;
+	
+	if ((host==NULL) || (backend==NULL) || (host->watchCount>=kDriverHostMaxWatches)
+	||  (strlen(directory)>=kDriverHostPathSize) || (strlen(name)>=kDriverHostPathSize))
+		return(kQ3Failure);
+	
+	watch = &host->watches[host->watchCount++];
+	watch->backend			= backend;
+	watch->exact			= exact;
+	watch->watchDescriptor	= -1;
+	strcpy(watch->directory, directory);
+	strcpy(watch->name, name);
+	
+#if defined(__linux__)
+	//watches of one directory share its watch descriptor
+	if (host->notifyDescriptor!=-1)
+		watch->watchDescriptor = inotify_add_watch(host->notifyDescriptor, directory, kDriverHostNotifyMask);
+#endif
+	
+	//what is there already
+	directoryStream = opendir(directory);
+	if (directoryStream!=NULL)
+	{
+		while ((entry = readdir(directoryStream))!=NULL)
+			DriverHost_Arrived(host, watch, entry->d_name);
+		closedir(directoryStream);
+	}
+	
+	return(kQ3Success);
+}
+
+
+
+//=============================================================================
+//      DriverHost_HandleNotifications : Add and remove watched devices.
+//-----------------------------------------------------------------------------
+//		Note :	A node usually appears before udev gives it its permissions;
+//				an open that fails on IN_CREATE is retried on IN_ATTRIB.
+//-----------------------------------------------------------------------------
+static void
+DriverHost_HandleNotifications(TDriverHost *host)
+{
+#if defined(__linux__)
+	char		buffer[16 * (sizeof(struct inotify_event) + NAME_MAX + 1)]
+					__attribute__ ((aligned(__alignof__(struct inotify_event))));
+	char		path[kDriverHostPathSize];
+	ssize_t		byteCount, offset;
+	TQ3Uns32	index;
+	
+	while ((byteCount = read(host->notifyDescriptor, buffer, sizeof(buffer)))>0)
+	{
+		for (offset=0; offset<byteCount; offset += (ssize_t) (sizeof(struct inotify_event) + ((const struct inotify_event *) &buffer[offset])->len))
+		{
+			const struct inotify_event *event = (const struct inotify_event *) &buffer[offset];
+			
+			if (event->len==0)
+				continue;
+			
+			for (index=0; index<host->watchCount; index++)
+			{
+				const TDriverHostWatch *watch = &host->watches[index];
+				
+				if ((watch->watchDescriptor!=event->wd) || !DriverHost_WatchMatches(watch, event->name))
+					continue;
+				
+				if (event->mask & (IN_DELETE | IN_MOVED_FROM))
+				{
+					TDriverDevice *device;
+					
+					snprintf(path, sizeof(path), "%s/%s", watch->directory, event->name);
+					device = DriverHost_FindDevice(host, path);
+					if (device!=NULL)
+						DriverHost_RemoveDevice(host, device);
+				}
+				else
+					DriverHost_Arrived(host, watch, event->name);
+			}
+		}
+	}
+#else
+	(void) host;
+#endif
+}
+
+
+
+//=============================================================================
+//      DriverHost_HasPending : Whether any device waits for a flush.
+//-----------------------------------------------------------------------------
+static TQ3Boolean
+DriverHost_HasPending(const TDriverHost *host)
+{
+	TQ3Uns32	index;
+	
+	for (index=0; index<host->deviceCount; index++)
+		if (host->devices[index]->hasPendingMotion || host->devices[index]->hasPendingValues)
+			return(kQ3True);
+	
+	return(kQ3False);
+}
+
+
+
+//=============================================================================
+//      DriverHost_NextDeadline : When the loop has work without input.
+//-----------------------------------------------------------------------------
+//		Note : The earlier of the next flush, if motion or values are
+//				pending, and the first serviceTime. 0 for none.
+//-----------------------------------------------------------------------------
+static double
+DriverHost_NextDeadline(const TDriverHost *host)
+{
+	double		deadline = 0.0;
+	TQ3Uns32	index;
+	
+	if (DriverHost_HasPending(host))
+		deadline = host->lastFlush + host->flushInterval;
+	
+	for (index=0; index<host->deviceCount; index++)
+	{
+		double serviceTime = host->devices[index]->serviceTime;
+		
+		if ((serviceTime!=0.0) && ((deadline==0.0) || (serviceTime<deadline)))
+			deadline = serviceTime;
+	}
+	
+	return(deadline);
+}
+
+
+
+
+
+//=============================================================================
+//      Public functions
+//-----------------------------------------------------------------------------
+//      DriverHost_Now : Monotonic time in seconds.
+//-----------------------------------------------------------------------------
+double
+DriverHost_Now(void)
+{
+#if defined(__APPLE__)
+	static mach_timebase_info_data_t	timebase;
+	
+	if (timebase.denom==0)
+		mach_timebase_info(&timebase);
+	
+	return((double) mach_absolute_time() * timebase.numer / timebase.denom * 1.0e-9);
+#else
+	struct timespec		now;
+	
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return((double) now.tv_sec + (double) now.tv_nsec * 1.0e-9);
+#endif
+}
+
+
+
+//=============================================================================
+//      DriverHost_New : Create a host without devices.
+//-----------------------------------------------------------------------------
+//		Note : flushRate is in Hz; 0 delivers after every read.
+//-----------------------------------------------------------------------------
+TDriverHost *
+DriverHost_New(float flushRate)
+{
+	TDriverHost		*host = (TDriverHost *) calloc(1, sizeof(TDriverHost));
+	
+	if (host==NULL)
+		return(NULL);
+	
+	if (pipe(host->wakePipe)!=0)
+	{
+		free(host);
+		return(NULL);
+	}
+	fcntl(host->wakePipe[0], F_SETFL, O_NONBLOCK);
+	fcntl(host->wakePipe[1], F_SETFL, O_NONBLOCK);
+	
+#if defined(__linux__)
+	host->notifyDescriptor = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+#else
+	host->notifyDescriptor = -1;
+#endif
+	
+	host->flushInterval = (flushRate>0.0f) ? 1.0/flushRate : 0.0;
+	return(host);
+}
+
+
+
+//=============================================================================
+//      DriverHost_Dispose : Remove all devices and free the host.
+//-----------------------------------------------------------------------------
+void
+DriverHost_Dispose(TDriverHost *host)
+{
+	if (host==NULL)
+		return;
+	
+	while (host->deviceCount>0)
+		DriverHost_RemoveDevice(host, host->devices[host->deviceCount-1]);
+	
+	if (host->notifyDescriptor!=-1)
+		close(host->notifyDescriptor);
+	close(host->wakePipe[0]);
+	close(host->wakePipe[1]);
+	free(host);
+}
+
+
+
+//=============================================================================
+//      DriverHost_FindBackend : Look up a backend by name.
+//-----------------------------------------------------------------------------
+const TDriverBackend *
+DriverHost_FindBackend(const char *name)
+{
+	TQ3Uns32	index;
+	
+	for (index=0; backends[index]!=NULL; index++)
+		if (strcmp(backends[index]->name, name)==0)
+			return(backends[index]);
+	
+	return(NULL);
+}
+
+
+
+//=============================================================================
+//      DriverHost_AddDevice : Open a device and register its controller.
+//-----------------------------------------------------------------------------
+TDriverDevice *
+DriverHost_AddDevice(TDriverHost *host, const TDriverBackend *backend, const char *path)
+{
+	TDriverDevice		*device;
+	TQ3ControllerData	controllerData;
+	
+	if ((host==NULL) || (backend==NULL) || (host->deviceCount>=kDriverHostMaxDevices)
+	||  (strlen(path)>=kDriverHostPathSize))
+		return(NULL);
+	
+	device = (TDriverDevice *) calloc(1, sizeof(TDriverDevice));
+	if (device==NULL)
+		return(NULL);
+	
+	device->backend				= backend;
+	device->fileDescriptor		= -1;
+	strcpy(device->path, path);
+	device->translationScale	= 1.0f;
+	device->rotationScale		= 1.0f;
+	device->repeatInterval		= (host->flushInterval>0.0) ? host->flushInterval : 1.0/kDriverHostDefaultFlushRate;
+	
+	if (backend->open(device, path)!=kQ3Success)
+	{
+		free(device);
+		return(NULL);
+	}
+	
+	if (device->valueCount>kDriverHostMaxValues)
+		device->valueCount = kDriverHostMaxValues;
+	
+	controllerData.signature		= device->signature;
+	controllerData.valueCount		= device->valueCount;
+	controllerData.channelCount		= 0;
+	controllerData.channelGetMethod	= NULL;
+	controllerData.channelSetMethod	= NULL;
+	
+	device->controllerRef = Q3Controller_New(&controllerData);
+	if (device->controllerRef==NULL)
+	{
+		backend->close(device);
+		free(device);
+		return(NULL);
+	}
+	
+	host->devices[host->deviceCount++] = device;
+	return(device);
+}
+
+
+
+//=============================================================================
+//      DriverHost_RemoveDevice : Decommission and close a device.
+//-----------------------------------------------------------------------------
+void
+DriverHost_RemoveDevice(TDriverHost *host, TDriverDevice *device)
+{
+	TQ3Uns32	index;
+	
+	for (index=0; index<host->deviceCount; index++)
+		if (host->devices[index]==device)
+			break;
+	
+	if (index==host->deviceCount)
+		return;
+	
+	host->devices[index] = host->devices[--host->deviceCount];
+	
+	DriverHost_FlushDevice(device);
+	Q3Controller_Decommission(device->controllerRef);
+	device->backend->close(device);
+	free(device);
+}
+
+
+
+//=============================================================================
+//      DriverHost_WatchDevice : Serve a device path, also after it reappears.
+//-----------------------------------------------------------------------------
+TQ3Status
+DriverHost_WatchDevice(TDriverHost *host, const TDriverBackend *backend, const char *path)
+{
+	char		directory[kDriverHostPathSize];
+	const char	*separator = strrchr(path, '/');
+	
+	if ((separator==NULL) || ((size_t) (separator-path)>=sizeof(directory)))
+		return(DriverHost_AddWatch(host, backend, ".", path, kQ3True));
+	
+	memcpy(directory, path, (size_t) (separator-path));
+	directory[separator-path] = 0;
+	
+	return(DriverHost_AddWatch(host, backend, (separator==path) ? "/" : directory, separator+1, kQ3True));
+}
+
+
+
+//=============================================================================
+//      DriverHost_WatchDirectory : Serve matching nodes of a directory.
+//-----------------------------------------------------------------------------
+TQ3Status
+DriverHost_WatchDirectory(TDriverHost *host, const TDriverBackend *backend,
+							const char *directory, const char *prefix)
+{
+	return(DriverHost_AddWatch(host, backend, directory, prefix, kQ3False));
+}
+
+
+
+//=============================================================================
+//      DriverHost_Run : Serve all devices until DriverHost_Stop.
+//-----------------------------------------------------------------------------
+TQ3Status
+DriverHost_Run(TDriverHost *host)
+{
+	TDriverDevice	*failed[kDriverHostMaxDevices];
+	TQ3Uns32		failedCount, index;
+	fd_set			readSet;
+	int				maxDescriptor, result;
+	struct timeval	timeout, *timeoutPtr;
+	double			now, deadline, remaining;
+	char			drain[16];
+	
+	host->running	= 1;
+	host->lastFlush	= 0.0;
+	
+	while (host->running)
+	{
+		FD_ZERO(&readSet);
+		FD_SET(host->wakePipe[0], &readSet);
+		maxDescriptor = host->wakePipe[0];
+		
+		if (host->notifyDescriptor!=-1)
+		{
+			FD_SET(host->notifyDescriptor, &readSet);
+			if (host->notifyDescriptor>maxDescriptor)
+				maxDescriptor = host->notifyDescriptor;
+		}
+		
+		for (index=0; index<host->deviceCount; index++)
+		{
+			FD_SET(host->devices[index]->fileDescriptor, &readSet);
+			if (host->devices[index]->fileDescriptor>maxDescriptor)
+				maxDescriptor = host->devices[index]->fileDescriptor;
+		}
+		
+		//sleep until input, or until pending motion or a backend's service is due
+		timeoutPtr	= NULL;
+		deadline	= DriverHost_NextDeadline(host);
+		if (deadline!=0.0)
+		{
+			remaining = deadline - DriverHost_Now();
+			if (remaining<0.0)
+				remaining = 0.0;
+			timeout.tv_sec	= (long) remaining;
+			timeout.tv_usec	= (long) ((remaining - (double) timeout.tv_sec) * 1.0e6);
+			timeoutPtr		= &timeout;
+		}
+		
+		result = select(maxDescriptor+1, &readSet, NULL, NULL, timeoutPtr);
+		if (result<0)
+		{
+			if (errno==EINTR)
+				continue;
+			host->running = 0;
+			return(kQ3Failure);
+		}
+		
+		if (FD_ISSET(host->wakePipe[0], &readSet))
+			while (read(host->wakePipe[0], drain, sizeof(drain))>0)
+				;
+		
+		//read all ready devices; removing is deferred, it reorders the device list
+		failedCount = 0;
+		if (result>0)
+			for (index=0; index<host->deviceCount; index++)
+			{
+				TDriverDevice *device = host->devices[index];
+				
+				if (FD_ISSET(device->fileDescriptor, &readSet))
+					if (device->backend->read(device)!=kQ3Success)
+						failed[failedCount++] = device;
+			}
+		
+		for (index=0; index<failedCount; index++)
+			DriverHost_RemoveDevice(host, failed[index]);
+		
+		if ((result>0) && (host->notifyDescriptor!=-1) && FD_ISSET(host->notifyDescriptor, &readSet))
+			DriverHost_HandleNotifications(host);
+		
+		//timed backend work, e.g. the steps of a device initialization
+		now			= DriverHost_Now();
+		failedCount	= 0;
+		for (index=0; index<host->deviceCount; index++)
+		{
+			TDriverDevice *device = host->devices[index];
+			
+			if ((device->serviceTime!=0.0) && (now>=device->serviceTime))
+			{
+				device->serviceTime = 0.0;
+				if (device->backend->service(device, now)!=kQ3Success)
+					failed[failedCount++] = device;
+			}
+		}
+		
+		for (index=0; index<failedCount; index++)
+			DriverHost_RemoveDevice(host, failed[index]);
+		
+		//one flush for all devices
+		if (now - host->lastFlush >= host->flushInterval)
+		{
+			if (DriverHost_HasPending(host))
+			{
+				for (index=0; index<host->deviceCount; index++)
+					DriverHost_FlushDevice(host->devices[index]);
+				host->lastFlush = now;
+			}
+		}
+	}
+	
+	for (index=0; index<host->deviceCount; index++)
+		DriverHost_FlushDevice(host->devices[index]);
+	
+	return(kQ3Success);
+}
+
+
+
+//=============================================================================
+//      DriverHost_Stop : Make DriverHost_Run return.
+//-----------------------------------------------------------------------------
+//		Note : Only touches a flag and the wake pipe, so it may be called from
+//				a signal handler or another thread.
+//-----------------------------------------------------------------------------
+void
+DriverHost_Stop(TDriverHost *host)
+{
+	ssize_t		written;
+	
+	host->running = 0;
+	written = write(host->wakePipe[1], "", 1);
+	(void) written;
+}
+
+
+
+//=============================================================================
+//      DriverHost_ReportMotion : Accumulate motion until the next flush.
+//-----------------------------------------------------------------------------
+void
+DriverHost_ReportMotion(TDriverDevice *device, const float translation[3], const float rotation[3])
+{
+	TQ3Vector3D		angles;
+	TQ3Quaternion	delta;
+	
+	angles.x = rotation[0] * device->rotationScale;
+	angles.y = rotation[1] * device->rotationScale;
+	angles.z = rotation[2] * device->rotationScale;
+	CC3Quaternion_SetRotateXYZArray(1, &angles, &delta);
+	
+	if (device->hasPendingMotion)
+	{
+		device->pendingTranslation.x += translation[0] * device->translationScale;
+		device->pendingTranslation.y += translation[1] * device->translationScale;
+		device->pendingTranslation.z += translation[2] * device->translationScale;
+		CC3Quaternion_Coalesce(&device->pendingRotation, &delta);
+	}
+	else
+	{
+		device->pendingTranslation.x = translation[0] * device->translationScale;
+		device->pendingTranslation.y = translation[1] * device->translationScale;
+		device->pendingTranslation.z = translation[2] * device->translationScale;
+		device->pendingRotation		 = delta;
+		device->hasPendingMotion	 = kQ3True;
+	}
+}
+
+
+
+//=============================================================================
+//      DriverHost_ReportButtons : Deliver a button change at once.
+//-----------------------------------------------------------------------------
+//		Note : Pending motion goes out first, so it keeps its order relative
+//				to the edge.
+//-----------------------------------------------------------------------------
+void
+DriverHost_ReportButtons(TDriverDevice *device, TQ3Uns32 buttons)
+{
+	if (buttons==device->buttons)
+		return;
+	
+	DriverHost_FlushDevice(device);
+	
+	device->buttons = buttons;
+	Q3Controller_SetButtons(device->controllerRef, buttons);
+}
+
+
+
+//=============================================================================
+//      DriverHost_ReportValues : Update values until the next flush.
+//-----------------------------------------------------------------------------
+void
+DriverHost_ReportValues(TDriverDevice *device, TQ3Uns32 firstValue, TQ3Uns32 valueCount, const float *values)
+{
+	if (firstValue>=device->valueCount)
+		return;
+	
+	if (valueCount > device->valueCount-firstValue)
+		valueCount = device->valueCount-firstValue;
+	
+	memcpy(&device->pendingValues[firstValue], values, valueCount*sizeof(float));
+	device->hasPendingValues = kQ3True;
+}
@@ -0,0 +1,200 @@
+/*  NAME:
+        DriverHost.h
+
+    DESCRIPTION:
+        Headless host for input device drivers. The host registers each device
+		as a Quesa controller, multiplexes all device descriptors in one select
+		loop, coalesces motion between flushes and decommissions devices that
+		go away. Watched devices are added again when they come back (inotify
+		on Linux). Device protocols plug in as backends (TDriverBackend).
+      
+    COPYRIGHT:
+        Copyright (c) 1999-2005, Quesa Developers. All rights reserved.
+
+        For the current release of Quesa, please see:
+
+            <http://www.quesa.org/>
+        
+        Redistribution and use in source and binary forms, with or without
+        modification, are permitted provided that the following conditions
+        are met:
+        
+            o Redistributions of source code must retain the above copyright
+              notice, this list of conditions and the following disclaimer.
+        
+            o Redistributions in binary form must reproduce the above
+              copyright notice, this list of conditions and the following
+              disclaimer in the documentation and/or other materials provided
+              with the distribution.
+        
+            o Neither the name of Quesa nor the names of its contributors
+              may be used to endorse or promote products derived from this
+              software without specific prior written permission.
+        
+        THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+        "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+        LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+        A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+        OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+        SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+        TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+        PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+        LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+        NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+        SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+    ___________________________________________________________________________
+*/
+
+
+
+
+
+#ifndef DriverHost_HDR
+#define DriverHost_HDR
+
+#if defined(__APPLE__)
+	#ifndef QUESA_OS_MACINTOSH
+		#define QUESA_OS_MACINTOSH		1
+	#endif
+	#include <Quesa/QuesaController.h>
+#else
+	#ifndef QUESA_OS_UNIX
+		#define QUESA_OS_UNIX			1
+	#endif
+	#include <QuesaController.h>
+#endif
+
+//=============================================================================
+//		C++ preamble
+//-----------------------------------------------------------------------------
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//=============================================================================
+//      Constants
+//-----------------------------------------------------------------------------
+#define kDriverHostMaxDevices			64
+#define kDriverHostSignatureSize		256		//as kQ3StringMaximumLength
+#define kDriverHostMaxValues			32
+#define kDriverHostMaxWatches			16
+#define kDriverHostPathSize				256
+#define kDriverHostDefaultFlushRate		60.0f	//Hz
+
+//=============================================================================
+//      Types
+//-----------------------------------------------------------------------------
+typedef struct TDriverDevice TDriverDevice;
+
+//a device protocol; all functions are called on the host's thread
+typedef struct TDriverBackend
+{
+	const char		*name;										//as used in device specifications, e.g. "magellan"
+	
+	//opens path, sets fileDescriptor, signature, valueCount and scales
+	TQ3Status		(*open)(TDriverDevice *device, const char *path);
+	void			(*close)(TDriverDevice *device);
+	
+	//fileDescriptor is readable; reports through DriverHost_Report*. kQ3Failure removes the device.
+	TQ3Status		(*read)(TDriverDevice *device);
+	
+	//optional; device->serviceTime has passed, e.g. the next step of an initialization is due.
+	//Must not block. kQ3Failure removes the device.
+	TQ3Status		(*service)(TDriverDevice *device, double now);
+} TDriverBackend;
+
+struct TDriverDevice
+{
+	const TDriverBackend	*backend;
+	char					path[kDriverHostPathSize];
+	void					*backendData;
+	int						fileDescriptor;
+	char					signature[kDriverHostSignatureSize];
+	TQ3Uns32				valueCount;
+	float					translationScale;					//device counts to tracker units
+	float					rotationScale;						//device counts to radians
+	double					serviceTime;						//DriverHost_Now time for backend->service, 0 for none
+	double					repeatInterval;						//seconds between repeats of a held state; the flush interval
+	
+	//host side
+	TQ3ControllerRef		controllerRef;
+	TQ3Uns32				buttons;
+	TQ3Boolean				hasPendingMotion;
+	TQ3Vector3D				pendingTranslation;					//sum of the deltas
+	TQ3Quaternion			pendingRotation;					//product of the deltas
+	TQ3Boolean				hasPendingValues;
+	float					pendingValues[kDriverHostMaxValues];
+};
+
+//devices in directory whose names start with prefix (or are name, if exact) are served
+typedef struct TDriverHostWatch
+{
+	const TDriverBackend	*backend;
+	char					directory[kDriverHostPathSize];
+	char					name[kDriverHostPathSize];
+	TQ3Boolean				exact;
+	int						watchDescriptor;
+} TDriverHostWatch;
+
+typedef struct TDriverHost
+{
+	TDriverDevice			*devices[kDriverHostMaxDevices];
+	TQ3Uns32				deviceCount;
+	TDriverHostWatch		watches[kDriverHostMaxWatches];
+	TQ3Uns32				watchCount;
+	int						notifyDescriptor;					//inotify on Linux, else -1
+	double					flushInterval;						//seconds; 0 flushes after every read
+	double					lastFlush;
+	int						wakePipe[2];
+	volatile int			running;
+} TDriverHost;
+
+//=============================================================================
+//      Backends
+//-----------------------------------------------------------------------------
+extern const TDriverBackend		kDriverBackendMagellan;			//Magellan/SpaceMouse on a serial port
+#if defined(__linux__)
+extern const TDriverBackend		kDriverBackendEvdev;			//Linux input devices: 6-DoF and gamepads
+#endif
+
+//=============================================================================
+//      Function prototypes
+//-----------------------------------------------------------------------------
+TDriverHost				*DriverHost_New(float flushRate);
+void					DriverHost_Dispose(TDriverHost *host);
+
+//monotonic time in seconds
+double					DriverHost_Now(void);
+
+//backend by name, or NULL
+const TDriverBackend	*DriverHost_FindBackend(const char *name);
+
+//opens the device and registers it with Q3Controller_New
+TDriverDevice			*DriverHost_AddDevice(TDriverHost *host, const TDriverBackend *backend, const char *path);
+//decommissions and closes the device
+void					DriverHost_RemoveDevice(TDriverHost *host, TDriverDevice *device);
+
+//serve path now, if present, and again whenever it reappears
+TQ3Status				DriverHost_WatchDevice(TDriverHost *host, const TDriverBackend *backend, const char *path);
+//serve every node of directory whose name starts with prefix, present and future ones
+TQ3Status				DriverHost_WatchDirectory(TDriverHost *host, const TDriverBackend *backend,
+												const char *directory, const char *prefix);
+
+//serves all devices until DriverHost_Stop; DriverHost_Stop is async-signal safe
+TQ3Status				DriverHost_Run(TDriverHost *host);
+void					DriverHost_Stop(TDriverHost *host);
+
+//backend reports
+//motion in device counts, scaled by the device scales; rotation about x, then y, then z
+void					DriverHost_ReportMotion(TDriverDevice *device, const float translation[3], const float rotation[3]);
+void					DriverHost_ReportButtons(TDriverDevice *device, TQ3Uns32 buttons);
+void					DriverHost_ReportValues(TDriverDevice *device, TQ3Uns32 firstValue, TQ3Uns32 valueCount, const float *values);
+
+//=============================================================================
+//		C++ postamble
+//-----------------------------------------------------------------------------
+#ifdef __cplusplus
+}
+#endif
+
+#endif
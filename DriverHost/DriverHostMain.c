@@ -0,0 +1,194 @@
+/*  NAME:
+        DriverHostMain.c
+
+    DESCRIPTION:
+        Headless driver process: serves any number of input devices through
+		one DriverHost.
+		
+		    DriverHost [-r flushRate] backend:path ...
+		
+		e.g. DriverHost magellan:/dev/ttyUSB0 evdev:/dev/input/event*
+		
+		Each path is watched: the device is served again when it comes back. A
+		path ending in * serves every matching node, present and future ones.
+		
+		Build, from this directory:
+		
+		    Mac OS X: cc -O2 -I../SpaceMouseController -I../common *.c ../SpaceMouseController/MagellanParser.c ../common/C3QuaternionMath.c -F<dir of Quesa.framework> -framework Quesa -framework Carbon -o DriverHost
+		    Linux:    cc -O2 -I../SpaceMouseController -I../common -I<Quesa includes> *.c ../SpaceMouseController/MagellanParser.c ../common/C3QuaternionMath.c -lquesa -lm -o DriverHost
+      
+    COPYRIGHT:
+        Copyright (c) 1999-2005, Quesa Developers. All rights reserved.
+
+        For the current release of Quesa, please see:
+
+            <http://www.quesa.org/>
+        
+        Redistribution and use in source and binary forms, with or without
+        modification, are permitted provided that the following conditions
+        are met:
+        
+            o Redistributions of source code must retain the above copyright
+              notice, this list of conditions and the following disclaimer.
+        
+            o Redistributions in binary form must reproduce the above
+              copyright notice, this list of conditions and the following
+              disclaimer in the documentation and/or other materials provided
+              with the distribution.
+        
+            o Neither the name of Quesa nor the names of its contributors
+              may be used to endorse or promote products derived from this
+              software without specific prior written permission.
+        
+        THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+        "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+        LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+        A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+        OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+        SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+        TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+        PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+        LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+        NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+        SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+    ___________________________________________________________________________
+*/
+
+
+
+
+
+//=============================================================================
+//      Include files
+//-----------------------------------------------------------------------------
+#include "DriverHost.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <unistd.h>
+
+
+
+
+
+//=============================================================================
+//      Internal variables
+//-----------------------------------------------------------------------------
+static TDriverHost *theHost = NULL;
+
+
+
+
+
+//=============================================================================
+//      Internal functions
+//-----------------------------------------------------------------------------
+//      DriverHostMain_Signal : Stop serving on SIGINT/SIGTERM.
+//-----------------------------------------------------------------------------
+static void
+DriverHostMain_Signal(int signalNumber)
+{
+	(void) signalNumber;
+	
+	if (theHost!=NULL)
+		DriverHost_Stop(theHost);
+}
+
+
+
+
+
+//=============================================================================
+//      main
+//-----------------------------------------------------------------------------
+int
+main(int argc, char *argv[])
+{
+	float					flushRate = kDriverHostDefaultFlushRate;
+	int						option, index;
+	char					backendName[32];
+	const char				*separator, *path;
+	size_t					length;
+	const TDriverBackend	*backend;
+	TQ3Status				status;
+	
+	while ((option = getopt(argc, argv, "r:"))!=-1)
+	{
+		switch (option)
+		{
+			case 'r':	flushRate = (float) atof(optarg);	break;
+			default:	optind = argc+1;					break;
+		}
+	}
+	
+	if ((optind>=argc) || (flushRate<0.0f))
+	{
+		fprintf(stderr, "usage: %s [-r flushRate] backend:path ...\n", argv[0]);
+		return(1);
+	}
+	
+	Q3Initialize();
+	
+	theHost = DriverHost_New(flushRate);
+	if (theHost==NULL)
+		return(1);
+	
+	for (index=optind; index<argc; index++)
+	{
+		separator = strchr(argv[index], ':');
+		if ((separator==NULL) || ((size_t) (separator-argv[index])>=sizeof(backendName)))
+		{
+			fprintf(stderr, "%s: %s is not backend:path\n", argv[0], argv[index]);
+			continue;
+		}
+		
+		memcpy(backendName, argv[index], (size_t) (separator-argv[index]));
+		backendName[separator-argv[index]] = 0;
+		
+		backend = DriverHost_FindBackend(backendName);
+		if (backend==NULL)
+		{
+			fprintf(stderr, "%s: no backend %s\n", argv[0], backendName);
+			continue;
+		}
+		
+		path	= separator+1;
+		length	= strlen(path);
+		if ((length>0) && (path[length-1]=='*'))
+		{
+			//directory/prefix*
+			const char	*slash = strrchr(path, '/');
+			char		directory[kDriverHostPathSize], prefix[kDriverHostPathSize];
+			
+			if ((slash==NULL) || (length>=kDriverHostPathSize))
+				status = kQ3Failure;
+			else
+			{
+				memcpy(directory, path, (size_t) (slash-path));
+				directory[slash-path] = 0;
+				memcpy(prefix, slash+1, length-(size_t) (slash-path)-2);
+				prefix[length-(size_t) (slash-path)-2] = 0;
+				status = DriverHost_WatchDirectory(theHost, backend, (slash==path) ? "/" : directory, prefix);
+			}
+		}
+		else
+			status = DriverHost_WatchDevice(theHost, backend, path);
+		
+		if (status!=kQ3Success)
+			fprintf(stderr, "%s: cannot watch %s\n", argv[0], argv[index]);
+	}
+	
+	signal(SIGINT,  DriverHostMain_Signal);
+	signal(SIGTERM, DriverHostMain_Signal);
+	signal(SIGPIPE, SIG_IGN);
+	
+	status = DriverHost_Run(theHost);
+	
+	DriverHost_Dispose(theHost);
+	theHost = NULL;
+	
+	Q3Exit();
+	return((status==kQ3Success) ? 0 : 1);
+}
@@ -0,0 +1,469 @@
+/*  NAME:
+        EvdevBackend.c
+
+    DESCRIPTION:
+        DriverHost backend for Linux input devices (evdev).
+		
+		6-DoF devices (relative rotations, or absolute x..rz without joystick
+		buttons) report motion like the Magellan; gamepads and joysticks
+		(BTN_GAMEPAD or BTN_JOYSTICK) report their absolute axes as controller
+		values in [-1, 1]. Other devices are left to the system. Keys map to
+		button bits in the order the device declares them. Devices can be
+		emulated with uinput.
+		
+		An absolute 6-DoF device only sends events while its deflection
+		changes; a held deflection is repeated every repeatInterval until the
+		axes are back at zero, as a Magellan keeps sending it.
+      
+    COPYRIGHT:
+        Copyright (c) 1999-2005, Quesa Developers. All rights reserved.
+
+        For the current release of Quesa, please see:
+
+            <http://www.quesa.org/>
+        
+        Redistribution and use in source and binary forms, with or without
+        modification, are permitted provided that the following conditions
+        are met:
+        
+            o Redistributions of source code must retain the above copyright
+              notice, this list of conditions and the following disclaimer.
+        
+            o Redistributions in binary form must reproduce the above
+              copyright notice, this list of conditions and the following
+              disclaimer in the documentation and/or other materials provided
+              with the distribution.
+        
+            o Neither the name of Quesa nor the names of its contributors
+              may be used to endorse or promote products derived from this
+              software without specific prior written permission.
+        
+        THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+        "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+        LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+        A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+        OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+        SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+        TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+        PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+        LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+        NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+        SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+    ___________________________________________________________________________
+*/
+
+
+
+
+
+//=============================================================================
+//      Include files
+//-----------------------------------------------------------------------------
+#include "DriverHost.h"
+
+#if defined(__linux__)
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <linux/input.h>
+
+
+
+
+
+//=============================================================================
+//      Internal constants
+//-----------------------------------------------------------------------------
+#define kEvdevMaxButtons				32
+#define kEvdevMaxEvents					64
+
+//full deflection of a 3Dconnexion device is about 350 counts; as the Magellan backend
+#define kEvdevTranslationScale			(3.0f/4000.0f)
+#define kEvdevRotationScale				((10.0f/4000.0f)*(3.1415926535898f/180.0f))
+
+#define kEvdevLongBits					(sizeof(unsigned long)*8)
+#define kEvdevBitArraySize(_bits)		(((_bits)+kEvdevLongBits-1)/kEvdevLongBits)
+#define kEvdevTestBit(_array, _bit)		(((_array)[(_bit)/kEvdevLongBits] >> ((_bit)%kEvdevLongBits)) & 1UL)
+
+
+
+
+
+//=============================================================================
+//      Internal types
+//-----------------------------------------------------------------------------
+typedef struct TEvdevBackendData
+{
+	TQ3Boolean		is6DoF;
+	TQ3Boolean		isAbsolute;							//6-DoF deflection instead of deltas
+	TQ3Boolean		dropped;							//events were lost; resync at the next report
+	
+	signed char		keyToButton[KEY_CNT];				//-1: not a button
+	signed char		axisToValue[ABS_CNT];				//-1: not a value
+	float			valueMinimum[kDriverHostMaxValues];
+	float			valueScale[kDriverHostMaxValues];
+	
+	TQ3Uns32		buttons;
+	float			motion[6];
+	TQ3Boolean		motionChanged;
+	float			values[kDriverHostMaxValues];
+	TQ3Boolean		valuesChanged;
+} TEvdevBackendData;
+
+
+
+
+
+//=============================================================================
+//      Internal functions
+//-----------------------------------------------------------------------------
+//      EvdevBackend_SetValue : Store an absolute axis as a value in [-1, 1].
+//-----------------------------------------------------------------------------
+static void
+EvdevBackend_SetValue(TEvdevBackendData *data, int valueIndex, int rawValue)
+{
+	data->values[valueIndex] = ((float) rawValue - data->valueMinimum[valueIndex]) * data->valueScale[valueIndex] - 1.0f;
+	data->valuesChanged = kQ3True;
+}
+
+
+
+//=============================================================================
+//      EvdevBackend_IsDeflected : Is any absolute 6-DoF axis off zero?
+//-----------------------------------------------------------------------------
+static TQ3Boolean
+EvdevBackend_IsDeflected(const TEvdevBackendData *data)
+{
+	int		index;
+	
+	for (index=0; index<6; index++)
+		if (data->motion[index]!=0.0f)
+			return(kQ3True);
+	
+	return(kQ3False);
+}
+
+
+
+//=============================================================================
+//      EvdevBackend_Resync : Reread key and axis state after SYN_DROPPED.
+//-----------------------------------------------------------------------------
+static void
+EvdevBackend_Resync(TDriverDevice *device)
+{
+	TEvdevBackendData	*data = (TEvdevBackendData *) device->backendData;
+	unsigned long		keyState[kEvdevBitArraySize(KEY_CNT)];
+	struct input_absinfo	absInfo;
+	int					code;
+	
+	memset(keyState, 0, sizeof(keyState));
+	if (ioctl(device->fileDescriptor, EVIOCGKEY(sizeof(keyState)), keyState)>=0)
+	{
+		data->buttons = 0;
+		for (code=0; code<KEY_CNT; code++)
+			if ((data->keyToButton[code]>=0) && kEvdevTestBit(keyState, code))
+				data->buttons |= (1UL << data->keyToButton[code]);
+	}
+	
+	for (code=0; code<ABS_CNT; code++)
+	{
+		if (ioctl(device->fileDescriptor, EVIOCGABS(code), &absInfo)<0)
+			continue;
+		
+		if (data->axisToValue[code]>=0)
+			EvdevBackend_SetValue(data, data->axisToValue[code], absInfo.value);
+		else if (data->is6DoF && data->isAbsolute && (code<=ABS_RZ))
+			data->motion[code] = (float) absInfo.value;
+	}
+	
+	//relative motion of the lost events is gone
+	if (!data->isAbsolute)
+		memset(data->motion, 0, sizeof(data->motion));
+}
+
+
+
+//=============================================================================
+//      EvdevBackend_Report : Hand one complete event frame to the host.
+//-----------------------------------------------------------------------------
+static void
+EvdevBackend_Report(TDriverDevice *device)
+{
+	TEvdevBackendData	*data = (TEvdevBackendData *) device->backendData;
+	
+	if (data->motionChanged)
+	{
+		DriverHost_ReportMotion(device, &data->motion[0], &data->motion[3]);
+		if (!data->isAbsolute)
+			memset(data->motion, 0, sizeof(data->motion));
+		data->motionChanged = kQ3False;
+	}
+	
+	if (data->valuesChanged)
+	{
+		DriverHost_ReportValues(device, 0, device->valueCount, data->values);
+		data->valuesChanged = kQ3False;
+	}
+	
+	//after the motion of the frame, so the edge follows it
+	DriverHost_ReportButtons(device, data->buttons);
+	
+	//a held deflection is repeated, unless the next frame comes first
+	if (data->isAbsolute)
+		device->serviceTime = EvdevBackend_IsDeflected(data) ? DriverHost_Now() + device->repeatInterval : 0.0;
+}
+
+
+
+//=============================================================================
+//      EvdevBackend_Open : Open an event device and classify it.
+//-----------------------------------------------------------------------------
+static TQ3Status
+EvdevBackend_Open(TDriverDevice *device, const char *path)
+{
+	TEvdevBackendData		*data;
+	unsigned long			relBits[kEvdevBitArraySize(REL_CNT)];
+	unsigned long			absBits[kEvdevBitArraySize(ABS_CNT)];
+	unsigned long			keyBits[kEvdevBitArraySize(KEY_CNT)];
+	struct input_absinfo	absInfo;
+	char					name[128];
+	int						code, buttonCount = 0;
+	TQ3Boolean				hasRelRotation, hasAbs6DoF, isJoystick;
+	
+	data = (TEvdevBackendData *) calloc(1, sizeof(TEvdevBackendData));
+	if (data==NULL)
+		return(kQ3Failure);
+	
+	device->fileDescriptor = open(path, O_RDONLY | O_NONBLOCK);
+	if (device->fileDescriptor==-1)
+	{
+		fprintf(stderr, "evdev: cannot open %s - %s(%d)\n", path, strerror(errno), errno);
+		free(data);
+		return(kQ3Failure);
+	}
+	
+	memset(relBits, 0, sizeof(relBits));
+	memset(absBits, 0, sizeof(absBits));
+	memset(keyBits, 0, sizeof(keyBits));
+	memset(name, 0, sizeof(name));
+	if ((ioctl(device->fileDescriptor, EVIOCGNAME(sizeof(name)-1), name)<0)
+	||  (ioctl(device->fileDescriptor, EVIOCGBIT(EV_REL, sizeof(relBits)), relBits)<0)
+	||  (ioctl(device->fileDescriptor, EVIOCGBIT(EV_ABS, sizeof(absBits)), absBits)<0)
+	||  (ioctl(device->fileDescriptor, EVIOCGBIT(EV_KEY, sizeof(keyBits)), keyBits)<0))
+	{
+		fprintf(stderr, "evdev: %s is not an event device\n", path);
+		close(device->fileDescriptor);
+		free(data);
+		return(kQ3Failure);
+	}
+	
+	hasRelRotation	= (kEvdevTestBit(relBits, REL_RX) && kEvdevTestBit(relBits, REL_RY) && kEvdevTestBit(relBits, REL_RZ)) ? kQ3True : kQ3False;
+	hasAbs6DoF		= kQ3True;
+	for (code=ABS_X; code<=ABS_RZ; code++)
+		if (!kEvdevTestBit(absBits, code))
+			hasAbs6DoF = kQ3False;
+	isJoystick		= (kEvdevTestBit(keyBits, BTN_GAMEPAD) || kEvdevTestBit(keyBits, BTN_JOYSTICK)) ? kQ3True : kQ3False;
+	
+	data->is6DoF		= (hasRelRotation || (hasAbs6DoF && !isJoystick)) ? kQ3True : kQ3False;
+	data->isAbsolute	= (data->is6DoF && !hasRelRotation) ? kQ3True : kQ3False;
+	
+	//buttons in declaration order
+	for (code=0; code<KEY_CNT; code++)
+	{
+		data->keyToButton[code] = -1;
+		if (kEvdevTestBit(keyBits, code) && (buttonCount<kEvdevMaxButtons))
+			data->keyToButton[code] = (signed char) buttonCount++;
+	}
+	
+	//absolute axes of a gamepad or joystick are values
+	device->valueCount = 0;
+	for (code=0; code<ABS_CNT; code++)
+	{
+		data->axisToValue[code] = -1;
+		
+		if (data->is6DoF || !isJoystick || !kEvdevTestBit(absBits, code) || (device->valueCount>=kDriverHostMaxValues))
+			continue;
+		
+		if ((ioctl(device->fileDescriptor, EVIOCGABS(code), &absInfo)<0) || (absInfo.maximum<=absInfo.minimum))
+			continue;
+		
+		data->axisToValue[code]						= (signed char) device->valueCount;
+		data->valueMinimum[device->valueCount]		= (float) absInfo.minimum;
+		data->valueScale[device->valueCount]		= 2.0f / (float) (absInfo.maximum - absInfo.minimum);
+		device->valueCount++;
+	}
+	
+	//keyboards, mice, touchpads, accelerometers and the like are left to the system
+	if (!data->is6DoF && (!isJoystick || (device->valueCount==0)))
+	{
+		close(device->fileDescriptor);
+		free(data);
+		return(kQ3Failure);
+	}
+	
+	device->backendData			= data;
+	device->translationScale	= kEvdevTranslationScale;
+	device->rotationScale		= kEvdevRotationScale;
+	snprintf(device->signature, kDriverHostSignatureSize, "%s:evdev:", name);
+	
+	EvdevBackend_Resync(device);
+	data->valuesChanged = (device->valueCount>0) ? kQ3True : kQ3False;
+	data->motionChanged = kQ3False;
+	
+	return(kQ3Success);
+}
+
+
+
+//=============================================================================
+//      EvdevBackend_Close : Close the event device.
+//-----------------------------------------------------------------------------
+static void
+EvdevBackend_Close(TDriverDevice *device)
+{
+	if (device->fileDescriptor!=-1)
+	{
+		close(device->fileDescriptor);
+		device->fileDescriptor = -1;
+	}
+	
+	free(device->backendData);
+	device->backendData = NULL;
+}
+
+
+
+//=============================================================================
+//      EvdevBackend_Service : Repeat a held absolute deflection.
+//-----------------------------------------------------------------------------
+static TQ3Status
+EvdevBackend_Service(TDriverDevice *device, double now)
+{
+	TEvdevBackendData	*data = (TEvdevBackendData *) device->backendData;
+	
+	if (data->isAbsolute && EvdevBackend_IsDeflected(data))
+	{
+		DriverHost_ReportMotion(device, &data->motion[0], &data->motion[3]);
+		device->serviceTime = now + device->repeatInterval;
+	}
+	
+	return(kQ3Success);
+}
+
+
+
+//=============================================================================
+//      EvdevBackend_Read : Read all pending events.
+//-----------------------------------------------------------------------------
+static TQ3Status
+EvdevBackend_Read(TDriverDevice *device)
+{
+	TEvdevBackendData	*data = (TEvdevBackendData *) device->backendData;
+	struct input_event	events[kEvdevMaxEvents];
+	ssize_t				byteCount;
+	size_t				index, eventCount;
+	
+	while (1)
+	{
+		byteCount = read(device->fileDescriptor, events, sizeof(events));
+		if (byteCount<0)
+		{
+			if (errno==EINTR)
+				continue;
+			
+			//ENODEV: unplugged
+			return((errno==EAGAIN) ? kQ3Success : kQ3Failure);
+		}
+		if (byteCount==0)
+			return(kQ3Failure);
+		
+		eventCount = (size_t) byteCount / sizeof(struct input_event);
+		for (index=0; index<eventCount; index++)
+		{
+			const struct input_event *event = &events[index];
+			
+			if (event->type==EV_SYN)
+			{
+				if (event->code==SYN_DROPPED)
+					data->dropped = kQ3True;
+				else if (event->code==SYN_REPORT)
+				{
+					if (data->dropped)
+					{
+						EvdevBackend_Resync(device);
+						data->dropped		= kQ3False;
+						data->motionChanged	= data->isAbsolute;
+					}
+					EvdevBackend_Report(device);
+				}
+				continue;
+			}
+			
+			//until the resync, events describe a state that was partly lost
+			if (data->dropped)
+				continue;
+			
+			switch (event->type)
+			{
+				case EV_KEY:
+					if ((event->code<KEY_CNT) && (data->keyToButton[event->code]>=0))
+					{
+						if (event->value!=0)
+							data->buttons |=  (1UL << data->keyToButton[event->code]);
+						else
+							data->buttons &= ~(1UL << data->keyToButton[event->code]);
+					}
+					break;
+				
+				case EV_REL:
+					if (data->is6DoF && !data->isAbsolute && (event->code<=REL_RZ))
+					{
+						data->motion[event->code] += (float) event->value;
+						data->motionChanged = kQ3True;
+					}
+					break;
+				
+				case EV_ABS:
+					if (event->code>=ABS_CNT)
+						break;
+					if (data->axisToValue[event->code]>=0)
+						EvdevBackend_SetValue(data, data->axisToValue[event->code], event->value);
+					else if (data->isAbsolute && (event->code<=ABS_RZ))
+					{
+						data->motion[event->code] = (float) event->value;
+						data->motionChanged = kQ3True;
+					}
+					break;
+				
+				default:
+					break;
+			}
+		}
+		
+		if (byteCount < (ssize_t) sizeof(events))
+			return(kQ3Success);
+	}
+}
+
+
+
+
+
+//=============================================================================
+//      Public variables
+//-----------------------------------------------------------------------------
+const TDriverBackend kDriverBackendEvdev =
+{
+	"evdev",
+	EvdevBackend_Open,
+	EvdevBackend_Close,
+	EvdevBackend_Read,
+	EvdevBackend_Service
+};
+
+#endif
@@ -0,0 +1,352 @@
+/*  NAME:
+        MagellanBackend.c
+
+    DESCRIPTION:
+        DriverHost backend for the Magellan/SpaceMouse (grey model; RS232).
+		
+		The serial setup follows SPCMObject; replies are read straight into the
+		ring of a MagellanParser and decoded in place.
+      
+    COPYRIGHT:
+        Copyright (c) 1999-2005, Quesa Developers. All rights reserved.
+
+        For the current release of Quesa, please see:
+
+            <http://www.quesa.org/>
+        
+        Redistribution and use in source and binary forms, with or without
+        modification, are permitted provided that the following conditions
+        are met:
+        
+            o Redistributions of source code must retain the above copyright
+              notice, this list of conditions and the following disclaimer.
+        
+            o Redistributions in binary form must reproduce the above
+              copyright notice, this list of conditions and the following
+              disclaimer in the documentation and/or other materials provided
+              with the distribution.
+        
+            o Neither the name of Quesa nor the names of its contributors
+              may be used to endorse or promote products derived from this
+              software without specific prior written permission.
+        
+        THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+        "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+        LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+        A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+        OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+        SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+        TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+        PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+        LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+        NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+        SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+    ___________________________________________________________________________
+*/
+
+
+
+
+
+//=============================================================================
+//      Include files
+//-----------------------------------------------------------------------------
+#include "DriverHost.h"
+#include "MagellanParser.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <termios.h>
+
+
+
+
+
+//=============================================================================
+//      Internal constants
+//-----------------------------------------------------------------------------
+//SPCMObject defaults: rotScale 10, transScale 3, over a base of 4000 counts
+#define kMagellanTranslationScale		(3.0f/4000.0f)
+#define kMagellanRotationScale			((10.0f/4000.0f)*(3.1415926535898f/180.0f))
+
+#define kMagellanSignature				"Magellan SpaceMouse:Logitech:"
+
+//the sync is repeated until the device echoes it; without an echo the device
+//is configured anyway after kMagellanSyncTimeout, as the old fixed sleeps did
+#define kMagellanSyncRetry				0.2		//seconds
+#define kMagellanSyncTimeout			2.0		//seconds
+
+typedef enum TMagellanInitState
+{
+	kMagellanInitSync,								//sync sent, waiting for its echo
+	kMagellanInitDone
+} TMagellanInitState;
+
+
+
+
+
+//=============================================================================
+//      Internal types
+//-----------------------------------------------------------------------------
+typedef struct TMagellanBackendData
+{
+	TMagellanParser		parser;
+	struct termios		originalAttributes;
+	TMagellanInitState	initState;
+	double				syncDeadline;					//DriverHost_Now time to give up waiting for the echo
+} TMagellanBackendData;
+
+
+
+
+
+//=============================================================================
+//      Internal functions
+//-----------------------------------------------------------------------------
+//      MagellanBackend_Transmit : Send a command.
+//-----------------------------------------------------------------------------
+static void
+MagellanBackend_Transmit(TDriverDevice *device, const char *command, size_t length)
+{
+	ssize_t		written;
+	
+	written = write(device->fileDescriptor, command, length);
+	(void) written;
+}
+
+
+
+//=============================================================================
+//      MagellanBackend_Configure : Zero the device and send the settings.
+//-----------------------------------------------------------------------------
+//		Note : Translation and rotation on, data rate 60..180 ms, as
+//				SPCMObject connectToDevice. Ends the initialization.
+//-----------------------------------------------------------------------------
+static void
+MagellanBackend_Configure(TDriverDevice *device)
+{
+	TMagellanBackendData	*data = (TMagellanBackendData *) device->backendData;
+	char					command[4];
+	
+	data->initState		= kMagellanInitDone;
+	device->serviceTime	= 0.0;
+	
+	MagellanBackend_Transmit(device, "z\r", 2);
+	
+	command[0] = 'm';
+	command[1] = MagellanParser_NibbleToChar(3);
+	command[2] = '\r';
+	MagellanBackend_Transmit(device, command, 3);
+	
+	command[0] = 'p';
+	command[1] = MagellanParser_NibbleToChar(8);
+	command[2] = MagellanParser_NibbleToChar(2);
+	command[3] = '\r';
+	MagellanBackend_Transmit(device, command, 4);
+}
+
+
+
+//=============================================================================
+//      MagellanBackend_EventProc : Report a decoded reply to the host.
+//-----------------------------------------------------------------------------
+static void
+MagellanBackend_EventProc(const TMagellanEvent *event, void *refCon)
+{
+	TDriverDevice	*device = (TDriverDevice *) refCon;
+	float			translation[3], rotation[3];
+	
+	switch (event->type)
+	{
+		case kMagellanEventMotion:
+			translation[0]	= event->axes[0];
+			translation[1]	= event->axes[1];
+			translation[2]	= event->axes[2];
+			rotation[0]		= event->axes[3];
+			rotation[1]		= event->axes[4];
+			rotation[2]		= event->axes[5];
+			DriverHost_ReportMotion(device, translation, rotation);
+			break;
+		
+		case kMagellanEventKeys:
+			DriverHost_ReportButtons(device, event->keys);
+			break;
+		
+		//the echo of the sync: the device is up, no need to wait any longer
+		case kMagellanEventZero:
+			if (((TMagellanBackendData *) device->backendData)->initState==kMagellanInitSync)
+				MagellanBackend_Configure(device);
+			break;
+		
+		default:
+			break;
+	}
+}
+
+
+
+//=============================================================================
+//      MagellanBackend_Open : Open and initialize the serial port.
+//-----------------------------------------------------------------------------
+static TQ3Status
+MagellanBackend_Open(TDriverDevice *device, const char *path)
+{
+	TMagellanBackendData	*data;
+	struct termios			options;
+	
+	data = (TMagellanBackendData *) calloc(1, sizeof(TMagellanBackendData));
+	if (data==NULL)
+		return(kQ3Failure);
+	
+	device->fileDescriptor = open(path, O_RDWR | O_NOCTTY | O_NDELAY);
+	if (device->fileDescriptor==-1)
+	{
+		fprintf(stderr, "magellan: cannot open %s - %s(%d)\n", path, strerror(errno), errno);
+		free(data);
+		return(kQ3Failure);
+	}
+	
+	//blocking writes; reads only happen after select
+	if ((fcntl(device->fileDescriptor, F_SETFL, 0)==-1)
+	||  (tcgetattr(device->fileDescriptor, &data->originalAttributes)==-1))
+	{
+		fprintf(stderr, "magellan: cannot set up %s - %s(%d)\n", path, strerror(errno), errno);
+		close(device->fileDescriptor);
+		free(data);
+		return(kQ3Failure);
+	}
+	
+	options = data->originalAttributes;
+	cfsetispeed(&options, B9600);
+	cfsetospeed(&options, B9600);
+	options.c_cflag		|= (CREAD | CS8 | CSTOPB | HUPCL | CRTSCTS);
+	options.c_lflag		 = 0;
+	options.c_iflag		 = 0;
+	options.c_oflag		&= ~OPOST;
+	options.c_cc[VMIN]	 = 1;
+	options.c_cc[VTIME]	 = 0;
+	
+	if (tcsetattr(device->fileDescriptor, TCSANOW, &options)==-1)
+	{
+		fprintf(stderr, "magellan: cannot set tty attributes of %s - %s(%d)\n", path, strerror(errno), errno);
+		close(device->fileDescriptor);
+		free(data);
+		return(kQ3Failure);
+	}
+	
+	MagellanParser_Init(&data->parser);
+	device->backendData			= data;
+	device->translationScale	= kMagellanTranslationScale;
+	device->rotationScale		= kMagellanRotationScale;
+	device->valueCount			= 0;
+	strcpy(device->signature, kMagellanSignature);
+	
+	//the rest of the initialization follows the echo, or MagellanBackend_Service's
+	//retries; the host loop never sleeps. The sync also sets the device to 9600 Baud.
+	data->initState		= kMagellanInitSync;
+	data->syncDeadline	= DriverHost_Now() + kMagellanSyncTimeout;
+	device->serviceTime	= DriverHost_Now() + kMagellanSyncRetry;
+	MagellanBackend_Transmit(device, "z\r\r", 3);
+	
+	return(kQ3Success);
+}
+
+
+
+//=============================================================================
+//      MagellanBackend_Service : Repeat the sync until it is echoed.
+//-----------------------------------------------------------------------------
+//		Note : A device still powering up ignores the first syncs. One that
+//				never echoes is configured at syncDeadline, as before.
+//-----------------------------------------------------------------------------
+static TQ3Status
+MagellanBackend_Service(TDriverDevice *device, double now)
+{
+	TMagellanBackendData	*data = (TMagellanBackendData *) device->backendData;
+	
+	if (data->initState!=kMagellanInitSync)
+		return(kQ3Success);
+	
+	if (now>=data->syncDeadline)
+	{
+		MagellanBackend_Configure(device);
+		return(kQ3Success);
+	}
+	
+	MagellanBackend_Transmit(device, "z\r\r", 3);
+	device->serviceTime = now + kMagellanSyncRetry;
+	if (device->serviceTime>data->syncDeadline)
+		device->serviceTime = data->syncDeadline;
+	
+	return(kQ3Success);
+}
+
+
+
+//=============================================================================
+//      MagellanBackend_Close : Restore and close the serial port.
+//-----------------------------------------------------------------------------
+static void
+MagellanBackend_Close(TDriverDevice *device)
+{
+	TMagellanBackendData	*data = (TMagellanBackendData *) device->backendData;
+	
+	if (device->fileDescriptor!=-1)
+	{
+		tcsetattr(device->fileDescriptor, TCSANOW, &data->originalAttributes);
+		close(device->fileDescriptor);
+		device->fileDescriptor = -1;
+	}
+	
+	free(data);
+	device->backendData = NULL;
+}
+
+
+
+//=============================================================================
+//      MagellanBackend_Read : Read and decode what the port has.
+//-----------------------------------------------------------------------------
+static TQ3Status
+MagellanBackend_Read(TDriverDevice *device)
+{
+	TMagellanBackendData	*data = (TMagellanBackendData *) device->backendData;
+	uint32_t				freeSize;
+	uint8_t					*buffer;
+	ssize_t					byteCount;
+	
+	buffer		= MagellanParser_WriteBuffer(&data->parser, &freeSize);
+	byteCount	= read(device->fileDescriptor, buffer, freeSize);
+	
+	if (byteCount<0)
+		return(((errno==EINTR) || (errno==EAGAIN)) ? kQ3Success : kQ3Failure);
+	
+	//end of file: the port went away
+	if (byteCount==0)
+		return(kQ3Failure);
+	
+	MagellanParser_Commit(&data->parser, (uint32_t) byteCount);
+	MagellanParser_Parse(&data->parser, MagellanBackend_EventProc, device);
+	return(kQ3Success);
+}
+
+
+
+
+
+//=============================================================================
+//      Public variables
+//-----------------------------------------------------------------------------
+const TDriverBackend kDriverBackendMagellan =
+{
+	"magellan",
+	MagellanBackend_Open,
+	MagellanBackend_Close,
+	MagellanBackend_Read,
+	MagellanBackend_Service
+};
@@ -0,0 +1,292 @@
+/*  NAME:
+        ControllerBlobs.c
+
+    DESCRIPTION:
+        Content addressed store for saved controller channel data.
+		
+		Channel data is stored once per distinct contents and shared by
+		reference count, so that controller states hold blob ids only.
+      
+    COPYRIGHT:
+        Copyright (c) 1999-2005, Quesa Developers. All rights reserved.
+
+        For the current release of Quesa, please see:
+
+            <http://www.quesa.org/>
+        
+        Redistribution and use in source and binary forms, with or without
+        modification, are permitted provided that the following conditions
+        are met:
+        
+            o Redistributions of source code must retain the above copyright
+              notice, this list of conditions and the following disclaimer.
+        
+            o Redistributions in binary form must reproduce the above
+              copyright notice, this list of conditions and the following
+              disclaimer in the documentation and/or other materials provided
+              with the distribution.
+        
+            o Neither the name of Quesa nor the names of its contributors
+              may be used to endorse or promote products derived from this
+              software without specific prior written permission.
+        
+        THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+        "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+        LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+        A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+        OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+        SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+        TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+        PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+        LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+        NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+        SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+    ___________________________________________________________________________
+*/
+
+
+
+
+//=============================================================================
+//      Include files
+//-----------------------------------------------------------------------------
+#include <string.h>
+
+#include "ControllerBlobs.h"
+#include "IPCHandles.h"
+
+
+
+
+
+//=============================================================================
+//      Internal constants
+//-----------------------------------------------------------------------------
+#define kC3BlobsInitialBuckets			64
+#define kC3BlobsHashBasis				2166136261U		//FNV-1a
+#define kC3BlobsHashPrime				16777619U
+
+
+
+
+
+//=============================================================================
+//      Internal types
+//-----------------------------------------------------------------------------
+typedef struct TC3Blob
+{
+	CFDataRef				data;
+	TQ3Uns32				hash;
+	TQ3Uns32				refCount;
+	TQ3Uns32				blobId;
+	struct TC3Blob			*nextInBucket;
+} TC3Blob;
+
+
+
+
+
+//=============================================================================
+//      Internal globals
+//-----------------------------------------------------------------------------
+static TC3HandleTable		blobTable = kIPCHandleTableEmpty;
+static TC3Blob				**blobBuckets = NULL;
+static TQ3Uns32				blobBucketCount = 0;		//power of 2
+static TQ3Uns32				emptyBlobId = kIPCHandleNone;
+
+
+
+
+
+//=============================================================================
+//      Internal functions
+//-----------------------------------------------------------------------------
+#pragma mark -
+//=============================================================================
+//      ControllerBlobs_Hash : FNV-1a hash of bytes.
+//-----------------------------------------------------------------------------
+static TQ3Uns32
+ControllerBlobs_Hash(const UInt8 *bytes, CFIndex length)
+{
+	TQ3Uns32	hash = kC3BlobsHashBasis;
+	CFIndex		index;
+	
+	for (index=0; index<length; index++)
+	{
+		hash ^= bytes[index];
+		hash *= kC3BlobsHashPrime;
+	}
+	return(hash);
+}
+
+
+
+//=============================================================================
+//      ControllerBlobs_Grow : Double the buckets, rehash the blobs.
+//-----------------------------------------------------------------------------
+//		Note : On failure the old buckets stay; lookups just get slower.
+//-----------------------------------------------------------------------------
+static void
+ControllerBlobs_Grow(void)
+{
+	TQ3Uns32	newCount,bucket;
+	TC3Blob		**newBuckets;
+	
+	newCount = (blobBucketCount==0) ? kC3BlobsInitialBuckets : blobBucketCount*2;
+	newBuckets = (TC3Blob**)calloc(newCount,sizeof(TC3Blob*));
+	if (newBuckets==NULL)
+		return;
+	
+	for (bucket=0; bucket<blobBucketCount; bucket++)
+	{
+		TC3Blob *blob = blobBuckets[bucket];
+		
+		while (blob!=NULL)
+		{
+			TC3Blob *next = blob->nextInBucket;
+			
+			blob->nextInBucket = newBuckets[blob->hash & (newCount-1)];
+			newBuckets[blob->hash & (newCount-1)] = blob;
+			blob = next;
+		}
+	}
+	
+	if (blobBuckets!=NULL)
+		free(blobBuckets);
+	blobBuckets = newBuckets;
+	blobBucketCount = newCount;
+}
+
+
+
+
+
+//=============================================================================
+//      Public functions
+//-----------------------------------------------------------------------------
+#pragma mark -
+//=============================================================================
+//      ControllerBlobs_Intern : Blob for the contents of data.
+//-----------------------------------------------------------------------------
+//		Note : Identical contents always yield the same id while the blob
+//				is referenced, so callers compare contents by comparing ids.
+//-----------------------------------------------------------------------------
+TQ3Uns32
+ControllerBlobs_Intern(CFDataRef data)
+{
+	const UInt8	*bytes = NULL;
+	CFIndex		length = 0;
+	TQ3Uns32	hash;
+	TC3Blob		*blob;
+	
+	if (data!=NULL)
+	{
+		bytes = CFDataGetBytePtr(data);
+		length = CFDataGetLength(data);
+	}
+	hash = ControllerBlobs_Hash(bytes,length);
+	
+	//-known contents: one more reference
+	if (blobBucketCount!=0)
+		for (blob=blobBuckets[hash & (blobBucketCount-1)]; blob!=NULL; blob=blob->nextInBucket)
+			if ((blob->hash==hash)
+			 && (CFDataGetLength(blob->data)==length)
+			 && ((length==0) || (memcmp(CFDataGetBytePtr(blob->data),bytes,length)==0)))
+			{
+				blob->refCount++;
+				return(blob->blobId);
+			}
+	
+	//-new contents
+	if (blobTable.count>=blobBucketCount)
+		ControllerBlobs_Grow();
+	if (blobBucketCount==0)
+		return(kIPCHandleNone);
+	
+	blob = (TC3Blob*)malloc(sizeof(TC3Blob));
+	if (blob==NULL)
+		return(kIPCHandleNone);
+	
+	//an immutable copy of immutable data is just another reference to it
+	blob->data = (data!=NULL) ? CFDataCreateCopy(kCFAllocatorDefault,data) : CFDataCreate(kCFAllocatorDefault,NULL,0);
+	blob->hash = hash;
+	blob->refCount = 1;
+	blob->blobId = (blob->data!=NULL) ? IPCHandle_Insert(&blobTable,blob) : kIPCHandleNone;
+	if (blob->blobId==kIPCHandleNone)
+	{
+		if (blob->data!=NULL)
+			CFRelease(blob->data);
+		free(blob);
+		return(kIPCHandleNone);
+	}
+	
+	blob->nextInBucket = blobBuckets[hash & (blobBucketCount-1)];
+	blobBuckets[hash & (blobBucketCount-1)] = blob;
+	return(blob->blobId);
+}
+
+
+
+//=============================================================================
+//      ControllerBlobs_Empty : Blob of a channel in reset state.
+//-----------------------------------------------------------------------------
+TQ3Uns32
+ControllerBlobs_Empty(void)
+{
+	if (emptyBlobId==kIPCHandleNone)
+		emptyBlobId = ControllerBlobs_Intern(NULL);
+	return(emptyBlobId);
+}
+
+
+
+//=============================================================================
+//      ControllerBlobs_Retain : One more reference to blobId.
+//-----------------------------------------------------------------------------
+void
+ControllerBlobs_Retain(TQ3Uns32 blobId)
+{
+	TC3Blob *blob = (TC3Blob*)IPCHandle_Lookup(&blobTable,blobId);
+	
+	if (blob!=NULL)
+		blob->refCount++;
+}
+
+
+
+//=============================================================================
+//      ControllerBlobs_Release : Drop a reference, free the blob with the last.
+//-----------------------------------------------------------------------------
+void
+ControllerBlobs_Release(TQ3Uns32 blobId)
+{
+	TC3Blob *blob = (TC3Blob*)IPCHandle_Lookup(&blobTable,blobId);
+	TC3Blob **link;
+	
+	if ((blob==NULL) || (--blob->refCount!=0))
+		return;
+	
+	for (link=&blobBuckets[blob->hash & (blobBucketCount-1)]; *link!=NULL; link=&(*link)->nextInBucket)
+		if (*link==blob)
+		{
+			*link = blob->nextInBucket;
+			break;
+		}
+	
+	IPCHandle_Remove(&blobTable,blobId);
+	CFRelease(blob->data);
+	free(blob);
+}
+
+
+
+//=============================================================================
+//      ControllerBlobs_GetData : Contents of blobId.
+//-----------------------------------------------------------------------------
+CFDataRef
+ControllerBlobs_GetData(TQ3Uns32 blobId)
+{
+	TC3Blob *blob = (TC3Blob*)IPCHandle_Lookup(&blobTable,blobId);
+	
+	return((blob!=NULL) ? blob->data : NULL);
+}
@@ -55,6 +55,13 @@
 #include "IPCTracker.h"
 #include "IPCPackUnpack.h"
 #include "IPCDriver.h"
+#include "IPCAsync.h"
+#include "IPCHandles.h"
+#include "IPCSharedData.h"
+#include "ControllerJournal.h"
+#include "ControllerFilter.h"
+#include "ControllerBlobs.h"
+#include "ControllerStore.h"
 
 
 
@@ -66,6 +73,16 @@
 //-----------------------------------------------------------------------------
 // Internal constants go here
 
+#define kC3ChannelBit(channel)		(((TQ3Uns32)1)<<(channel))	//k3ChannelMask bits; kQ3MaxControllerChannels is 32
+
+#define kC3ConsumerRateWindow		2.0		//seconds client reads are averaged over
+
+//keys of a registry snapshot besides the IPC keys of the same values
+#define kC3SnapshotControllers		"Controllers"
+#define kC3SnapshotStates			"States"
+#define kC3SnapshotDecommissioned	"Decommissioned"
+#define kC3SnapshotController		"Controller"	//index into kC3SnapshotControllers
+
 
 
 
@@ -100,15 +117,75 @@ typedef struct TC3ControllerPrivateData
 	TQ3Uns32	 			theButtons;
 	TQ3Uns32 				serialNumber;
 	CFStringRef				driverPortName;
+	TQ3Uns32				driverHandle;			//controller in the driver, for direct channel calls of clients
+	TQ3Uns32				driverToken;			//capability for those calls; 0: clients go through the server
 	CFStringRef				trackerPortName;
-	CFStringRef				trackerUUID;
+	TQ3Uns32				trackerHandle;		//kIPCHandleNone: no tracker
 	float					*valuesRef;		//pointer to field of float-values
 	TQ3Boolean				isActive;
 	TQ3Boolean				isDecommissioned;
+	TQ3Boolean				isRestored;				//taken from the store; the driver is checked on first use
+	TQ3ControllerRef		previousRef;			//ref before the server restarted; NULL: none
+	TQ3Uns32				consumerReads;			//client reads since consumerWindowStart
+	CFAbsoluteTime			consumerWindowStart;
+	float					consumerRate;			//client reads per second of the last window
+	TC3ControllerFilterPtr	valuesFilter;			//NULL: values are stored as sent
+	TC3ControllerFilterPtr	positionFilter;			//NULL: deltas are forwarded as sent
+	TC3ControllerFilterPtr	orientationFilter;
+	TQ3Uns32				channelShadow[kQ3MaxControllerChannels];	//blob of the live data; kIPCHandleNone: only the driver knows it
+	TQ3Uns32				channelSize[kQ3MaxControllerChannels];		//size of live data set through shared memory; 0: none
 	//return reasonable default values if referenced but decommissioned - not fully implemented
 	void			 		*nextPrivateData;	//NULL, if no next controller (linked list)
 } TC3ControllerPrivateData;
 
+typedef struct TC3ControllerStateData
+{
+	TQ3ControllerRef		controllerRef;		//controller the state was created for
+	TQ3Boolean				isSaved;
+	TQ3Uns32				channelCount;
+	TQ3Uns32				channelBlobs[kQ3MaxControllerChannels];	//saved data, one blob reference each
+} TC3ControllerStateData, *TC3ControllerStateDataPtr;
+
+enum
+{
+	kC3StateBatchDone				= 0,	//stateStatus holds the result
+	kC3StateBatchSent				= 1,	//waits for the reply of its driver
+	kC3StateBatchLater				= 2		//saved after the rest of the batch
+};
+
+typedef struct TC3StateBatchEntry
+{
+	TQ3ControllerRef		controllerRef;
+	TQ3Uns32				ctrlStateHandle;
+	TQ3Uns32				phase;
+	TQ3Uns32				mask;				//channels to read (save) or to set (restore)
+	TQ3Uns32				resetMask;			//save only
+	TQ3Uns32				channelCount;		//restore only
+	TQ3Uns32				driverIndex;
+	TC3IPCSharedData		shared;				//save only: large channels come back in it
+} TC3StateBatchEntry;
+
+typedef struct TC3StateBatchDriver
+{
+	struct TC3StateBatch	*batch;
+	CFStringRef				driverPortName;
+	CFMutableArrayRef		requests;			//in the order of the entries
+	TQ3Boolean				isDone;				//its reply, or failure, has been handled
+} TC3StateBatchDriver;
+
+typedef struct TC3StateBatch
+{
+	TQ3Boolean				isRestore;
+	TQ3Uns32				stateCount;
+	TQ3Uns32				driverCount;
+	TQ3Uns32				pendingCount;		//driver requests without reply
+	TC3StateBatchEntry		*entry;
+	TC3StateBatchDriver		*driver;
+	TQ3Status				*stateStatus;
+	TC3StateBatchDoneProc	doneProc;
+	void					*userData;
+} TC3StateBatch, *TC3StateBatchPtr;
+
 
 
 //=============================================================================
@@ -129,7 +206,7 @@ in CGRemoteOperation.h! see: CGPostMouseEvent
 TQ3Uns32 						controllerListSerialNumber = 0;
 TC3ControllerPrivateDataPtr 	controllerListAnchor = NULL;
 
-CFMutableDictionaryRef			controllerStateDict = NULL;
+static TC3HandleTable			controllerStates = kIPCHandleTableEmpty;
 
 #pragma mark -
 
@@ -161,6 +238,121 @@ ControllerDB_refinlist(TQ3ControllerRef controllerRef)
 }
 
 
+
+//=============================================================================
+//      ControllerDB_BindFilter : Replace the filter pipeline of theController.
+//-----------------------------------------------------------------------------
+//		Note : stages==NULL removes it. Values and both tracker deltas get a
+//				pipeline of their own, as the smoothing state differs.
+//-----------------------------------------------------------------------------
+static void
+ControllerDB_BindFilter(TC3ControllerPrivateDataPtr theController, CFArrayRef stages)
+{
+	ControllerFilter_Dispose(theController->valuesFilter);
+	ControllerFilter_Dispose(theController->positionFilter);
+	ControllerFilter_Dispose(theController->orientationFilter);
+	
+	theController->valuesFilter = NULL;
+	theController->positionFilter = NULL;
+	theController->orientationFilter = NULL;
+	
+	if (stages==NULL)
+		return;
+	
+	if (theController->publicData.valueCount>0)
+		theController->valuesFilter = ControllerFilter_New(stages,theController->publicData.valueCount);
+	theController->positionFilter = ControllerFilter_New(stages,3);
+	theController->orientationFilter = ControllerFilter_New(stages,3);
+}
+
+
+
+//=============================================================================
+//      ControllerDB_ForgetPreviousRef : No restored controller answers to ref.
+//-----------------------------------------------------------------------------
+//		Note : A ref of this run that equals a ref of the last run is
+//				ambiguous; clients holding the old one have to re-enumerate.
+//-----------------------------------------------------------------------------
+static void
+ControllerDB_ForgetPreviousRef(TC3ControllerPrivateDataPtr theController)
+{
+	TC3ControllerPrivateDataPtr currentObj;
+	
+	for (currentObj=controllerListAnchor; currentObj!=NULL; currentObj=(TC3ControllerPrivateDataPtr)currentObj->nextPrivateData)
+		if (currentObj->previousRef==(TQ3ControllerRef)theController)
+			currentObj->previousRef=NULL;
+}
+
+
+
+//=============================================================================
+//      ControllerDB_ShadowSet : Note blob as live data of channel.
+//-----------------------------------------------------------------------------
+//		Note : Takes over the reference to blobId; kIPCHandleNone makes the
+//				channel unknown, so the driver is asked the next time.
+//-----------------------------------------------------------------------------
+static void
+ControllerDB_ShadowSet(TC3ControllerPrivateDataPtr theController, TQ3Uns32 channel, TQ3Uns32 blobId)
+{
+	TQ3Uns32 *shadow = &theController->channelShadow[channel];
+	
+	if (*shadow!=kIPCHandleNone)
+		ControllerBlobs_Release(*shadow);
+	*shadow = blobId;
+	theController->channelSize[channel] = 0;
+}
+
+
+
+//=============================================================================
+//      ControllerDB_ShadowStore : Note data as live data of channel.
+//-----------------------------------------------------------------------------
+//		Note : data==NULL or empty data is the state after a reset.
+//-----------------------------------------------------------------------------
+static void
+ControllerDB_ShadowStore(TC3ControllerPrivateDataPtr theController, TQ3Uns32 channel, CFDataRef data)
+{
+	if (channel>=theController->publicData.channelCount)
+		return;
+	
+	ControllerDB_ShadowSet(theController,channel,ControllerBlobs_Intern(data));
+}
+
+
+
+//=============================================================================
+//      ControllerDB_ShadowForget : Forget the live data of channel.
+//-----------------------------------------------------------------------------
+//		Note : dataSize is the size of data set through shared memory, so a
+//				state save can make room for it; 0 if not known.
+//-----------------------------------------------------------------------------
+static void
+ControllerDB_ShadowForget(TC3ControllerPrivateDataPtr theController, TQ3Uns32 channel, TQ3Uns32 dataSize)
+{
+	if (channel>=kQ3MaxControllerChannels)
+		return;
+	
+	ControllerDB_ShadowSet(theController,channel,kIPCHandleNone);
+	theController->channelSize[channel] = dataSize;
+}
+
+
+
+//=============================================================================
+//      ControllerDB_ShadowInvalidate : Forget the live data of all channels.
+//-----------------------------------------------------------------------------
+//		Note : For a driver taken up again; its channels may hold anything.
+//-----------------------------------------------------------------------------
+static void
+ControllerDB_ShadowInvalidate(TC3ControllerPrivateDataPtr theController)
+{
+	TQ3Uns32 channel;
+	
+	for (channel=0; channel<kQ3MaxControllerChannels; channel++)
+		ControllerDB_ShadowSet(theController,channel,kIPCHandleNone);
+}
+
+
 //=============================================================================
 //      Public functions
 //-----------------------------------------------------------------------------
@@ -269,11 +461,24 @@ ControllerDB_New(const TQ3ControllerData *controllerData)
 		
 		//general Init
 		//newCtrl->trackerObject=NULL;
+		newCtrl->driverPortName=NULL;
+		newCtrl->driverHandle=kIPCHandleNone;
+		newCtrl->driverToken=0;
 		newCtrl->trackerPortName=NULL;	
-		newCtrl->trackerUUID=NULL;
+		newCtrl->trackerHandle=kIPCHandleNone;
 		
 		newCtrl->valuesRef=NULL;
 		
+		newCtrl->valuesFilter=NULL;
+		newCtrl->positionFilter=NULL;
+		newCtrl->orientationFilter=NULL;
+		
+		newCtrl->previousRef=NULL;
+		ControllerDB_ForgetPreviousRef(newCtrl);
+		
+		memset(newCtrl->channelShadow,0,sizeof(newCtrl->channelShadow));
+		memset(newCtrl->channelSize,0,sizeof(newCtrl->channelSize));
+		
 		newCtrl->publicData.valueCount=controllerData->valueCount;
 		newCtrl->publicData.channelCount=controllerData->channelCount;
 		newCtrl->publicData.channelGetMethod=controllerData->channelGetMethod;
@@ -328,14 +533,42 @@ ControllerDB_New(const TQ3ControllerData *controllerData)
 			}
 			currentObj->nextPrivateData=newCtrl;
 		}	
+		
+		//- filter pipeline the server preferences hold for the signature
+		{
+			CFStringRef	signature = CFStringCreateWithCString(kCFAllocatorDefault,newCtrl->publicData.signature,kCFStringEncodingASCII);
+			CFArrayRef	stages = NULL;
+			
+			if (signature!=NULL)
+			{
+				stages = ControllerFilter_CopyPreferredStages(signature);
+				CFRelease(signature);
+			}
+			if (stages!=NULL)
+			{
+				ControllerDB_BindFilter(newCtrl,stages);
+				CFRelease(stages);
+			}
+		}
 	}
 	
 	newCtrl->theButtons=0;
 	newCtrl->serialNumber=1;
 	newCtrl->isDecommissioned=kQ3False;
+	newCtrl->isRestored=kQ3False;
+	newCtrl->consumerReads=0;
+	newCtrl->consumerWindowStart=CFAbsoluteTimeGetCurrent();
+	newCtrl->consumerRate=0.0f;
+	
+	//a driver taken up again starts without history
+	ControllerDB_ShadowInvalidate(newCtrl);
+	ControllerFilter_Reset(newCtrl->valuesFilter);
+	ControllerFilter_Reset(newCtrl->positionFilter);
+	ControllerFilter_Reset(newCtrl->orientationFilter);
 
 	ControllerDB_SetActivation(newCtrl, kQ3True);
 	controllerListSerialNumber++;
+	ControllerStore_NoteChange();
 	
 	return(newCtrl);	// Return on Success: list element
 }
@@ -358,7 +591,68 @@ ControllerDB_SetDriverPortName(TQ3ControllerRef controllerRef,CFStringRef thePor
 	if (ControllerDB_refinlist(controllerRef)==kQ3True)
 		if (theController!=NULL)
 		{
+			if ((theController->driverPortName!=NULL) && (theController->driverPortName!=thePortName))
+				CFRelease(theController->driverPortName);
 			theController->driverPortName=thePortName;
+			ControllerStore_NoteChange();
+			status = kQ3Success;
+		}
+	return(status);
+}
+
+
+
+
+//=============================================================================
+//      ControllerDB_SetDriverToken : Note the capability a driver grants
+//				clients for direct channel calls.
+//-----------------------------------------------------------------------------
+//		Note : token 0 withdraws the direct path.
+//
+// private function
+//-----------------------------------------------------------------------------
+TQ3Status
+ControllerDB_SetDriverToken(TQ3ControllerRef controllerRef, TQ3Uns32 driverHandle, TQ3Uns32 token)
+{
+	TQ3Status status = kQ3Failure;
+	TC3ControllerPrivateDataPtr theController = (TC3ControllerPrivateDataPtr)controllerRef;
+	
+	if (ControllerDB_refinlist(controllerRef)==kQ3True)
+		if (theController!=NULL)
+		{
+			theController->driverHandle=(token!=0) ? driverHandle : kIPCHandleNone;
+			theController->driverToken=token;
+			ControllerStore_NoteChange();
+			status = kQ3Success;
+		}
+	return(status);
+}
+
+
+
+//=============================================================================
+//      ControllerDB_GetDriverEndpoint : Where a client may send the channel
+//				calls of a controller directly.
+//-----------------------------------------------------------------------------
+//		Note : Fails if the controller is decommissioned or its driver did
+//				not grant a token; the client then uses the server.
+//				portName is not retained.
+//-----------------------------------------------------------------------------
+TQ3Status
+ControllerDB_GetDriverEndpoint(TQ3ControllerRef controllerRef, CFStringRef *portName, TQ3Uns32 *driverHandle, TQ3Uns32 *token)
+{
+	TQ3Status status = kQ3Failure;
+	TC3ControllerPrivateDataPtr theController = (TC3ControllerPrivateDataPtr)controllerRef;
+	
+	if (ControllerDB_refinlist(controllerRef)==kQ3True)
+		if ((theController!=NULL)
+		 && (theController->isDecommissioned==kQ3False)
+		 && (theController->driverPortName!=NULL)
+		 && (theController->driverToken!=0))
+		{
+			*portName = theController->driverPortName;
+			*driverHandle = theController->driverHandle;
+			*token = theController->driverToken;
 			status = kQ3Success;
 		}
 	return(status);
@@ -380,8 +674,13 @@ ControllerDB_Decommission(TQ3ControllerRef controllerRef)
 	if (ControllerDB_refinlist(controllerRef)==kQ3True)
 		if (theController!=NULL)
 		{
+			ControllerJournal_Record(controllerRef,&theController->publicData,kC3JournalDecommission,NULL,0);
+			ControllerFilter_Reset(theController->valuesFilter);
+			ControllerFilter_Reset(theController->positionFilter);
+			ControllerFilter_Reset(theController->orientationFilter);
 			status = ControllerDB_SetActivation(theController,kQ3False);
 			theController->isDecommissioned=kQ3True;
+			ControllerStore_NoteChange();
 		}
 	return(status);
 }
@@ -406,12 +705,14 @@ ControllerDB_SetActivation(TQ3ControllerRef controllerRef, TQ3Boolean active)
 	if (ControllerDB_refinlist(controllerRef)==kQ3True)
 		if (theController!=NULL)
 		{
+			ControllerJournal_Record(controllerRef,&theController->publicData,kC3JournalActivation,&active,sizeof(TQ3Boolean));
 			theController->isActive = active;
 			//lock
 			controllerListSerialNumber++;		//copy-on-write
 			//unlock
-			if (theController->trackerUUID!=NULL)
-				IPCTracker_callNotification(theController->trackerUUID,
+			ControllerStore_NoteChange();
+			if (theController->trackerHandle!=kIPCHandleNone)
+				IPCTracker_callNotification(theController->trackerHandle,
 											theController->trackerPortName,
 											theController);
 			status = kQ3Success;
@@ -515,6 +816,31 @@ ControllerDB_SetChannel(TQ3ControllerRef controllerRef, CFMutableDictionaryRef d
 				CFRelease(MethodRef);
 				
 				status = IPCDriver_Send(m3ControllerDriver_SetChannel,theController->driverPortName,dict,returnDict);
+				
+				//what the driver accepted is the live data of the channel
+				if (status==kQ3Success)
+				{
+					CFDictionaryRef methodsReturn = (CFDictionaryRef)CFDictionaryGetValue(returnDict,CFSTR(k3MethodsReturn));
+					TQ3Status		methodStatus = kQ3Failure;
+					TQ3Uns32		channel;
+					
+					if ((methodsReturn!=NULL) && (CFDictionaryGetValue(methodsReturn,CFSTR(k3Status))!=NULL))
+						IPCGetTQ3Uns32(methodsReturn,CFSTR(k3Status),(TQ3Uns32*)&methodStatus);
+					if ((methodStatus==kQ3Success) && (CFDictionaryGetValue(dict,CFSTR(k3Channel))!=NULL))
+					{
+						TQ3Uns32		dataSize = 0;
+						
+						IPCGetTQ3Uns32(dict,CFSTR(k3Channel),&channel);
+						if (CFDictionaryGetValue(dict,CFSTR(k3DataSize))!=NULL)
+							IPCGetTQ3Uns32(dict,CFSTR(k3DataSize),&dataSize);
+						
+						//data passed in shared memory is too large to be shadowed
+						if (CFDictionaryGetValue(dict,CFSTR(k3DataShm))!=NULL)
+							ControllerDB_ShadowForget(theController,channel,dataSize);
+						else
+							ControllerDB_ShadowStore(theController,channel,(CFDataRef)CFDictionaryGetValue(dict,CFSTR(k3Data)));
+					}
+				}
 			}	
 	return(status);
 }
@@ -547,6 +873,128 @@ ControllerDB_GetChannel(TQ3ControllerRef controllerRef, CFMutableDictionaryRef d
 				CFRelease(MethodRef);
 				
 				status = IPCDriver_Send(m3ControllerDriver_GetChannel,theController->driverPortName,dict,returnDict);
+				
+				if (status==kQ3Success)
+				{
+					CFDictionaryRef methodsReturn = (CFDictionaryRef)CFDictionaryGetValue(returnDict,CFSTR(k3MethodsReturn));
+					TQ3Status		methodStatus = kQ3Failure;
+					TQ3Uns32		channel;
+					
+					if ((methodsReturn!=NULL) && (CFDictionaryGetValue(methodsReturn,CFSTR(k3Status))!=NULL))
+						IPCGetTQ3Uns32(methodsReturn,CFSTR(k3Status),(TQ3Uns32*)&methodStatus);
+					if ((methodStatus==kQ3Success) && (CFDictionaryGetValue(methodsReturn,CFSTR(k3Data))!=NULL))
+					{
+						IPCGetTQ3Uns32(dict,CFSTR(k3Channel),&channel);
+						ControllerDB_ShadowStore(theController,channel,(CFDataRef)CFDictionaryGetValue(methodsReturn,CFSTR(k3Data)));
+					}
+				}
+			}	
+	return(status);
+}
+
+
+
+
+//=============================================================================
+//      ControllerDB_ShadowChannels : Note the channels a driver accepted or
+//				delivered in one SetChannels or GetChannels.
+//-----------------------------------------------------------------------------
+//		Note : For SetChannels the data is taken from the request entries,
+//				for GetChannels from the reply entries.
+//-----------------------------------------------------------------------------
+static void
+ControllerDB_ShadowChannels(TC3ControllerPrivateDataPtr theController, CFDictionaryRef dict, CFDictionaryRef returnDict, TQ3Boolean fromRequest)
+{
+	CFDictionaryRef	methodsReturn = (CFDictionaryRef)CFDictionaryGetValue(returnDict,CFSTR(k3MethodsReturn));
+	CFArrayRef		requests = (CFArrayRef)CFDictionaryGetValue(dict,CFSTR(k3Channels));
+	CFArrayRef		replies = NULL;
+	CFIndex			index;
+	
+	if (methodsReturn!=NULL)
+		replies = (CFArrayRef)CFDictionaryGetValue(methodsReturn,CFSTR(k3Channels));
+	if ((requests==NULL) || (replies==NULL))
+		return;
+	
+	for (index=0; (index<CFArrayGetCount(replies)) && (index<CFArrayGetCount(requests)); index++)
+	{
+		CFDictionaryRef	reply = (CFDictionaryRef)CFArrayGetValueAtIndex(replies,index);
+		CFDictionaryRef	source = (fromRequest==kQ3True) ? (CFDictionaryRef)CFArrayGetValueAtIndex(requests,index) : reply;
+		TQ3Status		methodStatus = kQ3Failure;
+		TQ3Uns32		channel;
+		
+		IPCGetTQ3Uns32(reply,CFSTR(k3Status),(TQ3Uns32*)&methodStatus);
+		if ((methodStatus==kQ3Success) && (IPCGetTQ3Uns32(reply,CFSTR(k3Channel),&channel)))
+		{
+			if ((fromRequest==kQ3False) && (CFDictionaryGetValue(source,CFSTR(k3Data))==NULL))
+				continue;
+			ControllerDB_ShadowStore(theController,channel,(CFDataRef)CFDictionaryGetValue(source,CFSTR(k3Data)));
+		}
+	}
+}
+
+
+
+//=============================================================================
+//      ControllerDB_SetChannels : ControllerDB_SetChannel for many channels.
+//-----------------------------------------------------------------------------
+//		Note : dict holds the channels in k3Channels; they reach the driver
+//				with one message.
+//-----------------------------------------------------------------------------
+TQ3Status
+ControllerDB_SetChannels(TQ3ControllerRef controllerRef, CFMutableDictionaryRef dict, CFMutableDictionaryRef returnDict)
+{
+	TQ3Status status = kQ3Failure;
+	TC3ControllerPrivateDataPtr theController = (TC3ControllerPrivateDataPtr)controllerRef;
+	
+	if (ControllerDB_refinlist(controllerRef)==kQ3True)
+		if (theController!=NULL)
+			if (theController->publicData.channelSetMethod!=NULL)
+			{
+				//insert Method into dictionary
+				CFDataRef MethodRef = CFDataCreate(	kCFAllocatorDefault, 
+													(UInt8*)&theController->publicData.channelSetMethod,
+													sizeof(TQ3ChannelSetMethod));
+				CFDictionarySetValue(dict,CFSTR(k3MethodRef),MethodRef);
+				CFRelease(MethodRef);
+				
+				status = IPCDriver_Send(m3ControllerDriver_SetChannels,theController->driverPortName,dict,returnDict);
+				
+				//what the driver accepted is the live data of the channels
+				if (status==kQ3Success)
+					ControllerDB_ShadowChannels(theController,dict,returnDict,kQ3True);
+			}	
+	return(status);
+}
+
+
+
+//=============================================================================
+//      ControllerDB_GetChannels : ControllerDB_GetChannel for many channels.
+//-----------------------------------------------------------------------------
+//		Note : dict holds the channels in k3Channels; they reach the driver
+//				with one message.
+//-----------------------------------------------------------------------------
+TQ3Status
+ControllerDB_GetChannels(TQ3ControllerRef controllerRef, CFMutableDictionaryRef dict, CFMutableDictionaryRef returnDict)
+{
+	TQ3Status status = kQ3Failure;
+	TC3ControllerPrivateDataPtr theController = (TC3ControllerPrivateDataPtr)controllerRef;
+	
+	if (ControllerDB_refinlist(controllerRef)==kQ3True)
+		if (theController!=NULL)
+			if (theController->publicData.channelGetMethod!=NULL)
+			{
+				//insert Method into dictionary
+				CFDataRef MethodRef = CFDataCreate(	kCFAllocatorDefault, 
+													(UInt8*)&theController->publicData.channelGetMethod,
+													sizeof(TQ3ChannelGetMethod));
+				CFDictionarySetValue(dict,CFSTR(k3MethodRef),MethodRef);
+				CFRelease(MethodRef);
+				
+				status = IPCDriver_Send(m3ControllerDriver_GetChannels,theController->driverPortName,dict,returnDict);
+				
+				if (status==kQ3Success)
+					ControllerDB_ShadowChannels(theController,dict,returnDict,kQ3False);
 			}	
 	return(status);
 }
@@ -554,6 +1002,39 @@ ControllerDB_GetChannel(TQ3ControllerRef controllerRef, CFMutableDictionaryRef d
 
 
 
+//=============================================================================
+//      ControllerDB_ChannelChanged : A driver set a channel on a direct call
+//				of a client.
+//-----------------------------------------------------------------------------
+//		Note : dict holds k3Channel and, for inline data, k3Data. Without
+//				k3Data the channel's shadow is forgotten, k3DataSize is then
+//				the size of the data the driver took from shared memory.
+//-----------------------------------------------------------------------------
+TQ3Status
+ControllerDB_ChannelChanged(TQ3ControllerRef controllerRef, CFDictionaryRef dict)
+{
+	TQ3Status status = kQ3Failure;
+	TC3ControllerPrivateDataPtr theController = (TC3ControllerPrivateDataPtr)controllerRef;
+	TQ3Uns32 channel,dataSize = 0;
+	
+	if (ControllerDB_refinlist(controllerRef)==kQ3True)
+		if ((theController!=NULL) && (CFDictionaryGetValue(dict,CFSTR(k3Channel))!=NULL))
+		{
+			IPCGetTQ3Uns32(dict,CFSTR(k3Channel),&channel);
+			if (CFDictionaryGetValue(dict,CFSTR(k3DataSize))!=NULL)
+				IPCGetTQ3Uns32(dict,CFSTR(k3DataSize),&dataSize);
+			if (CFDictionaryGetValue(dict,CFSTR(k3Data))!=NULL)
+				ControllerDB_ShadowStore(theController,channel,(CFDataRef)CFDictionaryGetValue(dict,CFSTR(k3Data)));
+			else
+				ControllerDB_ShadowForget(theController,channel,dataSize);
+			status = kQ3Success;
+		}
+	return(status);
+}
+
+
+
+
 
 
 //=============================================================================
@@ -592,7 +1073,7 @@ TQ3Status
 ControllerDB_SetTracker(TQ3ControllerRef controllerRef, TQ3TrackerObject tracker)
 */
 TQ3Status
-ControllerDB_SetTracker(TQ3ControllerRef controllerRef, CFStringRef theTrackerUUID, CFStringRef theTrackerPortName)
+ControllerDB_SetTracker(TQ3ControllerRef controllerRef, TQ3Uns32 theTrackerHandle, CFStringRef theTrackerPortName)
 {
 	TQ3Status status = kQ3Failure;
 	TC3ControllerPrivateDataPtr theController = (TC3ControllerPrivateDataPtr)controllerRef;
@@ -602,8 +1083,8 @@ ControllerDB_SetTracker(TQ3ControllerRef controllerRef, CFStringRef theTrackerUU
 		{
 			
 			//notification function of old...
-			if (theController->trackerUUID!=NULL)
-				IPCTracker_callNotification(theController->trackerUUID,
+			if (theController->trackerHandle!=kIPCHandleNone)
+				IPCTracker_callNotification(theController->trackerHandle,
 											theController->trackerPortName,
 											theController);
 			
@@ -612,11 +1093,10 @@ ControllerDB_SetTracker(TQ3ControllerRef controllerRef, CFStringRef theTrackerUU
 				CFRelease(theController->trackerPortName);
 			theController->trackerPortName=theTrackerPortName;
 			
-			if (theController->trackerUUID!=NULL)
-				CFRelease(theController->trackerUUID);
-			theController->trackerUUID=theTrackerUUID;
-			if (theController->trackerUUID!=NULL)
-				IPCTracker_callNotification(theController->trackerUUID,
+			theController->trackerHandle=theTrackerHandle;
+			ControllerStore_NoteChange();
+			if (theController->trackerHandle!=kIPCHandleNone)
+				IPCTracker_callNotification(theController->trackerHandle,
 											theController->trackerPortName,
 											theController);
 			/*
@@ -648,9 +1128,9 @@ ControllerDB_HasTracker(TQ3ControllerRef controllerRef, TQ3Boolean *hasTracker)
 	if (ControllerDB_refinlist(controllerRef)==kQ3True)
 		if (theController!=NULL)
 		{
-			if (theController->trackerUUID!=NULL)
+			if (theController->trackerHandle!=kIPCHandleNone)
 			{
-				status = IPCTracker_getActivation(	theController->trackerUUID,
+				status = IPCTracker_getActivation(	theController->trackerHandle,
 													theController->trackerPortName,
 													&TrackerIsActive);
 				if ((TrackerIsActive==kQ3True)&&(theController->isActive==kQ3True))
@@ -669,14 +1149,13 @@ ControllerDB_HasTracker(TQ3ControllerRef controllerRef, TQ3Boolean *hasTracker)
 
 
 //=============================================================================
-//      ControllerDB_Track2DCursor : One-line description of the method.
+//      ControllerDB_NoteConsumerRead : Counts one client read of controllerRef.
 //-----------------------------------------------------------------------------
-//		Note : More detailed comments can be placed here if required.
-//
-// used on Server/Driver Side
+//		Note : Called by the IPC layer for every client request reading values,
+//			   buttons or tracker state; the driver's own calls are not counted.
 //-----------------------------------------------------------------------------
 TQ3Status
-ControllerDB_Track2DCursor(TQ3ControllerRef controllerRef, TQ3Boolean *track2DCursor)
+ControllerDB_NoteConsumerRead(TQ3ControllerRef controllerRef)
 {
 	TQ3Status status = kQ3Failure;
 	TC3ControllerPrivateDataPtr theController = (TC3ControllerPrivateDataPtr)controllerRef;
@@ -684,10 +1163,7 @@ ControllerDB_Track2DCursor(TQ3ControllerRef controllerRef, TQ3Boolean *track2DCu
 	if (ControllerDB_refinlist(controllerRef)==kQ3True)
 		if (theController!=NULL)
 		{
-			if ((theController->trackerUUID!=NULL)||(theController->isActive==kQ3False))
-				*track2DCursor=kQ3False;
-			else
-				*track2DCursor=kQ3True;
+			theController->consumerReads++;
 			status = kQ3Success;
 		}
 	return(status);
@@ -698,27 +1174,39 @@ ControllerDB_Track2DCursor(TQ3ControllerRef controllerRef, TQ3Boolean *track2DCu
 
 
 //=============================================================================
-//      ControllerDB_Track3DCursor : One-line description of the method.
+//      ControllerDB_GetConsumerState : Demand of the clients of controllerRef.
 //-----------------------------------------------------------------------------
-//		Note : More detailed comments can be placed here if required.
+//		Note : hasTracker reports an active tracker, which is fed with every
+//			   sample the driver sends. consumerRate is the rate of client reads
+//			   averaged over the last kC3ConsumerRateWindow seconds; it drops to
+//			   0 one window after the last read.
 //
 // used on Server/Driver Side
 //-----------------------------------------------------------------------------
 TQ3Status
-ControllerDB_Track3DCursor(TQ3ControllerRef controllerRef, TQ3Boolean *track3DCursor)
+ControllerDB_GetConsumerState(TQ3ControllerRef controllerRef, TQ3Boolean *hasTracker, float *consumerRate)
 {
 	TQ3Status status = kQ3Failure;
 	TC3ControllerPrivateDataPtr theController = (TC3ControllerPrivateDataPtr)controllerRef;
+	CFAbsoluteTime now,elapsed;
 	
-	if (ControllerDB_refinlist(controllerRef)==kQ3True)
-		if (theController!=NULL)
+	if (ControllerDB_HasTracker(controllerRef,hasTracker)==kQ3Success)
+	{
+		now = CFAbsoluteTimeGetCurrent();
+		elapsed = now - theController->consumerWindowStart;
+		if (elapsed >= kC3ConsumerRateWindow)
 		{
-			if ((theController->trackerUUID!=NULL)||(theController->isActive==kQ3False))
-				*track3DCursor=kQ3False;
-			else
-				*track3DCursor=kQ3True;
-			status = kQ3Success;
+			theController->consumerRate = (float)(theController->consumerReads / elapsed);
+			theController->consumerReads = 0;
+			theController->consumerWindowStart = now;
 		}
+		else if ((elapsed > 0.0) && (theController->consumerReads / elapsed > theController->consumerRate))
+			//a consumer that just started shows up before the window closes
+			theController->consumerRate = (float)(theController->consumerReads / elapsed);
+		
+		*consumerRate = theController->consumerRate;
+		status = kQ3Success;
+	}
 	return(status);
 }
 
@@ -727,12 +1215,15 @@ ControllerDB_Track3DCursor(TQ3ControllerRef controllerRef, TQ3Boolean *track3DCu
 
 
 //=============================================================================
-//      ControllerDB_GetButtons : One-line description of the method.
+//      ControllerDB_SetFilter : Replace the filter pipeline of controllerRef.
 //-----------------------------------------------------------------------------
-//		Note : More detailed comments can be placed here if required.
+//		Note : stages==NULL, or no valid stage, removes it. Replaces the
+//				pipeline of the ControllerFilters preference.
+//
+// used on Server/Driver Side
 //-----------------------------------------------------------------------------
 TQ3Status
-ControllerDB_GetButtons(TQ3ControllerRef controllerRef, TQ3Uns32 *buttons)
+ControllerDB_SetFilter(TQ3ControllerRef controllerRef, CFArrayRef stages)
 {
 	TQ3Status status = kQ3Failure;
 	TC3ControllerPrivateDataPtr theController = (TC3ControllerPrivateDataPtr)controllerRef;
@@ -740,7 +1231,7 @@ ControllerDB_GetButtons(TQ3ControllerRef controllerRef, TQ3Uns32 *buttons)
 	if (ControllerDB_refinlist(controllerRef)==kQ3True)
 		if (theController!=NULL)
 		{
-			*buttons = theController->theButtons;
+			ControllerDB_BindFilter(theController,stages);
 			status = kQ3Success;
 		}
 	return(status);
@@ -751,33 +1242,116 @@ ControllerDB_GetButtons(TQ3ControllerRef controllerRef, TQ3Uns32 *buttons)
 
 
 //=============================================================================
-//      ControllerDB_SetButtons : One-line description of the method.
+//      ControllerDB_Track2DCursor : One-line description of the method.
 //-----------------------------------------------------------------------------
 //		Note : More detailed comments can be placed here if required.
 //
-// QD3D:notification function of associated tracker might get called!
 // used on Server/Driver Side
 //-----------------------------------------------------------------------------
 TQ3Status
-ControllerDB_SetButtons(TQ3ControllerRef controllerRef, TQ3Uns32 buttons)
+ControllerDB_Track2DCursor(TQ3ControllerRef controllerRef, TQ3Boolean *track2DCursor)
 {
 	TQ3Status status = kQ3Failure;
 	TC3ControllerPrivateDataPtr theController = (TC3ControllerPrivateDataPtr)controllerRef;
-	TQ3Uns32 buttonMask;	
 	
 	if (ControllerDB_refinlist(controllerRef)==kQ3True)
 		if (theController!=NULL)
 		{
-			status = kQ3Success;
+			if ((theController->trackerHandle!=kIPCHandleNone)||(theController->isActive==kQ3False))
+				*track2DCursor=kQ3False;
+			else
+				*track2DCursor=kQ3True;
+			status = kQ3Success;
+		}
+	return(status);
+}
+
+
+
+
+
+//=============================================================================
+//      ControllerDB_Track3DCursor : One-line description of the method.
+//-----------------------------------------------------------------------------
+//		Note : More detailed comments can be placed here if required.
+//
+// used on Server/Driver Side
+//-----------------------------------------------------------------------------
+TQ3Status
+ControllerDB_Track3DCursor(TQ3ControllerRef controllerRef, TQ3Boolean *track3DCursor)
+{
+	TQ3Status status = kQ3Failure;
+	TC3ControllerPrivateDataPtr theController = (TC3ControllerPrivateDataPtr)controllerRef;
+	
+	if (ControllerDB_refinlist(controllerRef)==kQ3True)
+		if (theController!=NULL)
+		{
+			if ((theController->trackerHandle!=kIPCHandleNone)||(theController->isActive==kQ3False))
+				*track3DCursor=kQ3False;
+			else
+				*track3DCursor=kQ3True;
+			status = kQ3Success;
+		}
+	return(status);
+}
+
+
+
+
+
+//=============================================================================
+//      ControllerDB_GetButtons : One-line description of the method.
+//-----------------------------------------------------------------------------
+//		Note : More detailed comments can be placed here if required.
+//-----------------------------------------------------------------------------
+TQ3Status
+ControllerDB_GetButtons(TQ3ControllerRef controllerRef, TQ3Uns32 *buttons)
+{
+	TQ3Status status = kQ3Failure;
+	TC3ControllerPrivateDataPtr theController = (TC3ControllerPrivateDataPtr)controllerRef;
+	
+	if (ControllerDB_refinlist(controllerRef)==kQ3True)
+		if (theController!=NULL)
+		{
+			*buttons = theController->theButtons;
+			status = kQ3Success;
+		}
+	return(status);
+}
+
+
+
+
+
+//=============================================================================
+//      ControllerDB_SetButtons : One-line description of the method.
+//-----------------------------------------------------------------------------
+//		Note : More detailed comments can be placed here if required.
+//
+// QD3D:notification function of associated tracker might get called!
+// used on Server/Driver Side
+//-----------------------------------------------------------------------------
+TQ3Status
+ControllerDB_SetButtons(TQ3ControllerRef controllerRef, TQ3Uns32 buttons)
+{
+	TQ3Status status = kQ3Failure;
+	TC3ControllerPrivateDataPtr theController = (TC3ControllerPrivateDataPtr)controllerRef;
+	TQ3Uns32 buttonMask;	
+	
+	if (ControllerDB_refinlist(controllerRef)==kQ3True)
+		if (theController!=NULL)
+		{
+			ControllerJournal_Record(controllerRef,&theController->publicData,kC3JournalButtons,&buttons,sizeof(TQ3Uns32));
+			status = kQ3Success;
 			
 			if (theController->isActive==kQ3True)
 			{
 				buttonMask=theController->theButtons^buttons;
 				theController->theButtons = buttons;
 				
-				if (theController->trackerUUID!=NULL)
+				if (theController->trackerHandle!=kIPCHandleNone)
 				{
-					status = IPCTracker_changeButtons(	theController->trackerUUID,
+					status = IPCTracker_changeButtons(	theController->trackerHandle,
 														theController->trackerPortName,											
 														theController,//Controller is used by Tracker Notification function
 														buttons,
@@ -812,8 +1386,8 @@ ControllerDB_GetTrackerPosition(TQ3ControllerRef controllerRef, TQ3Point3D *posi
 		if (theController!=NULL)
 		{
 			status = kQ3Success;
-			if ((theController->isActive==kQ3True)&&(theController->trackerUUID!=NULL))
-				status = IPCTracker_getPosition(	theController->trackerUUID,
+			if ((theController->isActive==kQ3True)&&(theController->trackerHandle!=kIPCHandleNone))
+				status = IPCTracker_getPosition(	theController->trackerHandle,
 													theController->trackerPortName,
 													position);
 			else
@@ -845,12 +1419,13 @@ ControllerDB_SetTrackerPosition(TQ3ControllerRef controllerRef, const TQ3Point3D
 	if (ControllerDB_refinlist(controllerRef)==kQ3True)
 		if (theController!=NULL)
 		{
+			ControllerJournal_Record(controllerRef,&theController->publicData,kC3JournalSetPosition,position,sizeof(TQ3Point3D));
 			status = kQ3Success;
 			if (theController->isActive==kQ3True)
 			{
-				if (theController->trackerUUID!=NULL)
+				if (theController->trackerHandle!=kIPCHandleNone)
 				{
-					status = IPCTracker_setPosition(	theController->trackerUUID,
+					status = IPCTracker_setPosition(	theController->trackerHandle,
 														theController->trackerPortName,
 														theController,//Controller is used by Tracker Notification function
 														position);
@@ -887,15 +1462,21 @@ ControllerDB_MoveTrackerPosition(TQ3ControllerRef controllerRef, const TQ3Vector
 	if (ControllerDB_refinlist(controllerRef)==kQ3True)
 		if (theController!=NULL)
 		{
+			ControllerJournal_Record(controllerRef,&theController->publicData,kC3JournalMovePosition,delta,sizeof(TQ3Vector3D));
 			status = kQ3Success;
 			if (theController->isActive==kQ3True)
 			{
-				if (theController->trackerUUID!=NULL)
+				TQ3Vector3D filteredDelta = *delta;
+				
+				//a delta the filter swallows completely isn't forwarded
+				if ((theController->trackerHandle!=kIPCHandleNone)
+				 && ((theController->positionFilter==NULL)
+				  || (ControllerFilter_ProcessVector(theController->positionFilter,&filteredDelta,CFAbsoluteTimeGetCurrent())==kQ3True)))
 				{
-					status = IPCTracker_movePosition(	theController->trackerUUID,
+					status = IPCTracker_movePosition(	theController->trackerHandle,
 														theController->trackerPortName,
 														theController,//Controller is used by Tracker Notification function
-														delta);
+														&filteredDelta);
 				}
 				/*
 				else
@@ -926,8 +1507,8 @@ ControllerDB_GetTrackerOrientation(TQ3ControllerRef controllerRef, TQ3Quaternion
 		if (theController!=NULL)
 		{
 			status = kQ3Success;
-			if ((theController->isActive==kQ3True)&&(theController->trackerUUID!=NULL))
-				status = IPCTracker_getOrientation(	theController->trackerUUID,
+			if ((theController->isActive==kQ3True)&&(theController->trackerHandle!=kIPCHandleNone))
+				status = IPCTracker_getOrientation(	theController->trackerHandle,
 													theController->trackerPortName,
 													orientation);
 			else
@@ -961,12 +1542,13 @@ ControllerDB_SetTrackerOrientation(TQ3ControllerRef controllerRef, const TQ3Quat
 	if (ControllerDB_refinlist(controllerRef)==kQ3True)
 		if (theController!=NULL)
 		{
+			ControllerJournal_Record(controllerRef,&theController->publicData,kC3JournalSetOrientation,orientation,sizeof(TQ3Quaternion));
 			status = kQ3Success;
 			if (theController->isActive==kQ3True)
 			{
-				if (theController->trackerUUID!=NULL)
+				if (theController->trackerHandle!=kIPCHandleNone)
 				{	
-					status = IPCTracker_setOrientation(	theController->trackerUUID,
+					status = IPCTracker_setOrientation(	theController->trackerHandle,
 														theController->trackerPortName,
 														theController,//Controller is used by Tracker Notification function
 														orientation);
@@ -1002,15 +1584,20 @@ ControllerDB_MoveTrackerOrientation(TQ3ControllerRef controllerRef, const TQ3Qua
 	if (ControllerDB_refinlist(controllerRef)==kQ3True)
 		if (theController!=NULL)
 		{
+			ControllerJournal_Record(controllerRef,&theController->publicData,kC3JournalMoveOrientation,delta,sizeof(TQ3Quaternion));
 			status = kQ3Success;
 			if (theController->isActive==kQ3True)
 			{
-				if (theController->trackerUUID!=NULL)
+				TQ3Quaternion filteredDelta = *delta;
+				
+				if ((theController->trackerHandle!=kIPCHandleNone)
+				 && ((theController->orientationFilter==NULL)
+				  || (ControllerFilter_ProcessRotation(theController->orientationFilter,&filteredDelta,CFAbsoluteTimeGetCurrent())==kQ3True)))
 				{
-					status = IPCTracker_moveOrientation(	theController->trackerUUID,
+					status = IPCTracker_moveOrientation(	theController->trackerHandle,
 															theController->trackerPortName,
 															theController,//Controller is used by Tracker Notification function
-															delta);
+															&filteredDelta);
 				}
 				/*
 				else
@@ -1132,11 +1719,34 @@ ControllerDB_SetValues(TQ3ControllerRef controllerRef, const float *values, TQ3U
 				else
 					maxCount=theController->publicData.valueCount;
 				
-				for (index=0; index<maxCount;index++)
-					theController->valuesRef[index]=values[index];
+				ControllerJournal_RecordValues(controllerRef,&theController->publicData,values,maxCount);
 				
-				theController->serialNumber++;	//This fits better to functionality of ControllerDB_GetValues
 				status = kQ3Success;
+				if (theController->valuesFilter!=NULL)
+				{
+					float		filtered[kQ3MaxControllerValues];
+					TQ3Boolean	changed = kQ3False;
+					
+					memcpy(filtered,values,maxCount*sizeof(float));
+					ControllerFilter_Process(theController->valuesFilter,filtered,maxCount,CFAbsoluteTimeGetCurrent());
+					
+					//jitter the filter suppressed doesn't wake the clients
+					for (index=0; index<maxCount;index++)
+						if (theController->valuesRef[index]!=filtered[index])
+						{
+							theController->valuesRef[index]=filtered[index];
+							changed = kQ3True;
+						}
+					if (changed==kQ3True)
+						theController->serialNumber++;
+				}
+				else
+				{
+					for (index=0; index<maxCount;index++)
+						theController->valuesRef[index]=values[index];
+					
+					theController->serialNumber++;	//This fits better to functionality of ControllerDB_GetValues
+				}
 			}
 	return(status);
 };
@@ -1144,157 +1754,1108 @@ ControllerDB_SetValues(TQ3ControllerRef controllerRef, const float *values, TQ3U
 #pragma mark -
 
 TQ3Status
-ControllerDB_StateNew(TQ3ControllerRef controllerRef, CFStringRef *CtrlStateKey)
+ControllerDB_StateNew(TQ3ControllerRef controllerRef, TQ3Uns32 *ctrlStateHandle)
 {
 	TQ3Status status = kQ3Failure;
 	TC3ControllerPrivateDataPtr theController = (TC3ControllerPrivateDataPtr)controllerRef;
+	TC3ControllerStateDataPtr	theState;
+	
+	*ctrlStateHandle = kIPCHandleNone;
 	
 	if (ControllerDB_refinlist(controllerRef)==kQ3True)
 		if (theController!=NULL)
 		{
-			status = kQ3Success;
 			//Do what to do:
-			//-Create UUID
-			CFUUIDRef StateUUID = CFUUIDCreate(kCFAllocatorDefault);
-			
-			//-Create and return UUID-key
-			*CtrlStateKey = CFUUIDCreateString(kCFAllocatorDefault,StateUUID);
-			
-			//-Create Dictionary if not available
-			if (controllerStateDict==NULL)
-				controllerStateDict = CFDictionaryCreateMutable(	kCFAllocatorDefault,0,
-																	&kCFTypeDictionaryKeyCallBacks,
-																	&kCFTypeDictionaryValueCallBacks);
-			
-			//-clean up
-			if (StateUUID)
-				CFRelease(StateUUID);
+			//-Create state record
+			theState = (TC3ControllerStateDataPtr)malloc(sizeof(TC3ControllerStateData));
+			if (theState!=NULL)
+			{
+				theState->controllerRef = controllerRef;
+				theState->isSaved = kQ3False;
+				theState->channelCount = 0;
+				
+				//-Create and return handle
+				*ctrlStateHandle = IPCHandle_Insert(&controllerStates,theState);
+				if (*ctrlStateHandle!=kIPCHandleNone)
+				{
+					ControllerStore_NoteChange();
+					status = kQ3Success;
+				}
+				else
+					free(theState);
+			}
 		}
 	return(status);
 }
 
+//=============================================================================
+//      ControllerDB_StateLookup : State of ctrlStateHandle, if it belongs to
+//				controllerRef.
+//-----------------------------------------------------------------------------
+static TC3ControllerStateDataPtr
+ControllerDB_StateLookup(TQ3ControllerRef controllerRef, TQ3Uns32 ctrlStateHandle)
+{
+	TC3ControllerStateDataPtr theState = (TC3ControllerStateDataPtr)IPCHandle_Lookup(&controllerStates,ctrlStateHandle);
+	
+	if ((controllerRef==NULL) || (ControllerDB_refinlist(controllerRef)==kQ3False)
+	 || (theState==NULL) || (theState->controllerRef!=controllerRef))
+		return(NULL);
+	return(theState);
+}
+
 TQ3Status
-ControllerDB_StateDelete(TQ3ControllerRef controllerRef, CFStringRef CtrlStateKey)
+ControllerDB_StateDelete(TQ3ControllerRef controllerRef, TQ3Uns32 ctrlStateHandle)
 {
 	TQ3Status status = kQ3Failure;
 	TC3ControllerPrivateDataPtr theController = (TC3ControllerPrivateDataPtr)controllerRef;
+	TC3ControllerStateDataPtr	theState;
 	
 	if (ControllerDB_refinlist(controllerRef)==kQ3True)
 		if (theController!=NULL)
 		{
 			status = kQ3Success;
 			//Do what to do:
-			if (controllerStateDict)
+			//-Remove state record; stale handles and states of other controllers yield NULL
+			theState = ControllerDB_StateLookup(controllerRef,ctrlStateHandle);
+			if (theState!=NULL)
 			{
-				//-Release Array at CtrlStateKey
-				CFDictionaryRemoveValue (controllerStateDict,CtrlStateKey);
+				TQ3Uns32 channel;
+				
+				IPCHandle_Remove(&controllerStates,ctrlStateHandle);
+				for (channel=0; channel<theState->channelCount; channel++)
+					ControllerBlobs_Release(theState->channelBlobs[channel]);
+				free(theState);
+				ControllerStore_NoteChange();
 			}
 		}
 	return(status);
 }
 
-TQ3Status
-ControllerDB_StateSaveAndReset(TQ3ControllerRef controllerRef, CFStringRef CtrlStateKey)
+
+
+//=============================================================================
+//      ControllerDB_StateSavePrepare : Driver request of a save and reset.
+//-----------------------------------------------------------------------------
+//		Note : Channels the shadow doesn't know are read, channels not yet
+//				reset are reset. NULL if that leaves nothing for the driver.
+//				Channels set through shared memory get a slot of shared, which
+//				the caller closes after ControllerDB_StateSaveFinish.
+//-----------------------------------------------------------------------------
+static CFMutableDictionaryRef
+ControllerDB_StateSavePrepare(TC3ControllerPrivateDataPtr theController, TQ3Uns32 *getMask, TQ3Uns32 *resetMask, TC3IPCSharedData *shared)
 {
-	TQ3Status					status = kQ3Failure;
-	TC3ControllerPrivateDataPtr theController = (TC3ControllerPrivateDataPtr)controllerRef;
-	UInt8						channelData[kQ3ControllerSetChannelMaxDataSize];
-	UInt32						channelDataSize;
+	TQ3ControllerRef		controllerRef = (TQ3ControllerRef)theController;
+	TQ3Uns32				channel,channelCount,offset,sharedSize = 0;
+	CFMutableDictionaryRef	dict;
+	CFMutableArrayRef		slots;
 	
-	CFMutableDictionaryRef		dict,returnDict;
+	*getMask = 0;
+	*resetMask = 0;
+	shared->bytes = NULL;
+	shared->isOwner = kQ3False;
 	
-	Boolean result;
+	channelCount = theController->publicData.channelCount;
+	for (channel=0; channel<channelCount; channel++)
+	{
+		TQ3Uns32 shadow = theController->channelShadow[channel];
+		
+		if (shadow==kIPCHandleNone)
+		{
+			*getMask |= kC3ChannelBit(channel);
+			if ((theController->channelSize[channel]>kIPCSharedDataThreshold)
+			 && (theController->channelSize[channel]<=kIPCSharedDataMaxSize-sharedSize))
+				sharedSize += theController->channelSize[channel];
+		}
+		if (shadow!=ControllerBlobs_Empty())
+			*resetMask |= kC3ChannelBit(channel);
+	}
+	
+	if ((*getMask|*resetMask)==0)
+		return(NULL);
 	
-	//create dictionaries
 	dict = CFDictionaryCreateMutable(	kCFAllocatorDefault,0,
 										&kCFTypeDictionaryKeyCallBacks,
 										&kCFTypeDictionaryValueCallBacks);
-										
-	returnDict = CFDictionaryCreateMutable(	kCFAllocatorDefault,0,
-										&kCFTypeDictionaryKeyCallBacks,
-										&kCFTypeDictionaryValueCallBacks);									
-	
-	if (ControllerDB_refinlist(controllerRef)==kQ3True)
-		if ((theController!=NULL)&&(dict!=NULL))
+	if (dict!=NULL)
+	{
+		//--Set method
+		IPCPutBytes(dict, CFSTR(k3SetMethodRef), sizeof(TQ3ChannelSetMethod), &theController->publicData.channelSetMethod);
+		//--Get method
+		IPCPutBytes(dict, CFSTR(k3GetMethodRef), sizeof(TQ3ChannelGetMethod), &theController->publicData.channelGetMethod);
+		//--controllerRef
+		IPCPutControllerRef(dict, CFSTR(k3CtrlRef), &controllerRef);
+		//--channelCount
+		IPCPutTQ3Uns32(dict, CFSTR(k3ChannelCount), &channelCount);	
+		//--channels to read and to reset
+		IPCPutTQ3Uns32(dict, CFSTR(k3ChannelMask), getMask);	
+		IPCPutTQ3Uns32(dict, CFSTR(k3ResetMask), resetMask);	
+		
+		//--slots of the large channels, one after the other; without them those are read inline and fail
+		if ((sharedSize>0) && (IPCSharedData_Create(sharedSize, shared)==kQ3Success))
 		{
-			//Do what to do:
-			//-pack
-			//--Set method
-			result = IPCPutBytes(dict, CFSTR(k3SetMethodRef), sizeof(TQ3ChannelSetMethod), &theController->publicData.channelSetMethod);
-			//--Get method
-			result = IPCPutBytes(dict, CFSTR(k3GetMethodRef), sizeof(TQ3ChannelGetMethod), &theController->publicData.channelGetMethod);
-			//--controllerRef
-			result = IPCPutControllerRef(dict, CFSTR(k3CtrlRef), &controllerRef);
-			//--channelCount
-			result = IPCPutTQ3Uns32(dict, CFSTR(k3ChannelCount), &theController->publicData.channelCount);	
-			
-			//try sending
-			status = IPCDriver_Send(m3ControllerDriver_StateSaveAndReset,theController->driverPortName,dict,returnDict);
-			if (status!=kQ3Failure)
+			slots = CFArrayCreateMutable(kCFAllocatorDefault, 0, &kCFTypeArrayCallBacks);
+			for (channel=0, offset=0; (slots!=NULL) && (channel<channelCount); channel++)
+			{
+				CFMutableDictionaryRef	slot;
+				TQ3Uns32				size = theController->channelSize[channel];
+				
+				if ((!(*getMask & kC3ChannelBit(channel))) || (size<=kIPCSharedDataThreshold) || (size>sharedSize-offset))
+					continue;
+				
+				slot = CFDictionaryCreateMutable(	kCFAllocatorDefault,0,
+													&kCFTypeDictionaryKeyCallBacks,
+													&kCFTypeDictionaryValueCallBacks);
+				if (slot==NULL)
+					break;
+				IPCPutTQ3Uns32(slot, CFSTR(k3Channel), &channel);
+				IPCPutTQ3Uns32(slot, CFSTR(k3DataOffset), &offset);
+				IPCPutTQ3Uns32(slot, CFSTR(k3DataSize), &size);
+				CFArrayAppendValue(slots, slot);
+				CFRelease(slot);
+				offset += size;
+			}
+			if (slots!=NULL)
 			{
-				//-Methods return dictionary
-				CFDictionaryRef methodsReturnRef = (CFDictionaryRef)CFDictionaryGetValue(returnDict, CFSTR(k3MethodsReturn));
-				//unpack and replace
-				//-Array with channels
-				CFArrayRef channelArrayRef = (CFArrayRef)CFDictionaryGetValue(methodsReturnRef, CFSTR(k3ChannelsData));
-				//CFRetain(channelArrayRef);
-				CFDictionarySetValue(controllerStateDict,CtrlStateKey,channelArrayRef);  
+				CFDictionarySetValue(dict, CFSTR(k3Channels), slots);
+				IPCSharedData_Put(dict, shared);
+				CFRelease(slots);
 			}
-			//Do clean up
-			CFRelease(dict);
+		}
+	}
+	return(dict);
+}
+
+
+
+//=============================================================================
+//      ControllerDB_StateSaveFinish : Merge the driver's answer into the
+//				shadow, save the shadow's blobs, then note the reset.
+//-----------------------------------------------------------------------------
+//		Note : reply holds k3ChannelsData with the channels of getMask, entries
+//				outside it are placeholders; k3ChannelMask and k3ResetMask tell
+//				what the driver did read and reset, k3Channels which channels it
+//				left in shared. May be NULL if getMask is 0.
+//				A channel the driver couldn't read stays unknown, its saved
+//				data is kIPCHandleNone and a restore leaves it alone.
+//-----------------------------------------------------------------------------
+static void
+ControllerDB_StateSaveFinish(TC3ControllerPrivateDataPtr theController, TC3ControllerStateDataPtr theState,
+								TQ3Uns32 getMask, TQ3Uns32 resetMask, CFDictionaryRef reply, const TC3IPCSharedData *shared)
+{
+	TQ3Uns32	channel,channelCount = theController->publicData.channelCount;
+	TQ3Uns32	readMask = getMask,sharedMask = 0;
+	CFArrayRef	channelArrayRef = NULL,slots = NULL;
+	CFIndex		index;
+	
+	if (reply!=NULL)
+	{
+		channelArrayRef = (CFArrayRef)CFDictionaryGetValue(reply, CFSTR(k3ChannelsData));
+		slots = (CFArrayRef)CFDictionaryGetValue(reply, CFSTR(k3Channels));
+		if (CFDictionaryGetValue(reply, CFSTR(k3ChannelMask))!=NULL)
+		{
+			TQ3Uns32 mask = 0;
+			
+			IPCGetTQ3Uns32(reply, CFSTR(k3ChannelMask), &mask);
+			readMask &= mask;
+		}
+		if (CFDictionaryGetValue(reply, CFSTR(k3ResetMask))!=NULL)
+		{
+			TQ3Uns32 mask = 0;
+			
+			IPCGetTQ3Uns32(reply, CFSTR(k3ResetMask), &mask);
+			resetMask &= mask;
+		}
+	}
+	
+	for (channel=0; channel<theState->channelCount; channel++)
+		ControllerBlobs_Release(theState->channelBlobs[channel]);
+	theState->channelCount = 0;
+	theState->isSaved = kQ3True;
+	
+	//-channels the driver read into shared memory
+	for (index=0; (slots!=NULL) && (index<CFArrayGetCount(slots)); index++)
+	{
+		CFDictionaryRef	slot = (CFDictionaryRef)CFArrayGetValueAtIndex(slots, index);
+		TQ3Uns32		offset = 0, size = 0;
+		CFDataRef		data;
 		
-			if (returnDict)
-				CFRelease(returnDict);
+		channel = kQ3MaxControllerChannels;
+		IPCGetTQ3Uns32(slot, CFSTR(k3Channel), &channel);
+		IPCGetTQ3Uns32(slot, CFSTR(k3DataOffset), &offset);
+		IPCGetTQ3Uns32(slot, CFSTR(k3DataSize), &size);
+		if ((channel>=channelCount) || (!(readMask & kC3ChannelBit(channel))))
+			continue;
+		
+		sharedMask |= kC3ChannelBit(channel);
+		data = NULL;
+		if ((shared->bytes!=NULL) && (size<=shared->size) && (offset<=shared->size-size))
+			data = CFDataCreate(kCFAllocatorDefault, (const UInt8*)shared->bytes+offset, size);
+		if (data!=NULL)
+		{
+			ControllerDB_ShadowStore(theController,channel,data);
+			CFRelease(data);
 		}
+	}
+	
+	for (channel=0; channel<channelCount; channel++)
+	{
+		TQ3Uns32 blobId;
+		
+		if ((readMask & kC3ChannelBit(channel)) && (!(sharedMask & kC3ChannelBit(channel)))
+		 && (channelArrayRef!=NULL) && (channel<(TQ3Uns32)CFArrayGetCount(channelArrayRef)))
+			ControllerDB_ShadowStore(theController,channel,(CFDataRef)CFArrayGetValueAtIndex(channelArrayRef,channel));
+		
+		//a channel neither read nor known stays unknown
+		blobId = theController->channelShadow[channel];
+		ControllerBlobs_Retain(blobId);
+		theState->channelBlobs[theState->channelCount++] = blobId;
+		
+		if (resetMask & kC3ChannelBit(channel))
+		{
+			ControllerBlobs_Retain(ControllerBlobs_Empty());
+			ControllerDB_ShadowSet(theController,channel,ControllerBlobs_Empty());
+		}
+	}
+	ControllerStore_NoteChange();
+}
+
+
+
+//=============================================================================
+//      ControllerDB_StateRestoreMask : Channels whose live data differs from
+//				the saved data.
+//-----------------------------------------------------------------------------
+//		Note : Equal blobs mean equal contents. Channels saved unknown are
+//				left alone.
+//-----------------------------------------------------------------------------
+static TQ3Uns32
+ControllerDB_StateRestoreMask(TC3ControllerPrivateDataPtr theController, TC3ControllerStateDataPtr theState, TQ3Uns32 *channelCount)
+{
+	TQ3Uns32 channel,setMask = 0;
+	
+	*channelCount = theController->publicData.channelCount;
+	if (*channelCount>theState->channelCount)
+		*channelCount = theState->channelCount;
+	for (channel=0; channel<*channelCount; channel++)
+		if ((theState->channelBlobs[channel]!=kIPCHandleNone)
+		 && (theController->channelShadow[channel]!=theState->channelBlobs[channel]))
+			setMask |= kC3ChannelBit(channel);
+	return(setMask);
+}
+
+
+
+//=============================================================================
+//      ControllerDB_StateRestorePrepare : Driver request of a restore.
+//-----------------------------------------------------------------------------
+static CFMutableDictionaryRef
+ControllerDB_StateRestorePrepare(TC3ControllerPrivateDataPtr theController, TC3ControllerStateDataPtr theState, TQ3Uns32 setMask, TQ3Uns32 channelCount)
+{
+	TQ3ControllerRef		controllerRef = (TQ3ControllerRef)theController;
+	TQ3Uns32				channel;
+	CFMutableDictionaryRef	dict;
+	CFMutableArrayRef		channelArrayRef;
+	
+	dict = CFDictionaryCreateMutable(	kCFAllocatorDefault,0,
+										&kCFTypeDictionaryKeyCallBacks,
+										&kCFTypeDictionaryValueCallBacks);
+	channelArrayRef = CFArrayCreateMutable(kCFAllocatorDefault, channelCount, &kCFTypeArrayCallBacks);
+	
+	if ((dict!=NULL)&&(channelArrayRef!=NULL))
+	{
+		//--Set method
+		IPCPutBytes(dict, CFSTR(k3SetMethodRef), sizeof(TQ3ChannelSetMethod), &theController->publicData.channelSetMethod);
+		//--controllerRef
+		IPCPutControllerRef(dict, CFSTR(k3CtrlRef), &controllerRef);
+		//--channelCount
+		IPCPutTQ3Uns32(dict, CFSTR(k3ChannelCount), &channelCount);	
+		//--channels to set
+		IPCPutTQ3Uns32(dict, CFSTR(k3ChannelMask), &setMask);	
+		//--Array with channels; the blobs' data is shared, not copied; unknown ones aren't set
+		for (channel=0; channel<channelCount; channel++)
+			if (setMask & kC3ChannelBit(channel))
+				CFArrayAppendValue(channelArrayRef, ControllerBlobs_GetData(theState->channelBlobs[channel]));
+			else
+				CFArrayAppendValue(channelArrayRef, ControllerBlobs_GetData(ControllerBlobs_Empty()));
+		CFDictionarySetValue(dict, CFSTR(k3ChannelsData),channelArrayRef); 
+	}
+	else if (dict!=NULL)
+	{
+		CFRelease(dict);
+		dict = NULL;
+	}
+	
+	if (channelArrayRef)
+		CFRelease(channelArrayRef);
+	return(dict);
+}
+
+
+
+//=============================================================================
+//      ControllerDB_StateRestoreFinish : The pushed channels hold the saved
+//				data now.
+//-----------------------------------------------------------------------------
+static void
+ControllerDB_StateRestoreFinish(TC3ControllerPrivateDataPtr theController, TC3ControllerStateDataPtr theState, TQ3Uns32 setMask, TQ3Uns32 channelCount)
+{
+	TQ3Uns32 channel;
+	
+	for (channel=0; channel<channelCount; channel++)
+		if (setMask & kC3ChannelBit(channel))
+		{
+			ControllerBlobs_Retain(theState->channelBlobs[channel]);
+			ControllerDB_ShadowSet(theController,channel,theState->channelBlobs[channel]);
+		}
+}
+
+
+
+TQ3Status
+ControllerDB_StateSaveAndReset(TQ3ControllerRef controllerRef, TQ3Uns32 ctrlStateHandle)
+{
+	TQ3Status					status = kQ3Failure;
+	TC3ControllerPrivateDataPtr theController = (TC3ControllerPrivateDataPtr)controllerRef;
+	TC3ControllerStateDataPtr	theState = ControllerDB_StateLookup(controllerRef,ctrlStateHandle);
+	TQ3Uns32					getMask,resetMask;
+	CFDictionaryRef				methodsReturnRef = NULL;
+	TC3IPCSharedData			shared = {"", NULL, 0, kQ3False};
+	
+	CFMutableDictionaryRef		dict,returnDict;
+	
+	if (theState==NULL)
+		return(status);
+	
+	dict = ControllerDB_StateSavePrepare(theController,&getMask,&resetMask,&shared);
+	returnDict = CFDictionaryCreateMutable(	kCFAllocatorDefault,0,
+											&kCFTypeDictionaryKeyCallBacks,
+											&kCFTypeDictionaryValueCallBacks);									
+	
+	if ((getMask|resetMask)==0)
+		status = kQ3Success;	//nothing changed since the last save and reset: no driver round trip
+	else if ((dict!=NULL)&&(returnDict!=NULL))
+	{
+		//try sending
+		status = IPCDriver_Send(m3ControllerDriver_StateSaveAndReset,theController->driverPortName,dict,returnDict);
+		if (status!=kQ3Failure)
+		{
+			//-Methods return dictionary, with the array of channels
+			methodsReturnRef = (CFDictionaryRef)CFDictionaryGetValue(returnDict, CFSTR(k3MethodsReturn));
+			if ((methodsReturnRef==NULL) || (CFDictionaryGetValue(methodsReturnRef, CFSTR(k3ChannelsData))==NULL))
+				status = kQ3Failure;
+		}
+	}
+	
+	if (status==kQ3Success)
+		ControllerDB_StateSaveFinish(theController,theState,getMask,resetMask,methodsReturnRef,&shared);
+	
+	//Do clean up
+	IPCSharedData_Close(&shared);
+	if (dict)
+		CFRelease(dict);
+	if (returnDict)
+		CFRelease(returnDict);
 		
 	return(status);
 }
 
 TQ3Status
-ControllerDB_StateRestore(TQ3ControllerRef controllerRef, CFStringRef CtrlStateKey)
+ControllerDB_StateRestore(TQ3ControllerRef controllerRef, TQ3Uns32 ctrlStateHandle)
 {
 	TQ3Status					status = kQ3Failure;
 	TC3ControllerPrivateDataPtr theController = (TC3ControllerPrivateDataPtr)controllerRef;
-	UInt8						channelData[kQ3ControllerSetChannelMaxDataSize];
-	UInt32						channelDataSize;
+	TC3ControllerStateDataPtr	theState = ControllerDB_StateLookup(controllerRef,ctrlStateHandle);
+	TQ3Uns32					channelCount,setMask;
 	
 	CFMutableDictionaryRef		dict,returnDict;
 	
-	Boolean result;
+	if ((theState==NULL) || (theState->isSaved==kQ3False))
+		return(status);
 	
-	//create dictionaries
-	dict = CFDictionaryCreateMutable(	kCFAllocatorDefault,0,
-										&kCFTypeDictionaryKeyCallBacks,
-										&kCFTypeDictionaryValueCallBacks);
-										
+	//-only channels whose live data differs from the saved data are pushed
+	setMask = ControllerDB_StateRestoreMask(theController,theState,&channelCount);
+	if (setMask==0)
+		return(kQ3Success);
+	
+	dict = ControllerDB_StateRestorePrepare(theController,theState,setMask,channelCount);
 	returnDict = CFDictionaryCreateMutable(	kCFAllocatorDefault,0,
-										&kCFTypeDictionaryKeyCallBacks,
-										&kCFTypeDictionaryValueCallBacks);
+											&kCFTypeDictionaryKeyCallBacks,
+											&kCFTypeDictionaryValueCallBacks);
 	
-	if (ControllerDB_refinlist(controllerRef)==kQ3True)
-		if ((theController!=NULL)&&(dict!=NULL))
+	if ((dict!=NULL)&&(returnDict!=NULL))
+	{
+		//try sending
+		status = IPCDriver_Send(m3ControllerDriver_StateRestore,theController->driverPortName,dict,returnDict);
+		if (status==kQ3Success)
+			ControllerDB_StateRestoreFinish(theController,theState,setMask,channelCount);
+	}
+	
+	//Do clean up
+	if (dict)
+		CFRelease(dict);
+	if (returnDict)
+		CFRelease(returnDict);
+		
+	return(status);
+}
+
+//=============================================================================
+//      ControllerDB_StateBatchComplete : Finish the deferred states, report.
+//-----------------------------------------------------------------------------
+//		Note : A later save of a controller already in the batch runs after
+//				the earlier one, so it sees the reset of that one.
+//-----------------------------------------------------------------------------
+static void
+ControllerDB_StateBatchComplete(TC3StateBatchPtr batch)
+{
+	TQ3Uns32 index;
+	
+	for (index=0; index<batch->stateCount; index++)
+		if (batch->entry[index].phase==kC3StateBatchLater)
+			batch->stateStatus[index] = ControllerDB_StateSaveAndReset(batch->entry[index].controllerRef,batch->entry[index].ctrlStateHandle);
+	
+	if (batch->doneProc!=NULL)
+		batch->doneProc(batch->stateCount,batch->stateStatus,batch->userData);
+	
+	for (index=0; index<batch->driverCount; index++)
+	{
+		CFRelease(batch->driver[index].driverPortName);
+		CFRelease(batch->driver[index].requests);
+	}
+	for (index=0; index<batch->stateCount; index++)
+		IPCSharedData_Close(&batch->entry[index].shared);
+	free(batch->driver);
+	free(batch->entry);
+	free(batch->stateStatus);
+	free(batch);
+}
+
+
+
+//=============================================================================
+//      ControllerDB_StateBatchRelease : One driver request less to wait for.
+//-----------------------------------------------------------------------------
+static void
+ControllerDB_StateBatchRelease(TC3StateBatchPtr batch)
+{
+	if (--batch->pendingCount==0)
+		ControllerDB_StateBatchComplete(batch);
+}
+
+
+
+//=============================================================================
+//      ControllerDB_StateBatchDriverDone : Finish the states of one driver.
+//-----------------------------------------------------------------------------
+//		Note : driverReturn is NULL if the request failed. The states are
+//				looked up again, as the reply may arrive after a delete.
+//				Calls after the first for a driver are ignored, so the batch
+//				is released once per driver only.
+//-----------------------------------------------------------------------------
+static void
+ControllerDB_StateBatchDriverDone(TC3StateBatchPtr batch, TQ3Uns32 driverIndex, CFDictionaryRef driverReturn)
+{
+	CFArrayRef	replies = NULL;
+	CFIndex		replyIndex = 0;
+	TQ3Uns32	index;
+	
+	if (batch->driver[driverIndex].isDone==kQ3True)
+		return;
+	batch->driver[driverIndex].isDone = kQ3True;
+	
+	if (driverReturn!=NULL)
+		replies = (CFArrayRef)CFDictionaryGetValue(driverReturn, CFSTR(k3CtrlStates));
+	
+	for (index=0; index<batch->stateCount; index++)
+	{
+		TC3StateBatchEntry			*theEntry = &batch->entry[index];
+		TC3ControllerStateDataPtr	theState;
+		CFDictionaryRef				reply = NULL;
+		
+		if ((theEntry->phase!=kC3StateBatchSent) || (theEntry->driverIndex!=driverIndex))
+			continue;
+		theEntry->phase = kC3StateBatchDone;
+		
+		if ((replies!=NULL) && (replyIndex<CFArrayGetCount(replies)))
+			reply = (CFDictionaryRef)CFArrayGetValueAtIndex(replies, replyIndex);
+		replyIndex++;
+		
+		theState = ControllerDB_StateLookup(theEntry->controllerRef,theEntry->ctrlStateHandle);
+		if ((reply==NULL) || (theState==NULL))
+			continue;
+		
+		if (batch->isRestore==kQ3False)
 		{
-			//Do what to do:
-			//-pack
-			//--Set method
-			result = IPCPutBytes(dict, CFSTR(k3SetMethodRef), sizeof(TQ3ChannelSetMethod), &theController->publicData.channelSetMethod);
-			//--controllerRef
-			result = IPCPutControllerRef(dict, CFSTR(k3CtrlRef), &controllerRef);
-			//--channelCount
-			result = IPCPutTQ3Uns32(dict, CFSTR(k3ChannelCount), &theController->publicData.channelCount);	
-			//--Array with channels
-			CFArrayRef channelArrayRef = (CFArrayRef)CFDictionaryGetValue(controllerStateDict,CtrlStateKey);
-			CFDictionarySetValue(dict, CFSTR(k3ChannelsData),channelArrayRef); 
-			
-			//try sending
-			status = IPCDriver_Send(m3ControllerDriver_StateRestore,theController->driverPortName,dict,returnDict);
+			if (CFDictionaryGetValue(reply, CFSTR(k3ChannelsData))!=NULL)
+			{
+				ControllerDB_StateSaveFinish((TC3ControllerPrivateDataPtr)theEntry->controllerRef,theState,
+												theEntry->mask,theEntry->resetMask,reply,&theEntry->shared);
+				batch->stateStatus[index] = kQ3Success;
+			}
+		}
+		else
+		{
+			TQ3Status methodStatus = kQ3Failure;
 			
-			//Do clean up
+			if (CFDictionaryGetValue(reply, CFSTR(k3Status))!=NULL)
+				IPCGetTQ3Uns32(reply, CFSTR(k3Status), (TQ3Uns32*)&methodStatus);
+			if (methodStatus==kQ3Success)
+			{
+				ControllerDB_StateRestoreFinish((TC3ControllerPrivateDataPtr)theEntry->controllerRef,theState,
+												theEntry->mask,theEntry->channelCount);
+				batch->stateStatus[index] = kQ3Success;
+			}
+		}
+	}
+	
+	ControllerDB_StateBatchRelease(batch);
+}
+
+
+
+//=============================================================================
+//      ControllerDB_StateBatchReply : Completion of an asynchronous driver
+//				request of a batch.
+//-----------------------------------------------------------------------------
+static void
+ControllerDB_StateBatchReply(SInt32 msgid, TQ3Status status, CFDictionaryRef returnDict, void *userData)
+{
+	TC3StateBatchDriver *theDriver = (TC3StateBatchDriver*)userData;
+	
+	ControllerDB_StateBatchDriverDone(theDriver->batch, (TQ3Uns32)(theDriver - theDriver->batch->driver),
+										(status==kQ3Success) ? returnDict : NULL);
+}
+
+
+
+//=============================================================================
+//      ControllerDB_StateBatchAdd : Queue the driver request of an entry.
+//-----------------------------------------------------------------------------
+//		Note : Requests are grouped per driver port; dict is released.
+//-----------------------------------------------------------------------------
+static TQ3Status
+ControllerDB_StateBatchAdd(TC3StateBatchPtr batch, TC3StateBatchEntry *theEntry, CFStringRef driverPortName, CFMutableDictionaryRef dict)
+{
+	TQ3Uns32 driverIndex;
+	
+	if ((dict==NULL) || (driverPortName==NULL))
+	{
+		if (dict)
 			CFRelease(dict);
+		return(kQ3Failure);
+	}
+	
+	for (driverIndex=0; driverIndex<batch->driverCount; driverIndex++)
+		if (CFEqual(batch->driver[driverIndex].driverPortName,driverPortName))
+			break;
+	
+	if (driverIndex==batch->driverCount)
+	{
+		TC3StateBatchDriver *theDriver = &batch->driver[batch->driverCount];
 		
+		theDriver->requests = CFArrayCreateMutable(kCFAllocatorDefault, 0, &kCFTypeArrayCallBacks);
+		if (theDriver->requests==NULL)
+		{
+			CFRelease(dict);
+			return(kQ3Failure);
+		}
+		theDriver->batch = batch;
+		theDriver->driverPortName = (CFStringRef)CFRetain(driverPortName);
+		theDriver->isDone = kQ3False;
+		batch->driverCount++;
+	}
+	
+	CFArrayAppendValue(batch->driver[driverIndex].requests, dict);
+	CFRelease(dict);
+	theEntry->driverIndex = driverIndex;
+	theEntry->phase = kC3StateBatchSent;
+	return(kQ3Success);
+}
+
+
+
+//=============================================================================
+//      ControllerDB_StateBatch : Save and reset, or restore, many states.
+//-----------------------------------------------------------------------------
+//		Note : One request per driver carries all its states. inParallel
+//				sends them asynchronously and returns; doneProc is called
+//				when the last reply arrived, which may be before return.
+//				Otherwise the drivers are asked one after the other.
+//				kQ3Failure if the batch couldn't start; doneProc isn't called.
+//-----------------------------------------------------------------------------
+TQ3Status
+ControllerDB_StateBatch(TQ3Boolean isRestore, TQ3Uns32 stateCount, const TQ3ControllerRef *controllerRefs, const TQ3Uns32 *ctrlStateHandles,
+						TQ3Boolean inParallel, TC3StateBatchDoneProc doneProc, void *userData)
+{
+	TC3StateBatchPtr	batch;
+	TQ3Uns32			index,other;
+	
+	batch = (TC3StateBatchPtr)calloc(1,sizeof(TC3StateBatch));
+	if (batch==NULL)
+		return(kQ3Failure);
+	
+	batch->entry = (TC3StateBatchEntry*)calloc((stateCount>0) ? stateCount : 1,sizeof(TC3StateBatchEntry));
+	batch->driver = (TC3StateBatchDriver*)calloc((stateCount>0) ? stateCount : 1,sizeof(TC3StateBatchDriver));
+	batch->stateStatus = (TQ3Status*)calloc((stateCount>0) ? stateCount : 1,sizeof(TQ3Status));
+	if ((batch->entry==NULL) || (batch->driver==NULL) || (batch->stateStatus==NULL))
+	{
+		free(batch->entry);
+		free(batch->driver);
+		free(batch->stateStatus);
+		free(batch);
+		return(kQ3Failure);
+	}
+	
+	batch->isRestore = isRestore;
+	batch->stateCount = stateCount;
+	batch->doneProc = doneProc;
+	batch->userData = userData;
+	
+	//-prepare the driver request of every state
+	for (index=0; index<stateCount; index++)
+	{
+		TC3StateBatchEntry			*theEntry = &batch->entry[index];
+		TC3ControllerPrivateDataPtr	theController = (TC3ControllerPrivateDataPtr)controllerRefs[index];
+		TC3ControllerStateDataPtr	theState = ControllerDB_StateLookup(controllerRefs[index],ctrlStateHandles[index]);
+		CFMutableDictionaryRef		dict;
+		
+		theEntry->controllerRef = controllerRefs[index];
+		theEntry->ctrlStateHandle = ctrlStateHandles[index];
+		theEntry->phase = kC3StateBatchDone;
+		batch->stateStatus[index] = kQ3Failure;
+		
+		if (theState==NULL)
+			continue;
+		
+		//several states of one controller: saves queue up behind the first, only the last restore counts
+		for (other=0; other<stateCount; other++)
+			if ((other!=index) && (controllerRefs[other]==controllerRefs[index]))
+				if ((isRestore==kQ3False) ? (other<index) : (other>index))
+					break;
+		if (other<stateCount)
+		{
+			if (isRestore==kQ3False)
+				theEntry->phase = kC3StateBatchLater;
+			else if (theState->isSaved==kQ3True)
+				batch->stateStatus[index] = kQ3Success;
+			continue;
+		}
+		
+		if (isRestore==kQ3False)
+		{
+			dict = ControllerDB_StateSavePrepare(theController,&theEntry->mask,&theEntry->resetMask,&theEntry->shared);
+			if ((theEntry->mask|theEntry->resetMask)==0)
+			{
+				ControllerDB_StateSaveFinish(theController,theState,0,0,NULL,&theEntry->shared);
+				batch->stateStatus[index] = kQ3Success;
+				continue;
+			}
+		}
+		else
+		{
+			if (theState->isSaved==kQ3False)
+				continue;
+			theEntry->mask = ControllerDB_StateRestoreMask(theController,theState,&theEntry->channelCount);
+			if (theEntry->mask==0)
+			{
+				batch->stateStatus[index] = kQ3Success;
+				continue;
+			}
+			dict = ControllerDB_StateRestorePrepare(theController,theState,theEntry->mask,theEntry->channelCount);
+		}
+		
+		ControllerDB_StateBatchAdd(batch,theEntry,theController->driverPortName,dict);
+	}
+	
+	//-one request per driver; the extra count keeps the batch alive while sending
+	batch->pendingCount = batch->driverCount+1;
+	for (index=0; index<batch->driverCount; index++)
+	{
+		TC3StateBatchDriver		*theDriver = &batch->driver[index];
+		SInt32					msgid = (isRestore==kQ3False) ? m3ControllerDriver_StateSaveAndResetBatch : m3ControllerDriver_StateRestoreBatch;
+		CFMutableDictionaryRef	dict,returnDict;
+		
+		dict = CFDictionaryCreateMutable(	kCFAllocatorDefault,0,
+											&kCFTypeDictionaryKeyCallBacks,
+											&kCFTypeDictionaryValueCallBacks);
+		if (dict==NULL)
+		{
+			ControllerDB_StateBatchDriverDone(batch,index,NULL);
+			continue;
+		}
+		CFDictionarySetValue(dict, CFSTR(k3CtrlStates), theDriver->requests);
+		
+		if (inParallel==kQ3True)
+		{
+			if (IPCAsync_SendRequest(theDriver->driverPortName,msgid,dict,ControllerDB_StateBatchReply,theDriver)==kQ3Failure)
+				ControllerDB_StateBatchDriverDone(batch,index,NULL);
+		}
+		else
+		{
+			returnDict = CFDictionaryCreateMutable(	kCFAllocatorDefault,0,
+													&kCFTypeDictionaryKeyCallBacks,
+													&kCFTypeDictionaryValueCallBacks);
+			if ((returnDict!=NULL)
+			 && (IPCDriver_Send(msgid,theDriver->driverPortName,dict,returnDict)==kQ3Success))
+				ControllerDB_StateBatchDriverDone(batch,index,(CFDictionaryRef)CFDictionaryGetValue(returnDict, CFSTR(k3MethodsReturn)));
+			else
+				ControllerDB_StateBatchDriverDone(batch,index,NULL);
 			if (returnDict)
 				CFRelease(returnDict);
 		}
+		CFRelease(dict);
+	}
+	ControllerDB_StateBatchRelease(batch);
+	
+	return(kQ3Success);
+}
+
+#pragma mark -
+
+//=============================================================================
+//      ControllerDB_FetchMethods : Ask the driver of a restored controller
+//				for its channel methods.
+//-----------------------------------------------------------------------------
+//		Note : The driver answers only to the capability it issued. Without
+//				one, or without an answer, the controller has no channels.
+//-----------------------------------------------------------------------------
+static void
+ControllerDB_FetchMethods(TC3ControllerPrivateDataPtr theController)
+{
+	CFMutableDictionaryRef	dict,returnDict;
+	CFDictionaryRef			methodsReturn;
+	TQ3Status				methodStatus = kQ3Failure;
+	TQ3ChannelGetMethod		channelGetMethod = NULL;
+	TQ3ChannelSetMethod		channelSetMethod = NULL;
+	
+	if ((theController->driverPortName==NULL) || (theController->driverToken==0))
+		return;
+	
+	dict = CFDictionaryCreateMutable(	kCFAllocatorDefault,0,
+										&kCFTypeDictionaryKeyCallBacks,
+										&kCFTypeDictionaryValueCallBacks);
+	returnDict = CFDictionaryCreateMutable(	kCFAllocatorDefault,0,
+											&kCFTypeDictionaryKeyCallBacks,
+											&kCFTypeDictionaryValueCallBacks);
+	if ((dict!=NULL) && (returnDict!=NULL))
+	{
+		IPCPutTQ3Uns32(dict, CFSTR(k3DriverHandle), &theController->driverHandle);
+		IPCPutTQ3Uns32(dict, CFSTR(k3CapToken), &theController->driverToken);
+		
+		if (IPCDriver_Send(m3ControllerDriver_GetMethods,theController->driverPortName,dict,returnDict)==kQ3Success)
+		{
+			methodsReturn = (CFDictionaryRef)CFDictionaryGetValue(returnDict,CFSTR(k3MethodsReturn));
+			if ((methodsReturn!=NULL) && (CFDictionaryGetValue(methodsReturn,CFSTR(k3Status))!=NULL))
+				IPCGetTQ3Uns32(methodsReturn,CFSTR(k3Status),(TQ3Uns32*)&methodStatus);
+			if (methodStatus==kQ3Success)
+			{
+				IPCGetBytes(methodsReturn, CFSTR(k3GetMethodRef), sizeof(TQ3ChannelGetMethod), &channelGetMethod);
+				IPCGetBytes(methodsReturn, CFSTR(k3SetMethodRef), sizeof(TQ3ChannelSetMethod), &channelSetMethod);
+				theController->publicData.channelGetMethod = channelGetMethod;
+				theController->publicData.channelSetMethod = channelSetMethod;
+			}
+		}
+	}
+	
+	if (dict)
+		CFRelease(dict);
+	if (returnDict)
+		CFRelease(returnDict);
+}
+
+
+
+//=============================================================================
+//      ControllerDB_Resolve : Controller of a ref, also of the last run.
+//-----------------------------------------------------------------------------
+//		Note : Refs handed out before the server restarted map to the
+//				controller restored from them. A restored controller whose
+//				driver is gone is decommissioned on first use; one whose driver
+//				is alive gets its channel methods from it again.
+//-----------------------------------------------------------------------------
+TQ3ControllerRef
+ControllerDB_Resolve(TQ3ControllerRef controllerRef)
+{
+	TC3ControllerPrivateDataPtr theController = NULL;
+	TC3ControllerPrivateDataPtr currentObj;
+	
+	if (controllerRef==NULL)
+		return(controllerRef);
+	
+	if (ControllerDB_refinlist(controllerRef)==kQ3True)
+		theController = (TC3ControllerPrivateDataPtr)controllerRef;
+	else
+		for (currentObj=controllerListAnchor; currentObj!=NULL; currentObj=(TC3ControllerPrivateDataPtr)currentObj->nextPrivateData)
+			if (currentObj->previousRef==controllerRef)
+			{
+				theController = currentObj;
+				break;
+			}
+	
+	if (theController==NULL)
+		return(controllerRef);
+	
+	if (theController->isRestored==kQ3True)
+	{
+		CFMessagePortRef driverPort = NULL;
 		
-	return(status);
+		theController->isRestored = kQ3False;
+		if (theController->driverPortName!=NULL)
+			driverPort = CFMessagePortCreateRemote(kCFAllocatorDefault, theController->driverPortName);
+		if (driverPort!=NULL)
+		{
+			CFRelease(driverPort);
+			ControllerDB_FetchMethods(theController);
+		}
+		else if (theController->isDecommissioned==kQ3False)
+			ControllerDB_Decommission(theController);
+	}
+	
+	return((TQ3ControllerRef)theController);
 }
+
+
+
+//=============================================================================
+//      ControllerDB_CopySnapshot : Registry and saved states as property list.
+//-----------------------------------------------------------------------------
+//		Note : Values, buttons and tracker positions are not part of it; the
+//				drivers send them again. Neither are the channel methods, they
+//				are addresses in the driver and must not come from a file.
+//				The caller releases the snapshot.
+//-----------------------------------------------------------------------------
+CFDictionaryRef
+ControllerDB_CopySnapshot(void)
+{
+	CFMutableDictionaryRef		snapshot,entry;
+	CFMutableArrayRef			controllers,states,channels;
+	TC3ControllerPrivateDataPtr	currentObj;
+	TC3ControllerStateDataPtr	theState;
+	TQ3Uns32					handle = kIPCHandleNone;
+	TQ3Uns32					index,channel;
+	TQ3ControllerRef			controllerRef;
+	CFStringRef					signature;
+	
+	snapshot = CFDictionaryCreateMutable(	kCFAllocatorDefault,0,
+											&kCFTypeDictionaryKeyCallBacks,
+											&kCFTypeDictionaryValueCallBacks);
+	controllers = CFArrayCreateMutable(kCFAllocatorDefault, 0, &kCFTypeArrayCallBacks);
+	states = CFArrayCreateMutable(kCFAllocatorDefault, 0, &kCFTypeArrayCallBacks);
+	
+	if ((snapshot==NULL) || (controllers==NULL) || (states==NULL))
+	{
+		if (snapshot)
+			CFRelease(snapshot);
+		if (controllers)
+			CFRelease(controllers);
+		if (states)
+			CFRelease(states);
+		return(NULL);
+	}
+	
+	//-controllers in list order; states refer to them by index
+	for (currentObj=controllerListAnchor; currentObj!=NULL; currentObj=(TC3ControllerPrivateDataPtr)currentObj->nextPrivateData)
+	{
+		entry = CFDictionaryCreateMutable(	kCFAllocatorDefault,0,
+											&kCFTypeDictionaryKeyCallBacks,
+											&kCFTypeDictionaryValueCallBacks);
+		if (entry==NULL)
+			continue;
+		
+		controllerRef = (TQ3ControllerRef)currentObj;
+		IPCPutControllerRef(entry, CFSTR(k3CtrlRef), &controllerRef);
+		signature = CFStringCreateWithCString(kCFAllocatorDefault,currentObj->publicData.signature,kCFStringEncodingASCII);
+		if (signature!=NULL)
+		{
+			CFDictionarySetValue(entry, CFSTR(k3Signature), signature);
+			CFRelease(signature);
+		}
+		IPCPutTQ3Uns32(entry, CFSTR(k3ValueCount), &currentObj->publicData.valueCount);
+		IPCPutTQ3Uns32(entry, CFSTR(k3ChannelCount), &currentObj->publicData.channelCount);
+		IPCPutTQ3Boolean(entry, CFSTR(k3Active), &currentObj->isActive);
+		IPCPutTQ3Boolean(entry, CFSTR(kC3SnapshotDecommissioned), &currentObj->isDecommissioned);
+		if (currentObj->driverPortName!=NULL)
+		{
+			CFDictionarySetValue(entry, CFSTR(k3DriverPortName), currentObj->driverPortName);
+			IPCPutTQ3Uns32(entry, CFSTR(k3DriverHandle), &currentObj->driverHandle);
+			IPCPutTQ3Uns32(entry, CFSTR(k3CapToken), &currentObj->driverToken);
+		}
+		if (currentObj->trackerPortName!=NULL)
+		{
+			CFDictionarySetValue(entry, CFSTR(k3TrackerPortName), currentObj->trackerPortName);
+			IPCPutTQ3Uns32(entry, CFSTR(k3TrackerHandle), &currentObj->trackerHandle);
+		}
+		
+		CFArrayAppendValue(controllers, entry);
+		CFRelease(entry);
+	}
+	
+	//-saved states with their handles
+	while ((theState = (TC3ControllerStateDataPtr)IPCHandle_Next(&controllerStates,&handle))!=NULL)
+	{
+		index = 0;
+		for (currentObj=controllerListAnchor; currentObj!=NULL; currentObj=(TC3ControllerPrivateDataPtr)currentObj->nextPrivateData, index++)
+			if ((TQ3ControllerRef)currentObj==theState->controllerRef)
+				break;
+		if (currentObj==NULL)
+			continue;
+		
+		entry = CFDictionaryCreateMutable(	kCFAllocatorDefault,0,
+											&kCFTypeDictionaryKeyCallBacks,
+											&kCFTypeDictionaryValueCallBacks);
+		channels = CFArrayCreateMutable(kCFAllocatorDefault, theState->channelCount, &kCFTypeArrayCallBacks);
+		if ((entry!=NULL) && (channels!=NULL))
+		{
+			IPCPutTQ3Uns32(entry, CFSTR(k3CtrlStateHandle), &handle);
+			IPCPutTQ3Uns32(entry, CFSTR(kC3SnapshotController), &index);
+			if (theState->isSaved==kQ3True)
+			{
+				for (channel=0; channel<theState->channelCount; channel++)
+				{
+					CFDataRef data = ControllerBlobs_GetData(theState->channelBlobs[channel]);
+					
+					//a channel saved unknown is stored as reset
+					CFArrayAppendValue(channels, (data!=NULL) ? data : ControllerBlobs_GetData(ControllerBlobs_Empty()));
+				}
+				CFDictionarySetValue(entry, CFSTR(k3ChannelsData), channels);
+			}
+			CFArrayAppendValue(states, entry);
+		}
+		if (entry)
+			CFRelease(entry);
+		if (channels)
+			CFRelease(channels);
+	}
+	
+	CFDictionarySetValue(snapshot, CFSTR(kC3SnapshotControllers), controllers);
+	CFDictionarySetValue(snapshot, CFSTR(kC3SnapshotStates), states);
+	CFRelease(controllers);
+	CFRelease(states);
+	return(snapshot);
+}
+
+
+
+//=============================================================================
+//      ControllerDB_RestoreSnapshot : Rebuild registry and saved states.
+//-----------------------------------------------------------------------------
+//		Note : For server start, before the list is populated. Restored
+//				controllers keep their activation; their drivers are checked
+//				by ControllerDB_Resolve when a client or driver uses them.
+//-----------------------------------------------------------------------------
+TQ3Status
+ControllerDB_RestoreSnapshot(CFDictionaryRef snapshot)
+{
+	CFArrayRef					controllers = (CFArrayRef)CFDictionaryGetValue(snapshot, CFSTR(kC3SnapshotControllers));
+	CFArrayRef					states = (CFArrayRef)CFDictionaryGetValue(snapshot, CFSTR(kC3SnapshotStates));
+	TC3ControllerPrivateDataPtr	*restored;
+	CFIndex						index,count;
+	TQ3Uns32					channel;
+	
+	if ((controllerListAnchor!=NULL) || (controllers==NULL) || (states==NULL))
+		return(kQ3Failure);
+	
+	count = CFArrayGetCount(controllers);
+	restored = (TC3ControllerPrivateDataPtr*)calloc((count>0) ? count : 1, sizeof(TC3ControllerPrivateDataPtr));
+	if (restored==NULL)
+		return(kQ3Failure);
+	
+	//-controllers
+	for (index=0; index<count; index++)
+	{
+		CFDictionaryRef		entry = (CFDictionaryRef)CFArrayGetValueAtIndex(controllers, index);
+		CFStringRef			signature = (CFStringRef)CFDictionaryGetValue(entry, CFSTR(k3Signature));
+		CFStringRef			portName;
+		TQ3ControllerData	controllerData;
+		char				signatureBuffer[256];
+		TC3ControllerPrivateDataPtr theController;
+		
+		if ((signature==NULL)
+		 || (CFStringGetCString(signature,signatureBuffer,sizeof(signatureBuffer),kCFStringEncodingASCII)==false))
+			continue;
+		
+		controllerData.signature = signatureBuffer;
+		IPCGetTQ3Uns32(entry, CFSTR(k3ValueCount), &controllerData.valueCount);
+		IPCGetTQ3Uns32(entry, CFSTR(k3ChannelCount), &controllerData.channelCount);
+		controllerData.channelGetMethod = NULL;		//the driver hands them out again, see ControllerDB_Resolve
+		controllerData.channelSetMethod = NULL;
+		
+		theController = (TC3ControllerPrivateDataPtr)ControllerDB_New(&controllerData);
+		if (theController==NULL)
+			continue;
+		restored[index] = theController;
+		
+		IPCGetControllerRef(entry, CFSTR(k3CtrlRef), &theController->previousRef);
+		IPCGetTQ3Boolean(entry, CFSTR(k3Active), &theController->isActive);
+		IPCGetTQ3Boolean(entry, CFSTR(kC3SnapshotDecommissioned), &theController->isDecommissioned);
+		theController->isRestored = kQ3True;
+		
+		portName = (CFStringRef)CFDictionaryGetValue(entry, CFSTR(k3DriverPortName));
+		if (portName!=NULL)
+		{
+			theController->driverPortName = (CFStringRef)CFRetain(portName);
+			if (CFDictionaryGetValue(entry, CFSTR(k3CapToken))!=NULL)
+			{
+				IPCGetTQ3Uns32(entry, CFSTR(k3DriverHandle), &theController->driverHandle);
+				IPCGetTQ3Uns32(entry, CFSTR(k3CapToken), &theController->driverToken);
+			}
+		}
+		portName = (CFStringRef)CFDictionaryGetValue(entry, CFSTR(k3TrackerPortName));
+		if (portName!=NULL)
+		{
+			theController->trackerPortName = (CFStringRef)CFRetain(portName);
+			IPCGetTQ3Uns32(entry, CFSTR(k3TrackerHandle), &theController->trackerHandle);
+		}
+	}
+	
+	//-a ref of the last run that is also a ref of this run is ambiguous
+	for (index=0; index<count; index++)
+		if (restored[index]!=NULL)
+			ControllerDB_ForgetPreviousRef(restored[index]);
+	
+	//-states under their old handles
+	for (index=0; index<CFArrayGetCount(states); index++)
+	{
+		CFDictionaryRef				entry = (CFDictionaryRef)CFArrayGetValueAtIndex(states, index);
+		CFArrayRef					channels = (CFArrayRef)CFDictionaryGetValue(entry, CFSTR(k3ChannelsData));
+		TC3ControllerStateDataPtr	theState;
+		TQ3Uns32					handle,controllerIndex;
+		
+		IPCGetTQ3Uns32(entry, CFSTR(k3CtrlStateHandle), &handle);
+		IPCGetTQ3Uns32(entry, CFSTR(kC3SnapshotController), &controllerIndex);
+		if ((controllerIndex>=(TQ3Uns32)count) || (restored[controllerIndex]==NULL))
+			continue;
+		
+		theState = (TC3ControllerStateDataPtr)malloc(sizeof(TC3ControllerStateData));
+		if (theState==NULL)
+			continue;
+		theState->controllerRef = (TQ3ControllerRef)restored[controllerIndex];
+		theState->isSaved = (channels!=NULL) ? kQ3True : kQ3False;
+		theState->channelCount = 0;
+		
+		if (channels!=NULL)
+			for (channel=0; (channel<(TQ3Uns32)CFArrayGetCount(channels)) && (channel<kQ3MaxControllerChannels); channel++)
+			{
+				TQ3Uns32 blobId = ControllerBlobs_Intern((CFDataRef)CFArrayGetValueAtIndex(channels, channel));
+				
+				if (blobId==kIPCHandleNone)
+				{
+					blobId = ControllerBlobs_Empty();
+					ControllerBlobs_Retain(blobId);
+				}
+				theState->channelBlobs[theState->channelCount++] = blobId;
+			}
+		
+		if (IPCHandle_InsertAt(&controllerStates,handle,theState)==kQ3Failure)
+		{
+			for (channel=0; channel<theState->channelCount; channel++)
+				ControllerBlobs_Release(theState->channelBlobs[channel]);
+			free(theState);
+		}
+	}
+	
+	free(restored);
+	controllerListSerialNumber++;
+	return(kQ3Success);
+}
+
@@ -68,6 +68,9 @@ extern "C" {
 typedef struct TC3TrackerInstanceData *TC3TrackerInstanceDataPtr;
 typedef struct TC3ControllerPrivateData *TC3ControllerPrivateDataPtr;
 
+//end of a ControllerDB_StateBatch; stateStatus is only valid for the duration of the call
+typedef void (*TC3StateBatchDoneProc)(TQ3Uns32 stateCount, const TQ3Status *stateStatus, void *userData);
+
 //=============================================================================
 //      Function prototypes
 //-----------------------------------------------------------------------------
@@ -75,6 +78,8 @@ TQ3Status					ControllerDB_GetListChanged(TQ3Boolean *listChanged, TQ3Uns32 *ser
 TQ3Status					ControllerDB_Next(TQ3ControllerRef controllerRef, TQ3ControllerRef *nextControllerRef);
 TQ3ControllerRef			ControllerDB_New(const TQ3ControllerData *controllerData);
 TQ3Status					ControllerDB_SetDriverPortName(TQ3ControllerRef controllerRef, CFStringRef thePortName);
+TQ3Status					ControllerDB_SetDriverToken(TQ3ControllerRef controllerRef, TQ3Uns32 driverHandle, TQ3Uns32 token);
+TQ3Status					ControllerDB_GetDriverEndpoint(TQ3ControllerRef controllerRef, CFStringRef *portName, TQ3Uns32 *driverHandle, TQ3Uns32 *token);
 TQ3Status					ControllerDB_Decommission(TQ3ControllerRef controllerRef);
 TQ3Status					ControllerDB_SetActivation(TQ3ControllerRef controllerRef, TQ3Boolean active);
 TQ3Status					ControllerDB_GetActivation(TQ3ControllerRef controllerRef, TQ3Boolean *active);
@@ -84,10 +89,16 @@ TQ3Status					ControllerDB_GetCFSignature(TQ3ControllerRef controllerRef, CFStri
 TQ3Status					ControllerDB_SetChannel(TQ3ControllerRef controllerRef, CFMutableDictionaryRef dict, CFMutableDictionaryRef returnDict);
 //TQ3Status					ControllerDB_GetChannel(TQ3ControllerRef controllerRef, TQ3Uns32 channel, void *data, TQ3Uns32 *dataSize);
 TQ3Status					ControllerDB_GetChannel(TQ3ControllerRef controllerRef, CFMutableDictionaryRef dict, CFMutableDictionaryRef returnDict);
+TQ3Status					ControllerDB_SetChannels(TQ3ControllerRef controllerRef, CFMutableDictionaryRef dict, CFMutableDictionaryRef returnDict);
+TQ3Status					ControllerDB_GetChannels(TQ3ControllerRef controllerRef, CFMutableDictionaryRef dict, CFMutableDictionaryRef returnDict);
+TQ3Status					ControllerDB_ChannelChanged(TQ3ControllerRef controllerRef, CFDictionaryRef dict);
 TQ3Status					ControllerDB_GetValueCount(TQ3ControllerRef controllerRef, TQ3Uns32 *valueCount);
 //TQ3Status					ControllerDB_SetTracker(TQ3ControllerRef controllerRef, TQ3TrackerObject tracker);
-TQ3Status					ControllerDB_SetTracker(TQ3ControllerRef controllerRef, CFStringRef trackerUUID, CFStringRef trackerPortName);
+TQ3Status					ControllerDB_SetTracker(TQ3ControllerRef controllerRef, TQ3Uns32 trackerHandle, CFStringRef trackerPortName);
 TQ3Status					ControllerDB_HasTracker(TQ3ControllerRef controllerRef, TQ3Boolean *hasTracker);
+TQ3Status					ControllerDB_NoteConsumerRead(TQ3ControllerRef controllerRef);
+TQ3Status					ControllerDB_GetConsumerState(TQ3ControllerRef controllerRef, TQ3Boolean *hasTracker, float *consumerRate);
+TQ3Status					ControllerDB_SetFilter(TQ3ControllerRef controllerRef, CFArrayRef stages);
 TQ3Status					ControllerDB_Track2DCursor(TQ3ControllerRef controllerRef, TQ3Boolean *track2DCursor);
 TQ3Status					ControllerDB_Track3DCursor(TQ3ControllerRef controllerRef, TQ3Boolean *track3DCursor);
 TQ3Status					ControllerDB_GetButtons(TQ3ControllerRef controllerRef, TQ3Uns32 *buttons);
@@ -102,10 +113,16 @@ TQ3Status					ControllerDB_GetValues(TQ3ControllerRef controllerRef, TQ3Uns32 va
 TQ3Status					ControllerDB_GetValuesRaw(TQ3ControllerRef controllerRef, TQ3Uns32 *valueCount, float *values, TQ3Uns32 *serialNumber);
 TQ3Status					ControllerDB_SetValues(TQ3ControllerRef controllerRef, const float *values, TQ3Uns32 valueCount);
 
-TQ3Status					ControllerDB_StateNew(TQ3ControllerRef controllerRef, CFStringRef *CtrlStateKey);
-TQ3Status					ControllerDB_StateDelete(TQ3ControllerRef controllerRef, CFStringRef CtrlStateKey);
-TQ3Status					ControllerDB_StateSaveAndReset(TQ3ControllerRef controllerRef, CFStringRef CtrlStateKey);
-TQ3Status					ControllerDB_StateRestore(TQ3ControllerRef controllerRef, CFStringRef CtrlStateKey);
+TQ3Status					ControllerDB_StateNew(TQ3ControllerRef controllerRef, TQ3Uns32 *ctrlStateHandle);
+TQ3Status					ControllerDB_StateDelete(TQ3ControllerRef controllerRef, TQ3Uns32 ctrlStateHandle);
+TQ3Status					ControllerDB_StateSaveAndReset(TQ3ControllerRef controllerRef, TQ3Uns32 ctrlStateHandle);
+TQ3Status					ControllerDB_StateRestore(TQ3ControllerRef controllerRef, TQ3Uns32 ctrlStateHandle);
+TQ3Status					ControllerDB_StateBatch(TQ3Boolean isRestore, TQ3Uns32 stateCount, const TQ3ControllerRef *controllerRefs, const TQ3Uns32 *ctrlStateHandles,
+													TQ3Boolean inParallel, TC3StateBatchDoneProc doneProc, void *userData);
+
+TQ3ControllerRef			ControllerDB_Resolve(TQ3ControllerRef controllerRef);
+CFDictionaryRef				ControllerDB_CopySnapshot(void);
+TQ3Status					ControllerDB_RestoreSnapshot(CFDictionaryRef snapshot);
 
 
 //=============================================================================
@@ -0,0 +1,550 @@
+/*  NAME:
+        ControllerFilter.c
+
+    DESCRIPTION:
+        Implementation of Quesa API Controller Core Library.
+		
+		Per-controller filter pipeline of the device server; see
+		ControllerFilter.h.
+      
+    COPYRIGHT:
+        Copyright (c) 1999-2005, Quesa Developers. All rights reserved.
+
+        For the current release of Quesa, please see:
+
+            <http://www.quesa.org/>
+        
+        Redistribution and use in source and binary forms, with or without
+        modification, are permitted provided that the following conditions
+        are met:
+        
+            o Redistributions of source code must retain the above copyright
+              notice, this list of conditions and the following disclaimer.
+        
+            o Redistributions in binary form must reproduce the above
+              copyright notice, this list of conditions and the following
+              disclaimer in the documentation and/or other materials provided
+              with the distribution.
+        
+            o Neither the name of Quesa nor the names of its contributors
+              may be used to endorse or promote products derived from this
+              software without specific prior written permission.
+        
+        THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+        "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+        LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+        A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+        OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+        SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+        TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+        PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+        LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+        NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+        SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+    ___________________________________________________________________________
+*/
+
+
+
+
+//=============================================================================
+//      Include files
+//-----------------------------------------------------------------------------
+#include <math.h>
+
+#include "ControllerFilter.h"
+#include "IPCMessageIDs.h"
+
+
+
+
+
+//=============================================================================
+//      Internal constants
+//-----------------------------------------------------------------------------
+#define kC3FilterMaxParams				3
+#define kC3FilterDefaultInterval		(1.0/60.0)	//seconds assumed before the second sample
+#define kC3FilterMaxInterval			1.0			//longer pauses restart the smoothing
+
+enum
+{
+	kC3FilterStageDeadZone			= 1,
+	kC3FilterStageGain				= 2,
+	kC3FilterStageSmooth			= 3,
+	kC3FilterStageOneEuro			= 4,
+	kC3FilterStageRemap				= 5
+};
+
+
+
+
+
+//=============================================================================
+//      Internal types
+//-----------------------------------------------------------------------------
+typedef struct TC3FilterStage
+{
+	TQ3Uns32				type;
+	float					param[kC3FilterMaxParams];
+	float					*estimate;			//Smooth, OneEuro: last output per channel
+	float					*slope;				//OneEuro: smoothed derivative per channel
+	TQ3Uns32				*source;			//Remap: source channel per output channel
+	float					*sign;				//Remap: 1 or -1 per output channel
+} TC3FilterStage;
+
+typedef struct TC3ControllerFilter
+{
+	TQ3Uns32				channelCount;
+	TQ3Uns32				stageCount;
+	TQ3Boolean				primed;				//the smoothing stages hold a sample
+	CFAbsoluteTime			lastTime;
+	float					*scratch;			//input copy of a Remap stage
+	TC3FilterStage			stage[kC3FilterMaxStages];
+} TC3ControllerFilter;
+
+
+
+
+
+//=============================================================================
+//      Internal functions
+//-----------------------------------------------------------------------------
+#pragma mark -
+//=============================================================================
+//      ControllerFilter_Param : Parameter index of a stage description.
+//-----------------------------------------------------------------------------
+static float
+ControllerFilter_Param(CFArrayRef params, CFIndex index, float defaultValue)
+{
+	CFNumberRef	number;
+	float		value;
+	
+	if ((params==NULL) || (index>=CFArrayGetCount(params)))
+		return(defaultValue);
+	
+	number = (CFNumberRef)CFArrayGetValueAtIndex(params,index);
+	if ((CFGetTypeID(number)!=CFNumberGetTypeID()) || (!CFNumberGetValue(number,kCFNumberFloatType,&value)))
+		return(defaultValue);
+	
+	return(value);
+}
+
+
+
+//=============================================================================
+//      ControllerFilter_ParseStage : Set up stage from its description.
+//-----------------------------------------------------------------------------
+//		Note : kQ3False for unknown types and unusable parameters; such a stage
+//				is left out of the pipeline.
+//-----------------------------------------------------------------------------
+static TQ3Boolean
+ControllerFilter_ParseStage(CFTypeRef description, TQ3Uns32 channelCount, TC3FilterStage *stage)
+{
+	CFStringRef	type;
+	CFArrayRef	params;
+	TQ3Uns32	index;
+	
+	if (CFGetTypeID(description)!=CFDictionaryGetTypeID())
+		return(kQ3False);
+	
+	type = (CFStringRef)CFDictionaryGetValue((CFDictionaryRef)description,CFSTR(k3FilterType));
+	if ((type==NULL) || (CFGetTypeID(type)!=CFStringGetTypeID()))
+		return(kQ3False);
+	
+	params = (CFArrayRef)CFDictionaryGetValue((CFDictionaryRef)description,CFSTR(k3FilterParams));
+	if ((params!=NULL) && (CFGetTypeID(params)!=CFArrayGetTypeID()))
+		params = NULL;
+	
+	memset(stage,0,sizeof(TC3FilterStage));
+	
+	if (CFStringCompare(type,CFSTR(k3FilterDeadZone),0)==kCFCompareEqualTo)
+	{
+		stage->type = kC3FilterStageDeadZone;
+		stage->param[0] = ControllerFilter_Param(params,0,0.0f);
+		return((stage->param[0]>0.0f) ? kQ3True : kQ3False);
+	}
+	
+	if (CFStringCompare(type,CFSTR(k3FilterGain),0)==kCFCompareEqualTo)
+	{
+		stage->type = kC3FilterStageGain;
+		stage->param[0] = ControllerFilter_Param(params,0,1.0f);
+		stage->param[1] = ControllerFilter_Param(params,1,1.0f);
+		return((stage->param[1]>0.0f) ? kQ3True : kQ3False);
+	}
+	
+	if (CFStringCompare(type,CFSTR(k3FilterSmooth),0)==kCFCompareEqualTo)
+	{
+		stage->type = kC3FilterStageSmooth;
+		stage->param[0] = ControllerFilter_Param(params,0,1.0f);
+		if ((stage->param[0]<=0.0f) || (stage->param[0]>=1.0f))
+			return(kQ3False);
+		stage->estimate = (float*)calloc(channelCount,sizeof(float));
+		return((stage->estimate!=NULL) ? kQ3True : kQ3False);
+	}
+	
+	if (CFStringCompare(type,CFSTR(k3FilterOneEuro),0)==kCFCompareEqualTo)
+	{
+		stage->type = kC3FilterStageOneEuro;
+		stage->param[0] = ControllerFilter_Param(params,0,1.0f);
+		stage->param[1] = ControllerFilter_Param(params,1,0.0f);
+		stage->param[2] = ControllerFilter_Param(params,2,1.0f);
+		if ((stage->param[0]<=0.0f) || (stage->param[1]<0.0f) || (stage->param[2]<=0.0f))
+			return(kQ3False);
+		stage->estimate = (float*)calloc(channelCount,sizeof(float));
+		stage->slope = (float*)calloc(channelCount,sizeof(float));
+		return(((stage->estimate!=NULL) && (stage->slope!=NULL)) ? kQ3True : kQ3False);
+	}
+	
+	if (CFStringCompare(type,CFSTR(k3FilterRemap),0)==kCFCompareEqualTo)
+	{
+		stage->type = kC3FilterStageRemap;
+		stage->source = (TQ3Uns32*)malloc(channelCount*sizeof(TQ3Uns32));
+		stage->sign = (float*)malloc(channelCount*sizeof(float));
+		if ((stage->source==NULL) || (stage->sign==NULL))
+			return(kQ3False);
+		
+		//channels without a usable entry stay where they are
+		for (index=0; index<channelCount; index++)
+		{
+			float from = ControllerFilter_Param(params,index,0.0f);
+			TQ3Uns32 channel = (TQ3Uns32)fabsf(from);
+			
+			stage->source[index] = index;
+			stage->sign[index] = 1.0f;
+			if ((channel>=1) && (channel<=channelCount))
+			{
+				stage->source[index] = channel-1;
+				stage->sign[index] = (from<0.0f) ? -1.0f : 1.0f;
+			}
+		}
+		return(kQ3True);
+	}
+	
+	return(kQ3False);
+}
+
+
+
+//=============================================================================
+//      ControllerFilter_FreeStage : Release the arrays of stage.
+//-----------------------------------------------------------------------------
+static void
+ControllerFilter_FreeStage(TC3FilterStage *stage)
+{
+	if (stage->estimate!=NULL)
+		free(stage->estimate);
+	if (stage->slope!=NULL)
+		free(stage->slope);
+	if (stage->source!=NULL)
+		free(stage->source);
+	if (stage->sign!=NULL)
+		free(stage->sign);
+	memset(stage,0,sizeof(TC3FilterStage));
+}
+
+
+
+//=============================================================================
+//      ControllerFilter_Alpha : Smoothing factor of a first order low pass.
+//-----------------------------------------------------------------------------
+static float
+ControllerFilter_Alpha(float cutoff, float interval)
+{
+	float tau = 1.0f / (2.0f * kQ3Pi * cutoff);
+	
+	return(1.0f / (1.0f + tau / interval));
+}
+
+
+
+
+
+//=============================================================================
+//      Public functions
+//-----------------------------------------------------------------------------
+#pragma mark -
+//=============================================================================
+//      ControllerFilter_New : Pipeline for channelCount channels.
+//-----------------------------------------------------------------------------
+//		Note : Stages are applied in the order of the array. At most
+//				kC3FilterMaxStages are used; invalid ones are skipped.
+//-----------------------------------------------------------------------------
+TC3ControllerFilterPtr
+ControllerFilter_New(CFArrayRef stages, TQ3Uns32 channelCount)
+{
+	TC3ControllerFilterPtr	filter;
+	CFIndex					index,count;
+	
+	if ((stages==NULL) || (channelCount==0) || (CFGetTypeID(stages)!=CFArrayGetTypeID()))
+		return(NULL);
+	
+	filter = (TC3ControllerFilterPtr)calloc(1,sizeof(TC3ControllerFilter));
+	if (filter==NULL)
+		return(NULL);
+	
+	filter->channelCount = channelCount;
+	filter->scratch = (float*)malloc(channelCount*sizeof(float));
+	if (filter->scratch==NULL)
+	{
+		free(filter);
+		return(NULL);
+	}
+	
+	count = CFArrayGetCount(stages);
+	for (index=0; (index<count) && (filter->stageCount<kC3FilterMaxStages); index++)
+	{
+		TC3FilterStage *stage = &filter->stage[filter->stageCount];
+		
+		if (ControllerFilter_ParseStage(CFArrayGetValueAtIndex(stages,index),channelCount,stage)==kQ3True)
+			filter->stageCount++;
+		else
+			ControllerFilter_FreeStage(stage);
+	}
+	
+	if (filter->stageCount==0)
+	{
+		ControllerFilter_Dispose(filter);
+		return(NULL);
+	}
+	
+	return(filter);
+}
+
+
+
+//=============================================================================
+//      ControllerFilter_Dispose : Release filter.
+//-----------------------------------------------------------------------------
+void
+ControllerFilter_Dispose(TC3ControllerFilterPtr filter)
+{
+	TQ3Uns32 index;
+	
+	if (filter==NULL)
+		return;
+	
+	for (index=0; index<filter->stageCount; index++)
+		ControllerFilter_FreeStage(&filter->stage[index]);
+	if (filter->scratch!=NULL)
+		free(filter->scratch);
+	free(filter);
+}
+
+
+
+//=============================================================================
+//      ControllerFilter_Reset : Forget the smoothing history.
+//-----------------------------------------------------------------------------
+void
+ControllerFilter_Reset(TC3ControllerFilterPtr filter)
+{
+	if (filter!=NULL)
+		filter->primed = kQ3False;
+}
+
+
+
+//=============================================================================
+//      ControllerFilter_Process : Run values through the pipeline.
+//-----------------------------------------------------------------------------
+//		Note : Every stage works through all channels before the next one
+//				starts; the inner loops are branch free where the stage
+//				allows, so the compiler can vectorize them.
+//-----------------------------------------------------------------------------
+void
+ControllerFilter_Process(TC3ControllerFilterPtr filter, float *values, TQ3Uns32 count, CFAbsoluteTime now)
+{
+	TQ3Uns32	stageIndex,index;
+	float		interval;
+	
+	if (filter==NULL)
+		return;
+	
+	if (count>filter->channelCount)
+		count = filter->channelCount;
+	
+	if ((filter->primed==kQ3True) && ((now - filter->lastTime)>kC3FilterMaxInterval))
+		filter->primed = kQ3False;
+	
+	interval = (float)(now - filter->lastTime);
+	if ((filter->primed==kQ3False) || (interval<=0.0f))
+		interval = (float)kC3FilterDefaultInterval;
+	
+	for (stageIndex=0; stageIndex<filter->stageCount; stageIndex++)
+	{
+		TC3FilterStage *stage = &filter->stage[stageIndex];
+		
+		switch (stage->type)
+		{
+			case kC3FilterStageDeadZone:
+			{
+				//shifted, so the output starts at 0 at the edge of the zone
+				float radius = stage->param[0];
+				for (index=0; index<count; index++)
+				{
+					float magnitude = fabsf(values[index]) - radius;
+					values[index] = copysignf((magnitude>0.0f) ? magnitude : 0.0f, values[index]);
+				}
+				break;
+			}
+			case kC3FilterStageGain:
+			{
+				float gain = stage->param[0];
+				float exponent = stage->param[1];
+				if (exponent==1.0f)
+					for (index=0; index<count; index++)
+						values[index] *= gain;
+				else
+					for (index=0; index<count; index++)
+						values[index] = copysignf(gain * powf(fabsf(values[index]),exponent), values[index]);
+				break;
+			}
+			case kC3FilterStageSmooth:
+			{
+				float alpha = stage->param[0];
+				float *estimate = stage->estimate;
+				if (filter->primed==kQ3False)
+					memcpy(estimate,values,count*sizeof(float));
+				for (index=0; index<count; index++)
+				{
+					estimate[index] += alpha * (values[index] - estimate[index]);
+					values[index] = estimate[index];
+				}
+				break;
+			}
+			case kC3FilterStageOneEuro:
+			{
+				//the cutoff rises with the speed: steady input is smoothed hard, fast motion lags little
+				float minCutoff = stage->param[0];
+				float beta = stage->param[1];
+				float slopeAlpha = ControllerFilter_Alpha(stage->param[2],interval);
+				float *estimate = stage->estimate;
+				float *slope = stage->slope;
+				if (filter->primed==kQ3False)
+				{
+					memcpy(estimate,values,count*sizeof(float));
+					memset(slope,0,count*sizeof(float));
+				}
+				for (index=0; index<count; index++)
+				{
+					float speed = (values[index] - estimate[index]) / interval;
+					float alpha;
+					
+					slope[index] += slopeAlpha * (speed - slope[index]);
+					alpha = ControllerFilter_Alpha(minCutoff + beta * fabsf(slope[index]),interval);
+					estimate[index] += alpha * (values[index] - estimate[index]);
+					values[index] = estimate[index];
+				}
+				break;
+			}
+			case kC3FilterStageRemap:
+			{
+				memcpy(filter->scratch,values,count*sizeof(float));
+				for (index=0; index<count; index++)
+					values[index] = (stage->source[index]<count) ? stage->sign[index] * filter->scratch[stage->source[index]] : 0.0f;
+				break;
+			}
+		}
+	}
+	
+	filter->primed = kQ3True;
+	filter->lastTime = now;
+}
+
+
+
+//=============================================================================
+//      ControllerFilter_ProcessVector : Run a translation delta through.
+//-----------------------------------------------------------------------------
+TQ3Boolean
+ControllerFilter_ProcessVector(TC3ControllerFilterPtr filter, TQ3Vector3D *delta, CFAbsoluteTime now)
+{
+	float channels[3];
+	
+	channels[0] = delta->x;
+	channels[1] = delta->y;
+	channels[2] = delta->z;
+	
+	ControllerFilter_Process(filter,channels,3,now);
+	
+	delta->x = channels[0];
+	delta->y = channels[1];
+	delta->z = channels[2];
+	
+	if ((delta->x==0.0f) && (delta->y==0.0f) && (delta->z==0.0f))
+		return(kQ3False);
+	return(kQ3True);
+}
+
+
+
+//=============================================================================
+//      ControllerFilter_ProcessRotation : Run a rotation delta through.
+//-----------------------------------------------------------------------------
+//		Note : The channels are the rotation vector (axis times angle in
+//				radians), so a dead zone is an angle and a remap swaps axes.
+//-----------------------------------------------------------------------------
+TQ3Boolean
+ControllerFilter_ProcessRotation(TC3ControllerFilterPtr filter, TQ3Quaternion *delta, CFAbsoluteTime now)
+{
+	float	channels[3];
+	float	sign,sinHalf,angle,scale;
+	
+	//shortest way round
+	sign = (delta->w<0.0f) ? -1.0f : 1.0f;
+	sinHalf = sqrtf(delta->x*delta->x + delta->y*delta->y + delta->z*delta->z);
+	angle = 2.0f * atan2f(sinHalf,sign*delta->w);
+	scale = (sinHalf>kQ3RealZero) ? sign*angle/sinHalf : 2.0f*sign;
+	
+	channels[0] = delta->x * scale;
+	channels[1] = delta->y * scale;
+	channels[2] = delta->z * scale;
+	
+	ControllerFilter_Process(filter,channels,3,now);
+	
+	angle = sqrtf(channels[0]*channels[0] + channels[1]*channels[1] + channels[2]*channels[2]);
+	if (angle==0.0f)
+	{
+		delta->w = 1.0f;
+		delta->x = delta->y = delta->z = 0.0f;
+		return(kQ3False);
+	}
+	
+	scale = sinf(0.5f*angle) / angle;
+	delta->w = cosf(0.5f*angle);
+	delta->x = channels[0] * scale;
+	delta->y = channels[1] * scale;
+	delta->z = channels[2] * scale;
+	return(kQ3True);
+}
+
+
+
+//=============================================================================
+//      ControllerFilter_CopyPreferredStages : Stages preferred for signature.
+//-----------------------------------------------------------------------------
+//		Note : The ControllerFilters preference of the server maps controller
+//				signatures to stage arrays, e.g. written with defaults(1).
+//-----------------------------------------------------------------------------
+CFArrayRef
+ControllerFilter_CopyPreferredStages(CFStringRef signature)
+{
+	CFPropertyListRef	preference;
+	CFArrayRef			stages = NULL;
+	
+	preference = CFPreferencesCopyAppValue(CFSTR(kC3FilterPreferencesKey),kCFPreferencesCurrentApplication);
+	if (preference==NULL)
+		return(NULL);
+	
+	if (CFGetTypeID(preference)==CFDictionaryGetTypeID())
+	{
+		stages = (CFArrayRef)CFDictionaryGetValue((CFDictionaryRef)preference,signature);
+		if ((stages!=NULL) && (CFGetTypeID(stages)==CFArrayGetTypeID()))
+			CFRetain(stages);
+		else
+			stages = NULL;
+	}
+	
+	CFRelease(preference);
+	return(stages);
+}
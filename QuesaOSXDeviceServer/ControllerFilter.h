@@ -0,0 +1,111 @@
+/*  NAME:
+        ControllerFilter.h
+
+    DESCRIPTION:
+        Implementation of Quesa API Controller Core Library.
+		
+		Per-controller filter pipeline of the device server. Values and
+		tracker deltas a driver sends pass a chain of stages (dead zone,
+		gain curve, exponential or One-Euro smoothing, axis remap) before
+		they are stored or forwarded, so drivers need not reimplement them
+		and clients see the same filtered stream.
+		
+		A pipeline is described by a CFArray of CFDictionary stages; the
+		keys are in IPCMessageIDs.h. It comes from the ControllerFilters
+		preference of the server (signature -> stages) or from a driver via
+		m3Controller_SetFilter.
+      
+    COPYRIGHT:
+        Copyright (c) 1999-2005, Quesa Developers. All rights reserved.
+
+        For the current release of Quesa, please see:
+
+            <http://www.quesa.org/>
+        
+        Redistribution and use in source and binary forms, with or without
+        modification, are permitted provided that the following conditions
+        are met:
+        
+            o Redistributions of source code must retain the above copyright
+              notice, this list of conditions and the following disclaimer.
+        
+            o Redistributions in binary form must reproduce the above
+              copyright notice, this list of conditions and the following
+              disclaimer in the documentation and/or other materials provided
+              with the distribution.
+        
+            o Neither the name of Quesa nor the names of its contributors
+              may be used to endorse or promote products derived from this
+              software without specific prior written permission.
+        
+        THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+        "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+        LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+        A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+        OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+        SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+        TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+        PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+        LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+        NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+        SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+    ___________________________________________________________________________
+*/
+
+
+
+
+#ifndef ControllerFilter_HDR
+#define ControllerFilter_HDR
+
+//=============================================================================
+//      Include files
+//-----------------------------------------------------------------------------
+#include <Carbon/Carbon.h>
+
+//=============================================================================
+//		C++ preamble
+//-----------------------------------------------------------------------------
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//=============================================================================
+//      Constants
+//-----------------------------------------------------------------------------
+#define kC3FilterMaxStages				8
+#define kC3FilterPreferencesKey			"ControllerFilters"	//server preference: signature -> stages
+
+//=============================================================================
+//      Types
+//-----------------------------------------------------------------------------
+typedef struct TC3ControllerFilter *TC3ControllerFilterPtr;
+
+//=============================================================================
+//      Function prototypes
+//-----------------------------------------------------------------------------
+//NULL, if stages is empty or describes no valid stage
+TC3ControllerFilterPtr		ControllerFilter_New(CFArrayRef stages, TQ3Uns32 channelCount);
+void						ControllerFilter_Dispose(TC3ControllerFilterPtr filter);
+
+//forgets the smoothing history, e.g. after a pause of the driver
+void						ControllerFilter_Reset(TC3ControllerFilterPtr filter);
+
+//filters values[0..count-1] in place; channels beyond the filter's channelCount pass unchanged
+void						ControllerFilter_Process(TC3ControllerFilterPtr filter, float *values, TQ3Uns32 count, CFAbsoluteTime now);
+
+//filter a tracker delta in place (a rotation as its rotation vector); kQ3False, if nothing is left of it
+TQ3Boolean					ControllerFilter_ProcessVector(TC3ControllerFilterPtr filter, TQ3Vector3D *delta, CFAbsoluteTime now);
+TQ3Boolean					ControllerFilter_ProcessRotation(TC3ControllerFilterPtr filter, TQ3Quaternion *delta, CFAbsoluteTime now);
+
+//stages for signature from the server preferences; NULL if there are none; the caller releases
+CFArrayRef					ControllerFilter_CopyPreferredStages(CFStringRef signature);
+
+//=============================================================================
+//		C++ postamble
+//-----------------------------------------------------------------------------
+#ifdef __cplusplus
+}
+#endif
+
+#endif
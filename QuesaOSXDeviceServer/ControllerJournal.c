@@ -0,0 +1,395 @@
+/*  NAME:
+        ControllerJournal.c
+
+    DESCRIPTION:
+        Implementation of Quesa API Controller Core Library.
+		
+		Memory-mapped, append-only journal of the controller input stream;
+		see ControllerJournal.h.
+      
+    COPYRIGHT:
+        Copyright (c) 1999-2005, Quesa Developers. All rights reserved.
+
+        For the current release of Quesa, please see:
+
+            <http://www.quesa.org/>
+        
+        Redistribution and use in source and binary forms, with or without
+        modification, are permitted provided that the following conditions
+        are met:
+        
+            o Redistributions of source code must retain the above copyright
+              notice, this list of conditions and the following disclaimer.
+        
+            o Redistributions in binary form must reproduce the above
+              copyright notice, this list of conditions and the following
+              disclaimer in the documentation and/or other materials provided
+              with the distribution.
+        
+            o Neither the name of Quesa nor the names of its contributors
+              may be used to endorse or promote products derived from this
+              software without specific prior written permission.
+        
+        THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+        "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+        LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+        A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+        OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+        SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+        TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+        PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+        LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+        NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+        SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+    ___________________________________________________________________________
+*/
+
+
+
+//=============================================================================
+//      Include files
+//-----------------------------------------------------------------------------
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <mach/mach_time.h>
+
+#include "ControllerJournal.h"
+#include "C3MachTime.h"
+
+
+
+
+
+//=============================================================================
+//      Internal constants
+//-----------------------------------------------------------------------------
+#define kC3JournalInitialRecords		16384		//1 MB
+#define kC3JournalMaxControllers		256
+
+
+
+
+
+//=============================================================================
+//      Internal types
+//-----------------------------------------------------------------------------
+//compile time check of the record layout; a negative array size fails to compile
+typedef char TC3JournalHeaderSizeCheck[(sizeof(TC3JournalHeader)==kC3JournalRecordSize) ? 1 : -1];
+typedef char TC3JournalRecordSizeCheck[(sizeof(TC3JournalRecord)==kC3JournalRecordSize) ? 1 : -1];
+
+typedef struct TC3JournalState
+{
+	int						fileDescriptor;
+	UInt8					*mapping;			//NULL: journal closed
+	UInt32					capacity;			//records the mapping can hold
+	UInt32					maxRecords;
+	UInt64					startTime;			//mach_absolute_time at open
+	mach_timebase_info_data_t
+							timebase;
+	TQ3ControllerRef		controllers[kC3JournalMaxControllers];	//index+1 is the controllerId
+	UInt32					controllerCount;
+} TC3JournalState;
+
+
+
+
+
+//=============================================================================
+//      Internal variables
+//-----------------------------------------------------------------------------
+static TC3JournalState		journal = { -1, NULL, 0, 0, 0, { 0, 0 }, { NULL }, 0 };
+
+
+
+
+
+//=============================================================================
+//      Internal functions
+//-----------------------------------------------------------------------------
+#pragma mark -
+//=============================================================================
+//      ControllerJournal_Header : Header of the mapped journal.
+//-----------------------------------------------------------------------------
+static TC3JournalHeader *
+ControllerJournal_Header(void)
+{
+	return((TC3JournalHeader*)journal.mapping);
+}
+
+
+
+//=============================================================================
+//      ControllerJournal_Map : (Re)map the journal with room for capacity
+//				records.
+//-----------------------------------------------------------------------------
+static TQ3Status
+ControllerJournal_Map(UInt32 capacity)
+{
+	size_t	newSize = (size_t)(capacity+1)*kC3JournalRecordSize;
+	UInt8	*newMapping;
+	
+	if (ftruncate(journal.fileDescriptor, (off_t)newSize)!=0)
+		return(kQ3Failure);
+	
+	newMapping = (UInt8*)mmap(NULL, newSize, PROT_READ|PROT_WRITE, MAP_SHARED, journal.fileDescriptor, 0);
+	if (newMapping==(UInt8*)MAP_FAILED)
+		return(kQ3Failure);
+	
+	if (journal.mapping!=NULL)
+		munmap(journal.mapping, (size_t)(journal.capacity+1)*kC3JournalRecordSize);
+	
+	journal.mapping = newMapping;
+	journal.capacity = capacity;
+	return(kQ3Success);
+}
+
+
+
+//=============================================================================
+//      ControllerJournal_Append : Reserve the next record.
+//-----------------------------------------------------------------------------
+//		Note : Returns NULL if the journal is full; the record is committed
+//				by ControllerJournal_Commit.
+//-----------------------------------------------------------------------------
+static TC3JournalRecord *
+ControllerJournal_Append(UInt16 recordType, UInt16 controllerId)
+{
+	TC3JournalHeader	*header = ControllerJournal_Header();
+	TC3JournalRecord	*record;
+	UInt64				elapsed;
+	
+	if (header->recordCount==journal.capacity)
+	{
+		UInt32 newCapacity = journal.capacity*2;
+		if (newCapacity>journal.maxRecords)
+			newCapacity = journal.maxRecords;
+		
+		if ((newCapacity<=journal.capacity) || (ControllerJournal_Map(newCapacity)==kQ3Failure))
+		{
+			ControllerJournal_Header()->droppedCount++;
+			return(NULL);
+		}
+		header = ControllerJournal_Header();
+	}
+	
+	elapsed = mach_absolute_time() - journal.startTime;
+	
+	record = (TC3JournalRecord*)(journal.mapping + (size_t)(header->recordCount+1)*kC3JournalRecordSize);
+	memset(record, 0, sizeof(TC3JournalRecord));
+	record->timeStamp = CC3MachTime_ToNanoseconds(elapsed, &journal.timebase);
+	record->recordType = recordType;
+	record->controllerId = controllerId;
+	return(record);
+}
+
+
+
+//=============================================================================
+//      ControllerJournal_Commit : Make the last appended record visible.
+//-----------------------------------------------------------------------------
+static void
+ControllerJournal_Commit(void)
+{
+	ControllerJournal_Header()->recordCount++;
+}
+
+
+
+//=============================================================================
+//      ControllerJournal_ControllerId : Id of a controller in this journal.
+//-----------------------------------------------------------------------------
+//		Note : The first time a controller shows up it is announced by a
+//				kC3JournalController record. 0 if there is no room.
+//-----------------------------------------------------------------------------
+static UInt16
+ControllerJournal_ControllerId(TQ3ControllerRef controllerRef, const TQ3ControllerData *controllerData)
+{
+	TC3JournalRecord	*record;
+	UInt32				index;
+	
+	for (index=0; index<journal.controllerCount; index++)
+		if (journal.controllers[index]==controllerRef)
+			return((UInt16)(index+1));
+	
+	if (journal.controllerCount==kC3JournalMaxControllers)
+		return(0);
+	
+	record = ControllerJournal_Append(kC3JournalController, (UInt16)(journal.controllerCount+1));
+	if (record==NULL)
+		return(0);
+	
+	record->data.controller.valueCount = controllerData->valueCount;
+	strncpy(record->data.controller.signature, controllerData->signature, kC3JournalSignatureSize-1);
+	ControllerJournal_Commit();
+	
+	journal.controllers[journal.controllerCount++] = controllerRef;
+	return((UInt16)journal.controllerCount);
+}
+
+
+
+
+
+//=============================================================================
+//      Public functions
+//-----------------------------------------------------------------------------
+#pragma mark -
+//=============================================================================
+//      ControllerJournal_Open : Start recording into path.
+//-----------------------------------------------------------------------------
+//		Note : An existing file is replaced. The journal grows on demand up to
+//				maxRecords records; later records are counted as dropped.
+//-----------------------------------------------------------------------------
+TQ3Status
+ControllerJournal_Open(const char *path, UInt32 maxRecords)
+{
+	TC3JournalHeader *header;
+	
+	if ((journal.mapping!=NULL) || (path==NULL) || (maxRecords==0))
+		return(kQ3Failure);
+	
+	journal.fileDescriptor = open(path, O_RDWR|O_CREAT|O_TRUNC, 0644);
+	if (journal.fileDescriptor<0)
+		return(kQ3Failure);
+	
+	journal.maxRecords = maxRecords;
+	if (ControllerJournal_Map((maxRecords<kC3JournalInitialRecords) ? maxRecords : kC3JournalInitialRecords)==kQ3Failure)
+	{
+		close(journal.fileDescriptor);
+		journal.fileDescriptor = -1;
+		return(kQ3Failure);
+	}
+	
+	mach_timebase_info(&journal.timebase);
+	journal.startTime = mach_absolute_time();
+	journal.controllerCount = 0;
+	
+	header = ControllerJournal_Header();
+	header->magic = kC3JournalMagic;
+	header->version = kC3JournalVersion;
+	header->recordSize = kC3JournalRecordSize;
+	header->recordCount = 0;
+	header->droppedCount = 0;
+	header->openTime = CFAbsoluteTimeGetCurrent();
+	
+	return(kQ3Success);
+}
+
+
+
+//=============================================================================
+//      ControllerJournal_Close : Stop recording.
+//-----------------------------------------------------------------------------
+//		Note : The file is cut to the committed records.
+//-----------------------------------------------------------------------------
+TQ3Status
+ControllerJournal_Close(void)
+{
+	size_t	usedSize;
+	
+	if (journal.mapping==NULL)
+		return(kQ3Failure);
+	
+	usedSize = (size_t)(ControllerJournal_Header()->recordCount+1)*kC3JournalRecordSize;
+	
+	msync(journal.mapping, (size_t)(journal.capacity+1)*kC3JournalRecordSize, MS_SYNC);
+	munmap(journal.mapping, (size_t)(journal.capacity+1)*kC3JournalRecordSize);
+	ftruncate(journal.fileDescriptor, (off_t)usedSize);
+	close(journal.fileDescriptor);
+	
+	journal.mapping = NULL;
+	journal.fileDescriptor = -1;
+	journal.capacity = 0;
+	journal.controllerCount = 0;
+	return(kQ3Success);
+}
+
+
+
+//=============================================================================
+//      ControllerJournal_IsOpen : kQ3True while recording.
+//-----------------------------------------------------------------------------
+TQ3Boolean
+ControllerJournal_IsOpen(void)
+{
+	return((journal.mapping!=NULL) ? kQ3True : kQ3False);
+}
+
+
+
+//=============================================================================
+//      ControllerJournal_Record : Append one event of a controller.
+//-----------------------------------------------------------------------------
+//		Note : data is copied into the record; dataSize must fit the union of
+//				TC3JournalRecord. Does nothing while the journal is closed.
+//-----------------------------------------------------------------------------
+void
+ControllerJournal_Record(TQ3ControllerRef controllerRef, const TQ3ControllerData *controllerData, UInt16 recordType, const void *data, UInt32 dataSize)
+{
+	TC3JournalRecord	*record;
+	UInt16				controllerId;
+	
+	if (journal.mapping==NULL)
+		return;
+	
+	if (dataSize>sizeof(record->data))
+		return;
+	
+	controllerId = ControllerJournal_ControllerId(controllerRef, controllerData);
+	if (controllerId==0)
+		return;
+	
+	record = ControllerJournal_Append(recordType, controllerId);
+	if (record==NULL)
+		return;
+	
+	if (data!=NULL)
+		memcpy(&record->data, data, dataSize);
+	ControllerJournal_Commit();
+}
+
+
+
+//=============================================================================
+//      ControllerJournal_RecordValues : Append a SetValues call.
+//-----------------------------------------------------------------------------
+//		Note : Split into chunks of kC3JournalValuesPerRecord values. A
+//				replayer issues the call when the chunk ending at valueCount
+//				arrives.
+//-----------------------------------------------------------------------------
+void
+ControllerJournal_RecordValues(TQ3ControllerRef controllerRef, const TQ3ControllerData *controllerData, const float *values, TQ3Uns32 valueCount)
+{
+	TC3JournalRecord	*record;
+	UInt16				controllerId;
+	TQ3Uns32			firstValue = 0;
+	
+	if (journal.mapping==NULL)
+		return;
+	
+	controllerId = ControllerJournal_ControllerId(controllerRef, controllerData);
+	if (controllerId==0)
+		return;
+	
+	do
+	{
+		TQ3Uns32 chunkCount = valueCount-firstValue;
+		if (chunkCount>kC3JournalValuesPerRecord)
+			chunkCount = kC3JournalValuesPerRecord;
+		
+		record = ControllerJournal_Append(kC3JournalValues, controllerId);
+		if (record==NULL)
+			return;
+		
+		record->data.values.firstValue = (UInt16)firstValue;
+		record->data.values.chunkCount = (UInt16)chunkCount;
+		record->data.values.valueCount = valueCount;
+		memcpy(record->data.values.values, values+firstValue, chunkCount*sizeof(float));
+		ControllerJournal_Commit();
+		
+		firstValue += chunkCount;
+	}
+	while (firstValue<valueCount);
+}
@@ -0,0 +1,152 @@
+/*  NAME:
+        ControllerJournal.h
+
+    DESCRIPTION:
+        Implementation of Quesa API Controller Core Library.
+		
+		Opt-in recorder of the input stream of the device server. Every
+		SetValues, tracker move, button and activation change that reaches
+		the controller database is appended, with a monotonic time stamp, to
+		a memory-mapped journal of fixed-size records.
+		
+		The record layout is shared with Tools/JournalReplay.
+      
+    COPYRIGHT:
+        Copyright (c) 1999-2005, Quesa Developers. All rights reserved.
+
+        For the current release of Quesa, please see:
+
+            <http://www.quesa.org/>
+        
+        Redistribution and use in source and binary forms, with or without
+        modification, are permitted provided that the following conditions
+        are met:
+        
+            o Redistributions of source code must retain the above copyright
+              notice, this list of conditions and the following disclaimer.
+        
+            o Redistributions in binary form must reproduce the above
+              copyright notice, this list of conditions and the following
+              disclaimer in the documentation and/or other materials provided
+              with the distribution.
+        
+            o Neither the name of Quesa nor the names of its contributors
+              may be used to endorse or promote products derived from this
+              software without specific prior written permission.
+        
+        THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+        "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+        LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+        A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+        OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+        SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+        TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+        PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+        LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+        NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+        SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+    ___________________________________________________________________________
+*/
+
+
+
+#ifndef ControllerJournal_HDR
+#define ControllerJournal_HDR
+
+//=============================================================================
+//      Include files
+//-----------------------------------------------------------------------------
+#include <Carbon/Carbon.h>
+
+//=============================================================================
+//		C++ preamble
+//-----------------------------------------------------------------------------
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//=============================================================================
+//      Constants
+//-----------------------------------------------------------------------------
+#define kC3JournalMagic					0x51334A52		//'Q3JR'
+#define kC3JournalVersion				1
+#define kC3JournalRecordSize			64
+#define kC3JournalValuesPerRecord		10
+#define kC3JournalSignatureSize			44
+#define kC3JournalEnvironment			"QUESA_CONTROLLER_JOURNAL"	//path of the journal; unset: no recording
+#define kC3JournalDefaultMaxRecords		(4*1024*1024)				//256 MB
+
+enum
+{
+	kC3JournalController			= 1,	//announces controllerId; precedes all records of that controller
+	kC3JournalDecommission			= 2,
+	kC3JournalActivation			= 3,
+	kC3JournalButtons				= 4,
+	kC3JournalSetPosition			= 5,
+	kC3JournalMovePosition			= 6,
+	kC3JournalSetOrientation		= 7,
+	kC3JournalMoveOrientation		= 8,
+	kC3JournalValues				= 9		//one SetValues may span several records
+};
+
+//=============================================================================
+//      Types
+//-----------------------------------------------------------------------------
+//first kC3JournalRecordSize bytes of the file; records follow
+typedef struct TC3JournalHeader
+{
+	UInt32					magic;
+	UInt32					version;
+	UInt32					recordSize;
+	UInt32					recordCount;		//committed records; written after the record itself
+	UInt32					droppedCount;		//records lost because the journal was full
+	UInt32					reserved;
+	CFAbsoluteTime			openTime;			//wall clock at time stamp 0
+	UInt8					padding[kC3JournalRecordSize - 32];
+} TC3JournalHeader;
+
+typedef struct TC3JournalRecord
+{
+	UInt64					timeStamp;			//nanoseconds since the journal was opened, monotonic
+	UInt16					recordType;
+	UInt16					controllerId;
+	UInt32					reserved;
+	union
+	{
+		struct
+		{
+			UInt32			valueCount;
+			char			signature[kC3JournalSignatureSize];	//truncated, always terminated
+		}					controller;
+		UInt32				active;
+		UInt32				buttons;
+		TQ3Point3D			position;
+		TQ3Vector3D			delta;
+		TQ3Quaternion		orientation;
+		struct
+		{
+			UInt16			firstValue;
+			UInt16			chunkCount;
+			UInt32			valueCount;			//of the whole SetValues call
+			float			values[kC3JournalValuesPerRecord];
+		}					values;
+	}						data;
+} TC3JournalRecord;
+
+//=============================================================================
+//      Function prototypes
+//-----------------------------------------------------------------------------
+TQ3Status					ControllerJournal_Open(const char *path, UInt32 maxRecords);
+TQ3Status					ControllerJournal_Close(void);
+TQ3Boolean					ControllerJournal_IsOpen(void);
+void						ControllerJournal_Record(TQ3ControllerRef controllerRef, const TQ3ControllerData *controllerData, UInt16 recordType, const void *data, UInt32 dataSize);
+void						ControllerJournal_RecordValues(TQ3ControllerRef controllerRef, const TQ3ControllerData *controllerData, const float *values, TQ3Uns32 valueCount);
+
+//=============================================================================
+//		C++ postamble
+//-----------------------------------------------------------------------------
+#ifdef __cplusplus
+}
+#endif
+
+#endif
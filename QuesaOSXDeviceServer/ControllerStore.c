@@ -0,0 +1,471 @@
+/*  NAME:
+        ControllerStore.c
+
+    DESCRIPTION:
+        Crash consistent file of the controller registry and saved states.
+		
+		Snapshots are written alternately into two regions of a mapped file.
+		A slot in the header is updated only after its snapshot is synced,
+		so a crash leaves the previous snapshot intact.
+      
+    COPYRIGHT:
+        Copyright (c) 1999-2005, Quesa Developers. All rights reserved.
+
+        For the current release of Quesa, please see:
+
+            <http://www.quesa.org/>
+        
+        Redistribution and use in source and binary forms, with or without
+        modification, are permitted provided that the following conditions
+        are met:
+        
+            o Redistributions of source code must retain the above copyright
+              notice, this list of conditions and the following disclaimer.
+        
+            o Redistributions in binary form must reproduce the above
+              copyright notice, this list of conditions and the following
+              disclaimer in the documentation and/or other materials provided
+              with the distribution.
+        
+            o Neither the name of Quesa nor the names of its contributors
+              may be used to endorse or promote products derived from this
+              software without specific prior written permission.
+        
+        THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+        "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+        LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+        A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+        OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+        SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+        TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+        PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+        LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+        NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+        SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+    ___________________________________________________________________________
+*/
+
+
+
+
+//=============================================================================
+//      Include files
+//-----------------------------------------------------------------------------
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pwd.h>
+#include <errno.h>
+
+#include "ControllerStore.h"
+#include "ControllerDB.h"
+
+
+
+
+
+//=============================================================================
+//      Internal constants
+//-----------------------------------------------------------------------------
+#define kC3StoreSlotSpacing				(kC3StoreHeaderSize/2)	//slots in separate sectors
+#define kC3StoreGrowSize				65536
+#define kC3StoreHashBasis				2166136261U		//FNV-1a
+#define kC3StoreHashPrime				16777619U
+
+
+
+
+
+//=============================================================================
+//      Internal types
+//-----------------------------------------------------------------------------
+typedef struct TC3StoreState
+{
+	int						fileDescriptor;
+	UInt8					*mapping;			//NULL: store closed
+	size_t					mappedSize;
+	TQ3Boolean				isDirty;
+	CFRunLoopTimerRef		writeTimer;			//NULL: no write scheduled
+} TC3StoreState;
+
+
+
+
+
+//=============================================================================
+//      Internal variables
+//-----------------------------------------------------------------------------
+static TC3StoreState		store = { -1, NULL, 0, kQ3False, NULL };
+
+
+
+
+
+//=============================================================================
+//      Internal functions
+//-----------------------------------------------------------------------------
+#pragma mark -
+//=============================================================================
+//      ControllerStore_Slot : Header slot index of the mapped file.
+//-----------------------------------------------------------------------------
+static TC3StoreSlot *
+ControllerStore_Slot(UInt32 index)
+{
+	return((TC3StoreSlot*)(store.mapping + index*kC3StoreSlotSpacing));
+}
+
+
+
+//=============================================================================
+//      ControllerStore_Checksum : FNV-1a of a snapshot and its slot fields.
+//-----------------------------------------------------------------------------
+static UInt32
+ControllerStore_Checksum(const UInt8 *bytes, UInt32 length, UInt32 generation, UInt32 offset)
+{
+	UInt32	hash = kC3StoreHashBasis;
+	UInt32	fields[3];
+	UInt32	index;
+	
+	for (index=0; index<length; index++)
+	{
+		hash ^= bytes[index];
+		hash *= kC3StoreHashPrime;
+	}
+	
+	fields[0] = generation;
+	fields[1] = offset;
+	fields[2] = length;
+	for (index=0; index<sizeof(fields); index++)
+	{
+		hash ^= ((UInt8*)fields)[index];
+		hash *= kC3StoreHashPrime;
+	}
+	return(hash);
+}
+
+
+
+//=============================================================================
+//      ControllerStore_ActiveSlot : Slot of the last committed snapshot.
+//-----------------------------------------------------------------------------
+//		Note : -1 if neither slot is valid, e.g. in a new file.
+//-----------------------------------------------------------------------------
+static int
+ControllerStore_ActiveSlot(void)
+{
+	int		active = -1;
+	UInt32	index;
+	
+	for (index=0; index<2; index++)
+	{
+		TC3StoreSlot *slot = ControllerStore_Slot(index);
+		
+		if ((slot->magic!=kC3StoreMagic) || (slot->version!=kC3StoreVersion)
+		 || (slot->offset<kC3StoreHeaderSize) || (slot->length>store.mappedSize)
+		 || (slot->offset>store.mappedSize-slot->length))
+			continue;
+		
+		if (slot->checksum!=ControllerStore_Checksum(store.mapping+slot->offset,slot->length,slot->generation,slot->offset))
+			continue;
+		
+		if ((active<0) || (slot->generation-ControllerStore_Slot(active)->generation<0x80000000))
+			active = (int)index;
+	}
+	return(active);
+}
+
+
+
+//=============================================================================
+//      ControllerStore_Map : (Re)map the file with at least size bytes.
+//-----------------------------------------------------------------------------
+static TQ3Status
+ControllerStore_Map(size_t size)
+{
+	UInt8	*newMapping;
+	
+	if (ftruncate(store.fileDescriptor, (off_t)size)!=0)
+		return(kQ3Failure);
+	
+	newMapping = (UInt8*)mmap(NULL, size, PROT_READ|PROT_WRITE, MAP_SHARED, store.fileDescriptor, 0);
+	if (newMapping==(UInt8*)MAP_FAILED)
+		return(kQ3Failure);
+	
+	if (store.mapping!=NULL)
+		munmap(store.mapping, store.mappedSize);
+	
+	store.mapping = newMapping;
+	store.mappedSize = size;
+	return(kQ3Success);
+}
+
+
+
+//=============================================================================
+//      ControllerStore_Sync : Flush a range of the mapping to the file.
+//-----------------------------------------------------------------------------
+static void
+ControllerStore_Sync(size_t offset, size_t length)
+{
+	size_t pageOffset = offset & ~((size_t)getpagesize()-1);
+	
+	msync(store.mapping+pageOffset, length+(offset-pageOffset), MS_SYNC);
+}
+
+
+
+//=============================================================================
+//      ControllerStore_IsPrivate : Is fileInfo ours and closed to others?
+//-----------------------------------------------------------------------------
+static TQ3Boolean
+ControllerStore_IsPrivate(const struct stat *fileInfo)
+{
+	if ((fileInfo->st_uid!=geteuid()) || ((fileInfo->st_mode & (S_IRWXG|S_IRWXO))!=0))
+		return(kQ3False);
+	return(kQ3True);
+}
+
+
+
+//=============================================================================
+//      ControllerStore_Write : Commit a snapshot.
+//-----------------------------------------------------------------------------
+//		Note : The snapshot goes next to the active one and is synced before
+//				the other slot is pointed at it.
+//-----------------------------------------------------------------------------
+static TQ3Status
+ControllerStore_Write(CFDataRef snapshot)
+{
+	int				active = ControllerStore_ActiveSlot();
+	TC3StoreSlot	*activeSlot = (active>=0) ? ControllerStore_Slot(active) : NULL;
+	TC3StoreSlot	*slot = ControllerStore_Slot((active>=0) ? 1-active : 0);
+	UInt32			length = (UInt32)CFDataGetLength(snapshot);
+	UInt32			offset = kC3StoreHeaderSize;
+	UInt32			generation = (activeSlot!=NULL) ? activeSlot->generation+1 : 1;
+	
+	if ((activeSlot!=NULL) && (offset<activeSlot->offset+activeSlot->length) && (activeSlot->offset<offset+length))
+		offset = (activeSlot->offset+activeSlot->length+kC3StoreHeaderSize-1) & ~(kC3StoreHeaderSize-1);
+	
+	if ((size_t)offset+length>store.mappedSize)
+	{
+		size_t newSize = ((size_t)offset+length+kC3StoreGrowSize-1) & ~((size_t)kC3StoreGrowSize-1);
+		
+		if (ControllerStore_Map(newSize)==kQ3Failure)
+			return(kQ3Failure);
+		slot = ControllerStore_Slot((active>=0) ? 1-active : 0);
+	}
+	
+	memcpy(store.mapping+offset, CFDataGetBytePtr(snapshot), length);
+	ControllerStore_Sync(offset, length);
+	
+	slot->magic = kC3StoreMagic;
+	slot->version = kC3StoreVersion;
+	slot->generation = generation;
+	slot->offset = offset;
+	slot->length = length;
+	slot->checksum = ControllerStore_Checksum(store.mapping+offset, length, generation, offset);
+	ControllerStore_Sync(0, kC3StoreHeaderSize);
+	
+	return(kQ3Success);
+}
+
+
+
+//=============================================================================
+//      ControllerStore_TimerFired : Write the changes collected meanwhile.
+//-----------------------------------------------------------------------------
+static void
+ControllerStore_TimerFired(CFRunLoopTimerRef timer, void *info)
+{
+	CFRunLoopTimerInvalidate(store.writeTimer);
+	CFRelease(store.writeTimer);
+	store.writeTimer = NULL;
+	
+	ControllerStore_Flush();
+}
+
+
+
+
+
+//=============================================================================
+//      Public functions
+//-----------------------------------------------------------------------------
+#pragma mark -
+//=============================================================================
+//      ControllerStore_Open : Map path and restore its last snapshot.
+//-----------------------------------------------------------------------------
+//		Note : A missing or damaged file yields an empty store. The file
+//				holds driver capabilities; a symbolic link, or a file that is
+//				not ours or that others may access, is refused.
+//-----------------------------------------------------------------------------
+TQ3Status
+ControllerStore_Open(const char *path)
+{
+	struct stat	fileInfo;
+	int			active;
+	
+	if ((store.mapping!=NULL) || (path==NULL))
+		return(kQ3Failure);
+	
+	store.fileDescriptor = open(path, O_RDWR|O_CREAT|O_NOFOLLOW, S_IRUSR|S_IWUSR);
+	if (store.fileDescriptor<0)
+		return(kQ3Failure);
+	
+	if ((fstat(store.fileDescriptor, &fileInfo)!=0)
+	 || (!S_ISREG(fileInfo.st_mode)) || (ControllerStore_IsPrivate(&fileInfo)==kQ3False)
+	 || (ControllerStore_Map((fileInfo.st_size>kC3StoreHeaderSize) ? (size_t)fileInfo.st_size : kC3StoreHeaderSize)==kQ3Failure))
+	{
+		close(store.fileDescriptor);
+		store.fileDescriptor = -1;
+		return(kQ3Failure);
+	}
+	
+	active = ControllerStore_ActiveSlot();
+	if (active>=0)
+	{
+		TC3StoreSlot		*slot = ControllerStore_Slot(active);
+		CFDataRef			data;
+		CFPropertyListRef	snapshot = NULL;
+		
+		data = CFDataCreateWithBytesNoCopy(kCFAllocatorDefault, store.mapping+slot->offset, slot->length, kCFAllocatorNull);
+		if (data!=NULL)
+		{
+			snapshot = CFPropertyListCreateFromXMLData(kCFAllocatorDefault, data, kCFPropertyListImmutable, NULL);
+			CFRelease(data);
+		}
+		if (snapshot!=NULL)
+		{
+			if (CFGetTypeID(snapshot)==CFDictionaryGetTypeID())
+				ControllerDB_RestoreSnapshot((CFDictionaryRef)snapshot);
+			CFRelease(snapshot);
+		}
+	}
+	
+	store.isDirty = kQ3False;
+	return(kQ3Success);
+}
+
+
+
+//=============================================================================
+//      ControllerStore_DefaultPath : Path of the store in a private directory.
+//-----------------------------------------------------------------------------
+//		Note : The directory, kC3StoreDirectory in the user's home, is made
+//				with mode 0700 if missing; an existing one must be ours and
+//				closed to others, and not a symbolic link.
+//-----------------------------------------------------------------------------
+TQ3Status
+ControllerStore_DefaultPath(char *path, size_t pathSize)
+{
+	struct passwd	*user = getpwuid(geteuid());
+	struct stat		directoryInfo;
+	int				length;
+	
+	if ((user==NULL) || (user->pw_dir==NULL))
+		return(kQ3Failure);
+	
+	length = snprintf(path, pathSize, "%s/%s", user->pw_dir, kC3StoreDirectory);
+	if ((length<0) || ((size_t)length>=pathSize))
+		return(kQ3Failure);
+	
+	if ((mkdir(path, S_IRWXU)!=0) && (errno!=EEXIST))
+		return(kQ3Failure);
+	if ((lstat(path, &directoryInfo)!=0) || (!S_ISDIR(directoryInfo.st_mode))
+	 || (ControllerStore_IsPrivate(&directoryInfo)==kQ3False))
+		return(kQ3Failure);
+	
+	length = snprintf(path, pathSize, "%s/%s/%s", user->pw_dir, kC3StoreDirectory, kC3StoreFileName);
+	if ((length<0) || ((size_t)length>=pathSize))
+		return(kQ3Failure);
+	return(kQ3Success);
+}
+
+
+
+//=============================================================================
+//      ControllerStore_Close : Write pending changes, unmap the file.
+//-----------------------------------------------------------------------------
+TQ3Status
+ControllerStore_Close(void)
+{
+	if (store.mapping==NULL)
+		return(kQ3Failure);
+	
+	if (store.writeTimer!=NULL)
+	{
+		CFRunLoopTimerInvalidate(store.writeTimer);
+		CFRelease(store.writeTimer);
+		store.writeTimer = NULL;
+	}
+	ControllerStore_Flush();
+	
+	munmap(store.mapping, store.mappedSize);
+	close(store.fileDescriptor);
+	
+	store.mapping = NULL;
+	store.mappedSize = 0;
+	store.fileDescriptor = -1;
+	return(kQ3Success);
+}
+
+
+
+//=============================================================================
+//      ControllerStore_NoteChange : Schedule a write of the registry.
+//-----------------------------------------------------------------------------
+//		Note : Changes within kC3StoreWriteDelay are written together.
+//-----------------------------------------------------------------------------
+void
+ControllerStore_NoteChange(void)
+{
+	if (store.mapping==NULL)
+		return;
+	
+	store.isDirty = kQ3True;
+	if (store.writeTimer!=NULL)
+		return;
+	
+	store.writeTimer = CFRunLoopTimerCreate(kCFAllocatorDefault, CFAbsoluteTimeGetCurrent()+kC3StoreWriteDelay,
+											0, 0, 0, ControllerStore_TimerFired, NULL);
+	if (store.writeTimer!=NULL)
+		CFRunLoopAddTimer(CFRunLoopGetCurrent(), store.writeTimer, kCFRunLoopCommonModes);
+	else
+		ControllerStore_Flush();
+}
+
+
+
+//=============================================================================
+//      ControllerStore_Flush : Write pending changes now.
+//-----------------------------------------------------------------------------
+TQ3Status
+ControllerStore_Flush(void)
+{
+	TQ3Status			status = kQ3Failure;
+	CFDictionaryRef		snapshot;
+	CFDataRef			data;
+	
+	if (store.mapping==NULL)
+		return(status);
+	
+	if (store.isDirty==kQ3False)
+		return(kQ3Success);
+	
+	snapshot = ControllerDB_CopySnapshot();
+	if (snapshot!=NULL)
+	{
+		data = CFPropertyListCreateXMLData(kCFAllocatorDefault, snapshot);
+		if (data!=NULL)
+		{
+			status = ControllerStore_Write(data);
+			CFRelease(data);
+		}
+		CFRelease(snapshot);
+	}
+	
+	if (status==kQ3Success)
+		store.isDirty = kQ3False;
+	return(status);
+}
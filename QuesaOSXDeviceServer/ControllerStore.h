@@ -0,0 +1,113 @@
+/*  NAME:
+        ControllerStore.h
+
+    DESCRIPTION:
+        Crash consistent file of the controller registry and saved states.
+      
+    COPYRIGHT:
+        Copyright (c) 1999-2005, Quesa Developers. All rights reserved.
+
+        For the current release of Quesa, please see:
+
+            <http://www.quesa.org/>
+        
+        Redistribution and use in source and binary forms, with or without
+        modification, are permitted provided that the following conditions
+        are met:
+        
+            o Redistributions of source code must retain the above copyright
+              notice, this list of conditions and the following disclaimer.
+        
+            o Redistributions in binary form must reproduce the above
+              copyright notice, this list of conditions and the following
+              disclaimer in the documentation and/or other materials provided
+              with the distribution.
+        
+            o Neither the name of Quesa nor the names of its contributors
+              may be used to endorse or promote products derived from this
+              software without specific prior written permission.
+        
+        THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+        "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+        LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+        A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+        OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+        SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+        TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+        PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+        LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+        NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+        SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+    ___________________________________________________________________________
+*/
+
+
+
+
+#ifndef ControllerStore_HDR
+#define ControllerStore_HDR
+
+//=============================================================================
+//      Include files
+//-----------------------------------------------------------------------------
+#include <Carbon/Carbon.h>
+
+//=============================================================================
+//		C++ preamble
+//-----------------------------------------------------------------------------
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//=============================================================================
+//      Constants
+//-----------------------------------------------------------------------------
+#define kC3StoreMagic					0x51335354		//'Q3ST'
+#define kC3StoreVersion					1
+#define kC3StoreHeaderSize				4096			//both slots; snapshots follow
+#define kC3StoreEnvironment				"QUESA_CONTROLLER_STORE"	//path of the store; overrides the default
+#define kC3StoreFileName				"QuesaOSXDeviceServer.store"
+#define kC3StoreDirectory				"Library/Application Support/QuesaOSXDeviceServer"	//in the user's home, mode 0700
+#define kC3StorePathSize				1024
+#define kC3StoreWriteDelay				0.25			//seconds changes are collected before a write
+
+//=============================================================================
+//      Types
+//-----------------------------------------------------------------------------
+//the header holds two slots; the valid one with the higher generation names the snapshot
+typedef struct TC3StoreSlot
+{
+	UInt32					magic;
+	UInt32					version;
+	UInt32					generation;
+	UInt32					offset;				//of the snapshot in the file
+	UInt32					length;
+	UInt32					checksum;			//of the snapshot and the fields above
+} TC3StoreSlot;
+
+//=============================================================================
+//      Function prototypes
+//-----------------------------------------------------------------------------
+//maps path and hands the last committed snapshot to ControllerDB_RestoreSnapshot; path must be private to the user
+TQ3Status					ControllerStore_Open(const char *path);
+
+//path of the store in the user's private directory, which is created if missing
+TQ3Status					ControllerStore_DefaultPath(char *path, size_t pathSize);
+
+//writes pending changes, unmaps the file
+TQ3Status					ControllerStore_Close(void);
+
+//schedules a write of ControllerDB_CopySnapshot on the current run loop; does nothing while closed
+void						ControllerStore_NoteChange(void);
+
+//writes pending changes now
+TQ3Status					ControllerStore_Flush(void);
+
+//=============================================================================
+//		C++ postamble
+//-----------------------------------------------------------------------------
+#ifdef __cplusplus
+}
+#endif
+
+#endif
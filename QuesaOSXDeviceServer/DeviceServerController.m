@@ -50,6 +50,8 @@
 
 #import "IPCMessageIDs.h"
 #import "IPCController.h"
+#import "ControllerJournal.h"
+#import "ControllerStore.h"
 
 @implementation DeviceServerController
 
@@ -70,6 +72,19 @@
 	theServerPortRef = CFMessagePortCreateLocal(NULL, CFSTR(kQuesa3DeviceServer), IPCControllerDispatcher, &context, NULL);
 	theLoopSource = CFMessagePortCreateRunLoopSource(NULL, theServerPortRef, 0);
 	CFRunLoopAddSource([[NSRunLoop currentRunLoop] getCFRunLoop], theLoopSource, kCFRunLoopDefaultMode);
+	
+	//opt-in recording of the input stream
+	const char *journalPath = getenv(kC3JournalEnvironment);
+	if (journalPath!=NULL)
+		ControllerJournal_Open(journalPath,kC3JournalDefaultMaxRecords);
+	
+	//registry and saved states of the last run; drivers and clients keep their refs
+	char defaultStorePath[kC3StorePathSize];
+	const char *storePath = getenv(kC3StoreEnvironment);
+	if ((storePath==NULL) && (ControllerStore_DefaultPath(defaultStorePath,sizeof(defaultStorePath))==kQ3Success))
+		storePath = defaultStorePath;
+	if (storePath!=NULL)
+		ControllerStore_Open(storePath);
 
 	return self;
 }
@@ -81,6 +96,9 @@
 	CFRelease(theLoopSource);
 	CFRelease(theServerPortRef);
 	
+	ControllerJournal_Close();
+	ControllerStore_Close();
+	
 	[super dealloc];
 }
 
@@ -54,8 +54,47 @@
 
 #include "IPCPackUnpack.h"
 #include "IPCMessageIDs.h"
+#include "IPCAsync.h"
+#include "IPCHandles.h"
 #include "ControllerDB.h"
 
+#define kC3ValuesWaiterTimeout		30.0	//seconds a WaitForValues request stays parked
+#define kC3ValuesWaiterScanInterval	1.0		//seconds between scans for expired or orphaned waiters
+
+/*
+TC3ValuesWaiter:
+-a WaitForValues request parked until the values of its controller change,
+ or until its deadline passes
+*/
+typedef struct TC3ValuesWaiter
+{
+	TQ3ControllerRef		controllerRef;
+	TQ3Uns32				valueCount;
+	TQ3Uns32				requestTag;
+	CFStringRef				replyPortName;
+	CFAbsoluteTime			deadline;
+	struct TC3ValuesWaiter	*nextWaiter;
+} TC3ValuesWaiter;
+
+static TC3ValuesWaiter		*valuesWaiterAnchor = NULL;
+static CFRunLoopTimerRef	valuesWaiterTimer = NULL;	//NULL: no waiter parked
+
+static void	IpcController_CompleteValuesWaiters(TQ3ControllerRef controllerRef, TQ3Status status);
+static void	IpcController_PruneValuesWaiters(void);
+static void	IpcController_ValuesWaiterTimerFired(CFRunLoopTimerRef timer, void *info);
+
+/*
+IpcController_GetControllerRef:
+-controllerRef from dict; refs of the last server run map to their restored controller
+*/
+static Boolean	IpcController_GetControllerRef(CFDictionaryRef dict, const void *key, TQ3ControllerRef *controllerRef)
+{
+	Boolean result = IPCGetControllerRef(dict, key, controllerRef);
+	
+	*controllerRef = ControllerDB_Resolve(*controllerRef);
+	return result;
+};
+
 TQ3Status	IpcController_GetListChanged(CFDictionaryRef dict, CFMutableDictionaryRef returnDict)
 {
 	//Controller Parameter
@@ -95,7 +134,7 @@ TQ3Status	IpcController_Next(CFDictionaryRef dict, CFMutableDictionaryRef return
 	
 	//Get Parameters from dict
 	//controllerRef
-	IPCGetControllerRef(dict, CFSTR(k3CtrlRef), &controllerRef);
+	IpcController_GetControllerRef(dict, CFSTR(k3CtrlRef), &controllerRef);
 	
 	//-Do call
 	status = ControllerDB_Next(controllerRef, &nextControllerRef);
@@ -113,6 +152,7 @@ TQ3Status	IpcController_New(CFDictionaryRef dict, CFMutableDictionaryRef returnD
 	//Controller Parameter
 	TQ3ControllerRef 	controllerRef;
 	TQ3ControllerData	controllerData;
+	TQ3Uns32			driverHandle,driverToken;
 	
 	int 				numChars = 256;
 	Boolean 			result;
@@ -140,6 +180,16 @@ TQ3Status	IpcController_New(CFDictionaryRef dict, CFMutableDictionaryRef returnD
 	//...and set driver port name
 	ControllerDB_SetDriverPortName(controllerRef, DriverPortNameRef);
 	
+	//...and the capability for direct channel calls; none from older drivers
+	driverToken = 0;
+	driverHandle = kIPCHandleNone;
+	if (CFDictionaryGetValue(dict, CFSTR(k3CapToken))!=NULL)
+	{
+		IPCGetTQ3Uns32(dict, CFSTR(k3DriverHandle), &driverHandle);
+		IPCGetTQ3Uns32(dict, CFSTR(k3CapToken), &driverToken);
+	}
+	ControllerDB_SetDriverToken(controllerRef, driverHandle, driverToken);
+	
 	//Put Results into returnDict
 	//controllerRef
 	IPCPutControllerRef(returnDict, CFSTR(k3CtrlRef), &controllerRef);
@@ -156,11 +206,14 @@ TQ3Status	IpcController_Decommission(CFDictionaryRef dict, CFMutableDictionaryRe
 
 	//Get Parameters from dict
 	//controllerRef
-	IPCGetControllerRef(dict, CFSTR(k3CtrlRef), &controllerRef);
+	IpcController_GetControllerRef(dict, CFSTR(k3CtrlRef), &controllerRef);
 	
 	//-Do call
 	status = ControllerDB_Decommission(controllerRef);
 	
+	//nobody will set values any more
+	IpcController_CompleteValuesWaiters(controllerRef,kQ3Failure);
+	
 	//No Results for returnDict
 	return(status);
 };//done
@@ -175,7 +228,7 @@ TQ3Status	IpcController_SetActivation(CFDictionaryRef dict, CFMutableDictionaryR
 	
 	//Get Parameters from dict
 	//controllerRef
-	IPCGetControllerRef(dict, CFSTR(k3CtrlRef), &controllerRef);
+	IpcController_GetControllerRef(dict, CFSTR(k3CtrlRef), &controllerRef);
 							
 	//active
 	IPCGetTQ3Boolean(dict, CFSTR(k3Active), &active);
@@ -197,7 +250,7 @@ TQ3Status	IpcController_GetActivation(CFDictionaryRef dict, CFMutableDictionaryR
 	
 	//Get Parameters from dict
 	//controllerRef
-	IPCGetControllerRef(dict, CFSTR(k3CtrlRef), &controllerRef);
+	IpcController_GetControllerRef(dict, CFSTR(k3CtrlRef), &controllerRef);
 							
 	//-Do call
 	status = ControllerDB_GetActivation(controllerRef, &active);
@@ -219,7 +272,7 @@ TQ3Status	IpcController_GetSignature(CFDictionaryRef dict, CFMutableDictionaryRe
 	
 	//Get Parameters from dict
 	//controllerRef
-	IPCGetControllerRef(dict,CFSTR(k3CtrlRef), &controllerRef);
+	IpcController_GetControllerRef(dict,CFSTR(k3CtrlRef), &controllerRef);
 							
 	//-Do call
 	status = ControllerDB_GetCFSignature(controllerRef, &signature);
@@ -241,7 +294,7 @@ TQ3Status	IpcController_SetChannel(CFDictionaryRef dict, CFMutableDictionaryRef
 	
 	//Get Parameters from dict
 	//controllerRef
-	IPCGetControllerRef(dict, CFSTR(k3CtrlRef), &controllerRef);
+	IpcController_GetControllerRef(dict, CFSTR(k3CtrlRef), &controllerRef);
 	
 	workDict = CFDictionaryCreateMutableCopy (kCFAllocatorDefault, 0, dict);
 	
@@ -262,7 +315,7 @@ TQ3Status	IpcController_GetChannel(CFDictionaryRef dict, CFMutableDictionaryRef
 	
 	//Get Parameters from dict
 	//controllerRef
-	IPCGetControllerRef(dict,CFSTR(k3CtrlRef),&controllerRef);
+	IpcController_GetControllerRef(dict,CFSTR(k3CtrlRef),&controllerRef);
 							
 	workDict = CFDictionaryCreateMutableCopy (kCFAllocatorDefault,0,dict);
 	
@@ -274,6 +327,93 @@ TQ3Status	IpcController_GetChannel(CFDictionaryRef dict, CFMutableDictionaryRef
 	return(status);
 };//done; needs documentation
 
+TQ3Status	IpcController_SetChannels(CFDictionaryRef dict, CFMutableDictionaryRef returnDict)
+{
+	//Controller Parameter
+	TQ3Status 				status = kQ3Failure;	//resulting status after calling controller database
+	TQ3ControllerRef 		controllerRef;
+	CFMutableDictionaryRef	workDict;
+	
+	//Get Parameters from dict
+	//controllerRef
+	IpcController_GetControllerRef(dict, CFSTR(k3CtrlRef), &controllerRef);
+	
+	workDict = CFDictionaryCreateMutableCopy (kCFAllocatorDefault, 0, dict);
+	if (workDict==NULL)
+		return(status);
+	
+	//-Do call
+	status = ControllerDB_SetChannels(controllerRef, workDict, returnDict);
+	CFRelease(workDict);
+
+	//Put Results into returnDict
+					
+	return(status);
+};//done
+
+TQ3Status	IpcController_GetChannels(CFDictionaryRef dict, CFMutableDictionaryRef returnDict)
+{
+	//Controller Parameter
+	TQ3Status 				status = kQ3Failure;	//resulting status after calling controller database
+	TQ3ControllerRef 		controllerRef;
+	CFMutableDictionaryRef	workDict;
+	
+	//Get Parameters from dict
+	//controllerRef
+	IpcController_GetControllerRef(dict, CFSTR(k3CtrlRef), &controllerRef);
+	
+	workDict = CFDictionaryCreateMutableCopy (kCFAllocatorDefault, 0, dict);
+	if (workDict==NULL)
+		return(status);
+	
+	//-Do call
+	status = ControllerDB_GetChannels(controllerRef, workDict, returnDict);
+	CFRelease(workDict);
+
+	//Put Results into returnDict
+					
+	return(status);
+};//done
+
+TQ3Status	IpcController_GetDriverEndpoint(CFDictionaryRef dict, CFMutableDictionaryRef returnDict)
+{
+	//Controller Parameter
+	TQ3Status 				status;	//resulting status after calling controller database
+	TQ3ControllerRef 		controllerRef;
+	CFStringRef				portName;
+	TQ3Uns32				driverHandle,token;
+	
+	//Get Parameters from dict
+	//controllerRef
+	IpcController_GetControllerRef(dict, CFSTR(k3CtrlRef), &controllerRef);
+	
+	//-Do call
+	status = ControllerDB_GetDriverEndpoint(controllerRef, &portName, &driverHandle, &token);
+
+	//Put Results into returnDict
+	if (status==kQ3Success)
+	{
+		CFDictionarySetValue(returnDict, CFSTR(k3DriverPortName), portName);
+		IPCPutTQ3Uns32(returnDict, CFSTR(k3DriverHandle), &driverHandle);
+		IPCPutTQ3Uns32(returnDict, CFSTR(k3CapToken), &token);
+	}
+					
+	return(status);
+};//done
+
+TQ3Status	IpcController_ChannelChanged(CFDictionaryRef dict, CFMutableDictionaryRef returnDict)
+{
+	//Controller Parameter
+	TQ3ControllerRef 		controllerRef;
+	
+	//Get Parameters from dict
+	//controllerRef
+	IpcController_GetControllerRef(dict, CFSTR(k3CtrlRef), &controllerRef);
+	
+	//-Do call
+	return(ControllerDB_ChannelChanged(controllerRef, dict));
+};//done; sent without waiting for a reply
+
 TQ3Status	IpcController_GetValueCount(CFDictionaryRef dict, CFMutableDictionaryRef returnDict)
 {
 	//Controller Parameter
@@ -283,7 +423,7 @@ TQ3Status	IpcController_GetValueCount(CFDictionaryRef dict, CFMutableDictionaryR
 	
 	//Get Parameters from dict
 	//controllerRef
-	IPCGetControllerRef(dict,CFSTR(k3CtrlRef),&controllerRef);
+	IpcController_GetControllerRef(dict,CFSTR(k3CtrlRef),&controllerRef);
 							
 	//-Do call
 	status = ControllerDB_GetValueCount(controllerRef,&valueCount);
@@ -302,23 +442,23 @@ TQ3Status	IpcController_SetTracker(CFDictionaryRef dict, CFMutableDictionaryRef
 	TQ3Status 			status;	//resulting status after calling controller database
 	TQ3ControllerRef 	controllerRef;
 	CFStringRef			trackerPortName;	
-	CFStringRef			trackerUUID;
+	TQ3Uns32			trackerHandle = kIPCHandleNone;
 	
 	//Get Parameters from dict
 	//controllerRef
-	IPCGetControllerRef(dict,CFSTR(k3CtrlRef),&controllerRef);
+	IpcController_GetControllerRef(dict,CFSTR(k3CtrlRef),&controllerRef);
 					
-	//trackerPortName
+	//trackerPortName - may be NULL, if the client never created a tracker
 	trackerPortName = (CFStringRef)CFDictionaryGetValue(dict,CFSTR(k3TrackerPortName));
-	CFRetain(trackerPortName);	//trackerPortName is needed after releasing dict
+	if (trackerPortName!=NULL)
+		CFRetain(trackerPortName);	//trackerPortName is needed after releasing dict
 	
-	//trackerUUID - may be NULL, if key wasn't found in the dictionary				
-	trackerUUID = (CFStringRef)CFDictionaryGetValue(dict,CFSTR(k3TrackerUUID));
-	if (trackerUUID!=NULL)
-		CFRetain(trackerUUID);		//trackerUUID is needed after releasing dict
+	//trackerHandle - stays kIPCHandleNone, if key wasn't found in the dictionary				
+	if (CFDictionaryGetValue(dict,CFSTR(k3TrackerHandle))!=NULL)
+		IPCGetTQ3Uns32(dict,CFSTR(k3TrackerHandle),&trackerHandle);
 							
 	//-Do call
-	status = ControllerDB_SetTracker(controllerRef,trackerUUID,trackerPortName);
+	status = ControllerDB_SetTracker(controllerRef,trackerHandle,trackerPortName);
 	
 	//No Results for returnDict
 	return(status);
@@ -334,7 +474,7 @@ TQ3Status	IpcController_HasTracker(CFDictionaryRef dict, CFMutableDictionaryRef
 	
 	//Get Parameters from dict
 	//controllerRef
-	IPCGetControllerRef(dict,CFSTR(k3CtrlRef),&controllerRef);
+	IpcController_GetControllerRef(dict,CFSTR(k3CtrlRef),&controllerRef);
 							
 	//-Do call
 	status = ControllerDB_HasTracker(controllerRef,&hasTracker);
@@ -347,6 +487,65 @@ TQ3Status	IpcController_HasTracker(CFDictionaryRef dict, CFMutableDictionaryRef
 };//done
 
 
+TQ3Status	IpcController_GetConsumerState(CFDictionaryRef dict, CFMutableDictionaryRef returnDict)
+{
+	//Controller Parameter
+	TQ3Status 			status;	//resulting status after calling controller database
+	TQ3ControllerRef 	controllerRef;
+	TQ3Boolean 			hasSubscribers;
+	float				consumerRate;
+	TC3ValuesWaiter 	*theWaiter;
+	
+	//Get Parameters from dict
+	//controllerRef
+	IpcController_GetControllerRef(dict,CFSTR(k3CtrlRef),&controllerRef);
+							
+	//-Do call
+	status = ControllerDB_GetConsumerState(controllerRef,&hasSubscribers,&consumerRate);
+	
+	//a parked WaitForValues wants every change, just like a tracker;
+	//a waiter whose client has gone away doesn't count
+	IpcController_PruneValuesWaiters();
+	for (theWaiter=valuesWaiterAnchor; theWaiter!=NULL; theWaiter=theWaiter->nextWaiter)
+		if (theWaiter->controllerRef==controllerRef)
+			hasSubscribers = kQ3True;
+	
+	//Put Results into returnDict
+	if (status==kQ3Success)
+	{
+		//hasSubscribers
+		IPCPutTQ3Boolean(returnDict, CFSTR(k3hasSubscribers), &hasSubscribers);
+		
+		//consumerRate
+		IPCPutBytes(returnDict, CFSTR(k3ConsumerRate), sizeof(float), &consumerRate);
+	}
+				
+	return(status);
+};//done
+
+
+TQ3Status	IpcController_SetFilter(CFDictionaryRef dict, CFMutableDictionaryRef returnDict)
+{
+	//Controller Parameter
+	TQ3Status 			status;	//resulting status after calling controller database
+	TQ3ControllerRef 	controllerRef;
+	CFArrayRef			stages;
+	
+	//Get Parameters from dict
+	//controllerRef
+	IpcController_GetControllerRef(dict,CFSTR(k3CtrlRef),&controllerRef);
+	
+	//stages - NULL removes the filter
+	stages = (CFArrayRef)CFDictionaryGetValue(dict,CFSTR(k3FilterStages));
+							
+	//-Do call
+	status = ControllerDB_SetFilter(controllerRef,stages);
+	
+	//No Results for returnDict
+	return(status);
+};//done
+
+
 TQ3Status	IpcController_Track2DCursor(CFDictionaryRef dict, CFMutableDictionaryRef returnDict)
 {
 	//Controller Parameter
@@ -356,7 +555,7 @@ TQ3Status	IpcController_Track2DCursor(CFDictionaryRef dict, CFMutableDictionaryR
 	
 	//Get Parameters from dict
 	//controllerRef
-	IPCGetControllerRef(dict,CFSTR(k3CtrlRef),&controllerRef);
+	IpcController_GetControllerRef(dict,CFSTR(k3CtrlRef),&controllerRef);
 							
 	//-Do call
 	status = ControllerDB_Track2DCursor(controllerRef,&track2DCursor);
@@ -378,7 +577,7 @@ TQ3Status	IpcController_Track3DCursor(CFDictionaryRef dict, CFMutableDictionaryR
 	
 	//Get Parameters from dict
 	//controllerRef
-	IPCGetControllerRef(dict,CFSTR(k3CtrlRef),&controllerRef);
+	IpcController_GetControllerRef(dict,CFSTR(k3CtrlRef),&controllerRef);
 							
 	//-Do call
 	status = ControllerDB_Track3DCursor(controllerRef,&track3DCursor);
@@ -400,9 +599,10 @@ TQ3Status	IpcController_GetButtons(CFDictionaryRef dict, CFMutableDictionaryRef
 	
 	//Get Parameters from dict
 	//controllerRef
-	IPCGetControllerRef(dict,CFSTR(k3CtrlRef),&controllerRef);
+	IpcController_GetControllerRef(dict,CFSTR(k3CtrlRef),&controllerRef);
 							
 	//-Do call
+	ControllerDB_NoteConsumerRead(controllerRef);
 	status = ControllerDB_GetButtons(controllerRef,&buttons);
 	
 	//Put Results into returnDict
@@ -422,7 +622,7 @@ TQ3Status	IpcController_SetButtons(CFDictionaryRef dict, CFMutableDictionaryRef
 	
 	//Get Parameters from dict
 	//controllerRef
-	IPCGetControllerRef(dict,CFSTR(k3CtrlRef),&controllerRef);
+	IpcController_GetControllerRef(dict,CFSTR(k3CtrlRef),&controllerRef);
 							
 	//buttons
 	IPCGetTQ3Uns32(dict, CFSTR(k3Buttons), &buttons);
@@ -443,9 +643,10 @@ TQ3Status	IpcController_GetTrackerPosition(CFDictionaryRef dict, CFMutableDictio
 	
 	//Get Parameters from dict
 	//controllerRef
-	IPCGetControllerRef(dict,CFSTR(k3CtrlRef), &controllerRef);
+	IpcController_GetControllerRef(dict,CFSTR(k3CtrlRef), &controllerRef);
 							
 	//-Do call
+	ControllerDB_NoteConsumerRead(controllerRef);
 	status = ControllerDB_GetTrackerPosition(controllerRef, &position);
 	
 	//Put Results into returnDict
@@ -467,7 +668,7 @@ TQ3Status	IpcController_SetTrackerPosition(CFDictionaryRef dict, CFMutableDictio
 	
 	//Get Parameters from dict
 	//controllerRef
-	IPCGetControllerRef(dict,CFSTR(k3CtrlRef),&controllerRef);
+	IpcController_GetControllerRef(dict,CFSTR(k3CtrlRef),&controllerRef);
 	
 	//position
 	result = IPCGetTQ3Point3D(dict, CFSTR(k3Position), &position);
@@ -491,7 +692,7 @@ TQ3Status	IpcController_MoveTrackerPosition(CFDictionaryRef dict, CFMutableDicti
 	
 	//Get Parameters from dict
 	//controllerRef
-	IPCGetControllerRef(dict,CFSTR(k3CtrlRef),&controllerRef);
+	IpcController_GetControllerRef(dict,CFSTR(k3CtrlRef),&controllerRef);
 	
 	//delta
 	result = IPCGetTQ3Vector3D(dict, CFSTR(k3DeltaPos), &delta);
@@ -513,9 +714,10 @@ TQ3Status	IpcController_GetTrackerOrientation(CFDictionaryRef dict, CFMutableDic
 	
 	//Get Parameters from dict
 	//controllerRef
-	IPCGetControllerRef(dict,CFSTR(k3CtrlRef),&controllerRef);
+	IpcController_GetControllerRef(dict,CFSTR(k3CtrlRef),&controllerRef);
 							
 	//-Do call
+	ControllerDB_NoteConsumerRead(controllerRef);
 	status = ControllerDB_GetTrackerOrientation(controllerRef,&orientation);
 	
 	//Put Results into returnDict
@@ -537,7 +739,7 @@ TQ3Status	IpcController_SetTrackerOrientation(CFDictionaryRef dict, CFMutableDic
 	
 	//Get Parameters from dict
 	//controllerRef
-	IPCGetControllerRef(dict, CFSTR(k3CtrlRef), &controllerRef);
+	IpcController_GetControllerRef(dict, CFSTR(k3CtrlRef), &controllerRef);
 	
 	//orientation
 	result = IPCGetTQ3Quaternion(dict, CFSTR(k3Orient), &orientation);
@@ -561,7 +763,7 @@ TQ3Status	IpcController_MoveTrackerOrientation(CFDictionaryRef dict, CFMutableDi
 	
 	//Get Parameters from dict
 	//controllerRef 
-	IPCGetControllerRef(dict, CFSTR(k3CtrlRef), &controllerRef);
+	IpcController_GetControllerRef(dict, CFSTR(k3CtrlRef), &controllerRef);
 	
 	//delta
 	result = IPCGetTQ3Quaternion(dict, CFSTR(k3DeltaOrient), &delta);
@@ -574,29 +776,18 @@ TQ3Status	IpcController_MoveTrackerOrientation(CFDictionaryRef dict, CFMutableDi
 };//done
 
 
-TQ3Status	IpcController_GetValues(CFDictionaryRef dict, CFMutableDictionaryRef returnDict)
+/*
+IpcController_PutValues:
+-marshals a raw value read into returnDict; shared by GetValues and WaitForValues
+*/
+static void	IpcController_PutValues(TQ3ControllerRef controllerRef, TQ3Uns32 valueCount, const float *values, TQ3Uns32 serialNumber, CFMutableDictionaryRef returnDict)
 {
-	//Controller Parameter
-	TQ3Status 			status;	//resulting status after calling controller database
-	TQ3ControllerRef 	controllerRef;
-	TQ3Uns32 			valueCount;
-	float				values[kQ3MaxControllerValues];
-	TQ3Boolean 			privActive;
-	TQ3Uns32 			serialNumber;
-	
-	//Get Parameters from dict
-	//controllerRef
-	IPCGetControllerRef(dict, CFSTR(k3CtrlRef), &controllerRef);
+	TQ3Boolean 			privActive = kQ3False;
 	
-	//valueCount
-	IPCGetTQ3Uns32(dict, CFSTR(k3ValueCount), &valueCount);
-								
-	//-Do calls
-	//--public
-	//--ControllerDB_GetValuesRaw: valueCount: r/w; values: w; serialNumber: w
-	status = ControllerDB_GetValuesRaw(controllerRef,&valueCount,values,&serialNumber);
 	//--private; helper
-	status = ControllerDB_GetActivation(controllerRef,&privActive);
+	ControllerDB_GetActivation(controllerRef,&privActive);
+	if (privActive==kQ3False)
+		valueCount = 0;
 	
 	//Put Results into returnDict
 	//active
@@ -623,11 +814,236 @@ TQ3Status	IpcController_GetValues(CFDictionaryRef dict, CFMutableDictionaryRef r
 		CFDictionarySetValue(returnDict,CFSTR(k3Values),valuesRef);
 		CFRelease(valuesRef);
 	}
+};
+
+
+TQ3Status	IpcController_GetValues(CFDictionaryRef dict, CFMutableDictionaryRef returnDict)
+{
+	//Controller Parameter
+	TQ3Status 			status;	//resulting status after calling controller database
+	TQ3ControllerRef 	controllerRef;
+	TQ3Uns32 			valueCount;
+	float				values[kQ3MaxControllerValues];
+	TQ3Uns32 			serialNumber;
+	
+	//Get Parameters from dict
+	//controllerRef
+	IpcController_GetControllerRef(dict, CFSTR(k3CtrlRef), &controllerRef);
+	
+	//valueCount
+	IPCGetTQ3Uns32(dict, CFSTR(k3ValueCount), &valueCount);
+	if (valueCount>kQ3MaxControllerValues)
+		valueCount = kQ3MaxControllerValues;
+								
+	//-Do calls
+	//--public
+	//--ControllerDB_GetValuesRaw: valueCount: r/w; values: w; serialNumber: w
+	ControllerDB_NoteConsumerRead(controllerRef);
+	status = ControllerDB_GetValuesRaw(controllerRef,&valueCount,values,&serialNumber);
+	if (status==kQ3Success)
+		IpcController_PutValues(controllerRef,valueCount,values,serialNumber,returnDict);
 				
 	return(status);
 };//done
 
 
+/*
+IpcController_WaitForValues:
+-like GetValues, but an asynchronous request whose serialNumber is still current
+ is parked until the next SetValues (or Decommission) of that controller
+-a parked request costs one TC3ValuesWaiter, no thread and no port
+-after kC3ValuesWaiterTimeout it completes with the unchanged values; a waiter
+ whose reply port went invalid is dropped without a reply
+*/
+TQ3Status	IpcController_WaitForValues(CFDictionaryRef dict, CFMutableDictionaryRef returnDict, TQ3Boolean *deferred)
+{
+	//Controller Parameter
+	TQ3Status 			status;	//resulting status after calling controller database
+	TQ3ControllerRef 	controllerRef;
+	TQ3Uns32 			valueCount;
+	float				values[kQ3MaxControllerValues];
+	TQ3Uns32 			serialNumber,knownSerialNumber;
+	
+	*deferred = kQ3False;
+	
+	//Get Parameters from dict
+	//controllerRef
+	IpcController_GetControllerRef(dict, CFSTR(k3CtrlRef), &controllerRef);
+	
+	//valueCount
+	IPCGetTQ3Uns32(dict, CFSTR(k3ValueCount), &valueCount);
+	if (valueCount>kQ3MaxControllerValues)
+		valueCount = kQ3MaxControllerValues;
+	
+	//serialNumber the client has already seen
+	IPCGetTQ3Uns32(dict, CFSTR(k3SerNum), &knownSerialNumber);
+	
+	//-Do calls
+	ControllerDB_NoteConsumerRead(controllerRef);
+	status = ControllerDB_GetValuesRaw(controllerRef,&valueCount,values,&serialNumber);
+	if (status==kQ3Success)
+	{
+		if ((serialNumber==knownSerialNumber) && (IPCAsync_IsAsyncRequest(dict)))
+		{
+			TC3ValuesWaiter *theWaiter;
+			
+			IpcController_PruneValuesWaiters();
+			if (valuesWaiterTimer==NULL)
+			{
+				valuesWaiterTimer = CFRunLoopTimerCreate(	kCFAllocatorDefault,
+															CFAbsoluteTimeGetCurrent()+kC3ValuesWaiterScanInterval,
+															kC3ValuesWaiterScanInterval, 0, 0,
+															IpcController_ValuesWaiterTimerFired, NULL);
+				if (valuesWaiterTimer!=NULL)
+					CFRunLoopAddTimer(CFRunLoopGetCurrent(), valuesWaiterTimer, kCFRunLoopCommonModes);
+			}
+			
+			//without the timer nothing would ever expire it: answer right away
+			theWaiter = (valuesWaiterTimer!=NULL) ? (TC3ValuesWaiter*)malloc(sizeof(TC3ValuesWaiter)) : NULL;
+			if (theWaiter!=NULL)
+			{
+				theWaiter->controllerRef = controllerRef;
+				IPCGetTQ3Uns32(dict, CFSTR(k3ValueCount), &theWaiter->valueCount);
+				IPCGetTQ3Uns32(dict, CFSTR(k3RequestTag), &theWaiter->requestTag);
+				theWaiter->replyPortName = (CFStringRef)CFRetain(CFDictionaryGetValue(dict, CFSTR(k3ReplyPortName)));
+				theWaiter->deadline = CFAbsoluteTimeGetCurrent()+kC3ValuesWaiterTimeout;
+				theWaiter->nextWaiter = valuesWaiterAnchor;
+				valuesWaiterAnchor = theWaiter;
+				*deferred = kQ3True;
+				return(kQ3Success);
+			}
+		}
+		IpcController_PutValues(controllerRef,valueCount,values,serialNumber,returnDict);
+	}
+	
+	return(status);
+};//done
+
+
+/*
+IpcController_ReplyValuesWaiter:
+-answers one unlinked waiter and frees it
+-values and serialNumber are ignored unless status is kQ3Success
+*/
+static void	IpcController_ReplyValuesWaiter(TC3ValuesWaiter *theWaiter, TQ3Status status, TQ3Uns32 valueCount, const float *values, TQ3Uns32 serialNumber)
+{
+	CFMutableDictionaryRef returnDict = CFDictionaryCreateMutable(	kCFAllocatorDefault,0,
+																	&kCFTypeDictionaryKeyCallBacks,
+																	&kCFTypeDictionaryValueCallBacks);
+	if (returnDict)
+	{
+		if (status==kQ3Success)
+			IpcController_PutValues(theWaiter->controllerRef,
+									(theWaiter->valueCount < valueCount) ? theWaiter->valueCount : valueCount,
+									values,serialNumber,returnDict);
+		IPCPutTQ3Uns32(returnDict, CFSTR(k3Status), (TQ3Uns32*)&status);
+		IPCAsync_SendReplyTo(theWaiter->replyPortName, theWaiter->requestTag, m3Controller_WaitForValues, returnDict);
+		CFRelease(returnDict);
+	}
+	
+	CFRelease(theWaiter->replyPortName);
+	free(theWaiter);
+};
+
+
+/*
+IpcController_PruneValuesWaiters:
+-drops waiters whose client's reply port is gone, without a reply
+-answers waiters past their deadline with the current (unchanged) values
+-retires the scan timer once no waiter is left
+*/
+static void	IpcController_PruneValuesWaiters(void)
+{
+	TC3ValuesWaiter 	**link = &valuesWaiterAnchor;
+	CFAbsoluteTime		now = CFAbsoluteTimeGetCurrent();
+	TQ3Uns32 			valueCount;
+	float				values[kQ3MaxControllerValues];
+	TQ3Uns32 			serialNumber;
+	TQ3Status			status;
+	
+	while (*link!=NULL)
+	{
+		TC3ValuesWaiter *theWaiter = *link;
+		
+		if (!IPCAsync_ReplyPortIsValid(theWaiter->replyPortName))
+		{
+			*link = theWaiter->nextWaiter;
+			CFRelease(theWaiter->replyPortName);
+			free(theWaiter);
+			continue;
+		}
+		
+		if (now<theWaiter->deadline)
+		{
+			link = &theWaiter->nextWaiter;
+			continue;
+		}
+		
+		//unlink first: replying may re-enter the dispatcher
+		*link = theWaiter->nextWaiter;
+		
+		valueCount = kQ3MaxControllerValues;
+		serialNumber = 0;
+		status = ControllerDB_GetValuesRaw(theWaiter->controllerRef,&valueCount,values,&serialNumber);
+		IpcController_ReplyValuesWaiter(theWaiter,status,valueCount,values,serialNumber);
+		
+		//the list may have changed meanwhile
+		link = &valuesWaiterAnchor;
+	}
+	
+	if ((valuesWaiterAnchor==NULL) && (valuesWaiterTimer!=NULL))
+	{
+		CFRunLoopTimerInvalidate(valuesWaiterTimer);
+		CFRelease(valuesWaiterTimer);
+		valuesWaiterTimer = NULL;
+	}
+};
+
+
+/*
+IpcController_ValuesWaiterTimerFired:
+-expires waiters even when no further request comes in
+*/
+static void	IpcController_ValuesWaiterTimerFired(CFRunLoopTimerRef timer, void *info)
+{
+	IpcController_PruneValuesWaiters();
+};
+
+
+/*
+IpcController_CompleteValuesWaiters:
+-answers every parked WaitForValues request of controllerRef
+-called after the values changed, or with kQ3Failure when the controller goes away
+*/
+static void	IpcController_CompleteValuesWaiters(TQ3ControllerRef controllerRef, TQ3Status status)
+{
+	TC3ValuesWaiter 	**link = &valuesWaiterAnchor;
+	TQ3Uns32 			valueCount = kQ3MaxControllerValues;
+	float				values[kQ3MaxControllerValues];
+	TQ3Uns32 			serialNumber = 0;
+	
+	//one raw read serves all waiters of this controller
+	if (status==kQ3Success)
+		status = ControllerDB_GetValuesRaw(controllerRef,&valueCount,values,&serialNumber);
+	
+	while (*link!=NULL)
+	{
+		TC3ValuesWaiter *theWaiter = *link;
+		
+		if (theWaiter->controllerRef!=controllerRef)
+		{
+			link = &theWaiter->nextWaiter;
+			continue;
+		}
+		
+		//unlink first: replying may re-enter the dispatcher
+		*link = theWaiter->nextWaiter;
+		
+		IpcController_ReplyValuesWaiter(theWaiter,status,valueCount,values,serialNumber);
+	}
+};
+
+
 TQ3Status	IpcController_SetValues(CFDictionaryRef dict, CFMutableDictionaryRef returnDict)
 {
 	//Controller Parameter
@@ -641,7 +1057,7 @@ TQ3Status	IpcController_SetValues(CFDictionaryRef dict, CFMutableDictionaryRef r
 	
 	//Get Parameters from dict
 	//controllerRef
-	IPCGetControllerRef(dict, CFSTR(k3CtrlRef), &controllerRef);
+	IpcController_GetControllerRef(dict, CFSTR(k3CtrlRef), &controllerRef);
 	
 	//valueCount
 	IPCGetTQ3Uns32(dict, CFSTR(k3ValueCount), &valueCount);
@@ -656,8 +1072,17 @@ TQ3Status	IpcController_SetValues(CFDictionaryRef dict, CFMutableDictionaryRef r
 			result = CFNumberGetValue(	(CFNumberRef)CFArrayGetValueAtIndex(valAr,index),
 										kCFNumberFloatType,
 										&values[index]);
+		TQ3Uns32	noValues = 0;
+		TQ3Uns32	oldSerialNumber = 0,newSerialNumber = 0;
+		
 		//Do call
+		ControllerDB_GetValuesRaw(controllerRef,&noValues,NULL,&oldSerialNumber);
 		status = ControllerDB_SetValues(controllerRef,values,valueCount);
+		
+		//the serialNumber stays, if a filter of the controller held the values back
+		ControllerDB_GetValuesRaw(controllerRef,&noValues,NULL,&newSerialNumber);
+		if ((status==kQ3Success) && (newSerialNumber!=oldSerialNumber))
+			IpcController_CompleteValuesWaiters(controllerRef,kQ3Success);
 	}
 	
 	free(values);
@@ -672,23 +1097,23 @@ TQ3Status	IpcControllerState_New(CFDictionaryRef dict, CFMutableDictionaryRef re
 	//Controller Parameter
 	TQ3Status 			status = kQ3Failure;	//resulting status after calling controller database
 	TQ3ControllerRef 	controllerRef;
-	CFStringRef			ctrlStateUUIDString;
+	TQ3Uns32			ctrlStateHandle = kIPCHandleNone;
 	
 	Boolean 			result;
 	
 	//Get Parameters from dict
 	//controllerRef
-	result =  IPCGetControllerRef(dict, CFSTR(k3CtrlRef), &controllerRef);
+	result =  IpcController_GetControllerRef(dict, CFSTR(k3CtrlRef), &controllerRef);
 	
 	//-Do call
 	if (result==true)
 	{
-		ControllerDB_StateNew(controllerRef, &ctrlStateUUIDString);
+		ControllerDB_StateNew(controllerRef, &ctrlStateHandle);
 	}
 	
 	//Put Results into dictionary
-	//-ctrlStateUUIDString 
-	CFDictionarySetValue(returnDict, CFSTR(k3CtrlStateUUID), ctrlStateUUIDString);
+	//-ctrlStateHandle; kIPCHandleNone on failure 
+	result = IPCPutTQ3Uns32(returnDict, CFSTR(k3CtrlStateHandle), &ctrlStateHandle);
 	
 	return(kQ3Success);
 };//done
@@ -698,21 +1123,22 @@ TQ3Status	IpcControllerState_Delete(CFDictionaryRef dict, CFMutableDictionaryRef
 	//Controller Parameter
 	TQ3Status 			status = kQ3Failure;	//resulting status after calling controller database
 	TQ3ControllerRef 	controllerRef;
-	CFStringRef			ctrlStateUUIDString;
+	TQ3Uns32			ctrlStateHandle = kIPCHandleNone;
 	
 	Boolean 			result;
 	
 	//Get Parameters from dict
 	//-controllerRef
-	result = IPCGetControllerRef(dict, CFSTR(k3CtrlRef), &controllerRef);
+	result = IpcController_GetControllerRef(dict, CFSTR(k3CtrlRef), &controllerRef);
 	
-	//-ctrlStateUUID - may be NULL, if key wasn't found in the dictionary				
-	ctrlStateUUIDString = (CFStringRef)CFDictionaryGetValue(dict, CFSTR(k3CtrlStateUUID));//bug?
+	//-ctrlStateHandle - stays kIPCHandleNone, if key wasn't found in the dictionary				
+	if (CFDictionaryGetValue(dict, CFSTR(k3CtrlStateHandle))!=NULL)
+		IPCGetTQ3Uns32(dict, CFSTR(k3CtrlStateHandle), &ctrlStateHandle);
 	
 	//-Do call
 	if (result==true)
 	{
-		ControllerDB_StateDelete(controllerRef, ctrlStateUUIDString);
+		ControllerDB_StateDelete(controllerRef, ctrlStateHandle);
 	}
 	
 	return(kQ3Success);
@@ -723,21 +1149,22 @@ TQ3Status	IpcControllerState_SaveAndReset(CFDictionaryRef dict, CFMutableDiction
 	//Controller Parameter
 	TQ3Status 			status = kQ3Failure;	//resulting status after calling controller database
 	TQ3ControllerRef 	controllerRef;
-	CFStringRef			ctrlStateUUIDString;
+	TQ3Uns32			ctrlStateHandle = kIPCHandleNone;
 	
 	Boolean 			result;
 	
 	//Get Parameters from dict
 	//-controllerRef
-	result = IPCGetControllerRef(dict, CFSTR(k3CtrlRef), &controllerRef);
+	result = IpcController_GetControllerRef(dict, CFSTR(k3CtrlRef), &controllerRef);
 	
-	//-ctrlStateUUID - may be NULL, if key wasn't found in the dictionary				
-	ctrlStateUUIDString = (CFStringRef)CFDictionaryGetValue(dict, CFSTR(k3CtrlStateUUID));//bug?
+	//-ctrlStateHandle - stays kIPCHandleNone, if key wasn't found in the dictionary				
+	if (CFDictionaryGetValue(dict, CFSTR(k3CtrlStateHandle))!=NULL)
+		IPCGetTQ3Uns32(dict, CFSTR(k3CtrlStateHandle), &ctrlStateHandle);
 	
 	//-Do call
 	if (result==true)
 	{
-		status = ControllerDB_StateSaveAndReset(controllerRef, ctrlStateUUIDString);
+		status = ControllerDB_StateSaveAndReset(controllerRef, ctrlStateHandle);
 	}
 	
 	return(status);
@@ -748,33 +1175,174 @@ TQ3Status	IpcControllerState_Restore(CFDictionaryRef dict, CFMutableDictionaryRe
 	//Controller Parameter
 	TQ3Status 			status = kQ3Failure;	//resulting status after calling controller database
 	TQ3ControllerRef 	controllerRef;
-	CFStringRef			ctrlStateUUIDString;
+	TQ3Uns32			ctrlStateHandle = kIPCHandleNone;
 	
 	Boolean 			result;
 	
 	//Get Parameters from dict
 	//-controllerRef
-	result = IPCGetControllerRef(dict, CFSTR(k3CtrlRef), &controllerRef);
+	result = IpcController_GetControllerRef(dict, CFSTR(k3CtrlRef), &controllerRef);
 	
-	//-ctrlStateUUID - may be NULL, if key wasn't found in the dictionary				
-	ctrlStateUUIDString = (CFStringRef)CFDictionaryGetValue(dict, CFSTR(k3CtrlStateUUID));//bug?
+	//-ctrlStateHandle - stays kIPCHandleNone, if key wasn't found in the dictionary				
+	if (CFDictionaryGetValue(dict, CFSTR(k3CtrlStateHandle))!=NULL)
+		IPCGetTQ3Uns32(dict, CFSTR(k3CtrlStateHandle), &ctrlStateHandle);
 	
 	//-Do call
 	if (result==true)
 	{
-		status = ControllerDB_StateRestore(controllerRef, ctrlStateUUIDString);
+		status = ControllerDB_StateRestore(controllerRef, ctrlStateHandle);
 	}
 	
 	return(status);
 };//done
 
+/*
+TC3StateBatchReply:
+-where the result of a batch goes: returnDict of a synchronous request, or the reply port of an asynchronous one
+*/
+typedef struct TC3StateBatchReply
+{
+	CFMutableDictionaryRef	returnDict;			//NULL: asynchronous
+	TQ3Status				status;				//kQ3Success, if every state succeeded
+	SInt32					msgid;
+	TQ3Uns32				requestTag;
+	CFStringRef				replyPortName;
+} TC3StateBatchReply;
+
+static void	IpcControllerState_BatchDone(TQ3Uns32 stateCount, const TQ3Status *stateStatus, void *userData)
+{
+	TC3StateBatchReply		*theReply = (TC3StateBatchReply*)userData;
+	CFMutableDictionaryRef	returnDict = theReply->returnDict;
+	CFMutableArrayRef		statuses;
+	TQ3Uns32				index;
+	
+	if (returnDict==NULL)
+		returnDict = CFDictionaryCreateMutable(	kCFAllocatorDefault,0,
+												&kCFTypeDictionaryKeyCallBacks,
+												&kCFTypeDictionaryValueCallBacks);
+	
+	theReply->status = kQ3Success;
+	statuses = CFArrayCreateMutable(kCFAllocatorDefault, stateCount, &kCFTypeArrayCallBacks);
+	if ((returnDict!=NULL) && (statuses!=NULL))
+	{
+		for (index=0; index<stateCount; index++)
+		{
+			SInt32		stateStatusValue = (SInt32)stateStatus[index];
+			CFNumberRef	number = CFNumberCreate(kCFAllocatorDefault, kCFNumberSInt32Type, &stateStatusValue);
+			
+			if (stateStatus[index]!=kQ3Success)
+				theReply->status = kQ3Failure;
+			if (number!=NULL)
+			{
+				CFArrayAppendValue(statuses, number);
+				CFRelease(number);
+			}
+		}
+		CFDictionarySetValue(returnDict, CFSTR(k3StateStatuses), statuses);
+	}
+	else
+		theReply->status = kQ3Failure;
+	if (statuses)
+		CFRelease(statuses);
+	
+	//asynchronous caller: answer now and forget the request
+	if (theReply->returnDict==NULL)
+	{
+		if (returnDict!=NULL)
+		{
+			IPCPutTQ3Uns32(returnDict, CFSTR(k3Status), (TQ3Uns32*)&theReply->status);
+			IPCAsync_SendReplyTo(theReply->replyPortName, theReply->requestTag, theReply->msgid, returnDict);
+			CFRelease(returnDict);
+		}
+		CFRelease(theReply->replyPortName);
+		free(theReply);
+	}
+};
+
+TQ3Status	IpcControllerState_Batch(SInt32 msgid, CFDictionaryRef dict, CFMutableDictionaryRef returnDict, TQ3Boolean *deferred)
+{
+	//Controller Parameter
+	TQ3Status 			status = kQ3Failure;	//resulting status after calling controller database
+	CFArrayRef			states;
+	TQ3Uns32			stateCount,index;
+	TQ3ControllerRef	*controllerRefs;
+	TQ3Uns32			*ctrlStateHandles;
+	TC3StateBatchReply	syncReply,*theReply = &syncReply;
+	TQ3Boolean			isAsync = IPCAsync_IsAsyncRequest(dict) ? kQ3True : kQ3False;
+	
+	*deferred = kQ3False;
+	
+	//Get Parameters from dict
+	//-states, each a dictionary with controllerRef and ctrlStateHandle
+	states = (CFArrayRef)CFDictionaryGetValue(dict, CFSTR(k3CtrlStates));
+	if (states==NULL)
+		return(status);
+	stateCount = (TQ3Uns32)CFArrayGetCount(states);
+	
+	controllerRefs = (TQ3ControllerRef*)malloc(((stateCount>0) ? stateCount : 1)*sizeof(TQ3ControllerRef));
+	ctrlStateHandles = (TQ3Uns32*)malloc(((stateCount>0) ? stateCount : 1)*sizeof(TQ3Uns32));
+	if (isAsync==kQ3True)
+		theReply = (TC3StateBatchReply*)malloc(sizeof(TC3StateBatchReply));
+	
+	if ((controllerRefs!=NULL) && (ctrlStateHandles!=NULL) && (theReply!=NULL))
+	{
+		for (index=0; index<stateCount; index++)
+		{
+			CFDictionaryRef stateDict = (CFDictionaryRef)CFArrayGetValueAtIndex(states, index);
+			
+			controllerRefs[index] = NULL;
+			ctrlStateHandles[index] = kIPCHandleNone;
+			if (CFDictionaryGetValue(stateDict, CFSTR(k3CtrlRef))!=NULL)
+				IpcController_GetControllerRef(stateDict, CFSTR(k3CtrlRef), &controllerRefs[index]);
+			if (CFDictionaryGetValue(stateDict, CFSTR(k3CtrlStateHandle))!=NULL)
+				IPCGetTQ3Uns32(stateDict, CFSTR(k3CtrlStateHandle), &ctrlStateHandles[index]);
+		}
+		
+		theReply->returnDict = (isAsync==kQ3True) ? NULL : returnDict;
+		theReply->status = kQ3Failure;
+		theReply->msgid = msgid;
+		if (isAsync==kQ3True)
+		{
+			IPCGetTQ3Uns32(dict, CFSTR(k3RequestTag), &theReply->requestTag);
+			theReply->replyPortName = (CFStringRef)CFRetain(CFDictionaryGetValue(dict, CFSTR(k3ReplyPortName)));
+		}
+		
+		//-Do call; asynchronous callers get all drivers asked at once
+		status = ControllerDB_StateBatch(	(msgid==m3ControllerState_RestoreBatch) ? kQ3True : kQ3False,
+											stateCount, controllerRefs, ctrlStateHandles,
+											isAsync, IpcControllerState_BatchDone, theReply);
+		if (isAsync==kQ3True)
+		{
+			if (status==kQ3Success)
+				*deferred = kQ3True;	//answered by IpcControllerState_BatchDone
+			else
+			{
+				CFRelease(theReply->replyPortName);
+				free(theReply);
+			}
+		}
+		else if (status==kQ3Success)
+			status = syncReply.status;
+	}
+	else if ((isAsync==kQ3True) && (theReply!=NULL))
+		free(theReply);
+	
+	if (controllerRefs)
+		free(controllerRefs);
+	if (ctrlStateHandles)
+		free(ctrlStateHandles);
+	
+	return(status);
+};//done
+
 #pragma mark -
 
 CFDataRef IPCControllerDispatcher ( CFMessagePortRef local, SInt32 msgid, CFDataRef data, void *info)
 {
 	TQ3Status 				status;
+	TQ3Boolean				deferred = kQ3False;
 	
-	CFDataRef 				returnData;
+	CFDataRef 				returnData = NULL;
 	
 	CFDictionaryRef			dict;
 	CFMutableDictionaryRef	returnDict;
@@ -830,6 +1398,18 @@ CFDataRef IPCControllerDispatcher ( CFMessagePortRef local, SInt32 msgid, CFData
 			case m3Controller_GetChannel:
 				status = IpcController_GetChannel(dict,returnDict);
 				break;
+			case m3Controller_SetChannels:
+				status = IpcController_SetChannels(dict,returnDict);
+				break;
+			case m3Controller_GetChannels:
+				status = IpcController_GetChannels(dict,returnDict);
+				break;
+			case m3Controller_GetDriverEndpoint:
+				status = IpcController_GetDriverEndpoint(dict,returnDict);
+				break;
+			case m3Controller_ChannelChanged:
+				status = IpcController_ChannelChanged(dict,returnDict);
+				break;
 			case m3Controller_GetValueCount:
 				status = IpcController_GetValueCount(dict,returnDict);
 				break;
@@ -875,6 +1455,15 @@ CFDataRef IPCControllerDispatcher ( CFMessagePortRef local, SInt32 msgid, CFData
 			case m3Controller_SetValues:
 				status = IpcController_SetValues(dict,returnDict);
 				break;
+			case m3Controller_WaitForValues:
+				status = IpcController_WaitForValues(dict,returnDict,&deferred);
+				break;
+			case m3Controller_GetConsumerState:
+				status = IpcController_GetConsumerState(dict,returnDict);
+				break;
+			case m3Controller_SetFilter:
+				status = IpcController_SetFilter(dict,returnDict);
+				break;
 			case m3ControllerState_New:
 				status = IpcControllerState_New(dict,returnDict);
 				break;
@@ -887,18 +1476,29 @@ CFDataRef IPCControllerDispatcher ( CFMessagePortRef local, SInt32 msgid, CFData
 			case m3ControllerState_Restore:
 				status = IpcControllerState_Restore(dict,returnDict);
 				break;	
+			case m3ControllerState_SaveAndResetBatch:
+			case m3ControllerState_RestoreBatch:
+				status = IpcControllerState_Batch(msgid,dict,returnDict,&deferred);
+				break;
 			default:
 			break;
 		}
 	}
-	if (dict)
-		CFRelease(dict);
-	
 	//status
 	IPCPutTQ3Uns32(returnDict, CFSTR(k3Status), (TQ3Uns32*)&status);
-		
-	//returnDict to CFDataRef
-	returnData= CFPropertyListCreateXMLData(kCFAllocatorDefault,returnDict);
+	
+	if (IPCAsync_IsAsyncRequest(dict))
+	{
+		//asynchronous caller: answer via its reply port, unless the request was parked
+		if (deferred==kQ3False)
+			IPCAsync_SendReply(dict, msgid, returnDict);
+	}
+	else
+		//returnDict to CFDataRef
+		returnData= CFPropertyListCreateXMLData(kCFAllocatorDefault,returnDict);
+	
+	if (dict)
+		CFRelease(dict);
 	
 	if (returnDict)
 		CFRelease(returnDict);
@@ -53,7 +53,7 @@
 #include "IPCPackUnpack.h"
 
 TQ3Status IPCTracker_Send( 	SInt32 msgid, 
-							CFStringRef theTrackerUUID, 
+							TQ3Uns32 theTrackerHandle, 
 							CFStringRef theTrackerPortName, 
 							CFMutableDictionaryRef dict, 
 							CFMutableDictionaryRef *returnDict)
@@ -65,8 +65,8 @@ TQ3Status IPCTracker_Send( 	SInt32 msgid,
 	
 	*returnDict=NULL;
 	
-	//insert TrackerUUID into dict
-	CFDictionarySetValue(dict,CFSTR(k3TrackerUUID),theTrackerUUID); 
+	//insert tracker handle into dict
+	IPCPutTQ3Uns32(dict,CFSTR(k3TrackerHandle),&theTrackerHandle);
 	
 	data= CFPropertyListCreateXMLData(kCFAllocatorDefault,dict);
 	//what to release?
@@ -108,7 +108,7 @@ TQ3Status IPCTracker_Send( 	SInt32 msgid,
 };
 
 
-TQ3Status IPCTracker_callNotification	(	CFStringRef theTrackerUUID, 
+TQ3Status IPCTracker_callNotification	(	TQ3Uns32 theTrackerHandle, 
 											CFStringRef theTrackerPortName, 
 											TQ3ControllerRef controllerRef)
 {
@@ -128,7 +128,7 @@ TQ3Status IPCTracker_callNotification	(	CFStringRef theTrackerUUID,
 		result = IPCPutControllerRef(dict,CFSTR(k3CtrlRef),&controllerRef);
 				
 		//try sending
-		status = IPCTracker_Send(m3Tracker_CallNotification,theTrackerUUID,theTrackerPortName,dict,&returnDict);
+		status = IPCTracker_Send(m3Tracker_CallNotification,theTrackerHandle,theTrackerPortName,dict,&returnDict);
 		if (status!=kQ3Failure)
 		{
 			//Get status from returnDict
@@ -144,7 +144,7 @@ TQ3Status IPCTracker_callNotification	(	CFStringRef theTrackerUUID,
 }
 
 
-TQ3Status IPCTracker_changeButtons		(	CFStringRef theTrackerUUID, 
+TQ3Status IPCTracker_changeButtons		(	TQ3Uns32 theTrackerHandle, 
 											CFStringRef theTrackerPortName, 
 											TQ3ControllerRef controllerRef, 
 											TQ3Uns32 buttons, 
@@ -172,7 +172,7 @@ TQ3Status IPCTracker_changeButtons		(	CFStringRef theTrackerUUID,
 		result = IPCPutTQ3Uns32(dict, CFSTR(k3ButtonMask), &buttonMask);
 				
 		//try sending
-		status = IPCTracker_Send(m3Tracker_ChangeButtons,theTrackerUUID,theTrackerPortName,dict,&returnDict);
+		status = IPCTracker_Send(m3Tracker_ChangeButtons,theTrackerHandle,theTrackerPortName,dict,&returnDict);
 		if (status!=kQ3Failure)
 		{
 			//Get status from returnDict
@@ -187,7 +187,7 @@ TQ3Status IPCTracker_changeButtons		(	CFStringRef theTrackerUUID,
 	return(status);
 }
 
-TQ3Status IPCTracker_getActivation		(	CFStringRef theTrackerUUID, 
+TQ3Status IPCTracker_getActivation		(	TQ3Uns32 theTrackerHandle, 
 											CFStringRef theTrackerPortName, 
 											TQ3Boolean *active)
 {
@@ -203,7 +203,7 @@ TQ3Status IPCTracker_getActivation		(	CFStringRef theTrackerUUID,
 	if (dict)
 	{
 		//try sending
-		status = IPCTracker_Send(m3Tracker_GetActivation,theTrackerUUID,theTrackerPortName,dict,&returnDict);
+		status = IPCTracker_Send(m3Tracker_GetActivation,theTrackerHandle,theTrackerPortName,dict,&returnDict);
 		if (status!=kQ3Failure)
 		{
 			//Get values from returnDict
@@ -222,7 +222,7 @@ TQ3Status IPCTracker_getActivation		(	CFStringRef theTrackerUUID,
 	return(status);
 }
 
-TQ3Status IPCTracker_getPosition		(	CFStringRef theTrackerUUID, 
+TQ3Status IPCTracker_getPosition		(	TQ3Uns32 theTrackerHandle, 
 											CFStringRef theTrackerPortName, 
 											TQ3Point3D *position)
 {
@@ -238,7 +238,7 @@ TQ3Status IPCTracker_getPosition		(	CFStringRef theTrackerUUID,
 	if (dict)
 	{
 		//try sending
-		status = IPCTracker_Send(m3Tracker_GetPosition,theTrackerUUID,theTrackerPortName,dict,&returnDict);
+		status = IPCTracker_Send(m3Tracker_GetPosition,theTrackerHandle,theTrackerPortName,dict,&returnDict);
 		if (status!=kQ3Failure)
 		{
 			//Get values from returnDict
@@ -259,7 +259,7 @@ TQ3Status IPCTracker_getPosition		(	CFStringRef theTrackerUUID,
 
 
 
-TQ3Status IPCTracker_setPosition		(	CFStringRef theTrackerUUID, 
+TQ3Status IPCTracker_setPosition		(	TQ3Uns32 theTrackerHandle, 
 											CFStringRef theTrackerPortName, 
 											TQ3ControllerRef controllerRef, 
 											const TQ3Point3D *position)
@@ -283,7 +283,7 @@ TQ3Status IPCTracker_setPosition		(	CFStringRef theTrackerUUID,
 		result = IPCPutTQ3Point3D(dict, CFSTR(k3Position), position);
 		
 		//try sending
-		status = IPCTracker_Send(m3Tracker_SetPosition,theTrackerUUID,theTrackerPortName,dict,&returnDict);
+		status = IPCTracker_Send(m3Tracker_SetPosition,theTrackerHandle,theTrackerPortName,dict,&returnDict);
 		if (status!=kQ3Failure)
 		{
 			//Get status from returnDict
@@ -299,7 +299,7 @@ TQ3Status IPCTracker_setPosition		(	CFStringRef theTrackerUUID,
 }
 
 
-TQ3Status IPCTracker_movePosition		(	CFStringRef theTrackerUUID, 
+TQ3Status IPCTracker_movePosition		(	TQ3Uns32 theTrackerHandle, 
 											CFStringRef theTrackerPortName, 
 											TQ3ControllerRef controllerRef, 
 											const TQ3Vector3D *delta)
@@ -323,7 +323,7 @@ TQ3Status IPCTracker_movePosition		(	CFStringRef theTrackerUUID,
 		result = IPCPutTQ3Vector3D(dict, CFSTR(k3DeltaPos), delta);
 		
 		//try sending
-		status = IPCTracker_Send(m3Tracker_MovePosition,theTrackerUUID,theTrackerPortName,dict,&returnDict);
+		status = IPCTracker_Send(m3Tracker_MovePosition,theTrackerHandle,theTrackerPortName,dict,&returnDict);
 		if (status!=kQ3Failure)
 		{
 			//Get status from returnDict
@@ -338,7 +338,7 @@ TQ3Status IPCTracker_movePosition		(	CFStringRef theTrackerUUID,
 	return(status);
 }
 
-TQ3Status IPCTracker_getOrientation		(	CFStringRef theTrackerUUID, 
+TQ3Status IPCTracker_getOrientation		(	TQ3Uns32 theTrackerHandle, 
 											CFStringRef theTrackerPortName, 
 											TQ3Quaternion *orientation)
 {
@@ -354,7 +354,7 @@ TQ3Status IPCTracker_getOrientation		(	CFStringRef theTrackerUUID,
 	if (dict)
 	{
 		//try sending
-		status = IPCTracker_Send(m3Tracker_GetOrientation,theTrackerUUID,theTrackerPortName,dict,&returnDict);
+		status = IPCTracker_Send(m3Tracker_GetOrientation,theTrackerHandle,theTrackerPortName,dict,&returnDict);
 		if (status!=kQ3Failure)
 		{
 			//Get values from returnDict
@@ -373,7 +373,7 @@ TQ3Status IPCTracker_getOrientation		(	CFStringRef theTrackerUUID,
 	return(status);
 }
 
-TQ3Status IPCTracker_setOrientation		(	CFStringRef theTrackerUUID, 
+TQ3Status IPCTracker_setOrientation		(	TQ3Uns32 theTrackerHandle, 
 											CFStringRef theTrackerPortName, 
 											TQ3ControllerRef controllerRef, 
 											const TQ3Quaternion *orientation)
@@ -397,7 +397,7 @@ TQ3Status IPCTracker_setOrientation		(	CFStringRef theTrackerUUID,
 		result = IPCPutTQ3Quaternion(dict, CFSTR(k3Orient), orientation);
 				
 		//try sending
-		status = IPCTracker_Send(m3Tracker_SetOrientation,theTrackerUUID,theTrackerPortName,dict,&returnDict);
+		status = IPCTracker_Send(m3Tracker_SetOrientation,theTrackerHandle,theTrackerPortName,dict,&returnDict);
 		if (status!=kQ3Failure)
 		{
 			//Get status from returnDict
@@ -413,7 +413,7 @@ TQ3Status IPCTracker_setOrientation		(	CFStringRef theTrackerUUID,
 }
 
 
-TQ3Status IPCTracker_moveOrientation	(	CFStringRef theTrackerUUID, 
+TQ3Status IPCTracker_moveOrientation	(	TQ3Uns32 theTrackerHandle, 
 											CFStringRef theTrackerPortName, 
 											TQ3ControllerRef controllerRef, 
 											const TQ3Quaternion *delta)
@@ -437,7 +437,7 @@ TQ3Status IPCTracker_moveOrientation	(	CFStringRef theTrackerUUID,
 		result = IPCPutTQ3Quaternion(dict, CFSTR(k3Orient), delta);
 				
 		//try sending
-		status = IPCTracker_Send(m3Tracker_MoveOrientation,theTrackerUUID,theTrackerPortName,dict,&returnDict);
+		status = IPCTracker_Send(m3Tracker_MoveOrientation,theTrackerHandle,theTrackerPortName,dict,&returnDict);
 		if (status!=kQ3Failure)
 		{
 			//Get status from returnDict
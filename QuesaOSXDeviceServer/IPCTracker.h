@@ -49,44 +49,44 @@
 
 #include <Carbon/Carbon.h>
 
-TQ3Status IPCTracker_callNotification	(	CFStringRef theTrackerUUID, 
+TQ3Status IPCTracker_callNotification	(	TQ3Uns32 theTrackerHandle, 
 											CFStringRef theTrackerPortName, 
 											TQ3ControllerRef controllerRef);
 											
-TQ3Status IPCTracker_changeButtons		(	CFStringRef theTrackerUUID, 
+TQ3Status IPCTracker_changeButtons		(	TQ3Uns32 theTrackerHandle, 
 											CFStringRef theTrackerPortName, 
 											TQ3ControllerRef controllerRef, 
 											TQ3Uns32 buttons, 
 											TQ3Uns32 buttonMask);
 											
-TQ3Status IPCTracker_getActivation		(	CFStringRef theTrackerUUID, 
+TQ3Status IPCTracker_getActivation		(	TQ3Uns32 theTrackerHandle, 
 											CFStringRef theTrackerPortName, 
 											TQ3Boolean *active);
 											
-TQ3Status IPCTracker_getPosition		(	CFStringRef theTrackerUUID, 
+TQ3Status IPCTracker_getPosition		(	TQ3Uns32 theTrackerHandle, 
 											CFStringRef theTrackerPortName, 
 											TQ3Point3D *position);
 											
-TQ3Status IPCTracker_setPosition		(	CFStringRef theTrackerUUID, 
+TQ3Status IPCTracker_setPosition		(	TQ3Uns32 theTrackerHandle, 
 											CFStringRef theTrackerPortName, 
 											TQ3ControllerRef controllerRef, 
 											const TQ3Point3D *position);
 											
-TQ3Status IPCTracker_movePosition		(	CFStringRef theTrackerUUID, 
+TQ3Status IPCTracker_movePosition		(	TQ3Uns32 theTrackerHandle, 
 											CFStringRef theTrackerPortName, 
 											TQ3ControllerRef controllerRef, 
 											const TQ3Vector3D *delta);
 											
-TQ3Status IPCTracker_getOrientation		(	CFStringRef theTrackerUUID, 
+TQ3Status IPCTracker_getOrientation		(	TQ3Uns32 theTrackerHandle, 
 											CFStringRef theTrackerPortName, 
 											TQ3Quaternion *orientation);
 											
-TQ3Status IPCTracker_setOrientation		(	CFStringRef theTrackerUUID, 
+TQ3Status IPCTracker_setOrientation		(	TQ3Uns32 theTrackerHandle, 
 											CFStringRef theTrackerPortName, 
 											TQ3ControllerRef controllerRef, 
 											const TQ3Quaternion *orientation);
 											
-TQ3Status IPCTracker_moveOrientation	(	CFStringRef theTrackerUUID, 
+TQ3Status IPCTracker_moveOrientation	(	TQ3Uns32 theTrackerHandle, 
 											CFStringRef theTrackerPortName, 
 											TQ3ControllerRef controllerRef, 
 											const TQ3Quaternion *delta);
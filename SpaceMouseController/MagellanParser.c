@@ -0,0 +1,376 @@
+/*  NAME:
+        MagellanParser.c
+
+    DESCRIPTION:
+        Incremental parser for the serial protocol of the Magellan/SpaceMouse
+		(grey model; RS232).
+		
+		Bytes go into a fixed ring, either written there directly by the reader
+		or copied in by MagellanParser_Feed. Packets are CR terminated; each
+		complete packet is decoded in place (or from a small linear copy, when
+		it wraps around the end of the ring) and handed to the event callback.
+		Nothing is allocated and no byte is moved after it has been received.
+      
+    COPYRIGHT:
+        Copyright (c) 1999-2005, Quesa Developers. All rights reserved.
+
+        For the current release of Quesa, please see:
+
+            <http://www.quesa.org/>
+        
+        Redistribution and use in source and binary forms, with or without
+        modification, are permitted provided that the following conditions
+        are met:
+        
+            o Redistributions of source code must retain the above copyright
+              notice, this list of conditions and the following disclaimer.
+        
+            o Redistributions in binary form must reproduce the above
+              copyright notice, this list of conditions and the following
+              disclaimer in the documentation and/or other materials provided
+              with the distribution.
+        
+            o Neither the name of Quesa nor the names of its contributors
+              may be used to endorse or promote products derived from this
+              software without specific prior written permission.
+        
+        THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+        "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+        LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+        A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+        OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+        SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+        TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+        PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+        LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+        NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+        SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+    ___________________________________________________________________________
+*/
+
+
+
+
+//=============================================================================
+//      Include files
+//-----------------------------------------------------------------------------
+#include "MagellanParser.h"
+
+#include <string.h>
+
+
+
+
+
+//=============================================================================
+//      Internal constants
+//-----------------------------------------------------------------------------
+#define kMagellanRingMask			(kMagellanRingSize-1)
+#define kMagellanInvalidNibble		0x10
+
+#define kMagellanMotionLength		(1+4*kMagellanAxisCount)
+#define kMagellanKeysLength			4
+
+//the device encodes a nibble as one of "0AB3D56GH9:K<MN?"; only the low four bits matter.
+//Everything outside of 0x30..0x4F is marked invalid, so a whole packet is checked by
+//or-ing its table entries.
+#define N(_c)	((_c)&0x0F)
+#define ROW_INVALID \
+	kMagellanInvalidNibble,kMagellanInvalidNibble,kMagellanInvalidNibble,kMagellanInvalidNibble, \
+	kMagellanInvalidNibble,kMagellanInvalidNibble,kMagellanInvalidNibble,kMagellanInvalidNibble, \
+	kMagellanInvalidNibble,kMagellanInvalidNibble,kMagellanInvalidNibble,kMagellanInvalidNibble, \
+	kMagellanInvalidNibble,kMagellanInvalidNibble,kMagellanInvalidNibble,kMagellanInvalidNibble
+#define ROW_VALID \
+	N(0x0),N(0x1),N(0x2),N(0x3),N(0x4),N(0x5),N(0x6),N(0x7), \
+	N(0x8),N(0x9),N(0xA),N(0xB),N(0xC),N(0xD),N(0xE),N(0xF)
+
+static const uint8_t CharToNibbleTable[256] =
+{
+	ROW_INVALID, ROW_INVALID, ROW_INVALID, ROW_VALID,		//0x00..0x3F
+	ROW_VALID,   ROW_INVALID, ROW_INVALID, ROW_INVALID,		//0x40..0x7F
+	ROW_INVALID, ROW_INVALID, ROW_INVALID, ROW_INVALID,		//0x80..0xBF
+	ROW_INVALID, ROW_INVALID, ROW_INVALID, ROW_INVALID		//0xC0..0xFF
+};
+
+#undef ROW_VALID
+#undef ROW_INVALID
+#undef N
+
+static const char NibbleToCharTable[16] =
+	{0x30,0x41,0x42,0x33,0x44,0x35,0x36,0x47,0x48,0x39,0x3a,0x4b,0x3c,0x4d,0x4e,0x3f};
+
+
+
+
+
+//=============================================================================
+//      Internal functions
+//-----------------------------------------------------------------------------
+//      MagellanParser_DecodeAxes : Decode the six axes of a motion packet.
+//-----------------------------------------------------------------------------
+//		Note : Returns 0, if a character is not a valid nibble.
+//-----------------------------------------------------------------------------
+static int
+MagellanParser_DecodeAxes(const uint8_t *chars, int16_t *axes)
+{
+	const uint8_t	*table = CharToNibbleTable;
+	uint32_t		invalid = 0, axis;
+	
+	for (axis=0; axis<kMagellanAxisCount; axis++, chars+=4)
+	{
+		uint32_t n3 = table[chars[0]], n2 = table[chars[1]], n1 = table[chars[2]], n0 = table[chars[3]];
+		
+		invalid   |= n3 | n2 | n1 | n0;
+		axes[axis] = (int16_t) ((int32_t) ((n3<<12) | (n2<<8) | (n1<<4) | n0) - 32768);
+	}
+	
+	return((invalid & kMagellanInvalidNibble) == 0);
+}
+
+
+
+//=============================================================================
+//      MagellanParser_DecodePacket : Decode one packet, without its CR.
+//-----------------------------------------------------------------------------
+//		Note : Returns 0 for malformed packets.
+//-----------------------------------------------------------------------------
+static int
+MagellanParser_DecodePacket(const uint8_t *packet, uint32_t length,
+							TMagellanEventProc eventProc, void *refCon)
+{
+	const uint8_t	*table = CharToNibbleTable;
+	TMagellanEvent	event;
+	uint32_t		check = 0;
+	
+	memset(&event, 0, sizeof(event));
+	event.type = (TMagellanEventType) packet[0];
+	
+	switch (packet[0])
+	{
+		case kMagellanEventMotion:
+			if ((length!=kMagellanMotionLength) || !MagellanParser_DecodeAxes(packet+1, event.axes))
+				return(0);
+			break;
+		
+		case kMagellanEventKeys:
+			if (length!=kMagellanKeysLength)
+				return(0);
+			check		= table[packet[1]] | table[packet[2]] | table[packet[3]];
+			event.keys	= (uint16_t) ((table[packet[3]]<<8) | (table[packet[2]]<<4) | table[packet[1]]);
+			break;
+		
+		case kMagellanEventMode:
+			if (length!=2)
+				return(0);
+			check		= table[packet[1]];
+			event.mode	= table[packet[1]];
+			break;
+		
+		case kMagellanEventNullRadius:
+			if (length!=2)
+				return(0);
+			check				= table[packet[1]];
+			event.nullRadius	= table[packet[1]];
+			break;
+		
+		case kMagellanEventQuality:
+			if (length!=3)
+				return(0);
+			check				= table[packet[1]] | table[packet[2]];
+			event.transQuality	= table[packet[1]];
+			event.rotQuality	= table[packet[2]];
+			break;
+		
+		case kMagellanEventDataRate:
+			if (length!=3)
+				return(0);
+			check			= table[packet[1]] | table[packet[2]];
+			event.maxRate	= table[packet[1]];
+			event.minRate	= table[packet[2]];
+			break;
+		
+		case kMagellanEventVersion:
+		case kMagellanEventError:
+		case kMagellanEventBeep:
+		case kMagellanEventZero:
+			event.text			= (const char *) (packet+1);
+			event.textLength	= length-1;
+			break;
+		
+		default:
+			return(0);
+	}
+	
+	if (check & kMagellanInvalidNibble)
+		return(0);
+	
+	if (eventProc!=NULL)
+		eventProc(&event, refCon);
+	
+	return(1);
+}
+
+
+
+
+
+//=============================================================================
+//      Public functions
+//-----------------------------------------------------------------------------
+//      MagellanParser_Init : Reset the parser.
+//-----------------------------------------------------------------------------
+void
+MagellanParser_Init(TMagellanParser *parser)
+{
+	memset(parser, 0, sizeof(TMagellanParser));
+}
+
+
+
+//=============================================================================
+//      MagellanParser_WriteBuffer : Contiguous free space of the ring.
+//-----------------------------------------------------------------------------
+//		Note : The unfinished packet is kept; everything before it is free.
+//-----------------------------------------------------------------------------
+uint8_t *
+MagellanParser_WriteBuffer(TMagellanParser *parser, uint32_t *freeSize)
+{
+	uint32_t	offset = parser->writeIndex & kMagellanRingMask;
+	uint32_t	available = kMagellanRingSize - (parser->writeIndex - parser->packetStart);
+	
+	if (available > kMagellanRingSize-offset)
+		available = kMagellanRingSize-offset;
+	
+	*freeSize = available;
+	return(&parser->ring[offset]);
+}
+
+
+
+//=============================================================================
+//      MagellanParser_Commit : Account for bytes written to the write buffer.
+//-----------------------------------------------------------------------------
+void
+MagellanParser_Commit(TMagellanParser *parser, uint32_t byteCount)
+{
+	parser->writeIndex += byteCount;
+}
+
+
+
+//=============================================================================
+//      MagellanParser_Parse : Decode all complete packets of the ring.
+//-----------------------------------------------------------------------------
+//		Note :	A packet longer than kMagellanMaxPacketSize is dropped up to
+//				its CR, so line noise cannot stall the ring.
+//-----------------------------------------------------------------------------
+uint32_t
+MagellanParser_Parse(TMagellanParser *parser, TMagellanEventProc eventProc, void *refCon)
+{
+	uint8_t		linear[kMagellanMaxPacketSize];
+	uint32_t	eventCount = 0;
+	
+	while (parser->scanIndex != parser->writeIndex)
+	{
+		uint32_t		offset = parser->scanIndex & kMagellanRingMask;
+		uint32_t		available = parser->writeIndex - parser->scanIndex;
+		const uint8_t	*cr;
+		uint32_t		length;
+		
+		if (available > kMagellanRingSize-offset)
+			available = kMagellanRingSize-offset;
+		
+		cr = (const uint8_t *) memchr(&parser->ring[offset], '\r', available);
+		if (cr==NULL)
+		{
+			//no packet end yet
+			parser->scanIndex += available;
+			if (!parser->discarding && (parser->scanIndex - parser->packetStart > kMagellanMaxPacketSize))
+			{
+				parser->discarding = 1;
+				parser->errorCount++;
+			}
+			if (parser->discarding)
+				parser->packetStart = parser->scanIndex;
+			continue;
+		}
+		
+		parser->scanIndex += (uint32_t) (cr - &parser->ring[offset]) + 1;
+		length = parser->scanIndex - 1 - parser->packetStart;
+		
+		if (parser->discarding)
+			parser->discarding = 0;
+		else if (length > kMagellanMaxPacketSize)
+			parser->errorCount++;
+		else if (length > 0)
+		{
+			uint32_t		start = parser->packetStart & kMagellanRingMask;
+			const uint8_t	*packet = &parser->ring[start];
+			
+			//a packet wrapping around the end of the ring is decoded from a copy
+			if (start+length > kMagellanRingSize)
+			{
+				memcpy(linear, packet, kMagellanRingSize-start);
+				memcpy(linear+(kMagellanRingSize-start), parser->ring, length-(kMagellanRingSize-start));
+				packet = linear;
+			}
+			
+			if (MagellanParser_DecodePacket(packet, length, eventProc, refCon))
+			{
+				parser->packetCount++;
+				eventCount++;
+			}
+			else
+				parser->errorCount++;
+		}
+		
+		parser->packetStart = parser->scanIndex;
+	}
+	
+	return(eventCount);
+}
+
+
+
+//=============================================================================
+//      MagellanParser_Feed : Copy bytes into the ring and parse them.
+//-----------------------------------------------------------------------------
+uint32_t
+MagellanParser_Feed(TMagellanParser *parser, const uint8_t *bytes, uint32_t byteCount,
+					TMagellanEventProc eventProc, void *refCon)
+{
+	uint32_t	eventCount = 0;
+	
+	while (byteCount > 0)
+	{
+		uint32_t	freeSize;
+		uint8_t		*buffer = MagellanParser_WriteBuffer(parser, &freeSize);
+		
+		//cannot happen after a parse: an unfinished packet never exceeds kMagellanMaxPacketSize
+		if (freeSize==0)
+			break;
+		
+		if (freeSize > byteCount)
+			freeSize = byteCount;
+		
+		memcpy(buffer, bytes, freeSize);
+		MagellanParser_Commit(parser, freeSize);
+		bytes		+= freeSize;
+		byteCount	-= freeSize;
+		
+		eventCount += MagellanParser_Parse(parser, eventProc, refCon);
+	}
+	
+	return(eventCount);
+}
+
+
+
+//=============================================================================
+//      MagellanParser_NibbleToChar : The device's character for a nibble.
+//-----------------------------------------------------------------------------
+char
+MagellanParser_NibbleToChar(uint32_t nibble)
+{
+	return(NibbleToCharTable[nibble & 0x0F]);
+}
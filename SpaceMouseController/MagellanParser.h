@@ -0,0 +1,141 @@
+/*  NAME:
+        MagellanParser.h
+
+    DESCRIPTION:
+        Incremental parser for the serial protocol of the Magellan/SpaceMouse
+		(grey model; RS232). Plain C without Apple dependencies, so captured
+		byte streams can be decoded on any platform.
+      
+    COPYRIGHT:
+        Copyright (c) 1999-2005, Quesa Developers. All rights reserved.
+
+        For the current release of Quesa, please see:
+
+            <http://www.quesa.org/>
+        
+        Redistribution and use in source and binary forms, with or without
+        modification, are permitted provided that the following conditions
+        are met:
+        
+            o Redistributions of source code must retain the above copyright
+              notice, this list of conditions and the following disclaimer.
+        
+            o Redistributions in binary form must reproduce the above
+              copyright notice, this list of conditions and the following
+              disclaimer in the documentation and/or other materials provided
+              with the distribution.
+        
+            o Neither the name of Quesa nor the names of its contributors
+              may be used to endorse or promote products derived from this
+              software without specific prior written permission.
+        
+        THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+        "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+        LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+        A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+        OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+        SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+        TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+        PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+        LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+        NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+        SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+    ___________________________________________________________________________
+*/
+
+
+
+
+
+#ifndef MagellanParser_HDR
+#define MagellanParser_HDR
+
+#include <stdint.h>
+
+//=============================================================================
+//		C++ preamble
+//-----------------------------------------------------------------------------
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//=============================================================================
+//      Constants
+//-----------------------------------------------------------------------------
+#define kMagellanRingSize			256		//power of two; holds at least one whole packet
+#define kMagellanMaxPacketSize		80		//longest packet accepted, version replies included
+#define kMagellanAxisCount			6		//x, y, z, a, b, c
+
+typedef enum TMagellanEventType
+{
+	kMagellanEventMotion		= 'd',		//axes
+	kMagellanEventKeys			= 'k',		//keys
+	kMagellanEventMode			= 'm',		//mode
+	kMagellanEventNullRadius	= 'n',		//nullRadius
+	kMagellanEventDataRate		= 'p',		//maxRate, minRate
+	kMagellanEventQuality		= 'q',		//transQuality, rotQuality
+	kMagellanEventVersion		= 'v',		//text
+	kMagellanEventError			= 'e',		//text
+	kMagellanEventBeep			= 'b',		//echo of a beep command
+	kMagellanEventZero			= 'z'		//echo of a zero command
+} TMagellanEventType;
+
+//=============================================================================
+//      Types
+//-----------------------------------------------------------------------------
+typedef struct TMagellanEvent
+{
+	TMagellanEventType		type;
+	int16_t					axes[kMagellanAxisCount];	//signed device counts
+	uint16_t				keys;						//bit 0 is key 1, bit 8 is the star key
+	uint8_t					mode;						//bit 0 rotation, bit 1 translation, bit 2 dominant
+	uint8_t					nullRadius;
+	uint8_t					transQuality;
+	uint8_t					rotQuality;
+	uint8_t					maxRate;
+	uint8_t					minRate;
+	uint32_t				textLength;
+	const char				*text;						//not NUL terminated; valid during the callback
+} TMagellanEvent;
+
+typedef void (*TMagellanEventProc)(const TMagellanEvent *event, void *refCon);
+
+typedef struct TMagellanParser
+{
+	uint8_t					ring[kMagellanRingSize];
+	uint32_t				writeIndex;					//free running; masked on access
+	uint32_t				scanIndex;					//next byte to look at
+	uint32_t				packetStart;				//first byte of the unfinished packet
+	uint32_t				discarding;					//skip up to the next CR
+	
+	uint32_t				packetCount;
+	uint32_t				errorCount;
+} TMagellanParser;
+
+//=============================================================================
+//      Function prototypes
+//-----------------------------------------------------------------------------
+void		MagellanParser_Init(TMagellanParser *parser);
+
+//contiguous free space in the ring, e.g. for read(2) to fill directly; commit what was written
+uint8_t		*MagellanParser_WriteBuffer(TMagellanParser *parser, uint32_t *freeSize);
+void		MagellanParser_Commit(TMagellanParser *parser, uint32_t byteCount);
+
+//decodes all complete packets, calling eventProc for each; returns the number of events
+uint32_t	MagellanParser_Parse(TMagellanParser *parser, TMagellanEventProc eventProc, void *refCon);
+
+//copies bytes into the ring and parses them, in as many rounds as needed
+uint32_t	MagellanParser_Feed(TMagellanParser *parser, const uint8_t *bytes, uint32_t byteCount,
+								TMagellanEventProc eventProc, void *refCon);
+
+//command encoding: the device's character for a nibble
+char		MagellanParser_NibbleToChar(uint32_t nibble);
+
+//=============================================================================
+//		C++ postamble
+//-----------------------------------------------------------------------------
+#ifdef __cplusplus
+}
+#endif
+
+#endif
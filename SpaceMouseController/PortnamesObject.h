@@ -3,7 +3,8 @@
 
     DESCRIPTION:
         Objective-C Interface definition for an object holding the names and paths of 
-		serial ports under MacOS X 
+		serial ports under MacOS X. The list is kept current by IOKit arrival and
+		termination notifications; a delegate hears about each change.
 
     COPYRIGHT:
         Copyright (c) 1999-2005, Quesa Developers. All rights reserved.
@@ -44,18 +45,37 @@
 
 #import <Foundation/Foundation.h>
 
+#include <IOKit/IOKitLib.h>
+
 @class NSPopUpButton;
 
 @interface PortnamesObject : NSObject {
-	NSMutableArray *PortnamesArray;
+	NSMutableArray *PortnamesArray;		//name and path of each port; nothing else is copied
+	
+	IONotificationPortRef	notifyPort;
+	io_iterator_t			addedIterator;
+	io_iterator_t			removedIterator;
+	BOOL					notificationsArmed;
+	id						delegate;
 }
 
 - init;
 - (void)dealloc;
 
+//first call arms the notifications; the array is kept current from then on
 - (kern_return_t)buildPortnamesArray;
+- stopNotifications;
+
+- setDelegate:(id)anObject;
+- (int)indexOfDevicePath:(NSString*)devicePath;
 
 - (void)fillMenu:(id)thePopUp;
 - (NSString*)getDevicePathFromMenuitem:(int)anInt;
 
 @end
+
+//informal protocol of the delegate; called on the run loop buildPortnamesArray ran on
+@interface NSObject (PortnamesDelegate)
+- (void)portnamesAdded:(NSString *)devicePath;
+- (void)portnamesRemoved:(NSString *)devicePath;
+@end
@@ -58,6 +58,39 @@
 
 #import "PortnamesObject.h"
 
+#include <sys/stat.h>
+
+@interface PortnamesObject (Notifications)
+- (void)servicesAdded:(io_iterator_t)iterator;
+- (void)servicesRemoved:(io_iterator_t)iterator;
+@end
+
+static void PortnamesServicesAdded(void *refCon, io_iterator_t iterator)
+{
+	[(PortnamesObject *)refCon servicesAdded:iterator];
+}
+
+static void PortnamesServicesRemoved(void *refCon, io_iterator_t iterator)
+{
+	[(PortnamesObject *)refCon servicesRemoved:iterator];
+}
+
+//RS-232 serial ports
+static CFMutableDictionaryRef PortnamesMatching(void)
+{
+	CFMutableDictionaryRef classesToMatch;
+	
+    classesToMatch = IOServiceMatching(kIOSerialBSDServiceValue);
+    if (classesToMatch == NULL)
+        NSLog(@"IOServiceMatching returned a NULL dictionary.\n");
+    else {
+        CFDictionarySetValue(classesToMatch,
+                    CFSTR(kIOSerialBSDTypeKey),
+                    CFSTR(kIOSerialBSDRS232Type));
+    }
+	return classesToMatch;
+}
+
 @implementation PortnamesObject
 
 - init
@@ -72,6 +105,7 @@
 
 - (void)dealloc
 {
+	[self stopNotifications];
     [PortnamesArray release];
 	
     [super dealloc];
@@ -82,56 +116,84 @@
 	kern_return_t			kernResult; 
     mach_port_t				masterPort;
     CFMutableDictionaryRef	classesToMatch;
-	CFMutableDictionaryRef	PortProperties;
-	io_iterator_t			matchingServices;
-	io_object_t				serPortService;
+	
+	//the notifications keep the array current; no rescans
+	if (notificationsArmed)
+		return KERN_SUCCESS;
 	
 	//find seriel ports
 	kernResult = IOMasterPort(MACH_PORT_NULL, &masterPort);
-    if (KERN_SUCCESS != kernResult)
+    if (KERN_SUCCESS != kernResult) {
         NSLog(@"IOMasterPort returned %d\n", kernResult);
-
-    classesToMatch = IOServiceMatching(kIOSerialBSDServiceValue);
-    if (classesToMatch == NULL)
-        NSLog(@"IOServiceMatching returned a NULL dictionary.\n");
-    else {
-        CFDictionarySetValue(classesToMatch,
-                    CFSTR(kIOSerialBSDTypeKey),
-                    CFSTR(kIOSerialBSDRS232Type));
-    }
-
-    kernResult = IOServiceGetMatchingServices(masterPort, classesToMatch, &matchingServices);    
-    
-    if (KERN_SUCCESS != kernResult)
-        NSLog(@"IOServiceGetMatchingServices returned %d\n", kernResult);
+		return kernResult;
+	}
+	
+	notifyPort = IONotificationPortCreate(masterPort);
+	CFRunLoopAddSource(CFRunLoopGetCurrent(),
+						IONotificationPortGetRunLoopSource(notifyPort),
+						kCFRunLoopDefaultMode);
 	
 	//empty old array
 	[PortnamesArray removeAllObjects];
 	
-	//get human readable names and devices paths of all ports
-    IOIteratorReset(matchingServices);
+	//each call consumes one reference of the matching dictionary
+	classesToMatch = PortnamesMatching();
+	kernResult = IOServiceAddMatchingNotification(notifyPort, kIOFirstMatchNotification,
+													classesToMatch, PortnamesServicesAdded,
+													self, &addedIterator);
+    if (KERN_SUCCESS != kernResult)
+        NSLog(@"IOServiceAddMatchingNotification(first match) returned %d\n", kernResult);
 	
-	if (KERN_SUCCESS != kernResult)
-		return kernResult;
+	classesToMatch = PortnamesMatching();
+	kernResult = IOServiceAddMatchingNotification(notifyPort, kIOTerminatedNotification,
+													classesToMatch, PortnamesServicesRemoved,
+													self, &removedIterator);
+    if (KERN_SUCCESS != kernResult)
+        NSLog(@"IOServiceAddMatchingNotification(terminated) returned %d\n", kernResult);
 	
-    while (serPortService = IOIteratorNext(matchingServices))
-    {		
-		kernResult = IORegistryEntryCreateCFProperties(serPortService,
-														&PortProperties,
-														kCFAllocatorDefault,
-														kNilOptions);
-														
-		if (KERN_SUCCESS != kernResult)
-			NSLog(@"IORegistryEntryCreateCFProperties returned %d\n", kernResult);
-		
-		[PortnamesArray addObject:(NSDictionary *)PortProperties];
-    }
-
-	IOObjectRelease(matchingServices);	// Release the iterator.
+	//draining the iterators lists the present ports and arms the notifications
+	[self servicesAdded:addedIterator];
+	[self servicesRemoved:removedIterator];
+	notificationsArmed = YES;
 	
 	return kernResult;
 }
 
+- stopNotifications
+{
+	if (addedIterator) IOObjectRelease(addedIterator);
+	if (removedIterator) IOObjectRelease(removedIterator);
+	addedIterator = removedIterator = 0;
+	
+	if (notifyPort != NULL) {
+		CFRunLoopRemoveSource(CFRunLoopGetCurrent(),
+								IONotificationPortGetRunLoopSource(notifyPort),
+								kCFRunLoopDefaultMode);
+		IONotificationPortDestroy(notifyPort);
+		notifyPort = NULL;
+	}
+	
+	notificationsArmed = NO;
+	return self;
+}
+
+- setDelegate:(id)anObject
+{
+	delegate = anObject;
+	return self;
+}
+
+- (int)indexOfDevicePath:(NSString*)devicePath
+{
+	int index;
+	
+	for (index = 0; index < (int)[PortnamesArray count]; index++)
+		if ([devicePath isEqualToString:[self getDevicePathFromMenuitem:index]])
+			return index;
+	
+	return -1;
+}
+
 -(void)fillMenu:(id)thePopUp
 {
 	//key:	kIOTTYDeviceKey for	Port-Name
@@ -150,7 +212,70 @@
 - (NSString*)getDevicePathFromMenuitem:(int)anInt
 {
 	//key:	kIOCalloutDeviceKey	for BSD path
+	if ((anInt < 0) || (anInt >= (int)[PortnamesArray count]))
+		return nil;
+	
 	return [[PortnamesArray objectAtIndex:anInt] objectForKey:(id)CFSTR(kIOCalloutDeviceKey)];
 }
 
 @end
+
+@implementation PortnamesObject (Notifications)
+
+- (void)servicesAdded:(io_iterator_t)iterator
+{
+	io_object_t		serPortService;
+	CFTypeRef		ttyName, calloutPath;
+	
+	//cache the two properties used, instead of copying all of them
+    while (serPortService = IOIteratorNext(iterator))
+    {
+		ttyName = IORegistryEntryCreateCFProperty(serPortService, CFSTR(kIOTTYDeviceKey),
+													kCFAllocatorDefault, 0);
+		calloutPath = IORegistryEntryCreateCFProperty(serPortService, CFSTR(kIOCalloutDeviceKey),
+													kCFAllocatorDefault, 0);
+		IOObjectRelease(serPortService);
+		
+		if ((ttyName != NULL) && (calloutPath != NULL)
+		&&  ([self indexOfDevicePath:(NSString *)calloutPath] < 0))
+		{
+			[PortnamesArray addObject:[NSDictionary dictionaryWithObjectsAndKeys:
+										(id)ttyName,		(id)CFSTR(kIOTTYDeviceKey),
+										(id)calloutPath,	(id)CFSTR(kIOCalloutDeviceKey),
+										nil]];
+			
+			if (notificationsArmed && [delegate respondsToSelector:@selector(portnamesAdded:)])
+				[delegate portnamesAdded:(NSString *)calloutPath];
+		}
+		
+		if (ttyName != NULL) CFRelease(ttyName);
+		if (calloutPath != NULL) CFRelease(calloutPath);
+    }
+}
+
+- (void)servicesRemoved:(io_iterator_t)iterator
+{
+	io_object_t		serPortService;
+	NSString		*devicePath;
+	struct stat		nodeInfo;
+	int				index;
+	
+	//the iterator has to be drained to rearm the notification
+    while (serPortService = IOIteratorNext(iterator))
+		IOObjectRelease(serPortService);
+	
+	//a terminated service may have lost its properties: drop every port whose node is gone
+	for (index = (int)[PortnamesArray count] - 1; index >= 0; index--)
+	{
+		devicePath = [[[self getDevicePathFromMenuitem:index] retain] autorelease];
+		if (stat([devicePath fileSystemRepresentation], &nodeInfo) == 0)
+			continue;
+		
+		[PortnamesArray removeObjectAtIndex:index];
+		
+		if (notificationsArmed && [delegate respondsToSelector:@selector(portnamesRemoved:)])
+			[delegate portnamesRemoved:devicePath];
+	}
+}
+
+@end
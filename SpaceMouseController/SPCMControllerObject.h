@@ -76,4 +76,8 @@
 - (void) UpdateSensitivities:(id)sender;
 - (void) UpdateNullRadius:(id)sender;
 
+//PortnamesObject delegate
+- (void) portnamesAdded:(NSString *)devicePath;
+- (void) portnamesRemoved:(NSString *)devicePath;
+
 @end
@@ -64,6 +64,7 @@
 	
 	//create List of serial ports
 	thePorts = [[PortnamesObject alloc] init];
+	[thePorts setDelegate:self];
 	[thePorts buildPortnamesArray];
 	
 	[thePorts fillMenu:portMenu];
@@ -186,4 +187,37 @@
 	[zerRadOut setIntValue:[sender nullRad]];
 }
 
+//menu indices shift when ports come and go; keep the mouse's port selected by its path
+- (void) refillPortMenu
+{
+	int index;
+	
+	[thePorts fillMenu:portMenu];
+	
+	index = [thePorts indexOfDevicePath:[theMouse devPathString]];
+	if (index >= 0)
+	{
+		[theMouse SetSelectedPortItem:index];
+		[portMenu selectItemAtIndex:index];
+	}
+}
+
+- (void) portnamesAdded:(NSString *)devicePath
+{
+	[self refillPortMenu];
+	
+	//the mouse's port is back: reconnect
+	if (![theMouse isConnected] && [devicePath isEqualToString:[theMouse devPathString]])
+		[theMouse connectToDevice];
+}
+
+- (void) portnamesRemoved:(NSString *)devicePath
+{
+	//the mouse's port is gone: release it and decommission the controller
+	if ([theMouse isConnected] && [devicePath isEqualToString:[theMouse devPathString]])
+		[theMouse deviceRemoved];
+	
+	[self refillPortMenu];
+}
+
 @end
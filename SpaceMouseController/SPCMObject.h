@@ -6,7 +6,7 @@
 		communicating to and from a Logitech Spacemouse (Magellan; grey modell; RS232 
 		connection) under MacOS X.
 		Following is modelled:
-		- object holds: used serial port and its NSFileHandle
+		- object holds: used serial port, its reader thread and the delivery thread
 		- object holds: multipliers for rot and trans and
 		decoded device state
 		- Preferences
@@ -51,14 +51,19 @@
 
 //needed for the termios-struct in SPCMObject.h:
 #include <termios.h>		
+#include <pthread.h>
+#include <mach/mach.h>
 
 #import <Cocoa/Cocoa.h>
 
+#include "MagellanParser.h"
+#include "SPCMSampleQueue.h"
+
 @class SPCMdeliverQuesa;
 
 @interface SPCMObject : NSObject
 {
-    //holds used serial port and its NSFileHandle
+    //holds used serial port and its reader thread
     //holds multipliers for rot and trans
     //holds decoded device state
 	
@@ -71,13 +76,22 @@
 	//serial port
     struct 	termios 	gOriginalTTYAttrs;
     int 	portDescriptor;
-	id		port;
+	
+	//reader thread: polls the port, decodes in place and queues the replies;
+	//delivery thread: hands them to Quesa and reports state changes to the UI
+	pthread_t			readerThread;
+	pthread_t			deliveryThread;
+	int					wakePipe[2];		//ends the reader's select on disconnect
+	semaphore_t			deliverySemaphore;	//signalled by the reader per decoded batch
+	semaphore_t			syncSemaphore;		//signalled by the delivery thread per zero echo
+	volatile BOOL		threadsRunning;
+	TSPCMSampleQueue	sampleQueue;
 	
 	SPCMdeliverQuesa *QuesaConnection;	//Connection to Quesa; holds ControllerRef	
 				
 	NSString *devPathString;
 	
-	NSMutableString *inEvents;
+	TMagellanParser	parser;		//incremental decoder of device replies
 	
 	NSUserDefaults *prefs;
 	
@@ -92,6 +106,15 @@
     int		rotQuality;
     int		transQuality;
     int		nullRad;
+	int		readerPriority;		//SCHED_RR priority of both threads; 0 keeps the default
+	float	deliveryRate;		//Hz motion is flushed to Quesa at; 0 delivers every sample
+	
+	//device data rate follows the demand of the controller's clients
+	BOOL	adaptDataRate;
+	NSTimer	*demandTimer;
+	int		idlePolls;			//consecutive demand polls without any consumer
+	int		deviceMinRate;		//last rates sent with setDataRateMin:andMax:
+	int		deviceMaxRate;
 	
 	float	rotScale;
     float	transScale;
@@ -113,11 +136,19 @@
 - (BOOL)connectToDevice;
 - disconnectFromDevice;
 - (BOOL)isConnected;
+- deviceRemoved;
 
 // communication
-- processNotificationData:(NSData *)notificationData;
 - transmitChars: (const char *)buffer length: (int)length;
 
+- setReaderPriority:(int)anInt;
+- (int)readerPriority;
+- setDeliveryRate:(float)aFloat;
+- (float)deliveryRate;
+- setAdaptDataRate:(BOOL)aBool;
+- (BOOL)adaptDataRate;
+- adaptToDemand:(NSTimer *)aTimer;
+
 // The following are SpaceMouse specific methods. They are used to parse the
 // data and to set the mouse states.
 // accessors
@@ -147,13 +178,15 @@
 - setNullRad:(int)anInt;
 - beepFor:(int)anInt;	
 
+- syncDevice;
 - zeroMouse;
 
-- doEvent:(const char *)buffer;
-- doModeEvent:(const char *)buffer;
-- doQualityEvent:(const char *)buffer;
-- doNullRadiusEvent:(const char *)buffer;
-- doKeyEvent:(const char *)buffer;
-- doTransformationEvent:(const char *)buffer;
+- doEvent:(const TMagellanEvent *)event;
+- doModeEvent:(const TMagellanEvent *)event;
+- doQualityEvent:(const TMagellanEvent *)event;
+- doNullRadiusEvent:(const TMagellanEvent *)event;
+- doZeroEvent:(const TMagellanEvent *)event;
+- doKeyEvent:(const TMagellanEvent *)event;
+- doTransformationEvent:(const TMagellanEvent *)event;
 
 @end
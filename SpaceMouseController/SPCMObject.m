@@ -6,7 +6,7 @@
 		communicating to and from a Logitech Spacemouse (Magellan; grey modell; RS232 
 		connection) under MacOS X.
 		Following is modelled:
-		- object holds used serial port and its NSFileHandle
+		- object holds used serial port, its reader thread and the delivery thread
 		- object holds multipliers for rot and trans and decoded device state
 		- Preferences
 		- communication and parsing of device replies
@@ -50,25 +50,64 @@
 
 #include <fcntl.h>
 #include <unistd.h>
+#include <sys/select.h>
 
 #import "SPCMObject.h"
 #import "SPCMdeliverQuesa.h"
 
-static SInt8 CharToNibble(char ch)
+//the device rate is revised at kSPCMDemandPeriod; it drops to the slowest rate
+//only after kSPCMIdlePolls revisions without demand, so short pauses are bridged
+#define kSPCMDemandPeriod	1.0
+#define kSPCMIdlePolls		3
+
+//Magellan rate codes: period = (code+1)*20ms
+#define kSPCMFastRate		2
+#define kSPCMDefaultMaxRate	8
+#define kSPCMSlowRate		15
+
+//the sync is repeated until the device echoes it; without an echo the
+//connect goes on after kSPCMSyncRetries, as after the old fixed sleeps
+#define kSPCMSyncRetry		200000000	//ns
+#define kSPCMSyncRetries	10
+
+@interface SPCMObject (Threads)
+- (BOOL)startThreads;
+- stopThreads;
+- readerLoop;
+- deliveryLoop;
+- (void)noteCocoaThreading:(id)anObject;
+@end
+
+//queues each decoded reply of the parser for the delivery thread
+static void SPCMObjectQueueProc(const TMagellanEvent *event, void *refCon)
 {
-	return(ch&0x0F);
+	SPCMSampleQueue_Push((TSPCMSampleQueue *)refCon, event);
 }
 
-SInt16 FourCharsToVal(char a3,char a2,char a1,char a0)
+static void SPCMObjectSetPriority(int priority)
 {
-	return ((4096*(a3&0x0F)
-	         +256*(a2&0x0F)
-	          +16*(a1&0x0F)
-	             +(a0&0x0F))-32768);	
+	struct sched_param	param;
+	int					policy;
+	
+	//0 keeps the default policy
+	if(priority<=0) return;
+	
+	if(pthread_getschedparam(pthread_self(), &policy, &param)!=0) return;
+	param.sched_priority=priority;
+	pthread_setschedparam(pthread_self(), SCHED_RR, &param);
 }
 
-static char NibbleToCharTable[] =
-	{0x30,0x41,0x42,0x33,0x44,0x35,0x36,0x47,0x48,0x39,0x3a,0x4b,0x3c,0x4d,0x4e,0x3f};
+static void *SPCMObjectReaderThread(void *refCon)
+{
+	[(SPCMObject *)refCon readerLoop];
+	return NULL;
+}
+
+static void *SPCMObjectDeliveryThread(void *refCon)
+{
+	[(SPCMObject *)refCon deliveryLoop];
+	return NULL;
+}
 
 @implementation SPCMObject
 
@@ -81,7 +120,8 @@ static char NibbleToCharTable[] =
 	// Ok, we did pass the risky point. So lets do our default settings.
 	
 	devPathString = [[NSString alloc] init];
-	inEvents = [[NSMutableString alloc ] init];
+	MagellanParser_Init(&parser);
+	SPCMSampleQueue_Init(&sampleQueue);
 	QuesaConnection = [[SPCMdeliverQuesa alloc] init];
 	
 	portDescriptor=-1;
@@ -96,7 +136,6 @@ static char NibbleToCharTable[] =
     //Destructor
     
 	[devPathString release];
-	[inEvents release];
 	[self disconnectFromDevice];
 	
     //write current setting to prefs
@@ -124,6 +163,9 @@ static char NibbleToCharTable[] =
 	[defaultPrefs setObject: [NSNumber numberWithInt:4] forKey:@"rotationQuality"];
 	[defaultPrefs setObject: [NSNumber numberWithInt:2] forKey:@"translationQuality"];
 	[defaultPrefs setObject: [NSNumber numberWithInt:15] forKey:@"nullRadius"];
+	[defaultPrefs setObject: [NSNumber numberWithInt:40] forKey:@"readerPriority"];
+	[defaultPrefs setObject: [NSNumber numberWithFloat:60.0] forKey:@"deliveryRate"];
+	[defaultPrefs setObject: [NSNumber numberWithBool:YES] forKey:@"adaptDataRate"];
 	
 	[defaultPrefs setObject: [NSNumber numberWithFloat:10.0] forKey:@"rotScale"];
 	[defaultPrefs setObject: [NSNumber numberWithFloat:3.0] forKey:@"transScale"];
@@ -140,9 +182,12 @@ static char NibbleToCharTable[] =
 	rotQuality = [prefs integerForKey:@"rotationQuality"];
 	transQuality = [prefs integerForKey:@"translationQuality"];
 	nullRad = [prefs integerForKey:@"nullRadius"];
+	readerPriority = [prefs integerForKey:@"readerPriority"];
+	adaptDataRate = [prefs boolForKey:@"adaptDataRate"];
 		
 	[self setRotScale:[prefs floatForKey:@"rotScale"]];
 	[self setTransScale:[prefs floatForKey:@"transScale"]];
+	[self setDeliveryRate:[prefs floatForKey:@"deliveryRate"]];
 	
 	return self;
 }
@@ -158,9 +203,12 @@ static char NibbleToCharTable[] =
 	[prefs setInteger:rotQuality forKey:@"rotationQuality"];
 	[prefs setInteger:transQuality forKey:@"translationQuality"];
 	[prefs setInteger:nullRad forKey:@"nullRadius"];
+	[prefs setInteger:readerPriority forKey:@"readerPriority"];
 	
 	[prefs setFloat:rotScale forKey:@"rotScale"];
 	[prefs setFloat:transScale forKey:@"transScale"];
+	[prefs setFloat:deliveryRate forKey:@"deliveryRate"];
+	[prefs setBool:adaptDataRate forKey:@"adaptDataRate"];
 	
 	//write values to file!
 	[prefs synchronize];
@@ -265,24 +313,22 @@ static char NibbleToCharTable[] =
 		goto error;
 	}
 
-	// Success
-	sleep(1);
-		
-	//create NSFileHandle from portDescriptor
-	port = [[NSFileHandle alloc] initWithFileDescriptor:portDescriptor];
-	
-	[[NSNotificationCenter defaultCenter] addObserver:self
-		selector:@selector(dataFromMouse:)
-		name:NSFileHandleReadCompletionNotification
-		object:port];
+	//replies are read and delivered off the main run loop
+	if (![self startThreads])
+	{
+		NSLog(@"Error starting reader thread %@ - %s(%d).\n",
+			devPathString, strerror(errno), errno);
+		tcsetattr(portDescriptor, TCSANOW, &gOriginalTTYAttrs);
+		goto error;
+	}
 	
-	[port readInBackgroundAndNotify];
+	//a controller decommissioned by deviceRemoved is taken up again
+	[QuesaConnection commission];
 	
 	// The first direct write is just to set the mouse to 9600 Baud.
 	// Then we will set every value to a default. This way all our values
 	// get initialized.
-	[self transmitChars:"z\r\r" length:3];
-	sleep(1);
+	[self syncDevice];
 	
 	[self zeroMouse];
 	//transmit last settings
@@ -292,11 +338,20 @@ static char NibbleToCharTable[] =
 	
 	[self setTransQual:transQuality 
 			andRotQual:rotQuality];
-	[self setDataRateMin:2 andMax:8];
+	//full rate until the first demand poll says otherwise
+	[self setDataRateMin:kSPCMFastRate andMax:kSPCMDefaultMaxRate];
 	[self setNullRad:nullRad];
 	
 	[self beepFor:4];
 	
+	idlePolls=0;
+	if(adaptDataRate && (demandTimer==nil))
+		demandTimer=[[NSTimer scheduledTimerWithTimeInterval:kSPCMDemandPeriod
+													  target:self
+													selector:@selector(adaptToDemand:)
+													userInfo:nil
+													 repeats:YES] retain];
+	
 	return TRUE;
 	
 	// Failure path
@@ -311,14 +366,15 @@ error:
 
 - disconnectFromDevice
 {
+	//the timer retains self; it has to go before dealloc can happen
+	[demandTimer invalidate];
+	[demandTimer release];
+	demandTimer=nil;
+	
 	if([self isConnected])
 	{
-		//Notification is off!
-		[[NSNotificationCenter defaultCenter] removeObserver:self];
-		
-		//close port and handle!!!
-		[port closeFile];
-		[port release];
+		//reader and delivery are off!
+		[self stopThreads];
 		
 		//write back gOriginalTTYAttrs!
 		tcsetattr(portDescriptor, TCSANOW, &gOriginalTTYAttrs);
@@ -328,6 +384,13 @@ error:
 	return self;
 }
 
+- deviceRemoved
+{
+	[self disconnectFromDevice];
+	[QuesaConnection decommission];
+	return self;
+}
+
 - (BOOL)isConnected
 {
 	if(portDescriptor!=-1) 
@@ -342,50 +405,83 @@ error:
 	return self;
 }
 
-- (void)dataFromMouse:(NSNotification *)notification
+- setReaderPriority:(int)anInt
 {
-    NSData *SPCMEvent=[[notification userInfo] 
-        objectForKey:@"NSFileHandleNotificationDataItem"];
-	    
-	[self processNotificationData:SPCMEvent];
-    
-    //restart reading
-    [port readInBackgroundAndNotify];
-} 
+	//takes effect with the next connect
+	if(anInt < 0)	anInt=0;
+	if(anInt > 47)	anInt=47;
+	
+	readerPriority=anInt;
+	return self;
+}
 
-- processNotificationData:(NSData *)notificationData
+- (int)readerPriority
 {
-	NSString		*notifString;
-	NSCharacterSet	*crSet;
-    NSScanner		*inScanner;
-	NSString		*anEvent;
-	NSRange			crRange, cuttingRange;
-    
-	//convert notification data to notification string
-	notifString=[[NSString alloc] initWithData:notificationData encoding:NSASCIIStringEncoding];
-	//append notification string to event string
-	[inEvents appendString:notifString];
-	[notifString release];
-	//setup scanner
-	crSet=[NSCharacterSet characterSetWithCharactersInString:@"\r"];
-	inScanner=[NSScanner scannerWithString:inEvents];
-	//search for \r (CR) in event string -- quick 'n' dirty: at end of inEvents
-	crRange = [inEvents rangeOfCharacterFromSet:crSet];
-	if (crRange.location != NSNotFound){
-		//do bookkeeping for later character deletion
-		cuttingRange.location=[inScanner scanLocation];
-		//scan ...
-		while ([inScanner isAtEnd] == NO) {
-			if ([inScanner scanUpToCharactersFromSet:crSet intoString:&anEvent]) {
-				//... and parse
-				[self doEvent:[anEvent cStringUsingEncoding:NSASCIIStringEncoding]];
-				//do bookkeeping for later character deletion
-				cuttingRange.length=[inScanner scanLocation]+1;
-			}
-		}
-		//remove found events from event string
-		[inEvents deleteCharactersInRange:cuttingRange];
+	return readerPriority;
+}
+
+- setDeliveryRate:(float)aFloat
+{
+	if(aFloat < 0.0f) aFloat=0.0f;
+	
+	deliveryRate=aFloat;
+	[QuesaConnection setFlushRate:deliveryRate];
+	return self;
+}
+
+- (float)deliveryRate
+{
+	return deliveryRate;
+}
+
+- setAdaptDataRate:(BOOL)aBool
+{
+	//takes effect with the next connect; a fixed rate is the full rate
+	adaptDataRate=aBool;
+	return self;
+}
+
+- (BOOL)adaptDataRate
+{
+	return adaptDataRate;
+}
+
+/*
+	Subscribers (a tracker or a client waiting for values) take every sample,
+	so the device runs at full rate. Polling clients get a minimum period close
+	to their poll interval. Without any consumer the device drops to its slowest
+	rate, which still lets the first motion after a pause through.
+*/
+- adaptToDemand:(NSTimer *)aTimer
+{
+	BOOL	hasSubscribers;
+	float	consumerRate;
+	int		minRate,maxRate;
+	
+	if(![self isConnected]) return self;
+	
+	//keep the current rate while the server can't tell
+	if(![QuesaConnection getConsumerState:&hasSubscribers rate:&consumerRate]) return self;
+	
+	if(hasSubscribers || (consumerRate>0.0f))
+	{
+		idlePolls=0;
+		minRate=kSPCMFastRate;
+		if(!hasSubscribers)
+			minRate=(int)(1000.0f/(consumerRate*20.0f))-1;
+		if(minRate<kSPCMFastRate)	minRate=kSPCMFastRate;
+		if(minRate>kSPCMSlowRate)	minRate=kSPCMSlowRate;
+		maxRate=(minRate>kSPCMDefaultMaxRate) ? minRate : kSPCMDefaultMaxRate;
 	}
+	else
+	{
+		if(idlePolls<kSPCMIdlePolls) idlePolls++;
+		if(idlePolls<kSPCMIdlePolls) return self;
+		minRate=maxRate=kSPCMSlowRate;
+	}
+	
+	if((minRate!=deviceMinRate) || (maxRate!=deviceMaxRate))
+		[self setDataRateMin:minRate andMax:maxRate];
 	return self;
 }
 
@@ -400,7 +496,7 @@ error:
 	domModeOn	=domFlag;
 	
 	serSendBuffer[0]='m';
-	serSendBuffer[1]=NibbleToCharTable[rotFlag*1 + transFlag*2 + domFlag*4];
+	serSendBuffer[1]=MagellanParser_NibbleToChar(rotFlag*1 + transFlag*2 + domFlag*4);
 	serSendBuffer[2]='\r';
 	
 	// We don't need to ask for the result here. The mouse echos the setting.
@@ -437,8 +533,8 @@ error:
 	transQuality=transInt;
 	
 	serSendBuffer[0]='q';
-	serSendBuffer[1]=NibbleToCharTable[transInt];
-	serSendBuffer[2]=NibbleToCharTable[rotInt];
+	serSendBuffer[1]=MagellanParser_NibbleToChar(transInt);
+	serSendBuffer[2]=MagellanParser_NibbleToChar(rotInt);
 	serSendBuffer[3]='\r';
 	
 	[self transmitChars:serSendBuffer length:4];
@@ -465,7 +561,7 @@ error:
 	nullRad=anInt;
 	
 	serSendBuffer[0]='n';
-	serSendBuffer[1]=NibbleToCharTable[anInt];
+	serSendBuffer[1]=MagellanParser_NibbleToChar(anInt);
 	serSendBuffer[2]='\r';
 	
 	[self transmitChars:serSendBuffer length:3];
@@ -493,9 +589,12 @@ error:
 	if(minRate > maxRate) minRate=maxRate;
 	if(maxRate < minRate) maxRate=minRate;
 	
+	deviceMinRate=minRate;
+	deviceMaxRate=maxRate;
+	
 	serSendBuffer[0]='p';
-	serSendBuffer[1]=NibbleToCharTable[maxRate];
-	serSendBuffer[2]=NibbleToCharTable[minRate];
+	serSendBuffer[1]=MagellanParser_NibbleToChar(maxRate);
+	serSendBuffer[2]=MagellanParser_NibbleToChar(minRate);
 	serSendBuffer[3]='\r';
 	
 	[self transmitChars:serSendBuffer length:4];
@@ -552,40 +651,67 @@ error:
 	if(anInt > 7) anInt=7;
 	
 	serSendBuffer[0]='b';
-	serSendBuffer[1]=NibbleToCharTable[anInt + 7];
+	serSendBuffer[1]=MagellanParser_NibbleToChar(anInt + 7);
 	serSendBuffer[2]='\r';
 	
 	[self transmitChars:serSendBuffer length:3];
 	return self;
 }
 
+/*
+	Sends the sync until the device echoes it, i.e. until it is powered up and
+	listening; usually the first echo is there after a few ms. The echo comes
+	through doZeroEvent: on the delivery thread.
+*/
+- syncDevice
+{
+	mach_timespec_t	retryWait;
+	int				retries;
+	
+	retryWait.tv_sec=0;
+	retryWait.tv_nsec=kSPCMSyncRetry;
+	
+	for(retries=0; retries<kSPCMSyncRetries; retries++)
+	{
+		[self transmitChars:"z\r\r" length:3];
+		if(semaphore_timedwait(syncSemaphore, retryWait)==KERN_SUCCESS)
+			break;
+	}
+	return self;
+}
+
 - zeroMouse
 {
 	[self transmitChars:"z\r" length:2];
 	return self;
 }
 
-- doEvent:(const char *)buffer
+- doEvent:(const TMagellanEvent *)event
 {
-	if(buffer!=NULL)
+	if(event!=NULL)
 	{
-		if(buffer[0] == 'd') [self doTransformationEvent:buffer];
-		if(buffer[0] == 'k') [self doKeyEvent:buffer];
-		if(buffer[0] == 'n') [self doNullRadiusEvent:buffer];
-		if(buffer[0] == 'q') [self doQualityEvent:buffer];
-//		if(buffer[0] == 'p') [self doDataRateEvent:buffer];
-//		if(buffer[0] == 'e') [self doErrorEvent:buffer];
-//		if(buffer[0] == 'v') [self doVersionEvent:buffer];
-		if(buffer[0] == 'm') [self doModeEvent:buffer];
+		switch(event->type)
+		{
+			case kMagellanEventMotion:		[self doTransformationEvent:event];	break;
+			case kMagellanEventKeys:		[self doKeyEvent:event];			break;
+			case kMagellanEventNullRadius:	[self doNullRadiusEvent:event];		break;
+			case kMagellanEventQuality:		[self doQualityEvent:event];		break;
+			case kMagellanEventMode:		[self doModeEvent:event];			break;
+			case kMagellanEventZero:		[self doZeroEvent:event];			break;
+//			case kMagellanEventDataRate:	[self doDataRateEvent:event];		break;
+//			case kMagellanEventError:		[self doErrorEvent:event];			break;
+//			case kMagellanEventVersion:		[self doVersionEvent:event];		break;
+			default:														break;
+		}
 	}
 	return self;
 }
 
-- doModeEvent:(const char *)buffer
+- doModeEvent:(const TMagellanEvent *)event
 {
 	int	mode;
 	
-	mode = CharToNibble(buffer[1]);
+	mode = event->mode;
 	
 	if(mode&0x01)
 			rotOn=YES;
@@ -599,51 +725,53 @@ error:
 			domModeOn=YES;
 	else	domModeOn=NO;
         
-	[frontend UpdateModes:self];        
+	[frontend performSelectorOnMainThread:@selector(UpdateModes:) withObject:self waitUntilDone:NO];        
 	return self;
 }
 
-- doQualityEvent:(const char *)buffer
+- doQualityEvent:(const TMagellanEvent *)event
 {
-	transQuality=CharToNibble(buffer[1]);
-	rotQuality=CharToNibble(buffer[2]);
+	transQuality=event->transQuality;
+	rotQuality=event->rotQuality;
 	
-	[frontend UpdateSensitivities:self];
+	[frontend performSelectorOnMainThread:@selector(UpdateSensitivities:) withObject:self waitUntilDone:NO];
 	return self;
 }
 
-- doNullRadiusEvent:(const char *)buffer
+- doNullRadiusEvent:(const TMagellanEvent *)event
 {
-	nullRad=CharToNibble(buffer[1]);
+	nullRad=event->nullRadius;
 	
-	[frontend UpdateNullRadius:self];
+	[frontend performSelectorOnMainThread:@selector(UpdateNullRadius:) withObject:self waitUntilDone:NO];
 	return self;
 }
 
-- doKeyEvent:(const char *)buffer
+- doZeroEvent:(const TMagellanEvent *)event
 {
-	int keys;
-	
-	keys =256*CharToNibble(buffer[3]);
-	keys+=16 *CharToNibble(buffer[2]);
-	keys+=    CharToNibble(buffer[1]);
-	
-	[QuesaConnection deliverKeyPress:keys];
+	//wakes syncDevice; later echoes only raise a count nobody waits for
+	semaphore_signal(syncSemaphore);
+	return self;
+}
+
+- doKeyEvent:(const TMagellanEvent *)event
+{
+	[QuesaConnection deliverKeyPress:event->keys];
 	
 	return self;
 }
 
-- doTransformationEvent:(const char *)buffer
+- doTransformationEvent:(const TMagellanEvent *)event
 {
 	float	x, y, z, a, b, c;
 	
-	x=transMult*FourCharsToVal(buffer[0*4+1],buffer[0*4+2],buffer[0*4+3],buffer[0*4+4]);
-	y=transMult*FourCharsToVal(buffer[1*4+1],buffer[1*4+2],buffer[1*4+3],buffer[1*4+4]);
-	z=transMult*FourCharsToVal(buffer[2*4+1],buffer[2*4+2],buffer[2*4+3],buffer[2*4+4]);
+	//axes are decoded by the parser, all six at once
+	x=transMult*event->axes[0];
+	y=transMult*event->axes[1];
+	z=transMult*event->axes[2];
 	
-	a=rotMult*FourCharsToVal(buffer[3*4+1],buffer[3*4+2],buffer[3*4+3],buffer[3*4+4]);
-	b=rotMult*FourCharsToVal(buffer[4*4+1],buffer[4*4+2],buffer[4*4+3],buffer[4*4+4]);
-	c=rotMult*FourCharsToVal(buffer[5*4+1],buffer[5*4+2],buffer[5*4+3],buffer[5*4+4]);
+	a=rotMult*event->axes[3];
+	b=rotMult*event->axes[4];
+	c=rotMult*event->axes[5];
 		
 	[QuesaConnection deliverTranslation:x :y :z andRotation:a :b :c];
 
@@ -651,3 +779,159 @@ error:
 }
 
 @end
+
+@implementation SPCMObject (Threads)
+
+- (BOOL)startThreads
+{
+	if(![NSThread isMultiThreaded])
+		[NSThread detachNewThreadSelector:@selector(noteCocoaThreading:) toTarget:self withObject:nil];
+	
+	MagellanParser_Init(&parser);
+	SPCMSampleQueue_Init(&sampleQueue);
+	
+	if(pipe(wakePipe)!=0)
+		return NO;
+	
+	if(semaphore_create(mach_task_self(), &deliverySemaphore, SYNC_POLICY_FIFO, 0)!=KERN_SUCCESS)
+	{
+		close(wakePipe[0]);
+		close(wakePipe[1]);
+		return NO;
+	}
+	
+	if(semaphore_create(mach_task_self(), &syncSemaphore, SYNC_POLICY_FIFO, 0)!=KERN_SUCCESS)
+	{
+		semaphore_destroy(mach_task_self(), deliverySemaphore);
+		close(wakePipe[0]);
+		close(wakePipe[1]);
+		return NO;
+	}
+	
+	threadsRunning=YES;
+	
+	if(pthread_create(&deliveryThread, NULL, SPCMObjectDeliveryThread, self)!=0)
+		goto error;
+	
+	if(pthread_create(&readerThread, NULL, SPCMObjectReaderThread, self)!=0)
+	{
+		threadsRunning=NO;
+		semaphore_signal(deliverySemaphore);
+		pthread_join(deliveryThread, NULL);
+		goto error;
+	}
+	
+	return YES;
+	
+error:
+	threadsRunning=NO;
+	semaphore_destroy(mach_task_self(), deliverySemaphore);
+	semaphore_destroy(mach_task_self(), syncSemaphore);
+	close(wakePipe[0]);
+	close(wakePipe[1]);
+	return NO;
+}
+
+- stopThreads
+{
+	threadsRunning=NO;
+	
+	write(wakePipe[1], "", 1);
+	pthread_join(readerThread, NULL);
+	
+	semaphore_signal(deliverySemaphore);
+	pthread_join(deliveryThread, NULL);
+	
+	semaphore_destroy(mach_task_self(), deliverySemaphore);
+	semaphore_destroy(mach_task_self(), syncSemaphore);
+	close(wakePipe[0]);
+	close(wakePipe[1]);
+	return self;
+}
+
+//select rather than poll: poll does not handle tty devices on Mac OS X
+- readerLoop
+{
+	fd_set		readSet;
+	int			maxDescriptor;
+	uint8_t		*buffer;
+	uint32_t	freeSize;
+	ssize_t		byteCount;
+	
+	SPCMObjectSetPriority(readerPriority);
+	
+	maxDescriptor = (portDescriptor > wakePipe[0]) ? portDescriptor : wakePipe[0];
+	
+	while(threadsRunning)
+	{
+		FD_ZERO(&readSet);
+		FD_SET(portDescriptor, &readSet);
+		FD_SET(wakePipe[0], &readSet);
+		
+		if(select(maxDescriptor+1, &readSet, NULL, NULL, NULL)<0)
+		{
+			if(errno==EINTR) continue;
+			break;
+		}
+		
+		if(FD_ISSET(wakePipe[0], &readSet))
+			break;
+		
+		//read straight into the parser's ring; replies are decoded in place
+		buffer=MagellanParser_WriteBuffer(&parser, &freeSize);
+		byteCount=read(portDescriptor, buffer, freeSize);
+		if(byteCount<=0)
+		{
+			if((byteCount<0) && (errno==EINTR)) continue;
+			break;
+		}
+		
+		MagellanParser_Commit(&parser, (uint32_t)byteCount);
+		if(MagellanParser_Parse(&parser, SPCMObjectQueueProc, &sampleQueue)>0)
+			semaphore_signal(deliverySemaphore);
+	}
+	return self;
+}
+
+- deliveryLoop
+{
+	TMagellanEvent		event;
+	NSAutoreleasePool	*pool;
+	mach_timespec_t		flushWait;
+	
+	SPCMObjectSetPriority(readerPriority);
+	
+	while(threadsRunning)
+	{
+		//coalesced motion must go out even if the device falls silent
+		if([QuesaConnection hasPendingMotion] && (deliveryRate>0.0f))
+		{
+			flushWait.tv_sec=0;
+			flushWait.tv_nsec=(clock_res_t)(1.0e9f/deliveryRate);
+			if(deliveryRate<1.0f)
+			{
+				flushWait.tv_sec=(unsigned int)(1.0f/deliveryRate);
+				flushWait.tv_nsec=0;
+			}
+			semaphore_timedwait(deliverySemaphore, flushWait);
+		}
+		else
+			semaphore_wait(deliverySemaphore);
+		
+		pool=[[NSAutoreleasePool alloc] init];
+		while(SPCMSampleQueue_Pop(&sampleQueue, &event))
+			[self doEvent:&event];
+		[QuesaConnection deliverPendingMotion:NO];
+		[pool release];
+	}
+	
+	[QuesaConnection deliverPendingMotion:YES];
+	return self;
+}
+
+//the first NSThread puts Cocoa into multithreaded mode, which the pthreads above rely on
+- (void)noteCocoaThreading:(id)anObject
+{
+}
+
+@end
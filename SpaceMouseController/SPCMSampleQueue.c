@@ -0,0 +1,136 @@
+/*  NAME:
+        SPCMSampleQueue.c
+
+    DESCRIPTION:
+        Lock-free single producer/single consumer queue of decoded SpaceMouse
+		replies, from the serial reader thread to the delivery thread.
+		
+		Each index is written by one side only. A barrier orders the copy of an
+		event before the index that publishes it, and the read of an event
+		before the index that releases its slot.
+      
+    COPYRIGHT:
+        Copyright (c) 1999-2005, Quesa Developers. All rights reserved.
+
+        For the current release of Quesa, please see:
+
+            <http://www.quesa.org/>
+        
+        Redistribution and use in source and binary forms, with or without
+        modification, are permitted provided that the following conditions
+        are met:
+        
+            o Redistributions of source code must retain the above copyright
+              notice, this list of conditions and the following disclaimer.
+        
+            o Redistributions in binary form must reproduce the above
+              copyright notice, this list of conditions and the following
+              disclaimer in the documentation and/or other materials provided
+              with the distribution.
+        
+            o Neither the name of Quesa nor the names of its contributors
+              may be used to endorse or promote products derived from this
+              software without specific prior written permission.
+        
+        THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+        "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+        LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+        A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+        OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+        SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+        TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+        PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+        LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+        NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+        SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+    ___________________________________________________________________________
+*/
+
+
+
+//=============================================================================
+//      Include files
+//-----------------------------------------------------------------------------
+#include "SPCMSampleQueue.h"
+
+#include <string.h>
+
+#if defined(__APPLE__)
+	#include <libkern/OSAtomic.h>
+	#define SPCMSampleQueue_Barrier()	OSMemoryBarrier()
+#else
+	#define SPCMSampleQueue_Barrier()	__sync_synchronize()
+#endif
+
+
+
+
+
+//=============================================================================
+//      Internal constants
+//-----------------------------------------------------------------------------
+#define kSPCMSampleQueueMask		(kSPCMSampleQueueSize-1)
+
+
+
+
+
+//=============================================================================
+//      Public functions
+//-----------------------------------------------------------------------------
+//      SPCMSampleQueue_Init : Empty the queue.
+//-----------------------------------------------------------------------------
+void
+SPCMSampleQueue_Init(TSPCMSampleQueue *queue)
+{
+	memset(queue, 0, sizeof(TSPCMSampleQueue));
+}
+
+
+
+//=============================================================================
+//      SPCMSampleQueue_Push : Append an event; producer only.
+//-----------------------------------------------------------------------------
+int
+SPCMSampleQueue_Push(TSPCMSampleQueue *queue, const TMagellanEvent *event)
+{
+	uint32_t		writeIndex = queue->writeIndex;
+	TMagellanEvent	*slot;
+	
+	if (writeIndex - queue->readIndex >= kSPCMSampleQueueSize)
+	{
+		queue->droppedCount++;
+		return(0);
+	}
+	
+	//the reply text lives in the parser's ring and is gone after the callback
+	slot = &queue->events[writeIndex & kSPCMSampleQueueMask];
+	*slot = *event;
+	slot->text			= NULL;
+	slot->textLength	= 0;
+	
+	SPCMSampleQueue_Barrier();
+	queue->writeIndex = writeIndex+1;
+	return(1);
+}
+
+
+
+//=============================================================================
+//      SPCMSampleQueue_Pop : Remove the oldest event; consumer only.
+//-----------------------------------------------------------------------------
+int
+SPCMSampleQueue_Pop(TSPCMSampleQueue *queue, TMagellanEvent *event)
+{
+	uint32_t	readIndex = queue->readIndex;
+	
+	if (readIndex == queue->writeIndex)
+		return(0);
+	
+	SPCMSampleQueue_Barrier();
+	*event = queue->events[readIndex & kSPCMSampleQueueMask];
+	
+	SPCMSampleQueue_Barrier();
+	queue->readIndex = readIndex+1;
+	return(1);
+}
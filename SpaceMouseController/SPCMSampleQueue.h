@@ -0,0 +1,95 @@
+/*  NAME:
+        SPCMSampleQueue.h
+
+    DESCRIPTION:
+        Lock-free single producer/single consumer queue of decoded SpaceMouse
+		replies, from the serial reader thread to the delivery thread.
+      
+    COPYRIGHT:
+        Copyright (c) 1999-2005, Quesa Developers. All rights reserved.
+
+        For the current release of Quesa, please see:
+
+            <http://www.quesa.org/>
+        
+        Redistribution and use in source and binary forms, with or without
+        modification, are permitted provided that the following conditions
+        are met:
+        
+            o Redistributions of source code must retain the above copyright
+              notice, this list of conditions and the following disclaimer.
+        
+            o Redistributions in binary form must reproduce the above
+              copyright notice, this list of conditions and the following
+              disclaimer in the documentation and/or other materials provided
+              with the distribution.
+        
+            o Neither the name of Quesa nor the names of its contributors
+              may be used to endorse or promote products derived from this
+              software without specific prior written permission.
+        
+        THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+        "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+        LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+        A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+        OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+        SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+        TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+        PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+        LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+        NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+        SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+    ___________________________________________________________________________
+*/
+
+
+
+
+
+#ifndef SPCMSampleQueue_HDR
+#define SPCMSampleQueue_HDR
+
+#include "MagellanParser.h"
+
+//=============================================================================
+//		C++ preamble
+//-----------------------------------------------------------------------------
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//=============================================================================
+//      Constants
+//-----------------------------------------------------------------------------
+#define kSPCMSampleQueueSize		64		//power of two; > 1 s of replies at the fastest data rate
+
+//=============================================================================
+//      Types
+//-----------------------------------------------------------------------------
+typedef struct TSPCMSampleQueue
+{
+	TMagellanEvent			events[kSPCMSampleQueueSize];
+	volatile uint32_t		writeIndex;		//written by the producer only
+	volatile uint32_t		readIndex;		//written by the consumer only
+	volatile uint32_t		droppedCount;	//replies lost to a full queue
+} TSPCMSampleQueue;
+
+//=============================================================================
+//      Function prototypes
+//-----------------------------------------------------------------------------
+void		SPCMSampleQueue_Init(TSPCMSampleQueue *queue);
+
+//producer side; returns 0, if the queue is full. The text of version and error replies is not queued.
+int			SPCMSampleQueue_Push(TSPCMSampleQueue *queue, const TMagellanEvent *event);
+
+//consumer side; returns 0, if the queue is empty
+int			SPCMSampleQueue_Pop(TSPCMSampleQueue *queue, TMagellanEvent *event);
+
+//=============================================================================
+//		C++ postamble
+//-----------------------------------------------------------------------------
+#ifdef __cplusplus
+}
+#endif
+
+#endif
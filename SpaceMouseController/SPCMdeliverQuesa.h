@@ -57,12 +57,22 @@
 
 #include <Quesa/QuesaController.h>
 
+#include <mach/mach_time.h>
+
 #import <Foundation/Foundation.h>
 
 @interface SPCMdeliverQuesa : NSObject {
 	// Quesa/QD3D
 	TQ3ControllerRef	fControllerRef;
 	TQ3ControllerData 	fControllerData;
+	
+	// coalescing of motion between flushes
+	TQ3Vector3D			fPendingTranslation;	// sum of the deltas
+	TQ3Quaternion		fPendingRotation;		// product of the deltas
+	BOOL				fHasPendingMotion;
+	float				fFlushRate;				// Hz; 0 delivers every sample
+	uint64_t			fFlushInterval;			// mach_absolute_time units
+	uint64_t			fLastFlush;
 }
 
 - init;
@@ -71,4 +81,14 @@
 	  	 	   andRotation:(float)a :(float)b :(float)c;
 - (BOOL)deliverKeyPress:(int)keys;
 
+- commission;
+- decommission;
+
+- setFlushRate:(float)hz;
+- (float)flushRate;
+- (BOOL)hasPendingMotion;
+- (BOOL)deliverPendingMotion:(BOOL)force;
+
+- (BOOL)getConsumerState:(BOOL *)hasSubscribers rate:(float *)consumerRate;
+
 @end
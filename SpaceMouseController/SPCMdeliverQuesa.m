@@ -48,6 +48,10 @@
 
 #include <Quesa/QuesaMath.h>
 
+#include <ControllerCoreOSX/ControllerCoreOSX.h>
+
+#include "C3QuaternionMath.h"
+
 @implementation SPCMdeliverQuesa
 
 - init
@@ -65,7 +69,9 @@
 	fControllerData.channelGetMethod	= NULL ;
 	fControllerData.channelSetMethod	= NULL ;
 	
-	fControllerRef = Q3Controller_New(&fControllerData);
+	[self commission];
+	
+	[self setFlushRate:60.0f];
 	
 	/*
 	err = err_Controller;
@@ -77,44 +83,144 @@
 
 - (void)dealloc
 {
-    //Decommission the controller
+    [self decommission];
+		
+    [super dealloc];
+}
+
+// the server hands a decommissioned controller of the same signature back to Q3Controller_New
+- commission
+{
+	if (fControllerRef == NULL)
+		fControllerRef = Q3Controller_New(&fControllerData);
+	return self;
+}
+
+- decommission
+{
 	if (fControllerRef != NULL) {
+		[self deliverPendingMotion:YES];
 		Q3Controller_Decommission(fControllerRef);
 		fControllerRef = NULL;
 	}
-		
-    [super dealloc];
+	fHasPendingMotion = NO;
+	return self;
 }
 
 
+/*
+	Motion is accumulated and flushed at fFlushRate: translations add up,
+	rotations multiply in the order they arrived. A device running faster
+	than the consumer renders then costs one position and one orientation
+	call per frame instead of per sample.
+*/
 - (BOOL)deliverTranslation:(float)x :(float)y :(float)z
 	  	       andRotation:(float)a :(float)b :(float)c
 {
-	TQ3Boolean track2DCursor;
-	
 	TQ3Quaternion d_orient;
-	TQ3Vector3D d_pos;
+	TQ3Vector3D d_angles;
 	
-	Q3Controller_Track2DCursor(fControllerRef, &track2DCursor);
-	d_pos.x = x;
-	d_pos.y = y;
-	d_pos.z = z;
+	if (fControllerRef == NULL) return NO;
 	
-	Q3Controller_MoveTrackerPosition(fControllerRef, &d_pos);
-	Q3Quaternion_SetRotate_XYZ(&d_orient,a,b,c); 	
-	Q3Controller_MoveTrackerOrientation(fControllerRef, &d_orient);			
+	d_angles.x = a;
+	d_angles.y = b;
+	d_angles.z = c;
+	CC3Quaternion_SetRotateXYZArray(1,&d_angles,&d_orient);
 	
-	return NO;
+	if (fHasPendingMotion) {
+		fPendingTranslation.x += x;
+		fPendingTranslation.y += y;
+		fPendingTranslation.z += z;
+		CC3Quaternion_Coalesce(&fPendingRotation,&d_orient);
+	}
+	else {
+		fPendingTranslation.x = x;
+		fPendingTranslation.y = y;
+		fPendingTranslation.z = z;
+		fPendingRotation = d_orient;
+		fHasPendingMotion = YES;
+	}
+	
+	return [self deliverPendingMotion:NO];
 }
 
 - (BOOL)deliverKeyPress:(int)keys
 {
 	TQ3Boolean track2DCursor;
 	
+	if (fControllerRef == NULL) return NO;
+	
+	// motion before the button change goes out first; the edge itself is never coalesced
+	[self deliverPendingMotion:YES];
+	
 	Q3Controller_Track2DCursor(fControllerRef, &track2DCursor);
 	Q3Controller_SetButtons(fControllerRef, keys);			
 	
 	return NO;
 }
 
+- setFlushRate:(float)hz
+{
+	mach_timebase_info_data_t timebase;
+	
+	if (hz < 0.0f) hz = 0.0f;
+	fFlushRate = hz;
+	
+	if (hz > 0.0f) {
+		mach_timebase_info(&timebase);
+		fFlushInterval = (uint64_t) ((1.0e9 / hz) * timebase.denom / timebase.numer);
+	}
+	else
+		fFlushInterval = 0;
+	
+	return self;
+}
+
+- (float)flushRate
+{
+	return fFlushRate;
+}
+
+- (BOOL)hasPendingMotion
+{
+	return fHasPendingMotion;
+}
+
+- (BOOL)deliverPendingMotion:(BOOL)force
+{
+	TQ3Boolean track2DCursor;
+	uint64_t now;
+	
+	if (!fHasPendingMotion) return NO;
+	
+	now = mach_absolute_time();
+	if (!force && (now - fLastFlush < fFlushInterval)) return NO;
+	
+	Q3Controller_Track2DCursor(fControllerRef, &track2DCursor);
+	Q3Controller_MoveTrackerPosition(fControllerRef, &fPendingTranslation);
+	
+	// the product of many unit quaternions drifts off unit length
+	CC3Quaternion_NormalizeArray(1,&fPendingRotation,&fPendingRotation);
+	Q3Controller_MoveTrackerOrientation(fControllerRef, &fPendingRotation);			
+	
+	fHasPendingMotion = NO;
+	fLastFlush = now;
+	
+	return YES;
+}
+
+// asks the server how much the clients of our controller want; NO if that is unknown
+- (BOOL)getConsumerState:(BOOL *)hasSubscribers rate:(float *)consumerRate
+{
+	TQ3Boolean subscribers = kQ3False;
+	float rate = 0.0f;
+	
+	if (fControllerRef == NULL) return NO;
+	if (CC3OSXController_GetConsumerState(fControllerRef, &subscribers, &rate) != kQ3Success) return NO;
+	
+	*hasSubscribers = (subscribers == kQ3True);
+	*consumerRate = rate;
+	return YES;
+}
+
 @end
@@ -0,0 +1,219 @@
+/*  NAME:
+        CoalesceTest.c
+
+    DESCRIPTION:
+        Checks that coalescing rotation deltas, as SPCMdeliverQuesa.m and
+		DriverHost do between flushes, ends on the same tracker orientation
+		as delivering every delta on its own.
+		
+		Build and run, from this directory:
+		
+		    cc -O2 -I../../common CoalesceTest.c ../../common/C3QuaternionMath.c -lm -o CoalesceTest
+		    ./CoalesceTest
+		
+		Exits with 0, if all cases pass.
+		On Mac OS X add -F with the location of Quesa.framework.
+      
+    COPYRIGHT:
+        Copyright (c) 1999-2005, Quesa Developers. All rights reserved.
+
+        For the current release of Quesa, please see:
+
+            <http://www.quesa.org/>
+        
+        Redistribution and use in source and binary forms, with or without
+        modification, are permitted provided that the following conditions
+        are met:
+        
+            o Redistributions of source code must retain the above copyright
+              notice, this list of conditions and the following disclaimer.
+        
+            o Redistributions in binary form must reproduce the above
+              copyright notice, this list of conditions and the following
+              disclaimer in the documentation and/or other materials provided
+              with the distribution.
+        
+            o Neither the name of Quesa nor the names of its contributors
+              may be used to endorse or promote products derived from this
+              software without specific prior written permission.
+        
+        THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+        "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+        LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+        A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+        OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+        SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+        TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+        PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+        LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+        NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+        SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+    ___________________________________________________________________________
+*/
+
+
+//=============================================================================
+//      Include files
+//-----------------------------------------------------------------------------
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "C3QuaternionMath.h"
+
+
+
+
+
+//=============================================================================
+//      Internal constants
+//-----------------------------------------------------------------------------
+#define kTestTolerance				1.0e-5f
+#define kTestRandomRuns				200
+#define kTestRandomDeltas			16
+
+
+
+
+
+//=============================================================================
+//      Internal functions
+//-----------------------------------------------------------------------------
+//      TestMove : Tracker side of a delta.
+//-----------------------------------------------------------------------------
+//		Note : Same call as CC3OSXTracker_MoveOrientation, i.e. O becomes O*d.
+//-----------------------------------------------------------------------------
+static void
+TestMove(TQ3Quaternion *orientation, const TQ3Quaternion *delta)
+{
+	CC3Quaternion_MultiplyArray(1,delta,orientation,orientation);
+}
+
+
+
+//=============================================================================
+//      TestDiff : Distance of two unit quaternions, q and -q are equal.
+//-----------------------------------------------------------------------------
+static float
+TestDiff(const TQ3Quaternion *a, const TQ3Quaternion *b)
+{
+	float dot = a->w*b->w + a->x*b->x + a->y*b->y + a->z*b->z;
+	
+	return(1.0f - fabsf(dot));
+}
+
+
+
+//=============================================================================
+//      TestRandom : Uniform float in [lo, hi).
+//-----------------------------------------------------------------------------
+static float
+TestRandom(float lo, float hi)
+{
+	return(lo + (hi-lo) * (float) rand() / ((float) RAND_MAX + 1.0f));
+}
+
+
+
+//=============================================================================
+//      TestSequence : Deliver count deltas one by one and coalesced.
+//-----------------------------------------------------------------------------
+//		Note : Returns the distance between the two final orientations.
+//-----------------------------------------------------------------------------
+static float
+TestSequence(TQ3Uns32 count, const TQ3Vector3D *angles)
+{
+	TQ3Quaternion	start = { 0.8f, 0.2f, -0.4f, 0.4f };
+	TQ3Quaternion	uncoalesced, coalesced, pending, delta;
+	TQ3Uns32		i;
+	
+	CC3Quaternion_NormalizeArray(1,&start,&start);
+	uncoalesced = coalesced = start;
+	
+	for (i=0; i<count; i++)
+	{
+		CC3Quaternion_SetRotateXYZArray(1,&angles[i],&delta);
+		TestMove(&uncoalesced,&delta);
+		
+		if (i==0)
+			pending = delta;
+		else
+			CC3Quaternion_Coalesce(&pending,&delta);
+	}
+	TestMove(&coalesced,&pending);
+	
+	return(TestDiff(&uncoalesced,&coalesced));
+}
+
+
+
+//=============================================================================
+//      TestReport : One line per case.
+//-----------------------------------------------------------------------------
+static int
+TestReport(const char *name, float diff)
+{
+	int failed = (diff>kTestTolerance);
+	
+	printf("%-32s diff %-12g %s\n",name,diff,failed ? "FAILED" : "ok");
+	return(failed);
+}
+
+
+
+
+
+//=============================================================================
+//      main
+//-----------------------------------------------------------------------------
+int
+main(void)
+{
+	TQ3Vector3D		angles[kTestRandomDeltas];
+	TQ3Quaternion	qx, qy, xy, yx;
+	float			maxDiff = 0.0f;
+	int				failures = 0;
+	TQ3Uns32		r, i;
+	
+	//a quarter turn about x, then one about y; these do not commute
+	angles[0].x = 0.5f*kQ3Pi; angles[0].y = 0.0f;		 angles[0].z = 0.0f;
+	angles[1].x = 0.0f;		 angles[1].y = 0.5f*kQ3Pi; angles[1].z = 0.0f;
+	
+	CC3Quaternion_SetRotateXYZArray(1,&angles[0],&qx);
+	CC3Quaternion_SetRotateXYZArray(1,&angles[1],&qy);
+	CC3Quaternion_MultiplyArray(1,&qx,&qy,&xy);
+	CC3Quaternion_MultiplyArray(1,&qy,&qx,&yx);
+	if (TestDiff(&xy,&yx)<0.1f)
+	{
+		printf("test rotations commute, the cases below prove nothing\n");
+		return(1);
+	}
+	
+	failures += TestReport("x then y",TestSequence(2,angles));
+	
+	angles[2] = angles[0];
+	angles[0] = angles[1];
+	angles[1] = angles[2];
+	failures += TestReport("y then x",TestSequence(2,angles));
+	
+	//runs of small deltas, as a SpaceMouse delivers them between flushes
+	srand(1);
+	for (r=0; r<kTestRandomRuns; r++)
+	{
+		float diff;
+		
+		for (i=0; i<kTestRandomDeltas; i++)
+		{
+			angles[i].x = TestRandom(-0.3f,0.3f);
+			angles[i].y = TestRandom(-0.3f,0.3f);
+			angles[i].z = TestRandom(-0.3f,0.3f);
+		}
+		
+		diff = TestSequence(kTestRandomDeltas,angles);
+		if (diff>maxDiff)
+			maxDiff = diff;
+	}
+	failures += TestReport("random runs",maxDiff);
+	
+	return(failures!=0);
+}
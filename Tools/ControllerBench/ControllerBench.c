@@ -0,0 +1,1590 @@
+/*  NAME:
+        ControllerBench.c
+
+    DESCRIPTION:
+        Microbenchmarks of the IPC marshalling, the server's message dispatch,
+		the controller database, the tracker event ring and the quaternion
+		kernels. Every benchmark prints one JSON object per line:
+		
+		    {"bench":"put.TQ3Uns32","iterations":65536,"ns_per_op":91.40,"allocs_per_op":2.00,"bytes_per_op":64.0}
+		
+		so runs can be diffed and tracked. The first line names the allocation
+		counter: with glibc every malloc is counted, on Mac OS X only the
+		allocations of CoreFoundation objects (through a counting default
+		CFAllocator).
+		
+		The server sources are linked as they are; what they would send to
+		drivers, trackers, the journal and the store ends in the stand-ins
+		below, so the numbers are the in-process cost only. Of the client
+		library only its tracker event ring, C3EventRing.c, is linked; it
+		needs nothing else of ControllerCoreOSX.
+		
+		Build and run, from this directory, with Quesa's Includes and
+		Source/Core/Support directories in QUESA_INC:
+		
+		    c++ -O2 -x c++ -DQUESA_OS_UNIX=1 -IUnix -I../../common -I../../QuesaOSXDeviceServer -I../../ControllerCoreOSX $QUESA_INC -include E3Prefix.h \
+		        ControllerBench.c ../../common/IPCPackUnpack.c ../../common/IPCHandles.c \
+		        ../../common/C3QuaternionMath.c ../../common/IPCSharedData.c ../../ControllerCoreOSX/C3EventRing.c \
+		        ../../QuesaOSXDeviceServer/ControllerDB.c ../../QuesaOSXDeviceServer/ControllerFilter.c \
+		        ../../QuesaOSXDeviceServer/ControllerBlobs.c ../../QuesaOSXDeviceServer/IPCController.c \
+		        -lCoreFoundation -lm -o ControllerBench
+		    ./ControllerBench [filter] [milliseconds]
+		
+		The sources compile as C++, as in the Xcode targets. On Linux
+		CoreFoundation is the one of swift-corelibs-foundation. On
+		Mac OS X drop -IUnix, define QUESA_OS_MACINTOSH instead and link with
+		-framework CoreFoundation. filter selects the benchmarks whose name
+		contains it; milliseconds is the least time spent per benchmark.
+      
+    COPYRIGHT:
+        Copyright (c) 1999-2005, Quesa Developers. All rights reserved.
+
+        For the current release of Quesa, please see:
+
+            <http://www.quesa.org/>
+        
+        Redistribution and use in source and binary forms, with or without
+        modification, are permitted provided that the following conditions
+        are met:
+        
+            o Redistributions of source code must retain the above copyright
+              notice, this list of conditions and the following disclaimer.
+        
+            o Redistributions in binary form must reproduce the above
+              copyright notice, this list of conditions and the following
+              disclaimer in the documentation and/or other materials provided
+              with the distribution.
+        
+            o Neither the name of Quesa nor the names of its contributors
+              may be used to endorse or promote products derived from this
+              software without specific prior written permission.
+        
+        THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+        "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+        LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+        A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+        OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+        SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+        TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+        PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+        LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+        NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+        SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+    ___________________________________________________________________________
+*/
+
+
+
+
+//=============================================================================
+//      Include files
+//-----------------------------------------------------------------------------
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__APPLE__)
+	#include <mach/mach_time.h>
+#else
+	#include <time.h>
+#endif
+
+#include "IPCMessageIDs.h"
+#include "IPCPackUnpack.h"
+#include "IPCAsync.h"
+#include "C3QuaternionMath.h"
+#include "C3EventRing.h"
+#include "ControllerDB.h"
+#include "ControllerJournal.h"
+#include "ControllerStore.h"
+#include "IPCController.h"
+#include "IPCDriver.h"
+#include "IPCTracker.h"
+
+
+
+
+
+//=============================================================================
+//      Internal constants
+//-----------------------------------------------------------------------------
+#define kBenchDefaultMilliseconds		50
+#define kBenchMaxIterations				0x40000000
+#define kBenchMaxFields					8
+#define kBenchValueCount				8		//controller values, a SpaceMouse sends 6 or 8
+#define kBenchDataSize					8		//channel data
+#define kBenchChannelCount				16
+#define kBenchArrayCount				4		//entries of channel and state arrays
+#define kBenchKernelCount				1024	//quaternions per kernel call, power of two
+#define kBenchControllers				1000	//most controllers registered
+#define kBenchSignature					"bench:controller:%04u"
+
+
+
+
+
+//=============================================================================
+//      Internal types
+//-----------------------------------------------------------------------------
+//one dictionary entry: kind selects the IPCPut*/IPCGet* helper, see BenchPutField
+typedef struct TBenchField
+{
+	char					kind;
+	CFStringRef				key;
+} TBenchField;
+
+typedef struct TBenchFields
+{
+	TQ3Uns32				count;
+	TBenchField				field[kBenchMaxFields];
+} TBenchFields;
+
+//what gets marshalled, and where unmarshalled data goes
+typedef struct TBenchValues
+{
+	TQ3ControllerRef		controllerRef;
+	TQ3ControllerData		controllerData;
+	TQ3Uns32				uns32;
+	TQ3Boolean				boolean;
+	float					real;
+	TQ3Point3D				point;
+	TQ3Vector3D				vector;
+	TQ3Quaternion			quaternion;
+	UInt8					data[kBenchDataSize];
+	void					*methodRef;
+	float					values[kBenchValueCount];
+	CFStringRef				string;
+	char					text[64];
+} TBenchValues;
+
+//a message type: request and reply fields; k3Status is added to every reply
+typedef struct TBenchMessage
+{
+	SInt32					msgid;
+	const char				*name;
+	const char				*request;
+	const char				*reply;
+	TQ3Boolean				dispatch;		//safe to run through IPCControllerDispatcher here
+} TBenchMessage;
+
+typedef struct TBenchMarshal
+{
+	const TBenchFields		*fields;
+	TBenchValues			*values;
+	CFDataRef				data;			//serialized fields, for decoding
+	CFMutableDictionaryRef	dict;			//for single helpers
+} TBenchMarshal;
+
+typedef struct TBenchDispatch
+{
+	SInt32					msgid;
+	CFDataRef				data;
+} TBenchDispatch;
+
+typedef struct TBenchDB
+{
+	TQ3ControllerRef		controllerRef;
+	TQ3ControllerData		*controllerData;
+} TBenchDB;
+
+typedef struct TBenchRing
+{
+	TC3EventRing			ring;
+	TQ3Uns32				stamp;			//next stamp to insert
+	TQ3Uns32				sequence;		//cursor
+	TQ3Point3D				position;
+	TQ3Quaternion			orientation;
+} TBenchRing;
+
+typedef struct TBenchKernel
+{
+	TQ3Quaternion			*q1;
+	TQ3Quaternion			*q2;
+	TQ3Quaternion			*result;
+	TQ3Vector3D				*angles;
+	float					thresholdCos;
+} TBenchKernel;
+
+typedef void (*TBenchProc)(void *context, TQ3Uns32 iterations);
+
+//not in ControllerDB.h
+TQ3Boolean ControllerDB_refinlist(TQ3ControllerRef controllerRef);
+
+
+
+
+
+//=============================================================================
+//      Internal variables
+//-----------------------------------------------------------------------------
+#define R	"r" k3CtrlRef " "
+#define T	"u" k3TrackerHandle " "
+
+static const TBenchMessage gBenchMessages[] =
+{
+	{ m3Controller_GetListChanged,				"Controller_GetListChanged",			"b" k3ListChanged " u" k3SerNum,	"b" k3ListChanged " u" k3SerNum,	kQ3True },
+	{ m3Controller_Next,						"Controller_Next",						R,									R,									kQ3True },
+	{ m3Controller_New,							"Controller_New",						"c" k3CtrlData " s" k3Signature " s" k3DriverPortName " u" k3DriverHandle " u" k3CapToken,
+																																	R,									kQ3False },
+	{ m3Controller_Decommission,				"Controller_Decommission",				R,									"",									kQ3False },
+	{ m3Controller_SetActivation,				"Controller_SetActivation",				R "b" k3Active,						"",									kQ3True },
+	{ m3Controller_GetActivation,				"Controller_GetActivation",				R,									"b" k3Active,						kQ3True },
+	{ m3Controller_GetSignature,				"Controller_GetSignature",				R,									"s" k3Signature,					kQ3True },
+	{ m3Controller_SetChannel,					"Controller_SetChannel",				R "u" k3Channel " d" k3Data " u" k3DataSize,
+																																	"n" k3MethodsReturn,				kQ3True },
+	{ m3Controller_GetChannel,					"Controller_GetChannel",				R "u" k3Channel " u" k3DataSize,	"n" k3MethodsReturn,				kQ3True },
+	{ m3Controller_GetValueCount,				"Controller_GetValueCount",				R,									"u" k3ValueCnt,						kQ3True },
+	{ m3Controller_SetTracker,					"Controller_SetTracker",				R "u" k3TrackerHandle " s" k3TrackerPortName,
+																																	"",									kQ3False },
+	{ m3Controller_HasTracker,					"Controller_HasTracker",				R,									"b" k3hasTracker,					kQ3True },
+	{ m3Controller_Track2DCursor,				"Controller_Track2DCursor",				R,									"b" k3Track2DCrsr,					kQ3True },
+	{ m3Controller_Track3DCursor,				"Controller_Track3DCursor",				R,									"b" k3Track3DCrsr,					kQ3True },
+	{ m3Controller_GetButtons,					"Controller_GetButtons",				R,									"u" k3Buttons,						kQ3True },
+	{ m3Controller_SetButtons,					"Controller_SetButtons",				R "u" k3Buttons,					"",									kQ3True },
+	{ m3Controller_GetTrackerPosition,			"Controller_GetTrackerPosition",		R,									"p" k3Position,						kQ3True },
+	{ m3Controller_SetTrackerPosition,			"Controller_SetTrackerPosition",		R "p" k3Position,					"",									kQ3True },
+	{ m3Controller_MoveTrackerPosition,			"Controller_MoveTrackerPosition",		R "v" k3DeltaPos,					"",									kQ3True },
+	{ m3Controller_GetTrackerOrientation,		"Controller_GetTrackerOrientation",		R,									"q" k3Orient,						kQ3True },
+	{ m3Controller_SetTrackerOrientation,		"Controller_SetTrackerOrientation",		R "q" k3Orient,						"",									kQ3True },
+	{ m3Controller_MoveTrackerOrientation,		"Controller_MoveTrackerOrientation",	R "q" k3DeltaOrient,				"",									kQ3True },
+	{ m3Controller_GetValues,					"Controller_GetValues",					R "u" k3ValueCount " u" k3SerNum,	"b" k3Active " u" k3PrivValueCount " u" k3SerNum " a" k3Values,
+																																										kQ3True },
+	{ m3Controller_SetValues,					"Controller_SetValues",					R "u" k3ValueCount " a" k3Values,	"",									kQ3True },
+	{ m3Controller_WaitForValues,				"Controller_WaitForValues",				R "u" k3ValueCount " u" k3SerNum " u" k3RequestTag " s" k3ReplyPortName,
+																																	"b" k3Active " u" k3PrivValueCount " u" k3SerNum " a" k3Values,
+																																										kQ3False },
+	{ m3Controller_GetConsumerState,			"Controller_GetConsumerState",			R,									"b" k3hasSubscribers " f" k3ConsumerRate,
+																																										kQ3True },
+	{ m3Controller_SetFilter,					"Controller_SetFilter",					R "l" k3FilterStages,				"",									kQ3False },
+	{ m3Controller_SetChannels,					"Controller_SetChannels",				R "h" k3Channels,					"N" k3MethodsReturn,				kQ3True },
+	{ m3Controller_GetChannels,					"Controller_GetChannels",				R "h" k3Channels,					"N" k3MethodsReturn,				kQ3True },
+	{ m3Controller_GetDriverEndpoint,			"Controller_GetDriverEndpoint",			R,									"s" k3DriverPortName " u" k3DriverHandle " u" k3CapToken,
+																																										kQ3True },
+	{ m3Controller_ChannelChanged,				"Controller_ChannelChanged",			R "u" k3Channel " d" k3Data " u" k3DataSize,
+																																	"",									kQ3False },
+	{ m3ControllerDriver_SetChannel,			"ControllerDriver_SetChannel",			"m" k3MethodRef " " R "u" k3Channel " d" k3Data " u" k3DataSize,
+																																	"",									kQ3False },
+	{ m3ControllerDriver_GetChannel,			"ControllerDriver_GetChannel",			"m" k3MethodRef " " R "u" k3Channel " u" k3DataSize,
+																																	"d" k3Data " u" k3DataSize,			kQ3False },
+	{ m3ControllerDriver_StateSaveAndReset,		"ControllerDriver_StateSaveAndReset",	"m" k3GetMethodRef " m" k3SetMethodRef " " R "u" k3ChannelCount " u" k3ChannelMask " u" k3ResetMask,
+																																	"g" k3ChannelsData " u" k3ChannelMask " u" k3ResetMask,
+																																										kQ3False },
+	{ m3ControllerDriver_StateRestore,			"ControllerDriver_StateRestore",		"m" k3SetMethodRef " " R "u" k3ChannelCount " u" k3ChannelMask " g" k3ChannelsData,
+																																	"",									kQ3False },
+	{ m3ControllerDriver_StateSaveAndResetBatch,"ControllerDriver_StateSaveAndResetBatch","t" k3CtrlStates,						"t" k3CtrlStates,					kQ3False },
+	{ m3ControllerDriver_StateRestoreBatch,		"ControllerDriver_StateRestoreBatch",	"t" k3CtrlStates,					"t" k3CtrlStates,					kQ3False },
+	{ m3ControllerDriver_SetChannels,			"ControllerDriver_SetChannels",			"m" k3MethodRef " " R "h" k3Channels,
+																																	"h" k3Channels,						kQ3False },
+	{ m3ControllerDriver_GetChannels,			"ControllerDriver_GetChannels",			"m" k3MethodRef " " R "h" k3Channels,
+																																	"h" k3Channels,						kQ3False },
+	{ m3ControllerDriver_DirectSetChannel,		"ControllerDriver_DirectSetChannel",	"u" k3DriverHandle " u" k3CapToken " u" k3Channel " d" k3Data " u" k3DataSize,
+																																	"b" k3CapValid,						kQ3False },
+	{ m3ControllerDriver_DirectGetChannel,		"ControllerDriver_DirectGetChannel",	"u" k3DriverHandle " u" k3CapToken " u" k3Channel " u" k3DataSize,
+																																	"b" k3CapValid " d" k3Data " u" k3DataSize,
+																																										kQ3False },
+	{ m3ControllerState_New,					"ControllerState_New",					R,									"u" k3CtrlStateHandle,				kQ3False },
+	{ m3ControllerState_Delete,					"ControllerState_Delete",				R "u" k3CtrlStateHandle,			"",									kQ3False },
+	{ m3ControllerState_SaveAndReset,			"ControllerState_SaveAndReset",			R "u" k3CtrlStateHandle,			"",									kQ3False },
+	{ m3ControllerState_Restore,				"ControllerState_Restore",				R "u" k3CtrlStateHandle,			"",									kQ3False },
+	{ m3ControllerState_SaveAndResetBatch,		"ControllerState_SaveAndResetBatch",	"t" k3CtrlStates,					"x" k3StateStatuses,				kQ3False },
+	{ m3ControllerState_RestoreBatch,			"ControllerState_RestoreBatch",			"t" k3CtrlStates,					"x" k3StateStatuses,				kQ3False },
+	{ m3Tracker_ChangeButtons,					"Tracker_ChangeButtons",				T R "u" k3Buttons " u" k3ButtonMask,"",									kQ3False },
+	{ m3Tracker_GetActivation,					"Tracker_GetActivation",				T,									"b" k3Active,						kQ3False },
+	{ m3Tracker_GetPosition,					"Tracker_GetPosition",					T,									"p" k3Position,						kQ3False },
+	{ m3Tracker_SetPosition,					"Tracker_SetPosition",					T R "p" k3Position,					"",									kQ3False },
+	{ m3Tracker_MovePosition,					"Tracker_MovePosition",					T R "v" k3DeltaPos,					"",									kQ3False },
+	{ m3Tracker_GetOrientation,					"Tracker_GetOrientation",				T,									"q" k3Orient,						kQ3False },
+	{ m3Tracker_SetOrientation,					"Tracker_SetOrientation",				T R "q" k3Orient,					"",									kQ3False },
+	{ m3Tracker_MoveOrientation,				"Tracker_MoveOrientation",				T R "q" k3DeltaOrient,				"",									kQ3False },
+	{ m3Tracker_CallNotification,				"Tracker_CallNotification",				T R,								"",									kQ3False }
+};
+
+//the single helpers of IPCPackUnpack.h
+static const char *gBenchHelpers[][2] =
+{
+	{ "r" k3CtrlRef,		"ControllerRef" },
+	{ "d" k3Data,			"Bytes" },
+	{ "b" k3Active,			"TQ3Boolean" },
+	{ "u" k3SerNum,			"TQ3Uns32" },
+	{ "p" k3Position,		"TQ3Point3D" },
+	{ "v" k3DeltaPos,		"TQ3Vector3D" },
+	{ "q" k3Orient,			"TQ3Quaternion" }
+};
+
+#undef R
+#undef T
+
+//entries of the nested kinds
+static TBenchFields			gBenchChannelEntry;		//'h'
+static TBenchFields			gBenchStateEntry;		//'t'
+static TBenchFields			gBenchMethodsReturn;	//'n'
+static TBenchFields			gBenchChannelsReturn;	//'N'
+
+static const char			*gBenchFilter = NULL;
+static double				gBenchMinTime = kBenchDefaultMilliseconds*1.0e6;
+
+//allocation counter; only counts while gBenchCounting is set
+static int					gBenchCounting = 0;
+static unsigned long long	gBenchAllocs = 0;
+static unsigned long long	gBenchBytes = 0;
+
+//results nobody reads, so that the compiler keeps the work
+static volatile TQ3Uns32	gBenchSink = 0;
+
+
+
+
+
+//=============================================================================
+//      Allocation counting
+//-----------------------------------------------------------------------------
+#if defined(__GLIBC__)
+
+//glibc declares them throw() to C++
+#ifdef __cplusplus
+	#define BenchNoThrow	__THROW
+extern "C" {
+#else
+	#define BenchNoThrow
+#endif
+
+extern void	*__libc_malloc(size_t size);
+extern void	*__libc_calloc(size_t count, size_t size);
+extern void	*__libc_realloc(void *ptr, size_t size);
+extern void	__libc_free(void *ptr);
+
+void *
+malloc(size_t size) BenchNoThrow
+{
+	if (gBenchCounting)
+		{ gBenchAllocs++; gBenchBytes += size; }
+	return(__libc_malloc(size));
+}
+
+void *
+calloc(size_t count, size_t size) BenchNoThrow
+{
+	if (gBenchCounting)
+		{ gBenchAllocs++; gBenchBytes += count*size; }
+	return(__libc_calloc(count,size));
+}
+
+void *
+realloc(void *ptr, size_t size) BenchNoThrow
+{
+	if (gBenchCounting)
+		{ gBenchAllocs++; gBenchBytes += size; }
+	return(__libc_realloc(ptr,size));
+}
+
+void
+free(void *ptr) BenchNoThrow
+{
+	__libc_free(ptr);
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#define kBenchAllocCounter		"malloc"
+
+static void
+BenchInstallCounter(void)
+{
+}
+
+#elif defined(__APPLE__)
+
+#define kBenchAllocCounter		"CFAllocator"
+
+static void *
+BenchAllocate(CFIndex size, CFOptionFlags hint, void *info)
+{
+	if (gBenchCounting)
+		{ gBenchAllocs++; gBenchBytes += size; }
+	return(malloc(size));
+}
+
+static void *
+BenchReallocate(void *ptr, CFIndex size, CFOptionFlags hint, void *info)
+{
+	if (gBenchCounting)
+		{ gBenchAllocs++; gBenchBytes += size; }
+	return(realloc(ptr,size));
+}
+
+static void
+BenchDeallocate(void *ptr, void *info)
+{
+	free(ptr);
+}
+
+static void
+BenchInstallCounter(void)
+{
+	CFAllocatorContext	context = { 0, NULL, NULL, NULL, NULL, BenchAllocate, BenchReallocate, BenchDeallocate, NULL };
+	CFAllocatorRef		allocator = CFAllocatorCreate(kCFAllocatorUseContext,&context);
+	
+	//kCFAllocatorDefault, as used throughout, now resolves to the counting allocator
+	if (allocator!=NULL)
+		CFAllocatorSetDefault(allocator);
+}
+
+#else
+
+#define kBenchAllocCounter		"none"
+
+static void
+BenchInstallCounter(void)
+{
+}
+
+#endif
+
+
+
+
+
+//=============================================================================
+//      Stand-ins : What ControllerDB and IPCController would send elsewhere.
+//-----------------------------------------------------------------------------
+//		Note : A driver that accepts everything; channel reads return
+//				kBenchDataSize bytes.
+//-----------------------------------------------------------------------------
+static CFMutableDictionaryRef
+BenchNewDict(void)
+{
+	return(CFDictionaryCreateMutable(kCFAllocatorDefault,0,&kCFTypeDictionaryKeyCallBacks,&kCFTypeDictionaryValueCallBacks));
+}
+
+TQ3Status
+IPCDriver_Send(SInt32 msgid, CFStringRef theDriverPortName, CFMutableDictionaryRef dict, CFMutableDictionaryRef returnDict)
+{
+	static const UInt8		data[kBenchDataSize] = { 0 };
+	TQ3Uns32				success = kQ3Success;
+	TQ3Uns32				dataSize = kBenchDataSize;
+	CFMutableDictionaryRef	methodsReturn = BenchNewDict();
+	
+	if (methodsReturn==NULL)
+		return(kQ3Failure);
+	
+	IPCPutTQ3Uns32(methodsReturn,CFSTR(k3Status),&success);
+	if (msgid==m3ControllerDriver_GetChannel)
+	{
+		IPCPutBytes(methodsReturn,CFSTR(k3Data),kBenchDataSize,data);
+		IPCPutTQ3Uns32(methodsReturn,CFSTR(k3DataSize),&dataSize);
+	}
+	else if ((msgid==m3ControllerDriver_SetChannels) || (msgid==m3ControllerDriver_GetChannels))
+	{
+		CFArrayRef			requests = (CFArrayRef)CFDictionaryGetValue(dict,CFSTR(k3Channels));
+		CFMutableArrayRef	replies = CFArrayCreateMutable(kCFAllocatorDefault,0,&kCFTypeArrayCallBacks);
+		CFIndex				index;
+		
+		for (index=0; (requests!=NULL) && (replies!=NULL) && (index<CFArrayGetCount(requests)); index++)
+		{
+			CFDictionaryRef			request = (CFDictionaryRef)CFArrayGetValueAtIndex(requests,index);
+			CFMutableDictionaryRef	reply = BenchNewDict();
+			TQ3Uns32				channel = 0;
+			
+			if (reply==NULL)
+				continue;
+			IPCGetTQ3Uns32(request,CFSTR(k3Channel),&channel);
+			IPCPutTQ3Uns32(reply,CFSTR(k3Channel),&channel);
+			IPCPutTQ3Uns32(reply,CFSTR(k3Status),&success);
+			if (msgid==m3ControllerDriver_GetChannels)
+			{
+				IPCPutBytes(reply,CFSTR(k3Data),kBenchDataSize,data);
+				IPCPutTQ3Uns32(reply,CFSTR(k3DataSize),&dataSize);
+			}
+			CFArrayAppendValue(replies,reply);
+			CFRelease(reply);
+		}
+		if (replies!=NULL)
+		{
+			CFDictionarySetValue(methodsReturn,CFSTR(k3Channels),replies);
+			CFRelease(replies);
+		}
+	}
+	
+	CFDictionarySetValue(returnDict,CFSTR(k3MethodsReturn),methodsReturn);
+	CFRelease(methodsReturn);
+	return(kQ3Success);
+}
+
+TQ3Status
+IPCTracker_callNotification(TQ3Uns32 theTrackerHandle, CFStringRef theTrackerPortName, TQ3ControllerRef controllerRef)
+{
+	return(kQ3Success);
+}
+
+TQ3Status
+IPCTracker_changeButtons(TQ3Uns32 theTrackerHandle, CFStringRef theTrackerPortName, TQ3ControllerRef controllerRef, TQ3Uns32 buttons, TQ3Uns32 buttonMask)
+{
+	return(kQ3Success);
+}
+
+TQ3Status
+IPCTracker_getActivation(TQ3Uns32 theTrackerHandle, CFStringRef theTrackerPortName, TQ3Boolean *active)
+{
+	*active = kQ3True;
+	return(kQ3Success);
+}
+
+TQ3Status
+IPCTracker_getPosition(TQ3Uns32 theTrackerHandle, CFStringRef theTrackerPortName, TQ3Point3D *position)
+{
+	position->x = position->y = position->z = 0.0f;
+	return(kQ3Success);
+}
+
+TQ3Status
+IPCTracker_setPosition(TQ3Uns32 theTrackerHandle, CFStringRef theTrackerPortName, TQ3ControllerRef controllerRef, const TQ3Point3D *position)
+{
+	return(kQ3Success);
+}
+
+TQ3Status
+IPCTracker_movePosition(TQ3Uns32 theTrackerHandle, CFStringRef theTrackerPortName, TQ3ControllerRef controllerRef, const TQ3Vector3D *delta)
+{
+	return(kQ3Success);
+}
+
+TQ3Status
+IPCTracker_getOrientation(TQ3Uns32 theTrackerHandle, CFStringRef theTrackerPortName, TQ3Quaternion *orientation)
+{
+	orientation->w = 1.0f;
+	orientation->x = orientation->y = orientation->z = 0.0f;
+	return(kQ3Success);
+}
+
+TQ3Status
+IPCTracker_setOrientation(TQ3Uns32 theTrackerHandle, CFStringRef theTrackerPortName, TQ3ControllerRef controllerRef, const TQ3Quaternion *orientation)
+{
+	return(kQ3Success);
+}
+
+TQ3Status
+IPCTracker_moveOrientation(TQ3Uns32 theTrackerHandle, CFStringRef theTrackerPortName, TQ3ControllerRef controllerRef, const TQ3Quaternion *delta)
+{
+	return(kQ3Success);
+}
+
+TQ3Status
+IPCAsync_SendRequest(CFStringRef remotePortName, SInt32 msgid, CFMutableDictionaryRef dict, TC3IPCAsyncCompletionProc completionProc, void *userData)
+{
+	return(kQ3Failure);
+}
+
+Boolean
+IPCAsync_IsAsyncRequest(CFDictionaryRef dict)
+{
+	return((dict!=NULL) && CFDictionaryContainsKey(dict,CFSTR(k3ReplyPortName)));
+}
+
+TQ3Status
+IPCAsync_SendReply(CFDictionaryRef requestDict, SInt32 msgid, CFMutableDictionaryRef returnDict)
+{
+	return(kQ3Success);
+}
+
+TQ3Status
+IPCAsync_SendReplyTo(CFStringRef replyPortName, TQ3Uns32 requestTag, SInt32 msgid, CFMutableDictionaryRef returnDict)
+{
+	return(kQ3Success);
+}
+
+Boolean
+IPCAsync_ReplyPortIsValid(CFStringRef replyPortName)
+{
+	return(true);
+}
+
+void
+ControllerJournal_Record(TQ3ControllerRef controllerRef, const TQ3ControllerData *controllerData, UInt16 recordType, const void *data, UInt32 dataSize)
+{
+}
+
+void
+ControllerJournal_RecordValues(TQ3ControllerRef controllerRef, const TQ3ControllerData *controllerData, const float *values, TQ3Uns32 valueCount)
+{
+}
+
+void
+ControllerStore_NoteChange(void)
+{
+}
+
+static TQ3Status
+BenchChannelGet(TQ3ControllerRef controllerRef, TQ3Uns32 channel, void *data, TQ3Uns32 *dataSize)
+{
+	return(kQ3Success);
+}
+
+static TQ3Status
+BenchChannelSet(TQ3ControllerRef controllerRef, TQ3Uns32 channel, const void *data, TQ3Uns32 dataSize)
+{
+	return(kQ3Success);
+}
+
+
+
+
+
+//=============================================================================
+//      Internal functions
+//-----------------------------------------------------------------------------
+//      BenchNow : Monotonic time in nanoseconds.
+//-----------------------------------------------------------------------------
+static double
+BenchNow(void)
+{
+#if defined(__APPLE__)
+	static mach_timebase_info_data_t timebase;
+	if (timebase.denom==0)
+		mach_timebase_info(&timebase);
+	return((double) mach_absolute_time() * timebase.numer / timebase.denom);
+#else
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC,&ts);
+	return((double) ts.tv_sec * 1.0e9 + (double) ts.tv_nsec);
+#endif
+}
+
+
+
+//=============================================================================
+//      BenchReport : One JSON object per benchmark.
+//-----------------------------------------------------------------------------
+static void
+BenchReport(const char *name, TQ3Uns32 iterations, double ns, unsigned long long allocs, unsigned long long bytes)
+{
+	printf("{\"bench\":\"%s\",\"iterations\":%u,\"ns_per_op\":%.2f,\"allocs_per_op\":%.2f,\"bytes_per_op\":%.1f}\n",
+			name, (unsigned) iterations, ns/iterations, (double) allocs/iterations, (double) bytes/iterations);
+	fflush(stdout);
+}
+
+
+
+//=============================================================================
+//      BenchSelected : Is name picked by the filter argument?
+//-----------------------------------------------------------------------------
+static TQ3Boolean
+BenchSelected(const char *name)
+{
+	return(((gBenchFilter==NULL) || (strstr(name,gBenchFilter)!=NULL)) ? kQ3True : kQ3False);
+}
+
+
+
+//=============================================================================
+//      BenchRun : Time proc, doubling the iterations until it ran for
+//				gBenchMinTime.
+//-----------------------------------------------------------------------------
+//		Note : proc must be repeatable; every round has to measure the
+//				same thing.
+//-----------------------------------------------------------------------------
+static void
+BenchRun(const char *name, TBenchProc proc, void *context)
+{
+	TQ3Uns32	iterations = 1;
+	double		t0, ns;
+	
+	if (BenchSelected(name)==kQ3False)
+		return;
+	
+	proc(context,1);//warm up
+	
+	for (;;)
+	{
+		gBenchAllocs = gBenchBytes = 0;
+		gBenchCounting = 1;
+		t0 = BenchNow();
+		proc(context,iterations);
+		ns = BenchNow()-t0;
+		gBenchCounting = 0;
+		
+		if ((ns>=gBenchMinTime) || (iterations>=kBenchMaxIterations))
+			break;
+		iterations *= 2;
+	}
+	BenchReport(name,iterations,ns,gBenchAllocs,gBenchBytes);
+}
+
+
+
+//=============================================================================
+//      BenchParseFields : Fields from a spec such as "rE3CtrlRef uE3Buttons".
+//-----------------------------------------------------------------------------
+//		Note : Each word is the kind letter followed by the key.
+//-----------------------------------------------------------------------------
+static void
+BenchParseFields(const char *spec, TBenchFields *fields)
+{
+	char		key[64];
+	TQ3Uns32	length;
+	
+	fields->count = 0;
+	while (fields->count<kBenchMaxFields)
+	{
+		while (*spec==' ')
+			spec++;
+		if (*spec==0)
+			break;
+		
+		fields->field[fields->count].kind = *spec++;
+		for (length=0; (*spec!=0) && (*spec!=' ') && (length<sizeof(key)-1); length++)
+			key[length] = *spec++;
+		key[length] = 0;
+		
+		fields->field[fields->count].key = CFStringCreateWithCString(kCFAllocatorDefault,key,kCFStringEncodingASCII);
+		fields->count++;
+	}
+}
+
+static void
+BenchDisposeFields(TBenchFields *fields)
+{
+	TQ3Uns32 index;
+	
+	for (index=0; index<fields->count; index++)
+		CFRelease(fields->field[index].key);
+	fields->count = 0;
+}
+
+
+
+//=============================================================================
+//      BenchPutField : Marshal one field the way the repository does.
+//-----------------------------------------------------------------------------
+static void BenchPutFields(CFMutableDictionaryRef dict, const TBenchFields *fields, TBenchValues *values);
+
+static void
+BenchPutArray(CFMutableDictionaryRef dict, CFStringRef key, const TBenchFields *entry, TBenchValues *values)
+{
+	CFMutableArrayRef	array = CFArrayCreateMutable(kCFAllocatorDefault,kBenchArrayCount,&kCFTypeArrayCallBacks);
+	TQ3Uns32			index;
+	
+	for (index=0; index<kBenchArrayCount; index++)
+	{
+		CFMutableDictionaryRef entryDict = BenchNewDict();
+		
+		BenchPutFields(entryDict,entry,values);
+		CFArrayAppendValue(array,entryDict);
+		CFRelease(entryDict);
+	}
+	CFDictionarySetValue(dict,key,array);
+	CFRelease(array);
+}
+
+static void
+BenchPutField(CFMutableDictionaryRef dict, const TBenchField *field, TBenchValues *values)
+{
+	switch (field->kind)
+	{
+		case 'r':
+			IPCPutControllerRef(dict,field->key,&values->controllerRef);
+			break;
+		case 'u':
+			IPCPutTQ3Uns32(dict,field->key,&values->uns32);
+			break;
+		case 'b':
+			IPCPutTQ3Boolean(dict,field->key,&values->boolean);
+			break;
+		case 'p':
+			IPCPutTQ3Point3D(dict,field->key,&values->point);
+			break;
+		case 'v':
+			IPCPutTQ3Vector3D(dict,field->key,&values->vector);
+			break;
+		case 'q':
+			IPCPutTQ3Quaternion(dict,field->key,&values->quaternion);
+			break;
+		case 'f':
+			IPCPutBytes(dict,field->key,sizeof(float),&values->real);
+			break;
+		case 'd':
+			IPCPutBytes(dict,field->key,kBenchDataSize,values->data);
+			break;
+		case 'm':
+			IPCPutBytes(dict,field->key,sizeof(void*),&values->methodRef);
+			break;
+		case 'c':
+			IPCPutBytes(dict,field->key,sizeof(TQ3ControllerData),&values->controllerData);
+			break;
+		case 's':
+			CFDictionarySetValue(dict,field->key,values->string);
+			break;
+		case 'a'://values, as IpcController_PutValues
+		case 'x'://statuses of a batch
+		{
+			CFNumberRef	numbers[kBenchValueCount];
+			TQ3Uns32	index, count = (field->kind=='a') ? kBenchValueCount : kBenchArrayCount;
+			CFArrayRef	array;
+			
+			for (index=0; index<count; index++)
+				numbers[index] = (field->kind=='a')
+								? CFNumberCreate(kCFAllocatorDefault,kCFNumberFloatType,&values->values[index])
+								: CFNumberCreate(kCFAllocatorDefault,kCFNumberSInt32Type,&values->uns32);
+			array = CFArrayCreate(kCFAllocatorDefault,(const void**)numbers,count,&kCFTypeArrayCallBacks);
+			for (index=0; index<count; index++)
+				CFRelease(numbers[index]);
+			CFDictionarySetValue(dict,field->key,array);
+			CFRelease(array);
+			break;
+		}
+		case 'g'://channel data of a saved state
+		{
+			CFDataRef	datas[kBenchArrayCount];
+			TQ3Uns32	index;
+			CFArrayRef	array;
+			
+			for (index=0; index<kBenchArrayCount; index++)
+				datas[index] = CFDataCreate(kCFAllocatorDefault,values->data,kBenchDataSize);
+			array = CFArrayCreate(kCFAllocatorDefault,(const void**)datas,kBenchArrayCount,&kCFTypeArrayCallBacks);
+			for (index=0; index<kBenchArrayCount; index++)
+				CFRelease(datas[index]);
+			CFDictionarySetValue(dict,field->key,array);
+			CFRelease(array);
+			break;
+		}
+		case 'h':
+			BenchPutArray(dict,field->key,&gBenchChannelEntry,values);
+			break;
+		case 't':
+			BenchPutArray(dict,field->key,&gBenchStateEntry,values);
+			break;
+		case 'n':
+		case 'N':
+		{
+			CFMutableDictionaryRef methodsReturn = BenchNewDict();
+			
+			BenchPutFields(methodsReturn,(field->kind=='n') ? &gBenchMethodsReturn : &gBenchChannelsReturn,values);
+			CFDictionarySetValue(dict,field->key,methodsReturn);
+			CFRelease(methodsReturn);
+			break;
+		}
+		case 'l'://one smoothing stage
+		{
+			CFMutableDictionaryRef	stage = BenchNewDict();
+			CFNumberRef				param = CFNumberCreate(kCFAllocatorDefault,kCFNumberFloatType,&values->real);
+			CFArrayRef				params = CFArrayCreate(kCFAllocatorDefault,(const void**)&param,1,&kCFTypeArrayCallBacks);
+			CFArrayRef				stages;
+			
+			CFDictionarySetValue(stage,CFSTR(k3FilterType),CFSTR(k3FilterSmooth));
+			CFDictionarySetValue(stage,CFSTR(k3FilterParams),params);
+			stages = CFArrayCreate(kCFAllocatorDefault,(const void**)&stage,1,&kCFTypeArrayCallBacks);
+			CFDictionarySetValue(dict,field->key,stages);
+			CFRelease(stages);
+			CFRelease(params);
+			CFRelease(param);
+			CFRelease(stage);
+			break;
+		}
+	}
+}
+
+static void
+BenchPutFields(CFMutableDictionaryRef dict, const TBenchFields *fields, TBenchValues *values)
+{
+	TQ3Uns32 index;
+	
+	for (index=0; index<fields->count; index++)
+		BenchPutField(dict,&fields->field[index],values);
+}
+
+
+
+//=============================================================================
+//      BenchGetField : Unmarshal one field the way the repository does.
+//-----------------------------------------------------------------------------
+static void BenchGetFields(CFDictionaryRef dict, const TBenchFields *fields, TBenchValues *values);
+
+static void
+BenchGetArray(CFDictionaryRef dict, CFStringRef key, const TBenchFields *entry, TBenchValues *values)
+{
+	CFArrayRef	array = (CFArrayRef)CFDictionaryGetValue(dict,key);
+	CFIndex		index;
+	
+	for (index=0; index<CFArrayGetCount(array); index++)
+		BenchGetFields((CFDictionaryRef)CFArrayGetValueAtIndex(array,index),entry,values);
+}
+
+static void
+BenchGetField(CFDictionaryRef dict, const TBenchField *field, TBenchValues *values)
+{
+	switch (field->kind)
+	{
+		case 'r':
+			IPCGetControllerRef(dict,field->key,&values->controllerRef);
+			break;
+		case 'u':
+			IPCGetTQ3Uns32(dict,field->key,&values->uns32);
+			break;
+		case 'b':
+			IPCGetTQ3Boolean(dict,field->key,&values->boolean);
+			break;
+		case 'p':
+			IPCGetTQ3Point3D(dict,field->key,&values->point);
+			break;
+		case 'v':
+			IPCGetTQ3Vector3D(dict,field->key,&values->vector);
+			break;
+		case 'q':
+			IPCGetTQ3Quaternion(dict,field->key,&values->quaternion);
+			break;
+		case 'f':
+			IPCGetBytes(dict,field->key,sizeof(float),&values->real);
+			break;
+		case 'd':
+			IPCGetBytes(dict,field->key,kBenchDataSize,values->data);
+			break;
+		case 'm':
+			IPCGetBytes(dict,field->key,sizeof(void*),&values->methodRef);
+			break;
+		case 'c':
+			IPCGetBytes(dict,field->key,sizeof(TQ3ControllerData),&values->controllerData);
+			break;
+		case 's':
+			CFStringGetCString((CFStringRef)CFDictionaryGetValue(dict,field->key),values->text,sizeof(values->text),kCFStringEncodingASCII);
+			break;
+		case 'a':
+		case 'x':
+		{
+			CFArrayRef	array = (CFArrayRef)CFDictionaryGetValue(dict,field->key);
+			CFIndex		index;
+			
+			for (index=0; (index<CFArrayGetCount(array)) && (index<kBenchValueCount); index++)
+				if (field->kind=='a')
+					CFNumberGetValue((CFNumberRef)CFArrayGetValueAtIndex(array,index),kCFNumberFloatType,&values->values[index]);
+				else
+					CFNumberGetValue((CFNumberRef)CFArrayGetValueAtIndex(array,index),kCFNumberSInt32Type,&values->uns32);
+			break;
+		}
+		case 'g':
+		{
+			CFArrayRef	array = (CFArrayRef)CFDictionaryGetValue(dict,field->key);
+			CFIndex		index;
+			
+			for (index=0; index<CFArrayGetCount(array); index++)
+				CFDataGetBytes((CFDataRef)CFArrayGetValueAtIndex(array,index),CFRangeMake(0,kBenchDataSize),values->data);
+			break;
+		}
+		case 'h':
+			BenchGetArray(dict,field->key,&gBenchChannelEntry,values);
+			break;
+		case 't':
+			BenchGetArray(dict,field->key,&gBenchStateEntry,values);
+			break;
+		case 'n':
+		case 'N':
+			BenchGetFields((CFDictionaryRef)CFDictionaryGetValue(dict,field->key),
+							(field->kind=='n') ? &gBenchMethodsReturn : &gBenchChannelsReturn,values);
+			break;
+		case 'l':
+		{
+			CFArrayRef		stages = (CFArrayRef)CFDictionaryGetValue(dict,field->key);
+			CFDictionaryRef	stage = (CFDictionaryRef)CFArrayGetValueAtIndex(stages,0);
+			CFArrayRef		params = (CFArrayRef)CFDictionaryGetValue(stage,CFSTR(k3FilterParams));
+			
+			values->boolean = CFEqual(CFDictionaryGetValue(stage,CFSTR(k3FilterType)),CFSTR(k3FilterSmooth)) ? kQ3True : kQ3False;
+			CFNumberGetValue((CFNumberRef)CFArrayGetValueAtIndex(params,0),kCFNumberFloatType,&values->real);
+			break;
+		}
+	}
+}
+
+static void
+BenchGetFields(CFDictionaryRef dict, const TBenchFields *fields, TBenchValues *values)
+{
+	TQ3Uns32 index;
+	
+	for (index=0; index<fields->count; index++)
+		BenchGetField(dict,&fields->field[index],values);
+}
+
+
+
+//=============================================================================
+//      BenchEncode : Build the dictionary of a message and serialize it, as
+//				before CFMessagePortSendRequest.
+//-----------------------------------------------------------------------------
+static CFDataRef
+BenchEncode(const TBenchFields *fields, TBenchValues *values)
+{
+	CFMutableDictionaryRef	dict = BenchNewDict();
+	CFDataRef				data;
+	
+	BenchPutFields(dict,fields,values);
+	data = CFPropertyListCreateXMLData(kCFAllocatorDefault,dict);
+	CFRelease(dict);
+	return(data);
+}
+
+
+
+//=============================================================================
+//      Benchmark procs
+//-----------------------------------------------------------------------------
+static void
+BenchProcPut(void *context, TQ3Uns32 iterations)
+{
+	TBenchMarshal	*marshal = (TBenchMarshal*)context;
+	TQ3Uns32		i;
+	
+	for (i=0; i<iterations; i++)
+		BenchPutField(marshal->dict,&marshal->fields->field[0],marshal->values);
+}
+
+static void
+BenchProcGet(void *context, TQ3Uns32 iterations)
+{
+	TBenchMarshal	*marshal = (TBenchMarshal*)context;
+	TQ3Uns32		i;
+	
+	for (i=0; i<iterations; i++)
+		BenchGetField(marshal->dict,&marshal->fields->field[0],marshal->values);
+}
+
+static void
+BenchProcEncode(void *context, TQ3Uns32 iterations)
+{
+	TBenchMarshal	*marshal = (TBenchMarshal*)context;
+	TQ3Uns32		i;
+	
+	for (i=0; i<iterations; i++)
+	{
+		CFDataRef data = BenchEncode(marshal->fields,marshal->values);
+		if (data!=NULL)
+			CFRelease(data);
+	}
+}
+
+static void
+BenchProcDecode(void *context, TQ3Uns32 iterations)
+{
+	TBenchMarshal	*marshal = (TBenchMarshal*)context;
+	TQ3Uns32		i;
+	
+	for (i=0; i<iterations; i++)
+	{
+		CFStringRef		error = NULL;
+		CFDictionaryRef	dict = (CFDictionaryRef)CFPropertyListCreateFromXMLData(kCFAllocatorDefault,marshal->data,kCFPropertyListImmutable,&error);
+		
+		if (error!=NULL)
+			CFRelease(error);
+		if (dict!=NULL)
+		{
+			BenchGetFields(dict,marshal->fields,marshal->values);
+			CFRelease(dict);
+		}
+	}
+}
+
+static void
+BenchProcDispatch(void *context, TQ3Uns32 iterations)
+{
+	TBenchDispatch	*dispatch = (TBenchDispatch*)context;
+	TQ3Uns32		i;
+	
+	for (i=0; i<iterations; i++)
+	{
+		CFDataRef returnData = IPCControllerDispatcher(NULL,dispatch->msgid,dispatch->data,NULL);
+		if (returnData!=NULL)
+			CFRelease(returnData);
+	}
+}
+
+static void
+BenchProcRefInList(void *context, TQ3Uns32 iterations)
+{
+	TBenchDB			*db = (TBenchDB*)context;
+	TQ3Uns32			i, hits = 0;
+	
+	for (i=0; i<iterations; i++)
+		hits += (ControllerDB_refinlist(db->controllerRef)==kQ3True);
+	gBenchSink = hits;
+}
+
+static void
+BenchProcNew(void *context, TQ3Uns32 iterations)
+{
+	TBenchDB			*db = (TBenchDB*)context;
+	TQ3Uns32			i;
+	
+	for (i=0; i<iterations; i++)
+		ControllerDB_New(db->controllerData);
+}
+
+static void
+BenchProcRingAppend(void *context, TQ3Uns32 iterations)
+{
+	TBenchRing			*bench = (TBenchRing*)context;
+	TQ3Uns32			i;
+	
+	for (i=0; i<iterations; i++)
+	{
+		TC3TrackerEventPtr event = CC3EventRing_Insert(&bench->ring,bench->stamp++);
+		event->EventButtons = 0;
+		event->EventPosition = bench->position;
+		event->EventPositionIsNULL = kQ3False;
+		event->EventOrientation = bench->orientation;
+		event->EventOrientationIsNULL = kQ3False;
+	}
+}
+
+static void
+BenchProcRingLate(void *context, TQ3Uns32 iterations)
+{
+	TBenchRing			*bench = (TBenchRing*)context;
+	TQ3Uns32			i;
+	
+	//every other event arrives one stamp late and is moved past its successor
+	for (i=0; i<iterations; i++)
+	{
+		TC3TrackerEventPtr event = CC3EventRing_Insert(&bench->ring,(i&1) ? bench->stamp-2 : bench->stamp);
+		bench->stamp++;
+		if (event==NULL)
+			continue;
+		event->EventButtons = 0;
+		event->EventPosition = bench->position;
+		event->EventPositionIsNULL = kQ3False;
+		event->EventOrientation = bench->orientation;
+		event->EventOrientationIsNULL = kQ3False;
+	}
+}
+
+static void
+BenchProcRingFind(void *context, TQ3Uns32 iterations)
+{
+	TBenchRing			*bench = (TBenchRing*)context;
+	TQ3Uns32			i, sum = 0;
+	TQ3Uns32			oldest = CC3EventRing_At(&bench->ring,0)->EventTimeStamp;
+	
+	//stamps spread over the whole history
+	for (i=0; i<iterations; i++)
+		sum += CC3EventRing_Locate(&bench->ring,NULL,oldest + ((i*2654435761u) & (bench->ring.count-1)));
+	gBenchSink = sum;
+}
+
+static void
+BenchProcRingCursor(void *context, TQ3Uns32 iterations)
+{
+	TBenchRing			*bench = (TBenchRing*)context;
+	TQ3Uns32			i, sum = 0;
+	TQ3Uns32			oldest = CC3EventRing_At(&bench->ring,0)->EventTimeStamp;
+	
+	//ascending stamps, as a renderer samples frame by frame
+	bench->sequence = bench->ring.firstSequence;
+	for (i=0; i<iterations; i++)
+		sum += CC3EventRing_Locate(&bench->ring,&bench->sequence,oldest + (i & (bench->ring.count-1)));
+	gBenchSink = sum;
+}
+
+static void
+BenchProcMultiply(void *context, TQ3Uns32 iterations)
+{
+	TBenchKernel		*kernel = (TBenchKernel*)context;
+	TQ3Uns32			done, count;
+	
+	for (done=0; done<iterations; done+=count)
+	{
+		count = (iterations-done<kBenchKernelCount) ? iterations-done : kBenchKernelCount;
+		CC3Quaternion_MultiplyArray(count,kernel->q1,kernel->q2,kernel->result);
+	}
+}
+
+static void
+BenchProcNormalize(void *context, TQ3Uns32 iterations)
+{
+	TBenchKernel		*kernel = (TBenchKernel*)context;
+	TQ3Uns32			done, count;
+	
+	for (done=0; done<iterations; done+=count)
+	{
+		count = (iterations-done<kBenchKernelCount) ? iterations-done : kBenchKernelCount;
+		CC3Quaternion_NormalizeArray(count,kernel->q2,kernel->result);
+	}
+}
+
+static void
+BenchProcSetRotate(void *context, TQ3Uns32 iterations)
+{
+	TBenchKernel		*kernel = (TBenchKernel*)context;
+	TQ3Uns32			done, count;
+	
+	for (done=0; done<iterations; done+=count)
+	{
+		count = (iterations-done<kBenchKernelCount) ? iterations-done : kBenchKernelCount;
+		CC3Quaternion_SetRotateXYZArray(count,kernel->angles,kernel->result);
+	}
+}
+
+static void
+BenchProcReachesAngle(void *context, TQ3Uns32 iterations)
+{
+	TBenchKernel		*kernel = (TBenchKernel*)context;
+	TQ3Uns32			i, hits = 0;
+	
+	for (i=0; i<iterations; i++)
+		hits += (CC3Quaternion_ReachesAngle(&kernel->q1[i & (kBenchKernelCount-1)],kernel->thresholdCos)==kQ3True);
+	gBenchSink = hits;
+}
+
+
+
+//=============================================================================
+//      BenchInitValues : Field values of every marshalled message.
+//-----------------------------------------------------------------------------
+//		Note : uns32 serves as channel, data size and value count alike, so
+//				it is kBenchValueCount == kBenchDataSize < kBenchChannelCount.
+//-----------------------------------------------------------------------------
+static void
+BenchInitValues(TBenchValues *values, TQ3ControllerData *controllerData)
+{
+	TQ3Uns32 index;
+	
+	memset(values,0,sizeof(TBenchValues));
+	values->controllerRef = (TQ3ControllerRef) values;
+	values->controllerData = *controllerData;
+	values->uns32 = kBenchValueCount;
+	values->boolean = kQ3True;
+	values->real = 0.5f;
+	values->point.x = 1.0f;
+	values->point.y = 2.0f;
+	values->point.z = 3.0f;
+	values->vector.x = 0.1f;
+	values->vector.y = 0.2f;
+	values->vector.z = 0.3f;
+	values->quaternion.w = 1.0f;
+	for (index=0; index<kBenchDataSize; index++)
+		values->data[index] = (UInt8) index;
+	values->methodRef = (void*) BenchChannelSet;
+	for (index=0; index<kBenchValueCount; index++)
+		values->values[index] = 0.1f*index;
+	values->string = CFSTR(kQuesa3DeviceDriver ".bench");
+}
+
+
+
+//=============================================================================
+//      BenchControllerData : Public data of a controller to register.
+//-----------------------------------------------------------------------------
+static void
+BenchControllerData(TQ3ControllerData *controllerData, char *signature, TQ3Uns32 number)
+{
+	sprintf(signature,kBenchSignature,(unsigned) number);
+	controllerData->signature = signature;
+	controllerData->valueCount = kBenchValueCount;
+	controllerData->channelCount = kBenchChannelCount;
+	controllerData->channelGetMethod = BenchChannelGet;
+	controllerData->channelSetMethod = BenchChannelSet;
+}
+
+
+
+//=============================================================================
+//      BenchMarshalling : Every IPCPut*/IPCGet* helper, then encode and
+//				decode of every message type.
+//-----------------------------------------------------------------------------
+static void
+BenchMarshalling(TBenchValues *values)
+{
+	TBenchValues	sink = *values;
+	TBenchFields	fields;
+	TBenchMarshal	marshal;
+	char			name[128], spec[256];
+	TQ3Uns32		index, side;
+	
+	for (index=0; index<sizeof(gBenchHelpers)/sizeof(gBenchHelpers[0]); index++)
+	{
+		BenchParseFields(gBenchHelpers[index][0],&fields);
+		marshal.fields = &fields;
+		marshal.dict = BenchNewDict();
+		
+		marshal.values = values;
+		sprintf(name,"put.%s",gBenchHelpers[index][1]);
+		BenchRun(name,BenchProcPut,&marshal);
+		
+		marshal.values = &sink;
+		sprintf(name,"get.%s",gBenchHelpers[index][1]);
+		BenchRun(name,BenchProcGet,&marshal);
+		
+		CFRelease(marshal.dict);
+		BenchDisposeFields(&fields);
+	}
+	
+	for (index=0; index<sizeof(gBenchMessages)/sizeof(gBenchMessages[0]); index++)
+		for (side=0; side<2; side++)
+		{
+			if (side==0)
+				BenchParseFields(gBenchMessages[index].request,&fields);
+			else
+			{
+				sprintf(spec,"%s u%s",gBenchMessages[index].reply,k3Status);
+				BenchParseFields(spec,&fields);
+			}
+			marshal.fields = &fields;
+			
+			marshal.values = values;
+			sprintf(name,"msg.%s.%s.encode",gBenchMessages[index].name,(side==0) ? "request" : "reply");
+			BenchRun(name,BenchProcEncode,&marshal);
+			
+			marshal.values = &sink;
+			marshal.data = BenchEncode(&fields,values);
+			sprintf(name,"msg.%s.%s.decode",gBenchMessages[index].name,(side==0) ? "request" : "reply");
+			if (marshal.data!=NULL)
+			{
+				BenchRun(name,BenchProcDecode,&marshal);
+				CFRelease(marshal.data);
+			}
+			BenchDisposeFields(&fields);
+		}
+}
+
+
+
+//=============================================================================
+//      BenchDispatch : Serialized requests through IPCControllerDispatcher,
+//				as the server's message port delivers them.
+//-----------------------------------------------------------------------------
+//		Note : Messages that would park the request, create objects, or
+//				need a tracker are left out.
+//-----------------------------------------------------------------------------
+static void
+BenchDispatch(TBenchValues *values, TQ3ControllerRef controllerRef)
+{
+	TBenchValues	dispatchValues = *values;
+	TBenchFields	fields;
+	TBenchDispatch	dispatch;
+	char			name[128];
+	TQ3Uns32		index;
+	
+	dispatchValues.controllerRef = controllerRef;
+	
+	for (index=0; index<sizeof(gBenchMessages)/sizeof(gBenchMessages[0]); index++)
+	{
+		if (gBenchMessages[index].dispatch==kQ3False)
+			continue;
+		
+		BenchParseFields(gBenchMessages[index].request,&fields);
+		dispatch.msgid = gBenchMessages[index].msgid;
+		dispatch.data = BenchEncode(&fields,&dispatchValues);
+		sprintf(name,"dispatch.%s",gBenchMessages[index].name);
+		if (dispatch.data!=NULL)
+		{
+			BenchRun(name,BenchProcDispatch,&dispatch);
+			CFRelease(dispatch.data);
+		}
+		BenchDisposeFields(&fields);
+	}
+}
+
+
+
+//=============================================================================
+//      BenchControllerDB : ControllerDB_refinlist and ControllerDB_New
+//				with 1, 10, 100 and 1000 controllers registered.
+//-----------------------------------------------------------------------------
+//		Note : The list only grows; the controller of BenchDispatch is the
+//				first one. Lookups and re-registrations hit the newest
+//				controller, the end of the list.
+//-----------------------------------------------------------------------------
+static void
+BenchControllerDB(TBenchValues *values)
+{
+	static const TQ3Uns32	sizes[] = { 1, 10, 100, kBenchControllers };
+	TQ3ControllerData		*registry = (TQ3ControllerData*) malloc(kBenchControllers*sizeof(TQ3ControllerData));
+	char					*signatures = (char*) malloc(kBenchControllers*32);
+	TQ3Uns32				count = 1, index, added;
+	TBenchDB				db;
+	char					name[128];
+	double					t0, ns;
+	
+	if ((registry==NULL) || (signatures==NULL))
+	{
+		free(registry);
+		free(signatures);
+		return;
+	}
+	
+	for (index=0; index<sizeof(sizes)/sizeof(sizes[0]); index++)
+	{
+		//grow to sizes[index]; what a new registration costs at this size
+		added = sizes[index]-count;
+		gBenchAllocs = gBenchBytes = 0;
+		gBenchCounting = 1;
+		t0 = BenchNow();
+		for (; count<sizes[index]; count++)
+		{
+			BenchControllerData(&registry[count],&signatures[count*32],count);
+			db.controllerRef = ControllerDB_New(&registry[count]);
+		}
+		ns = BenchNow()-t0;
+		gBenchCounting = 0;
+		
+		sprintf(name,"db.New.fresh.%u",(unsigned) sizes[index]);
+		if ((added>0) && (BenchSelected(name)==kQ3True))
+			BenchReport(name,added,ns,gBenchAllocs,gBenchBytes);
+		
+		if (count==1)
+		{
+			//the controller of BenchDispatch
+			BenchControllerData(&registry[0],&signatures[0],0);
+			db.controllerRef = ControllerDB_New(&registry[0]);
+		}
+		db.controllerData = &registry[count-1];
+		
+		sprintf(name,"db.refinlist.hit.%u",(unsigned) sizes[index]);
+		BenchRun(name,BenchProcRefInList,&db);
+		
+		sprintf(name,"db.New.existing.%u",(unsigned) sizes[index]);
+		BenchRun(name,BenchProcNew,&db);
+		
+		db.controllerRef = values->controllerRef;//never registered
+		sprintf(name,"db.refinlist.miss.%u",(unsigned) sizes[index]);
+		BenchRun(name,BenchProcRefInList,&db);
+	}
+	
+	//the controllers stay registered, so their data does too
+}
+
+
+
+//=============================================================================
+//      BenchEventRing : CC3EventRing insert and lookup on a full ring.
+//-----------------------------------------------------------------------------
+static void
+BenchEventRing(const TBenchValues *values)
+{
+	static const TQ3Uns32	capacities[] = { 16, 1024 };
+	TBenchRing				bench;
+	char					name[128];
+	TQ3Uns32				index;
+	
+	for (index=0; index<sizeof(capacities)/sizeof(capacities[0]); index++)
+	{
+		if (CC3EventRing_Init(&bench.ring,capacities[index])==kQ3Failure)
+			continue;
+		bench.stamp = 1;
+		bench.sequence = 0;
+		bench.position = values->point;
+		bench.orientation = values->quaternion;
+		BenchProcRingAppend(&bench,capacities[index]);
+		
+		sprintf(name,"ring.Insert.append.%u",(unsigned) capacities[index]);
+		BenchRun(name,BenchProcRingAppend,&bench);
+		
+		sprintf(name,"ring.Insert.late.%u",(unsigned) capacities[index]);
+		BenchRun(name,BenchProcRingLate,&bench);
+		
+		sprintf(name,"ring.Locate.%u",(unsigned) capacities[index]);
+		BenchRun(name,BenchProcRingFind,&bench);
+		
+		sprintf(name,"ring.Locate.cursor.%u",(unsigned) capacities[index]);
+		BenchRun(name,BenchProcRingCursor,&bench);
+		
+		CC3EventRing_Dispose(&bench.ring);
+	}
+}
+
+
+
+//=============================================================================
+//      BenchKernels : The quaternion kernels of C3QuaternionMath.c, per
+//				quaternion.
+//-----------------------------------------------------------------------------
+static void
+BenchKernels(void)
+{
+	TBenchKernel	kernel;
+	TQ3Uns32		index;
+	
+	kernel.q1		= (TQ3Quaternion*) malloc(kBenchKernelCount*sizeof(TQ3Quaternion));
+	kernel.q2		= (TQ3Quaternion*) malloc(kBenchKernelCount*sizeof(TQ3Quaternion));
+	kernel.result	= (TQ3Quaternion*) malloc(kBenchKernelCount*sizeof(TQ3Quaternion));
+	kernel.angles	= (TQ3Vector3D*) malloc(kBenchKernelCount*sizeof(TQ3Vector3D));
+	
+	if ((kernel.q1!=NULL) && (kernel.q2!=NULL) && (kernel.result!=NULL) && (kernel.angles!=NULL))
+	{
+		//small per-packet rotations, as a SpaceMouse delivers them
+		srand(1);
+		for (index=0; index<kBenchKernelCount; index++)
+		{
+			kernel.angles[index].x = 0.1f * ((float) rand() / (float) RAND_MAX - 0.5f);
+			kernel.angles[index].y = 0.1f * ((float) rand() / (float) RAND_MAX - 0.5f);
+			kernel.angles[index].z = 0.1f * ((float) rand() / (float) RAND_MAX - 0.5f);
+		}
+		CC3Quaternion_SetRotateXYZArray(kBenchKernelCount,kernel.angles,kernel.q1);
+		CC3Quaternion_MultiplyArray(kBenchKernelCount,kernel.q1,kernel.q1,kernel.q2);
+		kernel.thresholdCos = CC3Quaternion_AngleThresholdCos(0.01f);
+		
+		BenchRun("quaternion.MultiplyArray",BenchProcMultiply,&kernel);
+		BenchRun("quaternion.NormalizeArray",BenchProcNormalize,&kernel);
+		BenchRun("quaternion.SetRotateXYZArray",BenchProcSetRotate,&kernel);
+		BenchRun("quaternion.ReachesAngle",BenchProcReachesAngle,&kernel);
+	}
+	
+	free(kernel.q1);
+	free(kernel.q2);
+	free(kernel.result);
+	free(kernel.angles);
+}
+
+
+
+
+
+//=============================================================================
+//      main
+//-----------------------------------------------------------------------------
+int
+main(int argc, char *argv[])
+{
+	TQ3ControllerData	dispatchData;
+	char				dispatchSignature[32];
+	TBenchValues		values;
+	TQ3ControllerRef	controllerRef;
+	
+	if (argc>1 && argv[1][0]!=0)
+		gBenchFilter = argv[1];
+	if (argc>2)
+		gBenchMinTime = atoi(argv[2])*1.0e6;
+	if ((argc>3) || (gBenchMinTime<=0.0))
+	{
+		fprintf(stderr,"usage: %s [filter] [milliseconds]\n",argv[0]);
+		return(1);
+	}
+	
+	BenchInstallCounter();
+	printf("{\"bench\":\"_meta\",\"alloc_counter\":\"%s\"}\n",kBenchAllocCounter);
+	
+	BenchParseFields("u" k3Channel " d" k3Data " u" k3DataSize,&gBenchChannelEntry);
+	BenchParseFields("r" k3CtrlRef " u" k3CtrlStateHandle,&gBenchStateEntry);
+	BenchParseFields("u" k3Status " d" k3Data " u" k3DataSize,&gBenchMethodsReturn);
+	BenchParseFields("u" k3Status " h" k3Channels,&gBenchChannelsReturn);
+	
+	BenchControllerData(&dispatchData,dispatchSignature,0);
+	BenchInitValues(&values,&dispatchData);
+	
+	BenchMarshalling(&values);
+	
+	//first controller of the list, with a driver that answers in process
+	controllerRef = ControllerDB_New(&dispatchData);
+	if (controllerRef!=NULL)
+	{
+		ControllerDB_SetDriverPortName(controllerRef,values.string);
+		BenchDispatch(&values,controllerRef);
+	}
+	
+	BenchControllerDB(&values);
+	BenchEventRing(&values);
+	BenchKernels();
+	
+	BenchDisposeFields(&gBenchChannelEntry);
+	BenchDisposeFields(&gBenchStateEntry);
+	BenchDisposeFields(&gBenchMethodsReturn);
+	BenchDisposeFields(&gBenchChannelsReturn);
+	
+	return(0);
+}
@@ -0,0 +1,511 @@
+/*  NAME:
+        EvdevBackendTest.c
+
+    DESCRIPTION:
+        Checks the evdev backend of DriverHost against devices emulated with
+		uinput: an absolute and a relative 6-DoF device, a gamepad and a
+		touchpad go through EvdevBackend_Open, and their events through the
+		backend's read and service. Asserts the classification, the axis
+		mapping, the repeat of a held deflection and the reported buttons.
+		
+		Build and run as a user who may write /dev/uinput, from this directory:
+		
+		    cc -O2 -I../../DriverHost -I<Quesa includes> EvdevBackendTest.c ../../DriverHost/EvdevBackend.c -o EvdevBackendTest
+		    ./EvdevBackendTest
+		
+		Exits with 0, if all cases pass, and with 2, if uinput is unavailable.
+      
+    COPYRIGHT:
+        Copyright (c) 1999-2005, Quesa Developers. All rights reserved.
+
+        For the current release of Quesa, please see:
+
+            <http://www.quesa.org/>
+        
+        Redistribution and use in source and binary forms, with or without
+        modification, are permitted provided that the following conditions
+        are met:
+        
+            o Redistributions of source code must retain the above copyright
+              notice, this list of conditions and the following disclaimer.
+        
+            o Redistributions in binary form must reproduce the above
+              copyright notice, this list of conditions and the following
+              disclaimer in the documentation and/or other materials provided
+              with the distribution.
+        
+            o Neither the name of Quesa nor the names of its contributors
+              may be used to endorse or promote products derived from this
+              software without specific prior written permission.
+        
+        THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+        "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+        LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+        A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+        OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+        SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+        TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+        PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+        LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+        NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+        SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+    ___________________________________________________________________________
+*/
+
+
+
+//=============================================================================
+//      Include files
+//-----------------------------------------------------------------------------
+#include "DriverHost.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <linux/input.h>
+#include <linux/uinput.h>
+
+
+
+
+
+//=============================================================================
+//      Internal constants
+//-----------------------------------------------------------------------------
+#define kTestUinputPath				"/dev/uinput"
+#define kTestSysfsInput				"/sys/devices/virtual/input"
+#define kTestNodeWait				100		//times 10 ms for udev to create a node
+#define kTestReadWait				1000	//ms
+#define kTestRepeatInterval			(1.0/60.0)
+#define kTestFullDeflection			350
+
+#define kTestNear(_a, _b)			((((_a)-(_b))<1.0e-4f) && (((_b)-(_a))<1.0e-4f))
+
+
+
+
+
+//=============================================================================
+//      Internal types
+//-----------------------------------------------------------------------------
+//what the backend reported through DriverHost_Report*
+typedef struct TTestLog
+{
+	TQ3Uns32				motionCount;
+	float					translation[3];
+	float					rotation[3];
+	TQ3Uns32				buttonsCount;
+	TQ3Uns32				buttons;
+	TQ3Uns32				valuesCount;
+	float					values[kDriverHostMaxValues];
+} TTestLog;
+
+//an emulated device, and the backend's view of it
+typedef struct TTestDevice
+{
+	int						uinput;
+	char					path[kDriverHostPathSize];
+	TDriverDevice			device;
+	TQ3Boolean				isOpen;
+} TTestDevice;
+
+
+
+
+
+//=============================================================================
+//      Internal variables
+//-----------------------------------------------------------------------------
+static TTestLog				testLog;
+static double				testNow = 1000.0;
+
+
+
+
+
+//=============================================================================
+//      DriverHost stubs
+//-----------------------------------------------------------------------------
+double
+DriverHost_Now(void)
+{
+	return(testNow);
+}
+
+void
+DriverHost_ReportMotion(TDriverDevice *device, const float translation[3], const float rotation[3])
+{
+	testLog.motionCount++;
+	memcpy(testLog.translation, translation, sizeof(testLog.translation));
+	memcpy(testLog.rotation, rotation, sizeof(testLog.rotation));
+}
+
+void
+DriverHost_ReportButtons(TDriverDevice *device, TQ3Uns32 buttons)
+{
+	testLog.buttonsCount++;
+	testLog.buttons = buttons;
+}
+
+void
+DriverHost_ReportValues(TDriverDevice *device, TQ3Uns32 firstValue, TQ3Uns32 valueCount, const float *values)
+{
+	testLog.valuesCount++;
+	if (firstValue+valueCount<=kDriverHostMaxValues)
+		memcpy(&testLog.values[firstValue], values, valueCount*sizeof(float));
+}
+
+
+
+
+
+//=============================================================================
+//      Internal functions
+//-----------------------------------------------------------------------------
+//      TestFindNode : Event node of a uinput device.
+//-----------------------------------------------------------------------------
+//		Note : Waits for udev to create /dev/input/eventN.
+//-----------------------------------------------------------------------------
+static int
+TestFindNode(int uinput, char *path)
+{
+	char			sysName[64], sysPath[256];
+	DIR				*dir;
+	struct dirent	*entry;
+	int				wait;
+	
+	memset(sysName, 0, sizeof(sysName));
+	if (ioctl(uinput, UI_GET_SYSNAME(sizeof(sysName)-1), sysName)<0)
+		return(0);
+	
+	snprintf(sysPath, sizeof(sysPath), "%s/%s", kTestSysfsInput, sysName);
+	for (wait=0; wait<kTestNodeWait; wait++)
+	{
+		path[0] = 0;
+		dir = opendir(sysPath);
+		if (dir!=NULL)
+		{
+			while ((entry = readdir(dir))!=NULL)
+				if (strncmp(entry->d_name, "event", 5)==0)
+					snprintf(path, kDriverHostPathSize, "/dev/input/%.32s", entry->d_name);
+			closedir(dir);
+		}
+		
+		if ((path[0]!=0) && (access(path, R_OK)==0))
+			return(1);
+		usleep(10000);
+	}
+	
+	return(0);
+}
+
+
+
+//=============================================================================
+//      TestCreate : Emulate a device and open it with the evdev backend.
+//-----------------------------------------------------------------------------
+//		Note : keys, absAxes and relAxes end with -1; absolute axes range
+//				over [absMinimum, absMaximum]. Returns 0 if uinput failed;
+//				test->isOpen tells whether the backend took the device.
+//-----------------------------------------------------------------------------
+static int
+TestCreate(TTestDevice *test, const char *name, const int *keys, const int *absAxes, int absMinimum, int absMaximum, const int *relAxes)
+{
+	struct uinput_user_dev	setup;
+	int						index;
+	
+	memset(test, 0, sizeof(TTestDevice));
+	test->uinput = open(kTestUinputPath, O_WRONLY | O_NONBLOCK);
+	if (test->uinput==-1)
+		return(0);
+	
+	memset(&setup, 0, sizeof(setup));
+	snprintf(setup.name, UINPUT_MAX_NAME_SIZE, "%s", name);
+	setup.id.bustype	= BUS_VIRTUAL;
+	setup.id.vendor		= 0x1;
+	setup.id.product	= 0x1;
+	
+	if (keys[0]!=-1)
+		ioctl(test->uinput, UI_SET_EVBIT, EV_KEY);
+	for (index=0; keys[index]!=-1; index++)
+		ioctl(test->uinput, UI_SET_KEYBIT, keys[index]);
+	
+	if (absAxes[0]!=-1)
+		ioctl(test->uinput, UI_SET_EVBIT, EV_ABS);
+	for (index=0; absAxes[index]!=-1; index++)
+	{
+		ioctl(test->uinput, UI_SET_ABSBIT, absAxes[index]);
+		setup.absmin[absAxes[index]] = absMinimum;
+		setup.absmax[absAxes[index]] = absMaximum;
+	}
+	
+	if (relAxes[0]!=-1)
+		ioctl(test->uinput, UI_SET_EVBIT, EV_REL);
+	for (index=0; relAxes[index]!=-1; index++)
+		ioctl(test->uinput, UI_SET_RELBIT, relAxes[index]);
+	
+	if ((write(test->uinput, &setup, sizeof(setup))!=(ssize_t) sizeof(setup))
+	||  (ioctl(test->uinput, UI_DEV_CREATE)<0)
+	||  !TestFindNode(test->uinput, test->path))
+	{
+		close(test->uinput);
+		test->uinput = -1;
+		return(0);
+	}
+	
+	memset(&testLog, 0, sizeof(testLog));
+	test->device.backend			= &kDriverBackendEvdev;
+	test->device.fileDescriptor		= -1;
+	test->device.translationScale	= 1.0f;
+	test->device.rotationScale		= 1.0f;
+	test->device.repeatInterval		= kTestRepeatInterval;
+	strcpy(test->device.path, test->path);
+	test->isOpen = (kDriverBackendEvdev.open(&test->device, test->path)==kQ3Success) ? kQ3True : kQ3False;
+	
+	return(1);
+}
+
+
+
+//=============================================================================
+//      TestDispose : Close the backend's side and remove the device.
+//-----------------------------------------------------------------------------
+static void
+TestDispose(TTestDevice *test)
+{
+	if (test->isOpen)
+		kDriverBackendEvdev.close(&test->device);
+	
+	if (test->uinput!=-1)
+	{
+		ioctl(test->uinput, UI_DEV_DESTROY);
+		close(test->uinput);
+	}
+}
+
+
+
+//=============================================================================
+//      TestEmit : Send one event frame and let the backend read it.
+//-----------------------------------------------------------------------------
+//		Note : events holds count type, code, value triples; a SYN_REPORT
+//				ends the frame.
+//-----------------------------------------------------------------------------
+static int
+TestEmit(TTestDevice *test, const int *events, int count)
+{
+	struct input_event	event;
+	struct pollfd		readable;
+	int					index;
+	
+	for (index=0; index<=count; index++)
+	{
+		memset(&event, 0, sizeof(event));
+		if (index<count)
+		{
+			event.type	= (__u16) events[3*index];
+			event.code	= (__u16) events[3*index+1];
+			event.value	= events[3*index+2];
+		}
+		else
+			event.type	= EV_SYN;
+		
+		if (write(test->uinput, &event, sizeof(event))!=(ssize_t) sizeof(event))
+			return(0);
+	}
+	
+	readable.fd			= test->device.fileDescriptor;
+	readable.events		= POLLIN;
+	readable.revents	= 0;
+	if (poll(&readable, 1, kTestReadWait)!=1)
+		return(0);
+	
+	return(kDriverBackendEvdev.read(&test->device)==kQ3Success);
+}
+
+
+
+//=============================================================================
+//      TestReport : One line per case.
+//-----------------------------------------------------------------------------
+static int
+TestReport(const char *name, int passed)
+{
+	printf("%-40s %s\n", name, passed ? "ok" : "FAILED");
+	return(!passed);
+}
+
+
+
+//=============================================================================
+//      TestAbsolute6DoF : Absolute x..rz without joystick buttons.
+//-----------------------------------------------------------------------------
+//		Note : A held deflection is repeated by the service until the axes
+//				are back at zero.
+//-----------------------------------------------------------------------------
+static int
+TestAbsolute6DoF(void)
+{
+	static const int	keys[]		= {BTN_0, BTN_1, -1};
+	static const int	absAxes[]	= {ABS_X, ABS_Y, ABS_Z, ABS_RX, ABS_RY, ABS_RZ, -1};
+	static const int	relAxes[]	= {-1};
+	static const int	deflect[]	= {EV_ABS, ABS_X, 100,	EV_ABS, ABS_Z, -20,	EV_ABS, ABS_RZ, -50};
+	static const int	center[]	= {EV_ABS, ABS_X, 0,	EV_ABS, ABS_Z, 0,	EV_ABS, ABS_RZ, 0};
+	static const int	press[]		= {EV_KEY, BTN_1, 1};
+	TTestDevice			test;
+	int					passed;
+	
+	if (!TestCreate(&test, "EvdevBackendTest 6-DoF", keys, absAxes, -kTestFullDeflection, kTestFullDeflection, relAxes))
+		return(0);
+	
+	passed = test.isOpen && (test.device.valueCount==0)
+		&& (strncmp(test.device.signature, "EvdevBackendTest 6-DoF:evdev:", 29)==0);
+	
+	//one frame, one report of the deflection
+	passed = passed && TestEmit(&test, deflect, 3)
+		&& (testLog.motionCount==1)
+		&& (testLog.translation[0]==100.0f) && (testLog.translation[1]==0.0f) && (testLog.translation[2]==-20.0f)
+		&& (testLog.rotation[0]==0.0f) && (testLog.rotation[1]==0.0f) && (testLog.rotation[2]==-50.0f)
+		&& (test.device.serviceTime==testNow+kTestRepeatInterval);
+	
+	//held: the service repeats it
+	testNow += kTestRepeatInterval;
+	passed = passed && (kDriverBackendEvdev.service(&test.device, testNow)==kQ3Success)
+		&& (testLog.motionCount==2) && (testLog.translation[0]==100.0f) && (testLog.rotation[2]==-50.0f)
+		&& (test.device.serviceTime==testNow+kTestRepeatInterval);
+	
+	//back at zero: no more repeats
+	passed = passed && TestEmit(&test, center, 3)
+		&& (testLog.motionCount==3) && (testLog.translation[0]==0.0f)
+		&& (test.device.serviceTime==0.0);
+	
+	passed = passed && TestEmit(&test, press, 1) && (testLog.buttons==0x2);
+	
+	TestDispose(&test);
+	return(passed);
+}
+
+
+
+//=============================================================================
+//      TestRelative6DoF : Relative x..rz, reported as deltas.
+//-----------------------------------------------------------------------------
+static int
+TestRelative6DoF(void)
+{
+	static const int	keys[]		= {BTN_0, -1};
+	static const int	absAxes[]	= {-1};
+	static const int	relAxes[]	= {REL_X, REL_Y, REL_Z, REL_RX, REL_RY, REL_RZ, -1};
+	static const int	move[]		= {EV_REL, REL_Y, 7,	EV_REL, REL_RX, -3,	EV_REL, REL_RX, -4};
+	static const int	press[]		= {EV_KEY, BTN_0, 1};
+	TTestDevice			test;
+	int					passed;
+	
+	if (!TestCreate(&test, "EvdevBackendTest relative", keys, absAxes, 0, 0, relAxes))
+		return(0);
+	
+	passed = test.isOpen && (test.device.valueCount==0);
+	
+	//deltas of a frame add up; nothing is repeated
+	passed = passed && TestEmit(&test, move, 3)
+		&& (testLog.motionCount==1)
+		&& (testLog.translation[1]==7.0f) && (testLog.rotation[0]==-7.0f)
+		&& (test.device.serviceTime==0.0);
+	
+	passed = passed && TestEmit(&test, press, 1) && (testLog.buttons==0x1);
+	
+	TestDispose(&test);
+	return(passed);
+}
+
+
+
+//=============================================================================
+//      TestGamepad : Absolute axes of a gamepad become values in [-1, 1].
+//-----------------------------------------------------------------------------
+static int
+TestGamepad(void)
+{
+	static const int	keys[]		= {BTN_SOUTH, BTN_EAST, BTN_START, -1};
+	static const int	absAxes[]	= {ABS_X, ABS_Y, -1};
+	static const int	relAxes[]	= {-1};
+	static const int	stick[]		= {EV_ABS, ABS_X, 255,	EV_ABS, ABS_Y, 0};
+	static const int	press[]		= {EV_KEY, BTN_EAST, 1,	EV_KEY, BTN_START, 1};
+	static const int	release[]	= {EV_KEY, BTN_EAST, 0};
+	TTestDevice			test;
+	int					passed;
+	
+	if (!TestCreate(&test, "EvdevBackendTest gamepad", keys, absAxes, 0, 255, relAxes))
+		return(0);
+	
+	passed = test.isOpen && (test.device.valueCount==2);
+	
+	passed = passed && TestEmit(&test, stick, 2)
+		&& (testLog.motionCount==0) && (testLog.valuesCount>=1)
+		&& kTestNear(testLog.values[0], 1.0f) && kTestNear(testLog.values[1], -1.0f);
+	
+	//buttons in declaration order
+	passed = passed && TestEmit(&test, press, 2) && (testLog.buttons==0x6);
+	passed = passed && TestEmit(&test, release, 1) && (testLog.buttons==0x4);
+	
+	TestDispose(&test);
+	return(passed);
+}
+
+
+
+//=============================================================================
+//      TestTouchpad : Absolute axes without joystick buttons are skipped.
+//-----------------------------------------------------------------------------
+static int
+TestTouchpad(void)
+{
+	static const int	keys[]		= {BTN_TOUCH, BTN_LEFT, -1};
+	static const int	absAxes[]	= {ABS_X, ABS_Y, -1};
+	static const int	relAxes[]	= {-1};
+	TTestDevice			test;
+	int					passed;
+	
+	if (!TestCreate(&test, "EvdevBackendTest touchpad", keys, absAxes, 0, 1000, relAxes))
+		return(0);
+	
+	passed = !test.isOpen;
+	
+	TestDispose(&test);
+	return(passed);
+}
+
+
+
+
+
+//=============================================================================
+//      main
+//-----------------------------------------------------------------------------
+int
+main(void)
+{
+	int		failures = 0;
+	int		uinput;
+	
+	uinput = open(kTestUinputPath, O_WRONLY | O_NONBLOCK);
+	if (uinput==-1)
+	{
+		fprintf(stderr, "EvdevBackendTest: cannot open %s - %s(%d)\n", kTestUinputPath, strerror(errno), errno);
+		return(2);
+	}
+	close(uinput);
+	
+	failures += TestReport("absolute 6-DoF: motion, repeat, buttons", TestAbsolute6DoF());
+	failures += TestReport("relative 6-DoF: deltas, buttons", TestRelative6DoF());
+	failures += TestReport("gamepad: values, buttons", TestGamepad());
+	failures += TestReport("touchpad: left to the system", TestTouchpad());
+	
+	return(failures!=0);
+}
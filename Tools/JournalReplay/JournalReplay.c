@@ -0,0 +1,337 @@
+/*  NAME:
+        JournalReplay.c
+
+    DESCRIPTION:
+        Pushes a controller journal, as recorded by the device server with
+		QUESA_CONTROLLER_JOURNAL set, back into a running device server.
+		
+		    JournalReplay [-s speed | -f] [-d] journal
+		
+		    -s speed   replay at speed times the original pace (default 1)
+		    -f         replay as fast as possible
+		    -d         print the records instead of replaying them
+		
+		Build, from this directory:
+		
+		    cc -O2 -I../../QuesaOSXDeviceServer JournalReplay.c -F<dir of Quesa.framework> -framework Quesa -framework Carbon -o JournalReplay
+      
+    COPYRIGHT:
+        Copyright (c) 1999-2005, Quesa Developers. All rights reserved.
+
+        For the current release of Quesa, please see:
+
+            <http://www.quesa.org/>
+        
+        Redistribution and use in source and binary forms, with or without
+        modification, are permitted provided that the following conditions
+        are met:
+        
+            o Redistributions of source code must retain the above copyright
+              notice, this list of conditions and the following disclaimer.
+        
+            o Redistributions in binary form must reproduce the above
+              copyright notice, this list of conditions and the following
+              disclaimer in the documentation and/or other materials provided
+              with the distribution.
+        
+            o Neither the name of Quesa nor the names of its contributors
+              may be used to endorse or promote products derived from this
+              software without specific prior written permission.
+        
+        THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+        "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+        LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+        A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+        OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+        SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+        TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+        PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+        LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+        NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+        SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+    ___________________________________________________________________________
+*/
+
+
+
+//=============================================================================
+//      Include files
+//-----------------------------------------------------------------------------
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <mach/mach_time.h>
+
+#define QUESA_OS_MACINTOSH		1
+#include <Quesa/QuesaController.h>
+
+#include "ControllerJournal.h"
+
+
+
+
+
+//=============================================================================
+//      Internal constants
+//-----------------------------------------------------------------------------
+#define kReplayMaxControllers		256
+#define kReplayMaxValues			256		//kQ3MaxControllerValues of the server
+
+
+
+
+
+//=============================================================================
+//      Internal types
+//-----------------------------------------------------------------------------
+typedef struct TReplayController
+{
+	TQ3ControllerRef		controllerRef;
+	float					values[kReplayMaxValues];
+} TReplayController;
+
+
+
+
+
+//=============================================================================
+//      Internal variables
+//-----------------------------------------------------------------------------
+static TReplayController	controllers[kReplayMaxControllers+1];	//indexed by controllerId
+
+
+
+
+
+//=============================================================================
+//      Internal functions
+//-----------------------------------------------------------------------------
+//      ReplayDump : Print one record.
+//-----------------------------------------------------------------------------
+static void
+ReplayDump(const TC3JournalRecord *record)
+{
+	printf("%12.6f  ctrl %3u  ", (double) record->timeStamp * 1.0e-9, (unsigned) record->controllerId);
+	
+	switch (record->recordType)
+	{
+		case kC3JournalController:
+			printf("controller      \"%s\" values %u\n", record->data.controller.signature, (unsigned) record->data.controller.valueCount);
+			break;
+		case kC3JournalDecommission:
+			printf("decommission\n");
+			break;
+		case kC3JournalActivation:
+			printf("activation      %u\n", (unsigned) record->data.active);
+			break;
+		case kC3JournalButtons:
+			printf("buttons         0x%08x\n", (unsigned) record->data.buttons);
+			break;
+		case kC3JournalSetPosition:
+		case kC3JournalMovePosition:
+			printf("%s  %g %g %g\n", (record->recordType==kC3JournalSetPosition) ? "set position  " : "move position ",
+					record->data.delta.x, record->data.delta.y, record->data.delta.z);
+			break;
+		case kC3JournalSetOrientation:
+		case kC3JournalMoveOrientation:
+			printf("%s  %g %g %g %g\n", (record->recordType==kC3JournalSetOrientation) ? "set orientation " : "move orientation",
+					record->data.orientation.w, record->data.orientation.x, record->data.orientation.y, record->data.orientation.z);
+			break;
+		case kC3JournalValues:
+			printf("values          %u..%u of %u\n", (unsigned) record->data.values.firstValue,
+					(unsigned) (record->data.values.firstValue + record->data.values.chunkCount),
+					(unsigned) record->data.values.valueCount);
+			break;
+		default:
+			printf("unknown type %u\n", (unsigned) record->recordType);
+			break;
+	}
+}
+
+
+
+//=============================================================================
+//      ReplayRecord : Push one record into the device server.
+//-----------------------------------------------------------------------------
+static void
+ReplayRecord(const TC3JournalRecord *record)
+{
+	TReplayController	*controller = &controllers[record->controllerId];
+	
+	if ((record->controllerId==0) || (record->controllerId>kReplayMaxControllers))
+		return;
+	
+	if (record->recordType==kC3JournalController)
+	{
+		TQ3ControllerData	controllerData;
+		char				signature[kC3JournalSignatureSize];
+		
+		memcpy(signature, record->data.controller.signature, kC3JournalSignatureSize);
+		signature[kC3JournalSignatureSize-1] = 0;
+		
+		controllerData.signature		= signature;
+		controllerData.valueCount		= record->data.controller.valueCount;
+		controllerData.channelCount		= 0;	//channels are not journaled
+		controllerData.channelGetMethod	= NULL;
+		controllerData.channelSetMethod	= NULL;
+		
+		controller->controllerRef = Q3Controller_New(&controllerData);
+		return;
+	}
+	
+	if (controller->controllerRef==NULL)
+		return;
+	
+	switch (record->recordType)
+	{
+		case kC3JournalDecommission:
+			Q3Controller_Decommission(controller->controllerRef);
+			break;
+		case kC3JournalActivation:
+			Q3Controller_SetActivation(controller->controllerRef, (record->data.active!=0) ? kQ3True : kQ3False);
+			break;
+		case kC3JournalButtons:
+			Q3Controller_SetButtons(controller->controllerRef, record->data.buttons);
+			break;
+		case kC3JournalSetPosition:
+			Q3Controller_SetTrackerPosition(controller->controllerRef, &record->data.position);
+			break;
+		case kC3JournalMovePosition:
+			Q3Controller_MoveTrackerPosition(controller->controllerRef, &record->data.delta);
+			break;
+		case kC3JournalSetOrientation:
+			Q3Controller_SetTrackerOrientation(controller->controllerRef, &record->data.orientation);
+			break;
+		case kC3JournalMoveOrientation:
+			Q3Controller_MoveTrackerOrientation(controller->controllerRef, &record->data.orientation);
+			break;
+		case kC3JournalValues:
+		{
+			UInt32 first = record->data.values.firstValue;
+			UInt32 count = record->data.values.chunkCount;
+			
+			if ((first+count>kReplayMaxValues) || (count>kC3JournalValuesPerRecord) || (record->data.values.valueCount>kReplayMaxValues))
+				break;
+			
+			memcpy(&controller->values[first], record->data.values.values, count*sizeof(float));
+			
+			//the last chunk completes the call
+			if (first+count==record->data.values.valueCount)
+				Q3Controller_SetValues(controller->controllerRef, controller->values, record->data.values.valueCount);
+			break;
+		}
+		default:
+			break;
+	}
+}
+
+
+
+
+
+//=============================================================================
+//      main
+//-----------------------------------------------------------------------------
+int
+main(int argc, char *argv[])
+{
+	double						speed = 1.0;
+	int							asFastAsPossible = 0, dumpOnly = 0, option;
+	int							fileDescriptor;
+	struct stat					fileInfo;
+	const UInt8					*mapping;
+	const TC3JournalHeader		*header;
+	const TC3JournalRecord		*records;
+	UInt32						recordCount, index;
+	mach_timebase_info_data_t	timebase;
+	uint64_t					startTime, elapsed;
+	double						seconds;
+	
+	while ((option = getopt(argc, argv, "s:fd"))!=-1)
+	{
+		switch (option)
+		{
+			case 's':	speed = atof(optarg);		break;
+			case 'f':	asFastAsPossible = 1;		break;
+			case 'd':	dumpOnly = 1;				break;
+			default:	optind = argc+1;			break;
+		}
+	}
+	
+	if ((optind!=argc-1) || (speed<=0.0))
+	{
+		fprintf(stderr, "usage: %s [-s speed | -f] [-d] journal\n", argv[0]);
+		return(1);
+	}
+	
+	//map the journal
+	fileDescriptor = open(argv[optind], O_RDONLY);
+	if ((fileDescriptor<0) || (fstat(fileDescriptor, &fileInfo)!=0) || (fileInfo.st_size<kC3JournalRecordSize))
+	{
+		fprintf(stderr, "%s: cannot read %s\n", argv[0], argv[optind]);
+		return(1);
+	}
+	
+	mapping = (const UInt8*) mmap(NULL, (size_t) fileInfo.st_size, PROT_READ, MAP_PRIVATE, fileDescriptor, 0);
+	if (mapping==(const UInt8*) MAP_FAILED)
+	{
+		fprintf(stderr, "%s: cannot map %s\n", argv[0], argv[optind]);
+		return(1);
+	}
+	
+	header = (const TC3JournalHeader*) mapping;
+	if ((header->magic!=kC3JournalMagic) || (header->version!=kC3JournalVersion) || (header->recordSize!=kC3JournalRecordSize))
+	{
+		fprintf(stderr, "%s: %s is not a controller journal\n", argv[0], argv[optind]);
+		return(1);
+	}
+	
+	//a journal of a crashed server may be longer than its committed records
+	recordCount = header->recordCount;
+	if ((UInt64) (recordCount+1)*kC3JournalRecordSize > (UInt64) fileInfo.st_size)
+		recordCount = (UInt32) (fileInfo.st_size/kC3JournalRecordSize) - 1;
+	records = (const TC3JournalRecord*) (mapping + kC3JournalRecordSize);
+	
+	if (header->droppedCount!=0)
+		fprintf(stderr, "%s: journal was full, %u records were dropped\n", argv[0], (unsigned) header->droppedCount);
+	
+	if (dumpOnly)
+	{
+		for (index=0; index<recordCount; index++)
+			ReplayDump(&records[index]);
+		return(0);
+	}
+	
+	Q3Initialize();
+	
+	mach_timebase_info(&timebase);
+	startTime = mach_absolute_time();
+	
+	for (index=0; index<recordCount; index++)
+	{
+		if (!asFastAsPossible)
+		{
+			//record time stamps are nanoseconds; mach time units per nanosecond are denom/numer
+			double		dueNanoseconds = (double) records[index].timeStamp / speed;
+			uint64_t	due = startTime + (uint64_t) (dueNanoseconds * timebase.denom / timebase.numer);
+			
+			if (due>mach_absolute_time())
+				mach_wait_until(due);
+		}
+		ReplayRecord(&records[index]);
+	}
+	
+	elapsed = mach_absolute_time() - startTime;
+	seconds = (double) elapsed * timebase.numer / timebase.denom * 1.0e-9;
+	printf("replayed %u records in %.3f s (%.0f records/s)\n", (unsigned) recordCount, seconds, (seconds>0.0) ? recordCount/seconds : 0.0);
+	
+	Q3Exit();
+	
+	munmap((void*) mapping, (size_t) fileInfo.st_size);
+	close(fileDescriptor);
+	return(0);
+}
@@ -0,0 +1,893 @@
+/*  NAME:
+        LatencyBench.c
+
+    DESCRIPTION:
+        Measures end-to-end latency through a running device server, from a
+		simulated driver sample to the tracker notification and to a GetValues
+		read in the clients.
+		
+		    LatencyBench [-r rates] [-c controllers] [-n clients] [-t seconds]
+		                 [-p microseconds] [-S server]
+		
+		    -r rates          samples per second and controller (default 250)
+		    -c controllers    controllers of the simulated driver (default 1)
+		    -n clients        tracker clients (default 1)
+		    -t seconds        length of each run (default 5)
+		    -p microseconds   GetValues polling interval of the clients (default 1000)
+		    -S server         start this device server executable, instead of
+		                      using the one already running
+		
+		rates, controllers and clients take comma separated lists; every
+		combination is run in turn, each with a fresh driver and fresh clients.
+		The driver and the clients are local processes, this executable started
+		again with --driver or --client, talking to the server only through
+		the Quesa controller API.
+		
+		The driver stamps every sample with the monotonic clock, which all
+		processes share, and sends it twice: as tracker position and as
+		controller values, both carrying the sequence number and the stamp in
+		floats that hold 24 bits each exactly. Controller k notifies the
+		tracker of client k modulo clients; every client polls the values of
+		its controllers, a client without controllers polls one. Each run
+		prints one JSON line per path:
+		
+		    {"rate":250,"controllers":1,"clients":1,"path":"notify",
+		     "sent":1250,"count":1250,"late":0,"p50_us":..,"p90_us":..,
+		     "p99_us":..,"p999_us":..,"max_us":..}
+		
+		"notify" is sample to TQ3TrackerNotifyFunc, "read" is sample to the
+		first GetValues returning it, and includes up to one polling interval.
+		"late" counts samples the driver sent more than a period behind
+		schedule, because the server did not keep up.
+		
+		Build, from this directory:
+		
+		    cc -O2 LatencyBench.c -F<dir of Quesa.framework> -framework Quesa -framework Carbon -o LatencyBench
+      
+    COPYRIGHT:
+        Copyright (c) 1999-2005, Quesa Developers. All rights reserved.
+
+        For the current release of Quesa, please see:
+
+            <http://www.quesa.org/>
+        
+        Redistribution and use in source and binary forms, with or without
+        modification, are permitted provided that the following conditions
+        are met:
+        
+            o Redistributions of source code must retain the above copyright
+              notice, this list of conditions and the following disclaimer.
+        
+            o Redistributions in binary form must reproduce the above
+              copyright notice, this list of conditions and the following
+              disclaimer in the documentation and/or other materials provided
+              with the distribution.
+        
+            o Neither the name of Quesa nor the names of its contributors
+              may be used to endorse or promote products derived from this
+              software without specific prior written permission.
+        
+        THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+        "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+        LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+        A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+        OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+        SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+        TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+        PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+        LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+        NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+        SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+    ___________________________________________________________________________
+*/
+
+
+
+//=============================================================================
+//      Include files
+//-----------------------------------------------------------------------------
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <spawn.h>
+#include <sys/wait.h>
+#include <mach/mach_time.h>
+
+#define QUESA_OS_MACINTOSH		1
+#include <Quesa/QuesaController.h>
+
+extern char **environ;
+
+
+
+
+
+//=============================================================================
+//      Internal constants
+//-----------------------------------------------------------------------------
+#define kLatencyMaxControllers		64
+#define kLatencyMaxClients			64
+#define kLatencyMaxSweep			16
+#define kLatencyValueCount			3				//sequence, stamp high and low bits
+#define kLatencyStampBits			24				//floats hold integers up to 2^24 exactly
+#define kLatencyStampMask			0x00FFFFFF
+#define kLatencyGraceNs				500000000.0		//clients listen this long after the driver stopped
+#define kLatencyFindNs				5000000000.0	//clients wait this long for the controllers
+#define kLatencyServerStartNs		2000000000.0	//a started server gets this long to register
+#define kLatencySignature			"latencybench:%s:"	//run tag, the controller index follows
+
+
+
+
+
+//=============================================================================
+//      Internal types
+//-----------------------------------------------------------------------------
+typedef struct TLatencySamples
+{
+	UInt32					*ns;
+	UInt32					count;
+	UInt32					capacity;
+} TLatencySamples;
+
+//a driver or client process and the pipes to its stdin and stdout
+typedef struct TLatencyChild
+{
+	pid_t					pid;
+	FILE					*toChild;
+	FILE					*fromChild;
+} TLatencyChild;
+
+//one controller as seen by a client
+typedef struct TLatencyClientController
+{
+	TQ3ControllerRef		controllerRef;
+	TQ3TrackerObject		tracker;			//NULL if another client gets its notifications
+	TQ3Uns32				notifiedSequence;
+	TQ3Uns32				readSequence;
+} TLatencyClientController;
+
+
+
+
+
+//=============================================================================
+//      Internal variables
+//-----------------------------------------------------------------------------
+static mach_timebase_info_data_t	gLatencyTimebase;
+
+//client state, the notify function and the polling timer have no context
+static TLatencyClientController		gClientControllers[kLatencyMaxControllers];
+static TQ3Uns32						gClientControllerCount = 0;
+static UInt64						gClientBase = 0;
+static TLatencySamples				gClientNotified;
+static TLatencySamples				gClientRead;
+
+
+
+
+
+//=============================================================================
+//      Internal functions
+//-----------------------------------------------------------------------------
+//      LatencyNow : Monotonic time in nanoseconds, the same in all processes.
+//-----------------------------------------------------------------------------
+static UInt64
+LatencyNow(void)
+{
+	if (gLatencyTimebase.denom==0)
+		mach_timebase_info(&gLatencyTimebase);
+	return((UInt64) ((double) mach_absolute_time() * gLatencyTimebase.numer / gLatencyTimebase.denom));
+}
+
+
+
+//=============================================================================
+//      LatencyWaitUntil : Sleep until a LatencyNow time.
+//-----------------------------------------------------------------------------
+static void
+LatencyWaitUntil(UInt64 ns)
+{
+	if (gLatencyTimebase.denom==0)
+		mach_timebase_info(&gLatencyTimebase);
+	mach_wait_until((uint64_t) ((double) ns * gLatencyTimebase.denom / gLatencyTimebase.numer));
+}
+
+
+
+//=============================================================================
+//      LatencyEncode : Pack a sequence number and a stamp into three floats.
+//-----------------------------------------------------------------------------
+//		Note :	The stamp is relative to the start of the run, 48 bits last
+//				for days.
+//-----------------------------------------------------------------------------
+static void
+LatencyEncode(TQ3Uns32 sequence, UInt64 stamp, float *values)
+{
+	values[0] = (float) sequence;
+	values[1] = (float) (stamp >> kLatencyStampBits);
+	values[2] = (float) (stamp & kLatencyStampMask);
+}
+
+
+
+//=============================================================================
+//      LatencyDecode : Unpack what LatencyEncode packed, returns the stamp.
+//-----------------------------------------------------------------------------
+static UInt64
+LatencyDecode(const float *values, TQ3Uns32 *sequence)
+{
+	*sequence = (TQ3Uns32) values[0];
+	return(((UInt64) values[1] << kLatencyStampBits) | (UInt64) values[2]);
+}
+
+
+
+//=============================================================================
+//      LatencySamples_Add : Append one latency, clamped to 32 bits.
+//-----------------------------------------------------------------------------
+static void
+LatencySamples_Add(TLatencySamples *samples, UInt64 ns)
+{
+	if (samples->count==samples->capacity)
+	{
+		UInt32	capacity = (samples->capacity==0) ? 4096 : samples->capacity*2;
+		UInt32	*grown = (UInt32*) realloc(samples->ns, capacity*sizeof(UInt32));
+		
+		if (grown==NULL)
+			return;
+		samples->ns = grown;
+		samples->capacity = capacity;
+	}
+	samples->ns[samples->count++] = (ns>0xFFFFFFFFULL) ? 0xFFFFFFFF : (UInt32) ns;
+}
+
+
+
+//=============================================================================
+//      LatencySamples_Append : Append the latencies a client wrote to a pipe.
+//-----------------------------------------------------------------------------
+static TQ3Status
+LatencySamples_Append(TLatencySamples *samples, UInt32 count, FILE *file)
+{
+	UInt32		value;
+	
+	while (count-->0)
+	{
+		if (fread(&value, sizeof(value), 1, file)!=1)
+			return(kQ3Failure);
+		LatencySamples_Add(samples, value);
+	}
+	return(kQ3Success);
+}
+
+
+
+//=============================================================================
+//      LatencyCompare : qsort order of latencies.
+//-----------------------------------------------------------------------------
+static int
+LatencyCompare(const void *a, const void *b)
+{
+	UInt32	x = *(const UInt32*) a, y = *(const UInt32*) b;
+	
+	return((x<y) ? -1 : (x>y) ? 1 : 0);
+}
+
+
+
+//=============================================================================
+//      LatencyPercentile : Nearest rank percentile of sorted latencies, in us.
+//-----------------------------------------------------------------------------
+static double
+LatencyPercentile(const TLatencySamples *samples, double fraction)
+{
+	if (samples->count==0)
+		return(0.0);
+	return((double) samples->ns[(UInt32) (fraction*(samples->count-1) + 0.5)] * 1.0e-3);
+}
+
+
+
+//=============================================================================
+//      LatencyReport : One JSON line for one path of one run.
+//-----------------------------------------------------------------------------
+static void
+LatencyReport(unsigned rate, unsigned controllerCount, unsigned clientCount, const char *path,
+				TLatencySamples *samples, unsigned long long sent, unsigned long long late)
+{
+	qsort(samples->ns, samples->count, sizeof(UInt32), LatencyCompare);
+	
+	printf("{\"rate\":%u,\"controllers\":%u,\"clients\":%u,\"path\":\"%s\",\"sent\":%llu,\"count\":%u,\"late\":%llu,"
+			"\"p50_us\":%.1f,\"p90_us\":%.1f,\"p99_us\":%.1f,\"p999_us\":%.1f,\"max_us\":%.1f}\n",
+			rate, controllerCount, clientCount, path, sent, (unsigned) samples->count, late,
+			LatencyPercentile(samples,0.50), LatencyPercentile(samples,0.90), LatencyPercentile(samples,0.99),
+			LatencyPercentile(samples,0.999), LatencyPercentile(samples,1.0));
+	fflush(stdout);
+}
+
+
+
+//=============================================================================
+//      LatencyReadGo : Wait for the "go" line, returns the run's base time.
+//-----------------------------------------------------------------------------
+static TQ3Status
+LatencyReadGo(UInt64 *base)
+{
+	char				line[64];
+	unsigned long long	value;
+	
+	if ((fgets(line, sizeof(line), stdin)==NULL) || (sscanf(line, "go %llu", &value)!=1))
+		return(kQ3Failure);
+	*base = value;
+	return(kQ3Success);
+}
+
+
+
+//=============================================================================
+//      LatencyDriver : The --driver process.
+//-----------------------------------------------------------------------------
+//		Note :	Sends the samples round robin over its controllers, at
+//				absolute deadlines so a slow call does not shift the rest.
+//-----------------------------------------------------------------------------
+static int
+LatencyDriver(unsigned rate, unsigned controllerCount, unsigned seconds, const char *tag)
+{
+	TQ3ControllerRef	controllers[kLatencyMaxControllers];
+	TQ3Uns32			sequence[kLatencyMaxControllers];
+	TQ3ControllerData	controllerData;
+	char				signature[128], line[64];
+	float				values[kLatencyValueCount];
+	TQ3Point3D			position;
+	UInt64				base, end, due, now, period;
+	unsigned long long	sent = 0, late = 0;
+	unsigned			index;
+	
+	Q3Initialize();
+	
+	controllerData.valueCount		= kLatencyValueCount;
+	controllerData.channelCount		= 0;
+	controllerData.channelGetMethod	= NULL;
+	controllerData.channelSetMethod	= NULL;
+	
+	for (index=0; index<controllerCount; index++)
+	{
+		snprintf(signature, sizeof(signature), kLatencySignature "%u", tag, index);
+		controllerData.signature = signature;
+		
+		controllers[index] = Q3Controller_New(&controllerData);
+		if (controllers[index]==NULL)
+		{
+			printf("error cannot register controller %u\n", index);
+			return(1);
+		}
+		Q3Controller_SetActivation(controllers[index], kQ3True);
+		sequence[index] = 0;
+	}
+	
+	printf("ready\n");
+	fflush(stdout);
+	if (LatencyReadGo(&base)!=kQ3Success)
+		return(1);
+	
+	period = (UInt64) (1.0e9 / ((double) rate * controllerCount));
+	end = base + (UInt64) seconds * 1000000000ULL;
+	due = LatencyNow();
+	index = 0;
+	
+	while (due<end)
+	{
+		now = LatencyNow();
+		if (due>now)
+			LatencyWaitUntil(due);
+		else if (now-due>period)
+			late++;
+		
+		sequence[index]++;
+		
+		LatencyEncode(sequence[index], LatencyNow()-base, values);
+		position.x = values[0];
+		position.y = values[1];
+		position.z = values[2];
+		Q3Controller_SetTrackerPosition(controllers[index], &position);
+		
+		LatencyEncode(sequence[index], LatencyNow()-base, values);
+		Q3Controller_SetValues(controllers[index], values, kLatencyValueCount);
+		
+		sent++;
+		index = (index+1) % controllerCount;
+		due += period;
+	}
+	
+	printf("sent %llu late %llu\n", sent, late);
+	fflush(stdout);
+	
+	//the clients detach before their controllers go away
+	fgets(line, sizeof(line), stdin);
+	for (index=0; index<controllerCount; index++)
+		Q3Controller_Decommission(controllers[index]);
+	
+	Q3Exit();
+	return(0);
+}
+
+
+
+//=============================================================================
+//      LatencyNotify : Tracker notify function of the clients.
+//-----------------------------------------------------------------------------
+static TQ3Status
+LatencyNotify(TQ3TrackerObject trackerObject, TQ3ControllerRef controllerRef)
+{
+	UInt64						now = LatencyNow() - gClientBase, stamp;
+	TLatencyClientController	*controller;
+	TQ3Point3D					position;
+	float						values[kLatencyValueCount];
+	TQ3Uns32					index, sequence;
+	
+	for (index=0; index<gClientControllerCount; index++)
+		if (gClientControllers[index].tracker==trackerObject)
+			break;
+	if ((index==gClientControllerCount) || (Q3Tracker_GetPosition(trackerObject, &position, NULL, NULL, NULL)!=kQ3Success))
+		return(kQ3Success);
+	
+	values[0] = position.x;
+	values[1] = position.y;
+	values[2] = position.z;
+	stamp = LatencyDecode(values, &sequence);
+	
+	//attaching the tracker notifies too, with nothing new
+	controller = &gClientControllers[index];
+	if ((sequence>controller->notifiedSequence) && (now>=stamp))
+	{
+		controller->notifiedSequence = sequence;
+		LatencySamples_Add(&gClientNotified, now-stamp);
+	}
+	return(kQ3Success);
+}
+
+
+
+//=============================================================================
+//      LatencyPoll : Polling timer of the clients.
+//-----------------------------------------------------------------------------
+//		Note :	Runs on the run loop like the notifications; the server can
+//				still reach the tracker while GetValues waits for its reply.
+//-----------------------------------------------------------------------------
+static void
+LatencyPoll(CFRunLoopTimerRef timer, void *info)
+{
+	TLatencyClientController	*controller;
+	float						values[kLatencyValueCount];
+	TQ3Uns32					index, sequence;
+	UInt64						now, stamp;
+	
+	for (index=0; index<gClientControllerCount; index++)
+	{
+		controller = &gClientControllers[index];
+		if (Q3Controller_GetValues(controller->controllerRef, kLatencyValueCount, values, NULL, NULL)!=kQ3Success)
+			continue;
+		
+		now = LatencyNow() - gClientBase;
+		stamp = LatencyDecode(values, &sequence);
+		if ((sequence>controller->readSequence) && (now>=stamp))
+		{
+			controller->readSequence = sequence;
+			LatencySamples_Add(&gClientRead, now-stamp);
+		}
+	}
+}
+
+
+
+//=============================================================================
+//      LatencyClientFind : Look up the driver's controllers by signature.
+//-----------------------------------------------------------------------------
+static TQ3Uns32
+LatencyClientFind(const char *tag, unsigned controllerCount, TQ3ControllerRef *controllers)
+{
+	TQ3ControllerRef	controllerRef;
+	char				prefix[128], signature[256];
+	size_t				prefixLength;
+	unsigned			index, found = 0;
+	UInt64				deadline = LatencyNow() + (UInt64) kLatencyFindNs;
+	
+	snprintf(prefix, sizeof(prefix), kLatencySignature, tag);
+	prefixLength = strlen(prefix);
+	
+	while ((found<controllerCount) && (LatencyNow()<deadline))
+	{
+		memset(controllers, 0, controllerCount*sizeof(TQ3ControllerRef));
+		found = 0;
+		
+		controllerRef = NULL;
+		if (Q3Controller_Next(NULL, &controllerRef)!=kQ3Success)
+			controllerRef = NULL;
+		
+		while (controllerRef!=NULL)
+		{
+			if ((Q3Controller_GetSignature(controllerRef, signature, sizeof(signature))==kQ3Success)
+			&&  (strncmp(signature, prefix, prefixLength)==0))
+			{
+				index = (unsigned) atoi(signature+prefixLength);
+				if ((index<controllerCount) && (controllers[index]==NULL))
+				{
+					controllers[index] = controllerRef;
+					found++;
+				}
+			}
+			if (Q3Controller_Next(controllerRef, &controllerRef)!=kQ3Success)
+				break;
+		}
+		
+		if (found<controllerCount)
+			usleep(10000);
+	}
+	return(found);
+}
+
+
+
+//=============================================================================
+//      LatencyClient : The --client process.
+//-----------------------------------------------------------------------------
+static int
+LatencyClient(unsigned clientIndex, unsigned clientCount, unsigned controllerCount,
+				unsigned seconds, unsigned pollMicroseconds, const char *tag)
+{
+	TQ3ControllerRef			controllers[kLatencyMaxControllers];
+	TLatencyClientController	*controller;
+	CFRunLoopTimerRef			timer;
+	UInt64						end;
+	TQ3Uns32					found;
+	unsigned					index;
+	
+	Q3Initialize();
+	
+	found = LatencyClientFind(tag, controllerCount, controllers);
+	if (found<controllerCount)
+	{
+		printf("error found %u of %u controllers\n", (unsigned) found, controllerCount);
+		return(1);
+	}
+	
+	//controller k notifies client k modulo clients
+	for (index=clientIndex; index<controllerCount; index+=clientCount)
+	{
+		controller = &gClientControllers[gClientControllerCount++];
+		controller->controllerRef = controllers[index];
+		controller->tracker = Q3Tracker_New(LatencyNotify);
+		if ((controller->tracker==NULL) || (Q3Controller_SetTracker(controller->controllerRef, controller->tracker)!=kQ3Success))
+		{
+			printf("error cannot attach a tracker to controller %u\n", index);
+			return(1);
+		}
+	}
+	if (gClientControllerCount==0)
+		gClientControllers[gClientControllerCount++].controllerRef = controllers[clientIndex % controllerCount];
+	
+	printf("ready\n");
+	fflush(stdout);
+	if (LatencyReadGo(&gClientBase)!=kQ3Success)
+		return(1);
+	
+	timer = CFRunLoopTimerCreate(NULL, CFAbsoluteTimeGetCurrent(), pollMicroseconds*1.0e-6, 0, 0, LatencyPoll, NULL);
+	CFRunLoopAddTimer(CFRunLoopGetCurrent(), timer, kCFRunLoopDefaultMode);
+	
+	end = gClientBase + (UInt64) seconds * 1000000000ULL + (UInt64) kLatencyGraceNs;
+	while (LatencyNow()<end)
+		CFRunLoopRunInMode(kCFRunLoopDefaultMode, (double) (end-LatencyNow()) * 1.0e-9, false);
+	
+	CFRunLoopTimerInvalidate(timer);
+	CFRelease(timer);
+	
+	printf("results %u %u\n", (unsigned) gClientNotified.count, (unsigned) gClientRead.count);
+	fwrite(gClientNotified.ns, sizeof(UInt32), gClientNotified.count, stdout);
+	fwrite(gClientRead.ns, sizeof(UInt32), gClientRead.count, stdout);
+	fflush(stdout);
+	
+	for (index=0; index<gClientControllerCount; index++)
+	{
+		controller = &gClientControllers[index];
+		if (controller->tracker!=NULL)
+		{
+			Q3Controller_SetTracker(controller->controllerRef, NULL);
+			Q3Object_Dispose(controller->tracker);
+		}
+	}
+	
+	Q3Exit();
+	return(0);
+}
+
+
+
+//=============================================================================
+//      LatencySpawn : Start a child process with pipes on stdin and stdout.
+//-----------------------------------------------------------------------------
+static TQ3Status
+LatencySpawn(char *const argv[], TLatencyChild *child)
+{
+	posix_spawn_file_actions_t	actions;
+	int							toChild[2], fromChild[2];
+	int							result;
+	
+	if (pipe(toChild)!=0)
+		return(kQ3Failure);
+	if (pipe(fromChild)!=0)
+	{
+		close(toChild[0]);
+		close(toChild[1]);
+		return(kQ3Failure);
+	}
+	
+	//our ends must not leak into the children started later
+	fcntl(toChild[1], F_SETFD, FD_CLOEXEC);
+	fcntl(fromChild[0], F_SETFD, FD_CLOEXEC);
+	
+	posix_spawn_file_actions_init(&actions);
+	posix_spawn_file_actions_adddup2(&actions, toChild[0], STDIN_FILENO);
+	posix_spawn_file_actions_adddup2(&actions, fromChild[1], STDOUT_FILENO);
+	result = posix_spawnp(&child->pid, argv[0], &actions, NULL, argv, environ);
+	posix_spawn_file_actions_destroy(&actions);
+	
+	close(toChild[0]);
+	close(fromChild[1]);
+	if (result!=0)
+	{
+		close(toChild[1]);
+		close(fromChild[0]);
+		child->pid = 0;
+		return(kQ3Failure);
+	}
+	
+	child->toChild = fdopen(toChild[1], "w");
+	child->fromChild = fdopen(fromChild[0], "r");
+	return(kQ3Success);
+}
+
+
+
+//=============================================================================
+//      LatencyExpect : Read the next line of a child, which must start so.
+//-----------------------------------------------------------------------------
+static TQ3Status
+LatencyExpect(TLatencyChild *child, const char *start, char *line, size_t lineSize)
+{
+	if (fgets(line, (int) lineSize, child->fromChild)==NULL)
+	{
+		fprintf(stderr, "LatencyBench: child %d exited\n", (int) child->pid);
+		return(kQ3Failure);
+	}
+	if (strncmp(line, start, strlen(start))!=0)
+	{
+		fprintf(stderr, "LatencyBench: child %d: %s", (int) child->pid, line);
+		return(kQ3Failure);
+	}
+	return(kQ3Success);
+}
+
+
+
+//=============================================================================
+//      LatencyReap : Close the pipes of a child and wait for it.
+//-----------------------------------------------------------------------------
+static void
+LatencyReap(TLatencyChild *child, TQ3Boolean terminate)
+{
+	int		status;
+	
+	if (child->pid<=0)
+		return;
+	if (terminate)
+		kill(child->pid, SIGTERM);
+	if (child->toChild!=NULL)
+		fclose(child->toChild);
+	if (child->fromChild!=NULL)
+		fclose(child->fromChild);
+	waitpid(child->pid, &status, 0);
+	child->pid = 0;
+}
+
+
+
+//=============================================================================
+//      LatencyRun : One point of the sweep.
+//-----------------------------------------------------------------------------
+static TQ3Status
+LatencyRun(const char *self, unsigned rate, unsigned controllerCount, unsigned clientCount,
+			unsigned seconds, unsigned pollMicroseconds, unsigned runIndex)
+{
+	TLatencyChild		driver, clients[kLatencyMaxClients];
+	TLatencySamples		notifiedSamples, readSamples;
+	char				tag[32], rateText[16], controllersText[16], clientsText[16];
+	char				secondsText[16], pollText[16], indexText[16], line[128];
+	char				*argv[10];
+	unsigned long long	sent = 0, late = 0;
+	unsigned			notifiedCount, readCount, index;
+	TQ3Status			status = kQ3Failure;
+	UInt64				base;
+	
+	memset(&driver, 0, sizeof(driver));
+	memset(clients, 0, sizeof(clients));
+	memset(&notifiedSamples, 0, sizeof(notifiedSamples));
+	memset(&readSamples, 0, sizeof(readSamples));
+	
+	snprintf(tag, sizeof(tag), "%d.%u", (int) getpid(), runIndex);
+	snprintf(rateText, sizeof(rateText), "%u", rate);
+	snprintf(controllersText, sizeof(controllersText), "%u", controllerCount);
+	snprintf(clientsText, sizeof(clientsText), "%u", clientCount);
+	snprintf(secondsText, sizeof(secondsText), "%u", seconds);
+	snprintf(pollText, sizeof(pollText), "%u", pollMicroseconds);
+	
+	//the driver registers its controllers before the clients look for them
+	argv[0] = (char*) self;
+	argv[1] = (char*) "--driver";
+	argv[2] = rateText;
+	argv[3] = controllersText;
+	argv[4] = secondsText;
+	argv[5] = tag;
+	argv[6] = NULL;
+	if ((LatencySpawn(argv, &driver)!=kQ3Success) || (LatencyExpect(&driver, "ready", line, sizeof(line))!=kQ3Success))
+		goto done;
+	
+	for (index=0; index<clientCount; index++)
+	{
+		snprintf(indexText, sizeof(indexText), "%u", index);
+		argv[1] = (char*) "--client";
+		argv[2] = indexText;
+		argv[3] = clientsText;
+		argv[4] = controllersText;
+		argv[5] = secondsText;
+		argv[6] = pollText;
+		argv[7] = tag;
+		argv[8] = NULL;
+		if ((LatencySpawn(argv, &clients[index])!=kQ3Success) || (LatencyExpect(&clients[index], "ready", line, sizeof(line))!=kQ3Success))
+			goto done;
+	}
+	
+	//clients first, so they are listening when the first sample arrives
+	base = LatencyNow();
+	for (index=0; index<clientCount; index++)
+	{
+		fprintf(clients[index].toChild, "go %llu\n", (unsigned long long) base);
+		fflush(clients[index].toChild);
+	}
+	fprintf(driver.toChild, "go %llu\n", (unsigned long long) base);
+	fflush(driver.toChild);
+	
+	for (index=0; index<clientCount; index++)
+	{
+		if ((LatencyExpect(&clients[index], "results", line, sizeof(line))!=kQ3Success)
+		||  (sscanf(line, "results %u %u", &notifiedCount, &readCount)!=2)
+		||  (LatencySamples_Append(&notifiedSamples, notifiedCount, clients[index].fromChild)!=kQ3Success)
+		||  (LatencySamples_Append(&readSamples, readCount, clients[index].fromChild)!=kQ3Success))
+			goto done;
+		LatencyReap(&clients[index], kQ3False);
+	}
+	
+	if ((LatencyExpect(&driver, "sent", line, sizeof(line))!=kQ3Success)
+	||  (sscanf(line, "sent %llu late %llu", &sent, &late)!=2))
+		goto done;
+	fprintf(driver.toChild, "done\n");
+	fflush(driver.toChild);
+	LatencyReap(&driver, kQ3False);
+	
+	LatencyReport(rate, controllerCount, clientCount, "notify", &notifiedSamples, sent, late);
+	LatencyReport(rate, controllerCount, clientCount, "read", &readSamples, sent, late);
+	status = kQ3Success;
+
+done:
+	for (index=0; index<clientCount; index++)
+		LatencyReap(&clients[index], kQ3True);
+	LatencyReap(&driver, kQ3True);
+	free(notifiedSamples.ns);
+	free(readSamples.ns);
+	return(status);
+}
+
+
+
+//=============================================================================
+//      LatencyParseList : Parse a comma separated list of positive numbers.
+//-----------------------------------------------------------------------------
+static unsigned
+LatencyParseList(const char *text, unsigned *list, unsigned maxValue)
+{
+	unsigned	count = 0;
+	long		value;
+	char		*end;
+	
+	while (count<kLatencyMaxSweep)
+	{
+		value = strtol(text, &end, 10);
+		if ((end==text) || (value<=0) || ((unsigned long) value>maxValue))
+			return(0);
+		list[count++] = (unsigned) value;
+		if (*end==0)
+			return(count);
+		if (*end!=',')
+			return(0);
+		text = end+1;
+	}
+	return(0);
+}
+
+
+
+
+
+//=============================================================================
+//      main
+//-----------------------------------------------------------------------------
+int
+main(int argc, char *argv[])
+{
+	unsigned		rates[kLatencyMaxSweep], controllers[kLatencyMaxSweep], clients[kLatencyMaxSweep];
+	unsigned		rateCount, controllerCount, clientCount;
+	unsigned		rate, controller, client, runIndex = 0;
+	unsigned		seconds = 5, pollMicroseconds = 1000;
+	const char		*rateText = "250", *controllerText = "1", *clientText = "1", *server = NULL;
+	TLatencyChild	serverChild;
+	int				option, failed = 0;
+	
+	//the processes of a run
+	if ((argc==6) && (strcmp(argv[1], "--driver")==0))
+		return(LatencyDriver((unsigned) atoi(argv[2]), (unsigned) atoi(argv[3]), (unsigned) atoi(argv[4]), argv[5]));
+	if ((argc==8) && (strcmp(argv[1], "--client")==0))
+		return(LatencyClient((unsigned) atoi(argv[2]), (unsigned) atoi(argv[3]), (unsigned) atoi(argv[4]),
+								(unsigned) atoi(argv[5]), (unsigned) atoi(argv[6]), argv[7]));
+	
+	while ((option = getopt(argc, argv, "r:c:n:t:p:S:"))!=-1)
+	{
+		switch (option)
+		{
+			case 'r':	rateText = optarg;						break;
+			case 'c':	controllerText = optarg;				break;
+			case 'n':	clientText = optarg;					break;
+			case 't':	seconds = (unsigned) atoi(optarg);		break;
+			case 'p':	pollMicroseconds = (unsigned) atoi(optarg);	break;
+			case 'S':	server = optarg;						break;
+			default:	optind = argc+1;						break;
+		}
+	}
+	
+	rateCount = LatencyParseList(rateText, rates, 100000);
+	controllerCount = LatencyParseList(controllerText, controllers, kLatencyMaxControllers);
+	clientCount = LatencyParseList(clientText, clients, kLatencyMaxClients);
+	
+	if ((optind!=argc) || (rateCount==0) || (controllerCount==0) || (clientCount==0) || (seconds==0) || (pollMicroseconds<50))
+	{
+		fprintf(stderr, "usage: %s [-r rates] [-c controllers] [-n clients] [-t seconds] [-p microseconds] [-S server]\n", argv[0]);
+		return(1);
+	}
+	
+	memset(&serverChild, 0, sizeof(serverChild));
+	if (server!=NULL)
+	{
+		char	*serverArgv[2];
+		
+		//the server keeps our stdin and stdout, nobody would drain its pipes
+		serverArgv[0] = (char*) server;
+		serverArgv[1] = NULL;
+		if (posix_spawn(&serverChild.pid, server, NULL, NULL, serverArgv, environ)!=0)
+		{
+			fprintf(stderr, "%s: cannot start %s\n", argv[0], server);
+			return(1);
+		}
+		LatencyWaitUntil(LatencyNow() + (UInt64) kLatencyServerStartNs);
+	}
+	
+	for (rate=0; (rate<rateCount) && !failed; rate++)
+		for (controller=0; (controller<controllerCount) && !failed; controller++)
+			for (client=0; (client<clientCount) && !failed; client++)
+				failed = (LatencyRun(argv[0], rates[rate], controllers[controller], clients[client],
+										seconds, pollMicroseconds, runIndex++)!=kQ3Success);
+	
+	LatencyReap(&serverChild, kQ3True);
+	return(failed ? 1 : 0);
+}
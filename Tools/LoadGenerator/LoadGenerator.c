@@ -0,0 +1,994 @@
+/*  NAME:
+        LoadGenerator.c
+
+    DESCRIPTION:
+        Puts a running device server under load from populations of drivers
+		and clients, and reports throughput, errors and the server's CPU and
+		memory over time.
+		
+		    LoadGenerator [-d drivers] [-r rate] [-g clients] [-e clients]
+		                  [-h clients] [-s clients] [-i microseconds]
+		                  [-t seconds] [-I milliseconds] [-P pid | -S server]
+		
+		    -d drivers        driver processes, one controller each (default 1)
+		    -r rate           samples per second and driver, 0 for as fast as
+		                      possible; a sample is SetValues, MoveTrackerPosition
+		                      and MoveTrackerOrientation (default 100)
+		    -g clients        clients polling GetValues of all drivers (default 1)
+		    -e clients        clients enumerating the controller list (default 0)
+		    -h clients        clients setting and getting channels (default 0)
+		    -s clients        clients saving and restoring ControllerStates (default 0)
+		    -i microseconds   pause of the clients between rounds, 0 for none
+		                      (default 1000)
+		    -t seconds        length of the run (default 10)
+		    -I milliseconds   reporting interval (default 1000)
+		    -P pid            sample CPU and memory of this server process
+		    -S server         start this device server executable and sample it
+		
+		Every driver and client is a process of its own, this executable
+		started again with --worker, using nothing but the Quesa controller
+		API; so the load reaches the server through whatever transport the
+		Quesa library is built with. The workers count calls, failed calls
+		and time spent in calls in a shared file the generator samples. Each
+		interval prints one JSON line per kind of worker and one for the
+		server, and the run ends with a line per kind for the whole run:
+		
+		    {"phase":"interval","t_s":1.00,"kind":"getvalues","workers":1,"exited":0,
+		     "ops_per_s":..,"errors_per_s":..,"mean_call_us":..}
+		    {"phase":"interval","t_s":1.00,"kind":"server","pid":..,"cpu_pct":..,"rss_kb":..}
+		
+		A server that keeps up shows driver ops at 3 times drivers times
+		rate; raise -d, -r or the client counts until it does not.
+		Server CPU and memory come from proc_pidinfo on Mac OS X and from
+		/proc on Linux.
+		
+		Build, from this directory:
+		
+		    Mac OS X: cc -O2 LoadGenerator.c -F<dir of Quesa.framework> -framework Quesa -framework Carbon -o LoadGenerator
+		    Linux:    cc -O2 -I<Quesa includes> LoadGenerator.c -lquesa -lm -o LoadGenerator
+      
+    COPYRIGHT:
+        Copyright (c) 1999-2005, Quesa Developers. All rights reserved.
+
+        For the current release of Quesa, please see:
+
+            <http://www.quesa.org/>
+        
+        Redistribution and use in source and binary forms, with or without
+        modification, are permitted provided that the following conditions
+        are met:
+        
+            o Redistributions of source code must retain the above copyright
+              notice, this list of conditions and the following disclaimer.
+        
+            o Redistributions in binary form must reproduce the above
+              copyright notice, this list of conditions and the following
+              disclaimer in the documentation and/or other materials provided
+              with the distribution.
+        
+            o Neither the name of Quesa nor the names of its contributors
+              may be used to endorse or promote products derived from this
+              software without specific prior written permission.
+        
+        THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+        "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+        LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+        A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+        OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+        SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+        TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+        PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+        LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+        NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+        SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+    ___________________________________________________________________________
+*/
+
+
+
+//=============================================================================
+//      Include files
+//-----------------------------------------------------------------------------
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <spawn.h>
+#include <time.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+
+#if defined(__APPLE__)
+	#include <mach/mach_time.h>
+	#include <libproc.h>
+	#define QUESA_OS_MACINTOSH		1
+	#include <Quesa/QuesaController.h>
+#else
+	#define QUESA_OS_UNIX			1
+	#include <QuesaController.h>
+#endif
+
+extern char **environ;
+
+
+
+
+
+//=============================================================================
+//      Internal constants
+//-----------------------------------------------------------------------------
+#define kLoadMaxWorkers				256
+#define kLoadValueCount				6
+#define kLoadChannelCount			4
+#define kLoadChannelSize			16
+#define kLoadReadyNs				15000000000.0	//workers get this long to register or find the drivers
+#define kLoadFindNs					10000000000.0
+#define kLoadServerStartNs			2000000000.0	//a started server gets this long to register
+#define kLoadSignature				"loadgen:%s:"	//run tag, the driver index follows
+
+//workers by what they do
+enum
+{
+	kLoadDriver						= 0,
+	kLoadGetValues					= 1,
+	kLoadEnumerate					= 2,
+	kLoadChannels					= 3,
+	kLoadStates						= 4,
+	kLoadKindCount					= 5
+};
+
+//TLoadShared.state
+enum
+{
+	kLoadStarting					= 0,
+	kLoadRunning					= 1,
+	kLoadStopping					= 2
+};
+
+//TLoadSlot.ready
+enum
+{
+	kLoadNotReady					= 0,
+	kLoadReady						= 1,
+	kLoadFailed						= 2
+};
+
+
+
+
+
+//=============================================================================
+//      Internal types
+//-----------------------------------------------------------------------------
+//counters of one worker, written by the worker only
+typedef struct TLoadSlot
+{
+	volatile uint64_t		ops;
+	volatile uint64_t		errors;
+	volatile uint64_t		busyNs;				//time spent in calls
+	volatile uint32_t		ready;
+	uint32_t				kind;
+} TLoadSlot;
+
+//the file shared by the generator and its workers
+typedef struct TLoadShared
+{
+	volatile uint32_t		state;
+	uint32_t				slotCount;
+	TLoadSlot				slot[1];
+} TLoadShared;
+
+//the generator's view of a worker
+typedef struct TLoadWorker
+{
+	pid_t					pid;
+	uint32_t				kind;
+	TQ3Boolean				exited;
+} TLoadWorker;
+
+//sums over the workers of one kind
+typedef struct TLoadTotals
+{
+	uint64_t				ops;
+	uint64_t				errors;
+	uint64_t				busyNs;
+	uint32_t				workers;
+	uint32_t				exited;
+} TLoadTotals;
+
+
+
+
+
+//=============================================================================
+//      Internal variables
+//-----------------------------------------------------------------------------
+static const char					*gLoadKindNames[kLoadKindCount] = { "driver", "getvalues", "enumerate", "channels", "states" };
+
+//channel contents of a driver
+static uint8_t							gLoadChannels[kLoadChannelCount][kLoadChannelSize];
+
+#if defined(__APPLE__)
+static mach_timebase_info_data_t	gLoadTimebase;
+#endif
+
+
+
+
+
+//=============================================================================
+//      Internal functions
+//-----------------------------------------------------------------------------
+//      LoadNow : Monotonic time in nanoseconds.
+//-----------------------------------------------------------------------------
+static uint64_t
+LoadNow(void)
+{
+#if defined(__APPLE__)
+	if (gLoadTimebase.denom==0)
+		mach_timebase_info(&gLoadTimebase);
+	return((uint64_t) ((double) mach_absolute_time() * gLoadTimebase.numer / gLoadTimebase.denom));
+#else
+	struct timespec		now;
+	
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return((uint64_t) now.tv_sec * 1000000000ULL + (uint64_t) now.tv_nsec);
+#endif
+}
+
+
+
+//=============================================================================
+//      LoadSleepUntil : Sleep until a LoadNow time.
+//-----------------------------------------------------------------------------
+static void
+LoadSleepUntil(uint64_t due)
+{
+	struct timespec		delay;
+	uint64_t			now = LoadNow();
+	
+	if (due<=now)
+		return;
+	delay.tv_sec = (time_t) ((due-now) / 1000000000ULL);
+	delay.tv_nsec = (long) ((due-now) % 1000000000ULL);
+	nanosleep(&delay, NULL);
+}
+
+
+
+//=============================================================================
+//      LoadIdleUntil : Wait for the next sample of a driver.
+//-----------------------------------------------------------------------------
+//		Note :	On Mac OS X the server's channel calls reach the driver
+//				through its run loop, which runs at least once.
+//-----------------------------------------------------------------------------
+static void
+LoadIdleUntil(uint64_t due)
+{
+#if defined(__APPLE__)
+	uint64_t	now;
+	
+	do
+	{
+		now = LoadNow();
+		CFRunLoopRunInMode(kCFRunLoopDefaultMode, (due>now) ? (double) (due-now) * 1.0e-9 : 0.0, true);
+	}
+	while (LoadNow()<due);
+#else
+	LoadSleepUntil(due);
+#endif
+}
+
+
+
+//=============================================================================
+//      LoadCount : Count one call that started at start.
+//-----------------------------------------------------------------------------
+static void
+LoadCount(TLoadSlot *slot, uint64_t start, TQ3Status status)
+{
+	slot->busyNs += LoadNow() - start;
+	slot->ops++;
+	if (status!=kQ3Success)
+		slot->errors++;
+}
+
+
+
+//=============================================================================
+//      LoadMap : Map the shared file.
+//-----------------------------------------------------------------------------
+static TLoadShared *
+LoadMap(const char *path, size_t *size)
+{
+	struct stat		fileInfo;
+	void			*mapping;
+	int				fileDescriptor;
+	
+	fileDescriptor = open(path, O_RDWR);
+	if (fileDescriptor<0)
+		return(NULL);
+	if (fstat(fileDescriptor, &fileInfo)!=0)
+	{
+		close(fileDescriptor);
+		return(NULL);
+	}
+	
+	*size = (size_t) fileInfo.st_size;
+	mapping = mmap(NULL, *size, PROT_READ|PROT_WRITE, MAP_SHARED, fileDescriptor, 0);
+	close(fileDescriptor);
+	
+	return((mapping==MAP_FAILED) ? NULL : (TLoadShared*) mapping);
+}
+
+
+
+//=============================================================================
+//      LoadChannelGet : Channel get method of the drivers.
+//-----------------------------------------------------------------------------
+static TQ3Status
+LoadChannelGet(TQ3ControllerRef controllerRef, TQ3Uns32 channel, void *data, TQ3Uns32 *dataSize)
+{
+	if ((channel>=kLoadChannelCount) || (dataSize==NULL))
+		return(kQ3Failure);
+	
+	if (data!=NULL)
+		memcpy(data, gLoadChannels[channel], (*dataSize<kLoadChannelSize) ? *dataSize : kLoadChannelSize);
+	*dataSize = kLoadChannelSize;
+	return(kQ3Success);
+}
+
+
+
+//=============================================================================
+//      LoadChannelSet : Channel set method of the drivers.
+//-----------------------------------------------------------------------------
+static TQ3Status
+LoadChannelSet(TQ3ControllerRef controllerRef, TQ3Uns32 channel, const void *data, TQ3Uns32 dataSize)
+{
+	if ((channel>=kLoadChannelCount) || (data==NULL))
+		return(kQ3Failure);
+	
+	memcpy(gLoadChannels[channel], data, (dataSize<kLoadChannelSize) ? dataSize : kLoadChannelSize);
+	return(kQ3Success);
+}
+
+
+
+//=============================================================================
+//      LoadDriver : A driver worker, one controller sending at rate.
+//-----------------------------------------------------------------------------
+//		Note :	A driver that falls behind sends back to back until it has
+//				caught up, so its ops show what the server let through.
+//-----------------------------------------------------------------------------
+static int
+LoadDriver(TLoadShared *shared, TLoadSlot *slot, const char *tag, unsigned driverIndex, unsigned rate)
+{
+	TQ3ControllerRef	controllerRef;
+	TQ3ControllerData	controllerData;
+	char				signature[128];
+	float				values[kLoadValueCount];
+	TQ3Vector3D			delta;
+	TQ3Quaternion		rotation;
+	uint64_t			start, due, period;
+	TQ3Uns32			sequence = 0, index;
+	
+	snprintf(signature, sizeof(signature), kLoadSignature "%u", tag, driverIndex);
+	controllerData.signature		= signature;
+	controllerData.valueCount		= kLoadValueCount;
+	controllerData.channelCount		= kLoadChannelCount;
+	controllerData.channelGetMethod	= LoadChannelGet;
+	controllerData.channelSetMethod	= LoadChannelSet;
+	
+	controllerRef = Q3Controller_New(&controllerData);
+	if (controllerRef==NULL)
+	{
+		slot->ready = kLoadFailed;
+		return(1);
+	}
+	Q3Controller_SetActivation(controllerRef, kQ3True);
+	slot->ready = kLoadReady;
+	
+	while (shared->state==kLoadStarting)
+		LoadIdleUntil(LoadNow() + 1000000);
+	
+	//a small turn about z
+	rotation.w = 0.9999995f;
+	rotation.x = 0.0f;
+	rotation.y = 0.0f;
+	rotation.z = 0.001f;
+	
+	period = (rate!=0) ? (uint64_t) (1.0e9 / rate) : 0;
+	due = LoadNow();
+	
+	while (shared->state==kLoadRunning)
+	{
+		LoadIdleUntil(due);
+		due += period;
+		sequence++;
+		
+		for (index=0; index<kLoadValueCount; index++)
+			values[index] = (float) ((sequence+index) % 100) * 0.01f;
+		start = LoadNow();
+		LoadCount(slot, start, Q3Controller_SetValues(controllerRef, values, kLoadValueCount));
+		
+		//back and forth, so the position stays put
+		delta.x = (sequence & 1) ? 0.001f : -0.001f;
+		delta.y = 0.0f;
+		delta.z = 0.0f;
+		start = LoadNow();
+		LoadCount(slot, start, Q3Controller_MoveTrackerPosition(controllerRef, &delta));
+		
+		start = LoadNow();
+		LoadCount(slot, start, Q3Controller_MoveTrackerOrientation(controllerRef, &rotation));
+	}
+	
+	Q3Controller_Decommission(controllerRef);
+	return(0);
+}
+
+
+
+//=============================================================================
+//      LoadFind : Look up the drivers' controllers by signature.
+//-----------------------------------------------------------------------------
+static TQ3Uns32
+LoadFind(const char *tag, unsigned driverCount, TQ3ControllerRef *controllers)
+{
+	TQ3ControllerRef	controllerRef;
+	char				prefix[128], signature[256];
+	size_t				prefixLength;
+	unsigned			index, found = 0;
+	uint64_t			deadline = LoadNow() + (uint64_t) kLoadFindNs;
+	
+	snprintf(prefix, sizeof(prefix), kLoadSignature, tag);
+	prefixLength = strlen(prefix);
+	
+	while ((found<driverCount) && (LoadNow()<deadline))
+	{
+		memset(controllers, 0, driverCount*sizeof(TQ3ControllerRef));
+		found = 0;
+		
+		controllerRef = NULL;
+		if (Q3Controller_Next(NULL, &controllerRef)!=kQ3Success)
+			controllerRef = NULL;
+		
+		while (controllerRef!=NULL)
+		{
+			if ((Q3Controller_GetSignature(controllerRef, signature, sizeof(signature))==kQ3Success)
+			&&  (strncmp(signature, prefix, prefixLength)==0))
+			{
+				index = (unsigned) atoi(signature+prefixLength);
+				if ((index<driverCount) && (controllers[index]==NULL))
+				{
+					controllers[index] = controllerRef;
+					found++;
+				}
+			}
+			if (Q3Controller_Next(controllerRef, &controllerRef)!=kQ3Success)
+				break;
+		}
+		
+		if (found<driverCount)
+			LoadSleepUntil(LoadNow() + 10000000);
+	}
+	return(found);
+}
+
+
+
+//=============================================================================
+//      LoadEnumerate : One round of an enumerating client.
+//-----------------------------------------------------------------------------
+static void
+LoadEnumerate(TLoadSlot *slot)
+{
+	static TQ3Uns32		serialNumber = 0;
+	TQ3ControllerRef	controllerRef = NULL;
+	TQ3Boolean			listChanged;
+	char				signature[256];
+	TQ3Status			status;
+	uint64_t			start;
+	
+	start = LoadNow();
+	LoadCount(slot, start, Q3Controller_GetListChanged(&listChanged, &serialNumber));
+	
+	start = LoadNow();
+	status = Q3Controller_Next(NULL, &controllerRef);
+	LoadCount(slot, start, status);
+	
+	while ((status==kQ3Success) && (controllerRef!=NULL))
+	{
+		start = LoadNow();
+		LoadCount(slot, start, Q3Controller_GetSignature(controllerRef, signature, sizeof(signature)));
+		
+		start = LoadNow();
+		status = Q3Controller_Next(controllerRef, &controllerRef);
+		LoadCount(slot, start, status);
+	}
+}
+
+
+
+//=============================================================================
+//      LoadClientCall : One round of a client on one controller.
+//-----------------------------------------------------------------------------
+static void
+LoadClientCall(TLoadSlot *slot, unsigned kind, TQ3ControllerRef controllerRef, TQ3Uns32 round)
+{
+	float						values[kLoadValueCount];
+	uint8_t						data[kLoadChannelSize];
+	TQ3Uns32					channel, dataSize;
+	TQ3ControllerStateObject	state;
+	uint64_t					start;
+	
+	switch (kind)
+	{
+		case kLoadGetValues:
+			start = LoadNow();
+			LoadCount(slot, start, Q3Controller_GetValues(controllerRef, kLoadValueCount, values, NULL, NULL));
+			break;
+		
+		case kLoadChannels:
+			channel = round % kLoadChannelCount;
+			memset(data, (int) (round & 0xFF), sizeof(data));
+			start = LoadNow();
+			LoadCount(slot, start, Q3Controller_SetChannel(controllerRef, channel, data, sizeof(data)));
+			
+			dataSize = sizeof(data);
+			start = LoadNow();
+			LoadCount(slot, start, Q3Controller_GetChannel(controllerRef, channel, data, &dataSize));
+			break;
+		
+		case kLoadStates:
+			start = LoadNow();
+			state = Q3ControllerState_New(controllerRef);
+			LoadCount(slot, start, (state!=NULL) ? kQ3Success : kQ3Failure);
+			if (state==NULL)
+				break;
+			
+			start = LoadNow();
+			LoadCount(slot, start, Q3ControllerState_SaveAndReset(state));
+			start = LoadNow();
+			LoadCount(slot, start, Q3ControllerState_Restore(state));
+			start = LoadNow();
+			LoadCount(slot, start, Q3Object_Dispose(state));
+			break;
+	}
+}
+
+
+
+//=============================================================================
+//      LoadWorker : The --worker process.
+//-----------------------------------------------------------------------------
+static int
+LoadWorker(unsigned kind, unsigned slotIndex, const char *tag, const char *path, unsigned parameter, unsigned driverCount)
+{
+	TQ3ControllerRef	controllers[kLoadMaxWorkers];
+	TLoadShared			*shared;
+	TLoadSlot			*slot;
+	size_t				size;
+	TQ3Uns32			round = 0;
+	unsigned			index;
+	int					result = 0;
+	
+	shared = LoadMap(path, &size);
+	if ((shared==NULL) || (slotIndex>=shared->slotCount) || (kind>=kLoadKindCount) || (driverCount>kLoadMaxWorkers))
+		return(1);
+	slot = &shared->slot[slotIndex];
+	
+	Q3Initialize();
+	
+	if (kind==kLoadDriver)
+		result = LoadDriver(shared, slot, tag, slotIndex, parameter);
+	
+	else if (LoadFind(tag, driverCount, controllers)<driverCount)
+	{
+		slot->ready = kLoadFailed;
+		result = 1;
+	}
+	
+	else
+	{
+		slot->ready = kLoadReady;
+		while (shared->state==kLoadStarting)
+			LoadSleepUntil(LoadNow() + 1000000);
+		
+		while (shared->state==kLoadRunning)
+		{
+			if (kind==kLoadEnumerate)
+				LoadEnumerate(slot);
+			else
+				for (index=0; index<driverCount; index++)
+					LoadClientCall(slot, kind, controllers[index], round);
+			
+			round++;
+			if (parameter!=0)
+				LoadSleepUntil(LoadNow() + (uint64_t) parameter * 1000);
+		}
+	}
+	
+	Q3Exit();
+	munmap((void*) shared, size);
+	return(result);
+}
+
+
+
+//=============================================================================
+//      LoadSpawn : Start a worker.
+//-----------------------------------------------------------------------------
+static TQ3Status
+LoadSpawn(const char *self, unsigned kind, unsigned slotIndex, const char *tag, const char *path,
+			unsigned parameter, unsigned driverCount, TLoadWorker *worker)
+{
+	char	kindText[16], slotText[16], parameterText[16], driversText[16];
+	char	*argv[9];
+	
+	snprintf(kindText, sizeof(kindText), "%u", kind);
+	snprintf(slotText, sizeof(slotText), "%u", slotIndex);
+	snprintf(parameterText, sizeof(parameterText), "%u", parameter);
+	snprintf(driversText, sizeof(driversText), "%u", driverCount);
+	
+	argv[0] = (char*) self;
+	argv[1] = (char*) "--worker";
+	argv[2] = kindText;
+	argv[3] = slotText;
+	argv[4] = (char*) tag;
+	argv[5] = (char*) path;
+	argv[6] = parameterText;
+	argv[7] = driversText;
+	argv[8] = NULL;
+	
+	worker->kind = kind;
+	worker->exited = kQ3False;
+	if (posix_spawnp(&worker->pid, self, NULL, NULL, argv, environ)!=0)
+	{
+		worker->pid = 0;
+		worker->exited = kQ3True;
+		return(kQ3Failure);
+	}
+	return(kQ3Success);
+}
+
+
+
+//=============================================================================
+//      LoadPoll : Notice workers that exited.
+//-----------------------------------------------------------------------------
+static void
+LoadPoll(TLoadWorker *workers, unsigned workerCount)
+{
+	unsigned	index;
+	int			status;
+	
+	for (index=0; index<workerCount; index++)
+		if (!workers[index].exited && (waitpid(workers[index].pid, &status, WNOHANG)==workers[index].pid))
+			workers[index].exited = kQ3True;
+}
+
+
+
+//=============================================================================
+//      LoadWaitReady : Wait for workers to register or fail, returns failures.
+//-----------------------------------------------------------------------------
+static unsigned
+LoadWaitReady(TLoadShared *shared, TLoadWorker *workers, unsigned first, unsigned count)
+{
+	uint64_t	deadline = LoadNow() + (uint64_t) kLoadReadyNs;
+	unsigned	index, pending, failed;
+	
+	do
+	{
+		LoadPoll(workers, first+count);
+		pending = failed = 0;
+		for (index=first; index<first+count; index++)
+		{
+			if (shared->slot[index].ready==kLoadFailed)
+				failed++;
+			else if (shared->slot[index].ready==kLoadNotReady)
+			{
+				if (workers[index].exited)
+					failed++;
+				else
+					pending++;
+			}
+		}
+		if (pending!=0)
+			LoadSleepUntil(LoadNow() + 10000000);
+	}
+	while ((pending!=0) && (LoadNow()<deadline));
+	
+	return(failed+pending);
+}
+
+
+
+//=============================================================================
+//      LoadServerSample : CPU time and resident memory of the server.
+//-----------------------------------------------------------------------------
+static TQ3Status
+LoadServerSample(pid_t pid, uint64_t *cpuNs, uint64_t *residentBytes)
+{
+#if defined(__APPLE__)
+	struct proc_taskinfo	info;
+	
+	if (proc_pidinfo(pid, PROC_PIDTASKINFO, 0, &info, sizeof(info))!=(int) sizeof(info))
+		return(kQ3Failure);
+	
+	//mach time units, which are nanoseconds on Intel
+	if (gLoadTimebase.denom==0)
+		mach_timebase_info(&gLoadTimebase);
+	*cpuNs = (uint64_t) ((double) (info.pti_total_user + info.pti_total_system) * gLoadTimebase.numer / gLoadTimebase.denom);
+	*residentBytes = info.pti_resident_size;
+	return(kQ3Success);
+#else
+	char			path[64], buffer[1024], *fields;
+	unsigned long	userTicks, systemTicks;
+	long			residentPages;
+	size_t			length;
+	FILE			*file;
+	
+	snprintf(path, sizeof(path), "/proc/%d/stat", (int) pid);
+	file = fopen(path, "r");
+	if (file==NULL)
+		return(kQ3Failure);
+	length = fread(buffer, 1, sizeof(buffer)-1, file);
+	fclose(file);
+	buffer[length] = 0;
+	
+	//the command name may contain blanks, the fields follow its closing parenthesis
+	fields = strrchr(buffer, ')');
+	if ((fields==NULL) || (sscanf(fields+1, " %*c %*d %*d %*d %*d %*d %*u %*u %*u %*u %*u %lu %lu %*d %*d %*d %*d %*d %*d %*u %*u %ld",
+									&userTicks, &systemTicks, &residentPages)!=3))
+		return(kQ3Failure);
+	
+	*cpuNs = (uint64_t) ((double) (userTicks+systemTicks) * 1.0e9 / sysconf(_SC_CLK_TCK));
+	*residentBytes = (uint64_t) residentPages * (uint64_t) sysconf(_SC_PAGESIZE);
+	return(kQ3Success);
+#endif
+}
+
+
+
+//=============================================================================
+//      LoadSum : Sum the counters of the workers by kind.
+//-----------------------------------------------------------------------------
+static void
+LoadSum(const TLoadShared *shared, const TLoadWorker *workers, unsigned workerCount, TLoadTotals *totals)
+{
+	unsigned	index;
+	
+	memset(totals, 0, kLoadKindCount*sizeof(TLoadTotals));
+	for (index=0; index<workerCount; index++)
+	{
+		TLoadTotals	*total = &totals[workers[index].kind];
+		
+		total->ops		+= shared->slot[index].ops;
+		total->errors	+= shared->slot[index].errors;
+		total->busyNs	+= shared->slot[index].busyNs;
+		total->workers++;
+		if (workers[index].exited)
+			total->exited++;
+	}
+}
+
+
+
+//=============================================================================
+//      LoadReport : One JSON line per kind, for what changed in ns.
+//-----------------------------------------------------------------------------
+static void
+LoadReport(const char *phase, double seconds, const TLoadTotals *now, const TLoadTotals *before, uint64_t ns)
+{
+	unsigned	kind;
+	uint64_t	ops, errors, busyNs;
+	
+	for (kind=0; kind<kLoadKindCount; kind++)
+	{
+		if (now[kind].workers==0)
+			continue;
+		
+		ops		= now[kind].ops - before[kind].ops;
+		errors	= now[kind].errors - before[kind].errors;
+		busyNs	= now[kind].busyNs - before[kind].busyNs;
+		
+		printf("{\"phase\":\"%s\",\"t_s\":%.2f,\"kind\":\"%s\",\"workers\":%u,\"exited\":%u,"
+				"\"ops_per_s\":%.1f,\"errors_per_s\":%.1f,\"mean_call_us\":%.1f}\n",
+				phase, seconds, gLoadKindNames[kind], (unsigned) now[kind].workers, (unsigned) now[kind].exited,
+				(double) ops * 1.0e9 / ns, (double) errors * 1.0e9 / ns, (ops!=0) ? (double) busyNs * 1.0e-3 / ops : 0.0);
+	}
+	fflush(stdout);
+}
+
+
+
+
+
+//=============================================================================
+//      main
+//-----------------------------------------------------------------------------
+int
+main(int argc, char *argv[])
+{
+	unsigned		counts[kLoadKindCount] = { 1, 1, 0, 0, 0 };
+	unsigned		rate = 100, interval = 1000, seconds = 10, reportMilliseconds = 1000;
+	unsigned		workerCount = 0, kind, index, failed;
+	const char		*server = NULL;
+	char			path[64], tag[32];
+	TLoadWorker		workers[kLoadMaxWorkers];
+	TLoadTotals		totals[kLoadKindCount], previous[kLoadKindCount], zero[kLoadKindCount];
+	TLoadShared		*shared;
+	size_t			size;
+	pid_t			serverPid = 0;
+	TQ3Boolean		startedServer = kQ3False;
+	uint64_t		start, end, next, now, before, cpuNs, cpuBefore = 0, residentBytes;
+	int				option, fileDescriptor, status;
+	
+	//the processes of a run
+	if ((argc==8) && (strcmp(argv[1], "--worker")==0))
+		return(LoadWorker((unsigned) atoi(argv[2]), (unsigned) atoi(argv[3]), argv[4], argv[5],
+							(unsigned) atoi(argv[6]), (unsigned) atoi(argv[7])));
+	
+	while ((option = getopt(argc, argv, "d:r:g:e:h:s:i:t:I:P:S:"))!=-1)
+	{
+		switch (option)
+		{
+			case 'd':	counts[kLoadDriver] = (unsigned) atoi(optarg);		break;
+			case 'r':	rate = (unsigned) atoi(optarg);						break;
+			case 'g':	counts[kLoadGetValues] = (unsigned) atoi(optarg);	break;
+			case 'e':	counts[kLoadEnumerate] = (unsigned) atoi(optarg);	break;
+			case 'h':	counts[kLoadChannels] = (unsigned) atoi(optarg);	break;
+			case 's':	counts[kLoadStates] = (unsigned) atoi(optarg);		break;
+			case 'i':	interval = (unsigned) atoi(optarg);					break;
+			case 't':	seconds = (unsigned) atoi(optarg);					break;
+			case 'I':	reportMilliseconds = (unsigned) atoi(optarg);		break;
+			case 'P':	serverPid = (pid_t) atoi(optarg);					break;
+			case 'S':	server = optarg;									break;
+			default:	optind = argc+1;									break;
+		}
+	}
+	
+	for (kind=0; kind<kLoadKindCount; kind++)
+		workerCount += counts[kind];
+	
+	if ((optind!=argc) || (counts[kLoadDriver]==0) || (workerCount>kLoadMaxWorkers) || (seconds==0) || (reportMilliseconds==0)
+	||  ((server!=NULL) && (serverPid!=0)))
+	{
+		fprintf(stderr, "usage: %s [-d drivers] [-r rate] [-g clients] [-e clients] [-h clients] [-s clients]\n"
+						"       [-i microseconds] [-t seconds] [-I milliseconds] [-P pid | -S server]\n", argv[0]);
+		return(1);
+	}
+	
+	//the shared counters, zero filled
+	snprintf(path, sizeof(path), "/tmp/LoadGenerator.XXXXXX");
+	fileDescriptor = mkstemp(path);
+	size = sizeof(TLoadShared) + (workerCount-1)*sizeof(TLoadSlot);
+	if ((fileDescriptor<0) || (ftruncate(fileDescriptor, (off_t) size)!=0))
+	{
+		fprintf(stderr, "%s: cannot create %s\n", argv[0], path);
+		return(1);
+	}
+	shared = (TLoadShared*) mmap(NULL, size, PROT_READ|PROT_WRITE, MAP_SHARED, fileDescriptor, 0);
+	close(fileDescriptor);
+	if (shared==(TLoadShared*) MAP_FAILED)
+	{
+		fprintf(stderr, "%s: cannot map %s\n", argv[0], path);
+		unlink(path);
+		return(1);
+	}
+	shared->state = kLoadStarting;
+	shared->slotCount = workerCount;
+	
+	if (server!=NULL)
+	{
+		char	*serverArgv[2];
+		
+		serverArgv[0] = (char*) server;
+		serverArgv[1] = NULL;
+		if (posix_spawn(&serverPid, server, NULL, NULL, serverArgv, environ)!=0)
+		{
+			fprintf(stderr, "%s: cannot start %s\n", argv[0], server);
+			unlink(path);
+			return(1);
+		}
+		startedServer = kQ3True;
+		LoadSleepUntil(LoadNow() + (uint64_t) kLoadServerStartNs);
+	}
+	
+	//drivers first, the clients look for their controllers; slot i is worker i
+	snprintf(tag, sizeof(tag), "%d", (int) getpid());
+	for (kind=0; kind<kLoadKindCount; kind++)
+	{
+		for (index=0; index<counts[kind]; index++)
+		{
+			shared->slot[workerCount].kind = kind;
+			LoadSpawn(argv[0], kind, workerCount, tag, path, (kind==kLoadDriver) ? rate : interval,
+						counts[kLoadDriver], &workers[workerCount]);
+			workerCount++;
+		}
+		
+		if (kind==kLoadDriver)
+		{
+			failed = LoadWaitReady(shared, workers, 0, counts[kLoadDriver]);
+			if (failed!=0)
+			{
+				fprintf(stderr, "%s: %u of %u drivers could not register\n", argv[0], failed, counts[kLoadDriver]);
+				shared->state = kLoadStopping;
+				break;
+			}
+		}
+	}
+	
+	if (shared->state==kLoadStarting)
+	{
+		failed = LoadWaitReady(shared, workers, counts[kLoadDriver], workerCount-counts[kLoadDriver]);
+		if (failed!=0)
+			fprintf(stderr, "%s: %u clients did not find the drivers\n", argv[0], failed);
+		
+		memset(previous, 0, sizeof(previous));
+		memset(zero, 0, sizeof(zero));
+		if (serverPid!=0)
+			LoadServerSample(serverPid, &cpuBefore, &residentBytes);
+		
+		shared->state = kLoadRunning;
+		start = before = LoadNow();
+		end = start + (uint64_t) seconds * 1000000000ULL;
+		next = start;
+		
+		do
+		{
+			next += (uint64_t) reportMilliseconds * 1000000ULL;
+			if (next>end)
+				next = end;
+			LoadSleepUntil(next);
+			now = LoadNow();
+			
+			LoadPoll(workers, workerCount);
+			LoadSum(shared, workers, workerCount, totals);
+			LoadReport("interval", (double) (now-start) * 1.0e-9, totals, previous, now-before);
+			memcpy(previous, totals, sizeof(totals));
+			
+			if (serverPid!=0)
+			{
+				if (LoadServerSample(serverPid, &cpuNs, &residentBytes)==kQ3Success)
+				{
+					printf("{\"phase\":\"interval\",\"t_s\":%.2f,\"kind\":\"server\",\"pid\":%d,\"cpu_pct\":%.1f,\"rss_kb\":%llu}\n",
+							(double) (now-start) * 1.0e-9, (int) serverPid, (double) (cpuNs-cpuBefore) * 100.0 / (now-before),
+							(unsigned long long) (residentBytes/1024));
+					cpuBefore = cpuNs;
+				}
+				else
+					printf("{\"phase\":\"interval\",\"t_s\":%.2f,\"kind\":\"server\",\"pid\":%d,\"alive\":false}\n",
+							(double) (now-start) * 1.0e-9, (int) serverPid);
+				fflush(stdout);
+			}
+			before = now;
+		}
+		while (now<end);
+		
+		LoadReport("total", (double) (now-start) * 1.0e-9, totals, zero, now-start);
+	}
+	
+	//workers stop at their next round; counters stay as reported
+	shared->state = kLoadStopping;
+	for (index=0; index<workerCount; index++)
+		if (!workers[index].exited)
+			waitpid(workers[index].pid, &status, 0);
+	
+	if (startedServer)
+	{
+		kill(serverPid, SIGTERM);
+		waitpid(serverPid, &status, 0);
+	}
+	
+	munmap((void*) shared, size);
+	unlink(path);
+	return(0);
+}
@@ -0,0 +1,369 @@
+/*  NAME:
+        MagellanParserTest.c
+
+    DESCRIPTION:
+        Checks MagellanParser against a captured SpaceMouse session: every
+		packet decoded with its values, resynchronisation after line noise, and
+		the same events however the stream is split into reads.
+		
+		Build and run, from this directory:
+		
+		    cc -O2 -I../../SpaceMouseController MagellanParserTest.c ../../SpaceMouseController/MagellanParser.c -o MagellanParserTest
+		    ./MagellanParserTest
+		
+		Exits with 0, if all cases pass.
+      
+    COPYRIGHT:
+        Copyright (c) 1999-2005, Quesa Developers. All rights reserved.
+
+        For the current release of Quesa, please see:
+
+            <http://www.quesa.org/>
+        
+        Redistribution and use in source and binary forms, with or without
+        modification, are permitted provided that the following conditions
+        are met:
+        
+            o Redistributions of source code must retain the above copyright
+              notice, this list of conditions and the following disclaimer.
+        
+            o Redistributions in binary form must reproduce the above
+              copyright notice, this list of conditions and the following
+              disclaimer in the documentation and/or other materials provided
+              with the distribution.
+        
+            o Neither the name of Quesa nor the names of its contributors
+              may be used to endorse or promote products derived from this
+              software without specific prior written permission.
+        
+        THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+        "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+        LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+        A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+        OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+        SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+        TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+        PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+        LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+        NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+        SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+    ___________________________________________________________________________
+*/
+
+
+//=============================================================================
+//      Include files
+//-----------------------------------------------------------------------------
+#include "MagellanParser.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+
+
+
+//=============================================================================
+//      Internal constants
+//-----------------------------------------------------------------------------
+#define kTestMaxEvents				256
+#define kTestMaxText				kMagellanMaxPacketSize
+#define kTestRepeats				5		//the capture is ~200 bytes, so the ring wraps
+
+
+
+
+
+//=============================================================================
+//      Internal types
+//-----------------------------------------------------------------------------
+typedef struct TTestExpected
+{
+	TMagellanEventType		type;
+	int16_t					axes[kMagellanAxisCount];
+	uint16_t				keys;
+	uint8_t					values[2];				//mode, nullRadius, qualities or rates
+	const char				*text;
+} TTestExpected;
+
+typedef struct TTestLog
+{
+	uint32_t				count;
+	TMagellanEvent			events[kTestMaxEvents];
+	char					texts[kTestMaxEvents][kTestMaxText];
+} TTestLog;
+
+
+
+
+
+//=============================================================================
+//      Internal variables
+//-----------------------------------------------------------------------------
+//the device's side of a session: zero, version query, mode, rate, quality and
+//null radius set, key 1 pressed and released, motion, the star key, a beep
+static const char kTestCapture[] =
+	"z\r"
+	"v  MAGELLAN  Version 6.60  3Dconnexion GmbH 05/11/00\r"
+	"m3\r"
+	"pHB\r"
+	"q00\r"
+	"nB\r"
+	"kA00\r"
+	"dH000H000H000H000H000H000\r"
+	"dH0GHG?M3H00GGNMDH00BH000\r"
+	"k000\r"
+	"dG???H00A0000????H0??G?00\r"
+	"dH0BHG?MHHA90GNG0H?:0G060\r"
+	"k00A\r"
+	"k??A\r"
+	"bK\r";
+
+static const TTestExpected kTestCaptureEvents[] =
+{
+	{ kMagellanEventZero,		{0},									0,		{0,0},	"" },
+	{ kMagellanEventVersion,	{0},									0,		{0,0},	"  MAGELLAN  Version 6.60  3Dconnexion GmbH 05/11/00" },
+	{ kMagellanEventMode,		{0},									0,		{3,0},	NULL },
+	{ kMagellanEventDataRate,	{0},									0,		{8,2},	NULL },
+	{ kMagellanEventQuality,	{0},									0,		{0,0},	NULL },
+	{ kMagellanEventNullRadius,	{0},									0,		{2,0},	NULL },
+	{ kMagellanEventKeys,		{0},									0x001,	{0,0},	NULL },
+	{ kMagellanEventMotion,		{0, 0, 0, 0, 0, 0},						0,		{0,0},	NULL },
+	{ kMagellanEventMotion,		{120, -45, 7, -300, 2, 0},				0,		{0,0},	NULL },
+	{ kMagellanEventKeys,		{0},									0x000,	{0,0},	NULL },
+	{ kMagellanEventMotion,		{-1, 1, -32768, 32767, 255, -256},		0,		{0,0},	NULL },
+	{ kMagellanEventMotion,		{40, -40, 400, -400, 4000, -4000},		0,		{0,0},	NULL },
+	{ kMagellanEventKeys,		{0},									0x100,	{0,0},	NULL },
+	{ kMagellanEventKeys,		{0},									0x1FF,	{0,0},	NULL },
+	{ kMagellanEventBeep,		{0},									0,		{0,0},	"K" }
+};
+
+#define kTestCaptureEventCount		(sizeof(kTestCaptureEvents)/sizeof(kTestCaptureEvents[0]))
+
+
+
+
+
+//=============================================================================
+//      Internal functions
+//-----------------------------------------------------------------------------
+//      TestEventProc : Log a decoded event, with a copy of its text.
+//-----------------------------------------------------------------------------
+static void
+TestEventProc(const TMagellanEvent *event, void *refCon)
+{
+	TTestLog	*log = (TTestLog *) refCon;
+	
+	if (log->count>=kTestMaxEvents)
+		return;
+	
+	log->events[log->count] = *event;
+	if (event->text!=NULL)
+	{
+		memcpy(log->texts[log->count], event->text, event->textLength);
+		log->events[log->count].text = log->texts[log->count];
+	}
+	log->count++;
+}
+
+
+
+//=============================================================================
+//      TestMatches : Whether a logged event is the expected one.
+//-----------------------------------------------------------------------------
+static int
+TestMatches(const TMagellanEvent *event, const TTestExpected *expected)
+{
+	if (event->type!=expected->type)
+		return(0);
+	
+	switch (event->type)
+	{
+		case kMagellanEventMotion:
+			return(memcmp(event->axes, expected->axes, sizeof(event->axes))==0);
+		
+		case kMagellanEventKeys:
+			return(event->keys==expected->keys);
+		
+		case kMagellanEventMode:
+			return(event->mode==expected->values[0]);
+		
+		case kMagellanEventNullRadius:
+			return(event->nullRadius==expected->values[0]);
+		
+		case kMagellanEventQuality:
+			return((event->transQuality==expected->values[0]) && (event->rotQuality==expected->values[1]));
+		
+		case kMagellanEventDataRate:
+			return((event->maxRate==expected->values[0]) && (event->minRate==expected->values[1]));
+		
+		default:
+			return((event->textLength==strlen(expected->text))
+				&& (memcmp(event->text, expected->text, event->textLength)==0));
+	}
+}
+
+
+
+//=============================================================================
+//      TestCheckLog : Whether the log holds repeats times the capture's events.
+//-----------------------------------------------------------------------------
+static int
+TestCheckLog(const TTestLog *log, uint32_t repeats)
+{
+	uint32_t	index;
+	
+	if (log->count!=repeats*kTestCaptureEventCount)
+	{
+		printf("    %u events, expected %u\n", (unsigned) log->count, (unsigned) (repeats*kTestCaptureEventCount));
+		return(0);
+	}
+	
+	for (index=0; index<log->count; index++)
+		if (!TestMatches(&log->events[index], &kTestCaptureEvents[index % kTestCaptureEventCount]))
+		{
+			printf("    event %u ('%c') differs\n", (unsigned) index, (char) log->events[index].type);
+			return(0);
+		}
+	
+	return(1);
+}
+
+
+
+//=============================================================================
+//      TestReport : One line per case.
+//-----------------------------------------------------------------------------
+static int
+TestReport(const char *name, int passed)
+{
+	printf("%-40s %s\n", name, passed ? "ok" : "FAILED");
+	return(!passed);
+}
+
+
+
+//=============================================================================
+//      TestWhole : The capture in one read.
+//-----------------------------------------------------------------------------
+static int
+TestWhole(void)
+{
+	static TTestLog		log;
+	TMagellanParser		parser;
+	
+	memset(&log, 0, sizeof(log));
+	MagellanParser_Init(&parser);
+	MagellanParser_Feed(&parser, (const uint8_t *) kTestCapture, sizeof(kTestCapture)-1, TestEventProc, &log);
+	
+	return(TestCheckLog(&log, 1) && (parser.errorCount==0) && (parser.packetCount==kTestCaptureEventCount));
+}
+
+
+
+//=============================================================================
+//      TestSplit : The capture, repeated, in reads of every size.
+//-----------------------------------------------------------------------------
+//		Note : Reads go through WriteBuffer and Commit as a port reader's do,
+//				so packets are cut at every offset and wrap around the ring.
+//-----------------------------------------------------------------------------
+static int
+TestSplit(void)
+{
+	static TTestLog		log;
+	TMagellanParser		parser;
+	uint32_t			length = sizeof(kTestCapture)-1;
+	uint32_t			readSize, repeat, done;
+	
+	for (readSize=1; readSize<=kMagellanRingSize; readSize++)
+	{
+		memset(&log, 0, sizeof(log));
+		MagellanParser_Init(&parser);
+		
+		for (repeat=0; repeat<kTestRepeats; repeat++)
+			for (done=0; done<length; )
+			{
+				uint32_t	freeSize;
+				uint8_t		*buffer = MagellanParser_WriteBuffer(&parser, &freeSize);
+				
+				if (freeSize>readSize)
+					freeSize = readSize;
+				if (freeSize>length-done)
+					freeSize = length-done;
+				
+				memcpy(buffer, kTestCapture+done, freeSize);
+				MagellanParser_Commit(&parser, freeSize);
+				MagellanParser_Parse(&parser, TestEventProc, &log);
+				done += freeSize;
+			}
+		
+		if (!TestCheckLog(&log, kTestRepeats) || (parser.errorCount!=0))
+		{
+			printf("    read size %u\n", (unsigned) readSize);
+			return(0);
+		}
+	}
+	
+	return(1);
+}
+
+
+
+//=============================================================================
+//      TestGarbage : The capture after line noise, and with a packet cut short.
+//-----------------------------------------------------------------------------
+//		Note : The noise is longer than any packet and has no CR, so the
+//				parser has to discard it; a cut packet ends at its CR.
+//-----------------------------------------------------------------------------
+static int
+TestGarbage(void)
+{
+	static TTestLog		log;
+	static uint8_t		stream[1024];
+	TMagellanParser		parser;
+	uint32_t			length = 0, index, cut;
+	
+	//noise of a device powering up, without a CR
+	for (index=0; index<2*kMagellanMaxPacketSize; index++)
+		stream[length++] = (uint8_t) (0x80 | (index*37));
+	stream[length++] = '\r';
+	
+	//a motion packet cut short, and an unknown packet type
+	memcpy(stream+length, "dH000H0\r", 8);		length += 8;
+	memcpy(stream+length, "\x01\x7f\r", 3);		length += 3;
+	
+	//the capture, with another cut motion packet between two of its packets
+	cut = (uint32_t) (strstr(kTestCapture, "k000\r") - kTestCapture);
+	memcpy(stream+length, kTestCapture, cut);							length += cut;
+	memcpy(stream+length, "dH0GHG?M3H\r", 11);							length += 11;
+	memcpy(stream+length, kTestCapture+cut, sizeof(kTestCapture)-1-cut);	length += sizeof(kTestCapture)-1-cut;
+	
+	memset(&log, 0, sizeof(log));
+	MagellanParser_Init(&parser);
+	MagellanParser_Feed(&parser, stream, length, TestEventProc, &log);
+	
+	if (parser.errorCount!=4)
+		printf("    %u errors, expected 4\n", (unsigned) parser.errorCount);
+	
+	return(TestCheckLog(&log, 1) && (parser.errorCount==4));
+}
+
+
+
+
+
+//=============================================================================
+//      main
+//-----------------------------------------------------------------------------
+int
+main(void)
+{
+	int		failures = 0;
+	
+	failures += TestReport("captured session, one read", TestWhole());
+	failures += TestReport("captured session, split reads", TestSplit());
+	failures += TestReport("resync after noise and cut packets", TestGarbage());
+	
+	return(failures!=0);
+}
@@ -0,0 +1,604 @@
+/*  NAME:
+        MagellanSimulator.c
+
+    DESCRIPTION:
+        Simulates a Magellan/SpaceMouse on a pseudo terminal, for driving
+		SPCMObject or DriverHost without the device.
+		
+		It replies to the host's commands as the device does: it echoes the
+		z, b, m, q, n and p commands and answers vQ with a version string. It
+		also sends key and motion events at any rate; a pty is not limited to
+		9600 baud. Motion honours the mode (translation, rotation, dominant)
+		and the null radius set by the host.
+		
+		    MagellanSimulator [-r rate] [-m sine|random|probe] [-s script] [-k keyPeriod]
+		                      [-d duration] [-t timestampLog] [-l linkPath]
+		
+		    -r  motion events per second (default 50)
+		    -m  sine sweeps, random walk, or latency probes: x counts up the
+		        sample number and all other axes are 0, so every sample can be
+		        recognized at the tracker
+		    -s  script of "x y z a b c keys" lines (device counts), one per event, looping
+		    -k  toggle key 1 every keyPeriod seconds
+		    -d  stop after duration seconds
+		    -t  log "sample nanoseconds" per motion event, for latency measurements
+		    -l  symlink to the pty, e.g. a stable name for the SpaceMouseController prefs
+		
+		Build, from this directory:
+		
+		    cc -O2 -I../../SpaceMouseController -I../../common MagellanSimulator.c ../../SpaceMouseController/MagellanParser.c -lm -o MagellanSimulator
+      
+    COPYRIGHT:
+        Copyright (c) 1999-2005, Quesa Developers. All rights reserved.
+
+        For the current release of Quesa, please see:
+
+            <http://www.quesa.org/>
+        
+        Redistribution and use in source and binary forms, with or without
+        modification, are permitted provided that the following conditions
+        are met:
+        
+            o Redistributions of source code must retain the above copyright
+              notice, this list of conditions and the following disclaimer.
+        
+            o Redistributions in binary form must reproduce the above
+              copyright notice, this list of conditions and the following
+              disclaimer in the documentation and/or other materials provided
+              with the distribution.
+        
+            o Neither the name of Quesa nor the names of its contributors
+              may be used to endorse or promote products derived from this
+              software without specific prior written permission.
+        
+        THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+        "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+        LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+        A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+        OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+        SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+        TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+        PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+        LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+        NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+        SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+    ___________________________________________________________________________
+*/
+
+
+
+
+
+//=============================================================================
+//      Include files
+//-----------------------------------------------------------------------------
+#if defined(__linux__)
+	//posix_openpt and friends
+	#define _XOPEN_SOURCE		600
+	#define _DEFAULT_SOURCE		1
+#endif
+
+#include "MagellanParser.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <math.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/select.h>
+
+#if defined(__APPLE__)
+	#include "C3MachTime.h"
+#else
+	#include <time.h>
+#endif
+
+
+
+
+
+//=============================================================================
+//      Internal constants
+//-----------------------------------------------------------------------------
+#define kSimulatorDefaultRate		50.0
+#define kSimulatorMaxDeflection		400			//counts; linear range of the device
+#define kSimulatorMaxScriptLines	65536
+#define kSimulatorVersion			"vMAGELLAN  Version 6.60 3D-Sensor by LOGITECH INC.\r"
+
+enum
+{
+	kSimulatorSine		= 0,
+	kSimulatorRandom	= 1,
+	kSimulatorProbe		= 2,
+	kSimulatorScript	= 3
+};
+
+
+
+
+
+//=============================================================================
+//      Internal types
+//-----------------------------------------------------------------------------
+typedef struct TSimulatorSample
+{
+	int				axes[kMagellanAxisCount];
+	unsigned int	keys;
+} TSimulatorSample;
+
+typedef struct TSimulator
+{
+	int					master;
+	TMagellanParser		parser;
+	
+	//device state, as set by the host
+	unsigned int		mode;					//bit 0 rotation, bit 1 translation, bit 2 dominant
+	unsigned int		transQuality;
+	unsigned int		rotQuality;
+	unsigned int		nullRadius;
+	unsigned int		maxRate;
+	unsigned int		minRate;
+	
+	//motion source
+	int					source;
+	TSimulatorSample	*script;
+	unsigned long		scriptLength;
+	int					walk[kMagellanAxisCount];
+	unsigned int		keys;
+	
+	unsigned long		sampleCount;
+	unsigned long		droppedCount;
+	FILE				*timestampLog;
+} TSimulator;
+
+
+
+
+
+//=============================================================================
+//      Internal variables
+//-----------------------------------------------------------------------------
+static volatile int running = 1;
+
+
+
+
+
+//=============================================================================
+//      Internal functions
+//-----------------------------------------------------------------------------
+//      Simulator_Now : Monotonic time in nanoseconds.
+//-----------------------------------------------------------------------------
+static unsigned long long
+Simulator_Now(void)
+{
+#if defined(__APPLE__)
+	static mach_timebase_info_data_t	timebase;
+	
+	if (timebase.denom==0)
+		mach_timebase_info(&timebase);
+	
+	return(CC3MachTime_ToNanoseconds(mach_absolute_time(), &timebase));
+#else
+	struct timespec		now;
+	
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return((unsigned long long) now.tv_sec * 1000000000ULL + (unsigned long long) now.tv_nsec);
+#endif
+}
+
+
+
+//=============================================================================
+//      Simulator_Signal : Stop on SIGINT/SIGTERM.
+//-----------------------------------------------------------------------------
+static void
+Simulator_Signal(int signalNumber)
+{
+	(void) signalNumber;
+	running = 0;
+}
+
+
+
+//=============================================================================
+//      Simulator_Send : Write a packet to the host.
+//-----------------------------------------------------------------------------
+//		Note : The master is non-blocking; a host that does not keep up loses
+//				whole packets, never parts of one.
+//-----------------------------------------------------------------------------
+static int
+Simulator_Send(TSimulator *simulator, const char *packet, size_t length)
+{
+	ssize_t		written = write(simulator->master, packet, length);
+	
+	if (written==(ssize_t) length)
+		return(1);
+	
+	//a partial packet would desynchronize the host; finish it blocking
+	if (written>0)
+	{
+		int flags = fcntl(simulator->master, F_GETFL);
+		
+		fcntl(simulator->master, F_SETFL, flags & ~O_NONBLOCK);
+		written = write(simulator->master, packet+written, length-(size_t) written);
+		fcntl(simulator->master, F_SETFL, flags);
+		return(1);
+	}
+	
+	simulator->droppedCount++;
+	return(0);
+}
+
+
+
+//=============================================================================
+//      Simulator_EncodeValue : Four device characters for a signed count.
+//-----------------------------------------------------------------------------
+static void
+Simulator_EncodeValue(char *chars, int value)
+{
+	unsigned int	encoded = (unsigned int) (value + 32768);
+	
+	chars[0] = MagellanParser_NibbleToChar(encoded>>12);
+	chars[1] = MagellanParser_NibbleToChar(encoded>>8);
+	chars[2] = MagellanParser_NibbleToChar(encoded>>4);
+	chars[3] = MagellanParser_NibbleToChar(encoded);
+}
+
+
+
+//=============================================================================
+//      Simulator_SendKeys : Send a key event.
+//-----------------------------------------------------------------------------
+static void
+Simulator_SendKeys(TSimulator *simulator, unsigned int keys)
+{
+	char	packet[5];
+	
+	packet[0] = 'k';
+	packet[1] = MagellanParser_NibbleToChar(keys);
+	packet[2] = MagellanParser_NibbleToChar(keys>>4);
+	packet[3] = MagellanParser_NibbleToChar(keys>>8);
+	packet[4] = '\r';
+	Simulator_Send(simulator, packet, sizeof(packet));
+}
+
+
+
+//=============================================================================
+//      Simulator_SendMotion : Apply the device settings and send motion.
+//-----------------------------------------------------------------------------
+static void
+Simulator_SendMotion(TSimulator *simulator, const int *axes)
+{
+	char	packet[1 + 4*kMagellanAxisCount + 1];
+	int		filtered[kMagellanAxisCount];
+	int		axis, dominant = 0;
+	
+	for (axis=0; axis<kMagellanAxisCount; axis++)
+	{
+		filtered[axis] = axes[axis];
+		
+		//the null radius is in steps of about 4 counts
+		if (abs(filtered[axis]) <= (int) simulator->nullRadius*4)
+			filtered[axis] = 0;
+		
+		if ((axis<3) && !(simulator->mode & 0x02))
+			filtered[axis] = 0;
+		if ((axis>=3) && !(simulator->mode & 0x01))
+			filtered[axis] = 0;
+		
+		if (abs(filtered[axis]) > abs(filtered[dominant]))
+			dominant = axis;
+	}
+	
+	if (simulator->mode & 0x04)
+		for (axis=0; axis<kMagellanAxisCount; axis++)
+			if (axis!=dominant)
+				filtered[axis] = 0;
+	
+	packet[0] = 'd';
+	for (axis=0; axis<kMagellanAxisCount; axis++)
+		Simulator_EncodeValue(&packet[1+4*axis], filtered[axis]);
+	packet[sizeof(packet)-1] = '\r';
+	
+	if (Simulator_Send(simulator, packet, sizeof(packet)) && (simulator->timestampLog!=NULL))
+		fprintf(simulator->timestampLog, "%lu %llu\n", simulator->sampleCount, Simulator_Now());
+}
+
+
+
+//=============================================================================
+//      Simulator_NextSample : Produce the next motion sample.
+//-----------------------------------------------------------------------------
+static void
+Simulator_NextSample(TSimulator *simulator, double seconds, int *axes)
+{
+	int		axis;
+	
+	switch (simulator->source)
+	{
+		case kSimulatorRandom:
+			for (axis=0; axis<kMagellanAxisCount; axis++)
+			{
+				simulator->walk[axis] += (rand() % 41) - 20;
+				if (simulator->walk[axis] >  kSimulatorMaxDeflection) simulator->walk[axis] =  kSimulatorMaxDeflection;
+				if (simulator->walk[axis] < -kSimulatorMaxDeflection) simulator->walk[axis] = -kSimulatorMaxDeflection;
+				axes[axis] = simulator->walk[axis];
+			}
+			break;
+		
+		case kSimulatorProbe:
+			//1..30000, never 0: a zero sample would vanish in the null radius
+			memset(axes, 0, kMagellanAxisCount*sizeof(int));
+			axes[0] = (int) (simulator->sampleCount % 30000) + 1;
+			break;
+		
+		case kSimulatorScript:
+		{
+			const TSimulatorSample *sample = &simulator->script[simulator->sampleCount % simulator->scriptLength];
+			
+			memcpy(axes, sample->axes, sizeof(sample->axes));
+			if (sample->keys!=simulator->keys)
+			{
+				simulator->keys = sample->keys;
+				Simulator_SendKeys(simulator, simulator->keys);
+			}
+			break;
+		}
+		
+		default:
+			//each axis sweeps at its own frequency
+			for (axis=0; axis<kMagellanAxisCount; axis++)
+				axes[axis] = (int) (kSimulatorMaxDeflection * sin(seconds * (0.5 + 0.25*axis)));
+			break;
+	}
+}
+
+
+
+//=============================================================================
+//      Simulator_EventProc : Answer a command of the host.
+//-----------------------------------------------------------------------------
+static void
+Simulator_EventProc(const TMagellanEvent *event, void *refCon)
+{
+	TSimulator	*simulator = (TSimulator *) refCon;
+	char		packet[4];
+	
+	switch (event->type)
+	{
+		case kMagellanEventMode:
+			simulator->mode = event->mode;
+			packet[0] = 'm';
+			packet[1] = MagellanParser_NibbleToChar(simulator->mode);
+			packet[2] = '\r';
+			Simulator_Send(simulator, packet, 3);
+			break;
+		
+		case kMagellanEventQuality:
+			simulator->transQuality	= event->transQuality;
+			simulator->rotQuality	= event->rotQuality;
+			packet[0] = 'q';
+			packet[1] = MagellanParser_NibbleToChar(simulator->transQuality);
+			packet[2] = MagellanParser_NibbleToChar(simulator->rotQuality);
+			packet[3] = '\r';
+			Simulator_Send(simulator, packet, 4);
+			break;
+		
+		case kMagellanEventNullRadius:
+			simulator->nullRadius = event->nullRadius;
+			packet[0] = 'n';
+			packet[1] = MagellanParser_NibbleToChar(simulator->nullRadius);
+			packet[2] = '\r';
+			Simulator_Send(simulator, packet, 3);
+			break;
+		
+		case kMagellanEventDataRate:
+			simulator->maxRate = event->maxRate;
+			simulator->minRate = event->minRate;
+			packet[0] = 'p';
+			packet[1] = MagellanParser_NibbleToChar(simulator->maxRate);
+			packet[2] = MagellanParser_NibbleToChar(simulator->minRate);
+			packet[3] = '\r';
+			Simulator_Send(simulator, packet, 4);
+			break;
+		
+		case kMagellanEventZero:
+			Simulator_Send(simulator, "z\r", 2);
+			break;
+		
+		case kMagellanEventBeep:
+			packet[0] = 'b';
+			packet[1] = (event->textLength>0) ? event->text[0] : MagellanParser_NibbleToChar(0);
+			packet[2] = '\r';
+			Simulator_Send(simulator, packet, 3);
+			break;
+		
+		case kMagellanEventVersion:
+			Simulator_Send(simulator, kSimulatorVersion, strlen(kSimulatorVersion));
+			break;
+		
+		default:
+			break;
+	}
+}
+
+
+
+//=============================================================================
+//      Simulator_ReadScript : Load "x y z a b c keys" lines.
+//-----------------------------------------------------------------------------
+static int
+Simulator_ReadScript(TSimulator *simulator, const char *path)
+{
+	FILE				*file = fopen(path, "r");
+	char				line[256];
+	TSimulatorSample	sample;
+	
+	if (file==NULL)
+		return(0);
+	
+	simulator->script = (TSimulatorSample *) calloc(kSimulatorMaxScriptLines, sizeof(TSimulatorSample));
+	while ((simulator->script!=NULL) && (simulator->scriptLength<kSimulatorMaxScriptLines) && (fgets(line, sizeof(line), file)!=NULL))
+	{
+		memset(&sample, 0, sizeof(sample));
+		if ((line[0]=='#') || (sscanf(line, "%d %d %d %d %d %d %u", &sample.axes[0], &sample.axes[1], &sample.axes[2],
+								&sample.axes[3], &sample.axes[4], &sample.axes[5], &sample.keys) < 6))
+			continue;
+		simulator->script[simulator->scriptLength++] = sample;
+	}
+	
+	fclose(file);
+	return(simulator->scriptLength>0);
+}
+
+
+
+
+
+//=============================================================================
+//      main
+//-----------------------------------------------------------------------------
+int
+main(int argc, char *argv[])
+{
+	TSimulator			simulator;
+	double				rate = kSimulatorDefaultRate, keyPeriod = 0.0, duration = 0.0;
+	const char			*linkPath = NULL, *slaveName;
+	unsigned long long	startTime, nextSample, nextKey, now;
+	int					option, axes[kMagellanAxisCount];
+	fd_set				readSet;
+	struct timeval		timeout;
+	
+	memset(&simulator, 0, sizeof(simulator));
+	simulator.mode		= 0x03;
+	simulator.maxRate	= 8;
+	simulator.minRate	= 2;
+	MagellanParser_Init(&simulator.parser);
+	
+	while ((option = getopt(argc, argv, "r:m:s:k:d:t:l:"))!=-1)
+	{
+		switch (option)
+		{
+			case 'r':	rate		= atof(optarg);		break;
+			case 'k':	keyPeriod	= atof(optarg);		break;
+			case 'd':	duration	= atof(optarg);		break;
+			case 'l':	linkPath	= optarg;			break;
+			case 'm':
+				if (strcmp(optarg, "random")==0)		simulator.source = kSimulatorRandom;
+				else if (strcmp(optarg, "probe")==0)	simulator.source = kSimulatorProbe;
+				else									simulator.source = kSimulatorSine;
+				break;
+			case 's':
+				if (!Simulator_ReadScript(&simulator, optarg))
+				{
+					fprintf(stderr, "%s: cannot read script %s\n", argv[0], optarg);
+					return(1);
+				}
+				simulator.source = kSimulatorScript;
+				break;
+			case 't':
+				simulator.timestampLog = fopen(optarg, "w");
+				if (simulator.timestampLog==NULL)
+				{
+					fprintf(stderr, "%s: cannot write %s\n", argv[0], optarg);
+					return(1);
+				}
+				break;
+			default:
+				fprintf(stderr, "usage: %s [-r rate] [-m sine|random|probe] [-s script] [-k keyPeriod]\n"
+								"       [-d duration] [-t timestampLog] [-l linkPath]\n", argv[0]);
+				return(1);
+		}
+	}
+	
+	if (rate<=0.0)
+		rate = kSimulatorDefaultRate;
+	
+	//the device side of the pty
+	simulator.master = posix_openpt(O_RDWR | O_NOCTTY);
+	if ((simulator.master<0) || (grantpt(simulator.master)!=0) || (unlockpt(simulator.master)!=0)
+	||  ((slaveName = ptsname(simulator.master))==NULL))
+	{
+		fprintf(stderr, "%s: cannot open a pty - %s(%d)\n", argv[0], strerror(errno), errno);
+		return(1);
+	}
+	fcntl(simulator.master, F_SETFL, fcntl(simulator.master, F_GETFL) | O_NONBLOCK);
+	
+	if (linkPath!=NULL)
+	{
+		unlink(linkPath);
+		if (symlink(slaveName, linkPath)!=0)
+			fprintf(stderr, "%s: cannot link %s - %s(%d)\n", argv[0], linkPath, strerror(errno), errno);
+	}
+	
+	printf("%s\n", slaveName);
+	fflush(stdout);
+	
+	signal(SIGINT,  Simulator_Signal);
+	signal(SIGTERM, Simulator_Signal);
+	
+	startTime	= Simulator_Now();
+	nextSample	= startTime;
+	nextKey		= (keyPeriod>0.0) ? startTime + (unsigned long long) (keyPeriod*1.0e9) : 0;
+	
+	while (running)
+	{
+		now = Simulator_Now();
+		
+		if ((duration>0.0) && (now-startTime >= (unsigned long long) (duration*1.0e9)))
+			break;
+		
+		//all samples that are due; a late loop catches up instead of stretching time
+		while (now>=nextSample)
+		{
+			Simulator_NextSample(&simulator, (double) (nextSample-startTime)*1.0e-9, axes);
+			Simulator_SendMotion(&simulator, axes);
+			simulator.sampleCount++;
+			nextSample += (unsigned long long) (1.0e9/rate);
+		}
+		
+		if ((nextKey!=0) && (now>=nextKey))
+		{
+			simulator.keys ^= 0x01;
+			Simulator_SendKeys(&simulator, simulator.keys);
+			nextKey += (unsigned long long) (keyPeriod*1.0e9);
+		}
+		
+		//commands of the host, until the next sample is due
+		FD_ZERO(&readSet);
+		FD_SET(simulator.master, &readSet);
+		now = Simulator_Now();
+		timeout.tv_sec	= (nextSample>now) ? (long) ((nextSample-now)/1000000000ULL) : 0;
+		timeout.tv_usec	= (nextSample>now) ? (long) (((nextSample-now)%1000000000ULL)/1000ULL) : 0;
+		
+		if (select(simulator.master+1, &readSet, NULL, NULL, &timeout)>0)
+		{
+			uint32_t	freeSize;
+			uint8_t		*buffer = MagellanParser_WriteBuffer(&simulator.parser, &freeSize);
+			ssize_t		byteCount = read(simulator.master, buffer, freeSize);
+			
+			if (byteCount>0)
+			{
+				MagellanParser_Commit(&simulator.parser, (uint32_t) byteCount);
+				MagellanParser_Parse(&simulator.parser, Simulator_EventProc, &simulator);
+			}
+		}
+	}
+	
+	fprintf(stderr, "%lu motion events, %lu dropped by a slow host, %.1f s\n", simulator.sampleCount,
+			simulator.droppedCount, (double) (Simulator_Now()-startTime)*1.0e-9);
+	
+	if (simulator.timestampLog!=NULL)
+		fclose(simulator.timestampLog);
+	if (linkPath!=NULL)
+		unlink(linkPath);
+	close(simulator.master);
+	free(simulator.script);
+	return(0);
+}
@@ -0,0 +1,335 @@
+/*  NAME:
+        QuaternionBench.c
+
+    DESCRIPTION:
+        Microbenchmark of the quaternion kernels in C3QuaternionMath.c
+		against the one-at-a-time scalar code they replace.
+		
+		Build and run, from this directory:
+		
+		    cc -O2 -I../../common QuaternionBench.c ../../common/C3QuaternionMath.c -lm -o QuaternionBench
+		    ./QuaternionBench [count] [rounds]
+		
+		On Mac OS X add -F with the location of Quesa.framework.
+      
+    COPYRIGHT:
+        Copyright (c) 1999-2005, Quesa Developers. All rights reserved.
+
+        For the current release of Quesa, please see:
+
+            <http://www.quesa.org/>
+        
+        Redistribution and use in source and binary forms, with or without
+        modification, are permitted provided that the following conditions
+        are met:
+        
+            o Redistributions of source code must retain the above copyright
+              notice, this list of conditions and the following disclaimer.
+        
+            o Redistributions in binary form must reproduce the above
+              copyright notice, this list of conditions and the following
+              disclaimer in the documentation and/or other materials provided
+              with the distribution.
+        
+            o Neither the name of Quesa nor the names of its contributors
+              may be used to endorse or promote products derived from this
+              software without specific prior written permission.
+        
+        THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+        "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+        LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+        A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+        OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+        SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+        TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+        PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+        LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+        NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+        SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+    ___________________________________________________________________________
+*/
+
+//=============================================================================
+//      Include files
+//-----------------------------------------------------------------------------
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#if defined(__APPLE__)
+	#include <mach/mach_time.h>
+#else
+	#include <time.h>
+#endif
+
+#include "C3QuaternionMath.h"
+
+
+
+
+
+//=============================================================================
+//      Internal constants
+//-----------------------------------------------------------------------------
+#define kBenchDefaultCount			1024
+#define kBenchDefaultRounds			2000
+#define kBenchTolerance				1.0e-5f
+
+
+
+
+
+//=============================================================================
+//      Internal functions
+//-----------------------------------------------------------------------------
+//      BenchNow : Monotonic time in nanoseconds.
+//-----------------------------------------------------------------------------
+static double
+BenchNow(void)
+{
+#if defined(__APPLE__)
+	static mach_timebase_info_data_t timebase;
+	if (timebase.denom==0)
+		mach_timebase_info(&timebase);
+	return((double) mach_absolute_time() * timebase.numer / timebase.denom);
+#else
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC,&ts);
+	return((double) ts.tv_sec * 1.0e9 + (double) ts.tv_nsec);
+#endif
+}
+
+
+
+//=============================================================================
+//      Reference code : what the tracker path did before the kernels.
+//-----------------------------------------------------------------------------
+//copy of CC3Quaternion_Multiply in ControllerCoreOSX.c
+static TQ3Quaternion *
+RefMultiply(const TQ3Quaternion *q1, const TQ3Quaternion *q2, TQ3Quaternion *result)
+{
+	TQ3Quaternion temp;
+	TQ3Quaternion* output = (result == q1 || result == q2 ? &temp : result);
+
+	output->w = q1->w*q2->w - q1->x*q2->x - q1->y*q2->y - q1->z*q2->z;
+	output->x = q1->w*q2->x + q1->x*q2->w - q1->y*q2->z + q1->z*q2->y;
+	output->y = q1->w*q2->y + q1->y*q2->w - q1->z*q2->x + q1->x*q2->z;
+	output->z = q1->w*q2->z + q1->z*q2->w - q1->x*q2->y + q1->y*q2->x;
+	
+	if (output == &temp)
+		*result = temp;
+	
+	return(result);
+}
+
+//copy of CC3Quaternion_GetAngle in ControllerCoreOSX.c
+static void
+RefGetAngle(const TQ3Quaternion *q, float *outAngle)
+{
+	float w_temp = q->w/sqrt(q->w*q->w + q->x*q->x + q->y*q->y + q->z*q->z);
+	
+	if (w_temp > 1.0f - kQ3RealZero || w_temp < -1.0f + kQ3RealZero)
+		*outAngle = 0.0f;
+	else
+		*outAngle = 2.0f * (float) acos(w_temp);
+}
+
+//as Q3Quaternion_SetRotate_XYZ
+static void
+RefSetRotateXYZ(TQ3Quaternion *q, float x, float y, float z)
+{
+	float cosX = (float) cos(0.5f*x), sinX = (float) sin(0.5f*x);
+	float cosY = (float) cos(0.5f*y), sinY = (float) sin(0.5f*y);
+	float cosZ = (float) cos(0.5f*z), sinZ = (float) sin(0.5f*z);
+	
+	q->w = cosZ*cosY*cosX + sinZ*sinY*sinX;
+	q->x = cosZ*cosY*sinX - sinZ*sinY*cosX;
+	q->y = cosZ*sinY*cosX + sinZ*cosY*sinX;
+	q->z = sinZ*cosY*cosX - cosZ*sinY*sinX;
+}
+
+//as Q3Quaternion_Normalize
+static void
+RefNormalize(const TQ3Quaternion *q, TQ3Quaternion *result)
+{
+	float len = (float) sqrt(q->w*q->w + q->x*q->x + q->y*q->y + q->z*q->z);
+	
+	result->w = q->w/len;
+	result->x = q->x/len;
+	result->y = q->y/len;
+	result->z = q->z/len;
+}
+
+
+
+//=============================================================================
+//      BenchRandom : Uniform float in [lo, hi).
+//-----------------------------------------------------------------------------
+static float
+BenchRandom(float lo, float hi)
+{
+	return(lo + (hi-lo) * (float) rand() / ((float) RAND_MAX + 1.0f));
+}
+
+
+
+//=============================================================================
+//      BenchCompare : Largest component difference of two arrays.
+//-----------------------------------------------------------------------------
+static float
+BenchCompare(TQ3Uns32 count, const TQ3Quaternion *a, const TQ3Quaternion *b)
+{
+	float		maxDiff = 0.0f;
+	TQ3Uns32	i;
+	
+	for (i=0; i<count; i++)
+	{
+		float d = fabsf(a[i].w-b[i].w) + fabsf(a[i].x-b[i].x) + fabsf(a[i].y-b[i].y) + fabsf(a[i].z-b[i].z);
+		if (d>maxDiff)
+			maxDiff = d;
+	}
+	return(maxDiff);
+}
+
+
+
+//=============================================================================
+//      BenchReport : One line per kernel.
+//-----------------------------------------------------------------------------
+static void
+BenchReport(const char *name, double refNs, double newNs, TQ3Uns32 ops, float maxDiff)
+{
+	printf("%-16s scalar %8.2f ns/op   kernel %8.2f ns/op   speedup %5.2fx   max diff %g%s\n",
+			name, refNs/ops, newNs/ops, refNs/newNs, maxDiff,
+			(maxDiff>kBenchTolerance) ? "   MISMATCH" : "");
+}
+
+
+
+
+
+//=============================================================================
+//      main
+//-----------------------------------------------------------------------------
+int
+main(int argc, char *argv[])
+{
+	TQ3Uns32		count	= (argc>1) ? (TQ3Uns32) atoi(argv[1]) : kBenchDefaultCount;
+	TQ3Uns32		rounds	= (argc>2) ? (TQ3Uns32) atoi(argv[2]) : kBenchDefaultRounds;
+	TQ3Uns32		i, r, ops, refHits, newHits, mismatches;
+	double			t0, refNs, newNs;
+	float			thresholds[4] = { 0.0f, 0.01f, 0.5f, 3.0f };
+	volatile float	sink = 0.0f;
+	
+	TQ3Quaternion	*q1			= (TQ3Quaternion*) malloc(count*sizeof(TQ3Quaternion));
+	TQ3Quaternion	*q2			= (TQ3Quaternion*) malloc(count*sizeof(TQ3Quaternion));
+	TQ3Quaternion	*refResult	= (TQ3Quaternion*) malloc(count*sizeof(TQ3Quaternion));
+	TQ3Quaternion	*newResult	= (TQ3Quaternion*) malloc(count*sizeof(TQ3Quaternion));
+	TQ3Vector3D		*angles		= (TQ3Vector3D*) malloc(count*sizeof(TQ3Vector3D));
+	
+	if ((count==0) || (rounds==0) || !q1 || !q2 || !refResult || !newResult || !angles)
+	{
+		fprintf(stderr,"usage: %s [count] [rounds]\n",argv[0]);
+		return(1);
+	}
+	
+	srand(1);
+	for (i=0; i<count; i++)
+	{
+		//small per-packet rotations, as a SpaceMouse delivers them
+		angles[i].x = BenchRandom(-0.05f,0.05f);
+		angles[i].y = BenchRandom(-0.05f,0.05f);
+		angles[i].z = BenchRandom(-0.05f,0.05f);
+		RefSetRotateXYZ(&q1[i],angles[i].x,angles[i].y,angles[i].z);
+		RefSetRotateXYZ(&q2[i],BenchRandom(-3.0f,3.0f),BenchRandom(-3.0f,3.0f),BenchRandom(-3.0f,3.0f));
+	}
+	ops = count*rounds;
+	
+	printf("count %u, rounds %u\n",(unsigned) count,(unsigned) rounds);
+	
+	//multiply
+	t0 = BenchNow();
+	for (r=0; r<rounds; r++)
+		for (i=0; i<count; i++)
+			RefMultiply(&q1[i],&q2[i],&refResult[i]);
+	refNs = BenchNow()-t0;
+	
+	t0 = BenchNow();
+	for (r=0; r<rounds; r++)
+		CC3Quaternion_MultiplyArray(count,q1,q2,newResult);
+	newNs = BenchNow()-t0;
+	BenchReport("multiply",refNs,newNs,ops,BenchCompare(count,refResult,newResult));
+	
+	//normalize
+	t0 = BenchNow();
+	for (r=0; r<rounds; r++)
+		for (i=0; i<count; i++)
+			RefNormalize(&q2[i],&refResult[i]);
+	refNs = BenchNow()-t0;
+	
+	t0 = BenchNow();
+	for (r=0; r<rounds; r++)
+		CC3Quaternion_NormalizeArray(count,q2,newResult);
+	newNs = BenchNow()-t0;
+	BenchReport("normalize",refNs,newNs,ops,BenchCompare(count,refResult,newResult));
+	
+	//Euler angles
+	t0 = BenchNow();
+	for (r=0; r<rounds; r++)
+		for (i=0; i<count; i++)
+			RefSetRotateXYZ(&refResult[i],angles[i].x,angles[i].y,angles[i].z);
+	refNs = BenchNow()-t0;
+	
+	t0 = BenchNow();
+	for (r=0; r<rounds; r++)
+		CC3Quaternion_SetRotateXYZArray(count,angles,newResult);
+	newNs = BenchNow()-t0;
+	BenchReport("set rotate xyz",refNs,newNs,ops,BenchCompare(count,refResult,newResult));
+	
+	//angle threshold, per threshold the old and the new test must agree
+	for (r=0; r<4; r++)
+	{
+		float	thresholdCos = CC3Quaternion_AngleThresholdCos(thresholds[r]);
+		TQ3Uns32 k;
+		
+		refHits = newHits = mismatches = 0;
+		
+		t0 = BenchNow();
+		for (k=0; k<rounds; k++)
+			for (i=0; i<count; i++)
+			{
+				float angle;
+				RefGetAngle(&q1[i],&angle);
+				refHits += (fabsf(angle)>=thresholds[r]);
+			}
+		refNs = BenchNow()-t0;
+		
+		t0 = BenchNow();
+		for (k=0; k<rounds; k++)
+			for (i=0; i<count; i++)
+				newHits += (CC3Quaternion_ReachesAngle(&q1[i],thresholdCos)==kQ3True);
+		newNs = BenchNow()-t0;
+		
+		for (i=0; i<count; i++)
+		{
+			float angle;
+			RefGetAngle(&q1[i],&angle);
+			if ((fabsf(angle)>=thresholds[r]) != (CC3Quaternion_ReachesAngle(&q1[i],thresholdCos)==kQ3True))
+				mismatches++;
+		}
+		
+		printf("angle >= %-7g scalar %8.2f ns/op   kernel %8.2f ns/op   speedup %5.2fx   %u/%u hits%s\n",
+				thresholds[r], refNs/ops, newNs/ops, refNs/newNs,
+				(unsigned) (newHits/rounds), (unsigned) count,
+				(mismatches!=0) ? "   MISMATCH" : "");
+		sink += (float) refHits;
+	}
+	
+	free(q1);
+	free(q2);
+	free(refResult);
+	free(newResult);
+	free(angles);
+	
+	return(sink<0.0f);
+}
@@ -0,0 +1,292 @@
+/*  NAME:
+        C3QuaternionMath.c
+
+    DESCRIPTION:
+        Used by ControllerCoreOSX and SpaceMouseController.
+		
+		Batch quaternion kernels, see C3QuaternionMath.h.
+      
+    COPYRIGHT:
+        Copyright (c) 1999-2005, Quesa Developers. All rights reserved.
+
+        For the current release of Quesa, please see:
+
+            <http://www.quesa.org/>
+        
+        Redistribution and use in source and binary forms, with or without
+        modification, are permitted provided that the following conditions
+        are met:
+        
+            o Redistributions of source code must retain the above copyright
+              notice, this list of conditions and the following disclaimer.
+        
+            o Redistributions in binary form must reproduce the above
+              copyright notice, this list of conditions and the following
+              disclaimer in the documentation and/or other materials provided
+              with the distribution.
+        
+            o Neither the name of Quesa nor the names of its contributors
+              may be used to endorse or promote products derived from this
+              software without specific prior written permission.
+        
+        THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+        "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+        LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+        A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+        OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+        SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+        TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+        PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+        LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+        NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+        SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+    ___________________________________________________________________________
+*/
+
+//=============================================================================
+//      Include files
+//-----------------------------------------------------------------------------
+#include <math.h>
+
+#include "C3QuaternionMath.h"
+
+#if defined(__SSE__) || defined(_M_X64)
+	#include <xmmintrin.h>
+	#define C3_QUATERNION_SSE		1
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+	#include <arm_neon.h>
+	#define C3_QUATERNION_NEON		1
+#endif
+
+
+
+
+
+//=============================================================================
+//      Internal constants
+//-----------------------------------------------------------------------------
+//|w|/|q| above this is a null rotation, as in CC3Quaternion_GetAngle
+#define kC3QuaternionNullCos		(1.0f - kQ3RealZero)
+
+
+
+
+
+//=============================================================================
+//      Public functions
+//-----------------------------------------------------------------------------
+//      CC3Quaternion_MultiplyArray : Multiply count quaternion pairs.
+//-----------------------------------------------------------------------------
+//		Note : Same order as CC3Quaternion_Multiply, i.e. q2[i]*q1[i].
+//				Lanes are w,x,y,z as in TQ3Quaternion:
+//
+//				r = q2.w*(b.w, b.x, b.y, b.z) + q2.x*(-b.x, b.w,-b.z, b.y)
+//				  + q2.y*(-b.y, b.z, b.w,-b.x) + q2.z*(-b.z,-b.y, b.x, b.w)
+//
+//				with b = q1[i].
+//-----------------------------------------------------------------------------
+void
+CC3Quaternion_MultiplyArray(TQ3Uns32 count, const TQ3Quaternion *q1, const TQ3Quaternion *q2, TQ3Quaternion *result)
+{
+	TQ3Uns32 i;
+	
+#if C3_QUATERNION_SSE
+	const __m128 sign1 = _mm_setr_ps(-0.0f, 0.0f,-0.0f, 0.0f);
+	const __m128 sign2 = _mm_setr_ps(-0.0f, 0.0f, 0.0f,-0.0f);
+	const __m128 sign3 = _mm_setr_ps(-0.0f,-0.0f, 0.0f, 0.0f);
+	
+	for (i=0; i<count; i++)
+	{
+		__m128 b = _mm_loadu_ps(&q1[i].w);
+		__m128 a = _mm_loadu_ps(&q2[i].w);
+		
+		__m128 t0 = b;
+		__m128 t1 = _mm_xor_ps(_mm_shuffle_ps(b,b,_MM_SHUFFLE(2,3,0,1)),sign1);
+		__m128 t2 = _mm_xor_ps(_mm_shuffle_ps(b,b,_MM_SHUFFLE(1,0,3,2)),sign2);
+		__m128 t3 = _mm_xor_ps(_mm_shuffle_ps(b,b,_MM_SHUFFLE(0,1,2,3)),sign3);
+		
+		__m128 r = _mm_mul_ps(_mm_shuffle_ps(a,a,_MM_SHUFFLE(0,0,0,0)),t0);
+		r = _mm_add_ps(r,_mm_mul_ps(_mm_shuffle_ps(a,a,_MM_SHUFFLE(1,1,1,1)),t1));
+		r = _mm_add_ps(r,_mm_mul_ps(_mm_shuffle_ps(a,a,_MM_SHUFFLE(2,2,2,2)),t2));
+		r = _mm_add_ps(r,_mm_mul_ps(_mm_shuffle_ps(a,a,_MM_SHUFFLE(3,3,3,3)),t3));
+		
+		_mm_storeu_ps(&result[i].w,r);
+	}
+#elif C3_QUATERNION_NEON
+	static const float sign1[4] = {-1.0f, 1.0f,-1.0f, 1.0f};
+	static const float sign2[4] = {-1.0f, 1.0f, 1.0f,-1.0f};
+	static const float sign3[4] = {-1.0f,-1.0f, 1.0f, 1.0f};
+	const float32x4_t s1 = vld1q_f32(sign1);
+	const float32x4_t s2 = vld1q_f32(sign2);
+	const float32x4_t s3 = vld1q_f32(sign3);
+	
+	for (i=0; i<count; i++)
+	{
+		float32x4_t b = vld1q_f32(&q1[i].w);
+		float32x4_t a = vld1q_f32(&q2[i].w);
+		
+		float32x4_t t1 = vmulq_f32(vrev64q_f32(b),s1);
+		float32x4_t t2 = vmulq_f32(vextq_f32(b,b,2),s2);
+		float32x4_t t3 = vmulq_f32(vrev64q_f32(vextq_f32(b,b,2)),s3);
+		
+		float32x4_t r = vmulq_n_f32(b,vgetq_lane_f32(a,0));
+		r = vmlaq_n_f32(r,t1,vgetq_lane_f32(a,1));
+		r = vmlaq_n_f32(r,t2,vgetq_lane_f32(a,2));
+		r = vmlaq_n_f32(r,t3,vgetq_lane_f32(a,3));
+		
+		vst1q_f32(&result[i].w,r);
+	}
+#else
+	for (i=0; i<count; i++)
+	{
+		float bw = q1[i].w, bx = q1[i].x, by = q1[i].y, bz = q1[i].z;
+		float aw = q2[i].w, ax = q2[i].x, ay = q2[i].y, az = q2[i].z;
+		
+		result[i].w = aw*bw - ax*bx - ay*by - az*bz;
+		result[i].x = aw*bx + ax*bw + ay*bz - az*by;
+		result[i].y = aw*by - ax*bz + ay*bw + az*bx;
+		result[i].z = aw*bz + ax*by - ay*bx + az*bw;
+	}
+#endif
+}
+
+
+
+//=============================================================================
+//      CC3Quaternion_Coalesce : Fold a further delta into a pending one.
+//-----------------------------------------------------------------------------
+//		Note : CC3OSXTracker_MoveOrientation turns orientation O into O*d,
+//				so d1 then d2 gives O*d1*d2 and the pending delta has to
+//				become pending*delta, not delta*pending. Sending the result
+//				once then ends on the same orientation as sending each delta.
+//-----------------------------------------------------------------------------
+void
+CC3Quaternion_Coalesce(TQ3Quaternion *pending, const TQ3Quaternion *delta)
+{
+	CC3Quaternion_MultiplyArray(1,delta,pending,pending);
+}
+
+
+
+//=============================================================================
+//      CC3Quaternion_NormalizeArray : Normalize count quaternions.
+//-----------------------------------------------------------------------------
+void
+CC3Quaternion_NormalizeArray(TQ3Uns32 count, const TQ3Quaternion *q, TQ3Quaternion *result)
+{
+	TQ3Uns32 i;
+	
+#if C3_QUATERNION_SSE
+	for (i=0; i<count; i++)
+	{
+		__m128 v = _mm_loadu_ps(&q[i].w);
+		__m128 s = _mm_mul_ps(v,v);
+		
+		//horizontal sum, broadcast to all lanes
+		s = _mm_add_ps(s,_mm_shuffle_ps(s,s,_MM_SHUFFLE(2,3,0,1)));
+		s = _mm_add_ps(s,_mm_shuffle_ps(s,s,_MM_SHUFFLE(1,0,3,2)));
+		
+		_mm_storeu_ps(&result[i].w,_mm_div_ps(v,_mm_sqrt_ps(s)));
+	}
+#elif C3_QUATERNION_NEON
+	for (i=0; i<count; i++)
+	{
+		float32x4_t v = vld1q_f32(&q[i].w);
+		float32x4_t s = vmulq_f32(v,v);
+		float32x2_t h = vadd_f32(vget_low_f32(s),vget_high_f32(s));
+		float invLen = 1.0f / sqrtf(vget_lane_f32(vpadd_f32(h,h),0));
+		
+		vst1q_f32(&result[i].w,vmulq_n_f32(v,invLen));
+	}
+#else
+	for (i=0; i<count; i++)
+	{
+		float invLen = 1.0f / (float) sqrt(q[i].w*q[i].w + q[i].x*q[i].x + q[i].y*q[i].y + q[i].z*q[i].z);
+		
+		result[i].w = q[i].w*invLen;
+		result[i].x = q[i].x*invLen;
+		result[i].y = q[i].y*invLen;
+		result[i].z = q[i].z*invLen;
+	}
+#endif
+}
+
+
+
+//=============================================================================
+//      CC3Quaternion_SetRotateXYZArray : Quaternions from Euler angles.
+//-----------------------------------------------------------------------------
+//		Note : The sines and cosines dominate; the loop is kept free of
+//				branches and aliasing so the compiler can vectorize the rest.
+//-----------------------------------------------------------------------------
+void
+CC3Quaternion_SetRotateXYZArray(TQ3Uns32 count, const TQ3Vector3D *angles, TQ3Quaternion *result)
+{
+	TQ3Uns32 i;
+	
+	for (i=0; i<count; i++)
+	{
+		float cosX = (float) cos(0.5f*angles[i].x), sinX = (float) sin(0.5f*angles[i].x);
+		float cosY = (float) cos(0.5f*angles[i].y), sinY = (float) sin(0.5f*angles[i].y);
+		float cosZ = (float) cos(0.5f*angles[i].z), sinZ = (float) sin(0.5f*angles[i].z);
+		
+		float cosZcosY = cosZ*cosY;
+		float sinZsinY = sinZ*sinY;
+		
+		result[i].w = cosZcosY*cosX + sinZsinY*sinX;
+		result[i].x = cosZcosY*sinX - sinZsinY*cosX;
+		result[i].y = cosZ*sinY*cosX + sinZ*cosY*sinX;
+		result[i].z = sinZ*cosY*cosX - cosZ*sinY*sinX;
+	}
+}
+
+
+
+//=============================================================================
+//      CC3Quaternion_AngleThresholdCos : Precompute a threshold.
+//-----------------------------------------------------------------------------
+//		Note : Call once when the threshold changes, not per test.
+//-----------------------------------------------------------------------------
+float
+CC3Quaternion_AngleThresholdCos(float threshold)
+{
+	if (threshold<=0.0f)
+		return(1.0f);
+		
+	if (threshold>=2.0f*kQ3Pi)
+		return(-1.0f);
+		
+	return((float) cos(0.5f*threshold));
+}
+
+
+
+//=============================================================================
+//      CC3Quaternion_ReachesAngle : Compare the rotation angle of q with a
+//				threshold.
+//-----------------------------------------------------------------------------
+//		Note : Same answer as (CC3Quaternion_GetAngle(q) >= threshold):
+//				angle >= threshold  <=>  w/|q| <= cos(threshold/2), compared
+//				squared so neither sqrt nor acos is needed. q need not be
+//				normalized.
+//-----------------------------------------------------------------------------
+TQ3Boolean
+CC3Quaternion_ReachesAngle(const TQ3Quaternion *q, float thresholdCos)
+{
+	float wSquared		= q->w*q->w;
+	float lenSquared	= wSquared + q->x*q->x + q->y*q->y + q->z*q->z;
+	float limit			= thresholdCos*thresholdCos*lenSquared;
+	
+	//a zero threshold lets everything pass
+	if (thresholdCos>=1.0f)
+		return(kQ3True);
+	
+	//null rotation, angle 0
+	if (wSquared > kC3QuaternionNullCos*kC3QuaternionNullCos*lenSquared)
+		return(kQ3False);
+	
+	if (thresholdCos>=0.0f)
+		return(((q->w<=0.0f) || (wSquared<=limit)) ? kQ3True : kQ3False);
+	
+	return(((q->w<0.0f) && (wSquared>=limit)) ? kQ3True : kQ3False);
+}
@@ -0,0 +1,113 @@
+/*  NAME:
+        C3QuaternionMath.h
+
+    DESCRIPTION:
+        Used by ControllerCoreOSX and SpaceMouseController.
+		
+		Batch quaternion kernels for the tracker path: multiply, normalize,
+		Euler angles to quaternion and a trig-free rotation angle test.
+		SSE or NEON where available, plain C otherwise; all variants give
+		the same results up to rounding.
+      
+    COPYRIGHT:
+        Copyright (c) 1999-2005, Quesa Developers. All rights reserved.
+
+        For the current release of Quesa, please see:
+
+            <http://www.quesa.org/>
+        
+        Redistribution and use in source and binary forms, with or without
+        modification, are permitted provided that the following conditions
+        are met:
+        
+            o Redistributions of source code must retain the above copyright
+              notice, this list of conditions and the following disclaimer.
+        
+            o Redistributions in binary form must reproduce the above
+              copyright notice, this list of conditions and the following
+              disclaimer in the documentation and/or other materials provided
+              with the distribution.
+        
+            o Neither the name of Quesa nor the names of its contributors
+              may be used to endorse or promote products derived from this
+              software without specific prior written permission.
+        
+        THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+        "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+        LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+        A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+        OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+        SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+        TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+        PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+        LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+        NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+        SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+    ___________________________________________________________________________
+*/
+
+
+
+
+#ifndef C3QuaternionMath_HDR
+#define C3QuaternionMath_HDR
+
+#if defined(__APPLE__)
+	#include <Carbon/Carbon.h>
+	
+	//outside of the Quesa build (E3Prefix.h) the types come from the framework
+	#ifndef QUESA_HDR
+		#ifndef QUESA_OS_MACINTOSH
+			#define QUESA_OS_MACINTOSH		1
+		#endif
+		#include <Quesa/Quesa.h>
+	#endif
+#elif !defined(QUESA_HDR)
+	//standalone builds, e.g. Tools/QuaternionBench, get the few Quesa types used here
+	#include <stdint.h>
+	
+	typedef uint32_t						TQ3Uns32;
+	typedef enum { kQ3False = 0, kQ3True = 1 }	TQ3Boolean;
+	typedef struct { float x, y, z; }		TQ3Vector3D;
+	typedef struct { float w, x, y, z; }	TQ3Quaternion;
+	
+	#define kQ3Pi							3.1415926535898f
+	#define kQ3RealZero						(1.19209290e-07f)
+#endif
+
+//=============================================================================
+//		C++ preamble
+//-----------------------------------------------------------------------------
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//=============================================================================
+//      Function prototypes
+//-----------------------------------------------------------------------------
+//result[i] = q1[i] followed by q2[i], as CC3Quaternion_Multiply; result may alias q1 or q2
+void		CC3Quaternion_MultiplyArray(TQ3Uns32 count, const TQ3Quaternion *q1, const TQ3Quaternion *q2, TQ3Quaternion *result);
+
+//pending = pending*delta, i.e. one MoveOrientation by pending moves as far as by pending, then by delta
+void		CC3Quaternion_Coalesce(TQ3Quaternion *pending, const TQ3Quaternion *delta);
+
+//q[i] must not be zero; result may alias q
+void		CC3Quaternion_NormalizeArray(TQ3Uns32 count, const TQ3Quaternion *q, TQ3Quaternion *result);
+
+//rotation about x, then y, then z by angles[i] (radians), as Q3Quaternion_SetRotate_XYZ
+void		CC3Quaternion_SetRotateXYZArray(TQ3Uns32 count, const TQ3Vector3D *angles, TQ3Quaternion *result);
+
+//cos(threshold/2) for CC3Quaternion_ReachesAngle; threshold is clamped to [0, 2 pi]
+float		CC3Quaternion_AngleThresholdCos(float threshold);
+
+//kQ3True, if the rotation angle of q is at least the threshold; no trig, no sqrt
+TQ3Boolean	CC3Quaternion_ReachesAngle(const TQ3Quaternion *q, float thresholdCos);
+
+//=============================================================================
+//		C++ postamble
+//-----------------------------------------------------------------------------
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,528 @@
+/*  NAME:
+        IPCAsync.c
+
+    DESCRIPTION:
+        Used by QuesaOSXDeviceServer and ControllerCoreOSX.
+		
+		Non-blocking request/reply transport on top of CFMessagePort.
+		
+		The requesting side owns one local reply port per process. Outstanding
+		requests live in a slot table indexed by the low half of the request tag;
+		the high half is a generation count, so a late reply to a recycled slot
+		is dropped instead of completing the wrong request.
+		
+		Remote ports are cached by name. When a cached port becomes invalid all
+		requests still pending on it are completed with kQ3Failure.
+      
+    COPYRIGHT:
+        Copyright (c) 1999-2005, Quesa Developers. All rights reserved.
+
+        For the current release of Quesa, please see:
+
+            <http://www.quesa.org/>
+        
+        Redistribution and use in source and binary forms, with or without
+        modification, are permitted provided that the following conditions
+        are met:
+        
+            o Redistributions of source code must retain the above copyright
+              notice, this list of conditions and the following disclaimer.
+        
+            o Redistributions in binary form must reproduce the above
+              copyright notice, this list of conditions and the following
+              disclaimer in the documentation and/or other materials provided
+              with the distribution.
+        
+            o Neither the name of Quesa nor the names of its contributors
+              may be used to endorse or promote products derived from this
+              software without specific prior written permission.
+        
+        THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+        "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+        LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+        A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+        OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+        SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+        TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+        PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+        LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+        NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+        SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+    ___________________________________________________________________________
+*/
+
+
+#include "IPCAsync.h"
+#include "IPCMessageIDs.h"
+#include "IPCPackUnpack.h"
+
+
+
+
+
+//=============================================================================
+//      Internal constants
+//-----------------------------------------------------------------------------
+#define kIPCAsyncNoSlot				0xFFFFFFFF
+#define kIPCAsyncMaxSlots			0x00010000
+#define kIPCAsyncInitialSlots		64
+#define kIPCAsyncSendTimeout		10
+#define kIPCAsyncReplyTimeout		0.05	//a replier never waits longer for a client that doesn't read
+
+
+
+
+
+//=============================================================================
+//      Internal types
+//-----------------------------------------------------------------------------
+typedef struct TC3IPCAsyncPending
+{
+	TQ3Uns32					tag;			//0: slot is free
+	TQ3Uns32					nextFree;
+	SInt32						msgid;
+	TC3IPCAsyncCompletionProc	completionProc;
+	void						*userData;
+	CFStringRef					remotePortName;
+} TC3IPCAsyncPending;
+
+
+
+
+
+//=============================================================================
+//      Internal variables
+//-----------------------------------------------------------------------------
+/*
+ReplyPort, ReplyPortName and ReplyRunLoopSource:
+-replies to asynchronous requests arrive here
+-created on first call of IPCAsync_SendRequest, scheduled on the run loop of that thread
+*/
+static CFMessagePortRef			ReplyPort = NULL;
+static CFStringRef				ReplyPortName = NULL;
+static CFRunLoopSourceRef		ReplyRunLoopSource = NULL;
+
+/*
+PendingRequests:
+-slot table of outstanding requests; free slots are chained via nextFree
+*/
+static TC3IPCAsyncPending		*PendingRequests = NULL;
+static TQ3Uns32					PendingCapacity = 0;
+static TQ3Uns32					PendingCount = 0;
+static TQ3Uns32					PendingFreeHead = kIPCAsyncNoSlot;
+static TQ3Uns32					PendingGeneration = 0;
+
+/*
+RemotePorts:
+-port name -> remote CFMessagePortRef; saves a bootstrap lookup per message
+*/
+static CFMutableDictionaryRef	RemotePorts = NULL;
+
+
+
+
+
+//=============================================================================
+//      Internal functions
+//-----------------------------------------------------------------------------
+static TQ3Uns32
+IPCAsync_PendingAlloc(CFStringRef remotePortName, SInt32 msgid, TC3IPCAsyncCompletionProc completionProc, void *userData)
+{
+	TQ3Uns32			index;
+	TC3IPCAsyncPending	*slot;
+	
+	if (PendingFreeHead==kIPCAsyncNoSlot)
+	{
+		//grow slot table
+		TQ3Uns32			newCapacity;
+		TC3IPCAsyncPending	*newRequests;
+		
+		if (PendingCapacity>=kIPCAsyncMaxSlots)
+			return(0);
+		
+		newCapacity = (PendingCapacity==0) ? kIPCAsyncInitialSlots : PendingCapacity*2;
+		if (newCapacity>kIPCAsyncMaxSlots)
+			newCapacity = kIPCAsyncMaxSlots;
+			
+		newRequests = (TC3IPCAsyncPending*)realloc(PendingRequests, newCapacity*sizeof(TC3IPCAsyncPending));
+		if (newRequests==NULL)
+			return(0);
+		
+		for (index=newCapacity; index>PendingCapacity; index--)
+		{
+			newRequests[index-1].tag = 0;
+			newRequests[index-1].nextFree = PendingFreeHead;
+			PendingFreeHead = index-1;
+		}
+		PendingRequests = newRequests;
+		PendingCapacity = newCapacity;
+	}
+	
+	index = PendingFreeHead;
+	slot = &PendingRequests[index];
+	PendingFreeHead = slot->nextFree;
+	
+	//generation 0 is reserved, so that a tag is never 0
+	PendingGeneration = (PendingGeneration+1) & 0xFFFF;
+	if (PendingGeneration==0)
+		PendingGeneration = 1;
+	
+	slot->tag = (PendingGeneration<<16) | index;
+	slot->nextFree = kIPCAsyncNoSlot;
+	slot->msgid = msgid;
+	slot->completionProc = completionProc;
+	slot->userData = userData;
+	slot->remotePortName = (CFStringRef)CFRetain(remotePortName);
+	PendingCount++;
+	
+	return(slot->tag);
+}
+
+
+
+static TC3IPCAsyncPending*
+IPCAsync_PendingLookup(TQ3Uns32 tag)
+{
+	TQ3Uns32 index = tag & 0xFFFF;
+	
+	if ((tag!=0) && (index<PendingCapacity) && (PendingRequests[index].tag==tag))
+		return(&PendingRequests[index]);
+		
+	return(NULL);
+}
+
+
+
+static void
+IPCAsync_PendingFree(TC3IPCAsyncPending *slot)
+{
+	if (slot->remotePortName)
+		CFRelease(slot->remotePortName);
+	slot->remotePortName = NULL;
+	slot->tag = 0;
+	slot->nextFree = PendingFreeHead;
+	PendingFreeHead = (TQ3Uns32)(slot-PendingRequests);
+	PendingCount--;
+}
+
+
+
+/*
+IPCAsync_RemotePortInvalidated:
+-the peer went away; drop the cached port and fail everything waiting on it
+*/
+static void
+IPCAsync_RemotePortInvalidated(CFMessagePortRef remotePort, void *info)
+{
+	CFStringRef	portName = CFMessagePortGetName(remotePort);
+	TQ3Uns32	index;
+	
+	if (portName==NULL)
+		return;
+		
+	CFRetain(portName);
+	
+	if (RemotePorts!=NULL)
+		if (CFDictionaryGetValue(RemotePorts, portName)==remotePort)
+			CFDictionaryRemoveValue(RemotePorts, portName);
+	
+	for (index=0; index<PendingCapacity; index++)
+	{
+		TC3IPCAsyncPending *slot = &PendingRequests[index];
+		if ((slot->tag!=0) && (CFEqual(slot->remotePortName, portName)))
+		{
+			SInt32						msgid			= slot->msgid;
+			TC3IPCAsyncCompletionProc	completionProc	= slot->completionProc;
+			void						*userData		= slot->userData;
+			
+			IPCAsync_PendingFree(slot);
+			if (completionProc!=NULL)
+				completionProc(msgid, kQ3Failure, NULL, userData);
+		}
+	}
+	
+	CFRelease(portName);
+}
+
+
+
+static CFMessagePortRef
+IPCAsync_RemotePortGet(CFStringRef portName)
+{
+	CFMessagePortRef remotePort = NULL;
+	
+	if (RemotePorts==NULL)
+		RemotePorts = CFDictionaryCreateMutable(kCFAllocatorDefault, 0,
+												&kCFTypeDictionaryKeyCallBacks,
+												&kCFTypeDictionaryValueCallBacks);
+	if (RemotePorts==NULL)
+		return(NULL);
+	
+	remotePort = (CFMessagePortRef)CFDictionaryGetValue(RemotePorts, portName);
+	if ((remotePort!=NULL) && (!CFMessagePortIsValid(remotePort)))
+	{
+		CFDictionaryRemoveValue(RemotePorts, portName);
+		remotePort = NULL;
+	}
+	
+	if (remotePort==NULL)
+	{
+		remotePort = CFMessagePortCreateRemote(kCFAllocatorDefault, portName);
+		if (remotePort!=NULL)
+		{
+			CFMessagePortSetInvalidationCallBack(remotePort, IPCAsync_RemotePortInvalidated);
+			CFDictionarySetValue(RemotePorts, portName, remotePort);
+			CFRelease(remotePort);//RemotePorts holds it now
+		}
+	}
+	
+	return(remotePort);
+}
+
+
+
+static TQ3Status
+IPCAsync_SendOneWay(CFStringRef portName, SInt32 msgid, CFDictionaryRef dict, CFTimeInterval sendTimeout)
+{
+	TQ3Status			status = kQ3Failure;
+	CFMessagePortRef	remotePort;
+	CFDataRef			data;
+	SInt32				reqRes;
+	
+	data = CFPropertyListCreateXMLData(kCFAllocatorDefault, dict);
+	if (data==NULL)
+		return(status);
+	
+	remotePort = IPCAsync_RemotePortGet(portName);
+	if (remotePort!=NULL)
+	{
+		//replyMode NULL: returns as soon as the message is queued
+		reqRes = CFMessagePortSendRequest(remotePort, msgid, data, sendTimeout, 0, NULL, NULL);
+		if (reqRes==kCFMessagePortIsInvalid)
+		{
+			//stale cache entry, try once more with a fresh port
+			remotePort = IPCAsync_RemotePortGet(portName);
+			if (remotePort!=NULL)
+				reqRes = CFMessagePortSendRequest(remotePort, msgid, data, sendTimeout, 0, NULL, NULL);
+		}
+		if (reqRes==kCFMessagePortSuccess)
+			status = kQ3Success;
+	}
+	
+	CFRelease(data);
+	
+	return(status);
+}
+
+
+
+/*
+IPCAsync_ReplyDispatcher will be called by CFMessagePort on incoming replies
+*/
+static CFDataRef
+IPCAsync_ReplyDispatcher(CFMessagePortRef local, SInt32 msgid, CFDataRef data, void *info)
+{
+	CFDictionaryRef		returnDict;
+	CFStringRef			propertyListError = NULL;
+	TQ3Uns32			tag = 0;
+	TQ3Status			status = kQ3Failure;
+	TC3IPCAsyncPending	*slot;
+	
+	returnDict = (CFDictionaryRef)CFPropertyListCreateFromXMLData(	kCFAllocatorDefault, 
+																	data, 
+																	kCFPropertyListImmutable, 
+																	&propertyListError);
+	if (propertyListError)
+		CFRelease(propertyListError);
+		
+	if (returnDict==NULL)
+		return(NULL);
+	
+	if (CFDictionaryGetValue(returnDict, CFSTR(k3RequestTag))!=NULL)
+		IPCGetTQ3Uns32(returnDict, CFSTR(k3RequestTag), &tag);
+		
+	slot = IPCAsync_PendingLookup(tag);
+	if (slot!=NULL)
+	{
+		TC3IPCAsyncCompletionProc	completionProc	= slot->completionProc;
+		void						*userData		= slot->userData;
+		
+		IPCAsync_PendingFree(slot);
+		
+		if (CFDictionaryGetValue(returnDict, CFSTR(k3Status))!=NULL)
+			IPCGetTQ3Uns32(returnDict, CFSTR(k3Status), (TQ3Uns32*)&status);
+			
+		if (completionProc!=NULL)
+			completionProc(msgid, status, returnDict, userData);
+	}
+	//else: late reply to a recycled or failed slot
+	
+	CFRelease(returnDict);
+	
+	return(NULL);
+}
+
+
+
+static TQ3Status
+IPCAsync_ReplyPortCreate(void)
+{
+	CFMutableStringRef	portName;
+	CFUUIDRef			portUUID;
+	CFStringRef			portUUIDString;
+	CFMessagePortContext context;
+	
+	if (ReplyPort!=NULL)
+		return(kQ3Success);
+	
+	portName = CFStringCreateMutable(kCFAllocatorDefault, 0);
+	CFStringAppend(portName, CFSTR(kQuesa3DeviceReply));
+	CFStringAppend(portName, CFSTR("."));
+	portUUID = CFUUIDCreate(kCFAllocatorDefault);
+	portUUIDString = CFUUIDCreateString(kCFAllocatorDefault, portUUID);
+	CFStringAppend(portName, portUUIDString);
+	
+	context.version = 0;
+	context.info = NULL;
+	context.retain = NULL;
+	context.release = NULL;
+	context.copyDescription = NULL;
+	
+	ReplyPort = CFMessagePortCreateLocal(kCFAllocatorDefault, portName, IPCAsync_ReplyDispatcher, &context, NULL);
+	if (ReplyPort!=NULL)
+	{
+		ReplyRunLoopSource = CFMessagePortCreateRunLoopSource(kCFAllocatorDefault, ReplyPort, 0);
+		CFRunLoopAddSource(CFRunLoopGetCurrent(), ReplyRunLoopSource, kCFRunLoopDefaultMode);
+		ReplyPortName = portName;
+	}
+	else
+		CFRelease(portName);
+	
+	CFRelease(portUUID);
+	CFRelease(portUUIDString);
+	
+	return((ReplyPort!=NULL) ? kQ3Success : kQ3Failure);
+}
+
+
+
+
+
+//=============================================================================
+//      Public functions
+//-----------------------------------------------------------------------------
+//      IPCAsync_SendRequest : Send a request without waiting for its reply.
+//-----------------------------------------------------------------------------
+//		Note : completionProc is called exactly once if kQ3Success is returned,
+//				never if kQ3Failure is returned. It runs on the run loop of the
+//				thread that made the first asynchronous request. A peer that
+//				goes away while sending completes the request with kQ3Failure
+//				before this returns; that counts as kQ3Success here.
+//-----------------------------------------------------------------------------
+TQ3Status
+IPCAsync_SendRequest(CFStringRef remotePortName, SInt32 msgid, CFMutableDictionaryRef dict, TC3IPCAsyncCompletionProc completionProc, void *userData)
+{
+	TQ3Status	status = kQ3Failure;
+	TQ3Uns32	tag;
+	
+	if (IPCAsync_ReplyPortCreate()==kQ3Success)
+	{
+		tag = IPCAsync_PendingAlloc(remotePortName, msgid, completionProc, userData);
+		if (tag!=0)
+		{
+			CFDictionarySetValue(dict, CFSTR(k3ReplyPortName), ReplyPortName);
+			IPCPutTQ3Uns32(dict, CFSTR(k3RequestTag), &tag);
+			
+			status = IPCAsync_SendOneWay(remotePortName, msgid, dict, kIPCAsyncSendTimeout);
+			if (status==kQ3Failure)
+			{
+				//the invalidation callback may have completed it already,
+				//then the caller must not clean up a second time
+				TC3IPCAsyncPending *slot = IPCAsync_PendingLookup(tag);
+				if (slot!=NULL)
+					IPCAsync_PendingFree(slot);
+				else
+					status = kQ3Success;
+			}
+		}
+	}
+	
+	return(status);
+}
+
+
+
+//=============================================================================
+//      IPCAsync_PendingCount : Number of requests still waiting for a reply.
+//-----------------------------------------------------------------------------
+TQ3Uns32
+IPCAsync_PendingCount(void)
+{
+	return(PendingCount);
+}
+
+
+
+//=============================================================================
+//      IPCAsync_IsAsyncRequest : Does the request expect a one-way reply?
+//-----------------------------------------------------------------------------
+Boolean
+IPCAsync_IsAsyncRequest(CFDictionaryRef dict)
+{
+	if (dict==NULL)
+		return(false);
+		
+	return((CFDictionaryGetValue(dict, CFSTR(k3ReplyPortName))!=NULL)
+		&& (CFDictionaryGetValue(dict, CFSTR(k3RequestTag))!=NULL));
+}
+
+
+
+//=============================================================================
+//      IPCAsync_SendReply : Answer an asynchronous request.
+//-----------------------------------------------------------------------------
+TQ3Status
+IPCAsync_SendReply(CFDictionaryRef requestDict, SInt32 msgid, CFMutableDictionaryRef returnDict)
+{
+	TQ3Uns32	tag;
+	CFStringRef	replyPortName;
+	
+	if (!IPCAsync_IsAsyncRequest(requestDict))
+		return(kQ3Failure);
+		
+	replyPortName = (CFStringRef)CFDictionaryGetValue(requestDict, CFSTR(k3ReplyPortName));
+	IPCGetTQ3Uns32(requestDict, CFSTR(k3RequestTag), &tag);
+	
+	return(IPCAsync_SendReplyTo(replyPortName, tag, msgid, returnDict));
+}
+
+
+
+//=============================================================================
+//      IPCAsync_SendReplyTo : Answer a request that was parked earlier.
+//-----------------------------------------------------------------------------
+//		Note : returnDict must already hold k3Status. A reply the client's
+//				port doesn't take within kIPCAsyncReplyTimeout is dropped, so
+//				a hung client can't block the replier's run loop.
+//-----------------------------------------------------------------------------
+TQ3Status
+IPCAsync_SendReplyTo(CFStringRef replyPortName, TQ3Uns32 requestTag, SInt32 msgid, CFMutableDictionaryRef returnDict)
+{
+	IPCPutTQ3Uns32(returnDict, CFSTR(k3RequestTag), &requestTag);
+	
+	return(IPCAsync_SendOneWay(replyPortName, msgid, returnDict, kIPCAsyncReplyTimeout));
+}
+
+
+
+//=============================================================================
+//      IPCAsync_ReplyPortIsValid : Is the client behind a parked request alive?
+//-----------------------------------------------------------------------------
+//		Note : A cached port that went invalid is looked up again, so this is
+//				only false once the client's reply port is gone.
+//-----------------------------------------------------------------------------
+Boolean
+IPCAsync_ReplyPortIsValid(CFStringRef replyPortName)
+{
+	return(IPCAsync_RemotePortGet(replyPortName)!=NULL);
+}
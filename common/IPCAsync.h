@@ -0,0 +1,100 @@
+/*  NAME:
+        IPCAsync.h
+
+    DESCRIPTION:
+        Used by QuesaOSXDeviceServer and ControllerCoreOSX.
+		
+		Non-blocking request/reply transport on top of CFMessagePort.
+		
+		A request carrying a reply port name and a request tag is answered
+		by a one-way message to the reply port instead of a synchronous
+		CFMessagePort reply. Completions run on the run loop of the thread
+		that sent the first asynchronous request; no thread is blocked while
+		a request is outstanding.
+      
+    COPYRIGHT:
+        Copyright (c) 1999-2005, Quesa Developers. All rights reserved.
+
+        For the current release of Quesa, please see:
+
+            <http://www.quesa.org/>
+        
+        Redistribution and use in source and binary forms, with or without
+        modification, are permitted provided that the following conditions
+        are met:
+        
+            o Redistributions of source code must retain the above copyright
+              notice, this list of conditions and the following disclaimer.
+        
+            o Redistributions in binary form must reproduce the above
+              copyright notice, this list of conditions and the following
+              disclaimer in the documentation and/or other materials provided
+              with the distribution.
+        
+            o Neither the name of Quesa nor the names of its contributors
+              may be used to endorse or promote products derived from this
+              software without specific prior written permission.
+        
+        THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+        "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+        LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+        A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+        OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+        SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+        TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+        PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+        LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+        NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+        SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+    ___________________________________________________________________________
+*/
+
+
+
+#ifndef IPCAsync_HDR
+#define IPCAsync_HDR
+
+#include <Carbon/Carbon.h>
+
+//=============================================================================
+//		C++ preamble
+//-----------------------------------------------------------------------------
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//=============================================================================
+//      Types
+//-----------------------------------------------------------------------------
+/*
+TC3IPCAsyncCompletionProc:
+-called once per asynchronous request, on the run loop owning the reply port
+-returnDict is NULL if the request failed before a reply arrived
+-returnDict is only valid for the duration of the call
+-IPCAsync_SendRequest owns the rule: kQ3Success means completionProc has run or
+ will run exactly once (it may already have run, with kQ3Failure, if the peer went
+ away while sending); kQ3Failure means it never runs and the caller cleans up
+*/
+typedef void (*TC3IPCAsyncCompletionProc)(SInt32 msgid, TQ3Status status, CFDictionaryRef returnDict, void *userData);
+
+//=============================================================================
+//      Function prototypes
+//-----------------------------------------------------------------------------
+//requesting side
+TQ3Status	IPCAsync_SendRequest(CFStringRef remotePortName, SInt32 msgid, CFMutableDictionaryRef dict, TC3IPCAsyncCompletionProc completionProc, void *userData);
+TQ3Uns32	IPCAsync_PendingCount(void);
+
+//replying side
+Boolean		IPCAsync_IsAsyncRequest(CFDictionaryRef dict);
+TQ3Status	IPCAsync_SendReply(CFDictionaryRef requestDict, SInt32 msgid, CFMutableDictionaryRef returnDict);
+TQ3Status	IPCAsync_SendReplyTo(CFStringRef replyPortName, TQ3Uns32 requestTag, SInt32 msgid, CFMutableDictionaryRef returnDict);
+Boolean		IPCAsync_ReplyPortIsValid(CFStringRef replyPortName);
+
+//=============================================================================
+//		C++ postamble
+//-----------------------------------------------------------------------------
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,237 @@
+/*  NAME:
+        IPCHandles.c
+
+    DESCRIPTION:
+        Used by QuesaOSXDeviceServer and ControllerCoreOSX.
+		
+		Generational integer handles for objects referenced across IPC.
+		
+		Lookup is an index plus a compare; no string is formatted or hashed.
+      
+    COPYRIGHT:
+        Copyright (c) 1999-2005, Quesa Developers. All rights reserved.
+
+        For the current release of Quesa, please see:
+
+            <http://www.quesa.org/>
+        
+        Redistribution and use in source and binary forms, with or without
+        modification, are permitted provided that the following conditions
+        are met:
+        
+            o Redistributions of source code must retain the above copyright
+              notice, this list of conditions and the following disclaimer.
+        
+            o Redistributions in binary form must reproduce the above
+              copyright notice, this list of conditions and the following
+              disclaimer in the documentation and/or other materials provided
+              with the distribution.
+        
+            o Neither the name of Quesa nor the names of its contributors
+              may be used to endorse or promote products derived from this
+              software without specific prior written permission.
+        
+        THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+        "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+        LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+        A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+        OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+        SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+        TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+        PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+        LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+        NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+        SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+    ___________________________________________________________________________
+*/
+
+
+#include "IPCHandles.h"
+
+
+
+
+
+//=============================================================================
+//      Internal constants
+//-----------------------------------------------------------------------------
+#define kIPCHandleNoSlot			0xFFFFFFFF
+#define kIPCHandleMaxSlots			0x00010000
+#define kIPCHandleInitialSlots		16
+
+
+
+
+
+//=============================================================================
+//      Internal functions
+//-----------------------------------------------------------------------------
+//      IPCHandle_Grow : Double the slots of table, queue the new ones as free.
+//-----------------------------------------------------------------------------
+static TQ3Status
+IPCHandle_Grow(TC3HandleTable *table)
+{
+	TQ3Uns32		index,newCapacity;
+	TC3HandleSlot	*newSlots;
+	
+	if (table->capacity>=kIPCHandleMaxSlots)
+		return(kQ3Failure);
+		
+	newCapacity = (table->capacity==0) ? kIPCHandleInitialSlots : table->capacity*2;
+	if (newCapacity>kIPCHandleMaxSlots)
+		newCapacity = kIPCHandleMaxSlots;
+	
+	newSlots = (TC3HandleSlot*)realloc(table->slots, newCapacity*sizeof(TC3HandleSlot));
+	if (newSlots==NULL)
+		return(kQ3Failure);
+		
+	for (index=newCapacity; index>table->capacity; index--)
+	{
+		newSlots[index-1].object = NULL;
+		newSlots[index-1].generation = 0;
+		newSlots[index-1].nextFree = table->freeHead;
+		table->freeHead = index-1;
+	}
+	table->slots = newSlots;
+	table->capacity = newCapacity;
+	return(kQ3Success);
+}
+
+
+
+
+
+//=============================================================================
+//      Public functions
+//-----------------------------------------------------------------------------
+//      IPCHandle_Insert : Register object, return its handle.
+//-----------------------------------------------------------------------------
+//		Note : Returns kIPCHandleNone if the table is full or out of memory.
+//-----------------------------------------------------------------------------
+TQ3Uns32
+IPCHandle_Insert(TC3HandleTable *table, void *object)
+{
+	TQ3Uns32		index;
+	TC3HandleSlot	*slot;
+	
+	if (object==NULL)
+		return(kIPCHandleNone);
+	
+	if ((table->freeHead==kIPCHandleNoSlot) && (IPCHandle_Grow(table)==kQ3Failure))
+		return(kIPCHandleNone);
+	
+	index = table->freeHead;
+	slot = &table->slots[index];
+	table->freeHead = slot->nextFree;
+	
+	//generation 0 is skipped, so that no handle is kIPCHandleNone
+	slot->generation = (slot->generation+1) & 0xFFFF;
+	if (slot->generation==0)
+		slot->generation = 1;
+	slot->object = object;
+	slot->nextFree = kIPCHandleNoSlot;
+	table->count++;
+	
+	return((slot->generation<<16) | index);
+}
+
+
+
+//=============================================================================
+//      IPCHandle_Lookup : Resolve a handle; NULL if stale or unknown.
+//-----------------------------------------------------------------------------
+void *
+IPCHandle_Lookup(const TC3HandleTable *table, TQ3Uns32 handle)
+{
+	TQ3Uns32 index = handle & 0xFFFF;
+	
+	if ((index<table->capacity) && (table->slots[index].generation==(handle>>16)))
+		return(table->slots[index].object);
+		
+	return(NULL);
+}
+
+
+
+//=============================================================================
+//      IPCHandle_Remove : Unregister a handle, return its object.
+//-----------------------------------------------------------------------------
+void *
+IPCHandle_Remove(TC3HandleTable *table, TQ3Uns32 handle)
+{
+	void		*object = IPCHandle_Lookup(table, handle);
+	TQ3Uns32	index = handle & 0xFFFF;
+	
+	if (object!=NULL)
+	{
+		table->slots[index].object = NULL;
+		table->slots[index].nextFree = table->freeHead;
+		table->freeHead = index;
+		table->count--;
+	}
+	
+	return(object);
+}
+
+
+
+//=============================================================================
+//      IPCHandle_InsertAt : Register object under a handle issued before.
+//-----------------------------------------------------------------------------
+//		Note : For tables rebuilt from a saved copy, so that handles held by
+//				clients stay valid. Fails if the slot is taken.
+//-----------------------------------------------------------------------------
+TQ3Status
+IPCHandle_InsertAt(TC3HandleTable *table, TQ3Uns32 handle, void *object)
+{
+	TQ3Uns32	index = handle & 0xFFFF;
+	TQ3Uns32	*link;
+	
+	if ((object==NULL) || (handle==kIPCHandleNone) || ((handle>>16)==0))
+		return(kQ3Failure);
+	
+	while (index>=table->capacity)
+		if (IPCHandle_Grow(table)==kQ3Failure)
+			return(kQ3Failure);
+	
+	if (table->slots[index].object!=NULL)
+		return(kQ3Failure);
+	
+	//unlink the slot from the free list
+	for (link=&table->freeHead; *link!=kIPCHandleNoSlot; link=&table->slots[*link].nextFree)
+		if (*link==index)
+		{
+			*link = table->slots[index].nextFree;
+			break;
+		}
+	
+	table->slots[index].generation = handle>>16;
+	table->slots[index].object = object;
+	table->slots[index].nextFree = kIPCHandleNoSlot;
+	table->count++;
+	return(kQ3Success);
+}
+
+
+
+//=============================================================================
+//      IPCHandle_Next : Iterate the registered objects.
+//-----------------------------------------------------------------------------
+//		Note : Start with *handle==kIPCHandleNone; returns NULL and sets
+//				kIPCHandleNone after the last object.
+//-----------------------------------------------------------------------------
+void *
+IPCHandle_Next(const TC3HandleTable *table, TQ3Uns32 *handle)
+{
+	TQ3Uns32 index = (*handle==kIPCHandleNone) ? 0 : (*handle & 0xFFFF)+1;
+	
+	for (; index<table->capacity; index++)
+		if (table->slots[index].object!=NULL)
+		{
+			*handle = (table->slots[index].generation<<16) | index;
+			return(table->slots[index].object);
+		}
+	
+	*handle = kIPCHandleNone;
+	return(NULL);
+}
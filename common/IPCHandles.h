@@ -0,0 +1,101 @@
+/*  NAME:
+        IPCHandles.h
+
+    DESCRIPTION:
+        Used by QuesaOSXDeviceServer and ControllerCoreOSX.
+		
+		Generational integer handles for objects referenced across IPC.
+		
+		A handle packs a slot index (low 16 bits) and the generation of that slot
+		(high 16 bits). Reusing a slot bumps its generation, so a stale handle
+		fails to resolve instead of reaching the next occupant. 0 is never a
+		valid handle.
+      
+    COPYRIGHT:
+        Copyright (c) 1999-2005, Quesa Developers. All rights reserved.
+
+        For the current release of Quesa, please see:
+
+            <http://www.quesa.org/>
+        
+        Redistribution and use in source and binary forms, with or without
+        modification, are permitted provided that the following conditions
+        are met:
+        
+            o Redistributions of source code must retain the above copyright
+              notice, this list of conditions and the following disclaimer.
+        
+            o Redistributions in binary form must reproduce the above
+              copyright notice, this list of conditions and the following
+              disclaimer in the documentation and/or other materials provided
+              with the distribution.
+        
+            o Neither the name of Quesa nor the names of its contributors
+              may be used to endorse or promote products derived from this
+              software without specific prior written permission.
+        
+        THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+        "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+        LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+        A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+        OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+        SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+        TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+        PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+        LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+        NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+        SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+    ___________________________________________________________________________
+*/
+
+
+
+#ifndef IPCHandles_HDR
+#define IPCHandles_HDR
+
+#include <Carbon/Carbon.h>
+
+//=============================================================================
+//		C++ preamble
+//-----------------------------------------------------------------------------
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define kIPCHandleNone				0
+
+typedef struct TC3HandleSlot
+{
+	void					*object;		//NULL: slot is free
+	TQ3Uns32				generation;
+	TQ3Uns32				nextFree;
+} TC3HandleSlot;
+
+typedef struct TC3HandleTable
+{
+	TC3HandleSlot			*slots;
+	TQ3Uns32				capacity;
+	TQ3Uns32				count;
+	TQ3Uns32				freeHead;
+} TC3HandleTable;
+
+//initializer for a static TC3HandleTable
+#define kIPCHandleTableEmpty		{ NULL, 0, 0, 0xFFFFFFFF }
+
+//=============================================================================
+//      Function prototypes
+//-----------------------------------------------------------------------------
+TQ3Uns32	IPCHandle_Insert(TC3HandleTable *table, void *object);
+void		*IPCHandle_Lookup(const TC3HandleTable *table, TQ3Uns32 handle);
+void		*IPCHandle_Remove(TC3HandleTable *table, TQ3Uns32 handle);
+TQ3Status	IPCHandle_InsertAt(TC3HandleTable *table, TQ3Uns32 handle, void *object);
+void		*IPCHandle_Next(const TC3HandleTable *table, TQ3Uns32 *handle);
+
+//=============================================================================
+//		C++ postamble
+//-----------------------------------------------------------------------------
+#ifdef __cplusplus
+}
+#endif
+
+#endif
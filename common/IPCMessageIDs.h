@@ -85,14 +85,30 @@ enum
 	m3Controller_MoveTrackerOrientation		= 1021,
 	m3Controller_GetValues					= 1022,
 	m3Controller_SetValues					= 1023,
+	m3Controller_WaitForValues				= 1024,
+	m3Controller_GetConsumerState			= 1025,
+	m3Controller_SetFilter					= 1026,
+	m3Controller_SetChannels				= 1027,
+	m3Controller_GetChannels				= 1028,
+	m3Controller_GetDriverEndpoint			= 1029,
+	m3Controller_ChannelChanged				= 1030,
 	m3ControllerDriver_SetChannel			= 1500,
 	m3ControllerDriver_GetChannel			= 1501,
 	m3ControllerDriver_StateSaveAndReset	= 1502,
 	m3ControllerDriver_StateRestore			= 1503,
+	m3ControllerDriver_StateSaveAndResetBatch	= 1504,
+	m3ControllerDriver_StateRestoreBatch	= 1505,
+	m3ControllerDriver_SetChannels			= 1506,
+	m3ControllerDriver_GetChannels			= 1507,
+	m3ControllerDriver_DirectSetChannel		= 1508,
+	m3ControllerDriver_DirectGetChannel		= 1509,
+	m3ControllerDriver_GetMethods			= 1510,
 	m3ControllerState_New					= 1700,
 	m3ControllerState_Delete				= 1701,
 	m3ControllerState_SaveAndReset			= 1702,
 	m3ControllerState_Restore				= 1703,
+	m3ControllerState_SaveAndResetBatch		= 1704,
+	m3ControllerState_RestoreBatch			= 1705,
 	m3Tracker_ChangeButtons					= 2000,
 	m3Tracker_GetActivation					= 2001,
 	m3Tracker_GetPosition					= 2002,
@@ -107,6 +123,7 @@ enum
 #define kQuesa3DeviceServer 	"com.quesa.osx.3device.server"
 #define kQuesa3DeviceDriver 	"com.quesa.osx.3device.driver"
 #define kQuesa3DeviceTracker 	"com.quesa.osx.3device.tracker"
+#define kQuesa3DeviceReply 		"com.quesa.osx.3device.reply"
 
 //Constants for controller values
 #define k3CtrlRef			"E3CtrlRef"
@@ -119,8 +136,14 @@ enum
 #define k3Channel			"E3Channel"
 #define k3ChannelCount		"E3ChannelCount"
 #define k3ChannelsData		"E3ChannelsData"
+#define k3Channels			"E3Channels"		//CFArray of per channel dictionaries (k3Channel, k3Data, k3DataSize, k3Status), in request order
+#define k3ChannelMask		"E3ChannelMask"		//bit per channel to read (save) or to set (restore); absent: all
+#define k3ResetMask			"E3ResetMask"		//bit per channel to reset (save); absent: all
 #define k3DataSize			"E3DataSize"
 #define k3Data				"E3Data"
+#define k3DataShm			"E3DataShm"			//name of the shared memory segment holding the data instead of k3Data
+#define k3DataShmSize		"E3DataShmSize"		//size of that segment
+#define k3DataOffset		"E3DataOffset"		//offset of a channel's data in that segment (state save)
 #define k3MethodRef			"E3MethodRef"
 #define k3SetMethodRef		"E3SetMethodRef"
 #define k3GetMethodRef		"E3GetMethodRef"
@@ -139,16 +162,39 @@ enum
 #define k3ValueCount		"E3ValueCount"
 #define k3PrivValueCount	"E3PrivValueCount"
 #define k3ValuesChanged		"E3ValuesChanged"
+#define k3hasSubscribers	"E3hasSubscribers"
+#define k3ConsumerRate		"E3ConsumerRate"
 
 #define k3CtrlStateUUID		"E3CtrlStateUUID"
+#define k3CtrlStateHandle	"E3CtrlStateHandle"
+#define k3CtrlStates		"E3CtrlStates"		//CFArray of per state dictionaries of a batch, in request order
+#define k3StateStatuses		"E3StateStatuses"	//CFArray of CFNumber, status per state of a batch
+
+//Constants for filter stages; see ControllerFilter.h of the device server
+#define k3FilterStages		"E3FilterStages"	//CFArray of stage dictionaries; absent: no filter
+#define k3FilterType		"E3FilterType"		//CFString, one of the stage types below
+#define k3FilterParams		"E3FilterParams"	//CFArray of CFNumber
+#define k3FilterDeadZone	"DeadZone"			//radius
+#define k3FilterGain		"Gain"				//gain, exponent (default 1)
+#define k3FilterSmooth		"Smooth"			//alpha in (0,1]; 1 passes unchanged
+#define k3FilterOneEuro		"OneEuro"			//minCutoff (Hz), beta, dCutoff (Hz, default 1)
+#define k3FilterRemap		"Remap"				//per output channel: 1-based source channel; negative inverts
 
 //Constants for tracker values
 #define k3TrackerUUID		"E3TrackerUUID"
+#define k3TrackerHandle		"E3TrackerHandle"
 #define k3TrackerPortName	"E3TrackerPortName"
 
+//Constants for asynchronous requests
+#define k3ReplyPortName		"E3ReplyPortName"
+#define k3RequestTag		"E3RequestTag"
+
 //Constants for driver values
 #define k3DriverUUID		"E3DriverUUID"
 #define k3DriverPortName	"E3DriverPortName"
+#define k3DriverHandle		"E3DriverHandle"	//controller in the driver, for direct channel calls
+#define k3CapToken			"E3CapToken"		//capability for direct channel calls; 0: none
+#define k3CapValid			"E3CapValid"		//driver accepted the capability of a direct call
 
 //=============================================================================
 //		C++ postamble
@@ -0,0 +1,217 @@
+/*  NAME:
+        IPCSharedData.c
+
+    DESCRIPTION:
+        Used by ControllerCoreOSX.
+		
+		POSIX shared memory segments for large channel data.
+      
+    COPYRIGHT:
+        Copyright (c) 1999-2005, Quesa Developers. All rights reserved.
+
+        For the current release of Quesa, please see:
+
+            <http://www.quesa.org/>
+        
+        Redistribution and use in source and binary forms, with or without
+        modification, are permitted provided that the following conditions
+        are met:
+        
+            o Redistributions of source code must retain the above copyright
+              notice, this list of conditions and the following disclaimer.
+        
+            o Redistributions in binary form must reproduce the above
+              copyright notice, this list of conditions and the following
+              disclaimer in the documentation and/or other materials provided
+              with the distribution.
+        
+            o Neither the name of Quesa nor the names of its contributors
+              may be used to endorse or promote products derived from this
+              software without specific prior written permission.
+        
+        THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+        "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+        LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+        A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+        OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+        SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+        TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+        PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+        LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+        NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+        SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+    ___________________________________________________________________________
+*/
+
+
+
+
+#include "IPCSharedData.h"
+#include "IPCMessageIDs.h"
+#include "IPCPackUnpack.h"
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <stdio.h>
+
+
+
+
+
+//=============================================================================
+//      Internal functions
+//-----------------------------------------------------------------------------
+//      IPCSharedData_Map : Map the open segment fd into shared.
+//-----------------------------------------------------------------------------
+static TQ3Status
+IPCSharedData_Map(int fd, TQ3Uns32 size, TC3IPCSharedData *shared)
+{
+	void *bytes = mmap(NULL, (size>0) ? size : 1, PROT_READ|PROT_WRITE, MAP_SHARED, fd, 0);
+	
+	close(fd);
+	if (bytes==MAP_FAILED)
+		return(kQ3Failure);
+	
+	shared->bytes = bytes;
+	shared->size = size;
+	return(kQ3Success);
+}
+
+
+
+
+
+//=============================================================================
+//      Public functions
+//-----------------------------------------------------------------------------
+//      IPCSharedData_Create : Create a segment of size bytes owned by the
+//				caller.
+//-----------------------------------------------------------------------------
+//		Note : The segment lives until IPCSharedData_Close of the owner.
+//-----------------------------------------------------------------------------
+TQ3Status
+IPCSharedData_Create(TQ3Uns32 size, TC3IPCSharedData *shared)
+{
+	static TQ3Uns32	segmentCount = 0;
+	int				fd;
+	
+	shared->bytes = NULL;
+	shared->size = 0;
+	shared->isOwner = kQ3False;
+	
+	if (size>kIPCSharedDataMaxSize)
+		return(kQ3Failure);
+	
+	snprintf(shared->name, kIPCSharedDataNameSize, "/q3cc.%d.%lu", (int)getpid(), (unsigned long)++segmentCount);
+	
+	fd = shm_open(shared->name, O_RDWR|O_CREAT|O_EXCL, S_IRUSR|S_IWUSR);
+	if (fd<0)
+		return(kQ3Failure);
+	
+	if (ftruncate(fd, (size>0) ? size : 1)!=0)
+	{
+		close(fd);
+		shm_unlink(shared->name);
+		return(kQ3Failure);
+	}
+	
+	if (IPCSharedData_Map(fd, size, shared)==kQ3Failure)
+	{
+		shm_unlink(shared->name);
+		return(kQ3Failure);
+	}
+	
+	shared->isOwner = kQ3True;
+	return(kQ3Success);
+}
+
+
+
+//=============================================================================
+//      IPCSharedData_Put : Let the request dict refer to the segment.
+//-----------------------------------------------------------------------------
+Boolean
+IPCSharedData_Put(CFMutableDictionaryRef dict, const TC3IPCSharedData *shared)
+{
+	CFStringRef	name;
+	TQ3Uns32	size = shared->size;
+	
+	name = CFStringCreateWithCString(kCFAllocatorDefault, shared->name, kCFStringEncodingASCII);
+	if (name==NULL)
+		return(false);
+	
+	CFDictionarySetValue(dict, CFSTR(k3DataShm), name);
+	CFRelease(name);
+	
+	return(IPCPutTQ3Uns32(dict, CFSTR(k3DataShmSize), &size));
+}
+
+
+
+//=============================================================================
+//      IPCSharedData_InDict : Does the request carry its data in a segment?
+//-----------------------------------------------------------------------------
+Boolean
+IPCSharedData_InDict(CFDictionaryRef dict)
+{
+	return(CFDictionaryGetValue(dict, CFSTR(k3DataShm))!=NULL);
+}
+
+
+
+//=============================================================================
+//      IPCSharedData_Open : Map the segment a request refers to.
+//-----------------------------------------------------------------------------
+//		Note : Fails if the segment is smaller than announced, so a sender
+//				can not make the driver read or write beyond it.
+//-----------------------------------------------------------------------------
+TQ3Status
+IPCSharedData_Open(CFDictionaryRef dict, TC3IPCSharedData *shared)
+{
+	CFStringRef		name = (CFStringRef)CFDictionaryGetValue(dict, CFSTR(k3DataShm));
+	TQ3Uns32		size = 0;
+	struct stat		info;
+	int				fd;
+	
+	shared->bytes = NULL;
+	shared->size = 0;
+	shared->isOwner = kQ3False;
+	
+	if ((name==NULL) || (!CFStringGetCString(name, shared->name, kIPCSharedDataNameSize, kCFStringEncodingASCII)))
+		return(kQ3Failure);
+	
+	IPCGetTQ3Uns32(dict, CFSTR(k3DataShmSize), &size);
+	if (size>kIPCSharedDataMaxSize)
+		return(kQ3Failure);
+	
+	fd = shm_open(shared->name, O_RDWR, 0);
+	if (fd<0)
+		return(kQ3Failure);
+	
+	if ((fstat(fd, &info)!=0) || (info.st_size<(off_t)size))
+	{
+		close(fd);
+		return(kQ3Failure);
+	}
+	
+	return(IPCSharedData_Map(fd, size, shared));
+}
+
+
+
+//=============================================================================
+//      IPCSharedData_Close : Unmap the segment; the owner also removes it.
+//-----------------------------------------------------------------------------
+void
+IPCSharedData_Close(TC3IPCSharedData *shared)
+{
+	if (shared->bytes!=NULL)
+		munmap(shared->bytes, (shared->size>0) ? shared->size : 1);
+	shared->bytes = NULL;
+	
+	if (shared->isOwner==kQ3True)
+		shm_unlink(shared->name);
+	shared->isOwner = kQ3False;
+}
@@ -0,0 +1,100 @@
+/*  NAME:
+        IPCSharedData.h
+
+    DESCRIPTION:
+        Used by ControllerCoreOSX.
+		
+		Shared memory for channel data too large to travel inline in a
+		property list. The requesting side creates and owns a segment, the
+		request only carries its name; the driver maps it and works in place.
+      
+    COPYRIGHT:
+        Copyright (c) 1999-2005, Quesa Developers. All rights reserved.
+
+        For the current release of Quesa, please see:
+
+            <http://www.quesa.org/>
+        
+        Redistribution and use in source and binary forms, with or without
+        modification, are permitted provided that the following conditions
+        are met:
+        
+            o Redistributions of source code must retain the above copyright
+              notice, this list of conditions and the following disclaimer.
+        
+            o Redistributions in binary form must reproduce the above
+              copyright notice, this list of conditions and the following
+              disclaimer in the documentation and/or other materials provided
+              with the distribution.
+        
+            o Neither the name of Quesa nor the names of its contributors
+              may be used to endorse or promote products derived from this
+              software without specific prior written permission.
+        
+        THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+        "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+        LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+        A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+        OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+        SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+        TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+        PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF
+        LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING
+        NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+        SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+    ___________________________________________________________________________
+*/
+
+
+
+
+#ifndef IPCSharedData_HDR
+#define IPCSharedData_HDR
+
+#include <Carbon/Carbon.h>
+
+//=============================================================================
+//		C++ preamble
+//-----------------------------------------------------------------------------
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//channel data above this size travels through shared memory instead of k3Data
+#define kIPCSharedDataThreshold		4096
+
+//sanity limit for a single segment
+#define kIPCSharedDataMaxSize		0x04000000
+
+#define kIPCSharedDataNameSize		32
+
+typedef struct TC3IPCSharedData
+{
+	char					name[kIPCSharedDataNameSize];
+	void					*bytes;		//NULL: not mapped
+	TQ3Uns32				size;
+	TQ3Boolean				isOwner;	//owner unlinks the segment on close
+} TC3IPCSharedData;
+
+//=============================================================================
+//      Function prototypes
+//-----------------------------------------------------------------------------
+//requesting side
+TQ3Status	IPCSharedData_Create(TQ3Uns32 size, TC3IPCSharedData *shared);
+Boolean		IPCSharedData_Put(CFMutableDictionaryRef dict, const TC3IPCSharedData *shared);
+
+//replying side
+Boolean		IPCSharedData_InDict(CFDictionaryRef dict);
+TQ3Status	IPCSharedData_Open(CFDictionaryRef dict, TC3IPCSharedData *shared);
+
+//both
+void		IPCSharedData_Close(TC3IPCSharedData *shared);
+
+//=============================================================================
+//		C++ postamble
+//-----------------------------------------------------------------------------
+#ifdef __cplusplus
+}
+#endif
+
+#endif